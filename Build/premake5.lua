@@ -4,9 +4,9 @@
 -- solution
 workspace "BuildAll"
     configurations { "Debug", "Release" }
+    platforms { "Win32", "x64" }
     location "Intermedia"
     language "C++"
-    architecture "x86"
     
 	-- Catch requires RTTI and exceptions
 	exceptionhandling "On"
@@ -25,11 +25,22 @@ workspace "BuildAll"
     filter "system:windows"
         defines { "_WIN32" }
 
+    filter "platforms:Win32"
+        architecture "x86"
+
+    filter "platforms:x64"
+        architecture "x86_64"
+
     filter {}
 
     targetdir("../Bin")  
     objdir("Intermedia/Obj/%{prj.name}/%{cfg.longname}")
     debugdir("../Bin")
+
+    filter "platforms:x64"
+        targetdir("../Bin/x64")
+
+    filter {}
 	
 -----------------------------------------------------   
 -- Helper function for set  ------------
@@ -72,6 +83,7 @@ project "Example_WriteCodePage"
 project "Example_ProtectSegmenet"
     kind "ConsoleApp"
     setup_include_link_env()
+	removeplatforms { "x64" }
 	files {
         "../Src/Examples/ProtectSegmenet.cpp"
     }
@@ -80,6 +92,7 @@ project "Example_ProtectSegmenet"
 project "Example_Fault"
     kind "ConsoleApp"
     setup_include_link_env()
+	removeplatforms { "x64" }
 	files {
         "../Src/Examples/Fault.cpp"
     }
@@ -98,6 +111,7 @@ project "Example_B2BStep"
 project "Example_HiInt3"
     kind "ConsoleApp"
     setup_include_link_env()
+	removeplatforms { "x64" }
 	files {
         "../Src/Examples/HiInt3.cpp"
     }
@@ -106,6 +120,7 @@ project "Example_HiInt3"
 project "Example_DataBP"
     kind "ConsoleApp"
     setup_include_link_env()
+	removeplatforms { "x64" }
 	files {
         "../Src/Examples/DataBP.cpp"
     }
@@ -114,6 +129,7 @@ project "Example_DataBP"
 project "Example_TryInt1"
     kind "ConsoleApp"
     setup_include_link_env()
+	removeplatforms { "x64" }
 	files {
         "../Src/Examples/TryInt1.cpp"
     }
@@ -146,6 +162,7 @@ project "Example_ConsoleScroll"
 project "Example_Debuggee"
     kind "ConsoleApp"
     setup_include_link_env()
+	removeplatforms { "x64" }
 	files {
         "../Src/Examples/Debuggee.cpp"
     }
@@ -154,6 +171,7 @@ project "Example_Debuggee"
 project "Example_VectoredExceptionHandler"
     kind "ConsoleApp"
     setup_include_link_env()
+	removeplatforms { "x64" }
 	files {
         "../Src/Examples/VectoredExceptionHandler.cpp"
     }	
@@ -170,6 +188,7 @@ project "Example_BufferOverflow"
 project "Example_SEH_Raw"
     kind "ConsoleApp"
     setup_include_link_env()
+	removeplatforms { "x64" }
 	files {
         "../Src/Examples/SEH_Raw.cpp"
     }
@@ -195,10 +214,12 @@ project "WinDebugger"
     kind "ConsoleApp"
     setup_include_link_env()
 	defines { " DBGHELP_TRANSLATE_TCHAR" }
-	links { "dbghelp" }
+	links { "dbghelp", "winhttp" }
 	files {
 		"../Src/Foundation/AppHelper.h",
 		"../Src/Foundation/AppHelper.cpp",
+		"../Src/Foundation/AppMappedFile.h",
+		"../Src/Foundation/AppMappedFile.cpp",
 		"../Src/WinDebugger/WinProcessHelper.h",
 		"../Src/WinDebugger/WinProcessHelper.cpp",
 		"../Src/WinDebugger/WinDebugger.h",
@@ -208,5 +229,205 @@ project "WinDebugger"
 		"../Src/WinDebugger/WinVariableTypeHelper.cpp",
 		"../Src/WinDebugger/WinStackTraceHelper.h",
 		"../Src/WinDebugger/WinStackTraceHelper.cpp",
+		"../Src/WinDebugger/WinMemoryDumpHelper.h",
+		"../Src/WinDebugger/WinMemoryDumpHelper.cpp",
+		"../Src/WinDebugger/WinRemoteMemory.h",
+		"../Src/WinDebugger/WinRemoteMemory.cpp",
+		"../Src/WinDebugger/WinHeapWalker.h",
+		"../Src/WinDebugger/WinHeapWalker.cpp",
+		"../Src/WinDebugger/WinHeapSnapshot.h",
+		"../Src/WinDebugger/WinHeapSnapshot.cpp",
+		"../Src/WinDebugger/WinPdbReader.h",
+		"../Src/WinDebugger/WinPdbReader.cpp",
+		"../Src/WinDebugger/WinPdbTypeSource.h",
+		"../Src/WinDebugger/WinPdbTypeSource.cpp",
+		"../Src/WinDebugger/WinSymbolIndex.h",
+		"../Src/WinDebugger/WinSymbolIndex.cpp",
+		"../Src/WinDebugger/WinLineTable.h",
+		"../Src/WinDebugger/WinLineTable.cpp",
+		"../Src/WinDebugger/WinSymbolCache.h",
+		"../Src/WinDebugger/WinSymbolCache.cpp",
+		"../Src/WinDebugger/WinPeImage.h",
+		"../Src/WinDebugger/WinPeImage.cpp",
+		"../Src/WinDebugger/WinSymbolStore.h",
+		"../Src/WinDebugger/WinSymbolStore.cpp",
+		"../Src/WinDebugger/WinTaskPool.h",
+		"../Src/WinDebugger/WinTaskPool.cpp",
+		"../Src/WinDebugger/WinDemangler.h",
+		"../Src/WinDebugger/WinDemangler.cpp",
+		"../Src/WinDebugger/WinSymbolSearch.h",
+		"../Src/WinDebugger/WinSymbolSearch.cpp",
+		"../Src/WinDebugger/WinStringPool.h",
+		"../Src/WinDebugger/WinStringPool.cpp",
+		"../Src/WinDebugger/WinValueFormatter.h",
+		"../Src/WinDebugger/WinValueFormatter.cpp",
+		"../Src/WinDebugger/WinVisualizer.h",
+		"../Src/WinDebugger/WinVisualizer.cpp",
+		"../Src/WinDebugger/WinArrayStats.h",
+		"../Src/WinDebugger/WinArrayStats.cpp",
+		"../Src/WinDebugger/WinX64Unwinder.h",
+		"../Src/WinDebugger/WinX64Unwinder.cpp",
+		"../Src/WinDebugger/WinUniqueStacks.h",
+		"../Src/WinDebugger/WinUniqueStacks.cpp",
         "../Src/WinDebugger/Main.cpp"
     }	
+
+	-- project: x64 unwinder test over the fixtures of Data/Tests, portable, takes more x64 images
+project "Test_X64Unwinder"
+    kind "ConsoleApp"
+    setup_include_link_env()
+	files {
+		"../Src/Foundation/AppMappedFile.h",
+		"../Src/Foundation/AppMappedFile.cpp",
+		"../Src/WinDebugger/WinRemoteMemory.h",
+		"../Src/WinDebugger/WinRemoteMemory.cpp",
+		"../Src/WinDebugger/WinPeImage.h",
+		"../Src/WinDebugger/WinPeImage.cpp",
+		"../Src/WinDebugger/WinX64Unwinder.h",
+		"../Src/WinDebugger/WinX64Unwinder.cpp",
+		"../Src/Tests/TestHelper.h",
+		"../Src/Tests/X64UnwinderTest.cpp"
+    }
+
+	-- project: memory dump formatter test and benchmark, portable
+project "Test_MemoryDump"
+    kind "ConsoleApp"
+    setup_include_link_env()
+	files {
+		"../Src/WinDebugger/WinMemoryDumpHelper.h",
+		"../Src/WinDebugger/WinMemoryDumpHelper.cpp",
+		"../Src/Tests/TestHelper.h",
+		"../Src/Tests/MemoryDumpTest.cpp"
+    }
+
+	-- project: NT heap walker test over the captured heap images of Data/Tests, portable
+project "Test_HeapWalker"
+    kind "ConsoleApp"
+    setup_include_link_env()
+	files {
+		"../Src/WinDebugger/WinRemoteMemory.h",
+		"../Src/WinDebugger/WinRemoteMemory.cpp",
+		"../Src/WinDebugger/WinHeapWalker.h",
+		"../Src/WinDebugger/WinHeapWalker.cpp",
+		"../Src/Tests/TestHelper.h",
+		"../Src/Tests/HeapWalkerTest.cpp"
+    }
+
+	-- project: symbol index test and lookup benchmark over synthetic tables, portable
+project "Test_SymbolIndex"
+    kind "ConsoleApp"
+    setup_include_link_env()
+	files {
+		"../Src/Foundation/AppMappedFile.h",
+		"../Src/Foundation/AppMappedFile.cpp",
+		"../Src/WinDebugger/WinSymbolCache.h",
+		"../Src/WinDebugger/WinSymbolCache.cpp",
+		"../Src/WinDebugger/WinSymbolIndex.h",
+		"../Src/WinDebugger/WinSymbolIndex.cpp",
+		"../Src/Tests/TestHelper.h",
+		"../Src/Tests/SymbolIndexTest.cpp"
+    }
+
+	-- project: PE image test over the sample images of Data/Tests, portable
+project "Test_PeImage"
+    kind "ConsoleApp"
+    setup_include_link_env()
+	files {
+		"../Src/Foundation/AppMappedFile.h",
+		"../Src/Foundation/AppMappedFile.cpp",
+		"../Src/WinDebugger/WinRemoteMemory.h",
+		"../Src/WinDebugger/WinRemoteMemory.cpp",
+		"../Src/WinDebugger/WinPeImage.h",
+		"../Src/WinDebugger/WinPeImage.cpp",
+		"../Src/Tests/TestHelper.h",
+		"../Src/Tests/PeImageTest.cpp"
+    }
+
+	-- project: demangler test over a name corpus and demangle benchmark, portable
+project "Test_Demangler"
+    kind "ConsoleApp"
+    setup_include_link_env()
+	files {
+		"../Src/WinDebugger/WinDemangler.h",
+		"../Src/WinDebugger/WinDemangler.cpp",
+		"../Src/Tests/TestHelper.h",
+		"../Src/Tests/DemanglerTest.cpp"
+    }
+
+	-- project: type arena test and build/lookup benchmark over generated type tables
+project "Test_TypeArena"
+    kind "ConsoleApp"
+    setup_include_link_env()
+	defines { " DBGHELP_TRANSLATE_TCHAR" }
+	links { "dbghelp" }
+	files {
+		"../Src/Foundation/AppHelper.h",
+		"../Src/Foundation/AppHelper.cpp",
+		"../Src/WinDebugger/WinProcessHelper.h",
+		"../Src/WinDebugger/WinProcessHelper.cpp",
+		"../Src/WinDebugger/WinRemoteMemory.h",
+		"../Src/WinDebugger/WinRemoteMemory.cpp",
+		"../Src/WinDebugger/WinStringPool.h",
+		"../Src/WinDebugger/WinStringPool.cpp",
+		"../Src/WinDebugger/WinValueFormatter.h",
+		"../Src/WinDebugger/WinValueFormatter.cpp",
+		"../Src/WinDebugger/WinVisualizer.h",
+		"../Src/WinDebugger/WinVisualizer.cpp",
+		"../Src/WinDebugger/WinVariableTypeHelper.h",
+		"../Src/WinDebugger/WinVariableTypeHelper.cpp",
+		"../Src/Tests/TestHelper.h",
+		"../Src/Tests/TestTypeSource.h",
+		"../Src/Tests/TypeArenaTest.cpp"
+    }
+
+	-- project: batched type query test and call count benchmark over generated type tables
+project "Test_TypeQuery"
+    kind "ConsoleApp"
+    setup_include_link_env()
+	defines { " DBGHELP_TRANSLATE_TCHAR" }
+	links { "dbghelp" }
+	files {
+		"../Src/Foundation/AppHelper.h",
+		"../Src/Foundation/AppHelper.cpp",
+		"../Src/WinDebugger/WinProcessHelper.h",
+		"../Src/WinDebugger/WinProcessHelper.cpp",
+		"../Src/WinDebugger/WinRemoteMemory.h",
+		"../Src/WinDebugger/WinRemoteMemory.cpp",
+		"../Src/WinDebugger/WinStringPool.h",
+		"../Src/WinDebugger/WinStringPool.cpp",
+		"../Src/WinDebugger/WinValueFormatter.h",
+		"../Src/WinDebugger/WinValueFormatter.cpp",
+		"../Src/WinDebugger/WinVisualizer.h",
+		"../Src/WinDebugger/WinVisualizer.cpp",
+		"../Src/WinDebugger/WinVariableTypeHelper.h",
+		"../Src/WinDebugger/WinVariableTypeHelper.cpp",
+		"../Src/Tests/TestHelper.h",
+		"../Src/Tests/TestTypeSource.h",
+		"../Src/Tests/TypeQueryTest.cpp"
+    }
+
+	-- project: layout plan test and benchmark against the member by member formatting
+project "Test_LayoutPlan"
+    kind "ConsoleApp"
+    setup_include_link_env()
+	defines { " DBGHELP_TRANSLATE_TCHAR" }
+	links { "dbghelp" }
+	files {
+		"../Src/Foundation/AppHelper.h",
+		"../Src/Foundation/AppHelper.cpp",
+		"../Src/WinDebugger/WinProcessHelper.h",
+		"../Src/WinDebugger/WinProcessHelper.cpp",
+		"../Src/WinDebugger/WinRemoteMemory.h",
+		"../Src/WinDebugger/WinRemoteMemory.cpp",
+		"../Src/WinDebugger/WinStringPool.h",
+		"../Src/WinDebugger/WinStringPool.cpp",
+		"../Src/WinDebugger/WinValueFormatter.h",
+		"../Src/WinDebugger/WinValueFormatter.cpp",
+		"../Src/WinDebugger/WinVisualizer.h",
+		"../Src/WinDebugger/WinVisualizer.cpp",
+		"../Src/WinDebugger/WinVariableTypeHelper.h",
+		"../Src/WinDebugger/WinVariableTypeHelper.cpp",
+		"../Src/Tests/TestHelper.h",
+		"../Src/Tests/TestTypeSource.h",
+		"../Src/Tests/LayoutPlanTest.cpp"
+    }
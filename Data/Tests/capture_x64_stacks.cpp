@@ -0,0 +1,306 @@
+// \brief
+//		captures the stacks of unwind_x64_stacks.txt, linux x86_64 only. unwind_x64.dll is mapped at
+//		its image base, Entry is run on a stack at a fixed address with the trap flag set, and at each
+//		instruction inside the image the registers, the written part of the stack and the frames are
+//		printed. the frames are tracked from the calls and rets executed, not from the unwind info.
+//
+// cmd> capture_x64_stacks unwind_x64.dll > unwind_x64_stacks.txt
+//
+
+#include <signal.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace NSCapture
+{
+	const uint64_t kStackBase   = 0x10000000;
+	const uint64_t kStackSize   = 0x100000;
+	// home space and a 0 return address above the first frame end the walk
+	const uint64_t kStackTop    = kStackBase + kStackSize - 0x30;
+	// the host code calling Entry
+	const uint64_t kHostBase    = 0x11000000;
+	const uint64_t kFill        = 0xCCCCCCCCCCCCCCCCull;
+	const uint64_t kArgument    = 5;
+}
+
+// registers in ucontext order, printed in unwind code order: rax rcx rdx rbx rsp rbp rsi rdi r8..r15
+static const int sRegisters[16] = { REG_RAX, REG_RCX, REG_RDX, REG_RBX, REG_RSP, REG_RBP, REG_RSI, REG_RDI,
+	REG_R8, REG_R9, REG_R10, REG_R11, REG_R12, REG_R13, REG_R14, REG_R15 };
+// rbx rbp rsi rdi r12 r13 r14 r15
+static const int sNonvolatile[8] = { 3, 5, 6, 7, 12, 13, 14, 15 };
+
+struct FCall
+{
+	uint64_t	ReturnAddress;
+	uint64_t	Rsp;			// of the caller after the return
+	uint64_t	Registers[16];	// at the call
+};
+
+static uint64_t sImageBase, sImageEnd;
+static uint64_t sLastRip, sLastRsp;
+static std::vector<FCall> sCalls;
+static uint32_t sSamples;
+
+extern "C" void RunTraced(uint64_t InEntry, uint64_t InArgument);
+extern "C" uint64_t sHostRsp;
+
+// switch to the fixed stack, set the nonvolatile registers to patterns and clear the volatile ones, set the trap flag and jump to the
+// host stub, which calls Entry, clears the trap flag and jumps back through the address at kHostBase + 18
+asm(R"(
+	.text
+	.globl	RunTraced
+RunTraced:
+	push	%rbp
+	push	%rbx
+	push	%r12
+	push	%r13
+	push	%r14
+	push	%r15
+	mov		%rsp, sHostRsp(%rip)
+	lea		RunTracedDone(%rip), %rax
+	mov		$0x11000012, %r8
+	mov		%rax, (%r8)
+	mov		$0x11000000, %r9
+	mov		$0x100FFFD0, %rsp
+	mov		%rsi, %rcx
+	xor		%edx, %edx
+	xor		%r10d, %r10d
+	xor		%r11d, %r11d
+	movabs	$0x1B1B1B1B1B1B1B1B, %rbx
+	movabs	$0x1B0B0B0B0B0B0B0B, %rbp
+	movabs	$0x1A1A1A1A1A1A1A1A, %rsi
+	movabs	$0x1D1D1D1D1D1D1D1D, %r12
+	movabs	$0x1C1C1C1C1C1C1C1C, %r13
+	movabs	$0x1E1E1E1E1E1E1E1E, %r14
+	movabs	$0x1F1F1F1F1F1F1F1F, %r15
+	mov		%rdi, %rax
+	movabs	$0x1010101010101010, %rdi
+	pushfq
+	orq		$0x100, (%rsp)
+	popfq
+	jmp		*%r9
+RunTracedDone:
+	mov		sHostRsp(%rip), %rsp
+	pop		%r15
+	pop		%r14
+	pop		%r13
+	pop		%r12
+	pop		%rbx
+	pop		%rbp
+	ret
+	.data
+	.globl	sHostRsp
+sHostRsp:
+	.quad	0
+)");
+
+// call rax; pushfq; and qword [rsp], ~0x100; popfq; jmp [rip]
+static const uint8_t sHostStub[] = { 0xFF, 0xD0, 0x9C, 0x48, 0x81, 0x24, 0x24, 0xFF, 0xFE, 0xFF, 0xFF, 0x9D, 0xFF, 0x25, 0x00, 0x00, 0x00, 0x00 };
+
+static uint64_t Read64(uint64_t InAddress)
+{
+	uint64_t Value;
+	memcpy(&Value, (const void*)InAddress, 8);
+	return Value;
+}
+
+static uint32_t GetCallLength(uint64_t InRip)
+{
+	const uint8_t *Code = (const uint8_t*)InRip;
+	if (Code[0] == 0xE8)
+	{
+		return 5;
+	}
+	if (Code[0] == 0xFF && (Code[1] & 0xF8) == 0xD0)
+	{
+		return 2;
+	}
+	return 0;
+}
+
+static void PrintSample(const uint64_t *InRegisters, uint64_t InRip)
+{
+	using namespace NSCapture;
+
+	printf("sample %llx\nregs", (unsigned long long)InRip);
+	for (int k = 0; k < 16; k++)
+	{
+		printf(" %llx", (unsigned long long)InRegisters[k]);
+	}
+	const FCall &Caller = sCalls.back();
+	printf("\ncaller %llx %llx", (unsigned long long)Caller.ReturnAddress, (unsigned long long)Caller.Rsp);
+	for (int k = 0; k < 8; k++)
+	{
+		printf(" %llx", (unsigned long long)Caller.Registers[sNonvolatile[k]]);
+	}
+	printf("\nframes %llx", (unsigned long long)InRip);
+	for (size_t k = sCalls.size(); k-- > 0; )
+	{
+		printf(" %llx", (unsigned long long)sCalls[k].ReturnAddress);
+	}
+
+	// runs of the qwords written since the stack was filled
+	for (uint64_t Address = InRegisters[4]; Address < kStackBase + kStackSize; )
+	{
+		if (Read64(Address) == kFill)
+		{
+			Address += 8;
+			continue;
+		}
+		printf("\nmemory %llx", (unsigned long long)Address);
+		for (; Address < kStackBase + kStackSize && Read64(Address) != kFill; Address += 8)
+		{
+			printf(" %llx", (unsigned long long)Read64(Address));
+		}
+	}
+	printf("\nend\n");
+	sSamples++;
+}
+
+static void OnTrap(int, siginfo_t *, void *InContext)
+{
+	const greg_t *Context = ((ucontext_t*)InContext)->uc_mcontext.gregs;
+	uint64_t Registers[16];
+	for (int k = 0; k < 16; k++)
+	{
+		Registers[k] = (uint64_t)Context[sRegisters[k]];
+	}
+	const uint64_t Rip = (uint64_t)Context[REG_RIP], Rsp = Registers[4];
+
+	if (sLastRip)
+	{
+		const uint32_t CallLength = GetCallLength(sLastRip);
+		if (CallLength && Rsp == sLastRsp - 8 && Read64(Rsp) == sLastRip + CallLength)
+		{
+			FCall Call;
+			Call.ReturnAddress = Read64(Rsp);
+			Call.Rsp = Rsp + 8;
+			memcpy(Call.Registers, Registers, sizeof(Registers));
+			sCalls.push_back(Call);
+		}
+		else if (*(const uint8_t*)sLastRip == 0xC3 && !sCalls.empty())
+		{
+			sCalls.pop_back();
+		}
+	}
+	sLastRip = Rip;
+	sLastRsp = Rsp;
+
+	if (Rip >= sImageBase && Rip < sImageEnd && !sCalls.empty())
+	{
+		PrintSample(Registers, Rip);
+	}
+}
+
+// the image in its loaded layout at its base, the entry point named InExport
+static bool MapImage(const char *InFilename, const char *InExport, uint64_t &OutEntry)
+{
+	FILE *File = fopen(InFilename, "rb");
+	if (!File)
+	{
+		return false;
+	}
+	std::vector<uint8_t> Data;
+	uint8_t Buffer[4096];
+	for (size_t Bytes; (Bytes = fread(Buffer, 1, sizeof(Buffer), File)) > 0; )
+	{
+		Data.insert(Data.end(), Buffer, Buffer + Bytes);
+	}
+	fclose(File);
+
+	uint32_t NtOffset;
+	memcpy(&NtOffset, &Data[0x3C], 4);
+	const uint8_t *Nt = &Data[NtOffset];
+	uint16_t SectionCount, OptionalSize;
+	uint32_t SizeOfImage, SizeOfHeaders, ExportRva;
+	memcpy(&SectionCount, Nt + 6, 2);
+	memcpy(&OptionalSize, Nt + 20, 2);
+	memcpy(&sImageBase, Nt + 24 + 24, 8);
+	memcpy(&SizeOfImage, Nt + 24 + 56, 4);
+	memcpy(&SizeOfHeaders, Nt + 24 + 60, 4);
+	memcpy(&ExportRva, Nt + 24 + 112, 4);
+
+	void *Image = mmap((void*)sImageBase, SizeOfImage, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+	if (Image != (void*)sImageBase)
+	{
+		return false;
+	}
+	sImageEnd = sImageBase + SizeOfImage;
+	memcpy(Image, &Data[0], SizeOfHeaders);
+	const uint8_t *Section = Nt + 24 + OptionalSize;
+	for (uint16_t k = 0; k < SectionCount; k++, Section += 40)
+	{
+		uint32_t VirtualAddress, RawSize, RawOffset;
+		memcpy(&VirtualAddress, Section + 12, 4);
+		memcpy(&RawSize, Section + 16, 4);
+		memcpy(&RawOffset, Section + 20, 4);
+		memcpy((uint8_t*)Image + VirtualAddress, &Data[RawOffset], RawSize);
+	} // end for k
+
+	// export directory: names at +32, ordinals at +36, functions at +28
+	const uint8_t *Export = (const uint8_t*)Image + ExportRva;
+	uint32_t NameCount, Functions, Names, Ordinals;
+	memcpy(&NameCount, Export + 24, 4);
+	memcpy(&Functions, Export + 28, 4);
+	memcpy(&Names, Export + 32, 4);
+	memcpy(&Ordinals, Export + 36, 4);
+	for (uint32_t k = 0; k < NameCount; k++)
+	{
+		const uint32_t NameRva = ((const uint32_t*)((const uint8_t*)Image + Names))[k];
+		if (!strcmp((const char*)Image + NameRva, InExport))
+		{
+			const uint16_t Ordinal = ((const uint16_t*)((const uint8_t*)Image + Ordinals))[k];
+			OutEntry = sImageBase + ((const uint32_t*)((const uint8_t*)Image + Functions))[Ordinal];
+			return true;
+		}
+	} // end for k
+	return false;
+}
+
+int main(int argc, char *argv[])
+{
+	using namespace NSCapture;
+
+	uint64_t Entry = 0;
+	if (argc < 2 || !MapImage(argv[1], "Entry", Entry))
+	{
+		fprintf(stderr, "usage: capture_x64_stacks unwind_x64.dll\n");
+		return 1;
+	}
+
+	uint8_t *Stack = (uint8_t*)mmap((void*)kStackBase, kStackSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+	uint8_t *Host = (uint8_t*)mmap((void*)kHostBase, 4096, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+	if (Stack != (uint8_t*)kStackBase || Host != (uint8_t*)kHostBase)
+	{
+		return 1;
+	}
+	memset(Stack, 0xCC, kStackSize);
+	memset(Stack + (kStackTop - kStackBase), 0, kStackBase + kStackSize - kStackTop);
+	memcpy(Host, sHostStub, sizeof(sHostStub));
+
+	static uint8_t SignalStack[1 << 16];
+	stack_t AltStack;
+	memset(&AltStack, 0, sizeof(AltStack));
+	AltStack.ss_sp = SignalStack;
+	AltStack.ss_size = sizeof(SignalStack);
+	sigaltstack(&AltStack, NULL);
+
+	struct sigaction Action;
+	memset(&Action, 0, sizeof(Action));
+	Action.sa_sigaction = OnTrap;
+	Action.sa_flags = SA_SIGINFO | SA_ONSTACK;
+	sigaction(SIGTRAP, &Action, NULL);
+
+	printf("# Entry(%llu) of unwind_x64.dll, one sample per instruction, see capture_x64_stacks.cpp\n", (unsigned long long)kArgument);
+	printf("stack %llx %llx\n", (unsigned long long)kStackBase, (unsigned long long)kStackSize);
+	RunTraced(Entry, kArgument);
+
+	fprintf(stderr, "%u samples\n", sSamples);
+	return sSamples ? 0 : 1;
+}
@@ -0,0 +1,42 @@
+#!/bin/sh
+# make_fixtures.sh
+#	rebuilds the test images and captures from their sources, on linux x86_64 with llvm and lld,
+#	and the captured heap images, which only need a c++ compiler.
+#	the outputs are checked in, the tests do not need these tools. the images are linked in a
+#	scratch directory with relative paths so that /brepro gives the same bytes on every run.
+#
+# cmd> cd Data/Tests && sh make_fixtures.sh
+#
+
+set -e
+# lld-link, or LLD_LINK="rust-lld -flavor link"
+LLD_LINK="${LLD_LINK:-lld-link}"
+SRC=$(pwd)
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+cd "$TMP"
+
+# unwind_x64.dll and the stacks of its Entry
+printf 'LIBRARY kernel32.dll\nEXPORTS\nGetTickCount\n' > kernel32_x64.def
+llvm-dlltool -m i386:x86-64 -d kernel32_x64.def -l kernel32_x64.lib
+llvm-mc -triple x86_64-pc-windows-msvc -filetype=obj "$SRC/unwind_x64.s" -o unwind_x64.obj
+$LLD_LINK /dll /noentry /nodefaultlib /brepro /machine:x64 /base:0x180000000 /debug /pdbaltpath:unwind_x64.pdb /pdbsourcepath:/fixtures \
+	/out:unwind_x64.dll unwind_x64.obj kernel32_x64.lib
+cp unwind_x64.dll "$SRC/"
+c++ -O1 -o capture_x64_stacks "$SRC/capture_x64_stacks.cpp"
+./capture_x64_stacks unwind_x64.dll > "$SRC/unwind_x64_stacks.txt"
+
+# pe_x86.dll, stdcall imports are named without their @n
+printf 'LIBRARY kernel32.dll\nEXPORTS\nGetTickCount@0\nSleep@4\n' > kernel32_x86.def
+printf 'LIBRARY helper.dll\nEXPORTS\nOrdinal7 @7 NONAME\n' > helper_x86.def
+llvm-dlltool -k -m i386 -d kernel32_x86.def -l kernel32_x86.lib
+llvm-dlltool -m i386 -d helper_x86.def -l helper_x86.lib
+llvm-mc -triple i686-pc-windows-msvc -filetype=obj "$SRC/pe_x86.s" -o pe_x86.obj
+$LLD_LINK /dll /noentry /nodefaultlib /brepro /safeseh:no /machine:x86 /base:0x10000000 /debug /pdbaltpath:pe_x86.pdb /pdbsourcepath:/fixtures \
+	/out:pe_x86.dll pe_x86.obj kernel32_x86.lib helper_x86.lib
+cp pe_x86.dll "$SRC/"
+
+# heap_x64.img and heap_x86_win7.img
+c++ -O1 -o make_heap_images "$SRC/make_heap_images.cpp"
+./make_heap_images
+cp heap_x64.img heap_x86_win7.img "$SRC/"
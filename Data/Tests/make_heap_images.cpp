@@ -0,0 +1,291 @@
+// \brief
+//		writes heap_x64.img and heap_x86_win7.img, the captured memory images of Test_HeapWalker, in
+//		the FCapturedMemory file format: { uint64 address, uint64 bytes, data } per region.
+//		the heaps are laid out with the offsets of dt ntdll!_HEAP, _HEAP_SEGMENT, _HEAP_ENTRY,
+//		_HEAP_UCR_DESCRIPTOR, _HEAP_VIRTUAL_ALLOC_ENTRY, _HEAP_USERDATA_HEADER and _PEB, written out
+//		here rather than taken from WinHeapWalker.cpp. HeapWalkerTest.cpp lists what they hold.
+//
+// cmd> make_heap_images
+//
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+
+// offsets of the fields the walker reads
+struct FImageLayout
+{
+	uint32_t	PointerSize;
+	uint32_t	Granularity;			// sizeof(HEAP_ENTRY)
+	uint32_t	EntryHeader;			// HEAP_ENTRY.Size, after PreviousBlockPrivateData on x64
+
+	uint32_t	SegmentSignature;
+	uint32_t	SegmentListEntry;
+	uint32_t	SegmentFirstEntry;
+	uint32_t	SegmentLastValidEntry;
+	uint32_t	SegmentUCRList;
+
+	uint32_t	HeapEncodeFlagMask;
+	uint32_t	HeapEncoding;
+	uint32_t	HeapSignature;
+	uint32_t	HeapVirtualAllocdBlocks;
+	uint32_t	HeapSegmentList;
+
+	uint32_t	UCRSegmentEntry;
+	uint32_t	UCRAddress;
+	uint32_t	UCRSize;
+
+	uint32_t	VirtualExtraStuff;
+	uint32_t	VirtualCommitSize;
+	uint32_t	VirtualBusyBlock;
+
+	uint32_t	UserDataSignature;
+	uint32_t	UserDataBusyBitmap;		// 0 on Windows 7
+
+	uint32_t	PebProcessHeap;
+	uint32_t	PebNumberOfHeaps;
+	uint32_t	PebProcessHeaps;
+};
+
+// x64, Windows 10
+static const FImageLayout sLayoutX64 =
+{
+	8, 16, 8,
+	0x10, 0x18, 0x40, 0x48, 0x60,
+	0x7C, 0x80, 0x98, 0x110, 0x120,
+	0x10, 0x20, 0x28,
+	0x10, 0x20, 0x30,
+	0x14, 0x20,
+	0x30, 0xE8, 0xF0
+};
+
+// x86, Windows 7: HEAP.PointerKey moves the fields after it one pointer up
+static const FImageLayout sLayoutX86Win7 =
+{
+	4, 8, 0,
+	0x08, 0x10, 0x24, 0x28, 0x38,
+	0x4C, 0x50, 0x64, 0xA0, 0xA8,
+	0x08, 0x10, 0x14,
+	0x08, 0x10, 0x18,
+	0x0C, 0,
+	0x18, 0x88, 0x90
+};
+
+class FImageWriter
+{
+public:
+	explicit FImageWriter(const FImageLayout &InLayout) : Layout(InLayout) {}
+
+	void AddRegion(uint64_t InAddress, uint32_t InBytes)
+	{
+		FRegion Region;
+		Region.Address = InAddress;
+		Region.Bytes.assign(InBytes, 0);
+		Regions.push_back(Region);
+	}
+
+	void Put(uint64_t InAddress, const void *InData, uint32_t InBytes)
+	{
+		for (size_t k = 0; k < Regions.size(); k++)
+		{
+			FRegion &Region = Regions[k];
+			if (InAddress >= Region.Address && InAddress + InBytes <= Region.Address + Region.Bytes.size())
+			{
+				memcpy(&Region.Bytes[(size_t)(InAddress - Region.Address)], InData, InBytes);
+				return;
+			}
+		} // end for k
+		fprintf(stderr, "no region at %llx\n", (unsigned long long)InAddress);
+	}
+
+	void Put32(uint64_t InAddress, uint32_t InValue) { Put(InAddress, &InValue, 4); }
+	void PutPointer(uint64_t InAddress, uint64_t InValue) { Put(InAddress, &InValue, Layout.PointerSize); }
+
+	// a LIST_ENTRY list: the head, then the entries, circular
+	void PutList(uint64_t InHead, const std::vector<uint64_t> &InEntries)
+	{
+		uint64_t Link = InHead;
+		for (size_t k = 0; k < InEntries.size(); k++)
+		{
+			PutPointer(Link, InEntries[k]);
+			Link = InEntries[k];
+		} // end for k
+		PutPointer(Link, InHead);
+	}
+
+	// HEAP_ENTRY: Size(2) Flags(1) SmallTagIndex(1) PreviousSize(2) SegmentOffset(1) UnusedBytes(1).
+	// encoded entries are xored with HEAP.Encoding, SmallTagIndex is the checksum of the first three bytes.
+	void PutEntry(uint64_t InAddress, uint32_t InBytes, uint8_t InFlags, const uint8_t *InEncoding)
+	{
+		const uint16_t Units = (uint16_t)(InBytes / Layout.Granularity);
+		uint8_t Header[8] = { (uint8_t)Units, (uint8_t)(Units >> 8), InFlags, 0, 0, 0, 0, 0 };
+		Header[3] = (uint8_t)(Header[0] ^ Header[1] ^ Header[2]);
+		if (InEncoding)
+		{
+			for (uint32_t k = 0; k < sizeof(Header); k++)
+			{
+				Header[k] ^= InEncoding[Layout.EntryHeader + k];
+			} // end for k
+		}
+		Put(InAddress + Layout.EntryHeader, Header, sizeof(Header));
+	}
+
+	// a heap and its first segment, which the HEAP starts with
+	void PutHeap(uint64_t InHeap, const uint8_t *InEncoding)
+	{
+		Put32(InHeap + Layout.HeapSignature, 0xEEFFEEFF);
+		Put32(InHeap + Layout.HeapEncodeFlagMask, InEncoding ? 0x100000 : 0);
+		if (InEncoding)
+		{
+			Put(InHeap + Layout.HeapEncoding, InEncoding, Layout.Granularity);
+		}
+	}
+
+	void PutSegment(uint64_t InSegment, uint64_t InFirstEntry, uint64_t InLastValidEntry, const std::vector<uint64_t> &InUCRs)
+	{
+		Put32(InSegment + Layout.SegmentSignature, 0xFFEEFFEE);
+		PutPointer(InSegment + Layout.SegmentFirstEntry, InFirstEntry);
+		PutPointer(InSegment + Layout.SegmentLastValidEntry, InLastValidEntry);
+		std::vector<uint64_t> Links;
+		for (size_t k = 0; k < InUCRs.size(); k++)
+		{
+			Links.push_back(InUCRs[k] + Layout.UCRSegmentEntry);
+		} // end for k
+		PutList(InSegment + Layout.SegmentUCRList, Links);
+	}
+
+	void PutUCR(uint64_t InDescriptor, uint64_t InAddress, uint64_t InSize)
+	{
+		PutPointer(InDescriptor + Layout.UCRAddress, InAddress);
+		PutPointer(InDescriptor + Layout.UCRSize, InSize);
+	}
+
+	bool Save(const char *InFilename) const
+	{
+		FILE *File = fopen(InFilename, "wb");
+		if (!File)
+		{
+			return false;
+		}
+		for (size_t k = 0; k < Regions.size(); k++)
+		{
+			const uint64_t Header[2] = { Regions[k].Address, (uint64_t)Regions[k].Bytes.size() };
+			fwrite(Header, sizeof(Header), 1, File);
+			fwrite(&Regions[k].Bytes[0], 1, Regions[k].Bytes.size(), File);
+		} // end for k
+		return fclose(File) == 0;
+	}
+
+	const FImageLayout	&Layout;
+
+private:
+	struct FRegion
+	{
+		uint64_t				Address;
+		std::vector<uint8_t>	Bytes;
+	};
+	std::vector<FRegion>	Regions;
+};
+
+static const uint8_t sEncoding[16] = { 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xF1, 0x02 };
+
+// busy, free, busy with a back trace index, LFH user blocks, free last entry, a hole, a last busy block.
+// a second segment, a virtual block, and an unencoded heap with a broken entry.
+static bool WriteX64()
+{
+	const FImageLayout &L = sLayoutX64;
+	FImageWriter Image(L);
+	const uint64_t Peb = 0x50000, HeapsArray = 0x51000;
+	const uint64_t HeapA = 0x1000000, SegmentA1 = 0x1100000, VirtualA = 0x2000000, HeapB = 0x3000000;
+
+	Image.AddRegion(Peb, 0x1000);
+	Image.AddRegion(HeapsArray, 0x1000);
+	Image.PutPointer(Peb + L.PebProcessHeap, HeapA);
+	Image.Put32(Peb + L.PebNumberOfHeaps, 2);
+	Image.PutPointer(Peb + L.PebProcessHeaps, HeapsArray);
+	Image.PutPointer(HeapsArray, HeapA);
+	Image.PutPointer(HeapsArray + 8, HeapB);
+
+	// heap A, segment 0: [0x2000, 0x8000) with [0x5000, 0x7000) not committed
+	Image.AddRegion(HeapA, 0x5000);
+	Image.AddRegion(HeapA + 0x7000, 0x1000);
+	Image.PutHeap(HeapA, sEncoding);
+	Image.PutSegment(HeapA, HeapA + 0x2000, HeapA + 0x8000, std::vector<uint64_t>(1, HeapA + 0x1800));
+	Image.PutUCR(HeapA + 0x1800, HeapA + 0x5000, 0x2000);
+	Image.PutEntry(HeapA + 0x2000, 0x40, 0x01, sEncoding);
+	Image.PutEntry(HeapA + 0x2040, 0x100, 0x00, sEncoding);
+	Image.PutEntry(HeapA + 0x2140, 0x80, 0x03, sEncoding);
+	Image.Put32(HeapA + 0x21B0, 0x1234);						// HEAP_ENTRY_EXTRA.AllocatorBackTraceIndex
+	Image.PutEntry(HeapA + 0x21C0, 0x400, 0x01, sEncoding);
+	Image.Put32(HeapA + 0x21D0 + L.UserDataSignature, 0xF0E0D0C0);
+	Image.PutPointer(HeapA + 0x21D0 + L.UserDataBusyBitmap, 20);	// RTL_BITMAP_EX.SizeOfBitMap
+	Image.PutPointer(HeapA + 0x21D0 + L.UserDataBusyBitmap + 8, HeapA + 0x2200);
+	const uint8_t Bits[3] = { 0xFF, 0x0F, 0xFA };					// 14 of the first 20 bits
+	Image.Put(HeapA + 0x2200, Bits, sizeof(Bits));
+	Image.PutEntry(HeapA + 0x25C0, 0x2A40, 0x10, sEncoding);
+	Image.PutEntry(HeapA + 0x7000, 0x1000, 0x11, sEncoding);
+
+	// heap A, segment 1: [0x100, 0x4000)
+	Image.AddRegion(SegmentA1, 0x4000);
+	Image.PutSegment(SegmentA1, SegmentA1 + 0x100, SegmentA1 + 0x4000, std::vector<uint64_t>());
+	Image.PutEntry(SegmentA1 + 0x100, 0x200, 0x01, sEncoding);
+	Image.PutEntry(SegmentA1 + 0x300, 0x3D00, 0x10, sEncoding);
+
+	std::vector<uint64_t> Segments;
+	Segments.push_back(HeapA + L.SegmentListEntry);
+	Segments.push_back(SegmentA1 + L.SegmentListEntry);
+	Image.PutList(HeapA + L.HeapSegmentList, Segments);
+
+	// heap A, a virtual block of 1 MB
+	Image.AddRegion(VirtualA, 0x100);
+	Image.PutList(HeapA + L.HeapVirtualAllocdBlocks, std::vector<uint64_t>(1, VirtualA));
+	Image.Put32(VirtualA + L.VirtualExtraStuff, 0x77);
+	Image.PutPointer(VirtualA + L.VirtualCommitSize, 0x100000);
+
+	// heap B: not encoded, the second entry has size 0
+	Image.AddRegion(HeapB, 0x2000);
+	Image.PutHeap(HeapB, NULL);
+	Image.PutSegment(HeapB, HeapB + 0x1000, HeapB + 0x2000, std::vector<uint64_t>());
+	Image.PutList(HeapB + L.HeapSegmentList, std::vector<uint64_t>(1, HeapB + L.SegmentListEntry));
+	Image.PutList(HeapB + L.HeapVirtualAllocdBlocks, std::vector<uint64_t>());
+	Image.PutEntry(HeapB + 0x1000, 0x100, 0x01, NULL);
+
+	return Image.Save("heap_x64.img");
+}
+
+// busy, free, LFH user blocks without a busy bitmap, free last entry, and a virtual block
+static bool WriteX86Win7()
+{
+	const FImageLayout &L = sLayoutX86Win7;
+	FImageWriter Image(L);
+	const uint64_t Peb = 0x7FFD0000, Heap = 0x300000, Virtual = 0x500000;
+
+	Image.AddRegion(Peb, 0x1000);
+	Image.PutPointer(Peb + L.PebProcessHeap, Heap);
+	Image.Put32(Peb + L.PebNumberOfHeaps, 1);
+	Image.PutPointer(Peb + L.PebProcessHeaps, Peb + 0x800);
+	Image.PutPointer(Peb + 0x800, Heap);
+
+	Image.AddRegion(Heap, 0x2000);
+	Image.PutHeap(Heap, sEncoding);
+	Image.PutSegment(Heap, Heap + 0x600, Heap + 0x2000, std::vector<uint64_t>());
+	Image.PutList(Heap + L.HeapSegmentList, std::vector<uint64_t>(1, Heap + L.SegmentListEntry));
+	Image.PutEntry(Heap + 0x600, 0x20, 0x01, sEncoding);
+	Image.PutEntry(Heap + 0x620, 0x100, 0x00, sEncoding);
+	Image.PutEntry(Heap + 0x720, 0x800, 0x01, sEncoding);
+	Image.Put32(Heap + 0x728 + L.UserDataSignature, 0xF0E0D0C0);
+	Image.PutEntry(Heap + 0xF20, 0x10E0, 0x10, sEncoding);
+
+	Image.AddRegion(Virtual, 0x100);
+	Image.PutList(Heap + L.HeapVirtualAllocdBlocks, std::vector<uint64_t>(1, Virtual));
+	Image.PutPointer(Virtual + L.VirtualCommitSize, 0x20000);
+
+	return Image.Save("heap_x86_win7.img");
+}
+
+int main()
+{
+	return WriteX64() && WriteX86Win7() ? 0 : 1;
+}
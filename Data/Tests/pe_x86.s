@@ -0,0 +1,34 @@
+# pe_x86.s
+#	a 32 bit image for Test_PeImage: named, ordinal only and forwarded exports, imports by name and by
+#	ordinal from two modules, and a CodeView record. make_fixtures.sh builds pe_x86.dll from it.
+
+	.intel_syntax noprefix
+	.text
+
+	.globl	_Add
+_Add:
+	mov	eax, dword ptr [esp + 4]
+	add	eax, dword ptr [esp + 8]
+	ret
+
+	.globl	_Twice
+_Twice:
+	mov	eax, dword ptr [esp + 4]
+	add	eax, eax
+	ret
+
+	.globl	_ByOrdinal
+_ByOrdinal:
+	xor	eax, eax
+	ret
+
+	.globl	_CallImports
+_CallImports:
+	call	dword ptr [__imp__GetTickCount@0]
+	push	eax
+	call	dword ptr [__imp__Sleep@4]
+	call	dword ptr [__imp__Ordinal7]
+	ret
+
+	.section .drectve,"yn"
+	.ascii	" -export:Add=_Add -export:Twice=_Twice -export:ByOrdinal=_ByOrdinal,@9,NONAME -export:CallImports=_CallImports -export:Tick=kernel32.GetTickCount"
@@ -0,0 +1,161 @@
+# unwind_x64.s
+#	functions with the prologs and epilogs x64 compilers emit, for Test_X64Unwinder and Test_PeImage.
+#	make_fixtures.sh builds unwind_x64.dll from it and captures the stack at each instruction of Entry.
+#	the code only computes, the import is never called.
+
+	.intel_syntax noprefix
+	.text
+
+# push, alloc small, a call through the home space
+	.globl	Entry
+	.def	Entry; .scl 2; .type 32; .endef
+	.seh_proc Entry
+Entry:
+	push	rbp
+	.seh_pushreg rbp
+	push	rbx
+	.seh_pushreg rbx
+	sub	rsp, 0x28
+	.seh_stackalloc 0x28
+	.seh_endprologue
+	mov	rbx, rcx
+	mov	rbp, 0x0B0B0B0B
+	call	FramePointer
+	add	rax, rbx
+	mov	rcx, rax
+	call	TailCaller
+	add	rsp, 0x28
+	pop	rbx
+	pop	rbp
+	ret
+	.seh_endproc
+
+# frame pointer with an offset, a dynamic allocation, the lea rsp epilog
+	.globl	FramePointer
+	.def	FramePointer; .scl 2; .type 32; .endef
+	.seh_proc FramePointer
+FramePointer:
+	push	rbp
+	.seh_pushreg rbp
+	push	r12
+	.seh_pushreg r12
+	sub	rsp, 0x28
+	.seh_stackalloc 0x28
+	lea	rbp, [rsp + 0x20]
+	.seh_setframe rbp, 0x20
+	.seh_endprologue
+	mov	r12, rcx
+	lea	rax, [rcx * 8 + 0x18]
+	and	rax, -16
+	sub	rsp, rax
+	mov	qword ptr [rsp + 0x20], r12
+	mov	rcx, r12
+	call	SaveNonvol
+	add	rax, r12
+	lea	rsp, [rbp + 0x8]
+	pop	r12
+	pop	rbp
+	ret
+	.seh_endproc
+
+# registers saved with mov into a large allocation, a shared epilog reached by a jump
+	.globl	SaveNonvol
+	.def	SaveNonvol; .scl 2; .type 32; .endef
+	.seh_proc SaveNonvol
+SaveNonvol:
+	sub	rsp, 0x1008
+	.seh_stackalloc 0x1008
+	mov	qword ptr [rsp + 0x1010], rsi
+	.seh_savereg rsi, 0x1010
+	mov	qword ptr [rsp + 0x1018], rdi
+	.seh_savereg rdi, 0x1018
+	.seh_endprologue
+	mov	rsi, rcx
+	mov	rdi, 0x0D1D1D1D
+	mov	rcx, rsi
+	call	Leaf
+	test	rax, 1
+	jnz	.LSaveNonvolOdd
+	add	rax, rdi
+	jmp	.LSaveNonvolDone
+.LSaveNonvolOdd:
+	sub	rax, rdi
+.LSaveNonvolDone:
+	mov	rsi, qword ptr [rsp + 0x1010]
+	mov	rdi, qword ptr [rsp + 0x1018]
+	add	rsp, 0x1008
+	ret
+	.seh_endproc
+
+# no unwind info
+	.globl	Leaf
+	.def	Leaf; .scl 2; .type 32; .endef
+Leaf:
+	lea	rax, [rcx + rcx * 2]
+	xor	rax, 0x55
+	ret
+
+# alloc only, leaves with a tail call
+	.globl	TailCaller
+	.def	TailCaller; .scl 2; .type 32; .endef
+	.seh_proc TailCaller
+TailCaller:
+	sub	rsp, 0x28
+	.seh_stackalloc 0x28
+	.seh_endprologue
+	add	rcx, 3
+	call	Leaf
+	mov	rcx, rax
+	add	rsp, 0x28
+	jmp	PushMany
+	.seh_endproc
+
+# the nonvolatile registers pushed, alloc large with a 32 bit size
+	.globl	PushMany
+	.def	PushMany; .scl 2; .type 32; .endef
+	.seh_proc PushMany
+PushMany:
+	push	r15
+	.seh_pushreg r15
+	push	r14
+	.seh_pushreg r14
+	push	r13
+	.seh_pushreg r13
+	push	rdi
+	.seh_pushreg rdi
+	push	rsi
+	.seh_pushreg rsi
+	sub	rsp, 0x80000
+	.seh_stackalloc 0x80000
+	.seh_endprologue
+	mov	r13, rcx
+	mov	r14, 0x0E0E0E0E
+	mov	r15, 0x0F0F0F0F
+	lea	rsi, [r13 + r14]
+	lea	rdi, [rsi + r15]
+	mov	rcx, rdi
+	call	Leaf
+	add	rsp, 0x80000
+	pop	rsi
+	pop	rdi
+	pop	r13
+	pop	r14
+	pop	r15
+	ret
+	.seh_endproc
+
+# an import for the parser tests, never called
+	.globl	CallImport
+	.def	CallImport; .scl 2; .type 32; .endef
+	.seh_proc CallImport
+CallImport:
+	sub	rsp, 0x28
+	.seh_stackalloc 0x28
+	.seh_endprologue
+	call	qword ptr [rip + __imp_GetTickCount]
+	add	rsp, 0x28
+	ret
+	.seh_endproc
+
+	.section .drectve,"yn"
+	.ascii	" -export:Entry -export:FramePointer -export:SaveNonvol -export:Leaf -export:TailCaller -export:PushMany -export:CallImport"
@@ -170,6 +170,25 @@ void appConsolePrintf(const TCHAR *InFormat, ...)
 	va_end(args);
 }
 
+void appConsoleWrite(const char *InText, size_t InLength)
+{
+	// keep the order with the buffered printf output.
+	fflush(stdout);
+
+	HANDLE OutputHandle = GetStdHandle(STD_OUTPUT_HANDLE);
+	while (InLength > 0)
+	{
+		DWORD Chunk = InLength > (1u << 20) ? (1u << 20) : (DWORD)InLength;
+		DWORD Written = 0;
+		if (!WriteFile(OutputHandle, InText, Chunk, &Written, NULL) || Written == 0)
+		{
+			break;
+		}
+		InText += Written;
+		InLength -= Written;
+	} // end while
+}
+
 TCHAR* appGetConsoleLine(TCHAR *OutLine, size_t SizeInCharacters)
 {
 	assert(OutLine);
@@ -76,6 +76,8 @@ COORD appGetConsoleCursorPosition();
 void appSetConsoleCursorPosition(const COORD &InPos);
 void appSetConsoleTextColor(const TCHAR *InColor);
 void appConsolePrintf(const TCHAR *InFormat, ...);
+// write a preformatted ANSI buffer in one call
+void appConsoleWrite(const char *InText, size_t InLength);
 TCHAR* appGetConsoleLine(TCHAR *OutLine, size_t SizeInCharacters);
 
 // parse cmdline
@@ -0,0 +1,148 @@
+// \brief
+//		read only memory mapped file.
+//
+
+#include "AppMappedFile.h"
+
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <cstdlib>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+
+#if defined(_WIN32)
+
+FMappedFile::FMappedFile()
+	: Data(NULL)
+	, Size(0)
+	, hFile(INVALID_HANDLE_VALUE)
+	, hMapping(NULL)
+{
+}
+
+bool FMappedFile::Open(const std::wstring &InFilename)
+{
+	Close();
+
+	hFile = ::CreateFileW(InFilename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (hFile == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER FileSize;
+	if (!::GetFileSizeEx(hFile, &FileSize) || FileSize.QuadPart == 0)
+	{
+		Close();
+		return false;
+	}
+
+	hMapping = ::CreateFileMapping(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!hMapping)
+	{
+		Close();
+		return false;
+	}
+
+	Data = (const uint8_t *)::MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+	if (!Data)
+	{
+		Close();
+		return false;
+	}
+
+	Size = (uint64_t)FileSize.QuadPart;
+	return true;
+}
+
+void FMappedFile::Close()
+{
+	if (Data)
+	{
+		::UnmapViewOfFile(Data);
+		Data = NULL;
+	}
+	if (hMapping)
+	{
+		::CloseHandle(hMapping);
+		hMapping = NULL;
+	}
+	if (hFile != INVALID_HANDLE_VALUE)
+	{
+		::CloseHandle(hFile);
+		hFile = INVALID_HANDLE_VALUE;
+	}
+	Size = 0;
+}
+
+#else
+
+FMappedFile::FMappedFile()
+	: Data(NULL)
+	, Size(0)
+	, FileDesc(-1)
+{
+}
+
+bool FMappedFile::Open(const std::wstring &InFilename)
+{
+	Close();
+
+	std::vector<char> Filename(InFilename.size() * 4 + 1);
+	if (wcstombs(&Filename[0], InFilename.c_str(), Filename.size()) == (size_t)-1)
+	{
+		return false;
+	}
+
+	FileDesc = ::open(&Filename[0], O_RDONLY);
+	if (FileDesc < 0)
+	{
+		return false;
+	}
+
+	struct stat FileStat;
+	if (::fstat(FileDesc, &FileStat) != 0 || FileStat.st_size == 0)
+	{
+		Close();
+		return false;
+	}
+
+	void *Mapping = ::mmap(NULL, (size_t)FileStat.st_size, PROT_READ, MAP_SHARED, FileDesc, 0);
+	if (Mapping == MAP_FAILED)
+	{
+		Close();
+		return false;
+	}
+
+	Data = (const uint8_t *)Mapping;
+	Size = (uint64_t)FileStat.st_size;
+	return true;
+}
+
+void FMappedFile::Close()
+{
+	if (Data)
+	{
+		::munmap((void *)Data, (size_t)Size);
+		Data = NULL;
+	}
+	if (FileDesc >= 0)
+	{
+		::close(FileDesc);
+		FileDesc = -1;
+	}
+	Size = 0;
+}
+
+#endif
+
+FMappedFile::~FMappedFile()
+{
+	Close();
+}
@@ -0,0 +1,38 @@
+// \brief
+//		read only memory mapped file.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+
+class FMappedFile
+{
+public:
+	FMappedFile();
+	~FMappedFile();
+
+	bool Open(const std::wstring &InFilename);
+	void Close();
+
+	bool IsOpen() const { return Data != NULL; }
+	const uint8_t* GetData() const { return Data; }
+	uint64_t GetSize() const { return Size; }
+
+private:
+	FMappedFile(const FMappedFile&);
+	FMappedFile& operator=(const FMappedFile&);
+
+	const uint8_t	*Data;
+	uint64_t		Size;
+
+#if defined(_WIN32)
+	void			*hFile;
+	void			*hMapping;
+#else
+	int				FileDesc;
+#endif
+};
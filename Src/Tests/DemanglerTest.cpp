@@ -0,0 +1,225 @@
+// \brief
+//		FMsvcDemangler over the name corpus of Data/Tests, portable. demangle_corpus.txt holds the
+//		publics of the test PDBs and hand written edge cases with what undname prints for them. the
+//		memo must return the same result for a name seen before without parsing it again, names alone
+//		are memoized apart from full ones, and truncated or mutated names must be rejected or printed
+//		without reading past their end. then the time per name, cold and memoized, is printed.
+//
+// cmd> Test_Demangler [fixture dir]
+//
+
+#include "WinDebugger/WinDemangler.h"
+#include "TestHelper.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+
+namespace NSDemanglerTest
+{
+	const uint32_t kBenchmarkRounds = 200;
+}
+
+struct FCorpusName
+{
+	std::string		Mangled;
+	std::string		Demangled;		// empty if the name must be rejected
+};
+
+static bool LoadCorpus(const std::string &InFilename, std::vector<FCorpusName> &OutNames)
+{
+	FILE *File = fopen(InFilename.c_str(), "rb");
+	if (!File)
+	{
+		return false;
+	}
+	char Line[4096];
+	while (fgets(Line, sizeof(Line), File))
+	{
+		Line[strcspn(Line, "\r\n")] = 0;
+		const char *Tab = strchr(Line, '\t');
+		if (Line[0] == '#' || !Tab)
+		{
+			continue;
+		}
+		FCorpusName Name;
+		Name.Mangled.assign(Line, Tab - Line);
+		Name.Demangled = Tab + 1;
+		OutNames.push_back(Name);
+	}
+	fclose(File);
+	return !OutNames.empty();
+}
+
+static bool IsExpected(const char *InResult, const FCorpusName &InName)
+{
+	return InName.Demangled.empty() ? InResult == NULL : (InResult && InName.Demangled == InResult);
+}
+
+static void TestCorpus(const std::vector<FCorpusName> &InNames)
+{
+	FMsvcDemangler Demangler;
+	std::vector<const char*> Results(InNames.size());
+	uint32_t Mismatches = 0;
+	for (size_t k = 0; k < InNames.size(); k++)
+	{
+		Results[k] = Demangler.Demangle(InNames[k].Mangled.c_str());
+		if (!IsExpected(Results[k], InNames[k]))
+		{
+			printf("  %s\n    %s\n", InNames[k].Mangled.c_str(), Results[k] ? Results[k] : "(rejected)");
+			Mismatches++;
+		}
+	} // end for k
+	TEST_CHECK(Mismatches == 0);
+	TEST_CHECK(Demangler.GetMissCount() == InNames.size() && Demangler.GetHitCount() == 0);
+
+	// the second time every name, rejected ones too, comes from the memo
+	const size_t MemoryUsage = Demangler.GetMemoryUsage();
+	Mismatches = 0;
+	for (size_t k = 0; k < InNames.size(); k++)
+	{
+		const std::string Copy(InNames[k].Mangled);
+		if (Demangler.Demangle(Copy.c_str()) != Results[k])
+		{
+			Mismatches++;
+		}
+	} // end for k
+	TEST_CHECK(Mismatches == 0);
+	TEST_CHECK(Demangler.GetMissCount() == InNames.size() && Demangler.GetHitCount() == InNames.size());
+	TEST_CHECK(Demangler.GetMemoryUsage() == MemoryUsage);
+
+	// after Clear() the names are demangled again
+	Demangler.Clear();
+	Mismatches = 0;
+	for (size_t k = 0; k < InNames.size(); k++)
+	{
+		if (!IsExpected(Demangler.Demangle(InNames[k].Mangled.c_str()), InNames[k]))
+		{
+			Mismatches++;
+		}
+	} // end for k
+	TEST_CHECK(Mismatches == 0);
+	TEST_CHECK(Demangler.GetMissCount() == InNames.size() * 2);
+}
+
+// UNDNAME_NAME_ONLY
+static void TestNameOnly()
+{
+	FMsvcDemangler Demangler;
+	const char *Names[][3] =
+	{
+		{ "??$?0H@Foo@@QAE@H@Z", "Foo::Foo<int>", "public: __thiscall Foo::Foo<int>(int)" },
+		{ "?f@@YAXPAPAH@Z", "f", "void __cdecl f(int **)" },
+		{ "??_7Foo@@6B@", "Foo::`vftable'", "const Foo::`vftable'" },
+		{ "??1GilHolder@@QAE@XZ", "GilHolder::~GilHolder", "public: __thiscall GilHolder::~GilHolder(void)" },
+		{ "??$_Deallocate@$07@std@@YAXPAXI@Z", "std::_Deallocate<8>", "void __cdecl std::_Deallocate<8>(void *, unsigned int)" },
+	};
+	for (size_t k = 0; k < sizeof(Names) / sizeof(Names[0]); k++)
+	{
+		const char *NameOnly = Demangler.Demangle(Names[k][0], true);
+		const char *Full = Demangler.Demangle(Names[k][0]);
+		if (!TEST_CHECK(NameOnly && Full && !strcmp(NameOnly, Names[k][1]) && !strcmp(Full, Names[k][2])))
+		{
+			printf("  %s\n    %s\n    %s\n", Names[k][0], NameOnly ? NameOnly : "(rejected)", Full ? Full : "(rejected)");
+		}
+		TEST_CHECK(Demangler.Demangle(Names[k][0], true) == NameOnly && Demangler.Demangle(Names[k][0]) == Full);
+	} // end for k
+
+	// not decorated
+	TEST_CHECK(!Demangler.Demangle(NULL) && !Demangler.Demangle("") && !Demangler.Demangle("main") && !Demangler.Demangle("_GetTickCount@0"));
+}
+
+// every prefix and every single byte mutation of the corpus names. a name is rejected or printed, each
+// one in its own buffer so that a read past the end shows under ASan.
+static void TestMalformed(const std::vector<FCorpusName> &InNames)
+{
+	FMsvcDemangler Demangler;
+	const char Mutations[] = { '@', '?', '$', '0', 'A', 'P', 'Y', 'Z', '_' };
+	uint32_t Printed = 0, Rejected = 0;
+	for (size_t k = 0; k < InNames.size(); k++)
+	{
+		const std::string &Mangled = InNames[k].Mangled;
+		for (size_t Length = 1; Length < Mangled.size(); Length++)
+		{
+			std::vector<char> Prefix(Mangled.begin(), Mangled.begin() + Length);
+			Prefix.push_back(0);
+			(Demangler.Demangle(&Prefix[0]) ? Printed : Rejected)++;
+		} // end for Length
+		for (size_t Offset = 1; Offset < Mangled.size(); Offset += 3)
+		{
+			std::string Mutated(Mangled);
+			Mutated[Offset] = Mutations[(k + Offset) % sizeof(Mutations)];
+			(Demangler.Demangle(Mutated.c_str()) ? Printed : Rejected)++;
+		} // end for Offset
+		// keep the memo small, the failures are not looked up again
+		if (k % 64 == 0)
+		{
+			Demangler.Clear();
+		}
+	} // end for k
+	printf("malformed: %u printed, %u rejected\n", Printed, Rejected);
+	TEST_CHECK(Rejected > Printed);
+
+	// the memo still returns the right results after all the failures
+	uint32_t Mismatches = 0;
+	for (size_t k = 0; k < InNames.size(); k++)
+	{
+		if (!IsExpected(Demangler.Demangle(InNames[k].Mangled.c_str()), InNames[k]))
+		{
+			Mismatches++;
+		}
+	} // end for k
+	TEST_CHECK(Mismatches == 0);
+}
+
+static void Benchmark(const std::vector<FCorpusName> &InNames)
+{
+	using namespace NSDemanglerTest;
+
+	FMsvcDemangler Demangler;
+	size_t Bytes = 0;
+	FTestTimer ColdTimer;
+	for (uint32_t r = 0; r < kBenchmarkRounds; r++)
+	{
+		Demangler.Clear();
+		for (size_t k = 0; k < InNames.size(); k++)
+		{
+			const char *Result = Demangler.Demangle(InNames[k].Mangled.c_str());
+			Bytes += Result ? strlen(Result) : 0;
+		} // end for k
+	} // end for r
+	const double ColdSeconds = ColdTimer.Seconds();
+
+	FTestTimer MemoTimer;
+	for (uint32_t r = 0; r < kBenchmarkRounds; r++)
+	{
+		for (size_t k = 0; k < InNames.size(); k++)
+		{
+			const char *Result = Demangler.Demangle(InNames[k].Mangled.c_str());
+			Bytes -= Result ? strlen(Result) : 0;
+		} // end for k
+	} // end for r
+	const double MemoSeconds = MemoTimer.Seconds();
+
+	const double Count = (double)InNames.size() * kBenchmarkRounds;
+	printf("%u names x %u: %.2f us per name cold, %.2f us memoized, %u KB\n", (uint32_t)InNames.size(), kBenchmarkRounds,
+		ColdSeconds / Count * 1e6, MemoSeconds / Count * 1e6, (uint32_t)(Demangler.GetMemoryUsage() / 1024));
+	TEST_CHECK(Bytes == 0);
+	TEST_CHECK(Demangler.GetHitCount() == InNames.size() * kBenchmarkRounds);
+}
+
+int main(int argc, char *argv[])
+{
+	const std::string DataDir = appTestDataDir(argc, argv);
+	std::vector<FCorpusName> Names;
+	if (TEST_CHECK(LoadCorpus(DataDir + "demangle_corpus.txt", Names)))
+	{
+		TestCorpus(Names);
+		TestNameOnly();
+		TestMalformed(Names);
+		Benchmark(Names);
+	}
+	return appTestResult("Test_Demangler");
+}
@@ -0,0 +1,157 @@
+// \brief
+//		FNtHeapWalker over the captured heap images of Data/Tests, portable. make_heap_images.cpp
+//		writes them:
+//		heap_x64.img, Windows 8+ layout: the PEB lists heap A, the default one, and heap B.
+//			heap A is encoded. segment 0 has a busy block, a free one, a busy one with the back trace
+//			index 0x1234, LFH user blocks with 14 busy blocks, a free last entry, an uncommitted range
+//			and a busy last entry. segment 1 has a busy and a free block. a virtual block of 1 MB has
+//			the back trace index 0x77. heap B is not encoded, its second entry is broken.
+//		heap_x86_win7.img, Windows 7 layout: one encoded heap with a busy block, a free one, LFH user
+//			blocks without a busy bitmap, a free last entry and a virtual block of 128 KB.
+//
+// cmd> Test_HeapWalker [fixture dir]
+//
+
+#include "WinDebugger/WinHeapWalker.h"
+#include "TestHelper.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+
+class FBlockList : public FHeapBlockVisitor
+{
+public:
+	virtual void VisitBlock(const FHeapBlock &InBlock) override
+	{
+		Blocks.push_back(InBlock);
+	}
+
+	std::vector<FHeapBlock>	Blocks;
+};
+
+struct FExpectedBlock
+{
+	uint64_t	Address;
+	uint64_t	Size;
+	uint32_t	Flags;
+	uint32_t	Segment;
+	uint32_t	BackTraceIndex;
+	uint32_t	LfhBusyBlocks;
+};
+
+static void CheckBlocks(const std::vector<FHeapBlock> &InBlocks, const FExpectedBlock *InExpected, size_t InCount)
+{
+	if (!TEST_CHECK(InBlocks.size() == InCount))
+	{
+		return;
+	}
+	for (size_t k = 0; k < InCount; k++)
+	{
+		const FHeapBlock &Block = InBlocks[k];
+		const FExpectedBlock &Expected = InExpected[k];
+		if (!TEST_CHECK(Block.Address == Expected.Address && Block.Size == Expected.Size && Block.Flags == Expected.Flags
+			&& Block.Segment == Expected.Segment && Block.BackTraceIndex == Expected.BackTraceIndex && Block.LfhBusyBlocks == Expected.LfhBusyBlocks))
+		{
+			printf("  block %u: %llx %llx %x\n", (uint32_t)k, (unsigned long long)Block.Address, (unsigned long long)Block.Size, Block.Flags);
+		}
+	} // end for k
+}
+
+static void TestX64(const std::string &InDataDir)
+{
+	FCapturedMemory Memory;
+	if (!TEST_CHECK(Memory.LoadFromFile((InDataDir + "heap_x64.img").c_str())))
+	{
+		return;
+	}
+
+	const uint64_t HeapA = 0x1000000, HeapB = 0x3000000;
+	FNtHeapWalker Walker(Memory, FNtHeapLayout::GetLayout(true));
+	std::vector<uint64_t> Heaps;
+	TEST_CHECK(Walker.GetProcessHeaps(0x50000, Heaps));
+	TEST_CHECK(Heaps.size() == 2 && Heaps[0] == HeapA && Heaps[1] == HeapB);
+	TEST_CHECK(FNtHeapLayout::FindHeapLayout(Memory, HeapA, true) == &FNtHeapLayout::GetLayout(true));
+
+	FHeapStatistics Stats;
+	FBlockList List;
+	TEST_CHECK(Walker.WalkHeap(HeapA, Stats, &List));
+	TEST_CHECK(Stats.HeapAddress == HeapA && Stats.SegmentCount == 2 && Stats.bEncoded && Stats.CorruptEntries == 0);
+	TEST_CHECK(Stats.BusyBlocks == 5 && Stats.BusyBytes == 0x40 + 0x80 + 0x400 + 0x1000 + 0x200);
+	TEST_CHECK(Stats.FreeBlocks == 3 && Stats.FreeBytes == 0x100 + 0x2A40 + 0x3D00 && Stats.LargestFreeBlock == 0x3D00);
+	TEST_CHECK(Stats.VirtualBlocks == 1 && Stats.VirtualBytes == 0x100000);
+	TEST_CHECK(Stats.SizeClassBlocks[6] == 1 && Stats.SizeClassBlocks[7] == 1 && Stats.SizeClassBlocks[9] == 1 && Stats.SizeClassBlocks[10] == 1
+		&& Stats.SizeClassBlocks[12] == 1 && Stats.SizeClassBlocks[20] == 1 && Stats.SizeClassBytes[20] == 0x100000);
+
+	const FExpectedBlock ExpectedA[] =
+	{
+		{ HeapA + 0x2000, 0x40, kHeapEntry_Busy, 0, 0, 0 },
+		{ HeapA + 0x2040, 0x100, 0, 0, 0, 0 },
+		{ HeapA + 0x2140, 0x80, kHeapEntry_Busy | kHeapEntry_ExtraPresent, 0, 0x1234, 0 },
+		{ HeapA + 0x21C0, 0x400, kHeapEntry_Busy | kHeapEntry_LfhUserBlocks, 0, 0, 14 },
+		{ HeapA + 0x25C0, 0x2A40, kHeapEntry_LastEntry, 0, 0, 0 },
+		{ HeapA + 0x7000, 0x1000, kHeapEntry_Busy | kHeapEntry_LastEntry, 0, 0, 0 },
+		{ 0x1100100, 0x200, kHeapEntry_Busy, 1, 0, 0 },
+		{ 0x1100300, 0x3D00, kHeapEntry_LastEntry, 1, 0, 0 },
+		{ 0x2000030, 0x100000, kHeapEntry_Busy | kHeapEntry_VirtualAlloc, (uint32_t)-1, 0x77, 0 },
+	};
+	CheckBlocks(List.Blocks, ExpectedA, sizeof(ExpectedA) / sizeof(ExpectedA[0]));
+
+	// the statistics do not depend on the visitor
+	FHeapStatistics Quick;
+	TEST_CHECK(Walker.WalkHeap(HeapA, Quick) && Quick.BusyBytes == Stats.BusyBytes && Quick.FreeBytes == Stats.FreeBytes && Quick.VirtualBytes == Stats.VirtualBytes);
+
+	// the walk of heap B stops at the broken entry
+	FBlockList ListB;
+	TEST_CHECK(Walker.WalkHeap(HeapB, Stats, &ListB));
+	TEST_CHECK(Stats.SegmentCount == 1 && !Stats.bEncoded && Stats.CorruptEntries == 1 && Stats.BusyBlocks == 1 && Stats.FreeBlocks == 0 && Stats.VirtualBlocks == 0);
+	const FExpectedBlock ExpectedB[] = { { HeapB + 0x1000, 0x100, kHeapEntry_Busy, 0, 0, 0 } };
+	CheckBlocks(ListB.Blocks, ExpectedB, 1);
+
+	// not a heap
+	TEST_CHECK(!Walker.WalkHeap(0x50000, Stats));
+}
+
+static void TestX86Win7(const std::string &InDataDir)
+{
+	FCapturedMemory Memory;
+	if (!TEST_CHECK(Memory.LoadFromFile((InDataDir + "heap_x86_win7.img").c_str())))
+	{
+		return;
+	}
+
+	const uint64_t Heap = 0x300000;
+	FNtHeapWalker Walker(Memory, FNtHeapLayout::GetLayout(false));
+	std::vector<uint64_t> Heaps;
+	TEST_CHECK(Walker.GetProcessHeaps(0x7FFD0000, Heaps) && Heaps.size() == 1 && Heaps[0] == Heap);
+
+	// the signature is one pointer further than on Windows 8
+	const FNtHeapLayout *pLayout = FNtHeapLayout::FindHeapLayout(Memory, Heap, false);
+	TEST_CHECK(pLayout && pLayout != &FNtHeapLayout::GetLayout(false) && pLayout->UserDataBusyBitmap == 0);
+
+	FHeapStatistics Stats;
+	FBlockList List;
+	TEST_CHECK(Walker.WalkHeap(Heap, Stats, &List));
+	TEST_CHECK(Stats.SegmentCount == 1 && Stats.bEncoded && Stats.CorruptEntries == 0);
+	TEST_CHECK(Stats.BusyBlocks == 2 && Stats.BusyBytes == 0x820 && Stats.FreeBlocks == 2 && Stats.FreeBytes == 0x11E0 && Stats.LargestFreeBlock == 0x10E0);
+	TEST_CHECK(Stats.VirtualBlocks == 1 && Stats.VirtualBytes == 0x20000);
+
+	const FExpectedBlock Expected[] =
+	{
+		{ Heap + 0x600, 0x20, kHeapEntry_Busy, 0, 0, 0 },
+		{ Heap + 0x620, 0x100, 0, 0, 0, 0 },
+		{ Heap + 0x720, 0x800, kHeapEntry_Busy | kHeapEntry_LfhUserBlocks, 0, 0, 0 },
+		{ Heap + 0xF20, 0x10E0, kHeapEntry_LastEntry, 0, 0, 0 },
+		{ 0x500018, 0x20000, kHeapEntry_Busy | kHeapEntry_VirtualAlloc, (uint32_t)-1, 0, 0 },
+	};
+	CheckBlocks(List.Blocks, Expected, sizeof(Expected) / sizeof(Expected[0]));
+}
+
+int main(int argc, char *argv[])
+{
+	const std::string DataDir = appTestDataDir(argc, argv);
+	TestX64(DataDir);
+	TestX86Win7(DataDir);
+	return appTestResult("Test_HeapWalker");
+}
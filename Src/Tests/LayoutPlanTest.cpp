@@ -0,0 +1,448 @@
+// \brief
+//		the flattened layout plans of FSymComplexType over types served by FTestTypeSource. a plan must
+//		format a value to the same text as member by member virtual FormatValue() calls, the budget
+//		included, with the first declared of equal enumerators. its leaves are the scalars of the value,
+//		pointers of 4 and 8 bytes as they are, so the hash does not see the padding and a diff names the
+//		members that changed. then format, hash and diff of a large struct are timed against the member
+//		by member walk.
+//
+// cmd> Test_LayoutPlan
+//
+
+#include "WinDebugger/WinVariableTypeHelper.h"
+#include "TestTypeSource.h"
+#include "TestHelper.h"
+
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+
+namespace NSLayoutPlanTest
+{
+	const uint64_t kModuleBase      = 0x10000000;
+	const uint32_t kBigPairs        = 64;
+	const uint32_t kBigLength       = 8 + kBigPairs * 24 + 8;	// the last 8 bytes are padding
+	const uint32_t kBenchmarkRounds = 2000;
+}
+
+struct FTestModule
+{
+	FTestTypeSource		Source;
+	uint32_t			InnerId;
+	uint32_t			PairId;
+	uint32_t			NarrowId;
+	uint32_t			BigId;
+};
+
+// the member names of every UDT by type name, in declaration order, for the member by member walk
+static std::map<std::wstring, std::vector<uint32_t> > GMemberNames;
+
+static void AddMember(FTestModule &OutModule, uint32_t InUdtId, const std::wstring &InUdtName, const std::wstring &InName, uint32_t InTypeId, uint32_t InOffset)
+{
+	OutModule.Source.AddMember(InUdtId, InName, InTypeId, InOffset);
+	GMemberNames[InUdtName].push_back(FSymTypeInfoHelper::GetNamePool().Intern(InName.c_str()));
+}
+
+// FInner { short A; int B; EColor Color; UINT Flags; }, two bytes of padding after A
+// FPair { FInner Inner; FInner *pSelf; }, 8 byte pointer
+// FNarrow { int Id; FInner *pInner; }, 4 byte pointer
+// FBig { FNarrow Header; FPair Pair0 .. Pair63; }, 8 bytes of padding at the end
+static void BuildModule(FTestModule &OutModule)
+{
+	using namespace NSLayoutPlanTest;
+
+	FTestTypeSource &Source = OutModule.Source;
+	GMemberNames.clear();
+	const uint32_t ShortId = Source.AddBaseType(btInt, 2);
+	const uint32_t IntId = Source.AddBaseType(btInt, 4);
+	const uint32_t UintId = Source.AddTypedef(L"UINT", Source.AddBaseType(btUInt, 4));
+
+	// Crimson and Red are equal, Red is declared first
+	const uint32_t ColorId = Source.AddEnum(L"EColor", btInt, 4);
+	Source.AddEnumerator(ColorId, L"Red", 1);
+	Source.AddEnumerator(ColorId, L"Green", 2);
+	Source.AddEnumerator(ColorId, L"Crimson", 1);
+	Source.AddEnumerator(ColorId, L"Blue", 4);
+	Source.AddEnumerator(ColorId, L"None", 0);
+
+	OutModule.InnerId = Source.AddUdt(L"FInner", 16);
+	AddMember(OutModule, OutModule.InnerId, L"FInner", L"A", ShortId, 0);
+	AddMember(OutModule, OutModule.InnerId, L"FInner", L"B", IntId, 4);
+	AddMember(OutModule, OutModule.InnerId, L"FInner", L"Color", ColorId, 8);
+	AddMember(OutModule, OutModule.InnerId, L"FInner", L"Flags", UintId, 12);
+
+	OutModule.PairId = Source.AddUdt(L"FPair", 24);
+	AddMember(OutModule, OutModule.PairId, L"FPair", L"Inner", OutModule.InnerId, 0);
+	AddMember(OutModule, OutModule.PairId, L"FPair", L"pSelf", Source.AddPointer(OutModule.InnerId, 8), 16);
+
+	OutModule.NarrowId = Source.AddUdt(L"FNarrow", 8);
+	AddMember(OutModule, OutModule.NarrowId, L"FNarrow", L"Id", IntId, 0);
+	AddMember(OutModule, OutModule.NarrowId, L"FNarrow", L"pInner", Source.AddPointer(OutModule.InnerId, 4), 4);
+
+	OutModule.BigId = Source.AddUdt(L"FBig", kBigLength);
+	AddMember(OutModule, OutModule.BigId, L"FBig", L"Header", OutModule.NarrowId, 0);
+	for (uint32_t k = 0; k < kBigPairs; k++)
+	{
+		AddMember(OutModule, OutModule.BigId, L"FBig", L"Pair" + std::to_wstring(k), OutModule.PairId, 8 + k * 24);
+	} // end for k
+}
+
+static FSymTypeInfo* BuildType(uint32_t InTypeId)
+{
+	return FSymTypeInfoHelper::BuildSymTypeInfo(NULL, FSymTypeInfoHelper::GetTypeSourceKey(NSLayoutPlanTest::kModuleBase), InTypeId);
+}
+
+static void WriteInner(uint8_t *OutValue, int16_t InA, int32_t InB, int32_t InColor, uint32_t InFlags)
+{
+	memcpy(OutValue, &InA, 2);
+	memcpy(OutValue + 4, &InB, 4);
+	memcpy(OutValue + 8, &InColor, 4);
+	memcpy(OutValue + 12, &InFlags, 4);
+}
+
+// a FBig with every member set, padding 0xCD
+static std::vector<uint8_t> MakeBigValue()
+{
+	using namespace NSLayoutPlanTest;
+
+	std::vector<uint8_t> Value(kBigLength, 0xCD);
+	const int32_t Id = 5;
+	const uint32_t pInner = 0x89ABCDEF;
+	memcpy(&Value[0], &Id, 4);
+	memcpy(&Value[4], &pInner, 4);
+	for (uint32_t k = 0; k < kBigPairs; k++)
+	{
+		uint8_t *pPair = &Value[8 + k * 24];
+		WriteInner(pPair, (int16_t)(k * 100 - 3000), (int32_t)(k * 70001), (int32_t)(k % 6), k * 3);
+		const uint64_t pSelf = 0xFEDCBA9800000000ull + k * 24;
+		memcpy(pPair + 16, &pSelf, 8);
+	} // end for k
+	return Value;
+}
+
+static std::wstring FormatPlan(const FSymTypeInfo *InType, const void *InValue, FSymExpandBudget &InOutBudget)
+{
+	FFormatBuffer Text;
+	InType->GetLayoutPlan()->FormatValue(InValue, InOutBudget, Text);
+	return Text.GetText();
+}
+
+// what FSymComplexType did before the plans, per member a lookup, a type name and a virtual call. the
+// typedefs are looked through, their GetLength() is 0
+static void FormatMembers(const FSymTypeInfo *InType, const uint8_t *InValue, FSymExpandBudget &InOutBudget, FFormatBuffer &OutText)
+{
+	const FStringPool &NamePool = FSymTypeInfoHelper::GetNamePool();
+	const std::vector<uint32_t> &Names = GMemberNames[InType->TypeName()];
+	OutText.Append(TEXT("{ "));
+	for (size_t k = 0; k < Names.size(); k++)
+	{
+		uint32_t Offset = 0;
+		const FSymTypeInfo *pDeclared = InType->FindMember(Names[k], Offset);
+		const FSymTypeInfo *pMember = pDeclared->GetRealType();
+		OutText.Append(NamePool.GetString(Names[k]));
+		OutText.Append(TEXT('('));
+		OutText.Append(pDeclared->TypeName());
+		OutText.Append(TEXT("): "));
+		if (pMember->GetKind() == stkComplex)
+		{
+			FormatMembers(pMember, InValue + Offset, InOutBudget, OutText);
+		}
+		else
+		{
+			pMember->FormatValue((void*)(InValue + Offset), InOutBudget, OutText);
+		}
+		OutText.Append(TEXT(", "));
+	} // end for k
+	OutText.Append(TEXT(" }"));
+}
+
+// FNV-1a of the scalar members in declaration order, the plans hash the same bytes
+static uint64_t HashMembers(const FSymTypeInfo *InType, const uint8_t *InValue, uint64_t InHash)
+{
+	const std::vector<uint32_t> &Names = GMemberNames[InType->TypeName()];
+	for (size_t k = 0; k < Names.size(); k++)
+	{
+		uint32_t Offset = 0;
+		const FSymTypeInfo *pMember = InType->FindMember(Names[k], Offset)->GetRealType();
+		if (pMember->GetKind() == stkComplex)
+		{
+			InHash = HashMembers(pMember, InValue + Offset, InHash);
+			continue;
+		}
+		for (uint32_t i = 0; i < pMember->GetLength(); i++)
+		{
+			InHash = (InHash ^ InValue[Offset + i]) * 1099511628211ull;
+		} // end for i
+	} // end for k
+	return InHash;
+}
+
+static void DiffMembers(const FSymTypeInfo *InType, const uint8_t *InOld, const uint8_t *InNew, const std::wstring &InPath, std::vector<std::wstring> &OutPaths)
+{
+	const FStringPool &NamePool = FSymTypeInfoHelper::GetNamePool();
+	const std::vector<uint32_t> &Names = GMemberNames[InType->TypeName()];
+	for (size_t k = 0; k < Names.size(); k++)
+	{
+		uint32_t Offset = 0;
+		const FSymTypeInfo *pMember = InType->FindMember(Names[k], Offset)->GetRealType();
+		if (pMember->GetKind() != stkComplex && memcmp(InOld + Offset, InNew + Offset, pMember->GetLength()) == 0)
+		{
+			continue;
+		}
+		const std::wstring Path = InPath.empty() ? NamePool.GetString(Names[k]) : InPath + L"." + NamePool.GetString(Names[k]);
+		if (pMember->GetKind() == stkComplex)
+		{
+			DiffMembers(pMember, InOld + Offset, InNew + Offset, Path, OutPaths);
+			continue;
+		}
+		OutPaths.push_back(Path);
+	} // end for k
+}
+
+static std::vector<std::wstring> DiffPlan(const FSymTypeInfo *InType, const void *InOld, const void *InNew)
+{
+	const FSymLayoutPlan *pPlan = InType->GetLayoutPlan();
+	std::vector<uint32_t> Leaves;
+	pPlan->Diff(InOld, InNew, Leaves);
+	std::vector<std::wstring> Paths;
+	for (size_t k = 0; k < Leaves.size(); k++)
+	{
+		Paths.push_back(pPlan->GetLeafPath(Leaves[k]));
+	} // end for k
+	return Paths;
+}
+
+static bool IsLeaf(const FSymLayoutPlan::FLeaf &InLeaf, uint32_t InOffset, uint32_t InLength, CPrimitiveTypeEnum InPrimitiveType)
+{
+	return InLeaf.Offset == InOffset && InLeaf.Length == InLength && InLeaf.PrimitiveType == InPrimitiveType;
+}
+
+static void TestLeaves(const FTestModule &InModule)
+{
+	using namespace NSLayoutPlanTest;
+
+	// FPair, the enum as its storage type, the pointer as 8 bytes
+	const FSymLayoutPlan *pPair = BuildType(InModule.PairId)->GetLayoutPlan();
+	const std::vector<FSymLayoutPlan::FLeaf> &PairLeaves = pPair->GetLeaves();
+	TEST_CHECK(PairLeaves.size() == 5);
+	if (PairLeaves.size() == 5)
+	{
+		TEST_CHECK(IsLeaf(PairLeaves[0], 0, 2, cbtShort) && IsLeaf(PairLeaves[1], 4, 4, cbtInt) && IsLeaf(PairLeaves[2], 8, 4, cbtInt));
+		TEST_CHECK(IsLeaf(PairLeaves[3], 12, 4, cbtUInt) && IsLeaf(PairLeaves[4], 16, 8, cbtNone));
+		TEST_CHECK(pPair->GetLeafPath(0) == L"Inner.A" && pPair->GetLeafPath(2) == L"Inner.Color" && pPair->GetLeafPath(4) == L"pSelf");
+	}
+
+	// FNarrow, a 4 byte pointer of a 32-bit module
+	const FSymLayoutPlan *pNarrow = BuildType(InModule.NarrowId)->GetLayoutPlan();
+	const std::vector<FSymLayoutPlan::FLeaf> &NarrowLeaves = pNarrow->GetLeaves();
+	TEST_CHECK(NarrowLeaves.size() == 2 && IsLeaf(NarrowLeaves[0], 0, 4, cbtInt) && IsLeaf(NarrowLeaves[1], 4, 4, cbtNone));
+
+	// FBig, the nested members at their offsets in the outer value
+	const FSymLayoutPlan *pBig = BuildType(InModule.BigId)->GetLayoutPlan();
+	const std::vector<FSymLayoutPlan::FLeaf> &BigLeaves = pBig->GetLeaves();
+	TEST_CHECK(BigLeaves.size() == 2 + kBigPairs * 5);
+	if (BigLeaves.size() == 2 + kBigPairs * 5)
+	{
+		TEST_CHECK(IsLeaf(BigLeaves[1], 4, 4, cbtNone) && pBig->GetLeafPath(1) == L"Header.pInner");
+		TEST_CHECK(IsLeaf(BigLeaves[2 + 17 * 5 + 3], 8 + 17 * 24 + 12, 4, cbtUInt) && pBig->GetLeafPath(2 + 17 * 5 + 3) == L"Pair17.Inner.Flags");
+		TEST_CHECK(IsLeaf(BigLeaves.back(), 8 + (kBigPairs - 1) * 24 + 16, 8, cbtNone));
+	}
+
+	// built once
+	TEST_CHECK(BuildType(InModule.BigId)->GetLayoutPlan() == pBig);
+}
+
+static void TestFormat(const FTestModule &InModule)
+{
+	uint8_t Inner[16];
+	memset(Inner, 0xCD, sizeof(Inner));
+	const FSymTypeInfo *pInner = BuildType(InModule.InnerId);
+
+	// the first declared of equal enumerators, a value without one
+	const int32_t Colors[] = { 1, 2, 4, 0, 3 };
+	const wchar_t *ColorNames[] = { L"Red", L"Green", L"Blue", L"None", L"N/A" };
+	for (size_t k = 0; k < sizeof(Colors) / sizeof(Colors[0]); k++)
+	{
+		WriteInner(Inner, -3, 70000, Colors[k], 7);
+		FSymExpandBudget Budget;
+		const std::wstring Expected = std::wstring(L"{ A(short): -3, B(int): 70000, Color(EColor): ") + ColorNames[k] + L", Flags(UINT): 7,  }";
+		if (!TEST_CHECK(FormatPlan(pInner, Inner, Budget) == Expected))
+		{
+			printf("  %ls\n", FormatPlan(pInner, Inner, Budget).c_str());
+		}
+	} // end for k
+
+	// nested, and a pointer of each size
+	uint8_t Pair[24];
+	WriteInner(Pair, 12, -1, 2, 0);
+	const uint64_t pSelf = 0xFEDCBA9876543210ull;
+	memcpy(Pair + 16, &pSelf, 8);
+	FSymExpandBudget PairBudget;
+	TEST_CHECK(FormatPlan(BuildType(InModule.PairId), Pair, PairBudget) ==
+		L"{ Inner(FInner): { A(short): 12, B(int): -1, Color(EColor): Green, Flags(UINT): 0,  }, pSelf(FInner*): FEDCBA9876543210,  }");
+	TEST_CHECK(PairBudget.Depth == 0 && PairBudget.ValueCount == 6);
+
+	const uint8_t Narrow[8] = { 5, 0, 0, 0, 0xEF, 0xCD, 0xAB, 0x89 };
+	FSymExpandBudget NarrowBudget;
+	TEST_CHECK(FormatPlan(BuildType(InModule.NarrowId), Narrow, NarrowBudget) == L"{ Id(int): 5, pInner(FInner*): 89ABCDEF,  }");
+
+	// the whole of FBig the same as member by member, and through FormatValue() of the type
+	const FSymTypeInfo *pBig = BuildType(InModule.BigId);
+	const std::vector<uint8_t> Big = MakeBigValue();
+	FSymExpandBudget PlanBudget(4, 1 << 20), MemberBudget(4, 1 << 20), TypeBudget(4, 1 << 20);
+	FFormatBuffer Members, Type;
+	FormatMembers(pBig, &Big[0], MemberBudget, Members);
+	pBig->FormatValue((void*)&Big[0], TypeBudget, Type);
+	const std::wstring Plan = FormatPlan(pBig, &Big[0], PlanBudget);
+	TEST_CHECK(Plan == Members.GetText() && Plan == Type.GetText());
+	TEST_CHECK(Plan.find(L"Pair16(FPair): { Inner(FInner): { A(short): -1400, B(int): 1120016, Color(EColor): Blue, Flags(UINT): 48,  }") != std::wstring::npos);
+}
+
+static void TestBudget(const FTestModule &InModule)
+{
+	uint8_t Pair[24];
+	WriteInner(Pair, 12, -1, 2, 0);
+	memset(Pair + 16, 0, 8);
+	const FSymTypeInfo *pPair = BuildType(InModule.PairId);
+
+	// no room for the nested aggregate
+	FSymExpandBudget Shallow(1);
+	TEST_CHECK(FormatPlan(pPair, Pair, Shallow) == L"{ Inner(FInner): { ... }, pSelf(FInner*): 0000000000000000,  }");
+	TEST_CHECK(Shallow.Depth == 0);
+
+	// three values, the rest of each aggregate cut
+	FSymExpandBudget Few(4, 3);
+	TEST_CHECK(FormatPlan(pPair, Pair, Few) == L"{ Inner(FInner): { A(short): 12, B(int): -1, ...,  }, ...,  }");
+	TEST_CHECK(Few.Depth == 0 && Few.ValueCount == 3);
+
+	// past the depth the type does not even reach its plan
+	FFormatBuffer Text;
+	FSymExpandBudget None(0);
+	BuildType(InModule.BigId)->FormatValue(Pair, None, Text);
+	TEST_CHECK(Text.GetText() == std::wstring(L"{ ... }"));
+}
+
+static void TestHashDiff(const FTestModule &InModule)
+{
+	const FSymTypeInfo *pBig = BuildType(InModule.BigId);
+	const FSymLayoutPlan *pPlan = pBig->GetLayoutPlan();
+	const std::vector<uint8_t> Old = MakeBigValue();
+	std::vector<uint8_t> New(Old);
+
+	// the padding after A and at the end does not count
+	for (uint32_t k = 0; k < NSLayoutPlanTest::kBigPairs; k++)
+	{
+		New[8 + k * 24 + 2] = 0x11;
+		New[8 + k * 24 + 3] = 0x22;
+	} // end for k
+	memset(&New[New.size() - 8], 0, 8);
+	TEST_CHECK(pPlan->HashValue(&Old[0]) == pPlan->HashValue(&New[0]) && DiffPlan(pBig, &Old[0], &New[0]).empty());
+	TEST_CHECK(pPlan->HashValue(&Old[0]) == HashMembers(pBig, &Old[0], 14695981039346656037ull));
+
+	// a member of a nested struct, the high byte of an 8 byte pointer, the last byte of a 4 byte one
+	New[8 + 17 * 24 + 8] ^= 1;
+	New[8 + 3 * 24 + 16 + 7] ^= 0x80;
+	New[7] ^= 0x80;
+	const std::vector<std::wstring> Paths = DiffPlan(pBig, &Old[0], &New[0]);
+	TEST_CHECK(Paths.size() == 3 && Paths[0] == L"Header.pInner" && Paths[1] == L"Pair3.pSelf" && Paths[2] == L"Pair17.Inner.Color");
+	TEST_CHECK(pPlan->HashValue(&Old[0]) != pPlan->HashValue(&New[0]));
+
+	std::vector<std::wstring> MemberPaths;
+	DiffMembers(pBig, &Old[0], &New[0], std::wstring(), MemberPaths);
+	TEST_CHECK(MemberPaths == Paths);
+}
+
+static void Benchmark(const FTestModule &InModule)
+{
+	using namespace NSLayoutPlanTest;
+
+	const FSymTypeInfo *pBig = BuildType(InModule.BigId);
+	const FSymLayoutPlan *pPlan = pBig->GetLayoutPlan();
+	const std::vector<uint8_t> Old = MakeBigValue();
+	std::vector<uint8_t> New(Old);
+	New[8 + 40 * 24 + 4] ^= 1;
+
+	FFormatBuffer Text;
+	size_t PlanChars = 0, MemberChars = 0;
+	FTestTimer PlanFormatTimer;
+	for (uint32_t r = 0; r < kBenchmarkRounds; r++)
+	{
+		FSymExpandBudget Budget(4, 1 << 20);
+		Text.Clear();
+		pPlan->FormatValue(&Old[0], Budget, Text);
+		PlanChars += Text.Length();
+	} // end for r
+	const double PlanFormat = PlanFormatTimer.Seconds();
+
+	FTestTimer MemberFormatTimer;
+	for (uint32_t r = 0; r < kBenchmarkRounds; r++)
+	{
+		FSymExpandBudget Budget(4, 1 << 20);
+		Text.Clear();
+		FormatMembers(pBig, &Old[0], Budget, Text);
+		MemberChars += Text.Length();
+	} // end for r
+	const double MemberFormat = MemberFormatTimer.Seconds();
+
+	uint64_t PlanHash = 0, MemberHash = 0;
+	FTestTimer PlanHashTimer;
+	for (uint32_t r = 0; r < kBenchmarkRounds; r++)
+	{
+		PlanHash += pPlan->HashValue(&Old[0], r);
+	} // end for r
+	const double PlanHashSeconds = PlanHashTimer.Seconds();
+
+	FTestTimer MemberHashTimer;
+	for (uint32_t r = 0; r < kBenchmarkRounds; r++)
+	{
+		MemberHash += HashMembers(pBig, &Old[0], r);
+	} // end for r
+	const double MemberHashSeconds = MemberHashTimer.Seconds();
+
+	size_t PlanDiffs = 0, MemberDiffs = 0;
+	std::vector<uint32_t> Leaves;
+	FTestTimer PlanDiffTimer;
+	for (uint32_t r = 0; r < kBenchmarkRounds; r++)
+	{
+		Leaves.clear();
+		pPlan->Diff(&Old[0], &New[0], Leaves);
+		PlanDiffs += Leaves.size();
+	} // end for r
+	const double PlanDiff = PlanDiffTimer.Seconds();
+
+	std::vector<std::wstring> Paths;
+	FTestTimer MemberDiffTimer;
+	for (uint32_t r = 0; r < kBenchmarkRounds; r++)
+	{
+		Paths.clear();
+		DiffMembers(pBig, &Old[0], &New[0], std::wstring(), Paths);
+		MemberDiffs += Paths.size();
+	} // end for r
+	const double MemberDiff = MemberDiffTimer.Seconds();
+
+	const double Us = 1e6 / kBenchmarkRounds;
+	printf("FBig, %u leaves in %u bytes, plan vs member by member, us per value:\n", (uint32_t)pPlan->GetLeaves().size(), kBigLength);
+	printf("  format %.2f vs %.2f, hash %.2f vs %.2f, diff %.2f vs %.2f\n", PlanFormat * Us, MemberFormat * Us,
+		PlanHashSeconds * Us, MemberHashSeconds * Us, PlanDiff * Us, MemberDiff * Us);
+	TEST_CHECK(PlanChars == MemberChars && PlanHash == MemberHash && PlanDiffs == kBenchmarkRounds && MemberDiffs == kBenchmarkRounds);
+}
+
+int main(int, char *[])
+{
+	FSymTypeInfoHelper::Initialize();
+	FTestModule Module;
+	BuildModule(Module);
+	FSymTypeInfoHelper::RegisterTypeSource(NSLayoutPlanTest::kModuleBase, &Module.Source);
+
+	TestLeaves(Module);
+	TestFormat(Module);
+	TestBudget(Module);
+	TestHashDiff(Module);
+	Benchmark(Module);
+
+	FSymTypeInfoHelper::Uninitialize();
+	return appTestResult("Test_LayoutPlan");
+}
@@ -0,0 +1,121 @@
+// \brief
+//		FMemoryDumpFormatter checked against the lines db/dw/dd/dq print, portable. unreadable bytes,
+//		partial lines and dumps split into chunks of whole lines are covered. then the throughput of
+//		each unit width over a 16 MB dump is printed.
+//
+// cmd> Test_MemoryDump
+//
+
+#include "WinDebugger/WinMemoryDumpHelper.h"
+#include "TestHelper.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+
+namespace NSMemoryDumpTest
+{
+	const size_t kBenchmarkBytes = 16 << 20;
+}
+
+static std::string Format(uint32_t InUnitWidth, bool bInShowAscii, uint32_t InAddressDigits, uint64_t InAddress, const uint8_t *InData, const uint8_t *InValidMask, size_t InBytes)
+{
+	FMemoryDumpFormatter Formatter(InUnitWidth, bInShowAscii, InAddressDigits);
+	std::string Text;
+	Formatter.FormatLines(InAddress, InData, InValidMask, InBytes, Text);
+	return Text;
+}
+
+// 21 bytes from an unaligned address, bytes 2 and 9 unreadable
+static void TestUnitWidths()
+{
+	uint8_t Data[21], Mask[21];
+	for (uint32_t k = 0; k < sizeof(Data); k++)
+	{
+		Data[k] = (uint8_t)(0x30 + k * 3);
+		Mask[k] = 1;
+	} // end for k
+	Mask[2] = Mask[9] = 0;
+
+	TEST_CHECK(Format(1, true, 8, 0x401003, Data, Mask, sizeof(Data)) ==
+		"00401003: 30 33 ?? 39 3C 3F 42 45 48 ?? 4E 51 54 57 5A 5D  03?9<?BEH?NQTWZ]\n"
+		"00401013: 60 63 66 69 6C                                   `cfil           \n");
+	TEST_CHECK(Format(2, true, 8, 0x401003, Data, Mask, sizeof(Data)) ==
+		"00401003: 3330 ???? 3F3C 4542 ???? 514E 5754 5D5A  03?9<?BEH?NQTWZ]\n"
+		"00401013: 6360 6966 ????                           `cfil           \n");
+	TEST_CHECK(Format(4, true, 8, 0x401003, Data, Mask, sizeof(Data)) ==
+		"00401003: ???????? 45423F3C ???????? 5D5A5754  03?9<?BEH?NQTWZ]\n"
+		"00401013: 69666360 ????????                    `cfil           \n");
+	TEST_CHECK(Format(8, true, 8, 0x401003, Data, Mask, sizeof(Data)) ==
+		"00401003: ???????????????? ????????????????  03?9<?BEH?NQTWZ]\n"
+		"00401013: ????????????????                   `cfil           \n");
+
+	// no mask, no ascii, 64 bit addresses
+	TEST_CHECK(Format(1, false, 16, 0x7FF000000000ull, Data, NULL, 16) == "00007FF000000000: 30 33 36 39 3C 3F 42 45 48 4B 4E 51 54 57 5A 5D\n");
+	// a partial line is padded to the full length
+	TEST_CHECK(Format(4, false, 8, 0x1000, Data, NULL, 8) == "00001000: 39363330 45423F3C" + std::string(18, ' ') + "\n");
+	TEST_CHECK(Format(1, true, 8, 0x1000, Data, NULL, 0).empty());
+}
+
+// every line is LineLength() long, and a dump formatted in chunks of whole lines is the dump formatted at once
+static void TestChunks()
+{
+	std::vector<uint8_t> Data(1000), Mask(1000, 1);
+	for (size_t k = 0; k < Data.size(); k++)
+	{
+		Data[k] = (uint8_t)(k * 7);
+		Mask[k] = (k % 97) ? 1 : 0;
+	} // end for k
+
+	const uint32_t Widths[] = { 1, 2, 4, 8 };
+	for (size_t w = 0; w < sizeof(Widths) / sizeof(Widths[0]); w++)
+	{
+		FMemoryDumpFormatter Formatter(Widths[w], true, 8);
+		std::string Whole;
+		Formatter.FormatLines(0x20005, &Data[0], &Mask[0], Data.size(), Whole);
+		TEST_CHECK(Whole.size() == (Data.size() + 15) / 16 * Formatter.LineLength());
+
+		std::string Chunked;
+		for (size_t Offset = 0; Offset < Data.size(); Offset += 5 * FMemoryDumpFormatter::kBytesPerLine)
+		{
+			const size_t Bytes = Data.size() - Offset < 80 ? Data.size() - Offset : 80;
+			Formatter.FormatLines(0x20005 + Offset, &Data[Offset], &Mask[Offset], Bytes, Chunked);
+		} // end for Offset
+		TEST_CHECK(Chunked == Whole);
+	} // end for w
+}
+
+static void BenchmarkUnitWidths()
+{
+	using namespace NSMemoryDumpTest;
+
+	std::vector<uint8_t> Data(kBenchmarkBytes), Mask(kBenchmarkBytes, 1);
+	for (size_t k = 0; k < Data.size(); k++)
+	{
+		Data[k] = (uint8_t)(k * 7);
+	} // end for k
+	Mask[5] = 0;
+
+	const uint32_t Widths[] = { 1, 2, 4, 8 };
+	for (size_t w = 0; w < sizeof(Widths) / sizeof(Widths[0]); w++)
+	{
+		FMemoryDumpFormatter Formatter(Widths[w], true, 8);
+		std::string Text;
+		Text.reserve(Data.size() / FMemoryDumpFormatter::kBytesPerLine * Formatter.LineLength());
+
+		FTestTimer Timer;
+		Formatter.FormatLines(0x401000, &Data[0], &Mask[0], Data.size(), Text);
+		const double Seconds = Timer.Seconds();
+		printf("width %u: %u MB in %.3f s, %.1f MB/s\n", Widths[w], (uint32_t)(Data.size() >> 20), Seconds, Data.size() / Seconds / 1e6);
+		TEST_CHECK(Text.size() == Data.size() / FMemoryDumpFormatter::kBytesPerLine * Formatter.LineLength());
+	} // end for w
+}
+
+int main(int, char *[])
+{
+	TestUnitWidths();
+	TestChunks();
+	BenchmarkUnitWidths();
+	return appTestResult("Test_MemoryDump");
+}
@@ -0,0 +1,250 @@
+// \brief
+//		FPeImage over the sample images of Data/Tests, portable. unwind_x64.dll (see unwind_x64.s) and
+//		pe_x86.dll (see pe_x86.s) are parsed from the file, from a copy of the file, from a copy in the
+//		loaded layout and from captured memory read on demand, which must take one read for the headers.
+//		truncated and broken images must be rejected.
+//
+// cmd> Test_PeImage [fixture dir]
+//
+
+#include "WinDebugger/WinPeImage.h"
+#include "WinDebugger/WinRemoteMemory.h"
+#include "TestHelper.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+
+// captured memory that counts the reads
+class FCountingMemory : public FCapturedMemory
+{
+public:
+	FCountingMemory() : ReadCount(0) {}
+
+	virtual bool ReadMemory(uint64_t InAddress, void *OutBuffer, size_t InBytes) override
+	{
+		ReadCount++;
+		return FCapturedMemory::ReadMemory(InAddress, OutBuffer, InBytes);
+	}
+
+	uint32_t	ReadCount;
+};
+
+static bool ReadFile(const std::string &InFilename, std::vector<uint8_t> &OutData)
+{
+	FILE *File = fopen(InFilename.c_str(), "rb");
+	if (!File)
+	{
+		return false;
+	}
+	uint8_t Buffer[4096];
+	OutData.clear();
+	for (size_t Bytes; (Bytes = fread(Buffer, 1, sizeof(Buffer), File)) > 0; )
+	{
+		OutData.insert(OutData.end(), Buffer, Buffer + Bytes);
+	}
+	fclose(File);
+	return !OutData.empty();
+}
+
+// the file in the layout the loader maps it with
+static std::vector<uint8_t> GetLoadedLayout(const FPeImage &InImage, const std::vector<uint8_t> &InFile)
+{
+	std::vector<uint8_t> Layout(InImage.GetSizeOfImage(), 0);
+	const std::vector<FPeSection> &Sections = InImage.GetSections();
+	const uint32_t HeaderBytes = Sections.empty() ? 0x400 : Sections[0].RawOffset;
+	memcpy(&Layout[0], &InFile[0], HeaderBytes);
+	for (size_t k = 0; k < Sections.size(); k++)
+	{
+		const FPeSection &Section = Sections[k];
+		const uint32_t Bytes = (Section.VirtualSize && Section.VirtualSize < Section.RawSize) ? Section.VirtualSize : Section.RawSize;
+		if ((uint64_t)Section.RawOffset + Bytes <= InFile.size() && (uint64_t)Section.VirtualAddress + Bytes <= Layout.size())
+		{
+			memcpy(&Layout[Section.VirtualAddress], &InFile[Section.RawOffset], Bytes);
+		}
+	} // end for k
+	return Layout;
+}
+
+static bool IsGuid(const FPdbGuid &InGuid, const uint8_t (&InBytes)[16])
+{
+	return memcmp(&InGuid, InBytes, 16) == 0;
+}
+
+static const FPeExport* FindExport(const std::vector<FPeExport> &InExports, const char *InName)
+{
+	for (size_t k = 0; k < InExports.size(); k++)
+	{
+		if (InExports[k].Name && !strcmp(InExports[k].Name, InName))
+		{
+			return &InExports[k];
+		}
+	} // end for k
+	return NULL;
+}
+
+// RSDS GUID of unwind_x64.dll, in file order
+static const uint8_t sGuidX64[16] = { 0xAE, 0xC7, 0x2F, 0x2B, 0x85, 0x5C, 0x53, 0x64, 0x4C, 0x4C, 0x44, 0x20, 0x50, 0x44, 0x42, 0x2E };
+static const uint8_t sGuidX86[16] = { 0xCF, 0xCA, 0x0B, 0x2E, 0x84, 0x15, 0x04, 0x27, 0x4C, 0x4C, 0x44, 0x20, 0x50, 0x44, 0x42, 0x2E };
+
+// the tables of unwind_x64.dll, however it was opened
+static void CheckX64(const FPeImage &InImage)
+{
+	TEST_CHECK(InImage.IsOpen() && InImage.Is64Bit() && InImage.GetMachine() == NSPeImage::MACHINE_AMD64);
+	TEST_CHECK(InImage.GetImageBase() == 0x180000000ull && InImage.GetSizeOfImage() == 0x4000 && InImage.GetEntryPointRva() == 0);
+	TEST_CHECK((InImage.GetCharacteristics() & 0x2000) != 0);	// IMAGE_FILE_DLL
+
+	const std::vector<FPeSection> &Sections = InImage.GetSections();
+	TEST_CHECK(Sections.size() == 3 && !strcmp(Sections[0].Name, ".text") && !strcmp(Sections[1].Name, ".rdata") && !strcmp(Sections[2].Name, ".pdata"));
+	TEST_CHECK(Sections.size() == 3 && (Sections[0].Characteristics & NSPeImage::SCN_MEM_EXECUTE) && Sections[2].VirtualAddress == 0x3000);
+	TEST_CHECK(InImage.FindSection(0x1050) == &Sections[0] && InImage.FindSection(0x5000) == NULL);
+
+	std::vector<FPeExport> Exports;
+	const char *ModuleName = NULL;
+	TEST_CHECK(InImage.GetExports(Exports, &ModuleName) && ModuleName && !strcmp(ModuleName, "unwind_x64.dll"));
+	const char *Names[] = { "CallImport", "Entry", "FramePointer", "Leaf", "PushMany", "SaveNonvol", "TailCaller" };
+	const uint32_t Rvas[] = { 0x1111, 0x1000, 0x1027, 0x10AE, 0x10D0, 0x105D, 0x10B7 };
+	if (TEST_CHECK(Exports.size() == 7))
+	{
+		for (uint32_t k = 0; k < 7; k++)
+		{
+			TEST_CHECK(!strcmp(Exports[k].Name, Names[k]) && Exports[k].Ordinal == k + 1 && Exports[k].Rva == Rvas[k] && !Exports[k].Forwarder);
+		} // end for k
+	}
+
+	std::vector<FPeImport> Imports;
+	TEST_CHECK(InImage.GetImports(Imports));
+	TEST_CHECK(Imports.size() == 1 && !strcmp(Imports[0].ModuleName, "kernel32.dll") && Imports[0].Name && !strcmp(Imports[0].Name, "GetTickCount")
+		&& Imports[0].IatRva == 0x2158);
+
+	FPeCodeView CodeView;
+	TEST_CHECK(InImage.GetCodeView(CodeView) && IsGuid(CodeView.Guid, sGuidX64) && CodeView.Age == 1 && !strcmp(CodeView.PdbPath, "unwind_x64.pdb"));
+
+	// Leaf has no unwind info
+	TEST_CHECK(InImage.GetRuntimeFunctionCount() == 6);
+	FPeRuntimeFunction Function;
+	TEST_CHECK(InImage.GetRuntimeFunction(1, Function) && Function.BeginRva == 0x1027 && Function.EndRva == 0x105D);
+	TEST_CHECK(InImage.FindRuntimeFunction(0x1040, Function) && Function.BeginRva == 0x1027);
+	TEST_CHECK(InImage.FindRuntimeFunction(0x10D0, Function) && Function.BeginRva == 0x10D0 && Function.EndRva == 0x1111);
+	TEST_CHECK(!InImage.FindRuntimeFunction(0x10B0, Function) && !InImage.FindRuntimeFunction(0xFFF, Function));
+
+	// lea rbp, [rsp + 0x20]: rbp, offset 2 * 16
+	FPeUnwindInfo Info;
+	TEST_CHECK(InImage.FindRuntimeFunction(0x1027, Function) && InImage.GetUnwindInfo(Function.UnwindInfoRva, Info));
+	TEST_CHECK(Info.Version == 1 && Info.Flags == 0 && Info.PrologSize == 12 && Info.CodeCount == 4 && Info.FrameRegister == 5 && Info.FrameOffset == 2);
+	// push x5, alloc large with a 32 bit size: 5 + 3 slots
+	TEST_CHECK(InImage.FindRuntimeFunction(0x10D0, Function) && InImage.GetUnwindInfo(Function.UnwindInfoRva, Info));
+	TEST_CHECK(Info.PrologSize == 15 && Info.CodeCount == 8 && Info.FrameRegister == 0 && (Info.Codes[1] & 0xF) == 1 && (Info.Codes[1] >> 4) == 1);
+}
+
+static void CheckX86(const FPeImage &InImage)
+{
+	TEST_CHECK(InImage.IsOpen() && !InImage.Is64Bit() && InImage.GetMachine() == NSPeImage::MACHINE_I386);
+	TEST_CHECK(InImage.GetImageBase() == 0x10000000 && InImage.GetSizeOfImage() == 0x4000);
+
+	std::vector<FPeExport> Exports;
+	TEST_CHECK(InImage.GetExports(Exports));
+	if (TEST_CHECK(Exports.size() == 5))
+	{
+		// ordinal only, then by name in ordinal order
+		TEST_CHECK(Exports[0].Name == NULL && Exports[0].Ordinal == 9 && Exports[0].Rva == 0x1010);
+		TEST_CHECK(Exports[1].Ordinal == 10 && !strcmp(Exports[1].Name, "Add") && Exports[1].Rva == 0x1000);
+		TEST_CHECK(Exports[4].Ordinal == 13 && !strcmp(Exports[4].Name, "Twice") && Exports[4].Rva == 0x1009);
+	}
+	const FPeExport *pTick = FindExport(Exports, "Tick");
+	TEST_CHECK(pTick && pTick->Forwarder && !strcmp(pTick->Forwarder, "kernel32.GetTickCount"));
+	const FPeExport *pCall = FindExport(Exports, "CallImports");
+	TEST_CHECK(pCall && pCall->Rva == 0x1013 && !pCall->Forwarder);
+
+	std::vector<FPeImport> Imports;
+	TEST_CHECK(InImage.GetImports(Imports));
+	if (TEST_CHECK(Imports.size() == 3))
+	{
+		TEST_CHECK(!strcmp(Imports[0].ModuleName, "kernel32.dll") && !strcmp(Imports[0].Name, "GetTickCount") && Imports[0].IatRva == 0x213C);
+		TEST_CHECK(!strcmp(Imports[1].ModuleName, "kernel32.dll") && !strcmp(Imports[1].Name, "Sleep") && Imports[1].IatRva == 0x2140);
+		TEST_CHECK(!strcmp(Imports[2].ModuleName, "helper.dll") && Imports[2].Name == NULL && Imports[2].Ordinal == 7 && Imports[2].IatRva == 0x2148);
+	}
+
+	FPeCodeView CodeView;
+	TEST_CHECK(InImage.GetCodeView(CodeView) && IsGuid(CodeView.Guid, sGuidX86) && CodeView.Age == 1 && !strcmp(CodeView.PdbPath, "pe_x86.pdb"));
+	TEST_CHECK(InImage.GetRuntimeFunctionCount() == 0);
+}
+
+// the file, a copy of it, the loaded layout, and captured memory
+static void TestImage(const std::string &InFilename, void (*InCheck)(const FPeImage&))
+{
+	std::vector<uint8_t> File;
+	if (!TEST_CHECK(ReadFile(InFilename, File)))
+	{
+		printf("  %s not found\n", InFilename.c_str());
+		return;
+	}
+
+	FPeImage Mapped;
+	if (TEST_CHECK(Mapped.OpenFile(appTestWidePath(InFilename))))
+	{
+		InCheck(Mapped);
+	}
+
+	FPeImage Copy;
+	if (TEST_CHECK(Copy.OpenMemory(&File[0], File.size(), false)))
+	{
+		InCheck(Copy);
+	}
+
+	const std::vector<uint8_t> Layout = GetLoadedLayout(Mapped, File);
+	FPeImage Loaded;
+	if (TEST_CHECK(Loaded.OpenMemory(&Layout[0], Layout.size(), true)))
+	{
+		InCheck(Loaded);
+	}
+
+	// the headers take one read, each table one more
+	FCountingMemory Memory;
+	Memory.AddRegion(Mapped.GetImageBase(), &Layout[0], Layout.size());
+	FPeImage Remote;
+	TEST_CHECK(Remote.OpenRemote(Memory, Mapped.GetImageBase()) && Memory.ReadCount == 1);
+	TEST_CHECK(Remote.GetSizeOfImage() == Mapped.GetSizeOfImage() && Remote.GetSections().size() == Mapped.GetSections().size());
+	std::vector<FPeExport> Exports;
+	TEST_CHECK(!Remote.GetExports(Exports));
+	TEST_CHECK(Remote.ReadRemoteDirectory(Memory, NSPeImage::DIRECTORY_EXPORT) && Remote.ReadRemoteDirectory(Memory, NSPeImage::DIRECTORY_IMPORT)
+		&& Remote.ReadRemoteDebugData(Memory));
+	uint32_t Rva = 0, Size = 0;
+	if (Remote.GetDataDirectory(NSPeImage::DIRECTORY_EXCEPTION, Rva, Size))
+	{
+		// the unwind info is in .rdata
+		const FPeSection *pRdata = Remote.FindSection(0x2000);
+		TEST_CHECK(Remote.ReadRemoteRange(Memory, Rva, Size) && pRdata && Remote.ReadRemoteRange(Memory, pRdata->VirtualAddress, pRdata->VirtualSize));
+	}
+	// the import names and IAT are in .rdata too
+	const FPeSection *pRdata = Remote.FindSection(0x2000);
+	TEST_CHECK(pRdata && Remote.ReadRemoteRange(Memory, pRdata->VirtualAddress, pRdata->VirtualSize));
+	InCheck(Remote);
+
+	// truncated: the headers, but not the sections
+	FPeImage Truncated;
+	TEST_CHECK(!Truncated.OpenMemory(&File[0], 0x100, false) || !Truncated.GetExports(Exports));
+
+	// no PE signature
+	std::vector<uint8_t> Broken(File);
+	uint32_t NtOffset;
+	memcpy(&NtOffset, &Broken[0x3C], 4);
+	Broken[NtOffset] = 'X';
+	FPeImage BrokenImage;
+	TEST_CHECK(!BrokenImage.OpenMemory(&Broken[0], Broken.size(), false));
+
+	// e_lfanew past the end
+	NtOffset = (uint32_t)Broken.size();
+	memcpy(&Broken[0x3C], &NtOffset, 4);
+	TEST_CHECK(!BrokenImage.OpenMemory(&Broken[0], Broken.size(), false));
+}
+
+int main(int argc, char *argv[])
+{
+	const std::string DataDir = appTestDataDir(argc, argv);
+	TestImage(DataDir + "unwind_x64.dll", CheckX64);
+	TestImage(DataDir + "pe_x86.dll", CheckX86);
+	return appTestResult("Test_PeImage");
+}
@@ -0,0 +1,245 @@
+// \brief
+//		FModuleSymbolIndex over synthetic symbol tables, portable. address lookups are checked against
+//		a binary search of the sorted table for tables of 0 to 100000 symbols, with and without sizes,
+//		then name lookups, the rank order and a round trip through a symbol cache file. the lookups
+//		per second of the Eytzinger search, of std::upper_bound over the same table and of the name
+//		hash are printed for a table of 100000 symbols.
+//
+// cmd> Test_SymbolIndex
+//
+
+#include "WinDebugger/WinSymbolIndex.h"
+#include "WinDebugger/WinSymbolCache.h"
+#include "TestHelper.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+
+namespace NSSymbolIndexTest
+{
+	const uint32_t kChecksPerTable   = 20000;
+	const uint32_t kBenchmarkSymbols = 100000;
+	const uint32_t kBenchmarkQueries = 1 << 22;
+	// spacing of the synthetic function starts, the average size of a function
+	const uint32_t kSpacing          = 64;
+}
+
+struct FTestSymbol
+{
+	uint32_t	Rva;
+	uint32_t	Size;
+	std::string	Name;
+
+	bool operator<(const FTestSymbol &Other) const { return Rva < Other.Rva; }
+};
+
+// InCount distinct starts in random order, every third one with a size shorter than the gap to the next
+static std::vector<FTestSymbol> MakeTable(uint32_t InCount, std::mt19937 &InRandom)
+{
+	using namespace NSSymbolIndexTest;
+
+	std::vector<FTestSymbol> Symbols(InCount);
+	for (uint32_t k = 0; k < InCount; k++)
+	{
+		Symbols[k].Rva = 0x1000 + k * kSpacing + (uint32_t)(InRandom() % (kSpacing / 2));
+		Symbols[k].Size = (k % 3) ? 0 : kSpacing / 4;
+		Symbols[k].Name = "Module::Function" + std::to_string(k);
+	} // end for k
+	std::shuffle(Symbols.begin(), Symbols.end(), InRandom);
+	return Symbols;
+}
+
+static void BuildIndex(const std::vector<FTestSymbol> &InSymbols, FModuleSymbolIndex &OutIndex)
+{
+	OutIndex.Clear();
+	OutIndex.Reserve(InSymbols.size(), InSymbols.size() * 24);
+	for (size_t k = 0; k < InSymbols.size(); k++)
+	{
+		OutIndex.AddSymbol(InSymbols[k].Rva, InSymbols[k].Size, InSymbols[k].Name.c_str());
+	} // end for k
+	OutIndex.Finalize();
+}
+
+// the symbol a lookup must find in the sorted table, NULL if none
+static const FTestSymbol* FindReference(const std::vector<FTestSymbol> &InSorted, uint32_t InRva)
+{
+	FTestSymbol Key;
+	Key.Rva = InRva;
+	std::vector<FTestSymbol>::const_iterator It = std::upper_bound(InSorted.begin(), InSorted.end(), Key);
+	if (It == InSorted.begin())
+	{
+		return NULL;
+	}
+	--It;
+	return (It->Size && InRva - It->Rva >= It->Size) ? NULL : &*It;
+}
+
+static bool IsSameSymbol(const FModuleSymbolIndex::FSymbol &InSymbol, const FTestSymbol &InExpected)
+{
+	return InSymbol.Rva == InExpected.Rva && InSymbol.Size == InExpected.Size && InSymbol.Name && InExpected.Name == InSymbol.Name;
+}
+
+static void CheckIndex(const FModuleSymbolIndex &InIndex, const std::vector<FTestSymbol> &InSorted, std::mt19937 &InRandom)
+{
+	using namespace NSSymbolIndexTest;
+
+	TEST_CHECK(InIndex.GetCount() == InSorted.size());
+
+	const uint32_t End = 0x1000 + (uint32_t)InSorted.size() * kSpacing + kSpacing;
+	uint32_t Mismatches = 0;
+	for (uint32_t k = 0; k < kChecksPerTable; k++)
+	{
+		const uint32_t Rva = (uint32_t)(InRandom() % End);
+		const FTestSymbol *pExpected = FindReference(InSorted, Rva);
+		FModuleSymbolIndex::FSymbol Symbol;
+		const bool bFound = InIndex.FindByAddress(Rva, Symbol);
+		if (bFound != (pExpected != NULL) || (bFound && !IsSameSymbol(Symbol, *pExpected)))
+		{
+			Mismatches++;
+		}
+	} // end for k
+	TEST_CHECK(Mismatches == 0);
+
+	// every start, the byte before it and the names
+	Mismatches = 0;
+	for (size_t k = 0; k < InSorted.size(); k++)
+	{
+		FModuleSymbolIndex::FSymbol Symbol, Named, Ranked;
+		const FTestSymbol *pBefore = FindReference(InSorted, InSorted[k].Rva - 1);
+		if (!InIndex.FindByAddress(InSorted[k].Rva, Symbol) || !IsSameSymbol(Symbol, InSorted[k])
+			|| InIndex.FindByAddress(InSorted[k].Rva - 1, Symbol) != (pBefore != NULL)
+			|| !InIndex.FindByName(InSorted[k].Name.c_str(), Named) || !IsSameSymbol(Named, InSorted[k]))
+		{
+			Mismatches++;
+		}
+		InIndex.GetSymbol((uint32_t)k, Ranked);
+		if (!IsSameSymbol(Ranked, InSorted[k]))
+		{
+			Mismatches++;
+		}
+	} // end for k
+	TEST_CHECK(Mismatches == 0);
+
+	FModuleSymbolIndex::FSymbol Symbol;
+	TEST_CHECK(!InIndex.FindByName("Module::Missing", Symbol));
+	TEST_CHECK(!InIndex.FindByAddress(0xFFF, Symbol));
+}
+
+static void TestTables()
+{
+	std::mt19937 Random(1);
+	const uint32_t Counts[] = { 0, 1, 2, 3, 7, 8, 9, 15, 16, 17, 100, 1000, 4095, 4096, 100000 };
+	for (size_t c = 0; c < sizeof(Counts) / sizeof(Counts[0]); c++)
+	{
+		std::vector<FTestSymbol> Symbols = MakeTable(Counts[c], Random);
+		FModuleSymbolIndex Index;
+		BuildIndex(Symbols, Index);
+
+		std::sort(Symbols.begin(), Symbols.end());
+		CheckIndex(Index, Symbols, Random);
+	} // end for c
+}
+
+static void TestCacheFile()
+{
+	std::mt19937 Random(2);
+	std::vector<FTestSymbol> Symbols = MakeTable(5000, Random);
+	FModuleSymbolIndex Index;
+	BuildIndex(Symbols, Index);
+	std::sort(Symbols.begin(), Symbols.end());
+
+	const std::wstring Filename = L"Test_SymbolIndex.symcache";
+	const FPdbGuid Guid = { 0x12345678, 0x9ABC, 0xDEF0, { 1, 2, 3, 4, 5, 6, 7, 8 } };
+	FSymbolCacheWriter Writer;
+	Index.Save(Writer);
+	if (!TEST_CHECK(Writer.Save(Filename, Guid, 3)))
+	{
+		return;
+	}
+
+	FModuleSymbolIndex Loaded;
+	FSymbolCacheReader Reader;
+	if (TEST_CHECK(Reader.Open(Filename, Guid, 3)) && TEST_CHECK(Loaded.Load(Reader)))
+	{
+		CheckIndex(Loaded, Symbols, Random);
+	}
+	Reader.Close();
+
+	// another age is another PDB
+	FSymbolCacheReader Stale;
+	TEST_CHECK(!Stale.Open(Filename, Guid, 4));
+	remove("Test_SymbolIndex.symcache");
+}
+
+static void Benchmark()
+{
+	using namespace NSSymbolIndexTest;
+
+	std::mt19937 Random(3);
+	std::vector<FTestSymbol> Symbols = MakeTable(kBenchmarkSymbols, Random);
+	FModuleSymbolIndex Index;
+	FTestTimer BuildTimer;
+	BuildIndex(Symbols, Index);
+	const double BuildSeconds = BuildTimer.Seconds();
+	std::sort(Symbols.begin(), Symbols.end());
+	std::vector<uint32_t> Rvas(Symbols.size());
+	for (size_t k = 0; k < Symbols.size(); k++)
+	{
+		Rvas[k] = Symbols[k].Rva;
+	} // end for k
+
+	const uint32_t End = 0x1000 + kBenchmarkSymbols * kSpacing;
+	std::vector<uint32_t> Queries(kBenchmarkQueries);
+	for (size_t k = 0; k < Queries.size(); k++)
+	{
+		Queries[k] = (uint32_t)(Random() % End);
+	} // end for k
+
+	uint64_t Sum = 0;
+	FTestTimer IndexTimer;
+	for (size_t k = 0; k < Queries.size(); k++)
+	{
+		FModuleSymbolIndex::FSymbol Symbol;
+		Sum += Index.FindByAddress(Queries[k], Symbol) ? Symbol.Rva : 0;
+	} // end for k
+	const double IndexSeconds = IndexTimer.Seconds();
+
+	uint64_t ReferenceSum = 0;
+	FTestTimer SearchTimer;
+	for (size_t k = 0; k < Queries.size(); k++)
+	{
+		std::vector<uint32_t>::const_iterator It = std::upper_bound(Rvas.begin(), Rvas.end(), Queries[k]);
+		ReferenceSum += It != Rvas.begin() ? *(It - 1) : 0;
+	} // end for k
+	const double SearchSeconds = SearchTimer.Seconds();
+
+	FTestTimer NameTimer;
+	uint32_t Named = 0;
+	for (size_t k = 0; k < Queries.size() / 16; k++)
+	{
+		FModuleSymbolIndex::FSymbol Symbol;
+		Named += Index.FindByName(Symbols[Queries[k] % Symbols.size()].Name.c_str(), Symbol) ? 1 : 0;
+	} // end for k
+	const double NameSeconds = NameTimer.Seconds();
+
+	printf("%u symbols: built in %.1f ms, %u KB\n", kBenchmarkSymbols, BuildSeconds * 1e3, (uint32_t)(Index.GetMemoryUsage() / 1024));
+	printf("by address: %.1f M/s, std::upper_bound %.1f M/s\n", Queries.size() / IndexSeconds / 1e6, Queries.size() / SearchSeconds / 1e6);
+	printf("by name: %.1f M/s\n", Queries.size() / 16 / NameSeconds / 1e6);
+
+	// with sizes the index finds fewer symbols, never others
+	TEST_CHECK(Sum <= ReferenceSum);
+	TEST_CHECK(Named == Queries.size() / 16);
+}
+
+int main(int, char *[])
+{
+	TestTables();
+	TestCacheFile();
+	Benchmark();
+	return appTestResult("Test_SymbolIndex");
+}
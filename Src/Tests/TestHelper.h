@@ -0,0 +1,78 @@
+// \brief
+//		checks and timings of the test targets, portable. a failed check prints its expression and
+//		line, main returns appTestResult(), which is 1 if any check failed.
+//
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+
+struct FTestResults
+{
+	uint32_t	Checks;
+	uint32_t	Failures;
+};
+
+inline FTestResults& appTestResults()
+{
+	static FTestResults Results = { 0, 0 };
+	return Results;
+}
+
+inline bool appTestCheck(bool bInPassed, const char *InExpression, const char *InFile, int InLine)
+{
+	FTestResults &Results = appTestResults();
+	Results.Checks++;
+	if (!bInPassed)
+	{
+		Results.Failures++;
+		printf("  failed: %s (%s:%d)\n", InExpression, InFile, InLine);
+	}
+	return bInPassed;
+}
+
+#define TEST_CHECK(Expression) appTestCheck(!!(Expression), #Expression, __FILE__, __LINE__)
+
+// print the summary, the exit code of the target
+inline int appTestResult(const char *InName)
+{
+	const FTestResults &Results = appTestResults();
+	printf("%s: %u checks, %u failed\n", InName, Results.Checks, Results.Failures);
+	return Results.Failures || !Results.Checks ? 1 : 0;
+}
+
+// the directory of the checked in fixtures, the first argument or Data/Tests seen from Bin, with a separator
+inline std::string appTestDataDir(int argc, char *argv[])
+{
+	std::string Dir = argc > 1 ? argv[1] : "../Data/Tests/";
+	if (!Dir.empty() && Dir[Dir.size() - 1] != '/' && Dir[Dir.size() - 1] != '\\')
+	{
+		Dir += '/';
+	}
+	return Dir;
+}
+
+// file names are ascii
+inline std::wstring appTestWidePath(const std::string &InPath)
+{
+	return std::wstring(InPath.begin(), InPath.end());
+}
+
+// wall time of a benchmark
+class FTestTimer
+{
+public:
+	FTestTimer() : Start(std::chrono::steady_clock::now()) {}
+
+	double Seconds() const
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+	}
+
+private:
+	std::chrono::steady_clock::time_point	Start;
+};
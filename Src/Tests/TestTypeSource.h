@@ -0,0 +1,259 @@
+// \brief
+//		a module of types described in tables, served to FSymTypeInfoHelper in place of dbghelp. ids
+//		are indexes into the table, members and enumerators are symbols of their own. the queries are
+//		counted, and batches can be made to fail the way older dbghelp versions do.
+//
+
+#pragma once
+
+#include "WinDebugger/WinVariableTypeHelper.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+
+class FTestTypeSource : public FSymTypeSource
+{
+public:
+	FTestTypeSource() : QueryCount(0), BatchCount(0), bFailBatches(false)
+	{
+		Symbols.resize(1);	// no id 0
+	}
+
+	uint32_t AddBaseType(BaseTypeEnum InBaseType, uint32_t InLength)
+	{
+		FSymbol &Symbol = AddSymbol(SymTagBaseType, L"");
+		Symbol.BaseType = InBaseType;
+		Symbol.Length = InLength;
+		return LastId();
+	}
+
+	uint32_t AddPointer(uint32_t InPointedTypeId, uint32_t InLength)
+	{
+		FSymbol &Symbol = AddSymbol(SymTagPointerType, L"");
+		Symbol.TypeId = InPointedTypeId;
+		Symbol.Length = InLength;
+		return LastId();
+	}
+
+	uint32_t AddArray(uint32_t InElementTypeId, uint32_t InCount)
+	{
+		FSymbol &Symbol = AddSymbol(SymTagArrayType, L"");
+		Symbol.TypeId = InElementTypeId;
+		Symbol.Count = InCount;
+		Symbol.Length = Symbols[InElementTypeId].Length * InCount;
+		return LastId();
+	}
+
+	uint32_t AddTypedef(const std::wstring &InName, uint32_t InTypeId)
+	{
+		FSymbol &Symbol = AddSymbol(SymTagTypedef, InName);
+		Symbol.TypeId = InTypeId;
+		return LastId();
+	}
+
+	uint32_t AddUdt(const std::wstring &InName, uint32_t InLength)
+	{
+		AddSymbol(SymTagUDT, InName).Length = InLength;
+		return LastId();
+	}
+
+	// a data member, or with SymTagBaseClass a base class
+	uint32_t AddMember(uint32_t InUdtId, const std::wstring &InName, uint32_t InTypeId, uint32_t InOffset, DWORD InSymTag = SymTagData)
+	{
+		FSymbol &Member = AddSymbol(InSymTag, InName);
+		Member.TypeId = InTypeId;
+		Member.Offset = InOffset;
+		Symbols[InUdtId].Children.push_back(LastId());
+		return LastId();
+	}
+
+	// a method, it has a function type but no offset
+	uint32_t AddMethod(uint32_t InUdtId, const std::wstring &InName, uint32_t InFunctionTypeId)
+	{
+		AddSymbol(SymTagFunction, InName).TypeId = InFunctionTypeId;
+		Symbols[InUdtId].Children.push_back(LastId());
+		return LastId();
+	}
+
+	uint32_t AddFunctionType(uint32_t InReturnTypeId)
+	{
+		AddSymbol(SymTagFunctionType, L"").TypeId = InReturnTypeId;
+		return LastId();
+	}
+
+	uint32_t AddArgument(uint32_t InFunctionTypeId, uint32_t InTypeId)
+	{
+		AddSymbol(SymTagFunctionArgType, L"").TypeId = InTypeId;
+		Symbols[InFunctionTypeId].Children.push_back(LastId());
+		return LastId();
+	}
+
+	uint32_t AddEnum(const std::wstring &InName, BaseTypeEnum InBaseType, uint32_t InLength)
+	{
+		FSymbol &Symbol = AddSymbol(SymTagEnum, InName);
+		Symbol.BaseType = InBaseType;
+		Symbol.Length = InLength;
+		return LastId();
+	}
+
+	uint32_t AddEnumerator(uint32_t InEnumId, const std::wstring &InName, int32_t InValue)
+	{
+		AddSymbol(SymTagData, InName).Value = InValue;
+		Symbols[InEnumId].Children.push_back(LastId());
+		return LastId();
+	}
+
+	uint32_t GetTypeCount() const { return (uint32_t)Symbols.size() - 1; }
+
+	virtual BOOL GetTypeInfo(uint32_t TypeId, IMAGEHLP_SYMBOL_TYPE_INFO GetType, PVOID pInfo) override
+	{
+		QueryCount++;
+		if (TypeId == 0 || TypeId >= Symbols.size())
+		{
+			return FALSE;
+		}
+
+		const FSymbol &Symbol = Symbols[TypeId];
+		switch (GetType)
+		{
+		case TI_GET_SYMTAG:
+			*(DWORD*)pInfo = Symbol.SymTag;
+			return TRUE;
+		case TI_GET_SYMNAME:
+			{
+				if (Symbol.Name.empty())
+				{
+					return FALSE;
+				}
+				const size_t Bytes = (Symbol.Name.size() + 1) * sizeof(WCHAR);
+				WCHAR *pName = (WCHAR*)LocalAlloc(LMEM_FIXED, Bytes);
+				memcpy(pName, Symbol.Name.c_str(), Bytes);
+				*(WCHAR**)pInfo = pName;
+				return TRUE;
+			}
+		case TI_GET_LENGTH:
+			if (Symbol.SymTag == SymTagData || Symbol.SymTag == SymTagFunction || Symbol.SymTag == SymTagTypedef
+				|| Symbol.SymTag == SymTagFunctionType || Symbol.SymTag == SymTagFunctionArgType)
+			{
+				return FALSE;
+			}
+			*(ULONG64*)pInfo = Symbol.Length;
+			return TRUE;
+		case TI_GET_BASETYPE:
+			if (Symbol.SymTag != SymTagBaseType && Symbol.SymTag != SymTagEnum)
+			{
+				return FALSE;
+			}
+			*(DWORD*)pInfo = Symbol.BaseType;
+			return TRUE;
+		case TI_GET_TYPEID:
+			if (Symbol.TypeId == 0)
+			{
+				return FALSE;
+			}
+			*(DWORD*)pInfo = Symbol.TypeId;
+			return TRUE;
+		case TI_GET_OFFSET:
+			if ((Symbol.SymTag != SymTagData && Symbol.SymTag != SymTagBaseClass) || Symbol.TypeId == 0)
+			{
+				return FALSE;
+			}
+			*(DWORD*)pInfo = Symbol.Offset;
+			return TRUE;
+		case TI_GET_COUNT:
+			if (Symbol.SymTag != SymTagArrayType)
+			{
+				return FALSE;
+			}
+			*(DWORD*)pInfo = Symbol.Count;
+			return TRUE;
+		case TI_GET_IS_REFERENCE:
+			*(BOOL*)pInfo = FALSE;
+			return Symbol.SymTag == SymTagPointerType;
+		case TI_GET_VALUE:
+			{
+				if (Symbol.SymTag != SymTagData || Symbol.TypeId != 0)
+				{
+					return FALSE;
+				}
+				VARIANT Value;
+				memset(&Value, 0, sizeof(Value));
+				Value.vt = 3;	// VT_I4
+				Value.intVal = Symbol.Value;
+				*(VARIANT*)pInfo = Value;
+				return TRUE;
+			}
+		case TI_GET_CHILDRENCOUNT:
+			*(DWORD*)pInfo = (DWORD)Symbol.Children.size();
+			return TRUE;
+		case TI_FINDCHILDREN:
+			{
+				TI_FINDCHILDREN_PARAMS *pParams = (TI_FINDCHILDREN_PARAMS*)pInfo;
+				if (pParams->Start + pParams->Count > Symbol.Children.size())
+				{
+					return FALSE;
+				}
+				for (ULONG k = 0; k < pParams->Count; k++)
+				{
+					pParams->ChildId[k] = Symbol.Children[pParams->Start + k];
+				} // end for k
+				return TRUE;
+			}
+		default:
+			return FALSE;
+		}
+	}
+
+	virtual BOOL GetTypeInfoEx(PIMAGEHLP_GET_TYPE_INFO_PARAMS Params) override
+	{
+		BatchCount++;
+		if (bFailBatches)
+		{
+			return FALSE;
+		}
+		// the attributes of a batch are not counted as single queries
+		const uint64_t SingleQueries = QueryCount;
+		const BOOL bSuccess = FSymTypeSource::GetTypeInfoEx(Params);
+		QueryCount = SingleQueries;
+		return bSuccess;
+	}
+
+	uint64_t	QueryCount;
+	uint64_t	BatchCount;
+	bool		bFailBatches;
+
+private:
+	struct FSymbol
+	{
+		DWORD					SymTag;
+		std::wstring			Name;
+		uint64_t				Length;
+		DWORD					BaseType;
+		uint32_t				TypeId;		// of a member, pointer, array or typedef
+		uint32_t				Offset;
+		uint32_t				Count;
+		int32_t					Value;
+		std::vector<uint32_t>	Children;
+	};
+
+	FSymbol& AddSymbol(DWORD InSymTag, const std::wstring &InName)
+	{
+		FSymbol Symbol;
+		Symbol.SymTag = InSymTag;
+		Symbol.Name = InName;
+		Symbol.Length = 0;
+		Symbol.BaseType = btNoType;
+		Symbol.TypeId = 0;
+		Symbol.Offset = 0;
+		Symbol.Count = 0;
+		Symbol.Value = 0;
+		Symbols.push_back(Symbol);
+		return Symbols.back();
+	}
+
+	uint32_t LastId() const { return (uint32_t)Symbols.size() - 1; }
+
+	std::vector<FSymbol>	Symbols;
+};
@@ -0,0 +1,181 @@
+// \brief
+//		the per-module type arenas of FSymTypeInfoHelper over modules of 100000 types served by
+//		FTestTypeSource. a type is built once, later lookups return the same node without a query.
+//		two modules using the same type ids keep their own types, unloading one leaves the other
+//		intact, and a module loaded again is built again. then the bulk build and lookup rates and
+//		the time to unload a module are printed.
+//
+// cmd> Test_TypeArena
+//
+
+#include "WinDebugger/WinVariableTypeHelper.h"
+#include "TestTypeSource.h"
+#include "TestHelper.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+
+namespace NSTypeArenaTest
+{
+	const uint32_t kModuleTypes     = 100000;
+	const uint32_t kLookupRounds    = 20;
+	const uint64_t kModuleBaseA     = 0x10000000;
+	const uint64_t kModuleBaseB     = 0x20000000;
+}
+
+// a module of InUdtCount structs FPrefix<k> { int Id; FPrefix<k+1> *pNext; EState State; DWORD Flags; }, the
+// last one pointing at the first. the UDTs take the ids 1 to InUdtCount, their pointers the next InUdtCount ids.
+// returns the last type id, the members and enumerators come after it.
+static uint32_t BuildModule(FTestTypeSource &OutSource, const std::wstring &InPrefix, uint32_t InUdtCount)
+{
+	for (uint32_t k = 0; k < InUdtCount; k++)
+	{
+		OutSource.AddUdt(InPrefix + std::to_wstring(k + 1), 24);
+	} // end for k
+	for (uint32_t k = 0; k < InUdtCount; k++)
+	{
+		OutSource.AddPointer((k + 1) % InUdtCount + 1, 8);
+	} // end for k
+
+	const uint32_t IntId = OutSource.AddBaseType(btInt, 4);
+	const uint32_t DwordId = OutSource.AddTypedef(L"DWORD", OutSource.AddBaseType(btULong, 4));
+	const uint32_t EnumId = OutSource.AddEnum(L"EState", btInt, 4);
+	OutSource.AddEnumerator(EnumId, L"Idle", 0);
+	OutSource.AddEnumerator(EnumId, L"Busy", 1);
+	for (uint32_t k = 1; k <= InUdtCount; k++)
+	{
+		OutSource.AddMember(k, L"Id", IntId, 0);
+		OutSource.AddMember(k, L"pNext", InUdtCount + k, 8);
+		OutSource.AddMember(k, L"State", EnumId, 16);
+		OutSource.AddMember(k, L"Flags", DwordId, 20);
+	} // end for k
+	return EnumId;
+}
+
+static std::wstring FormatValue(const FSymTypeInfo *InType, const void *InValue)
+{
+	FFormatBuffer Text;
+	FSymExpandBudget Budget(1);
+	InType->FormatValue((void*)InValue, Budget, Text);
+	return Text.GetText();
+}
+
+static bool HasMember(const FSymTypeInfo *InType, const wchar_t *InName, uint32_t InOffset, const std::wstring &InTypeName)
+{
+	uint32_t Offset = 0;
+	const FSymTypeInfo *pMember = InType->FindMember(FSymTypeInfoHelper::GetNamePool().Intern(InName), Offset);
+	return pMember && Offset == InOffset && pMember->TypeName() == InTypeName;
+}
+
+static void TestModules()
+{
+	using namespace NSTypeArenaTest;
+
+	const uint32_t Udts = 1000;
+	FTestTypeSource SourceA, SourceB;
+	const uint32_t LastTypeId = BuildModule(SourceA, L"FNodeA", Udts);
+	BuildModule(SourceB, L"FNodeB", Udts);
+
+	FSymTypeInfoHelper::Initialize();
+	FSymTypeInfoHelper::RegisterTypeSource(kModuleBaseA, &SourceA);
+	FSymTypeInfoHelper::RegisterTypeSource(kModuleBaseB, &SourceB);
+	const uint64_t KeyA = FSymTypeInfoHelper::GetTypeSourceKey(kModuleBaseA);
+	const uint64_t KeyB = FSymTypeInfoHelper::GetTypeSourceKey(kModuleBaseB);
+
+	// the same ids in both modules, built in turns
+	std::vector<FSymTypeInfo*> TypesA(LastTypeId + 1), TypesB(LastTypeId + 1);
+	uint32_t Built = 0;
+	for (uint32_t Id = 1; Id < TypesA.size(); Id++)
+	{
+		TypesA[Id] = FSymTypeInfoHelper::BuildSymTypeInfo(NULL, KeyA, Id);
+		TypesB[Id] = FSymTypeInfoHelper::BuildSymTypeInfo(NULL, KeyB, Id);
+		Built += TypesA[Id] && TypesB[Id] && TypesA[Id] != TypesB[Id] ? 1 : 0;
+	} // end for Id
+	TEST_CHECK(Built == LastTypeId);
+	TEST_CHECK(TypesA[7]->GetKind() == stkComplex && TypesA[7]->TypeName() == L"FNodeA7" && TypesB[7]->TypeName() == L"FNodeB7");
+	TEST_CHECK(TypesA[Udts + 7]->GetKind() == stkPointer && TypesA[Udts + 7]->GetLength() == 8 && TypesA[Udts + 7]->TypeName() == L"FNodeA8*");
+	TEST_CHECK(HasMember(TypesA[7], L"pNext", 8, L"FNodeA8*") && HasMember(TypesB[Udts], L"pNext", 8, L"FNodeB1*"));
+	TEST_CHECK(HasMember(TypesA[7], L"State", 16, L"EState") && HasMember(TypesA[7], L"Flags", 20, L"DWORD"));
+
+	// cached, no query
+	const uint64_t QueriesA = SourceA.QueryCount, QueriesB = SourceB.QueryCount;
+	uint32_t Same = 0;
+	for (uint32_t Id = 1; Id < TypesA.size(); Id++)
+	{
+		Same += FSymTypeInfoHelper::BuildSymTypeInfo(NULL, KeyA, Id) == TypesA[Id] && FSymTypeInfoHelper::BuildSymTypeInfo(NULL, KeyB, Id) == TypesB[Id] ? 1 : 0;
+	} // end for Id
+	TEST_CHECK(Same == LastTypeId);
+	TEST_CHECK(SourceA.QueryCount == QueriesA && SourceB.QueryCount == QueriesB);
+
+	// { Id, pNext, State, Flags } of the last node
+	const uint8_t Value[24] = { 5, 0, 0, 0, 0, 0, 0, 0, 0x10, 0x32, 0x54, 0x76, 0x98, 0xBA, 0xDC, 0xFE, 1, 0, 0, 0, 7, 0, 0, 0 };
+	TEST_CHECK(FormatValue(TypesB[Udts], Value) == L"{ Id(int): 5, pNext(FNodeB1*): FEDCBA9876543210, State(EState): Busy, Flags(DWORD): 7,  }");
+
+	// unloading A leaves B as it was
+	FSymTypeInfoHelper::UnloadModule(kModuleBaseA);
+	TEST_CHECK(FSymTypeInfoHelper::BuildSymTypeInfo(NULL, KeyB, 7) == TypesB[7] && SourceB.QueryCount == QueriesB);
+	TEST_CHECK(FormatValue(TypesB[Udts], Value) == L"{ Id(int): 5, pNext(FNodeB1*): FEDCBA9876543210, State(EState): Busy, Flags(DWORD): 7,  }");
+
+	// the source went with the module, A loaded again is built again
+	FSymTypeInfo *pUnregistered = FSymTypeInfoHelper::BuildSymTypeInfo(NULL, KeyA, 7);
+	TEST_CHECK(SourceA.QueryCount == QueriesA && pUnregistered && pUnregistered->GetKind() == stkUnknown);
+	FSymTypeInfoHelper::UnloadModule(kModuleBaseA);
+	FSymTypeInfoHelper::RegisterTypeSource(kModuleBaseA, &SourceA);
+	FSymTypeInfo *pReloaded = FSymTypeInfoHelper::BuildSymTypeInfo(NULL, KeyA, 7);
+	TEST_CHECK(SourceA.QueryCount > QueriesA && pReloaded && pReloaded->TypeName() == L"FNodeA7" && HasMember(pReloaded, L"pNext", 8, L"FNodeA8*"));
+
+	FSymTypeInfoHelper::Uninitialize();
+}
+
+static void Benchmark()
+{
+	using namespace NSTypeArenaTest;
+
+	FTestTypeSource Source;
+	const uint32_t TypeCount = BuildModule(Source, L"FType", kModuleTypes / 2);
+	FSymTypeInfoHelper::Initialize();
+	FSymTypeInfoHelper::RegisterTypeSource(kModuleBaseA, &Source);
+	const uint64_t Key = FSymTypeInfoHelper::GetTypeSourceKey(kModuleBaseA);
+
+	FTestTimer BuildTimer;
+	uint32_t Built = 0;
+	for (uint32_t Id = 1; Id <= TypeCount; Id++)
+	{
+		Built += FSymTypeInfoHelper::BuildSymTypeInfo(NULL, Key, Id) ? 1 : 0;
+	} // end for Id
+	const double BuildSeconds = BuildTimer.Seconds();
+	const uint64_t BuildQueries = Source.QueryCount;
+
+	// lookups in a scattered order
+	FTestTimer LookupTimer;
+	uint64_t Sum = 0;
+	for (uint32_t r = 0; r < kLookupRounds; r++)
+	{
+		for (uint32_t k = 0; k < TypeCount; k++)
+		{
+			const uint32_t Id = (uint32_t)((k * 2654435761ull) % TypeCount) + 1;
+			Sum += FSymTypeInfoHelper::BuildSymTypeInfo(NULL, Key, Id) ? 1 : 0;
+		} // end for k
+	} // end for r
+	const double LookupSeconds = LookupTimer.Seconds();
+
+	FTestTimer UnloadTimer;
+	FSymTypeInfoHelper::UnloadModule(kModuleBaseA);
+	const double UnloadSeconds = UnloadTimer.Seconds();
+
+	printf("%u types: built at %.2f M/s, %.1f queries per type, looked up at %.1f M/s, unloaded in %.1f ms\n", TypeCount, TypeCount / BuildSeconds / 1e6,
+		(double)BuildQueries / TypeCount, (double)TypeCount * kLookupRounds / LookupSeconds / 1e6, UnloadSeconds * 1e3);
+	TEST_CHECK(Built == TypeCount && Sum == (uint64_t)TypeCount * kLookupRounds);
+	TEST_CHECK(Source.QueryCount == BuildQueries);
+
+	FSymTypeInfoHelper::Uninitialize();
+}
+
+int main(int, char *[])
+{
+	TestModules();
+	Benchmark();
+	return appTestResult("Test_TypeArena");
+}
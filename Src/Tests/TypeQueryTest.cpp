@@ -0,0 +1,196 @@
+// \brief
+//		the batched attribute queries of type building, over types served by FTestTypeSource. a struct
+//		of 500 members, a fifth of them methods, with an enum of 500 values must take the same handful of
+//		single queries and two batches as a struct of 10 members. with batches failing the way they do on
+//		older dbghelp versions the ids are asked one at a time and the types come out the same. then the
+//		calls and the time per type are printed, batched and one at a time.
+//
+// cmd> Test_TypeQuery
+//
+
+#include "WinDebugger/WinVariableTypeHelper.h"
+#include "TestTypeSource.h"
+#include "TestHelper.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+
+namespace NSTypeQueryTest
+{
+	const uint64_t kModuleBase      = 0x10000000;
+	const uint32_t kBenchmarkTypes  = 200;
+}
+
+struct FTestModule
+{
+	FTestTypeSource		Source;
+	std::vector<uint32_t>	UdtIds;
+	uint32_t			FunctionTypeId;
+	uint32_t			MemberCount;	// data members of each UDT
+};
+
+// InUdtCount structs FBig<k> of InChildCount children: every fifth a method, every seventh data member an
+// EBig of InChildCount values, the others ints. and a function type int(int, EBig).
+static void BuildModule(FTestModule &OutModule, uint32_t InUdtCount, uint32_t InChildCount)
+{
+	FTestTypeSource &Source = OutModule.Source;
+	const uint32_t IntId = Source.AddBaseType(btInt, 4);
+	const uint32_t EnumId = Source.AddEnum(L"EBig", btInt, 4);
+	for (uint32_t k = 0; k < InChildCount; k++)
+	{
+		Source.AddEnumerator(EnumId, L"V" + std::to_wstring(k), (int32_t)k);
+	} // end for k
+	OutModule.FunctionTypeId = Source.AddFunctionType(IntId);
+	Source.AddArgument(OutModule.FunctionTypeId, IntId);
+	Source.AddArgument(OutModule.FunctionTypeId, EnumId);
+
+	for (uint32_t u = 0; u < InUdtCount; u++)
+	{
+		const uint32_t UdtId = Source.AddUdt(L"FBig" + std::to_wstring(u), InChildCount * 4);
+		OutModule.UdtIds.push_back(UdtId);
+		OutModule.MemberCount = 0;
+		for (uint32_t k = 0; k < InChildCount; k++)
+		{
+			if (k % 5 == 4)
+			{
+				Source.AddMethod(UdtId, L"Method" + std::to_wstring(k), OutModule.FunctionTypeId);
+				continue;
+			}
+			Source.AddMember(UdtId, L"m" + std::to_wstring(k), k % 7 == 0 ? EnumId : IntId, k * 4);
+			OutModule.MemberCount++;
+		} // end for k
+	} // end for u
+}
+
+// built and formatted, so that the members and the member types are queried
+static std::wstring BuildAndFormat(uint64_t InKey, uint32_t InTypeId, uint32_t InLength)
+{
+	FSymTypeInfo *pType = FSymTypeInfoHelper::BuildSymTypeInfo(NULL, InKey, InTypeId);
+	if (!pType)
+	{
+		return std::wstring();
+	}
+	std::vector<int32_t> Value(InLength / 4 + 1);
+	for (size_t k = 0; k < Value.size(); k++)
+	{
+		Value[k] = (int32_t)(k * 3);
+	} // end for k
+	FFormatBuffer Text;
+	FSymExpandBudget Budget(4, 1 << 20);
+	pType->FormatValue(&Value[0], Budget, Text);
+	return pType->TypeName() + L" = " + Text.GetText();
+}
+
+struct FQueryCount
+{
+	uint64_t	Queries;
+	uint64_t	Batches;
+	uint64_t	Types;
+	std::wstring	Text;
+};
+
+static FQueryCount BuildFirstUdt(uint32_t InChildCount, bool bInFailBatches)
+{
+	using namespace NSTypeQueryTest;
+
+	FTestModule Module;
+	BuildModule(Module, 1, InChildCount);
+	Module.Source.bFailBatches = bInFailBatches;
+
+	FSymTypeInfoHelper::Initialize();
+	FSymTypeInfoHelper::RegisterTypeSource(kModuleBase, &Module.Source);
+	const FSymTypeStats Before = FSymTypeInfoHelper::GetStats();
+	FQueryCount Count;
+	Count.Text = BuildAndFormat(FSymTypeInfoHelper::GetTypeSourceKey(kModuleBase), Module.UdtIds[0], InChildCount * 4);
+	const FSymTypeStats &After = FSymTypeInfoHelper::GetStats();
+	Count.Queries = After.QueryCount - Before.QueryCount;
+	Count.Batches = After.BatchCount - Before.BatchCount;
+	Count.Types = After.TypeCount - Before.TypeCount;
+
+	// the helper counts what reached the source
+	TEST_CHECK(Module.Source.QueryCount == Count.Queries && Module.Source.BatchCount == Count.Batches);
+	FSymTypeInfoHelper::Uninitialize();
+	return Count;
+}
+
+static void TestBatches()
+{
+	// FBig0, int and EBig
+	const FQueryCount Small = BuildFirstUdt(10, false);
+	const FQueryCount Large = BuildFirstUdt(500, false);
+	printf("10 children: %llu queries, %llu batches; 500 children: %llu queries, %llu batches\n", (unsigned long long)Small.Queries,
+		(unsigned long long)Small.Batches, (unsigned long long)Large.Queries, (unsigned long long)Large.Batches);
+	TEST_CHECK(Large.Types == 3 && Large.Batches == 2 && Large.Queries == Small.Queries && Large.Queries <= 16);
+
+	const std::wstring &Text = Large.Text;
+	TEST_CHECK(Text.compare(0, 40, L"FBig0 = { m0(EBig): V0, m1(int): 3, m2(i") == 0);
+	TEST_CHECK(Text.find(L"m7(EBig): V21, ") != std::wstring::npos && Text.find(L"m498(int): 1494, ") != std::wstring::npos);
+	TEST_CHECK(Text.find(L"Method") == std::wstring::npos);
+
+	// older dbghelp, the same types from single queries
+	const FQueryCount Fallback = BuildFirstUdt(500, true);
+	TEST_CHECK(Fallback.Text == Large.Text && Fallback.Batches == 2);
+	TEST_CHECK(Fallback.Queries >= Large.Queries + 500 * 4 + 500 * 2);
+}
+
+static void TestFunctionType()
+{
+	using namespace NSTypeQueryTest;
+
+	FTestModule Module;
+	BuildModule(Module, 1, 10);
+	FSymTypeInfoHelper::Initialize();
+	FSymTypeInfoHelper::RegisterTypeSource(kModuleBase, &Module.Source);
+	const FSymTypeStats Before = FSymTypeInfoHelper::GetStats();
+	FSymTypeInfo *pFunction = FSymTypeInfoHelper::BuildSymTypeInfo(NULL, FSymTypeInfoHelper::GetTypeSourceKey(kModuleBase), Module.FunctionTypeId);
+	TEST_CHECK(pFunction && pFunction->GetKind() == stkFunction && pFunction->TypeName() == L"int(int, EBig)");
+	TEST_CHECK(FSymTypeInfoHelper::GetStats().BatchCount - Before.BatchCount == 2);
+	FSymTypeInfoHelper::Uninitialize();
+}
+
+static void Benchmark(bool bInFailBatches)
+{
+	using namespace NSTypeQueryTest;
+
+	FTestModule Module;
+	BuildModule(Module, kBenchmarkTypes, 500);
+	Module.Source.bFailBatches = bInFailBatches;
+	FSymTypeInfoHelper::Initialize();
+	FSymTypeInfoHelper::RegisterTypeSource(kModuleBase, &Module.Source);
+	const uint64_t Key = FSymTypeInfoHelper::GetTypeSourceKey(kModuleBase);
+
+	// a member that is not there, all of them are queried and none of their types
+	const uint32_t MissingId = FSymTypeInfoHelper::GetNamePool().Intern(L"Missing");
+	const FSymTypeStats Before = FSymTypeInfoHelper::GetStats();
+	uint32_t Found = 0;
+	FTestTimer Timer;
+	for (size_t k = 0; k < Module.UdtIds.size(); k++)
+	{
+		FSymTypeInfo *pType = FSymTypeInfoHelper::BuildSymTypeInfo(NULL, Key, Module.UdtIds[k]);
+		uint32_t Offset = 0;
+		Found += pType && pType->FindMember(MissingId, Offset) ? 1 : 0;
+	} // end for k
+	const double Seconds = Timer.Seconds();
+	const FSymTypeStats &After = FSymTypeInfoHelper::GetStats();
+
+	printf("%s: %u structs of %u members, %.1f queries and %.1f batches per type, %.1f us per type\n", bInFailBatches ? "one at a time" : "batched",
+		kBenchmarkTypes, Module.MemberCount, (double)(After.QueryCount - Before.QueryCount) / kBenchmarkTypes,
+		(double)(After.BatchCount - Before.BatchCount) / kBenchmarkTypes, Seconds / kBenchmarkTypes * 1e6);
+	TEST_CHECK(Found == 0 && After.TypeCount - Before.TypeCount == kBenchmarkTypes && After.BatchCount - Before.BatchCount == kBenchmarkTypes);
+	if (!bInFailBatches)
+	{
+		TEST_CHECK(After.QueryCount - Before.QueryCount == kBenchmarkTypes * 5);
+	}
+	FSymTypeInfoHelper::Uninitialize();
+}
+
+int main(int, char *[])
+{
+	TestBatches();
+	TestFunctionType();
+	Benchmark(false);
+	Benchmark(true);
+	return appTestResult("Test_TypeQuery");
+}
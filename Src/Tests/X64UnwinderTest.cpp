@@ -0,0 +1,572 @@
+// \brief
+//		FX64Unwinder checked against Data/Tests/unwind_x64.dll, portable. the stacks captured at each
+//		instruction of its Entry (see make_fixtures.sh) are unwound, the caller's rip, rsp and
+//		nonvolatile registers and the whole list of frames must match the captured ones.
+//		then the prolog of every function of the image and of the other images given is run on a
+//		simulated stack up to each of its offsets and unwound, and epilogs "add rsp, N; pop reg; ret"
+//		and tail calls "add rsp, N; jmp" are unwound from each of their instructions.
+//
+// cmd> Test_X64Unwinder [fixture dir] [image.dll ...]
+//
+
+#include "WinDebugger/WinPeImage.h"
+#include "WinDebugger/WinRemoteMemory.h"
+#include "WinDebugger/WinX64Unwinder.h"
+#include "TestHelper.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+
+namespace NSUnwinderTest
+{
+	const uint64_t kImageBase     = 0x140000000ull;
+	const uint64_t kStackBase     = 0x7F0000;
+	const uint32_t kStackSize     = 0x10000;
+	// rsp of the caller, with room above it for the callee's home space
+	const uint64_t kCallerRsp     = kStackBase + kStackSize - 0x100;
+	const uint64_t kReturnAddress = kImageBase + 0x1000;
+
+	// unwind operations, see WinX64Unwinder.cpp
+	const uint8_t UWOP_PUSH_NONVOL       = 0;
+	const uint8_t UWOP_ALLOC_LARGE       = 1;
+	const uint8_t UWOP_ALLOC_SMALL       = 2;
+	const uint8_t UWOP_SET_FPREG         = 3;
+	const uint8_t UWOP_SAVE_NONVOL       = 4;
+	const uint8_t UWOP_SAVE_NONVOL_FAR   = 5;
+	const uint8_t UWOP_PUSH_MACHFRAME    = 10;
+
+	// chained records followed for one function
+	const uint32_t kMaxChainDepth = 8;
+
+	// frames compared per captured stack
+	const uint32_t kMaxFrames = 32;
+}
+
+static const X64RegisterEnum sNonvolatileRegisters[] = { x64Rbx, x64Rbp, x64Rsi, x64Rdi, x64R12, x64R13, x64R14, x64R15 };
+
+static inline uint16_t ReadU16(const uint8_t *InPtr)
+{
+	uint16_t Value;
+	memcpy(&Value, InPtr, sizeof(Value));
+	return Value;
+}
+
+static inline uint32_t ReadU32(const uint8_t *InPtr)
+{
+	uint32_t Value;
+	memcpy(&Value, InPtr, sizeof(Value));
+	return Value;
+}
+
+// the image in its loaded layout, and a stack the test writes
+class FTestMemory : public FRemoteMemory
+{
+public:
+	FTestMemory() : ImageBase(NSUnwinderTest::kImageBase), StackBase(NSUnwinderTest::kStackBase), Stack(NSUnwinderTest::kStackSize, 0) {}
+
+	virtual bool ReadMemory(uint64_t InAddress, void *OutBuffer, size_t InBytes) override
+	{
+		if (InAddress >= ImageBase && InAddress + InBytes <= ImageBase + Image.size())
+		{
+			memcpy(OutBuffer, &Image[(size_t)(InAddress - ImageBase)], InBytes);
+			return true;
+		}
+		if (InAddress >= StackBase && InAddress + InBytes <= StackBase + Stack.size())
+		{
+			memcpy(OutBuffer, &Stack[(size_t)(InAddress - StackBase)], InBytes);
+			return true;
+		}
+		return false;
+	}
+
+	bool WriteStack(uint64_t InAddress, uint64_t InValue)
+	{
+		if (InAddress < StackBase || InAddress + 8 > StackBase + Stack.size())
+		{
+			return false;
+		}
+		memcpy(&Stack[(size_t)(InAddress - StackBase)], &InValue, 8);
+		return true;
+	}
+
+	void ClearStack(uint8_t InFill)
+	{
+		memset(&Stack[0], InFill, Stack.size());
+	}
+
+	uint64_t				ImageBase;
+	std::vector<uint8_t>	Image;
+	uint64_t				StackBase;
+	std::vector<uint8_t>	Stack;
+};
+
+struct FTestCount
+{
+	uint32_t	Passed;
+	uint32_t	Total;
+};
+
+static bool LoadImage(const std::string &InFilename, FPeImage &OutImage, FTestMemory &OutMemory)
+{
+	if (!OutImage.OpenFile(appTestWidePath(InFilename)) || !OutImage.Is64Bit())
+	{
+		return false;
+	}
+
+	OutMemory.Image.assign(OutImage.GetSizeOfImage(), 0);
+	const std::vector<FPeSection> &Sections = OutImage.GetSections();
+	for (size_t k = 0; k < Sections.size(); k++)
+	{
+		const FPeSection &Section = Sections[k];
+		const uint32_t Bytes = (Section.VirtualSize && Section.VirtualSize < Section.RawSize) ? Section.VirtualSize : Section.RawSize;
+		const uint8_t *Data = OutImage.RvaToData(Section.VirtualAddress, Bytes);
+		if (Data && (uint64_t)Section.VirtualAddress + Bytes <= OutMemory.Image.size())
+		{
+			memcpy(&OutMemory.Image[Section.VirtualAddress], Data, Bytes);
+		}
+	} // end for k
+	return true;
+}
+
+// a function, then the ones it is chained to. false for chains through an odd unwind info address.
+static bool GetFunctionChain(const FPeImage &InImage, const FPeRuntimeFunction &InFunction, std::vector<FPeRuntimeFunction> &OutChain)
+{
+	OutChain.assign(1, InFunction);
+	for (uint32_t Depth = 0; Depth < NSUnwinderTest::kMaxChainDepth; Depth++)
+	{
+		FPeUnwindInfo Info;
+		if ((OutChain.back().UnwindInfoRva & 1) || !InImage.GetUnwindInfo(OutChain.back().UnwindInfoRva, Info))
+		{
+			return false;
+		}
+		if (!(Info.Flags & NSPeImage::UNW_FLAG_CHAININFO))
+		{
+			return true;
+		}
+		OutChain.push_back(Info.Chained);
+	} // end for Depth
+	return false;
+}
+
+// slots an unwind code takes, the code included
+static uint32_t GetCodeSlots(uint8_t InOp, uint8_t InOpInfo)
+{
+	switch (InOp)
+	{
+	case 1:		// alloc large
+		return InOpInfo ? 3 : 2;
+	case 4:		// save nonvol
+	case 6:		// epilog
+	case 8:		// save xmm128
+		return 2;
+	case 5:		// save nonvol far
+	case 7:		// spare
+	case 9:		// save xmm128 far
+		return 3;
+	default:
+		return 1;
+	}
+}
+
+// run the prolog codes of a function up to InPrologOffset, or all of them, on the stack of InOutFrame.
+// the nonvolatile registers are changed once they are saved, the unwind has to read them back.
+// false if the function has a machine frame or the stack is too small.
+static bool RunProlog(const FPeImage &InImage, const FPeRuntimeFunction &InFunction, uint32_t InPrologOffset, FTestMemory &InMemory, FX64Frame &InOutFrame)
+{
+	using namespace NSUnwinderTest;
+
+	uint64_t *Registers = InOutFrame.Registers;
+	FPeUnwindInfo Info;
+	if (!InImage.GetUnwindInfo(InFunction.UnwindInfoRva, Info))
+	{
+		return false;
+	}
+
+	// codes are stored last executed first
+	std::vector<uint32_t> Slots;
+	for (uint32_t Slot = 0; Slot < Info.CodeCount; Slot += GetCodeSlots(Info.Codes[Slot * 2 + 1] & 0xF, Info.Codes[Slot * 2 + 1] >> 4))
+	{
+		Slots.push_back(Slot);
+	} // end for Slot
+
+	struct FSave
+	{
+		uint32_t	Register;
+		uint32_t	Offset;
+	};
+	std::vector<FSave> Saves;
+	uint64_t FrameBase = 0;
+	bool bFrameSet = false;
+	for (size_t k = Slots.size(); k-- > 0; )
+	{
+		const uint8_t *Code = Info.Codes + Slots[k] * 2;
+		const uint8_t Op = Code[1] & 0xF, OpInfo = Code[1] >> 4;
+		if (Code[0] > InPrologOffset)
+		{
+			continue;
+		}
+
+		switch (Op)
+		{
+		case UWOP_PUSH_NONVOL:
+			Registers[x64Rsp] -= 8;
+			if (!InMemory.WriteStack(Registers[x64Rsp], Registers[OpInfo]))
+			{
+				return false;
+			}
+			Registers[OpInfo] ^= 0xABCDEF;
+			break;
+		case UWOP_ALLOC_LARGE:
+			Registers[x64Rsp] -= OpInfo ? ReadU32(Code + 2) : ReadU16(Code + 2) * 8u;
+			break;
+		case UWOP_ALLOC_SMALL:
+			Registers[x64Rsp] -= OpInfo * 8 + 8;
+			break;
+		case UWOP_SET_FPREG:
+			FrameBase = Registers[x64Rsp];
+			Registers[Info.FrameRegister] = Registers[x64Rsp] + Info.FrameOffset * 16;
+			bFrameSet = true;
+			break;
+		case UWOP_SAVE_NONVOL:
+		case UWOP_SAVE_NONVOL_FAR:
+			{
+				FSave Save = { OpInfo, Op == UWOP_SAVE_NONVOL ? ReadU16(Code + 2) * 8u : ReadU32(Code + 2) };
+				Saves.push_back(Save);
+			}
+			break;
+		case UWOP_PUSH_MACHFRAME:
+			return false;
+		default:
+			break;
+		}
+	} // end for k
+
+	// saves are relative to the frame the prolog ends with
+	const uint64_t SaveBase = bFrameSet ? FrameBase : Registers[x64Rsp];
+	for (size_t k = 0; k < Saves.size(); k++)
+	{
+		if (!InMemory.WriteStack(SaveBase + Saves[k].Offset, Registers[Saves[k].Register]))
+		{
+			return false;
+		}
+		Registers[Saves[k].Register] ^= 0x5A5A;
+	} // end for k
+	return Registers[x64Rsp] >= kStackBase;
+}
+
+static bool IsCallerFrame(const FX64Frame &InFrame, const FX64Frame &InCaller)
+{
+	if (InFrame.Rip != InCaller.Rip || InFrame.Registers[x64Rsp] != InCaller.Registers[x64Rsp])
+	{
+		return false;
+	}
+	for (size_t k = 0; k < sizeof(sNonvolatileRegisters) / sizeof(sNonvolatileRegisters[0]); k++)
+	{
+		if (InFrame.Registers[sNonvolatileRegisters[k]] != InCaller.Registers[sNonvolatileRegisters[k]])
+		{
+			return false;
+		}
+	} // end for k
+	return true;
+}
+
+// the start of an epilog right after the prolog is read as one, the way the unwinder must
+static bool LooksLikeEpilog(const uint8_t *InCode)
+{
+	return InCode[0] == 0xC3 || (InCode[0] >= 0x58 && InCode[0] <= 0x5F) || (InCode[0] & 0xF0) == 0x40;
+}
+
+// every offset of every prolog, the functions of a chain run the prologs of the ones they are chained to first
+static void TestPrologs(const FPeImage &InImage, FTestMemory &InMemory, const FX64Unwinder &InUnwinder, FTestCount &OutCount)
+{
+	using namespace NSUnwinderTest;
+
+	std::vector<FPeRuntimeFunction> Chain;
+	for (uint32_t k = 0; k < InImage.GetRuntimeFunctionCount(); k++)
+	{
+		FPeRuntimeFunction Function;
+		FPeUnwindInfo Info;
+		if (!InImage.GetRuntimeFunction(k, Function) || !GetFunctionChain(InImage, Function, Chain) || !InImage.GetUnwindInfo(Function.UnwindInfoRva, Info))
+		{
+			continue;
+		}
+
+		for (uint32_t PrologOffset = 0; PrologOffset <= Info.PrologSize && Function.BeginRva + PrologOffset < Function.EndRva; PrologOffset++)
+		{
+			if (PrologOffset == Info.PrologSize && LooksLikeEpilog(&InMemory.Image[Function.BeginRva + PrologOffset]))
+			{
+				continue;
+			}
+
+			FX64Frame Caller;
+			for (uint32_t r = 0; r < x64RegisterCount; r++)
+			{
+				Caller.Registers[r] = 0x1111000000000000ull * (r + 1) + k;
+			} // end for r
+			Caller.Registers[x64Rsp] = kCallerRsp;
+			Caller.Rip = kReturnAddress;
+
+			InMemory.ClearStack(0xCC);
+			FX64Frame Frame = Caller;
+			Frame.Registers[x64Rsp] -= 8;
+			InMemory.WriteStack(Frame.Registers[x64Rsp], kReturnAddress);
+
+			bool bRan = true;
+			for (size_t c = Chain.size(); bRan && c-- > 0; )
+			{
+				bRan = RunProlog(InImage, Chain[c], c == 0 ? PrologOffset : 0xFF, InMemory, Frame);
+			} // end for c
+			if (!bRan)
+			{
+				break;
+			}
+
+			Frame.Rip = kImageBase + Function.BeginRva + PrologOffset;
+			OutCount.Total++;
+			if (InUnwinder.UnwindFrame(InMemory, Frame) && IsCallerFrame(Frame, Caller))
+			{
+				OutCount.Passed++;
+			}
+			else
+			{
+				printf("  prolog: %08x+%u\n", Function.BeginRva, PrologOffset);
+			}
+		} // end for PrologOffset
+	} // end for k
+}
+
+// functions with a "push reg; sub rsp, N" prolog, from each instruction of "add rsp, N; pop reg; ret".
+// functions with a "sub rsp, N" prolog, from each instruction of "add rsp, N; jmp" out of the function.
+static void TestEpilogs(const FPeImage &InImage, FTestMemory &InMemory, const FX64Unwinder &InUnwinder, FTestCount &OutEpilogs, FTestCount &OutTailCalls)
+{
+	using namespace NSUnwinderTest;
+
+	const std::vector<uint8_t> &Image = InMemory.Image;
+	for (uint32_t k = 0; k < InImage.GetRuntimeFunctionCount(); k++)
+	{
+		FPeRuntimeFunction Function;
+		FPeUnwindInfo Info;
+		if (!InImage.GetRuntimeFunction(k, Function) || (Function.UnwindInfoRva & 1) || !InImage.GetUnwindInfo(Function.UnwindInfoRva, Info)
+			|| Info.Version != 1 || Info.Flags || Info.FrameRegister)
+		{
+			continue;
+		}
+
+		// push reg; sub rsp, N: alloc small then push nonvol, last executed first
+		const bool bPushed = Info.CodeCount == 2 && (Info.Codes[1] & 0xF) == UWOP_ALLOC_SMALL && (Info.Codes[3] & 0xF) == UWOP_PUSH_NONVOL && (Info.Codes[3] >> 4) < 8;
+		const bool bAllocOnly = Info.CodeCount == 1 && (Info.Codes[1] & 0xF) == UWOP_ALLOC_SMALL;
+		if (!bPushed && !bAllocOnly)
+		{
+			continue;
+		}
+		const uint32_t Alloc = (Info.Codes[1] >> 4) * 8 + 8;
+		const uint32_t Pushed = bPushed ? Info.Codes[3] >> 4 : 0;
+
+		for (uint32_t Rva = Function.BeginRva + Info.PrologSize; Rva + 9 <= Function.EndRva; Rva++)
+		{
+			const uint8_t *Code = &Image[Rva];
+			if (Code[0] != 0x48 || Code[1] != 0x83 || Code[2] != 0xC4 || Code[3] != Alloc)
+			{
+				continue;
+			}
+
+			std::vector<uint32_t> Offsets;
+			if (bPushed && Code[4] == 0x58 + Pushed && Code[5] == 0xC3)
+			{
+				const uint32_t EpilogOffsets[] = { 0, 4, 5 };
+				Offsets.assign(EpilogOffsets, EpilogOffsets + 3);
+			}
+			else if (bAllocOnly && Code[4] == 0xE9)
+			{
+				const uint32_t Target = Rva + 9 + ReadU32(Code + 5);
+				if (Target >= Function.BeginRva && Target < Function.EndRva)
+				{
+					continue;
+				}
+				const uint32_t TailCallOffsets[] = { 0, 4 };
+				Offsets.assign(TailCallOffsets, TailCallOffsets + 2);
+			}
+			else
+			{
+				continue;
+			}
+
+			FTestCount &Count = bPushed ? OutEpilogs : OutTailCalls;
+			for (size_t o = 0; o < Offsets.size(); o++)
+			{
+				// the stack as it is at the instruction: the locals, the pushed register, the return address
+				const uint64_t Top = kCallerRsp - 8 - (bPushed ? 8 : 0) - Alloc;
+				const uint64_t PushedSlot = kCallerRsp - 16;
+				InMemory.ClearStack(0);
+				InMemory.WriteStack(kCallerRsp - 8, kReturnAddress);
+				if (bPushed)
+				{
+					InMemory.WriteStack(PushedSlot, 0x77);
+				}
+
+				FX64Frame Frame;
+				memset(&Frame, 0, sizeof(Frame));
+				Frame.Rip = kImageBase + Rva + Offsets[o];
+				Frame.Registers[x64Rsp] = Offsets[o] == 0 ? Top : Offsets[o] == 4 ? Top + Alloc : kCallerRsp - 8;
+				Frame.Registers[Pushed] = Offsets[o] == 5 ? 0x77 : 1;
+
+				Count.Total++;
+				if (InUnwinder.UnwindFrame(InMemory, Frame) && Frame.Rip == kReturnAddress && Frame.Registers[x64Rsp] == kCallerRsp
+					&& (!bPushed || Frame.Registers[Pushed] == 0x77))
+				{
+					Count.Passed++;
+				}
+				else
+				{
+					printf("  %s: %08x+%u\n", bPushed ? "epilog" : "tail call", Rva, Offsets[o]);
+				}
+			} // end for o
+			break;
+		} // end for Rva
+	} // end for k
+}
+
+// the hex numbers of a line after its keyword
+static std::vector<uint64_t> ParseNumbers(const char *InLine)
+{
+	std::vector<uint64_t> Numbers;
+	const char *Cursor = strchr(InLine, ' ');
+	while (Cursor && *Cursor)
+	{
+		char *End;
+		const uint64_t Number = strtoull(Cursor, &End, 16);
+		if (End == Cursor)
+		{
+			break;
+		}
+		Numbers.push_back(Number);
+		Cursor = End;
+	} // end while
+	return Numbers;
+}
+
+// the samples of unwind_x64_stacks.txt: "sample rip", "regs" in unwind code order, "caller rip rsp" and
+// its nonvolatile registers, "frames" from rip outwards, "memory address qword..." for the written stack
+static void TestCapturedStacks(const std::string &InDataDir)
+{
+	FPeImage Image;
+	FTestMemory Memory;
+	FILE *File = fopen((InDataDir + "unwind_x64_stacks.txt").c_str(), "r");
+	if (!TEST_CHECK(LoadImage(InDataDir + "unwind_x64.dll", Image, Memory)) || !TEST_CHECK(File))
+	{
+		if (File)
+		{
+			fclose(File);
+		}
+		return;
+	}
+	Memory.ImageBase = Image.GetImageBase();
+
+	FX64Unwinder Unwinder;
+	Unwinder.AddModule(Memory.ImageBase, (uint32_t)Memory.Image.size(), Image);
+
+	FX64Frame Frame, Caller;
+	std::vector<uint64_t> Frames;
+	uint32_t Samples = 0;
+	std::vector<char> Line(1 << 16);
+	while (fgets(&Line[0], (int)Line.size(), File))
+	{
+		const std::vector<uint64_t> Numbers = ParseNumbers(&Line[0]);
+		if (!strncmp(&Line[0], "stack ", 6) && Numbers.size() == 2)
+		{
+			Memory.StackBase = Numbers[0];
+			Memory.Stack.assign((size_t)Numbers[1], 0);
+		}
+		else if (!strncmp(&Line[0], "sample ", 7) && Numbers.size() == 1)
+		{
+			memset(&Frame, 0, sizeof(Frame));
+			memset(&Caller, 0, sizeof(Caller));
+			Frame.Rip = Numbers[0];
+			Memory.ClearStack(0xCC);
+		}
+		else if (!strncmp(&Line[0], "regs ", 5) && Numbers.size() == x64RegisterCount)
+		{
+			memcpy(Frame.Registers, &Numbers[0], sizeof(Frame.Registers));
+		}
+		else if (!strncmp(&Line[0], "caller ", 7) && Numbers.size() == 10)
+		{
+			Caller.Rip = Numbers[0];
+			Caller.Registers[x64Rsp] = Numbers[1];
+			for (size_t k = 0; k < sizeof(sNonvolatileRegisters) / sizeof(sNonvolatileRegisters[0]); k++)
+			{
+				Caller.Registers[sNonvolatileRegisters[k]] = Numbers[2 + k];
+			} // end for k
+		}
+		else if (!strncmp(&Line[0], "frames ", 7))
+		{
+			Frames = Numbers;
+		}
+		else if (!strncmp(&Line[0], "memory ", 7) && !Numbers.empty())
+		{
+			for (size_t k = 1; k < Numbers.size(); k++)
+			{
+				Memory.WriteStack(Numbers[0] + (k - 1) * 8, Numbers[k]);
+			} // end for k
+		}
+		else if (!strncmp(&Line[0], "end", 3))
+		{
+			Samples++;
+
+			FX64Frame Unwound = Frame;
+			if (!TEST_CHECK(Unwinder.UnwindFrame(Memory, Unwound) && IsCallerFrame(Unwound, Caller)))
+			{
+				printf("  sample %llx: caller %llx\n", (unsigned long long)Frame.Rip, (unsigned long long)Unwound.Rip);
+			}
+
+			uint64_t Addresses[NSUnwinderTest::kMaxFrames];
+			const uint32_t Depth = Unwinder.CaptureStack(Memory, Frame, Addresses, NSUnwinderTest::kMaxFrames);
+			if (!TEST_CHECK(std::vector<uint64_t>(Addresses, Addresses + Depth) == Frames))
+			{
+				printf("  sample %llx: %u frames captured, %u expected\n", (unsigned long long)Frame.Rip, Depth, (uint32_t)Frames.size());
+			}
+		}
+	} // end while
+	fclose(File);
+
+	printf("unwind_x64_stacks.txt: %u samples\n", Samples);
+	TEST_CHECK(Samples > 0);
+}
+
+static void TestImage(const std::string &InFilename)
+{
+	FPeImage Image;
+	FTestMemory Memory;
+	if (!TEST_CHECK(LoadImage(InFilename, Image, Memory)))
+	{
+		printf("%s: not an x64 image\n", InFilename.c_str());
+		return;
+	}
+
+	FX64Unwinder Unwinder;
+	Unwinder.AddModule(NSUnwinderTest::kImageBase, (uint32_t)Memory.Image.size(), Image);
+
+	FTestCount Prologs = { 0, 0 }, Epilogs = { 0, 0 }, TailCalls = { 0, 0 };
+	TestPrologs(Image, Memory, Unwinder, Prologs);
+	TestEpilogs(Image, Memory, Unwinder, Epilogs, TailCalls);
+
+	printf("%s: %u functions, prolog offsets %u/%u, epilogs %u/%u, tail calls %u/%u\n", InFilename.c_str(), Image.GetRuntimeFunctionCount(),
+		Prologs.Passed, Prologs.Total, Epilogs.Passed, Epilogs.Total, TailCalls.Passed, TailCalls.Total);
+	TEST_CHECK(Prologs.Total && Prologs.Passed == Prologs.Total);
+	TEST_CHECK(Epilogs.Passed == Epilogs.Total && TailCalls.Passed == TailCalls.Total);
+}
+
+int main(int argc, char *argv[])
+{
+	const std::string DataDir = appTestDataDir(argc, argv);
+	TestCapturedStacks(DataDir);
+	TestImage(DataDir + "unwind_x64.dll");
+	for (int k = 2; k < argc; k++)
+	{
+		TestImage(argv[k]);
+	} // end for k
+	return appTestResult("Test_X64Unwinder");
+}
@@ -0,0 +1,296 @@
+// \brief
+//		statistics over large arrays of primitive values.
+//
+
+#include "WinArrayStats.h"
+
+#include <cmath>
+#include <limits>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define ARRAYSTATS_USE_SSE2	1
+#else
+#define ARRAYSTATS_USE_SSE2	0
+#endif
+
+
+namespace NSArrayStats
+{
+	// set bits of a 4-bit movemask
+	static const uint32_t kMaskBits[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+}
+
+// what a kernel found in one chunk
+struct FChunkStats
+{
+	uint64_t	NaNCount;
+	uint64_t	ZeroCount;
+	double		FloatMin;
+	double		FloatMax;
+	double		FloatSum;
+};
+
+FArrayStats::FArrayStats(CPrimitiveTypeEnum InType)
+	: Count(0)
+	, NaNCount(0)
+	, ZeroCount(0)
+	, FloatMin(std::numeric_limits<double>::infinity())
+	, FloatMax(-std::numeric_limits<double>::infinity())
+	, FloatSum(0)
+	, IntMin(0)
+	, IntMax(0)
+	, IntSum(0)
+	, Type(InType)
+{
+}
+
+bool FArrayStats::IsSupported(CPrimitiveTypeEnum InType)
+{
+	return InType > cbtVoid && InType < cbtEnd;
+}
+
+double FArrayStats::GetMean() const
+{
+	const uint64_t ValueCount = Count - NaNCount;
+	if (ValueCount == 0)
+	{
+		return 0;
+	}
+	if (IsFloat())
+	{
+		return FloatSum / (double)ValueCount;
+	}
+	return (Type == cbtULongLong ? (double)(uint64_t)IntSum : (double)IntSum) / (double)ValueCount;
+}
+
+// the scalar path, for the integer types without a kernel and for the tail of a chunk
+template <typename T>
+static void AccumulateFloatScalar(const T *pData, size_t InCount, FChunkStats &InOutChunk)
+{
+	for (size_t k = 0; k < InCount; k++)
+	{
+		const T Value = pData[k];
+		if (Value != Value)
+		{
+			InOutChunk.NaNCount++;
+			continue;
+		}
+		InOutChunk.ZeroCount += Value == 0;
+		InOutChunk.FloatMin = Value < InOutChunk.FloatMin ? Value : InOutChunk.FloatMin;
+		InOutChunk.FloatMax = Value > InOutChunk.FloatMax ? Value : InOutChunk.FloatMax;
+		InOutChunk.FloatSum += Value;
+	} // end for k
+}
+
+static void AccumulateFloats(const float *pData, size_t InCount, FChunkStats &InOutChunk)
+{
+	size_t k = 0;
+#if ARRAYSTATS_USE_SSE2
+	// a NaN lane is +inf for the min, -inf for the max and 0 for the sum
+	const __m128 PositiveInf = _mm_set1_ps(std::numeric_limits<float>::infinity());
+	const __m128 NegativeInf = _mm_set1_ps(-std::numeric_limits<float>::infinity());
+	const __m128 Zero = _mm_setzero_ps();
+	__m128 MinValue = PositiveInf;
+	__m128 MaxValue = NegativeInf;
+	__m128d SumLow = _mm_setzero_pd();
+	__m128d SumHigh = _mm_setzero_pd();
+	uint64_t NaNCount = 0, ZeroCount = 0;
+	for (; k + 4 <= InCount; k += 4)
+	{
+		const __m128 Value = _mm_loadu_ps(pData + k);
+		const __m128 NaNMask = _mm_cmpunord_ps(Value, Value);
+		const __m128 Clean = _mm_andnot_ps(NaNMask, Value);
+		MinValue = _mm_min_ps(MinValue, _mm_or_ps(Clean, _mm_and_ps(NaNMask, PositiveInf)));
+		MaxValue = _mm_max_ps(MaxValue, _mm_or_ps(Clean, _mm_and_ps(NaNMask, NegativeInf)));
+		// the sum is kept in double, a float sum of millions of values loses the small ones
+		SumLow = _mm_add_pd(SumLow, _mm_cvtps_pd(Clean));
+		SumHigh = _mm_add_pd(SumHigh, _mm_cvtps_pd(_mm_movehl_ps(Clean, Clean)));
+		NaNCount += NSArrayStats::kMaskBits[_mm_movemask_ps(NaNMask)];
+		ZeroCount += NSArrayStats::kMaskBits[_mm_movemask_ps(_mm_cmpeq_ps(Value, Zero))];
+	} // end for k
+
+	float Mins[4], Maxs[4];
+	double Sums[2];
+	_mm_storeu_ps(Mins, MinValue);
+	_mm_storeu_ps(Maxs, MaxValue);
+	_mm_storeu_pd(Sums, _mm_add_pd(SumLow, SumHigh));
+	for (int Lane = 0; Lane < 4; Lane++)
+	{
+		InOutChunk.FloatMin = Mins[Lane] < InOutChunk.FloatMin ? Mins[Lane] : InOutChunk.FloatMin;
+		InOutChunk.FloatMax = Maxs[Lane] > InOutChunk.FloatMax ? Maxs[Lane] : InOutChunk.FloatMax;
+	} // end for Lane
+	InOutChunk.FloatSum += Sums[0] + Sums[1];
+	InOutChunk.NaNCount += NaNCount;
+	InOutChunk.ZeroCount += ZeroCount;
+#endif
+	AccumulateFloatScalar(pData + k, InCount - k, InOutChunk);
+}
+
+static void AccumulateDoubles(const double *pData, size_t InCount, FChunkStats &InOutChunk)
+{
+	size_t k = 0;
+#if ARRAYSTATS_USE_SSE2
+	const __m128d PositiveInf = _mm_set1_pd(std::numeric_limits<double>::infinity());
+	const __m128d NegativeInf = _mm_set1_pd(-std::numeric_limits<double>::infinity());
+	const __m128d Zero = _mm_setzero_pd();
+	__m128d MinValue = PositiveInf;
+	__m128d MaxValue = NegativeInf;
+	__m128d Sum = _mm_setzero_pd();
+	uint64_t NaNCount = 0, ZeroCount = 0;
+	for (; k + 2 <= InCount; k += 2)
+	{
+		const __m128d Value = _mm_loadu_pd(pData + k);
+		const __m128d NaNMask = _mm_cmpunord_pd(Value, Value);
+		const __m128d Clean = _mm_andnot_pd(NaNMask, Value);
+		MinValue = _mm_min_pd(MinValue, _mm_or_pd(Clean, _mm_and_pd(NaNMask, PositiveInf)));
+		MaxValue = _mm_max_pd(MaxValue, _mm_or_pd(Clean, _mm_and_pd(NaNMask, NegativeInf)));
+		Sum = _mm_add_pd(Sum, Clean);
+		NaNCount += NSArrayStats::kMaskBits[_mm_movemask_pd(NaNMask)];
+		ZeroCount += NSArrayStats::kMaskBits[_mm_movemask_pd(_mm_cmpeq_pd(Value, Zero))];
+	} // end for k
+
+	double Mins[2], Maxs[2], Sums[2];
+	_mm_storeu_pd(Mins, MinValue);
+	_mm_storeu_pd(Maxs, MaxValue);
+	_mm_storeu_pd(Sums, Sum);
+	for (int Lane = 0; Lane < 2; Lane++)
+	{
+		InOutChunk.FloatMin = Mins[Lane] < InOutChunk.FloatMin ? Mins[Lane] : InOutChunk.FloatMin;
+		InOutChunk.FloatMax = Maxs[Lane] > InOutChunk.FloatMax ? Maxs[Lane] : InOutChunk.FloatMax;
+	} // end for Lane
+	InOutChunk.FloatSum += Sums[0] + Sums[1];
+	InOutChunk.NaNCount += NaNCount;
+	InOutChunk.ZeroCount += ZeroCount;
+#endif
+	AccumulateFloatScalar(pData + k, InCount - k, InOutChunk);
+}
+
+// merge the min, max and sum of a chunk, compared as T
+template <typename T>
+static void MergeIntegers(FArrayStats &InOutStats, T InMin, T InMax, int64_t InSum, uint64_t InZeroCount)
+{
+	if (InOutStats.Count == 0 || InMin < (T)InOutStats.IntMin)
+	{
+		InOutStats.IntMin = (int64_t)InMin;
+	}
+	if (InOutStats.Count == 0 || InMax > (T)InOutStats.IntMax)
+	{
+		InOutStats.IntMax = (int64_t)InMax;
+	}
+	InOutStats.IntSum = (int64_t)((uint64_t)InOutStats.IntSum + (uint64_t)InSum);
+	InOutStats.ZeroCount += InZeroCount;
+}
+
+template <typename T>
+static void AccumulateIntegers(const T *pData, size_t InCount, FArrayStats &InOutStats)
+{
+	T Min = pData[0], Max = pData[0];
+	uint64_t Sum = 0, ZeroCount = 0;
+	for (size_t k = 0; k < InCount; k++)
+	{
+		const T Value = pData[k];
+		Min = Value < Min ? Value : Min;
+		Max = Value > Max ? Value : Max;
+		Sum += (uint64_t)(int64_t)Value;
+		ZeroCount += Value == 0;
+	} // end for k
+	MergeIntegers<T>(InOutStats, Min, Max, (int64_t)Sum, ZeroCount);
+}
+
+// int and long, 32 bits on the debuggee
+static void AccumulateInt32s(const int32_t *pData, size_t InCount, FArrayStats &InOutStats)
+{
+	size_t k = 0;
+	int32_t Min = pData[0], Max = pData[0];
+	uint64_t Sum = 0, ZeroCount = 0;
+#if ARRAYSTATS_USE_SSE2
+	// sse2 has no 32-bit min/max, they are a compare and a select
+	const __m128i Zero = _mm_setzero_si128();
+	__m128i MinValue = _mm_set1_epi32(Min);
+	__m128i MaxValue = _mm_set1_epi32(Max);
+	__m128i Sum64 = _mm_setzero_si128();
+	for (; k + 4 <= InCount; k += 4)
+	{
+		const __m128i Value = _mm_loadu_si128((const __m128i *)(pData + k));
+		const __m128i LessMask = _mm_cmpgt_epi32(MinValue, Value);
+		const __m128i GreaterMask = _mm_cmpgt_epi32(Value, MaxValue);
+		MinValue = _mm_or_si128(_mm_and_si128(LessMask, Value), _mm_andnot_si128(LessMask, MinValue));
+		MaxValue = _mm_or_si128(_mm_and_si128(GreaterMask, Value), _mm_andnot_si128(GreaterMask, MaxValue));
+		// sign extend to 64 bits before adding
+		const __m128i Sign = _mm_srai_epi32(Value, 31);
+		Sum64 = _mm_add_epi64(Sum64, _mm_unpacklo_epi32(Value, Sign));
+		Sum64 = _mm_add_epi64(Sum64, _mm_unpackhi_epi32(Value, Sign));
+		ZeroCount += NSArrayStats::kMaskBits[_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(Value, Zero)))];
+	} // end for k
+
+	int32_t Mins[4], Maxs[4];
+	uint64_t Sums[2];
+	_mm_storeu_si128((__m128i *)Mins, MinValue);
+	_mm_storeu_si128((__m128i *)Maxs, MaxValue);
+	_mm_storeu_si128((__m128i *)Sums, Sum64);
+	for (int Lane = 0; Lane < 4; Lane++)
+	{
+		Min = Mins[Lane] < Min ? Mins[Lane] : Min;
+		Max = Maxs[Lane] > Max ? Maxs[Lane] : Max;
+	} // end for Lane
+	Sum = Sums[0] + Sums[1];
+#endif
+	for (; k < InCount; k++)
+	{
+		const int32_t Value = pData[k];
+		Min = Value < Min ? Value : Min;
+		Max = Value > Max ? Value : Max;
+		Sum += (uint64_t)(int64_t)Value;
+		ZeroCount += Value == 0;
+	} // end for k
+	MergeIntegers<int32_t>(InOutStats, Min, Max, (int64_t)Sum, ZeroCount);
+}
+
+void FArrayStats::Accumulate(const void *InData, size_t InCount)
+{
+	if (InCount == 0)
+	{
+		return;
+	}
+
+	if (IsFloat())
+	{
+		FChunkStats Chunk = { 0, 0, FloatMin, FloatMax, 0 };
+		if (Type == cbtFloat)
+		{
+			AccumulateFloats((const float *)InData, InCount, Chunk);
+		}
+		else
+		{
+			AccumulateDoubles((const double *)InData, InCount, Chunk);
+		}
+		NaNCount += Chunk.NaNCount;
+		ZeroCount += Chunk.ZeroCount;
+		FloatMin = Chunk.FloatMin;
+		FloatMax = Chunk.FloatMax;
+		FloatSum += Chunk.FloatSum;
+		Count += InCount;
+		return;
+	}
+
+	// long is 32 bits on the debuggee whatever it is here
+	switch (Type)
+	{
+	case cbtBool:
+	case cbtUChar:		AccumulateIntegers((const uint8_t *)InData, InCount, *this); break;
+	case cbtChar:		AccumulateIntegers((const int8_t *)InData, InCount, *this); break;
+	case cbtWChar:
+	case cbtUShort:		AccumulateIntegers((const uint16_t *)InData, InCount, *this); break;
+	case cbtShort:		AccumulateIntegers((const int16_t *)InData, InCount, *this); break;
+	case cbtInt:
+	case cbtLong:		AccumulateInt32s((const int32_t *)InData, InCount, *this); break;
+	case cbtUInt:
+	case cbtULong:		AccumulateIntegers((const uint32_t *)InData, InCount, *this); break;
+	case cbtLongLong:	AccumulateIntegers((const int64_t *)InData, InCount, *this); break;
+	case cbtULongLong:	AccumulateIntegers((const uint64_t *)InData, InCount, *this); break;
+	default:
+		return;
+	}
+	Count += InCount;
+}
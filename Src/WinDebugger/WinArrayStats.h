@@ -0,0 +1,48 @@
+// \brief
+//		statistics over large arrays of primitive values: min, max, sum, mean, NaN and zero counts.
+//		the values are fed in chunks as they are read from the debuggee, float, double and 32-bit
+//		integers go through SSE2 kernels.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include "WinVariableTypeHelper.h"
+
+
+class FArrayStats
+{
+public:
+	explicit FArrayStats(CPrimitiveTypeEnum InType);
+
+	// false for types without statistics, void and the like
+	static bool IsSupported(CPrimitiveTypeEnum InType);
+
+	// add InCount values stored back to back
+	void Accumulate(const void *InData, size_t InCount);
+
+	bool IsFloat() const { return Type == cbtFloat || Type == cbtDouble; }
+	CPrimitiveTypeEnum GetType() const { return Type; }
+
+	uint64_t	Count;
+	uint64_t	NaNCount;		// floating point only
+	uint64_t	ZeroCount;
+
+	// floating point types, over the values that are not NaN
+	double		FloatMin;
+	double		FloatMax;
+	double		FloatSum;
+
+	// integer types. the sum wraps at 64 bits, unsigned long long values are kept as their bits.
+	int64_t		IntMin;
+	int64_t		IntMax;
+	int64_t		IntSum;
+
+	// the sum over the values that are not NaN, divided by their count
+	double GetMean() const;
+
+private:
+	CPrimitiveTypeEnum	Type;
+};
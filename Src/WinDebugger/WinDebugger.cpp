@@ -7,9 +7,16 @@
 #include "WinProcessHelper.h"
 #include "WinVariableTypeHelper.h"
 #include "WinStackTraceHelper.h"
+#include "WinMemoryDumpHelper.h"
+#include "WinHeapWalker.h"
+#include "WinSymbolSearch.h"
+#include "WinUniqueStacks.h"
 
 
 #include <DbgHelp.h>
+#include <cstdio>
+#include <chrono>
+#include <map>
 
 
 // display debug event
@@ -274,6 +281,7 @@ BOOL FWinDebugger::DebugActiveProcess(DWORD InProcessId)
 	}
 	
 	DebuggeeCtx.hProcess = OpenProcess(PROCESS_ALL_ACCESS, FALSE, InProcessId);
+	DebuggeeCtx.bAttaching = TRUE;
 	return TRUE;
 }
 
@@ -366,7 +374,7 @@ VOID FWinDebugger::OnCreateThreadDebugEvent(const DEBUG_EVENT &InDbgEvent)
 	appConsolePrintf(TEXT("CREATE_THREAD_DEBUG_INFO: \n"));
 	appConsolePrintf(TEXT("    hThread:   0x%08x\n"), InDbgEvent.u.CreateThread.hThread);
 	appConsolePrintf(TEXT("    LocalBase: 0x%08x\n"), InDbgEvent.u.CreateThread.lpThreadLocalBase);
-	appConsolePrintf(TEXT("    StartAddr: 0x%08x\n"), InDbgEvent.u.CreateThread.lpStartAddress);
+	appConsolePrintf(TEXT("    StartAddr: 0x%p\n"), InDbgEvent.u.CreateThread.lpStartAddress);
 }
 
 VOID FWinDebugger::OnCreateProcessDebugEvent(const DEBUG_EVENT &InDbgEvent)
@@ -377,13 +385,28 @@ VOID FWinDebugger::OnCreateProcessDebugEvent(const DEBUG_EVENT &InDbgEvent)
 	appConsolePrintf(TEXT("    Image: %s\n"), ImageFile.c_str());
 	appConsolePrintf(TEXT("    BaseAddr Of Image: 0x%08x\n"), InDbgEvent.u.CreateProcessInfo.lpBaseOfImage);
 	appConsolePrintf(TEXT("    hProcess: 0x%08x, hThread: 0x%08x\n"), InDbgEvent.u.CreateProcessInfo.hProcess, InDbgEvent.u.CreateProcessInfo.hThread);
-	appConsolePrintf(TEXT("    StartAddr: 0x%08x\n"), InDbgEvent.u.CreateProcessInfo.lpStartAddress);
+	appConsolePrintf(TEXT("    StartAddr: 0x%p\n"), InDbgEvent.u.CreateProcessInfo.lpStartAddress);
 
-	// initialize symbol handler
+	// snapshots of an earlier debuggee, a detach leaves them behind without an exit event
+	HeapSnapshots.clear();
+
+	// initialize symbol handler. PDBs load on first use, a symbol server download in SymLoadModule64
+	// would stall every LOAD_DLL event, the symbol store prefetches them in the background instead.
+	::SymSetOptions(::SymGetOptions() | SYMOPT_DEFERRED_LOADS);
 	::SymInitialize(DebuggeeCtx.hProcess, NULL, FALSE);
+	FWinStackTraceHelper::InitializeSymbolStore();
+	if (DebuggeeCtx.bAttaching)
+	{
+		LoadAttachedModules(InDbgEvent.dwProcessId);
+		DebuggeeCtx.bAttaching = FALSE;
+		::CloseHandle(InDbgEvent.u.CreateProcessInfo.hFile);
+		return;
+	}
+
 	DWORD64 RealBaseAddr = SymLoadModule64(DebuggeeCtx.hProcess, InDbgEvent.u.CreateProcessInfo.hFile, NULL, NULL, (DWORD64)InDbgEvent.u.CreateProcessInfo.lpBaseOfImage, 0);
 	if (RealBaseAddr)
 	{
+		FWinStackTraceHelper::RegisterModule(DebuggeeCtx.hProcess, RealBaseAddr);
 		appConsolePrintf(TEXT("    Symbol Loaded Successfully.\n"));
 	}
 	else
@@ -394,6 +417,46 @@ VOID FWinDebugger::OnCreateProcessDebugEvent(const DEBUG_EVENT &InDbgEvent)
 	::CloseHandle(InDbgEvent.u.CreateProcessInfo.hFile);
 }
 
+// modules of a process we attach to, from one snapshot. dbghelp only records them, the symbols of
+// all modules are built in parallel.
+VOID FWinDebugger::LoadAttachedModules(DWORD InProcessId)
+{
+	std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+	std::vector<FSnapshotTool::FSnapModuleInfo> Modules;
+	{
+		FSnapshotTool Snapshot(InProcessId, FSnapshotTool::SNAP_MODULE);
+		Snapshot.GetModuleList(Modules);
+	}
+	const double SnapshotMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+
+	Start = std::chrono::steady_clock::now();
+	std::vector<DWORD64> ModuleBases;
+	for (size_t k = 0; k < Modules.size(); k++)
+	{
+		const DWORD64 BaseAddr = (DWORD64)Modules[k].BaseAddr;
+		if (SymLoadModuleEx(DebuggeeCtx.hProcess, NULL, Modules[k].ExeFilename.c_str(), NULL, BaseAddr, Modules[k].BaseSize, NULL, 0) || GetLastError() == ERROR_SUCCESS)
+		{
+			ModuleBases.push_back(BaseAddr);
+		}
+	} // end for k
+	const double DbgHelpMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+
+	FModuleLoadTimes Times;
+	FWinStackTraceHelper::RegisterModules(DebuggeeCtx.hProcess, ModuleBases, Times);
+
+	appConsolePrintf(TEXT("    Attach: %d modules, symbols on %d threads\n"), Times.ModuleCount, Times.ThreadCount);
+	appConsolePrintf(TEXT("      snapshot: %8.1f ms\n"), SnapshotMs);
+	appConsolePrintf(TEXT("      dbghelp:  %8.1f ms\n"), DbgHelpMs);
+	appConsolePrintf(TEXT("      headers:  %8.1f ms\n"), Times.HeadersMs);
+	appConsolePrintf(TEXT("      symbols:  %8.1f ms\n"), Times.SymbolsMs);
+	appConsolePrintf(TEXT("      commit:   %8.1f ms\n"), Times.CommitMs);
+	appConsolePrintf(TEXT("      total:    %8.1f ms\n"), SnapshotMs + DbgHelpMs + Times.HeadersMs + Times.SymbolsMs + Times.CommitMs);
+	if (Times.DeferredCount)
+	{
+		appConsolePrintf(TEXT("    %d modules without a PDB are indexed on first use.\n"), Times.DeferredCount);
+	}
+}
+
 VOID FWinDebugger::OnExitThreadDebugEvent(const DEBUG_EVENT &InDbgEvent)
 {
 	appConsolePrintf(TEXT("EXIT_THREAD_DEBUG_EVENT: \n"));
@@ -405,6 +468,10 @@ VOID FWinDebugger::OnExitProcessDebugEvent(const DEBUG_EVENT &InDbgEvent)
 	appConsolePrintf(TEXT("EXIT_PROCESS_DEBUG_EVENT: \n"));
 	appConsolePrintf(TEXT("    ExitCode:   %d\n"), InDbgEvent.u.ExitProcess.dwExitCode);
 
+	FWinStackTraceHelper::ClearModules();
+	ExpressionCache.Clear();
+	ResetWatchLayouts();
+	HeapSnapshots.clear();
 	::SymCleanup(DebuggeeCtx.hProcess);
 }
 
@@ -416,9 +483,18 @@ VOID FWinDebugger::OnLoadDllDebugEvent(const DEBUG_EVENT &InDbgEvent)
 	appConsolePrintf(TEXT("    Image: %s\n"), ImageFile.c_str());
 	appConsolePrintf(TEXT("    BaseAddr Of DLL: 0x%08x\n"), InDbgEvent.u.LoadDll.lpBaseOfDll);
 
+	// reported again after an attach, the snapshot already loaded it
+	if (FWinStackTraceHelper::HasModule((DWORD64)InDbgEvent.u.LoadDll.lpBaseOfDll))
+	{
+		appConsolePrintf(TEXT("    Symbol Preloaded.\n"));
+		CloseHandle(InDbgEvent.u.LoadDll.hFile);
+		return;
+	}
+
 	DWORD64 RealBaseAddr = SymLoadModule64(DebuggeeCtx.hProcess, InDbgEvent.u.LoadDll.hFile, NULL, NULL, (DWORD64)InDbgEvent.u.LoadDll.lpBaseOfDll, 0);
 	if (RealBaseAddr)
 	{
+		FWinStackTraceHelper::RegisterModule(DebuggeeCtx.hProcess, RealBaseAddr);
 		appConsolePrintf(TEXT("    Symbol Loaded Successfully.\n"));
 	}
 	else
@@ -433,6 +509,10 @@ VOID FWinDebugger::OnUnloadDllDebugEvent(const DEBUG_EVENT &InDbgEvent)
 {
 	appConsolePrintf(TEXT("UNLOAD_DLL_DEBUG_INFO: \n"));
 	appConsolePrintf(TEXT("    BaseAddr Of DLL: 0x%08x\n"), InDbgEvent.u.UnloadDll.lpBaseOfDll);
+	FWinStackTraceHelper::UnregisterModule((DWORD64)InDbgEvent.u.UnloadDll.lpBaseOfDll);
+	ExpressionCache.UnloadModule((DWORD64)InDbgEvent.u.UnloadDll.lpBaseOfDll);
+	ResetWatchLayouts();
+	FSymTypeInfoHelper::UnloadModule((DWORD64)InDbgEvent.u.UnloadDll.lpBaseOfDll);
 	BOOL bSuccess = SymUnloadModule64(DebuggeeCtx.hProcess, (DWORD64)InDbgEvent.u.UnloadDll.lpBaseOfDll);
 	if (bSuccess)
 	{
@@ -489,7 +569,7 @@ VOID FWinDebugger::DisplayException(uint32_t InProcessId, uint32_t InThreadId, c
 
 	appConsolePrintf(TEXT("Exception Occurred, PID=%d, TID=%d, bFirstChance=%d:\n"), InProcessId, InThreadId, InException.dwFirstChance);
 	appConsolePrintf(TEXT("Exception Code: %s(0x%08x)\n"), GetExceptionCodeDescription(ExceptionCode), ExceptionCode);
-	appConsolePrintf(TEXT("EIP: 0x%08x\n"), InException.ExceptionRecord.ExceptionAddress);
+	appConsolePrintf(TEXT("EIP: 0x%p\n"), InException.ExceptionRecord.ExceptionAddress);
 
 	if (ExceptionCode == EXCEPTION_ACCESS_VIOLATION
 		|| ExceptionCode == EXCEPTION_IN_PAGE_ERROR)
@@ -522,11 +602,18 @@ const FWinDebugger::FCommandMeta FWinDebugger::sUserCommands[] =
 	{ TEXT("go"),	  TEXT("continue execute"),        TEXT("go [u]"),						 &FWinDebugger::Command_Go },
 	{ TEXT("list"),   TEXT("list system info"),		   TEXT("list [processes, threads, modules, heaps]"), &FWinDebugger::Command_List },
 	{ TEXT("registers"), TEXT("dump current thread context"), TEXT("registers"),             &FWinDebugger::Command_DisplayThreadContext},
-	{ TEXT("memory"), TEXT("dump debuggee memory"),    TEXT("memory addr bytes"),            &FWinDebugger::Command_DisplayMemory },
-	{ TEXT("ls"),     TEXT("list source code"),			TEXT("ls"),							 &FWinDebugger::Command_ListSourceCode },
-	{ TEXT("gv"),     TEXT("list global variables"),   TEXT("gv [expression]"),              &FWinDebugger::Command_ListGlobalVariables },
-	{ TEXT("lv"),     TEXT("list local variables"),    TEXT("lv [expression]"),              &FWinDebugger::Command_ListLocalVariables  },
-	{ TEXT("bt"),     TEXT("display call stack"),      TEXT("bt [depth]"),                   &FWinDebugger::Command_StackTrace          }
+	{ TEXT("memory"), TEXT("dump debuggee memory"),    TEXT("memory addr bytes [-b|-w|-d|-q] [-noascii] [-out=filename]"), &FWinDebugger::Command_DisplayMemory },
+	{ TEXT("ls"),     TEXT("list source code"),			TEXT("ls [file:line]"),				 &FWinDebugger::Command_ListSourceCode },
+	{ TEXT("gv"),     TEXT("list global variables"),   TEXT("gv [expression] [-d=levels]"),  &FWinDebugger::Command_ListGlobalVariables },
+	{ TEXT("lv"),     TEXT("list local variables"),    TEXT("lv [expression] [-d=levels]"),  &FWinDebugger::Command_ListLocalVariables  },
+	{ TEXT("dt"),     TEXT("display variable and pointees"), TEXT("dt name [-r=levels] | dt name[start:end] | dt pointer,count"), &FWinDebugger::Command_DisplayType },
+	{ TEXT("agg"),    TEXT("statistics of array elements"), TEXT("agg name | agg name[start:end] | agg pointer,count"), &FWinDebugger::Command_AggregateArray },
+	{ TEXT("eval"),   TEXT("evaluate an expression"),  TEXT("eval \"expression\""),          &FWinDebugger::Command_Evaluate            },
+	{ TEXT("watch"),  TEXT("expressions shown when they change"), TEXT("watch add \"expression\" | watch del index|all | watch list"), &FWinDebugger::Command_Watch },
+	{ TEXT("bt"),     TEXT("display call stack"),      TEXT("bt [all] [depth]"),             &FWinDebugger::Command_StackTrace          },
+	{ TEXT("heapsnap"), TEXT("record busy heap blocks"), TEXT("heapsnap"),                   &FWinDebugger::Command_HeapSnapshot        },
+	{ TEXT("heapdiff"), TEXT("compare heap snapshots"),  TEXT("heapdiff [old new]"),         &FWinDebugger::Command_HeapDiff            },
+	{ TEXT("x"),      TEXT("search symbols"),          TEXT("x [module!]pattern [-r] [-n=count] [-p=page]"), &FWinDebugger::Command_SearchSymbols }
 };
 
 VOID FWinDebugger::WaitForUserCommand()
@@ -535,6 +622,11 @@ VOID FWinDebugger::WaitForUserCommand()
 	TCHAR szCmdBuffer[1024];
 	BOOL bQuitWait = FALSE;
 
+	if (DebuggeeCtx.pDbgEvent && !Watches.empty())
+	{
+		DisplayWatches(FALSE);
+	}
+
 	do 
 	{
 		appConsolePrintf(TEXT(">"));
@@ -721,20 +813,41 @@ BOOL FWinDebugger::Command_List(const vector<wstring> &InTokens, const vector<ws
 	}
 	else if (!appStricmp(StrSubCmd.c_str(), TEXT("heaps")))
 	{
-		std::vector<FSnapshotTool::FSnapHeapInfo> OutHeaps;
-		FSnapshotTool Snapshot(ProcessId, FSnapshotTool::SNAP_HEAP);
+		// walk the heap segments directly, Heap32First/Heap32Next is quadratic in the number of blocks.
+		FProcessMemory Memory(DebuggeeCtx.hProcess);
+		FNtHeapWalker Walker(Memory, FNtHeapLayout::GetLayout(FProcessInfoHelper::GetPointerSize(DebuggeeCtx.hProcess) == 8));
 
-		Snapshot.GetHeapList(OutHeaps);
-		for (uint32_t k = 0; k < OutHeaps.size(); k++)
+		std::vector<uint64_t> Heaps;
+		const uint64_t PebAddress = FProcessInfoHelper::GetPebAddress(DebuggeeCtx.hProcess);
+		if (!PebAddress || !Walker.GetProcessHeaps(PebAddress, Heaps))
 		{
-			const FSnapshotTool::FSnapHeapInfo &Entry = OutHeaps[k];
+			TRACE_ERROR(TEXT("Get Process Heaps"));
+			return FALSE;
+		}
 
-			appConsolePrintf(TEXT("heap %04d, %s:\n"), k, FSnapshotTool::GetHeapFlagsDesc(Entry.FlagValue));
-			for (uint32_t m = 0; m < Entry.Blocks.size(); m++)
+		for (uint32_t k = 0; k < Heaps.size(); k++)
+		{
+			FHeapStatistics Stats;
+			if (!Walker.WalkHeap(Heaps[k], Stats))
 			{
-				const FSnapshotTool::FSnapHeapBlock &Block = Entry.Blocks[m];
-				appConsolePrintf(TEXT("    addr:0x%p, size:%d, hHandle:%d, desc:%s\n"), Block.Address, Block.BlockSize, Block.hHandle, FSnapshotTool::GetHeapBlockFlagsDesc(Block.Flags));
-			} // end for m
+				appConsolePrintf(TEXT("heap %04d, addr:0x%p: not a NT heap\n"), k, (void*)(uintptr_t)Heaps[k]);
+				continue;
+			}
+
+			appConsolePrintf(TEXT("heap %04d, addr:0x%p, %s, segments:%d%s%s\n"), k, (void*)(uintptr_t)Heaps[k],
+				FSnapshotTool::GetHeapFlagsDesc(k == 0 ? kDefaultHeap : 0), Stats.SegmentCount,
+				Stats.bEncoded ? TEXT(", encoded") : TEXT(""), Stats.CorruptEntries ? TEXT(", CORRUPTED") : TEXT(""));
+			appConsolePrintf(TEXT("    busy:    %10I64u blocks, %12I64u bytes\n"), Stats.BusyBlocks, Stats.BusyBytes);
+			appConsolePrintf(TEXT("    free:    %10I64u blocks, %12I64u bytes, largest:%I64u\n"), Stats.FreeBlocks, Stats.FreeBytes, Stats.LargestFreeBlock);
+			appConsolePrintf(TEXT("    virtual: %10I64u blocks, %12I64u bytes\n"), Stats.VirtualBlocks, Stats.VirtualBytes);
+			for (uint32_t Class = 0; Class < kHeapSizeClasses; Class++)
+			{
+				if (Stats.SizeClassBlocks[Class])
+				{
+					appConsolePrintf(TEXT("    [%10I64u, %10I64u): %10I64u blocks, %12I64u bytes\n"), FHeapStatistics::GetSizeClassBase(Class),
+						FHeapStatistics::GetSizeClassBase(Class + 1), Stats.SizeClassBlocks[Class], Stats.SizeClassBytes[Class]);
+				}
+			} // end for Class
 		} // end for k
 	}
 
@@ -763,6 +876,37 @@ BOOL FWinDebugger::Command_DisplayThreadContext(const vector<wstring> &InTokens,
 	if (GetThreadContext(hThread, &ThreadContext))
 	{
 		// display registers
+#if defined(_M_X64)
+		if (ThreadContext.ContextFlags & CONTEXT_CONTROL)
+		{
+			TCHAR szBuffer[64];
+			appConsolePrintf(TEXT("rip:%016llx, rsp:%016llx, rbp:%016llx,  cs:%04x,  ss:%04x, eflags:%s\n"),
+				ThreadContext.Rip, ThreadContext.Rsp, ThreadContext.Rbp, ThreadContext.SegCs, ThreadContext.SegSs,
+				appItoA(ThreadContext.EFlags, szBuffer, 2));
+		}
+
+		if (ThreadContext.ContextFlags & CONTEXT_INTEGER)
+		{
+			appConsolePrintf(TEXT("rax:%016llx, rbx:%016llx, rcx:%016llx, rdx:%016llx\n"), ThreadContext.Rax, ThreadContext.Rbx,
+				ThreadContext.Rcx, ThreadContext.Rdx);
+			appConsolePrintf(TEXT("rsi:%016llx, rdi:%016llx,  r8:%016llx,  r9:%016llx\n"), ThreadContext.Rsi, ThreadContext.Rdi,
+				ThreadContext.R8, ThreadContext.R9);
+			appConsolePrintf(TEXT("r10:%016llx, r11:%016llx, r12:%016llx, r13:%016llx\n"), ThreadContext.R10, ThreadContext.R11,
+				ThreadContext.R12, ThreadContext.R13);
+			appConsolePrintf(TEXT("r14:%016llx, r15:%016llx\n"), ThreadContext.R14, ThreadContext.R15);
+		}
+
+		if (ThreadContext.ContextFlags & CONTEXT_SEGMENTS)
+		{
+			appConsolePrintf(TEXT(" gs:%04x,  fs:%04x,  es:%04x,  ds:%04x\n"), ThreadContext.SegGs, ThreadContext.SegFs, ThreadContext.SegEs, ThreadContext.SegDs);
+		}
+
+		if (ThreadContext.ContextFlags & CONTEXT_DEBUG_REGISTERS)
+		{
+			appConsolePrintf(TEXT("dr0:%016llx, dr1:%016llx, dr2:%016llx, dr3:%016llx\ndr6:%016llx, dr7:%016llx\n"), ThreadContext.Dr0,
+				ThreadContext.Dr1, ThreadContext.Dr2, ThreadContext.Dr3, ThreadContext.Dr6, ThreadContext.Dr7);
+		}
+#else
 		if (ThreadContext.ContextFlags & CONTEXT_CONTROL)
 		{
 			TCHAR szBuffer[64];
@@ -787,6 +931,7 @@ BOOL FWinDebugger::Command_DisplayThreadContext(const vector<wstring> &InTokens,
 			appConsolePrintf(TEXT("dr0:%08x, dr1:%08x, dr2:%08x, dr3:%08x, dr6:%08x, dr7:%08x\n"), ThreadContext.Dr0, ThreadContext.Dr1,
 				ThreadContext.Dr2, ThreadContext.Dr3, ThreadContext.Dr6, ThreadContext.Dr7);
 		}
+#endif
 	}
 	
 	CloseHandle(hThread);
@@ -806,30 +951,89 @@ BOOL FWinDebugger::Command_DisplayMemory(const vector<wstring> &InTokens, const
 		return FALSE;
 	}
 
-	int32_t DestAddr = appHextoi(InTokens[0].c_str());
-	int32_t Bytes = appAtoi(InTokens[1].c_str());
+	uint64_t DestAddr = appStrtoi64(InTokens[0].c_str(), NULL, 16);
+	int64_t Bytes = appAtoi64(InTokens[1].c_str());
+
+	// switches: -b -w -d -q unit width, -noascii, -out=filename
+	uint32_t UnitWidth = FMemoryDumpFormatter::UNIT_BYTE;
+	bool bShowAscii = true;
+	const TCHAR *szOutFilename = NULL;
+	for (size_t k = 0; k < InSwitchs.size(); k++)
+	{
+		const TCHAR *szSwitch = InSwitchs[k].c_str();
+		if (!appStricmp(szSwitch, TEXT("b")))      { UnitWidth = FMemoryDumpFormatter::UNIT_BYTE; }
+		else if (!appStricmp(szSwitch, TEXT("w"))) { UnitWidth = FMemoryDumpFormatter::UNIT_WORD; }
+		else if (!appStricmp(szSwitch, TEXT("d"))) { UnitWidth = FMemoryDumpFormatter::UNIT_DWORD; }
+		else if (!appStricmp(szSwitch, TEXT("q"))) { UnitWidth = FMemoryDumpFormatter::UNIT_QWORD; }
+		else if (!appStricmp(szSwitch, TEXT("noascii"))) { bShowAscii = false; }
+		else if (!appStrnicmp(szSwitch, TEXT("out="), 4)) { szOutFilename = szSwitch + 4; }
+	} // end for k
 
-	if (Bytes <= 0)    { Bytes = 20; }
-	if (Bytes >= 4096) { Bytes = 4096; }
+	if (Bytes <= 0) { Bytes = FMemoryDumpFormatter::kBytesPerLine * 8; }
+	// whole units only
+	Bytes = (Bytes + UnitWidth - 1) & ~(int64_t)(UnitWidth - 1);
 
-	const int32_t kBytesPerLine = 20;
-	for (int32_t k = 0; k < Bytes;)
+	FILE *OutFile = NULL;
+	if (szOutFilename)
 	{
-		appConsolePrintf(TEXT("%p:"), (void*)DestAddr);
-		for (int32_t col = 0; col < kBytesPerLine && k < Bytes; col++, k++, DestAddr++)
+		OutFile = _tfopen(szOutFilename, TEXT("wb"));
+		if (!OutFile)
 		{
-			unsigned char Ch;
-			if (::ReadProcessMemory(DebuggeeCtx.hProcess, (void*)DestAddr, &Ch, 1, NULL))
-			{
-				appConsolePrintf(TEXT(" %02X"), Ch);
-			}
-			else
+			appConsolePrintf(TEXT("can't open file %s\n"), szOutFilename);
+			return FALSE;
+		}
+	}
+
+	// read a chunk with one call, fall back to page reads to find the holes.
+	const uint32_t kPageSize = 4096;
+	const uint32_t kChunkSize = 64 * 1024;
+	const FMemoryDumpFormatter Formatter(UnitWidth, bShowAscii, sizeof(void*) * 2);
+	vector<uint8_t> ChunkData(kChunkSize);
+	vector<uint8_t> ValidMask(kChunkSize);
+	string Text;
+	Text.reserve((kChunkSize / FMemoryDumpFormatter::kBytesPerLine) * Formatter.LineLength());
+
+	for (int64_t Offset = 0; Offset < Bytes; )
+	{
+		const uint64_t ChunkAddr = DestAddr + Offset;
+		// end chunks on a page, in whole lines so an unaligned start does not break a line at the boundary
+		uint32_t ChunkBytes = kChunkSize - (uint32_t)(ChunkAddr & (kPageSize - 1));
+		ChunkBytes &= ~(FMemoryDumpFormatter::kBytesPerLine - 1);
+		if ((int64_t)ChunkBytes > Bytes - Offset) { ChunkBytes = (uint32_t)(Bytes - Offset); }
+
+		bool bAllValid = !!::ReadProcessMemory(DebuggeeCtx.hProcess, (void*)(uintptr_t)ChunkAddr, &ChunkData[0], ChunkBytes, NULL);
+		if (!bAllValid)
+		{
+			for (uint32_t PageOffset = 0; PageOffset < ChunkBytes; )
 			{
-				appConsolePrintf(TEXT(" ??"));
-			}
-		} // end for col
-		appConsolePrintf(TEXT("\n"));
-	} // end for k
+				uint32_t PageBytes = kPageSize - (uint32_t)((ChunkAddr + PageOffset) & (kPageSize - 1));
+				if (PageBytes > ChunkBytes - PageOffset) { PageBytes = ChunkBytes - PageOffset; }
+
+				BOOL bRead = ::ReadProcessMemory(DebuggeeCtx.hProcess, (void*)(uintptr_t)(ChunkAddr + PageOffset), &ChunkData[PageOffset], PageBytes, NULL);
+				memset(&ValidMask[PageOffset], bRead ? 1 : 0, PageBytes);
+				PageOffset += PageBytes;
+			} // end for PageOffset
+		}
+
+		Text.clear();
+		Formatter.FormatLines(ChunkAddr, &ChunkData[0], bAllValid ? NULL : &ValidMask[0], ChunkBytes, Text);
+		if (OutFile)
+		{
+			fwrite(Text.data(), 1, Text.size(), OutFile);
+		}
+		else
+		{
+			appConsoleWrite(Text.data(), Text.size());
+		}
+
+		Offset += ChunkBytes;
+	} // end for Offset
+
+	if (OutFile)
+	{
+		fclose(OutFile);
+		appConsolePrintf(TEXT("%I64d bytes dumped to %s\n"), Bytes, szOutFilename);
+	}
 
 	return FALSE;
 }
@@ -842,6 +1046,35 @@ BOOL FWinDebugger::Command_ListSourceCode(const vector<wstring> &InTokens, const
 		return FALSE;
 	}
 
+	// file:line -> addresses
+	if (InTokens.size() >= 1)
+	{
+		const wstring::size_type Colon = InTokens[0].rfind(TEXT(':'));
+		if (Colon == wstring::npos || Colon == 0 || Colon + 1 == InTokens[0].size())
+		{
+			appConsolePrintf(TEXT("usage: ls [file:line]\n"));
+			return FALSE;
+		}
+
+		const wstring FileName = InTokens[0].substr(0, Colon);
+		const DWORD Line = (DWORD)appAtoi(InTokens[0].c_str() + Colon + 1);
+
+		vector<FSourceLocation> Locations;
+		FWinStackTraceHelper::SourceLineToAddresses(DebuggeeCtx.hProcess, FileName, Line, Locations);
+		if (Locations.empty())
+		{
+			appConsolePrintf(TEXT("no code at %s:%d\n"), FileName.c_str(), Line);
+		}
+
+		for (size_t k = 0; k < Locations.size(); k++)
+		{
+			const FSourceLocation &Location = Locations[k];
+			appConsolePrintf(TEXT("  %p, %d bytes, file:%s, line:%d\n"), (void*)(uintptr_t)Location.Address, Location.Size,
+				Location.FileName.c_str(), Location.Line);
+		} // end for k
+		return FALSE;
+	}
+
 	HANDLE hThread = OpenThread(THREAD_ALL_ACCESS, FALSE, DebuggeeCtx.pDbgEvent->dwThreadId);
 	if (hThread == NULL)
 	{
@@ -852,15 +1085,14 @@ BOOL FWinDebugger::Command_ListSourceCode(const vector<wstring> &InTokens, const
 	ThreadContext.ContextFlags = CONTEXT_CONTROL;
 	if (GetThreadContext(hThread, &ThreadContext))
 	{
-		DWORD64 qwAddr = ThreadContext.Eip;
-		DWORD dwDisplacement = 0;
-		IMAGEHLP_LINE64  Line64;
+		DWORD64 qwAddr = FWinStackTraceHelper::GetProgramCounter(ThreadContext);
+		DWORD dwDisplacement = 0, LineNumber = 0;
+		wstring FileName;
 
-		Line64.SizeOfStruct = sizeof(Line64);
-		if (SymGetLineFromAddr64(DebuggeeCtx.hProcess, qwAddr, &dwDisplacement, &Line64))
+		if (FWinStackTraceHelper::ProgramCounterToLine(DebuggeeCtx.hProcess, qwAddr, FileName, LineNumber, dwDisplacement))
 		{
-			appConsolePrintf(TEXT("list source: eip:%p, displacement:%d, file:%s, line:%d\n"), ThreadContext.Eip, dwDisplacement, Line64.FileName,
-				Line64.LineNumber);
+			appConsolePrintf(TEXT("list source: pc:%p, displacement:%d, file:%s, line:%d\n"), (void*)(uintptr_t)qwAddr, dwDisplacement, FileName.c_str(),
+				LineNumber);
 		}
 		else
 		{
@@ -872,6 +1104,84 @@ BOOL FWinDebugger::Command_ListSourceCode(const vector<wstring> &InTokens, const
 	return FALSE;
 }
 
+// the stacks of all threads of the process, each distinct stack printed once with its threads, !uniqstack style
+static VOID DisplayAllStackTraces(HANDLE InProcess, DWORD InMaxDepth)
+{
+	static const uint32_t kIdsPerLine = 16;
+
+	std::vector<FSnapshotTool::FSnapThreadInfo> Threads;
+	FSnapshotTool Snapshot(GetProcessId(InProcess), FSnapshotTool::SNAP_THREAD);
+	Snapshot.GetThreadList(Threads);
+
+	std::vector<DWORD> ThreadIds(Threads.size());
+	for (size_t k = 0; k < Threads.size(); k++)
+	{
+		ThreadIds[k] = Threads[k].ThreadId;
+	} // end for k
+
+	const std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+	std::vector<FThreadStack> Stacks;
+	const uint32_t WorkerCount = FWinStackTraceHelper::CaptureStackTraces(InProcess, ThreadIds, InMaxDepth, Stacks);
+	const double UnwindMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+
+	FUniqueStacks UniqueStacks;
+	std::vector<DWORD> FailedIds;
+	for (size_t k = 0; k < Stacks.size(); k++)
+	{
+		const FThreadStack &Stack = Stacks[k];
+		if (Stack.bCaptured)
+		{
+			UniqueStacks.Add(Stack.ThreadId, Stack.BackTrace.empty() ? NULL : &Stack.BackTrace[0], (uint32_t)Stack.BackTrace.size());
+		}
+		else
+		{
+			FailedIds.push_back(Stack.ThreadId);
+		}
+	} // end for k
+
+	appConsolePrintf(TEXT("%u threads, %u distinct stacks, unwound on %u threads in %.2f ms\n"), UniqueStacks.GetThreadCount(),
+		UniqueStacks.GetStackCount(), WorkerCount, UnwindMs);
+
+	// stacks share their outer frames, each pc is symbolized once
+	std::map<DWORD64, std::wstring> Symbols;
+	std::vector<const FUniqueStacks::FStack*> SortedStacks;
+	UniqueStacks.GetStacks(SortedStacks);
+	for (size_t k = 0; k < SortedStacks.size(); k++)
+	{
+		const FUniqueStacks::FStack &Stack = *SortedStacks[k];
+		appConsolePrintf(TEXT("\n%u thread%s:"), (uint32_t)Stack.ThreadIds.size(), Stack.ThreadIds.size() > 1 ? TEXT("s") : TEXT(""));
+		for (size_t i = 0; i < Stack.ThreadIds.size(); i++)
+		{
+			appConsolePrintf((i && i % kIdsPerLine == 0) ? TEXT("\n    %u") : TEXT(" %u"), Stack.ThreadIds[i]);
+		} // end for i
+		appConsolePrintf(TEXT("\n"));
+
+		if (Stack.Frames.empty())
+		{
+			appConsolePrintf(TEXT("  (no frames)\n"));
+		}
+		for (size_t i = 0; i < Stack.Frames.size(); i++)
+		{
+			std::map<DWORD64, std::wstring>::iterator Itr = Symbols.find(Stack.Frames[i]);
+			if (Itr == Symbols.end())
+			{
+				Itr = Symbols.insert(std::make_pair(Stack.Frames[i], FWinStackTraceHelper::ProgramCounterToSymbolInfo(InProcess, Stack.Frames[i]))).first;
+			}
+			appConsolePrintf(TEXT("%3d: %s\n"), (INT)i, Itr->second.c_str());
+		} // end for i
+	} // end for k
+
+	if (!FailedIds.empty())
+	{
+		appConsolePrintf(TEXT("\nno context for %u thread%s:"), (uint32_t)FailedIds.size(), FailedIds.size() > 1 ? TEXT("s") : TEXT(""));
+		for (size_t i = 0; i < FailedIds.size(); i++)
+		{
+			appConsolePrintf(TEXT(" %u"), FailedIds[i]);
+		} // end for i
+		appConsolePrintf(TEXT("\n"));
+	}
+}
+
 BOOL FWinDebugger::Command_StackTrace(const vector<wstring> &InTokens, const vector<wstring> &InSwitchs)
 {
 	if (!DebuggeeCtx.pDbgEvent || DebuggeeCtx.hProcess == INVALID_HANDLE_VALUE)
@@ -879,6 +1189,27 @@ BOOL FWinDebugger::Command_StackTrace(const vector<wstring> &InTokens, const vec
 		return FALSE;
 	}
 
+	// bt [all] [depth]
+	BOOL bAllThreads = FALSE;
+	UINT MaxDepth = 100;
+	for (size_t k = 0; k < InTokens.size(); k++)
+	{
+		if (!appStricmp(InTokens[k].c_str(), TEXT("all")))
+		{
+			bAllThreads = TRUE;
+		}
+		else if (appAtoi(InTokens[k].c_str()) > 0)
+		{
+			MaxDepth = (UINT)appAtoi(InTokens[k].c_str());
+		}
+	} // end for k
+
+	if (bAllThreads)
+	{
+		DisplayAllStackTraces(DebuggeeCtx.hProcess, MaxDepth);
+		return FALSE;
+	}
+
 	HANDLE hThread = OpenThread(THREAD_ALL_ACCESS, FALSE, DebuggeeCtx.pDbgEvent->dwThreadId);
 	if (hThread == NULL)
 	{
@@ -889,12 +1220,9 @@ BOOL FWinDebugger::Command_StackTrace(const vector<wstring> &InTokens, const vec
 	ThreadContext.ContextFlags = CONTEXT_FULL;
 	if (GetThreadContext(hThread, &ThreadContext))
 	{
-		const UINT MaxDepth = 100;
-		DWORD64 StackTrace[MaxDepth];
-		memset(StackTrace, 0, sizeof(StackTrace));
-
-		FWinStackTraceHelper::CaptureStackTrace(DebuggeeCtx.hProcess, hThread, ThreadContext, StackTrace, MaxDepth);
-		for (INT CurrentDepth = 0; StackTrace[CurrentDepth]; CurrentDepth++)
+		vector<DWORD64> StackTrace(MaxDepth);
+		const INT Depth = FWinStackTraceHelper::CaptureStackTrace(DebuggeeCtx.hProcess, hThread, ThreadContext, &StackTrace[0], MaxDepth);
+		for (INT CurrentDepth = 0; CurrentDepth < Depth; CurrentDepth++)
 		{
 			std::wstring StrCallSymbol = FWinStackTraceHelper::ProgramCounterToSymbolInfo(DebuggeeCtx.hProcess, StackTrace[CurrentDepth]);
 
@@ -904,4 +1232,168 @@ BOOL FWinDebugger::Command_StackTrace(const vector<wstring> &InTokens, const vec
 
 	CloseHandle(hThread);
 	return FALSE;
-}
\ No newline at end of file
+}
+
+BOOL FWinDebugger::Command_HeapSnapshot(const vector<wstring> &InTokens, const vector<wstring> &InSwitchs)
+{
+	if (DebuggeeCtx.hProcess == INVALID_HANDLE_VALUE)
+	{
+		return FALSE;
+	}
+
+	FProcessMemory Memory(DebuggeeCtx.hProcess);
+	FNtHeapWalker Walker(Memory, FNtHeapLayout::GetLayout(FProcessInfoHelper::GetPointerSize(DebuggeeCtx.hProcess) == 8));
+
+	std::vector<uint64_t> Heaps;
+	const uint64_t PebAddress = FProcessInfoHelper::GetPebAddress(DebuggeeCtx.hProcess);
+	if (!PebAddress || !Walker.GetProcessHeaps(PebAddress, Heaps))
+	{
+		TRACE_ERROR(TEXT("Get Process Heaps"));
+		return FALSE;
+	}
+
+	HeapSnapshots.push_back(FHeapSnapshot());
+	FHeapSnapshot &Snapshot = HeapSnapshots.back();
+	if (!Snapshot.Capture(Walker, Heaps))
+	{
+		HeapSnapshots.pop_back();
+		appConsolePrintf(TEXT("heap snapshot failed.\n"));
+		return FALSE;
+	}
+
+	appConsolePrintf(TEXT("heap snapshot %d: %d heaps, %d busy blocks, %I64u bytes%s\n"), (int32_t)HeapSnapshots.size() - 1,
+		(int32_t)Heaps.size(), (int32_t)Snapshot.GetBlocks().size(), Snapshot.GetTotalBytes(),
+		Snapshot.HasBackTraces() ? TEXT(", with allocation stacks") : TEXT(""));
+	if (!Snapshot.GetLfhUserBlocks().empty())
+	{
+		appConsolePrintf(TEXT("    LFH: %d subsegments, %I64u busy blocks, counted in their subsegments, not listed\n"),
+			(int32_t)Snapshot.GetLfhUserBlocks().size(), Snapshot.GetLfhBusyBlocks());
+	}
+	return FALSE;
+}
+
+BOOL FWinDebugger::Command_HeapDiff(const vector<wstring> &InTokens, const vector<wstring> &InSwitchs)
+{
+	// default: the last two snapshots
+	int32_t OldIndex = (int32_t)HeapSnapshots.size() - 2;
+	int32_t NewIndex = (int32_t)HeapSnapshots.size() - 1;
+	if (InTokens.size() >= 2)
+	{
+		OldIndex = appAtoi(InTokens[0].c_str());
+		NewIndex = appAtoi(InTokens[1].c_str());
+	}
+
+	if (OldIndex < 0 || NewIndex < 0 || OldIndex >= (int32_t)HeapSnapshots.size() || NewIndex >= (int32_t)HeapSnapshots.size())
+	{
+		appConsolePrintf(TEXT("need two heap snapshots, %d recorded.\n"), (int32_t)HeapSnapshots.size());
+		return FALSE;
+	}
+
+	FHeapSnapshotDiff Diff;
+	Diff.Compare(HeapSnapshots[OldIndex], HeapSnapshots[NewIndex]);
+
+	appConsolePrintf(TEXT("heap diff %d -> %d: new %I64d blocks, %I64d bytes; freed %I64d blocks, %I64d bytes\n"), OldIndex, NewIndex,
+		Diff.TotalNewBlocks, Diff.TotalNewBytes, Diff.TotalFreedBlocks, Diff.TotalFreedBytes);
+	if (Diff.LfhNewUserBlocks || Diff.LfhFreedUserBlocks || Diff.LfhNewBlocks || Diff.LfhFreedBlocks)
+	{
+		// LFH blocks have no stacks and are not walked one by one, their sizes are not in the groups below
+		appConsolePrintf(TEXT("LFH: +%I64d busy blocks, -%I64d busy blocks; subsegments +%I64d -%I64d\n"),
+			Diff.LfhNewBlocks, Diff.LfhFreedBlocks, Diff.LfhNewUserBlocks, Diff.LfhFreedUserBlocks);
+	}
+
+	const uint32_t kMaxGroups = 20;
+	const vector<FHeapSnapshotDiff::FGroup> &SizeGroups = Diff.GetSizeClassGroups();
+	appConsolePrintf(TEXT("by size class:\n"));
+	for (uint32_t k = 0; k < SizeGroups.size() && k < kMaxGroups; k++)
+	{
+		const FHeapSnapshotDiff::FGroup &Group = SizeGroups[k];
+		appConsolePrintf(TEXT("    [%10I64u, %10I64u): +%I64d blocks +%I64d bytes, -%I64d blocks -%I64d bytes\n"),
+			FHeapStatistics::GetSizeClassBase(Group.Key), FHeapStatistics::GetSizeClassBase(Group.Key + 1),
+			Group.NewBlocks, Group.NewBytes, Group.FreedBlocks, Group.FreedBytes);
+	} // end for k
+
+	const vector<FHeapSnapshotDiff::FGroup> &StackGroups = Diff.GetBackTraceGroups();
+	if (!StackGroups.empty())
+	{
+		appConsolePrintf(TEXT("by allocation stack (user-mode stack trace database index):\n"));
+		for (uint32_t k = 0; k < StackGroups.size() && k < kMaxGroups; k++)
+		{
+			const FHeapSnapshotDiff::FGroup &Group = StackGroups[k];
+			appConsolePrintf(TEXT("    stack %5d: +%I64d blocks +%I64d bytes, -%I64d blocks -%I64d bytes\n"),
+				Group.Key, Group.NewBlocks, Group.NewBytes, Group.FreedBlocks, Group.FreedBytes);
+		} // end for k
+	}
+
+	return FALSE;
+}
+
+BOOL FWinDebugger::Command_SearchSymbols(const vector<wstring> &InTokens, const vector<wstring> &InSwitchs)
+{
+	if (!DebuggeeCtx.pDbgEvent || DebuggeeCtx.hProcess == INVALID_HANDLE_VALUE)
+	{
+		return FALSE;
+	}
+
+	if (InTokens.size() < 1)
+	{
+		return FALSE;
+	}
+
+	// switches: -r regex, -n=count matches per page, -p=page from 1
+	bool bRegex = false;
+	size_t PageSize = 50;
+	size_t Page = 1;
+	for (size_t k = 0; k < InSwitchs.size(); k++)
+	{
+		const TCHAR *szSwitch = InSwitchs[k].c_str();
+		if (!appStricmp(szSwitch, TEXT("r")))              { bRegex = true; }
+		else if (!appStrnicmp(szSwitch, TEXT("n="), 2))  { PageSize = (size_t)appAtoi64(szSwitch + 2); }
+		else if (!appStrnicmp(szSwitch, TEXT("p="), 2))  { Page = (size_t)appAtoi64(szSwitch + 2); }
+	} // end for k
+	if (PageSize == 0) { PageSize = 50; }
+	if (Page == 0) { Page = 1; }
+
+	// module!pattern, the module part is a file name with or without extension
+	wstring ModulePattern;
+	wstring NamePattern = InTokens[0];
+	const size_t Bang = NamePattern.find(TEXT('!'));
+	if (Bang != wstring::npos && Bang > 0)
+	{
+		ModulePattern = NamePattern.substr(0, Bang);
+		NamePattern = NamePattern.substr(Bang + 1);
+	}
+
+	// symbol names are UTF-8
+	const int32_t Bytes = WideCharToMultiByte(CP_UTF8, 0, NamePattern.c_str(), -1, NULL, 0, NULL, NULL);
+	string Pattern(Bytes > 0 ? Bytes : 1, '\0');
+	WideCharToMultiByte(CP_UTF8, 0, NamePattern.c_str(), -1, &Pattern[0], Bytes, NULL, NULL);
+
+	FSymbolQuery Query;
+	if (!Query.Parse(Pattern.c_str(), bRegex))
+	{
+		appConsolePrintf(TEXT("bad regular expression %s\n"), NamePattern.c_str());
+		return FALSE;
+	}
+
+	const std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+	vector<FSymbolMatch> Matches;
+	const size_t Total = FWinStackTraceHelper::SearchSymbols(DebuggeeCtx.hProcess, ModulePattern, Query, (Page - 1) * PageSize, PageSize, Matches);
+	const double SearchMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+
+	for (size_t k = 0; k < Matches.size(); k++)
+	{
+		const FSymbolMatch &Match = Matches[k];
+		if (Match.Size)
+		{
+			appConsolePrintf(TEXT("%p %s!%s (%d bytes)\n"), (void*)(uintptr_t)Match.Address, Match.ModuleName.c_str(), Match.Name.c_str(), Match.Size);
+		}
+		else
+		{
+			appConsolePrintf(TEXT("%p %s!%s\n"), (void*)(uintptr_t)Match.Address, Match.ModuleName.c_str(), Match.Name.c_str());
+		}
+	} // end for k
+
+	const size_t PageCount = (Total + PageSize - 1) / PageSize;
+	appConsolePrintf(TEXT("%d matches, page %d of %d, %.2f ms\n"), (int32_t)Total, (int32_t)Page, (int32_t)PageCount, SearchMs);
+	return FALSE;
+}
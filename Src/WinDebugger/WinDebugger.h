@@ -10,6 +10,9 @@
 #include <string>
 #include <vector>
 
+#include "WinHeapSnapshot.h"
+#include "WinVisualizer.h"
+
 using namespace std;
 
 
@@ -44,6 +47,14 @@ protected:
 	VOID OnOutputDebugStringEvent(const DEBUG_EVENT &InDbgEvent);
 	VOID OnRipEvent(const DEBUG_EVENT &InDbgEvent);
 
+	// symbols of all modules of an attached process, in parallel
+	VOID LoadAttachedModules(DWORD InProcessId);
+
+	// evaluate the watches at a stop, print the ones whose bytes changed, or all of them
+	VOID DisplayWatches(BOOL bInAll);
+	// the types the watches kept for diffing live in the arenas of modules, forget them before those go
+	VOID ResetWatchLayouts();
+
 	// display exception brief information.
 	VOID DisplayException(uint32_t InProcessId, uint32_t InThreadId, const EXCEPTION_DEBUG_INFO &InException);
 
@@ -65,7 +76,14 @@ protected:
 	BOOL Command_ListSourceCode(const vector<wstring> &InTokens, const vector<wstring> &InSwitchs);
 	BOOL Command_ListGlobalVariables(const vector<wstring> &InTokens, const vector<wstring> &InSwitchs);
 	BOOL Command_ListLocalVariables(const vector<wstring> &InTokens, const vector<wstring> &InSwitchs);
+	BOOL Command_DisplayType(const vector<wstring> &InTokens, const vector<wstring> &InSwitchs);
+	BOOL Command_AggregateArray(const vector<wstring> &InTokens, const vector<wstring> &InSwitchs);
+	BOOL Command_Evaluate(const vector<wstring> &InTokens, const vector<wstring> &InSwitchs);
+	BOOL Command_Watch(const vector<wstring> &InTokens, const vector<wstring> &InSwitchs);
 	BOOL Command_StackTrace(const vector<wstring> &InTokens, const vector<wstring> &InSwitchs);
+	BOOL Command_HeapSnapshot(const vector<wstring> &InTokens, const vector<wstring> &InSwitchs);
+	BOOL Command_HeapDiff(const vector<wstring> &InTokens, const vector<wstring> &InSwitchs);
+	BOOL Command_SearchSymbols(const vector<wstring> &InTokens, const vector<wstring> &InSwitchs);
 
 	// command meta
 	typedef BOOL(FWinDebugger::*PtrCommandFunction)(const vector<wstring> &InTokens, const vector<wstring> &InSwitchs);
@@ -83,18 +101,37 @@ protected:
 		HANDLE				 hProcess;
 		const DEBUG_EVENT   *pDbgEvent;
 		BOOL				 bCatchFirstChanceException;
+		BOOL				 bAttaching;	// until the CREATE_PROCESS event of an attach
 
 		void Reset()
 		{
 			hProcess = INVALID_HANDLE_VALUE;
 			pDbgEvent = NULL;
 			bCatchFirstChanceException = FALSE;
+			bAttaching = FALSE;
 		}
 	};
 
 protected:
 	FDebuggeeContext	DebuggeeCtx;
 
+	// heapsnap results
+	vector<FHeapSnapshot>	HeapSnapshots;
+
+	// eval expressions, compiled once per function
+	FVisExpressionCache		ExpressionCache;
+
+	// watch list
+	struct FWatch
+	{
+		wstring				Text;
+		uint64_t			Hash;		// of the bytes of the value at the last stop
+		BOOL				bHasHash;	// FALSE until a stop evaluated it
+		const FSymTypeInfo	*pLastType;	// an aggregate with a layout plan, NULL for other values
+		vector<BYTE>		LastValue;	// its bytes at the last stop, to name the members that changed
+	};
+	vector<FWatch>			Watches;
+
 	// user commands table
 	static const FCommandMeta sUserCommands[];
 };
@@ -6,9 +6,14 @@
 #include "WinDebugger.h"
 #include "WinProcessHelper.h"
 #include "WinVariableTypeHelper.h"
+#include "WinStackTraceHelper.h"
+#include "WinRemoteMemory.h"
+#include "WinArrayStats.h"
+#include "WinVisualizer.h"
 
 #include <DbgHelp.h>
 #include <vector>
+#include <chrono>
 
 
 // variable information
@@ -21,7 +26,7 @@ struct FVariableInfo
 	uint64_t    Value;            // Value of symbol, ValuePresent should be 1
 	uint64_t    Address;          // Address of symbol including base address of module
 	uint32_t    Register;         // register holding value or pointer to value
-	std::wstring Name;            // Name of symbol
+	uint32_t    NameId;           // Name of symbol, in the name pool
 };
 
 struct FSymEnumContext
@@ -54,7 +59,7 @@ BOOL CALLBACK PsymEnumeratesymbolsCallback(PSYMBOL_INFO pSymInfo, ULONG SymbolSi
 	SymVariable.Value = pSymInfo->Value;
 	SymVariable.Address = pSymInfo->Address;
 	SymVariable.Register = pSymInfo->Register;
-	SymVariable.Name = pSymInfo->Name;
+	SymVariable.NameId = FSymTypeInfoHelper::GetNamePool().Intern(pSymInfo->Name, pSymInfo->NameLen);
 
 	return TRUE;
 }
@@ -151,12 +156,10 @@ static std::wstring GetSymFlagsString(uint32_t InFlags)
 	return szDesc;
 }
 
-static void* CalculateVariableAbsAddress(const FVariableInfo &InVariable, HANDLE InProcess, const CONTEXT &InContext)
+#if !defined(_M_X64)
+// the base regrel locals are relative to
+static DWORD GetFrameBase(HANDLE InProcess, const CONTEXT &InContext)
 {
-	if ((InVariable.Flags & SYMFLAG_REGREL) == 0) {
-		return (void*)(InVariable.Address);
-	}
-
 	//ǰEIPָĵһָEBPֵȻ
 	//һģԴʱʹEBPӦʹESP-4ΪŵĻַ
 
@@ -167,15 +170,38 @@ static void* CalculateVariableAbsAddress(const FVariableInfo &InVariable, HANDLE
 	SymFromAddr(InProcess, InContext.Eip, &displacement, &symbolInfo);
 	//ǺĵһָʹEBP
 	if (displacement == 0) {
-		return (void *)(InContext.Esp - 4 + InVariable.Address);
+		return InContext.Esp - 4;
+	}
+
+	return InContext.Ebp;
+}
+#endif
+
+static void* CalculateVariableAbsAddress(const FVariableInfo &InVariable, HANDLE InProcess, const CONTEXT &InContext)
+{
+	if ((InVariable.Flags & SYMFLAG_REGREL) == 0) {
+		return (void*)(InVariable.Address);
 	}
 
-	return (void *)(InContext.Ebp + InVariable.Address);
+#if defined(_M_X64)
+	// relative to rsp, or to rbp in a function with a frame pointer. the offset is signed
+	(void)InProcess;
+	const DWORD64 Base = InVariable.Register == CV_AMD64_RBP ? InContext.Rbp : InContext.Rsp;
+	return (void *)(Base + (int32_t)InVariable.Address);
+#else
+	return (void *)(GetFrameBase(InProcess, InContext) + InVariable.Address);
+#endif
 }
 
 // ʾ
-static VOID DisplayVariables(const std::vector<FVariableInfo> &InVariables, HANDLE InProcess, const CONTEXT &InContext)
+static VOID DisplayVariables(const std::vector<FVariableInfo> &InVariables, HANDLE InProcess, const CONTEXT &InContext, uint32_t InDerefLevels)
 {
+	// one buffer for all the values
+	FFormatBuffer ValueText;
+	// the debuggee is stopped, what one variable read stays valid for the next
+	FProcessMemory ProcessMemory(InProcess);
+	FRemotePageCache PageCache(ProcessMemory);
+	std::vector<FSymPointee> Pointees;
 	for (size_t k = 0; k < InVariables.size(); k++)
 	{
 		const FVariableInfo &SymVariable = InVariables[k];
@@ -183,19 +209,32 @@ static VOID DisplayVariables(const std::vector<FVariableInfo> &InVariables, HAND
 #if 0
 		appConsolePrintf(TEXT("ModBase:0x%08x, TypeIndex:%d, Size:%d, Flags:0x%08x, Value:0x%08x, Address:0x%08x, Register:%d, Name:%s\n"),
 			(uint32_t)SymVariable.ModBase, (uint32_t)SymVariable.TypeIndex, (uint32_t)SymVariable.Size, (uint32_t)SymVariable.Flags,
-			(uint32_t)SymVariable.Value, (uint32_t)SymVariable.Address, (uint32_t)SymVariable.Register, SymVariable.Name.c_str());
+			(uint32_t)SymVariable.Value, (uint32_t)SymVariable.Address, (uint32_t)SymVariable.Register, FSymTypeInfoHelper::GetNamePool().GetString(SymVariable.NameId).c_str());
 		appConsolePrintf(TEXT("Flags: %s\n"), GetSymFlagsString(SymVariable.Flags).c_str());
 #else
 		void *DataAbsAddr = CalculateVariableAbsAddress(SymVariable, InProcess, InContext);
 		void *pBuffer = new BYTE[SymVariable.Size];
 		if (pBuffer && ReadProcessMemory(InProcess, DataAbsAddr, pBuffer, SymVariable.Size, NULL))
 		{
-			appConsolePrintf(TEXT("%s"), SymVariable.Name.c_str());
+			appConsolePrintf(TEXT("%s"), FSymTypeInfoHelper::GetNamePool().GetString(SymVariable.NameId).c_str());
 			FSymTypeInfo* pSymTypeInfo = FSymTypeInfoHelper::BuildSymTypeInfo(InProcess, SymVariable.ModBase, SymVariable.TypeIndex);
 			if (pSymTypeInfo)
 			{
+				// each variable gets its own budget, a large one does not hide the ones after it
+				FSymExpandBudget Budget;
+				Budget.pPointees = InDerefLevels > 0 ? &Pointees : NULL;
+				Budget.pMemory = &PageCache;
+				ValueText.Clear();
+				pSymTypeInfo->FormatValue(pBuffer, Budget, ValueText);
 				appConsolePrintf(TEXT("(%s): "), pSymTypeInfo->TypeName().c_str());
-				appConsolePrintf(TEXT(" %s\n"), pSymTypeInfo->FormatValue(pBuffer).c_str());
+				appConsolePrintf(TEXT(" %s\n"), ValueText.c_str());
+
+				if (!Pointees.empty())
+				{
+					ValueText.Clear();
+					FSymTypeInfoHelper::FormatPointees(PageCache, Pointees, InDerefLevels, Budget, ValueText);
+					appConsolePrintf(TEXT("%s"), ValueText.c_str());
+				}
 			}
 		}
 		delete pBuffer;
@@ -203,6 +242,460 @@ static VOID DisplayVariables(const std::vector<FVariableInfo> &InVariables, HAND
 	} // end for k
 }
 
+// -d=N / -r=N: pointer levels to follow
+static uint32_t ParseDerefLevels(const vector<wstring> &InSwitchs, const TCHAR *InSwitch, uint32_t InDefault)
+{
+	const size_t SwitchLen = _tcslen(InSwitch);
+	for (size_t k = 0; k < InSwitchs.size(); k++)
+	{
+		const TCHAR *szSwitch = InSwitchs[k].c_str();
+		if (!appStrnicmp(szSwitch, InSwitch, SwitchLen))
+		{
+			return (uint32_t)appAtoi64(szSwitch + SwitchLen);
+		}
+	} // end for k
+
+	return InDefault;
+}
+
+// globals of the module at the current instruction
+static BOOL EnumGlobalVariables(HANDLE InProcess, const CONTEXT &InContext, const TCHAR *szExpression, FSymEnumContext &OutEnumCtx)
+{
+	DWORD64 ModuleBaseAddr = SymGetModuleBase64(InProcess, FWinStackTraceHelper::GetProgramCounter(InContext));
+	if (!ModuleBaseAddr)
+	{
+		TRACE_ERROR(TEXT("SymGetModuleBase64 Failed."));
+		return FALSE;
+	}
+
+	return SymEnumSymbols(InProcess, ModuleBaseAddr, szExpression, &PsymEnumeratesymbolsCallback, (void*)&OutEnumCtx);
+}
+
+// locals of the function at the current instruction
+static BOOL EnumLocalVariables(HANDLE InProcess, const CONTEXT &InContext, const TCHAR *szExpression, FSymEnumContext &OutEnumCtx)
+{
+	IMAGEHLP_STACK_FRAME StackFrame = { 0 };
+	StackFrame.InstructionOffset = FWinStackTraceHelper::GetProgramCounter(InContext);
+
+	if (!SymSetContext(InProcess, &StackFrame, NULL) && (GetLastError() != ERROR_SUCCESS))
+	{
+		TRACE_ERROR(TEXT("SymSetContext Failed."));
+		return FALSE;
+	}
+
+	return SymEnumSymbols(InProcess, 0, szExpression, &PsymEnumeratesymbolsCallback, (void*)&OutEnumCtx);
+}
+
+// name[start:end], name[start:], name,count
+struct FArrayView
+{
+	std::wstring	Name;
+	bool			bHasRange;
+	uint64_t		Start;
+	uint64_t		End;		// exclusive, kOpenEnd if not given
+};
+
+// where the elements of a view are in the debuggee
+struct FArrayRange
+{
+	uint64_t		Address;		// of the first element shown
+	FSymTypeInfo	*pElementType;
+	uint32_t		ElementLength;
+	uint64_t		FirstIndex;
+	uint64_t		Count;
+};
+
+namespace NSArrayView
+{
+	const uint64_t kOpenEnd = ~0ull;
+	// elements are read this many bytes at a time
+	const uint32_t kChunkBytes = 4 * 1024 * 1024;
+}
+
+static bool ParseViewIndex(const std::wstring &InText, uint64_t InDefault, uint64_t &OutValue)
+{
+	if (InText.empty())
+	{
+		OutValue = InDefault;
+		return true;
+	}
+	TCHAR *pEnd = NULL;
+	OutValue = appStrtoi64(InText.c_str(), &pEnd, 0);
+	return pEnd && *pEnd == TEXT('\0');
+}
+
+static bool ParseArrayView(const std::wstring &InToken, FArrayView &OutView)
+{
+	OutView.bHasRange = false;
+	OutView.Start = 0;
+	OutView.End = NSArrayView::kOpenEnd;
+
+	const size_t Comma = InToken.find(TEXT(','));
+	if (Comma != std::wstring::npos)
+	{
+		OutView.Name = InToken.substr(0, Comma);
+		OutView.bHasRange = true;
+		return !OutView.Name.empty() && ParseViewIndex(InToken.substr(Comma + 1), NSArrayView::kOpenEnd, OutView.End);
+	}
+
+	const size_t Bracket = InToken.find(TEXT('['));
+	OutView.Name = InToken.substr(0, Bracket);
+	if (Bracket == std::wstring::npos)
+	{
+		return !OutView.Name.empty();
+	}
+
+	const size_t Colon = InToken.find(TEXT(':'), Bracket);
+	if (OutView.Name.empty() || Colon == std::wstring::npos || InToken[InToken.size() - 1] != TEXT(']'))
+	{
+		return false;
+	}
+	OutView.bHasRange = true;
+	return ParseViewIndex(InToken.substr(Bracket + 1, Colon - Bracket - 1), 0, OutView.Start)
+		&& ParseViewIndex(InToken.substr(Colon + 1, InToken.size() - Colon - 2), NSArrayView::kOpenEnd, OutView.End);
+}
+
+// an array variable, or a pointer with the element count given by the view
+static bool ResolveArrayView(const FArrayView &InView, const FVariableInfo &InVariable, HANDLE InProcess, const CONTEXT &InContext, FArrayRange &OutRange)
+{
+	FSymTypeInfo *pType = FSymTypeInfoHelper::BuildSymTypeInfo(InProcess, InVariable.ModBase, InVariable.TypeIndex);
+	const FSymTypeInfo *pRealType = pType ? pType->GetRealType() : NULL;
+	const SymTypeKindEnum Kind = pRealType ? pRealType->GetKind() : stkUnknown;
+	if (Kind != stkArray && Kind != stkPointer)
+	{
+		appConsolePrintf(TEXT("%s: not an array or a pointer.\n"), InView.Name.c_str());
+		return false;
+	}
+
+	OutRange.pElementType = pRealType->GetElementType();
+	OutRange.ElementLength = OutRange.pElementType ? OutRange.pElementType->GetRealType()->GetLength() : 0;
+	if (OutRange.ElementLength == 0)
+	{
+		appConsolePrintf(TEXT("%s: element size unknown.\n"), InView.Name.c_str());
+		return false;
+	}
+
+	uint64_t ElementCount = NSArrayView::kOpenEnd;
+	uint64_t Address = (uint64_t)CalculateVariableAbsAddress(InVariable, InProcess, InContext);
+	if (Kind == stkArray)
+	{
+		ElementCount = pRealType->GetLength() / OutRange.ElementLength;
+	}
+	else
+	{
+		// the pointer as the debuggee has it, 4 or 8 bytes
+		uint64_t Pointer = 0;
+		if (InView.End == NSArrayView::kOpenEnd)
+		{
+			appConsolePrintf(TEXT("%s: a pointer needs a count, %s,count or %s[start:end].\n"), InView.Name.c_str(), InView.Name.c_str(), InView.Name.c_str());
+			return false;
+		}
+		if (!ReadProcessMemory(InProcess, (LPCVOID)Address, &Pointer, pRealType->GetLength(), NULL))
+		{
+			appConsolePrintf(TEXT("%s: unreadable.\n"), InView.Name.c_str());
+			return false;
+		}
+		Address = Pointer;
+	}
+
+	const uint64_t End = InView.End < ElementCount ? InView.End : ElementCount;
+	OutRange.FirstIndex = InView.Start < End ? InView.Start : End;
+	OutRange.Count = End - OutRange.FirstIndex;
+	OutRange.Address = Address + OutRange.FirstIndex * OutRange.ElementLength;
+	return true;
+}
+
+// the variable of a view, a local hides a global of the same name
+static bool FindViewVariable(HANDLE InProcess, const CONTEXT &InContext, const FArrayView &InView, FVariableInfo &OutVariable)
+{
+	FSymEnumContext EnumCtx;
+	EnumLocalVariables(InProcess, InContext, InView.Name.c_str(), EnumCtx);
+	if (EnumCtx.Variables.empty())
+	{
+		EnumGlobalVariables(InProcess, InContext, InView.Name.c_str(), EnumCtx);
+	}
+	if (EnumCtx.Variables.empty())
+	{
+		appConsolePrintf(TEXT("%s: no such variable.\n"), InView.Name.c_str());
+		return false;
+	}
+
+	OutVariable = EnumCtx.Variables[0];
+	return true;
+}
+
+// every element of the range, read a chunk at a time
+static VOID DisplayArrayRange(const FArrayView &InView, const FArrayRange &InRange, HANDLE InProcess)
+{
+	appConsolePrintf(TEXT("%s[%I64u:%I64u](%s):\n"), InView.Name.c_str(), InRange.FirstIndex, InRange.FirstIndex + InRange.Count,
+		InRange.pElementType->TypeName().c_str());
+
+	FProcessMemory ProcessMemory(InProcess);
+	FRemotePageCache PageCache(ProcessMemory);
+	FFormatBuffer ValueText;
+	// the elements asked for are all shown, aggregates in them as deep as usual
+	FSymExpandBudget Budget(4, 0xFFFFFFFF);
+	Budget.pMemory = &PageCache;
+
+	const uint64_t ChunkCount = NSArrayView::kChunkBytes / InRange.ElementLength ? NSArrayView::kChunkBytes / InRange.ElementLength : 1;
+	std::vector<BYTE> Chunk;
+	for (uint64_t Done = 0; Done < InRange.Count; Done += ChunkCount)
+	{
+		const uint64_t Count = InRange.Count - Done < ChunkCount ? InRange.Count - Done : ChunkCount;
+		const uint64_t Address = InRange.Address + Done * InRange.ElementLength;
+		Chunk.resize((size_t)(Count * InRange.ElementLength));
+		if (!ProcessMemory.ReadMemory(Address, &Chunk[0], Chunk.size()))
+		{
+			appConsolePrintf(TEXT("[%I64u]: unreadable at 0x%08I64x\n"), InRange.FirstIndex + Done, Address);
+			break;
+		}
+
+		ValueText.Clear();
+		InRange.pElementType->FormatElements(&Chunk[0], (uint32_t)Count, InRange.ElementLength, InRange.FirstIndex + Done, Budget, ValueText);
+		appConsolePrintf(TEXT("%s"), ValueText.c_str());
+	} // end for Done
+}
+
+// register numbers of the symbols. x64 has CV_AMD64_ for the full registers and keeps the x86
+// numbers for their low 32 bits.
+static const struct
+{
+	uint32_t		CvRegister;
+	VisRegisterEnum	Register;
+} sCvRegisters[] =
+{
+#if defined(_M_X64)
+	{ CV_AMD64_RAX, vrEax },
+	{ CV_AMD64_RBX, vrEbx },
+	{ CV_AMD64_RCX, vrEcx },
+	{ CV_AMD64_RDX, vrEdx },
+	{ CV_AMD64_RSI, vrEsi },
+	{ CV_AMD64_RDI, vrEdi },
+	{ CV_AMD64_RBP, vrEbp },
+	{ CV_AMD64_RSP, vrEsp },
+	{ CV_AMD64_R8, vrR8 },
+	{ CV_AMD64_R9, vrR9 },
+	{ CV_AMD64_R10, vrR10 },
+	{ CV_AMD64_R11, vrR11 },
+	{ CV_AMD64_R12, vrR12 },
+	{ CV_AMD64_R13, vrR13 },
+	{ CV_AMD64_R14, vrR14 },
+	{ CV_AMD64_R15, vrR15 },
+	{ CV_AMD64_EBP, vrEbp },
+#else
+	{ CV_REG_EBP, vrFrame },	// read as the frame base the way dt does
+#endif
+	{ CV_REG_EAX, vrEax },
+	{ CV_REG_ECX, vrEcx },
+	{ CV_REG_EDX, vrEdx },
+	{ CV_REG_EBX, vrEbx },
+	{ CV_REG_ESP, vrEsp },
+	{ CV_REG_ESI, vrEsi },
+	{ CV_REG_EDI, vrEdi },
+	{ CV_REG_EIP, vrEip },
+};
+
+// the names eval expressions see at a stop: the locals of the function, then the globals and types
+// of its module.
+class FDebuggeeScope : public FVisScope
+{
+public:
+	FDebuggeeScope(HANDLE InProcess, const CONTEXT &InContext)
+		: hProcess(InProcess)
+		, Context(InContext)
+		, ModuleBase(SymGetModuleBase64(InProcess, FWinStackTraceHelper::GetProgramCounter(InContext)))
+		, ScopeKey(ModuleBase)
+	{
+		DWORD64 Displacement = 0;
+		SYMBOL_INFO SymbolInfo = { 0 };
+		SymbolInfo.SizeOfStruct = sizeof(SYMBOL_INFO);
+		if (SymFromAddr(InProcess, FWinStackTraceHelper::GetProgramCounter(InContext), &Displacement, &SymbolInfo))
+		{
+			ScopeKey = SymbolInfo.Address;
+		}
+	}
+
+	// the function at the instruction, the module if it has no symbol
+	uint64_t GetScopeKey() const { return ScopeKey; }
+	uint64_t GetModuleBase() const { return ModuleBase; }
+
+	virtual bool FindName(const std::wstring &InName, FVisBinding &OutBinding) const override
+	{
+		FSymEnumContext EnumCtx;
+		EnumLocalVariables(hProcess, Context, InName.c_str(), EnumCtx);
+		if (!FindVariable(EnumCtx, InName) && ModuleBase)
+		{
+			EnumGlobalVariables(hProcess, Context, InName.c_str(), EnumCtx);
+		}
+		const FVariableInfo *pVariable = FindVariable(EnumCtx, InName);
+		if (!pVariable)
+		{
+			return false;
+		}
+
+		OutBinding.pType = FSymTypeInfoHelper::BuildSymTypeInfo(hProcess, pVariable->ModBase, pVariable->TypeIndex);
+		OutBinding.Register = vrCount;
+		OutBinding.Offset = (int64_t)pVariable->Address;
+		if (pVariable->Flags & SYMFLAG_VALUEPRESENT)
+		{
+			OutBinding.Kind = vbConstant;
+			OutBinding.Offset = (int64_t)pVariable->Value;
+			return true;
+		}
+		if (pVariable->Flags & (SYMFLAG_REGREL | SYMFLAG_REGISTER))
+		{
+			for (uint32_t k = 0; k < XARRAY_COUNT(sCvRegisters); k++)
+			{
+				if (sCvRegisters[k].CvRegister == pVariable->Register)
+				{
+					OutBinding.Register = sCvRegisters[k].Register;
+				}
+			} // end for k
+			OutBinding.Kind = (pVariable->Flags & SYMFLAG_REGREL) ? vbRegisterRelative : vbRegister;
+			// the offset is signed
+			OutBinding.Offset = (int32_t)pVariable->Address;
+			return OutBinding.Register != vrCount;
+		}
+		OutBinding.Kind = vbAddress;
+		return (pVariable->Flags & (SYMFLAG_TLSREL | SYMFLAG_FRAMEREL)) == 0;
+	}
+
+	virtual const FSymTypeInfo* FindType(const std::wstring &InName) const override
+	{
+		if (!ModuleBase)
+		{
+			return NULL;
+		}
+		FSymTypeInfo *pType = FSymTypeInfoHelper::BuildPrimitiveType(hProcess, ModuleBase, InName);
+		if (pType)
+		{
+			return pType;
+		}
+
+		// the symbol cache answers without a dbghelp name search
+		DWORD64 TypeModule = 0;
+		DWORD TypeId = 0;
+		if (FWinStackTraceHelper::FindCachedType(hProcess, ModuleBase, InName, TypeModule, TypeId))
+		{
+			return FSymTypeInfoHelper::BuildSymTypeInfo(hProcess, TypeModule, TypeId);
+		}
+
+		SYMBOL_INFO SymbolInfo = { 0 };
+		SymbolInfo.SizeOfStruct = sizeof(SYMBOL_INFO);
+		if (!SymGetTypeFromName(hProcess, ModuleBase, InName.c_str(), &SymbolInfo))
+		{
+			return NULL;
+		}
+		return FSymTypeInfoHelper::BuildSymTypeInfo(hProcess, ModuleBase, SymbolInfo.TypeIndex);
+	}
+
+private:
+	// symbol masks ignore case, names do not
+	static const FVariableInfo* FindVariable(const FSymEnumContext &InEnumCtx, const std::wstring &InName)
+	{
+		for (size_t k = 0; k < InEnumCtx.Variables.size(); k++)
+		{
+			if (FSymTypeInfoHelper::GetNamePool().GetString(InEnumCtx.Variables[k].NameId) == InName)
+			{
+				return &InEnumCtx.Variables[k];
+			}
+		} // end for k
+		return NULL;
+	}
+
+	HANDLE			hProcess;
+	const CONTEXT	&Context;
+	uint64_t		ModuleBase;
+	uint64_t		ScopeKey;
+};
+
+// the registers of a stop, as expressions read them
+static void ReadVisRegisters(HANDLE InProcess, const CONTEXT &InContext, uint64_t OutRegisters[vrCount])
+{
+#if defined(_M_X64)
+	OutRegisters[vrEax] = InContext.Rax;
+	OutRegisters[vrEbx] = InContext.Rbx;
+	OutRegisters[vrEcx] = InContext.Rcx;
+	OutRegisters[vrEdx] = InContext.Rdx;
+	OutRegisters[vrEsi] = InContext.Rsi;
+	OutRegisters[vrEdi] = InContext.Rdi;
+	OutRegisters[vrEbp] = InContext.Rbp;
+	OutRegisters[vrEsp] = InContext.Rsp;
+	OutRegisters[vrEip] = InContext.Rip;
+	OutRegisters[vrEflags] = InContext.EFlags;
+	OutRegisters[vrR8] = InContext.R8;
+	OutRegisters[vrR9] = InContext.R9;
+	OutRegisters[vrR10] = InContext.R10;
+	OutRegisters[vrR11] = InContext.R11;
+	OutRegisters[vrR12] = InContext.R12;
+	OutRegisters[vrR13] = InContext.R13;
+	OutRegisters[vrR14] = InContext.R14;
+	OutRegisters[vrR15] = InContext.R15;
+	// x64 locals are bound to rsp or rbp themselves
+	OutRegisters[vrFrame] = InContext.Rsp;
+	(void)InProcess;
+#else
+	OutRegisters[vrEax] = InContext.Eax;
+	OutRegisters[vrEbx] = InContext.Ebx;
+	OutRegisters[vrEcx] = InContext.Ecx;
+	OutRegisters[vrEdx] = InContext.Edx;
+	OutRegisters[vrEsi] = InContext.Esi;
+	OutRegisters[vrEdi] = InContext.Edi;
+	OutRegisters[vrEbp] = InContext.Ebp;
+	OutRegisters[vrEsp] = InContext.Esp;
+	OutRegisters[vrEip] = InContext.Eip;
+	OutRegisters[vrEflags] = InContext.EFlags;
+	OutRegisters[vrFrame] = GetFrameBase(InProcess, InContext);
+	for (uint32_t k = vrR8; k <= vrR15; k++)
+	{
+		OutRegisters[k] = 0;
+	} // end for k
+#endif
+}
+
+// "text(type): value", InContext is that of the stop
+static void FormatEvaluation(const std::wstring &InText, const FVisExpression &InExpression, const FVisContext &InContext, FFormatBuffer &OutText)
+{
+	OutText.Append(InText);
+	if (!InExpression.IsValid())
+	{
+		OutText.Append(TEXT(": does not compile here\n"));
+		return;
+	}
+
+	if (InExpression.GetType())
+	{
+		OutText.Append(TEXT('('));
+		OutText.Append(InExpression.GetType()->TypeName());
+		OutText.Append(TEXT(')'));
+	}
+	OutText.Append(TEXT(": "), 2);
+	FSymExpandBudget Budget;
+	Budget.pMemory = InContext.pMemory;
+	InExpression.FormatValue(InContext, Budget, OutText);
+	OutText.Append(TEXT('\n'));
+}
+
+// FNV-1a
+static uint64_t HashValueBytes(const BYTE *InData, size_t InBytes, uint64_t InHash = 14695981039346656037ull)
+{
+	for (size_t k = 0; k < InBytes; k++)
+	{
+		InHash = (InHash ^ InData[k]) * 1099511628211ull;
+	} // end for k
+	return InHash;
+}
+
+namespace NSWatch
+{
+	// values larger than this are compared by their first bytes
+	const uint32_t kMaxHashBytes = 64 * 1024;
+	// a value that does not evaluate, or is not readable
+	const uint64_t kBadValueHash = 0;
+	// changed members named under a watch, the rest are counted
+	const size_t kMaxChangedPaths = 8;
+}
+
 // list global variables in current module.
 BOOL FWinDebugger::Command_ListGlobalVariables(const vector<wstring> &InTokens, const vector<wstring> &InSwitchs)
 {
@@ -221,27 +714,173 @@ BOOL FWinDebugger::Command_ListGlobalVariables(const vector<wstring> &InTokens,
 	ThreadContext.ContextFlags = CONTEXT_CONTROL;
 	if (GetThreadContext(hThread, &ThreadContext))
 	{
-		DWORD64 ModuleBaseAddr = SymGetModuleBase64(DebuggeeCtx.hProcess, ThreadContext.Eip);
-		if (!ModuleBaseAddr)
+		const TCHAR *szExpression = NULL;
+		if (InTokens.size() >= 1)
+		{
+			szExpression = InTokens[0].c_str();
+		}
+
+		FSymEnumContext EnumCtx;
+		if (EnumGlobalVariables(DebuggeeCtx.hProcess, ThreadContext, szExpression, EnumCtx))
+		{
+			DisplayVariables(EnumCtx.Variables, DebuggeeCtx.hProcess, ThreadContext, ParseDerefLevels(InSwitchs, TEXT("d="), 0));
+		}
+		else
+		{
+			TRACE_ERROR(TEXT("List global variables."));
+		}
+	}
+
+	CloseHandle(hThread);
+	return FALSE;
+}
+
+BOOL FWinDebugger::Command_ListLocalVariables(const vector<wstring> &InTokens, const vector<wstring> &InSwitchs)
+{
+	if (!DebuggeeCtx.pDbgEvent || DebuggeeCtx.hProcess == INVALID_HANDLE_VALUE)
+	{
+		return FALSE;
+	}
+
+	HANDLE hThread = OpenThread(THREAD_ALL_ACCESS, FALSE, DebuggeeCtx.pDbgEvent->dwThreadId);
+	if (hThread == NULL)
+	{
+		return FALSE;
+	}
+
+	CONTEXT ThreadContext;
+	ThreadContext.ContextFlags = CONTEXT_CONTROL;
+	if (GetThreadContext(hThread, &ThreadContext))
+	{
+		const TCHAR *szExpression = NULL;
+		if (InTokens.size() >= 1)
+		{
+			szExpression = InTokens[0].c_str();
+		}
+
+		FSymEnumContext EnumCtx;
+		if (EnumLocalVariables(DebuggeeCtx.hProcess, ThreadContext, szExpression, EnumCtx))
+		{
+			DisplayVariables(EnumCtx.Variables, DebuggeeCtx.hProcess, ThreadContext, ParseDerefLevels(InSwitchs, TEXT("d="), 0));
+		}
+		else
+		{
+			TRACE_ERROR(TEXT("List local variables."));
+		}
+	}
+
+	CloseHandle(hThread);
+	return FALSE;
+}
+
+// display a local, or a global of the current module, following its pointers.
+// name[start:end] and pointer,count show elements of an array or a buffer.
+BOOL FWinDebugger::Command_DisplayType(const vector<wstring> &InTokens, const vector<wstring> &InSwitchs)
+{
+	if (!DebuggeeCtx.pDbgEvent || DebuggeeCtx.hProcess == INVALID_HANDLE_VALUE)
+	{
+		return FALSE;
+	}
+	FArrayView View;
+	if (InTokens.size() < 1 || !ParseArrayView(InTokens[0], View))
+	{
+		TRACE_ERROR(TEXT("dt: variable name expected."));
+		return FALSE;
+	}
+
+	HANDLE hThread = OpenThread(THREAD_ALL_ACCESS, FALSE, DebuggeeCtx.pDbgEvent->dwThreadId);
+	if (hThread == NULL)
+	{
+		return FALSE;
+	}
+
+	CONTEXT ThreadContext;
+	ThreadContext.ContextFlags = CONTEXT_CONTROL;
+	FVariableInfo Variable;
+	if (GetThreadContext(hThread, &ThreadContext) && FindViewVariable(DebuggeeCtx.hProcess, ThreadContext, View, Variable))
+	{
+		FArrayRange Range;
+		if (!View.bHasRange)
+		{
+			DisplayVariables(std::vector<FVariableInfo>(1, Variable), DebuggeeCtx.hProcess, ThreadContext, ParseDerefLevels(InSwitchs, TEXT("r="), 1));
+		}
+		else if (ResolveArrayView(View, Variable, DebuggeeCtx.hProcess, ThreadContext, Range))
+		{
+			DisplayArrayRange(View, Range, DebuggeeCtx.hProcess);
+		}
+	}
+
+	CloseHandle(hThread);
+	return FALSE;
+}
+
+// min, max, sum, mean, NaN and zero counts of the primitive elements of an array or a buffer.
+BOOL FWinDebugger::Command_AggregateArray(const vector<wstring> &InTokens, const vector<wstring> &InSwitchs)
+{
+	if (!DebuggeeCtx.pDbgEvent || DebuggeeCtx.hProcess == INVALID_HANDLE_VALUE)
+	{
+		return FALSE;
+	}
+	FArrayView View;
+	if (InTokens.size() < 1 || !ParseArrayView(InTokens[0], View))
+	{
+		TRACE_ERROR(TEXT("agg: variable name expected."));
+		return FALSE;
+	}
+
+	HANDLE hThread = OpenThread(THREAD_ALL_ACCESS, FALSE, DebuggeeCtx.pDbgEvent->dwThreadId);
+	if (hThread == NULL)
+	{
+		return FALSE;
+	}
+
+	CONTEXT ThreadContext;
+	ThreadContext.ContextFlags = CONTEXT_CONTROL;
+	FVariableInfo Variable;
+	FArrayRange Range;
+	if (GetThreadContext(hThread, &ThreadContext) && FindViewVariable(DebuggeeCtx.hProcess, ThreadContext, View, Variable)
+		&& ResolveArrayView(View, Variable, DebuggeeCtx.hProcess, ThreadContext, Range))
+	{
+		const FSymTypeInfo *pElementType = Range.pElementType->GetRealType();
+		const CPrimitiveTypeEnum PrimitiveType = pElementType->GetKind() == stkPrimitive ? static_cast<const FSymPrimitiveType*>(pElementType)->GetPrimitiveType() : cbtNone;
+		if (!FArrayStats::IsSupported(PrimitiveType))
 		{
-			TRACE_ERROR(TEXT("SymGetModuleBase64 Failed."));
+			appConsolePrintf(TEXT("%s: elements of type %s have no statistics.\n"), View.Name.c_str(), Range.pElementType->TypeName().c_str());
 		}
 		else
 		{
-			const TCHAR *szExpression = NULL;
-			if (InTokens.size() >= 1)
+			// large reads straight from the debuggee, the values are looked at once
+			const std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+			FProcessMemory ProcessMemory(DebuggeeCtx.hProcess);
+			FArrayStats Stats(PrimitiveType);
+			const uint64_t ChunkCount = NSArrayView::kChunkBytes / Range.ElementLength;
+			std::vector<BYTE> Chunk((size_t)(ChunkCount * Range.ElementLength));
+			for (uint64_t Done = 0; Done < Range.Count; Done += ChunkCount)
 			{
-				szExpression = InTokens[0].c_str();
-			}
+				const uint64_t Count = Range.Count - Done < ChunkCount ? Range.Count - Done : ChunkCount;
+				const uint64_t Address = Range.Address + Done * Range.ElementLength;
+				if (!ProcessMemory.ReadMemory(Address, &Chunk[0], (size_t)(Count * Range.ElementLength)))
+				{
+					appConsolePrintf(TEXT("[%I64u]: unreadable at 0x%08I64x, the elements before it are counted\n"), Range.FirstIndex + Done, Address);
+					break;
+				}
+				Stats.Accumulate(&Chunk[0], (size_t)Count);
+			} // end for Done
+			const double ElapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
 
-			FSymEnumContext EnumCtx;
-			if (SymEnumSymbols(DebuggeeCtx.hProcess, ModuleBaseAddr, szExpression, &PsymEnumeratesymbolsCallback, (void*)&EnumCtx))
+			appConsolePrintf(TEXT("%s[%I64u:%I64u](%s): %I64u values in %.1f ms\n"), View.Name.c_str(), Range.FirstIndex, Range.FirstIndex + Range.Count,
+				Range.pElementType->TypeName().c_str(), Stats.Count, ElapsedMs);
+			if (Stats.IsFloat())
 			{
-				DisplayVariables(EnumCtx.Variables, DebuggeeCtx.hProcess, ThreadContext);
+				appConsolePrintf(TEXT("  min %g  max %g  sum %g  mean %g\n"), Stats.FloatMin, Stats.FloatMax, Stats.FloatSum, Stats.GetMean());
+				appConsolePrintf(TEXT("  NaN %I64u  zero %I64u\n"), Stats.NaNCount, Stats.ZeroCount);
 			}
 			else
 			{
-				TRACE_ERROR(TEXT("List global variables."));
+				const TCHAR *szFormat = PrimitiveType == cbtULongLong
+					? TEXT("  min %I64u  max %I64u  sum %I64u  mean %g\n") : TEXT("  min %I64d  max %I64d  sum %I64d  mean %g\n");
+				appConsolePrintf(szFormat, Stats.IntMin, Stats.IntMax, Stats.IntSum, Stats.GetMean());
+				appConsolePrintf(TEXT("  zero %I64u\n"), Stats.ZeroCount);
 			}
 		}
 	}
@@ -250,12 +889,26 @@ BOOL FWinDebugger::Command_ListGlobalVariables(const vector<wstring> &InTokens,
 	return FALSE;
 }
 
-BOOL FWinDebugger::Command_ListLocalVariables(const vector<wstring> &InTokens, const vector<wstring> &InSwitchs)
+// a C expression over the variables and registers of the stop. the compiled expression is kept for
+// the next stop in the same function.
+BOOL FWinDebugger::Command_Evaluate(const vector<wstring> &InTokens, const vector<wstring> &InSwitchs)
 {
 	if (!DebuggeeCtx.pDbgEvent || DebuggeeCtx.hProcess == INVALID_HANDLE_VALUE)
 	{
 		return FALSE;
 	}
+	if (InTokens.size() < 1)
+	{
+		TRACE_ERROR(TEXT("eval: expression expected."));
+		return FALSE;
+	}
+
+	wstring Text = InTokens[0];
+	for (size_t k = 1; k < InTokens.size(); k++)
+	{
+		Text += TEXT(' ');
+		Text += InTokens[k];
+	} // end for k
 
 	HANDLE hThread = OpenThread(THREAD_ALL_ACCESS, FALSE, DebuggeeCtx.pDbgEvent->dwThreadId);
 	if (hThread == NULL)
@@ -264,38 +917,218 @@ BOOL FWinDebugger::Command_ListLocalVariables(const vector<wstring> &InTokens, c
 	}
 
 	CONTEXT ThreadContext;
-	ThreadContext.ContextFlags = CONTEXT_CONTROL;
+	ThreadContext.ContextFlags = CONTEXT_CONTROL | CONTEXT_INTEGER;
 	if (GetThreadContext(hThread, &ThreadContext))
 	{
-		IMAGEHLP_STACK_FRAME StackFrame = { 0 };
-		StackFrame.InstructionOffset = ThreadContext.Eip;
+		FDebuggeeScope Scope(DebuggeeCtx.hProcess, ThreadContext);
+		const FVisExpression &Expression = ExpressionCache.Find(Text, Scope.GetScopeKey(), Scope.GetModuleBase(), Scope);
+
+		FProcessMemory ProcessMemory(DebuggeeCtx.hProcess);
+		FRemotePageCache PageCache(ProcessMemory);
+		uint64_t Registers[vrCount];
+		ReadVisRegisters(DebuggeeCtx.hProcess, ThreadContext, Registers);
+		FVisContext Context = { NULL, 0, &PageCache, Registers };
 
-		if (!SymSetContext(DebuggeeCtx.hProcess, &StackFrame, NULL) && (GetLastError() != ERROR_SUCCESS))
+		FFormatBuffer ValueText;
+		FormatEvaluation(Text, Expression, Context, ValueText);
+		appConsolePrintf(TEXT("%s"), ValueText.c_str());
+	}
+
+	CloseHandle(hThread);
+	return FALSE;
+}
+
+// the watches are evaluated first, which reads the pointers they go through. the values are then
+// fetched together, one read per run of nearby pages, and hashed before anything is formatted.
+// aggregates are hashed and compared through the layout plan of their type, member by member.
+VOID FWinDebugger::DisplayWatches(BOOL bInAll)
+{
+	HANDLE hThread = OpenThread(THREAD_ALL_ACCESS, FALSE, DebuggeeCtx.pDbgEvent->dwThreadId);
+	if (hThread == NULL)
+	{
+		return;
+	}
+
+	CONTEXT ThreadContext;
+	ThreadContext.ContextFlags = CONTEXT_CONTROL | CONTEXT_INTEGER;
+	if (!GetThreadContext(hThread, &ThreadContext))
+	{
+		CloseHandle(hThread);
+		return;
+	}
+	CloseHandle(hThread);
+
+	FDebuggeeScope Scope(DebuggeeCtx.hProcess, ThreadContext);
+	FProcessMemory ProcessMemory(DebuggeeCtx.hProcess);
+	FRemotePageCache PageCache(ProcessMemory);
+	uint64_t Registers[vrCount];
+	ReadVisRegisters(DebuggeeCtx.hProcess, ThreadContext, Registers);
+	FVisContext Context = { NULL, 0, &PageCache, Registers };
+
+	std::vector<const FVisExpression*> Expressions(Watches.size(), (const FVisExpression*)NULL);
+	std::vector<FVisValue> Values(Watches.size());
+	std::vector<bool> Evaluated(Watches.size(), false);
+	std::vector<FRemotePageCache::FRange> Ranges;
+	for (size_t k = 0; k < Watches.size(); k++)
+	{
+		Expressions[k] = &ExpressionCache.Find(Watches[k].Text, Scope.GetScopeKey(), Scope.GetModuleBase(), Scope);
+		Evaluated[k] = Expressions[k]->Evaluate(Context, Values[k]);
+		const FSymTypeInfo *pRealType = Values[k].pType ? Values[k].pType->GetRealType() : NULL;
+		if (Evaluated[k] && Values[k].bLValue && pRealType && pRealType->GetLength())
 		{
-			TRACE_ERROR(TEXT("SymSetContext Failed."));
+			FRemotePageCache::FRange Range;
+			Range.Address = Values[k].Address;
+			Range.Bytes = pRealType->GetLength() < NSWatch::kMaxHashBytes ? pRealType->GetLength() : NSWatch::kMaxHashBytes;
+			Ranges.push_back(Range);
 		}
-		else
+	} // end for k
+	PageCache.Prefetch(Ranges);
+
+	FFormatBuffer ValueText;
+	std::vector<BYTE> Bytes;
+	std::vector<uint32_t> ChangedLeaves;
+	uint32_t ChangedCount = 0;
+	for (size_t k = 0; k < Watches.size(); k++)
+	{
+		const FVisValue &Value = Values[k];
+		const FSymTypeInfo *pRealType = Value.pType ? Value.pType->GetRealType() : NULL;
+		const FSymLayoutPlan *pPlan = NULL;
+		uint64_t Hash = NSWatch::kBadValueHash;
+		if (Evaluated[k] && Value.bLValue && pRealType && pRealType->GetLength())
 		{
-			const TCHAR *szExpression = NULL;
-			if (InTokens.size() >= 1)
+			Bytes.resize(pRealType->GetLength() < NSWatch::kMaxHashBytes ? pRealType->GetLength() : NSWatch::kMaxHashBytes);
+			if (PageCache.ReadMemory(Value.Address, &Bytes[0], Bytes.size()))
 			{
-				szExpression = InTokens[0].c_str();
+				// the padding of an aggregate does not count
+				pPlan = Bytes.size() == pRealType->GetLength() ? pRealType->GetLayoutPlan() : NULL;
+				Hash = pPlan ? pPlan->HashValue(&Bytes[0]) : HashValueBytes(&Bytes[0], Bytes.size());
 			}
+		}
+		else if (Evaluated[k])
+		{
+			// a computed value, or one without a size
+			Hash = HashValueBytes((const BYTE*)&Value.Integer, sizeof(Value.Integer));
+			Hash = HashValueBytes((const BYTE*)&Value.Address, sizeof(Value.Address), Hash);
+		}
 
-			FSymEnumContext EnumCtx;
-			if (SymEnumSymbols(DebuggeeCtx.hProcess, 0, szExpression, &PsymEnumeratesymbolsCallback, (void*)&EnumCtx))
+		FWatch &Watch = Watches[k];
+		if (!bInAll && Watch.bHasHash && Watch.Hash == Hash)
+		{
+			continue;
+		}
+		const BOOL bChanged = Watch.bHasHash && Watch.Hash != Hash;
+		ChangedCount++;
+
+		ValueText.Clear();
+		ValueText.Append(TEXT('['));
+		ValueText.AppendUInt(k);
+		ValueText.Append(TEXT("] "), 2);
+		FormatEvaluation(Watch.Text, *Expressions[k], Context, ValueText);
+
+		// the members that differ from the last stop
+		if (pPlan && bChanged && Watch.pLastType == pRealType && Watch.LastValue.size() == Bytes.size())
+		{
+			ChangedLeaves.clear();
+			pPlan->Diff(&Watch.LastValue[0], &Bytes[0], ChangedLeaves);
+			ValueText.Append(TEXT("    changed: "));
+			for (size_t i = 0; i < ChangedLeaves.size() && i < NSWatch::kMaxChangedPaths; i++)
+			{
+				if (i > 0)
+				{
+					ValueText.Append(TEXT(", "), 2);
+				}
+				ValueText.Append(pPlan->GetLeafPath(ChangedLeaves[i]));
+			} // end for i
+			if (ChangedLeaves.size() > NSWatch::kMaxChangedPaths)
 			{
-				DisplayVariables(EnumCtx.Variables, DebuggeeCtx.hProcess, ThreadContext);
+				ValueText.Append(TEXT(" and "));
+				ValueText.AppendUInt(ChangedLeaves.size() - NSWatch::kMaxChangedPaths);
+				ValueText.Append(TEXT(" more"));
+			}
+			ValueText.Append(TEXT('\n'));
+		}
+		// a listing compares with the last stop and leaves it, the next stop still reports the change
+		if (!bInAll)
+		{
+			Watch.Hash = Hash;
+			Watch.bHasHash = TRUE;
+			Watch.pLastType = pPlan ? pRealType : NULL;
+			if (pPlan)
+			{
+				Watch.LastValue = Bytes;
 			}
 			else
 			{
-				TRACE_ERROR(TEXT("List local variables."));
+				Watch.LastValue.clear();
 			}
 		}
+		appConsolePrintf(TEXT("%s"), ValueText.c_str());
+	} // end for k
+
+	if (!bInAll && ChangedCount < Watches.size())
+	{
+		appConsolePrintf(TEXT("(%d of %d watches unchanged)\n"), (int)(Watches.size() - ChangedCount), (int)Watches.size());
 	}
+}
 
-	CloseHandle(hThread);
-	return FALSE;
-	return FALSE;
+VOID FWinDebugger::ResetWatchLayouts()
+{
+	// the next stop compares hashes only, then keeps the new type and bytes
+	for (size_t k = 0; k < Watches.size(); k++)
+	{
+		Watches[k].pLastType = NULL;
+		Watches[k].LastValue.clear();
+	} // end for k
 }
 
+// watch add "expression" | watch del index|all | watch list
+BOOL FWinDebugger::Command_Watch(const vector<wstring> &InTokens, const vector<wstring> &InSwitchs)
+{
+	const wstring Action = InTokens.size() >= 1 ? InTokens[0] : wstring(TEXT("list"));
+	if (Action == TEXT("add") && InTokens.size() >= 2)
+	{
+		FWatch Watch;
+		Watch.Text = InTokens[1];
+		for (size_t k = 2; k < InTokens.size(); k++)
+		{
+			Watch.Text += TEXT(' ');
+			Watch.Text += InTokens[k];
+		} // end for k
+		Watch.Hash = NSWatch::kBadValueHash;
+		Watch.bHasHash = FALSE;
+		Watch.pLastType = NULL;
+		Watches.push_back(Watch);
+	}
+	else if (Action == TEXT("del") && InTokens.size() >= 2)
+	{
+		if (InTokens[1] == TEXT("all"))
+		{
+			Watches.clear();
+			return FALSE;
+		}
+		const uint64_t Index = appAtoi64(InTokens[1].c_str());
+		if (Index >= Watches.size())
+		{
+			appConsolePrintf(TEXT("watch: no watch %s.\n"), InTokens[1].c_str());
+			return FALSE;
+		}
+		Watches.erase(Watches.begin() + (size_t)Index);
+		return FALSE;
+	}
+	else if (Action != TEXT("list"))
+	{
+		TRACE_ERROR(TEXT("watch: add \"expression\", del index|all or list."));
+		return FALSE;
+	}
+
+	if (!DebuggeeCtx.pDbgEvent || DebuggeeCtx.hProcess == INVALID_HANDLE_VALUE)
+	{
+		for (size_t k = 0; k < Watches.size(); k++)
+		{
+			appConsolePrintf(TEXT("[%d] %s\n"), (int)k, Watches[k].Text.c_str());
+		} // end for k
+		return FALSE;
+	}
+	DisplayWatches(TRUE);
+	return FALSE;
+}
@@ -0,0 +1,2379 @@
+// \brief
+//		portable MSVC C++ name demangler.
+//
+
+#include "WinDemangler.h"
+
+#include <cstring>
+
+
+namespace NSDemangle
+{
+	const uint32_t NIL                   = 0xFFFFFFFF;
+	const uint32_t MAX_DEPTH             = 128;
+	const size_t   BLOCK_SIZE            = 64 * 1024;
+	const uint32_t MEMO_INITIAL_SIZE     = 1024;
+
+	// node kinds
+	enum
+	{
+		N_PRIMITIVE,		// Text
+		N_TAG,				// Variant = tag, Child[0] = name
+		N_POINTER,			// Variant = affinity, Child[0] = pointee, Child[1] = class of a member pointer
+		N_ARRAY,			// Child[0] = element, list of N_INTEGER dimensions
+		N_FUNCTION,			// Child[0] = return type, list of parameters, Variant = FN_xxx
+							// Values = static, vtordisp, vbptr and vboffset this adjustments of thunks
+		N_CUSTOM,			// Child[0] = identifier
+		N_INTEGER,			// Values[0], Variant = negative
+		N_TEMPLATE_REF,		// Child[0] = symbol, Values = member pointer offsets, Variant = count, Quals = address of
+		N_NAME,				// Text
+		N_STRUCTOR,			// Child[0] = class identifier, Variant = destructor
+		N_CONVERSION,		// Child[0] = target type
+		N_LITERAL_OPERATOR,	// Text
+		N_LOCAL_GUARD,		// Variant = thread, Values[0] = scope index
+		N_DYNAMIC_STRUCTOR,	// Child[0] = variable symbol or Child[1] = name, Variant = destructor
+		N_VCALL,			// Values[0] = offset in vtable
+		N_RTTI_BCD,			// Values = offsets and flags
+		N_QUALIFIED_NAME,	// list of components, outermost first
+		N_SYM_FUNCTION,		// Child[0] = name, Child[1] = signature
+		N_SYM_VARIABLE,		// Child[0] = name, Child[1] = type, Variant = storage class
+		N_SYM_TABLE,		// Child[0] = name, Child[1] = target name
+		N_SYM_NAME,			// Child[0] = name, nothing else is printed
+		N_SYM_STRING		// Text
+	};
+
+	// qualifiers
+	const uint8_t Q_CONST                = 0x01;
+	const uint8_t Q_VOLATILE             = 0x02;
+	const uint8_t Q_RESTRICT             = 0x04;
+	const uint8_t Q_UNALIGNED            = 0x08;
+	const uint8_t Q_POINTER64            = 0x10;
+
+	// function classes
+	const uint32_t FC_PRIVATE            = 0x0001;
+	const uint32_t FC_PROTECTED          = 0x0002;
+	const uint32_t FC_PUBLIC             = 0x0004;
+	const uint32_t FC_GLOBAL             = 0x0008;
+	const uint32_t FC_STATIC             = 0x0010;
+	const uint32_t FC_VIRTUAL            = 0x0020;
+	const uint32_t FC_FAR                = 0x0040;
+	const uint32_t FC_EXTERNC            = 0x0080;
+	const uint32_t FC_NO_PARAMETER_LIST  = 0x0100;
+	const uint32_t FC_VIRTUAL_ADJUST     = 0x0200;
+	const uint32_t FC_STATIC_ADJUST      = 0x0400;
+	const uint32_t FC_VIRTUAL_ADJUST_EX  = 0x0800;
+	const uint32_t FC_THUNK              = FC_VIRTUAL_ADJUST | FC_STATIC_ADJUST | FC_VIRTUAL_ADJUST_EX;
+	const uint32_t FC_VARIADIC           = 0x1000;
+	const uint32_t FC_NOEXCEPT           = 0x2000;
+	const uint32_t FC_REF                = 0x4000;
+	const uint32_t FC_RVALUE_REF         = 0x8000;
+
+	// identifiers, the list holds template arguments
+	const uint32_t ID_TEMPLATE           = 0x0001;
+
+	// tags
+	enum { TAG_CLASS, TAG_STRUCT, TAG_UNION, TAG_ENUM };
+
+	// pointer affinities
+	enum { PA_POINTER, PA_REFERENCE, PA_RVALUE_REFERENCE };
+
+	// variable storage classes
+	enum { SC_PRIVATE_STATIC, SC_PROTECTED_STATIC, SC_PUBLIC_STATIC, SC_GLOBAL, SC_FUNCTION_LOCAL };
+
+	// type parsing modes
+	enum { MODE_DROP, MODE_MANGLE, MODE_RESULT };
+
+	const uint8_t CC_NONE = 0xFF;
+	const char* const CallingConventions[] =
+	{
+		"__cdecl", "__pascal", "__thiscall", "__stdcall", "__fastcall", "__clrcall", "__eabi", "__vectorcall"
+	};
+	enum { CC_CDECL, CC_PASCAL, CC_THISCALL, CC_STDCALL, CC_FASTCALL, CC_CLRCALL, CC_EABI, CC_VECTORCALL };
+
+	// function signatures
+	const uint8_t FN_PARAMETERS          = 0x1;
+	const uint8_t FN_THUNK               = 0x2;
+
+	// failed names are memoized too
+	const char* const FAILED = "";
+}
+
+using namespace NSDemangle;
+
+static inline uint64_t HashName(const char *InText, size_t InLength, bool bInNameOnly)
+{
+	uint64_t Hash = bInNameOnly ? 0x84222325CBF29CE4ull : 0xCBF29CE484222325ull;
+	for (size_t k = 0; k < InLength; k++)
+	{
+		Hash = (Hash ^ (uint8_t)InText[k]) * 0x100000001B3ull;
+	}
+	return Hash;
+}
+
+static inline bool IsDigit(char InChar)
+{
+	return InChar >= '0' && InChar <= '9';
+}
+
+static inline bool IsAlnum(char InChar)
+{
+	return IsDigit(InChar) || (InChar >= 'a' && InChar <= 'z') || (InChar >= 'A' && InChar <= 'Z');
+}
+
+static inline void AppendNumber(std::string &Out, int64_t InValue)
+{
+	char Buffer[24];
+	char *Ptr = Buffer + sizeof(Buffer);
+	uint64_t Value = InValue < 0 ? (uint64_t)0 - (uint64_t)InValue : (uint64_t)InValue;
+	do
+	{
+		*--Ptr = (char)('0' + Value % 10);
+		Value /= 10;
+	} while (Value);
+	if (InValue < 0)
+	{
+		*--Ptr = '-';
+	}
+	Out.append(Ptr, Buffer + sizeof(Buffer) - Ptr);
+}
+
+static inline void AppendUnsigned(std::string &Out, uint64_t InValue)
+{
+	char Buffer[24];
+	char *Ptr = Buffer + sizeof(Buffer);
+	do
+	{
+		*--Ptr = (char)('0' + InValue % 10);
+		InValue /= 10;
+	} while (InValue);
+	Out.append(Ptr, Buffer + sizeof(Buffer) - Ptr);
+}
+
+// a space between a word and what follows it
+static inline void SpaceIfNecessary(std::string &Out)
+{
+	if (!Out.empty() && (IsAlnum(Out.back()) || Out.back() == '>'))
+	{
+		Out += ' ';
+	}
+}
+
+static bool PrintQualifier(std::string &Out, uint8_t InQuals, uint8_t InMask, const char *InText, bool bInSpace)
+{
+	if (!(InQuals & InMask))
+	{
+		return bInSpace;
+	}
+	if (bInSpace)
+	{
+		Out += ' ';
+	}
+	Out += InText;
+	return true;
+}
+
+static void PrintQualifiers(std::string &Out, uint8_t InQuals, bool bInSpaceBefore, bool bInSpaceAfter)
+{
+	size_t Start = Out.size();
+	bInSpaceBefore = PrintQualifier(Out, InQuals, Q_CONST, "const", bInSpaceBefore);
+	bInSpaceBefore = PrintQualifier(Out, InQuals, Q_VOLATILE, "volatile", bInSpaceBefore);
+	PrintQualifier(Out, InQuals, Q_RESTRICT, "__restrict", bInSpaceBefore);
+	if (bInSpaceAfter && Out.size() > Start)
+	{
+		Out += ' ';
+	}
+}
+
+FMsvcDemangler::FMsvcDemangler()
+	: Cursor(NULL)
+	, End(NULL)
+	, bError(false)
+	, Depth(0)
+	, MemoCount(0)
+	, BlockUsed(BLOCK_SIZE)
+	, ArenaBytes(0)
+	, HitCount(0)
+	, MissCount(0)
+{
+	memset(&Backrefs, 0, sizeof(Backrefs));
+}
+
+FMsvcDemangler::~FMsvcDemangler()
+{
+	Clear();
+}
+
+void FMsvcDemangler::Clear()
+{
+	for (size_t k = 0; k < Blocks.size(); k++)
+	{
+		delete[] Blocks[k];
+	}
+	Blocks.clear();
+	BlockUsed = BLOCK_SIZE;
+	ArenaBytes = 0;
+
+	Memo.clear();
+	MemoCount = 0;
+
+	Nodes.clear();
+	Lists.clear();
+	Stack.clear();
+	TextPool.clear();
+	Output.clear();
+}
+
+size_t FMsvcDemangler::GetMemoryUsage() const
+{
+	return ArenaBytes + Memo.capacity() * sizeof(FMemoEntry) + Nodes.capacity() * sizeof(FNode)
+		+ (Lists.capacity() + Stack.capacity()) * sizeof(uint32_t) + Output.capacity();
+}
+
+// terminated copy of InText, in blocks that are only freed by Clear()
+const char* FMsvcDemangler::CopyToArena(const char *InText, size_t InLength)
+{
+	size_t Size = InLength + 1;
+	if (BlockUsed + Size > BLOCK_SIZE)
+	{
+		size_t BlockSize = Size > BLOCK_SIZE ? Size : BLOCK_SIZE;
+		if (Size > BLOCK_SIZE)
+		{
+			// oversized names get their own block, the current one stays open
+			char *Block = new char[BlockSize];
+			Blocks.insert(Blocks.begin(), Block);
+			ArenaBytes += BlockSize;
+			memcpy(Block, InText, InLength);
+			Block[InLength] = 0;
+			return Block;
+		}
+		Blocks.push_back(new char[BlockSize]);
+		ArenaBytes += BlockSize;
+		BlockUsed = 0;
+	}
+
+	char *Copy = Blocks.back() + BlockUsed;
+	memcpy(Copy, InText, InLength);
+	Copy[InLength] = 0;
+	BlockUsed += Size;
+	return Copy;
+}
+
+FMsvcDemangler::FMemoEntry* FMsvcDemangler::FindEntry(uint64_t InHash, const char *InMangled, size_t InLength)
+{
+	uint32_t Mask = (uint32_t)Memo.size() - 1;
+	uint32_t Slot = (uint32_t)InHash & Mask;
+	for (;;)
+	{
+		FMemoEntry &Entry = Memo[Slot];
+		if (Entry.Mangled == NULL)
+		{
+			return &Entry;
+		}
+		if (Entry.Hash == InHash && strncmp(Entry.Mangled, InMangled, InLength) == 0 && Entry.Mangled[InLength] == 0)
+		{
+			return &Entry;
+		}
+		Slot = (Slot + 1) & Mask;
+	}
+}
+
+void FMsvcDemangler::GrowMemo()
+{
+	std::vector<FMemoEntry> Old;
+	Old.swap(Memo);
+
+	FMemoEntry Empty = { 0, NULL, NULL };
+	Memo.assign(Old.empty() ? MEMO_INITIAL_SIZE : Old.size() * 2, Empty);
+
+	uint32_t Mask = (uint32_t)Memo.size() - 1;
+	for (size_t k = 0; k < Old.size(); k++)
+	{
+		if (Old[k].Mangled)
+		{
+			uint32_t Slot = (uint32_t)Old[k].Hash & Mask;
+			while (Memo[Slot].Mangled)
+			{
+				Slot = (Slot + 1) & Mask;
+			}
+			Memo[Slot] = Old[k];
+		}
+	} // end for k
+}
+
+const char* FMsvcDemangler::Demangle(const char *InMangled, bool bInNameOnly)
+{
+	if (InMangled == NULL || (InMangled[0] != '?' && InMangled[0] != '.'))
+	{
+		return NULL;
+	}
+
+	size_t Length = strlen(InMangled);
+	uint64_t Hash = HashName(InMangled, Length, bInNameOnly);
+	if (Memo.empty())
+	{
+		GrowMemo();
+	}
+
+	FMemoEntry *Entry = FindEntry(Hash, InMangled, Length);
+	if (Entry->Mangled)
+	{
+		HitCount++;
+		return Entry->Result == FAILED ? NULL : Entry->Result;
+	}
+
+	MissCount++;
+	const char *Result = Run(InMangled, Length, bInNameOnly) ? CopyToArena(Output.data(), Output.size()) : FAILED;
+
+	if ((MemoCount + 1) * 2 > Memo.size())
+	{
+		GrowMemo();
+		Entry = FindEntry(Hash, InMangled, Length);
+	}
+	Entry->Hash = Hash;
+	Entry->Mangled = CopyToArena(InMangled, Length);
+	Entry->Result = Result;
+	MemoCount++;
+
+	return Result == FAILED ? NULL : Result;
+}
+
+// parse and print one name into Output, the node storage is kept for the next name
+bool FMsvcDemangler::Run(const char *InMangled, size_t InLength, bool bInNameOnly)
+{
+	Cursor = InMangled;
+	End = InMangled + InLength;
+	bError = false;
+	Depth = 0;
+	Nodes.clear();
+	Lists.clear();
+	Stack.clear();
+	TextPool.clear();
+	memset(&Backrefs, 0, sizeof(Backrefs));
+	Output.clear();
+
+	uint32_t Symbol = ParseSymbol();
+	if (bError || Symbol == NIL)
+	{
+		return false;
+	}
+
+	Print(Symbol, Output, bInNameOnly);
+	return true;
+}
+
+uint32_t FMsvcDemangler::NewNode(uint8_t InKind)
+{
+	FNode Node;
+	memset(&Node, 0, sizeof(Node));
+	Node.Kind = InKind;
+	Node.CallConv = CC_NONE;
+	Node.Child[0] = NIL;
+	Node.Child[1] = NIL;
+	Nodes.push_back(Node);
+	return (uint32_t)Nodes.size() - 1;
+}
+
+uint32_t FMsvcDemangler::NewText(uint8_t InKind, const char *InText, uint32_t InLength)
+{
+	uint32_t Node = NewNode(InKind);
+	Nodes[Node].Text = InText;
+	Nodes[Node].Length = InLength;
+	return Node;
+}
+
+// a name node over a rendered string, the deque keeps the string in place
+uint32_t FMsvcDemangler::CopyText(const std::string &InText)
+{
+	TextPool.push_back(InText);
+	return NewText(N_NAME, TextPool.back().data(), (uint32_t)TextPool.back().size());
+}
+
+// move the items pushed on Stack since InStackMark into the list of InNode
+void FMsvcDemangler::EndList(uint32_t InNode, size_t InStackMark)
+{
+	Nodes[InNode].ListBegin = (uint32_t)Lists.size();
+	Nodes[InNode].ListCount = (uint32_t)(Stack.size() - InStackMark);
+	Lists.insert(Lists.end(), Stack.begin() + InStackMark, Stack.end());
+	Stack.resize(InStackMark);
+}
+
+bool FMsvcDemangler::Consume(char InChar)
+{
+	if (Cursor < End && *Cursor == InChar)
+	{
+		Cursor++;
+		return true;
+	}
+	return false;
+}
+
+bool FMsvcDemangler::Consume(const char *InPrefix)
+{
+	if (!StartsWith(InPrefix))
+	{
+		return false;
+	}
+	Cursor += strlen(InPrefix);
+	return true;
+}
+
+bool FMsvcDemangler::StartsWith(const char *InPrefix) const
+{
+	size_t Length = strlen(InPrefix);
+	return (size_t)(End - Cursor) >= Length && memcmp(Cursor, InPrefix, Length) == 0;
+}
+
+bool FMsvcDemangler::StartsWithDigit() const
+{
+	return Cursor < End && IsDigit(*Cursor);
+}
+
+uint32_t FMsvcDemangler::Fail()
+{
+	bError = true;
+	return NIL;
+}
+
+// the first 10 distinct names of a back reference context get a digit
+void FMsvcDemangler::Memorize(const char *InText, uint32_t InLength)
+{
+	if (Backrefs.NameCount >= 10)
+	{
+		return;
+	}
+	for (uint32_t k = 0; k < Backrefs.NameCount; k++)
+	{
+		if (Backrefs.NameLengths[k] == InLength && memcmp(Backrefs.Names[k], InText, InLength) == 0)
+		{
+			return;
+		}
+	} // end for k
+	Backrefs.Names[Backrefs.NameCount] = InText;
+	Backrefs.NameLengths[Backrefs.NameCount] = InLength;
+	Backrefs.NameCount++;
+}
+
+// template instantiations are referred to by their rendered name
+void FMsvcDemangler::MemorizeIdentifier(uint32_t InIdentifier)
+{
+	std::string Name;
+	PrintIdentifier(InIdentifier, Name);
+	TextPool.push_back(Name);
+	Memorize(TextPool.back().data(), (uint32_t)TextPool.back().size());
+}
+
+// <number> ::= [?] <digit>		digit + 1
+//          ::= [?] <hex digits A-P> @
+bool FMsvcDemangler::ParseNumber(uint64_t &OutValue, bool &bOutNegative)
+{
+	bOutNegative = Consume('?');
+	OutValue = 0;
+	if (StartsWithDigit())
+	{
+		OutValue = (uint64_t)(*Cursor++ - '0') + 1;
+		return true;
+	}
+
+	for (const char *Ptr = Cursor; Ptr < End; Ptr++)
+	{
+		if (*Ptr == '@')
+		{
+			Cursor = Ptr + 1;
+			return true;
+		}
+		if (*Ptr < 'A' || *Ptr > 'P')
+		{
+			break;
+		}
+		OutValue = (OutValue << 4) + (uint64_t)(*Ptr - 'A');
+	} // end for Ptr
+
+	bError = true;
+	bOutNegative = false;
+	OutValue = 0;
+	return false;
+}
+
+int64_t FMsvcDemangler::ParseSigned()
+{
+	uint64_t Value;
+	bool bNegative;
+	ParseNumber(Value, bNegative);
+	// offsets are 32 bit, 0xFFFFFFFC is -4
+	int64_t Signed = (int32_t)(uint32_t)Value;
+	return bNegative ? -Signed : Signed;
+}
+
+uint32_t FMsvcDemangler::ParseSymbol()
+{
+	// type descriptor names of RTTI records
+	if (Consume('.'))
+	{
+		uint32_t Type = ParseType(MODE_RESULT);
+		if (bError || Cursor != End)
+		{
+			return Fail();
+		}
+		return MakeRttiVariable("`RTTI Type Descriptor Name'", Type);
+	}
+
+	// hashed names of symbols too long to be decorated
+	if (StartsWith("??@"))
+	{
+		const char *Name = Cursor;
+		Cursor = (const char*)memchr(Cursor + 3, '@', End - Cursor - 3);
+		if (Cursor == NULL)
+		{
+			return Fail();
+		}
+		Cursor++;
+		return NewText(N_SYM_STRING, Name, (uint32_t)(Cursor - Name));
+	}
+
+	if (!Consume('?'))
+	{
+		return Fail();
+	}
+
+	bool bHandled = false;
+	uint32_t Symbol = ParseSpecialIntrinsic(bHandled);
+	if (bHandled)
+	{
+		return Symbol;
+	}
+	return ParseDeclarator();
+}
+
+uint32_t FMsvcDemangler::ParseSpecialIntrinsic(bool &bOutHandled)
+{
+	bOutHandled = true;
+
+	if (Consume("?_7"))
+	{
+		return ParseSpecialTable("`vftable'");
+	}
+	if (Consume("?_8"))
+	{
+		return ParseSpecialTable("`vbtable'");
+	}
+	if (Consume("?_S"))
+	{
+		return ParseSpecialTable("`local vftable'");
+	}
+	if (Consume("?_R4"))
+	{
+		return ParseSpecialTable("`RTTI Complete Object Locator'");
+	}
+
+	if (Consume("?_9"))
+	{
+		// [thunk]: __thiscall Foo::`vcall'{8, {flat}}
+		uint32_t Signature = NewNode(N_FUNCTION);
+		Nodes[Signature].Variant = FN_THUNK;
+		Nodes[Signature].FuncClass = FC_NO_PARAMETER_LIST;
+		uint32_t Identifier = NewNode(N_VCALL);
+		uint32_t Name = ParseNameScopeChain(Identifier);
+		if (bError || !Consume("$B"))
+		{
+			return Fail();
+		}
+		uint64_t Offset;
+		bool bNegative;
+		if (!ParseNumber(Offset, bNegative) || bNegative || !Consume('A'))
+		{
+			return Fail();
+		}
+		Nodes[Identifier].Values[0] = (int64_t)Offset;
+		Nodes[Signature].CallConv = ParseCallingConvention();
+
+		uint32_t Symbol = NewNode(N_SYM_FUNCTION);
+		Nodes[Symbol].Child[0] = Name;
+		Nodes[Symbol].Child[1] = Signature;
+		return Symbol;
+	}
+
+	if (Consume("?_B") || Consume("?__J"))
+	{
+		uint32_t Identifier = NewNode(N_LOCAL_GUARD);
+		Nodes[Identifier].Variant = Cursor[-1] == 'J' ? 1 : 0;
+		uint32_t Name = ParseNameScopeChain(Identifier);
+		if (bError || !(Consume("4IA") || Consume('5')))
+		{
+			return Fail();
+		}
+		if (Cursor < End)
+		{
+			uint64_t Index;
+			bool bNegative;
+			ParseNumber(Index, bNegative);
+			Nodes[Identifier].Values[0] = (int64_t)Index;
+		}
+		uint32_t Symbol = NewNode(N_SYM_NAME);
+		Nodes[Symbol].Child[0] = Name;
+		return bError ? NIL : Symbol;
+	}
+
+	if (Consume("?_C"))
+	{
+		// string literals are not spelled out, undname does the same
+		static const char Text[] = "`string'";
+		Cursor = End;
+		return NewText(N_SYM_STRING, Text, sizeof(Text) - 1);
+	}
+
+	if (Consume("?_R0"))
+	{
+		uint32_t Type = ParseType(MODE_RESULT);
+		if (bError || !Consume("@8") || Cursor != End)
+		{
+			return Fail();
+		}
+		return MakeRttiVariable("`RTTI Type Descriptor'", Type);
+	}
+
+	if (Consume("?_R1"))
+	{
+		uint32_t Identifier = NewNode(N_RTTI_BCD);
+		int64_t Values[4];
+		uint64_t Value;
+		bool bNegative;
+		ParseNumber(Value, bNegative);
+		Values[0] = (int64_t)Value;
+		Values[1] = ParseSigned();
+		ParseNumber(Value, bNegative);
+		Values[2] = (int64_t)Value;
+		ParseNumber(Value, bNegative);
+		Values[3] = (int64_t)Value;
+		if (bError)
+		{
+			return NIL;
+		}
+		memcpy(Nodes[Identifier].Values, Values, sizeof(Values));
+
+		uint32_t Name = ParseNameScopeChain(Identifier);
+		Consume('8');
+		uint32_t Symbol = NewNode(N_SYM_VARIABLE);
+		Nodes[Symbol].Variant = SC_GLOBAL;
+		Nodes[Symbol].Child[0] = Name;
+		return bError ? NIL : Symbol;
+	}
+
+	if (StartsWith("?_R2") || StartsWith("?_R3"))
+	{
+		static const char ArrayText[] = "`RTTI Base Class Array'";
+		static const char HierarchyText[] = "`RTTI Class Hierarchy Descriptor'";
+		bool bArray = Cursor[3] == '2';
+		Cursor += 4;
+		uint32_t Identifier = bArray ? NewText(N_NAME, ArrayText, sizeof(ArrayText) - 1) : NewText(N_NAME, HierarchyText, sizeof(HierarchyText) - 1);
+		uint32_t Name = ParseNameScopeChain(Identifier);
+		if (bError || !Consume('8'))
+		{
+			return Fail();
+		}
+		uint32_t Symbol = NewNode(N_SYM_VARIABLE);
+		Nodes[Symbol].Variant = SC_GLOBAL;
+		Nodes[Symbol].Child[0] = Name;
+		return Symbol;
+	}
+
+	if (Consume("?__E"))
+	{
+		return ParseInitFiniStub(false);
+	}
+	if (Consume("?__F"))
+	{
+		return ParseInitFiniStub(true);
+	}
+
+	// typeof and udt returning are not produced by any known compiler
+	if (StartsWith("?_A") || StartsWith("?_P"))
+	{
+		return Fail();
+	}
+
+	bOutHandled = false;
+	return NIL;
+}
+
+// class Foo `RTTI Type Descriptor'
+uint32_t FMsvcDemangler::MakeRttiVariable(const char *InName, uint32_t InType)
+{
+	uint32_t Name = NewNode(N_QUALIFIED_NAME);
+	Stack.push_back(NewText(N_NAME, InName, (uint32_t)strlen(InName)));
+	EndList(Name, Stack.size() - 1);
+
+	uint32_t Symbol = NewNode(N_SYM_VARIABLE);
+	Nodes[Symbol].Variant = SC_GLOBAL;
+	Nodes[Symbol].Child[0] = Name;
+	Nodes[Symbol].Child[1] = InType;
+	return Symbol;
+}
+
+// `vftable'{for `Base'}
+uint32_t FMsvcDemangler::ParseSpecialTable(const char *InName)
+{
+	uint32_t Identifier = NewText(N_NAME, InName, (uint32_t)strlen(InName));
+	uint32_t Name = ParseNameScopeChain(Identifier);
+	if (bError || !(Consume('6') || Consume('7')))
+	{
+		return Fail();
+	}
+
+	uint32_t Symbol = NewNode(N_SYM_TABLE);
+	Nodes[Symbol].Quals = ParseQualifiers(NULL);
+	Nodes[Symbol].Child[0] = Name;
+	if (!Consume('@'))
+	{
+		uint32_t Target = ParseFullyQualifiedTypeName();
+		Nodes[Symbol].Child[1] = Target;
+		Consume('@');
+	}
+	return bError ? NIL : Symbol;
+}
+
+// `dynamic initializer for 'x'', `dynamic atexit destructor for 'x''
+uint32_t FMsvcDemangler::ParseInitFiniStub(bool bInDestructor)
+{
+	uint32_t Identifier = NewNode(N_DYNAMIC_STRUCTOR);
+	Nodes[Identifier].Variant = bInDestructor ? 1 : 0;
+
+	bool bStaticMember = Consume('?');
+	uint32_t Declarator = ParseDeclarator();
+	if (bError)
+	{
+		return NIL;
+	}
+
+	uint32_t Symbol;
+	if (Nodes[Declarator].Kind == N_SYM_VARIABLE)
+	{
+		Nodes[Identifier].Child[0] = Declarator;
+		// older compilers emit a single '@' and no leading '?'
+		if (!Consume('@') || (bStaticMember && !Consume('@')))
+		{
+			return Fail();
+		}
+		Symbol = ParseFunctionEncoding();
+		if (bError)
+		{
+			return NIL;
+		}
+	}
+	else
+	{
+		if (bStaticMember)
+		{
+			return Fail();
+		}
+		Symbol = Declarator;
+		Nodes[Identifier].Child[1] = Nodes[Declarator].Child[0];
+	}
+
+	uint32_t Name = NewNode(N_QUALIFIED_NAME);
+	Stack.push_back(Identifier);
+	EndList(Name, Stack.size() - 1);
+	Nodes[Symbol].Child[0] = Name;
+	return Symbol;
+}
+
+uint32_t FMsvcDemangler::ParseDeclarator()
+{
+	uint32_t Name = ParseFullyQualifiedSymbolName();
+	if (bError)
+	{
+		return NIL;
+	}
+	uint32_t Symbol = ParseEncodedSymbol(Name);
+	if (bError)
+	{
+		return NIL;
+	}
+	Nodes[Symbol].Child[0] = Name;
+	return Symbol;
+}
+
+uint32_t FMsvcDemangler::ParseEncodedSymbol(uint32_t InName)
+{
+	if (Cursor < End && *Cursor >= '0' && *Cursor <= '4')
+	{
+		uint8_t StorageClass = (uint8_t)(*Cursor++ - '0');
+		return ParseVariableEncoding(StorageClass);
+	}
+
+	uint32_t Symbol = ParseFunctionEncoding();
+	if (bError)
+	{
+		return NIL;
+	}
+
+	// operator T gets its type from the return type
+	const FNode &Name = Nodes[InName];
+	uint32_t Identifier = Lists[Name.ListBegin + Name.ListCount - 1];
+	if (Nodes[Identifier].Kind == N_CONVERSION)
+	{
+		Nodes[Identifier].Child[0] = Nodes[Nodes[Symbol].Child[1]].Child[0];
+	}
+	return Symbol;
+}
+
+// the leftmost name of a symbol. only function templates can appear here and they are not memorized.
+uint32_t FMsvcDemangler::ParseFullyQualifiedSymbolName()
+{
+	uint32_t Identifier = ParseUnqualifiedSymbolName();
+	if (bError)
+	{
+		return NIL;
+	}
+	uint32_t Name = ParseNameScopeChain(Identifier);
+	if (bError)
+	{
+		return NIL;
+	}
+
+	if (Nodes[Identifier].Kind == N_STRUCTOR)
+	{
+		const FNode &Node = Nodes[Name];
+		if (Node.ListCount < 2)
+		{
+			return Fail();
+		}
+		Nodes[Identifier].Child[0] = Lists[Node.ListBegin + Node.ListCount - 2];
+	}
+	return Name;
+}
+
+uint32_t FMsvcDemangler::ParseFullyQualifiedTypeName()
+{
+	uint32_t Identifier = ParseUnqualifiedTypeName(true);
+	if (bError)
+	{
+		return NIL;
+	}
+	return ParseNameScopeChain(Identifier);
+}
+
+// scopes follow the name innermost first, up to '@'
+uint32_t FMsvcDemangler::ParseNameScopeChain(uint32_t InUnqualifiedName)
+{
+	size_t Mark = Stack.size();
+	Stack.push_back(InUnqualifiedName);
+	while (!Consume('@'))
+	{
+		if (Cursor >= End)
+		{
+			Stack.resize(Mark);
+			return Fail();
+		}
+		uint32_t Piece = ParseNameScopePiece();
+		if (bError)
+		{
+			Stack.resize(Mark);
+			return NIL;
+		}
+		Stack.push_back(Piece);
+	}
+
+	// outermost first
+	for (size_t Front = Mark, Back = Stack.size() - 1; Front < Back; Front++, Back--)
+	{
+		uint32_t Swap = Stack[Front];
+		Stack[Front] = Stack[Back];
+		Stack[Back] = Swap;
+	}
+	uint32_t Name = NewNode(N_QUALIFIED_NAME);
+	EndList(Name, Mark);
+	return Name;
+}
+
+uint32_t FMsvcDemangler::ParseUnqualifiedSymbolName()
+{
+	if (StartsWithDigit())
+	{
+		return ParseBackRefName();
+	}
+	if (StartsWith("?$"))
+	{
+		return ParseTemplateInstantiationName(false);
+	}
+	if (StartsWith("?"))
+	{
+		return ParseFunctionIdentifierCode();
+	}
+	return ParseSimpleName(true);
+}
+
+uint32_t FMsvcDemangler::ParseUnqualifiedTypeName(bool bInMemorize)
+{
+	if (StartsWithDigit())
+	{
+		return ParseBackRefName();
+	}
+	if (StartsWith("?$"))
+	{
+		return ParseTemplateInstantiationName(true);
+	}
+	return ParseSimpleName(bInMemorize);
+}
+
+// ?1??foo@@YAXXZ: a name local to the second scope of foo
+static bool StartsWithLocalScope(const char *InCursor, const char *InEnd)
+{
+	if (InCursor >= InEnd || *InCursor != '?')
+	{
+		return false;
+	}
+	const char *Start = InCursor + 1;
+	const char *Ptr = Start;
+	while (Ptr < InEnd && *Ptr != '?')
+	{
+		Ptr++;
+	}
+	if (Ptr >= InEnd || Ptr == Start)
+	{
+		return false;
+	}
+	if (Ptr - Start == 1)
+	{
+		return *Start == '@' || IsDigit(*Start);
+	}
+
+	// an encoded number, B-P then A-P, '@'
+	if (Ptr[-1] != '@' || *Start < 'B' || *Start > 'P')
+	{
+		return false;
+	}
+	for (const char *Digit = Start + 1; Digit < Ptr - 1; Digit++)
+	{
+		if (*Digit < 'A' || *Digit > 'P')
+		{
+			return false;
+		}
+	} // end for Digit
+	return true;
+}
+
+uint32_t FMsvcDemangler::ParseNameScopePiece()
+{
+	if (StartsWithDigit())
+	{
+		return ParseBackRefName();
+	}
+	if (StartsWith("?$"))
+	{
+		return ParseTemplateInstantiationName(true);
+	}
+	if (Consume("?A"))
+	{
+		// ?A0x1234abcd@, the key is memorized but not printed
+		static const char Text[] = "`anonymous namespace'";
+		const char *Key = Cursor;
+		const char *KeyEnd = (const char*)memchr(Cursor, '@', End - Cursor);
+		if (KeyEnd == NULL)
+		{
+			return Fail();
+		}
+		Cursor = KeyEnd + 1;
+		Memorize(Key, (uint32_t)(KeyEnd - Key));
+		return NewText(N_NAME, Text, sizeof(Text) - 1);
+	}
+	if (StartsWithLocalScope(Cursor, End))
+	{
+		return ParseLocallyScopedNamePiece();
+	}
+	return ParseSimpleName(true);
+}
+
+// `void __cdecl foo(void)'::`2'
+uint32_t FMsvcDemangler::ParseLocallyScopedNamePiece()
+{
+	if (Depth >= MAX_DEPTH)
+	{
+		return Fail();
+	}
+
+	Consume('?');
+	uint64_t Number;
+	bool bNegative;
+	if (!ParseNumber(Number, bNegative) || bNegative)
+	{
+		return Fail();
+	}
+	Consume('?');
+
+	Depth++;
+	uint32_t Scope = ParseSymbol();
+	Depth--;
+	if (bError)
+	{
+		return NIL;
+	}
+
+	std::string Text("`");
+	Print(Scope, Text);
+	Text += "'::`";
+	AppendUnsigned(Text, Number);
+	Text += '\'';
+	return CopyText(Text);
+}
+
+// ?$name followed by template arguments, in a fresh back reference context
+uint32_t FMsvcDemangler::ParseTemplateInstantiationName(bool bInMemorize)
+{
+	if (Depth >= MAX_DEPTH)
+	{
+		return Fail();
+	}
+	Consume("?$");
+
+	FBackrefs Outer = Backrefs;
+	memset(&Backrefs, 0, sizeof(Backrefs));
+
+	Depth++;
+	uint32_t Identifier = ParseUnqualifiedSymbolName();
+	if (!bError)
+	{
+		size_t Mark = Stack.size();
+		ParseTemplateParameterList();
+		if (!bError)
+		{
+			EndList(Identifier, Mark);
+			Nodes[Identifier].FuncClass |= ID_TEMPLATE;
+		}
+		else
+		{
+			Stack.resize(Mark);
+		}
+	}
+	Depth--;
+
+	Backrefs = Outer;
+	if (bError)
+	{
+		return NIL;
+	}
+
+	// types and scopes are memorized, structors and conversions only make sense as the leaf name
+	if (bInMemorize)
+	{
+		uint8_t Kind = Nodes[Identifier].Kind;
+		if (Kind == N_CONVERSION || Kind == N_STRUCTOR)
+		{
+			return Fail();
+		}
+		MemorizeIdentifier(Identifier);
+	}
+	return Identifier;
+}
+
+uint32_t FMsvcDemangler::ParseSimpleName(bool bInMemorize)
+{
+	const char *Name = Cursor;
+	const char *NameEnd = (const char*)memchr(Cursor, '@', End - Cursor);
+	if (NameEnd == NULL || NameEnd == Name)
+	{
+		return Fail();
+	}
+	Cursor = NameEnd + 1;
+
+	uint32_t Length = (uint32_t)(NameEnd - Name);
+	if (bInMemorize)
+	{
+		Memorize(Name, Length);
+	}
+	return NewText(N_NAME, Name, Length);
+}
+
+uint32_t FMsvcDemangler::ParseBackRefName()
+{
+	uint32_t Index = (uint32_t)(*Cursor++ - '0');
+	if (Index >= Backrefs.NameCount)
+	{
+		return Fail();
+	}
+	return NewText(N_NAME, Backrefs.Names[Index], Backrefs.NameLengths[Index]);
+}
+
+// ?<code>, ?_<code>, ?__<code>. constructors, destructors and conversions are resolved by the caller.
+uint32_t FMsvcDemangler::ParseFunctionIdentifierCode()
+{
+	static const char* const BasicOperators[36] =
+	{
+		NULL, NULL, "operator new", "operator delete", "operator=", "operator>>", "operator<<", "operator!", "operator==", "operator!=",
+		"operator[]", NULL, "operator->", "operator*", "operator++", "operator--", "operator-", "operator+", "operator&", "operator->*",
+		"operator/", "operator%", "operator<", "operator<=", "operator>", "operator>=", "operator,", "operator()", "operator~", "operator^",
+		"operator|", "operator&&", "operator||", "operator*=", "operator+=", "operator-="
+	};
+	static const char* const UnderOperators[36] =
+	{
+		"operator/=", "operator%=", "operator>>=", "operator<<=", "operator&=", "operator|=", "operator^=", NULL, NULL, NULL,
+		NULL, NULL, NULL, "`vbase dtor'", "`vector deleting dtor'", "`default ctor closure'", "`scalar deleting dtor'",
+		"`vector ctor iterator'", "`vector dtor iterator'", "`vector vbase ctor iterator'", "`virtual displacement map'",
+		"`eh vector ctor iterator'", "`eh vector dtor iterator'", "`eh vector vbase ctor iterator'", "`copy ctor closure'",
+		NULL, NULL, NULL, NULL, "`local vftable ctor closure'", "operator new[]", "operator delete[]", NULL,
+		"`placement delete closure'", "`placement delete[] closure'", NULL
+	};
+	static const char* const DoubleUnderOperators[36] =
+	{
+		NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+		"`managed vector ctor iterator'", "`managed vector dtor iterator'", "`EH vector copy ctor iterator'",
+		"`EH vector vbase copy ctor iterator'", NULL, NULL, "`vector copy ctor iterator'", "`vector vbase copy constructor iterator'",
+		"`managed vector vbase copy constructor iterator'", NULL, NULL, "operator co_await", "operator<=>", NULL,
+		NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL
+	};
+
+	Consume('?');
+	const char* const *Table = BasicOperators;
+	if (Consume("__"))
+	{
+		Table = DoubleUnderOperators;
+	}
+	else if (Consume('_'))
+	{
+		Table = UnderOperators;
+	}
+	if (Cursor >= End)
+	{
+		return Fail();
+	}
+
+	char Code = *Cursor++;
+	if (Table == BasicOperators && (Code == '0' || Code == '1'))
+	{
+		uint32_t Structor = NewNode(N_STRUCTOR);
+		Nodes[Structor].Variant = Code == '1' ? 1 : 0;
+		return Structor;
+	}
+	if (Table == BasicOperators && Code == 'B')
+	{
+		return NewNode(N_CONVERSION);
+	}
+	if (Table == DoubleUnderOperators && Code == 'K')
+	{
+		// operator "" _suffix
+		uint32_t Name = ParseSimpleName(false);
+		if (bError)
+		{
+			return NIL;
+		}
+		Nodes[Name].Kind = N_LITERAL_OPERATOR;
+		return Name;
+	}
+
+	int32_t Index = IsDigit(Code) ? Code - '0' : (Code >= 'A' && Code <= 'Z' ? Code - 'A' + 10 : -1);
+	if (Index < 0 || Table[Index] == NULL)
+	{
+		return Fail();
+	}
+	return NewText(N_NAME, Table[Index], (uint32_t)strlen(Table[Index]));
+}
+
+// <function-class> [<this adjustment>] <function-type>
+uint32_t FMsvcDemangler::ParseFunctionEncoding()
+{
+	uint32_t ExtraClass = Consume("$$J0") ? FC_EXTERNC : 0;
+	if (Cursor >= End)
+	{
+		return Fail();
+	}
+
+	uint32_t Class = ParseFunctionClass() | ExtraClass;
+	int64_t Adjust[4] = { 0, 0, 0, 0 };
+	if (Class & FC_STATIC_ADJUST)
+	{
+		Adjust[0] = ParseSigned();
+	}
+	else if (Class & FC_VIRTUAL_ADJUST)
+	{
+		if (Class & FC_VIRTUAL_ADJUST_EX)
+		{
+			Adjust[2] = ParseSigned();
+			Adjust[3] = ParseSigned();
+		}
+		Adjust[1] = ParseSigned();
+		Adjust[0] = ParseSigned();
+	}
+	if (bError)
+	{
+		return NIL;
+	}
+
+	uint32_t Signature;
+	if (Class & FC_NO_PARAMETER_LIST)
+	{
+		// an extern "C" function whose signature is not decorated, the scope of a local name
+		Signature = NewNode(N_FUNCTION);
+	}
+	else
+	{
+		Signature = ParseFunctionType(!(Class & (FC_GLOBAL | FC_STATIC)));
+		if (bError)
+		{
+			return NIL;
+		}
+	}
+
+	FNode &Node = Nodes[Signature];
+	Node.FuncClass |= Class;
+	if (Class & FC_THUNK)
+	{
+		Node.Variant |= FN_THUNK;
+		memcpy(Node.Values, Adjust, sizeof(Adjust));
+	}
+
+	uint32_t Symbol = NewNode(N_SYM_FUNCTION);
+	Nodes[Symbol].Child[1] = Signature;
+	return Symbol;
+}
+
+uint32_t FMsvcDemangler::ParseFunctionClass()
+{
+	static const uint32_t Classes[26] =
+	{
+		FC_PRIVATE, FC_PRIVATE | FC_FAR, FC_PRIVATE | FC_STATIC, FC_PRIVATE | FC_STATIC | FC_FAR,
+		FC_PRIVATE | FC_VIRTUAL, FC_PRIVATE | FC_VIRTUAL | FC_FAR,
+		FC_PRIVATE | FC_STATIC_ADJUST, FC_PRIVATE | FC_STATIC_ADJUST | FC_FAR,
+		FC_PROTECTED, FC_PROTECTED | FC_FAR, FC_PROTECTED | FC_STATIC, FC_PROTECTED | FC_STATIC | FC_FAR,
+		FC_PROTECTED | FC_VIRTUAL, FC_PROTECTED | FC_VIRTUAL | FC_FAR,
+		FC_PROTECTED | FC_VIRTUAL | FC_STATIC_ADJUST, FC_PROTECTED | FC_VIRTUAL | FC_STATIC_ADJUST | FC_FAR,
+		FC_PUBLIC, FC_PUBLIC | FC_FAR, FC_PUBLIC | FC_STATIC, FC_PUBLIC | FC_STATIC | FC_FAR,
+		FC_PUBLIC | FC_VIRTUAL, FC_PUBLIC | FC_VIRTUAL | FC_FAR,
+		FC_PUBLIC | FC_VIRTUAL | FC_STATIC_ADJUST, FC_PUBLIC | FC_VIRTUAL | FC_STATIC_ADJUST | FC_FAR,
+		FC_GLOBAL, FC_GLOBAL | FC_FAR
+	};
+
+	if (Cursor >= End)
+	{
+		return Fail();
+	}
+	char Code = *Cursor++;
+	if (Code >= 'A' && Code <= 'Z')
+	{
+		return Classes[Code - 'A'];
+	}
+	if (Code == '9')
+	{
+		return FC_EXTERNC | FC_NO_PARAMETER_LIST;
+	}
+	if (Code == '$')
+	{
+		// vtordisp thunks
+		uint32_t Adjust = FC_VIRTUAL_ADJUST;
+		if (Consume('R'))
+		{
+			Adjust |= FC_VIRTUAL_ADJUST_EX;
+		}
+		if (Cursor < End && *Cursor >= '0' && *Cursor <= '5')
+		{
+			static const uint32_t Access[3] = { FC_PRIVATE, FC_PROTECTED, FC_PUBLIC };
+			uint32_t Index = (uint32_t)(*Cursor++ - '0');
+			return Access[Index / 2] | FC_VIRTUAL | Adjust | ((Index & 1) ? FC_FAR : 0);
+		}
+	}
+	Fail();
+	return FC_PUBLIC;
+}
+
+uint8_t FMsvcDemangler::ParseCallingConvention()
+{
+	if (Cursor >= End)
+	{
+		return CC_NONE;
+	}
+	switch (*Cursor++)
+	{
+	case 'A': case 'B': return CC_CDECL;
+	case 'C': case 'D': return CC_PASCAL;
+	case 'E': case 'F': return CC_THISCALL;
+	case 'G': case 'H': return CC_STDCALL;
+	case 'I': case 'J': return CC_FASTCALL;
+	case 'M': case 'N': return CC_CLRCALL;
+	case 'O': case 'P': return CC_EABI;
+	case 'Q': return CC_VECTORCALL;
+	}
+	return CC_NONE;
+}
+
+// A-D plain, Q-T member
+uint8_t FMsvcDemangler::ParseQualifiers(bool *OutIsMember)
+{
+	static const uint8_t Quals[4] = { 0, Q_CONST, Q_VOLATILE, Q_CONST | Q_VOLATILE };
+	char Code = Cursor < End ? *Cursor++ : 0;
+	bool bMember = Code >= 'Q' && Code <= 'T';
+	if (OutIsMember)
+	{
+		*OutIsMember = bMember;
+	}
+	if (Code >= 'A' && Code <= 'D')
+	{
+		return Quals[Code - 'A'];
+	}
+	if (bMember)
+	{
+		return Quals[Code - 'Q'];
+	}
+	Fail();
+	return 0;
+}
+
+void FMsvcDemangler::ParsePointerCVQualifiers(uint8_t &OutQuals, uint8_t &OutAffinity)
+{
+	OutQuals = 0;
+	OutAffinity = PA_POINTER;
+	if (Consume("$$Q"))
+	{
+		OutAffinity = PA_RVALUE_REFERENCE;
+		return;
+	}
+	if (Consume("$$R"))
+	{
+		OutQuals = Q_VOLATILE;
+		OutAffinity = PA_RVALUE_REFERENCE;
+		return;
+	}
+	switch (Cursor < End ? *Cursor++ : 0)
+	{
+	case 'A': OutAffinity = PA_REFERENCE; break;
+	case 'B': OutAffinity = PA_REFERENCE; OutQuals = Q_VOLATILE; break;
+	case 'P': break;
+	case 'Q': OutQuals = Q_CONST; break;
+	case 'R': OutQuals = Q_VOLATILE; break;
+	case 'S': OutQuals = Q_CONST | Q_VOLATILE; break;
+	default: Fail(); break;
+	}
+}
+
+// E __ptr64, I __restrict, F __unaligned
+uint8_t FMsvcDemangler::ParsePointerExtQualifiers()
+{
+	uint8_t Quals = 0;
+	if (Consume('E'))
+	{
+		Quals |= Q_POINTER64;
+	}
+	if (Consume('I'))
+	{
+		Quals |= Q_RESTRICT;
+	}
+	if (Consume('F'))
+	{
+		Quals |= Q_UNALIGNED;
+	}
+	return Quals;
+}
+
+// <type> <cvr-qualifiers>, or for pointers <type> <pointee-cvr-qualifiers>
+uint32_t FMsvcDemangler::ParseVariableEncoding(uint8_t InStorageClass)
+{
+	uint32_t Type = ParseType(MODE_DROP);
+	if (bError)
+	{
+		return NIL;
+	}
+
+	if (Nodes[Type].Kind == N_POINTER)
+	{
+		uint8_t ExtQuals = ParsePointerExtQualifiers();
+		Nodes[Type].Quals |= ExtQuals;
+		uint8_t PointeeQuals = ParseQualifiers(NULL);
+		if (Nodes[Type].Child[1] != NIL)
+		{
+			// the class of a member pointer is repeated
+			ParseFullyQualifiedTypeName();
+		}
+		if (bError)
+		{
+			return NIL;
+		}
+		Nodes[Nodes[Type].Child[0]].Quals |= PointeeQuals;
+	}
+	else
+	{
+		uint8_t Quals = ParseQualifiers(NULL);
+		Nodes[Type].Quals = Quals;
+	}
+
+	uint32_t Symbol = NewNode(N_SYM_VARIABLE);
+	Nodes[Symbol].Variant = InStorageClass;
+	Nodes[Symbol].Child[1] = Type;
+	return bError ? NIL : Symbol;
+}
+
+// [<this qualifiers>] <calling convention> <return type> <parameters> <throw specification>
+uint32_t FMsvcDemangler::ParseFunctionType(bool bInHasThisQuals)
+{
+	uint32_t Function = NewNode(N_FUNCTION);
+	if (bInHasThisQuals)
+	{
+		uint8_t Quals = ParsePointerExtQualifiers();
+		uint32_t RefQualifier = Consume('G') ? FC_REF : (Consume('H') ? FC_RVALUE_REF : 0);
+		Quals |= ParseQualifiers(NULL);
+		Nodes[Function].Quals = Quals;
+		Nodes[Function].FuncClass |= RefQualifier;
+	}
+	uint8_t CallConv = ParseCallingConvention();
+	Nodes[Function].CallConv = CallConv;
+
+	// structors have no return type
+	if (!Consume('@'))
+	{
+		uint32_t ReturnType = ParseType(MODE_RESULT);
+		Nodes[Function].Child[0] = ReturnType;
+	}
+	if (bError)
+	{
+		return NIL;
+	}
+
+	ParseFunctionParameterList(Function);
+	if (bError)
+	{
+		return NIL;
+	}
+
+	if (Consume("_E"))
+	{
+		Nodes[Function].FuncClass |= FC_NOEXCEPT;
+	}
+	else if (!Consume('Z'))
+	{
+		return Fail();
+	}
+	return Function;
+}
+
+// X for void, else types up to '@', or up to 'Z' for variadic functions. types longer than one
+// character are memorized for the digits 0-9.
+void FMsvcDemangler::ParseFunctionParameterList(uint32_t InFunction)
+{
+	if (Consume('X'))
+	{
+		return;
+	}
+
+	size_t Mark = Stack.size();
+	while (!bError && Cursor < End && *Cursor != '@' && *Cursor != 'Z')
+	{
+		if (StartsWithDigit())
+		{
+			uint32_t Index = (uint32_t)(*Cursor++ - '0');
+			if (Index >= Backrefs.ParamCount)
+			{
+				Fail();
+				break;
+			}
+			Stack.push_back(Backrefs.Params[Index]);
+			continue;
+		}
+
+		const char *Start = Cursor;
+		uint32_t Type = ParseType(MODE_DROP);
+		if (bError)
+		{
+			break;
+		}
+		Stack.push_back(Type);
+		if (Backrefs.ParamCount < 10 && Cursor - Start > 1)
+		{
+			Backrefs.Params[Backrefs.ParamCount++] = Type;
+		}
+	}
+
+	if (bError || Cursor >= End)
+	{
+		Stack.resize(Mark);
+		Fail();
+		return;
+	}
+
+	EndList(InFunction, Mark);
+	Nodes[InFunction].Variant |= FN_PARAMETERS;
+	if (*Cursor++ == 'Z')
+	{
+		Nodes[InFunction].FuncClass |= FC_VARIADIC;
+	}
+}
+
+uint32_t FMsvcDemangler::ParseType(int32_t InMode)
+{
+	if (Depth >= MAX_DEPTH)
+	{
+		return Fail();
+	}
+	Depth++;
+	uint32_t Type = ParseTypeBody(InMode);
+	Depth--;
+	return bError ? NIL : Type;
+}
+
+uint32_t FMsvcDemangler::ParseTypeBody(int32_t InMode)
+{
+	uint8_t Quals = 0;
+	if (InMode == MODE_MANGLE || (InMode == MODE_RESULT && Consume('?')))
+	{
+		Quals = ParseQualifiers(NULL);
+	}
+	if (bError || Cursor >= End)
+	{
+		return Fail();
+	}
+
+	uint32_t Type;
+	char Code = *Cursor;
+	if (Code == 'T' || Code == 'U' || Code == 'V' || Code == 'W')
+	{
+		Type = ParseClassType();
+	}
+	else if (Code == 'A' || Code == 'B' || Code == 'P' || Code == 'Q' || Code == 'R' || Code == 'S' || StartsWith("$$Q") || StartsWith("$$R"))
+	{
+		Type = IsMemberPointer() ? ParseMemberPointerType() : (bError ? NIL : ParsePointerType());
+	}
+	else if (Code == 'Y')
+	{
+		Type = ParseArrayType();
+	}
+	else if (Consume("$$A8@@"))
+	{
+		Type = ParseFunctionType(true);
+	}
+	else if (Consume("$$A6"))
+	{
+		Type = ParseFunctionType(false);
+	}
+	else if (Code == '?')
+	{
+		// a template parameter of a template that is not instantiated
+		Cursor++;
+		uint32_t Identifier = ParseUnqualifiedTypeName(true);
+		if (bError || !Consume('@'))
+		{
+			return Fail();
+		}
+		Type = NewNode(N_CUSTOM);
+		Nodes[Type].Child[0] = Identifier;
+	}
+	else
+	{
+		Type = ParsePrimitiveType();
+	}
+
+	if (bError)
+	{
+		return NIL;
+	}
+	Nodes[Type].Quals |= Quals;
+	return Type;
+}
+
+uint32_t FMsvcDemangler::ParsePrimitiveType()
+{
+	struct FPrimitive
+	{
+		char		Code;
+		const char	*Name;
+	};
+	static const FPrimitive Primitives[] =
+	{
+		{ 'X', "void" }, { 'D', "char" }, { 'C', "signed char" }, { 'E', "unsigned char" }, { 'F', "short" },
+		{ 'G', "unsigned short" }, { 'H', "int" }, { 'I', "unsigned int" }, { 'J', "long" }, { 'K', "unsigned long" },
+		{ 'M', "float" }, { 'N', "double" }, { 'O', "long double" }
+	};
+	static const FPrimitive UnderPrimitives[] =
+	{
+		{ 'N', "bool" }, { 'J', "__int64" }, { 'K', "unsigned __int64" }, { 'W', "wchar_t" }, { 'Q', "char8_t" },
+		{ 'S', "char16_t" }, { 'U', "char32_t" }, { 'D', "__int8" }, { 'E', "unsigned __int8" }, { 'F', "__int16" },
+		{ 'G', "unsigned __int16" }, { 'H', "__int32" }, { 'I', "unsigned __int32" }, { 'L', "__int128" }, { 'M', "unsigned __int128" }
+	};
+
+	if (Consume("$$T"))
+	{
+		static const char Text[] = "std::nullptr_t";
+		return NewText(N_PRIMITIVE, Text, sizeof(Text) - 1);
+	}
+
+	const FPrimitive *Table = Primitives;
+	size_t Count = sizeof(Primitives) / sizeof(Primitives[0]);
+	if (Consume('_'))
+	{
+		Table = UnderPrimitives;
+		Count = sizeof(UnderPrimitives) / sizeof(UnderPrimitives[0]);
+	}
+	if (Cursor >= End)
+	{
+		return Fail();
+	}
+
+	char Code = *Cursor++;
+	for (size_t k = 0; k < Count; k++)
+	{
+		if (Table[k].Code == Code)
+		{
+			return NewText(N_PRIMITIVE, Table[k].Name, (uint32_t)strlen(Table[k].Name));
+		}
+	} // end for k
+	return Fail();
+}
+
+// T union, U struct, V class, W4 enum
+uint32_t FMsvcDemangler::ParseClassType()
+{
+	uint8_t Tag;
+	switch (*Cursor++)
+	{
+	case 'T': Tag = TAG_UNION; break;
+	case 'U': Tag = TAG_STRUCT; break;
+	case 'V': Tag = TAG_CLASS; break;
+	default:
+		if (!Consume('4'))
+		{
+			return Fail();
+		}
+		Tag = TAG_ENUM;
+		break;
+	}
+
+	uint32_t Type = NewNode(N_TAG);
+	Nodes[Type].Variant = Tag;
+	uint32_t Name = ParseFullyQualifiedTypeName();
+	Nodes[Type].Child[0] = Name;
+	return bError ? NIL : Type;
+}
+
+// P6 function pointer, P8 member function pointer, PQ data member pointer. the cursor does not move.
+bool FMsvcDemangler::IsMemberPointer()
+{
+	const char *Ptr = Cursor;
+	switch (*Ptr++)
+	{
+	case 'P': case 'Q': case 'R': case 'S':
+		break;
+	default:
+		// references, rvalue references
+		return false;
+	}
+
+	if (Ptr < End && IsDigit(*Ptr))
+	{
+		if (*Ptr != '6' && *Ptr != '8')
+		{
+			Fail();
+			return false;
+		}
+		return *Ptr == '8';
+	}
+
+	// extended qualifiers come on both kinds
+	for (const char *Ext = "EIF"; *Ext; Ext++)
+	{
+		if (Ptr < End && *Ptr == *Ext)
+		{
+			Ptr++;
+		}
+	} // end for Ext
+	if (Ptr >= End)
+	{
+		Fail();
+		return false;
+	}
+	if (*Ptr >= 'A' && *Ptr <= 'D')
+	{
+		return false;
+	}
+	if (*Ptr >= 'Q' && *Ptr <= 'T')
+	{
+		return true;
+	}
+	Fail();
+	return false;
+}
+
+uint32_t FMsvcDemangler::ParsePointerType()
+{
+	uint32_t Pointer = NewNode(N_POINTER);
+	uint8_t Quals, Affinity;
+	ParsePointerCVQualifiers(Quals, Affinity);
+	Nodes[Pointer].Quals = Quals;
+	Nodes[Pointer].Variant = Affinity;
+	if (bError)
+	{
+		return NIL;
+	}
+
+	uint32_t Pointee;
+	if (Consume('6'))
+	{
+		Pointee = ParseFunctionType(false);
+	}
+	else
+	{
+		uint8_t ExtQuals = ParsePointerExtQualifiers();
+		Nodes[Pointer].Quals |= ExtQuals;
+		Pointee = ParseType(MODE_MANGLE);
+	}
+	Nodes[Pointer].Child[0] = Pointee;
+	return bError ? NIL : Pointer;
+}
+
+uint32_t FMsvcDemangler::ParseMemberPointerType()
+{
+	uint32_t Pointer = NewNode(N_POINTER);
+	uint8_t Quals, Affinity;
+	ParsePointerCVQualifiers(Quals, Affinity);
+	Quals |= ParsePointerExtQualifiers();
+	Nodes[Pointer].Quals = Quals;
+	Nodes[Pointer].Variant = Affinity;
+
+	uint32_t Class, Pointee;
+	if (Consume('8'))
+	{
+		Class = ParseFullyQualifiedTypeName();
+		Pointee = bError ? NIL : ParseFunctionType(true);
+	}
+	else
+	{
+		uint8_t PointeeQuals = ParseQualifiers(NULL);
+		Class = bError ? NIL : ParseFullyQualifiedTypeName();
+		Pointee = bError ? NIL : ParseType(MODE_DROP);
+		if (!bError)
+		{
+			Nodes[Pointee].Quals = PointeeQuals;
+		}
+	}
+	if (bError)
+	{
+		return NIL;
+	}
+	Nodes[Pointer].Child[0] = Pointee;
+	Nodes[Pointer].Child[1] = Class;
+	return Pointer;
+}
+
+// Y <rank> <dimension>... [$$C <qualifiers>] <element type>
+uint32_t FMsvcDemangler::ParseArrayType()
+{
+	Cursor++;
+	uint64_t Rank;
+	bool bNegative;
+	if (!ParseNumber(Rank, bNegative) || bNegative || Rank == 0 || Rank > 32)
+	{
+		return Fail();
+	}
+
+	uint32_t Array = NewNode(N_ARRAY);
+	size_t Mark = Stack.size();
+	for (uint64_t k = 0; k < Rank; k++)
+	{
+		uint64_t Dimension;
+		if (!ParseNumber(Dimension, bNegative) || bNegative)
+		{
+			Stack.resize(Mark);
+			return Fail();
+		}
+		uint32_t Integer = NewNode(N_INTEGER);
+		Nodes[Integer].Values[0] = (int64_t)Dimension;
+		Stack.push_back(Integer);
+	} // end for k
+	EndList(Array, Mark);
+
+	if (Consume("$$C"))
+	{
+		bool bMember;
+		uint8_t Quals = ParseQualifiers(&bMember);
+		if (bMember)
+		{
+			return Fail();
+		}
+		Nodes[Array].Quals = Quals;
+	}
+
+	uint32_t Element = ParseType(MODE_DROP);
+	Nodes[Array].Child[0] = Element;
+	return bError ? NIL : Array;
+}
+
+// template arguments up to '@': types, integers, symbols and member pointers. empty packs add nothing.
+void FMsvcDemangler::ParseTemplateParameterList()
+{
+	while (!Consume('@'))
+	{
+		if (Cursor >= End)
+		{
+			Fail();
+			return;
+		}
+		if (Consume("$S") || Consume("$$V") || Consume("$$$V") || Consume("$$Z"))
+		{
+			continue;
+		}
+
+		// auto non type parameters carry their type, it is not printed
+		bool bAuto = Consume("$M");
+		if (bAuto)
+		{
+			ParseType(MODE_DROP);
+			if (bError)
+			{
+				return;
+			}
+		}
+
+		const char Prefix = bAuto ? 0 : '$';
+		char Code = 0;
+		if (Cursor < End && (Prefix == 0 || (*Cursor == '$' && Cursor + 1 < End)))
+		{
+			Code = Prefix == 0 ? *Cursor : Cursor[1];
+		}
+
+		uint32_t Argument;
+		if (Consume("$$Y"))
+		{
+			// alias template
+			Argument = ParseFullyQualifiedTypeName();
+		}
+		else if (Consume("$$B"))
+		{
+			Argument = ParseType(MODE_DROP);
+		}
+		else if (Consume("$$C"))
+		{
+			Argument = ParseType(MODE_MANGLE);
+		}
+		else if (Code == '1' || Code == 'H' || Code == 'I' || Code == 'J')
+		{
+			// &symbol, or a member pointer with 1, 2 or 3 offsets
+			Cursor += Prefix ? 2 : 1;
+			Argument = NewNode(N_TEMPLATE_REF);
+			Nodes[Argument].Quals = 1;
+			if (StartsWith("?"))
+			{
+				uint32_t Symbol = ParseSymbol();
+				if (bError || Nodes[Symbol].Child[0] == NIL)
+				{
+					Fail();
+					return;
+				}
+				const FNode &Name = Nodes[Nodes[Symbol].Child[0]];
+				MemorizeIdentifier(Lists[Name.ListBegin + Name.ListCount - 1]);
+				Nodes[Argument].Child[0] = Symbol;
+			}
+			uint8_t Count = Code == 'J' ? 3 : (Code == 'I' ? 2 : (Code == 'H' ? 1 : 0));
+			for (uint8_t k = 0; k < Count; k++)
+			{
+				int64_t Offset = ParseSigned();
+				Nodes[Argument].Values[k] = Offset;
+			} // end for k
+			Nodes[Argument].Variant = Count;
+		}
+		else if (Consume("$E?"))
+		{
+			// reference to a symbol
+			Cursor--;
+			Argument = NewNode(N_TEMPLATE_REF);
+			uint32_t Symbol = ParseSymbol();
+			Nodes[Argument].Child[0] = Symbol;
+		}
+		else if (Code == 'F' || Code == 'G')
+		{
+			// data member pointer offsets
+			Cursor += Prefix ? 2 : 1;
+			Argument = NewNode(N_TEMPLATE_REF);
+			uint8_t Count = Code == 'G' ? 3 : 2;
+			for (uint8_t k = 0; k < Count; k++)
+			{
+				int64_t Offset = ParseSigned();
+				Nodes[Argument].Values[k] = Offset;
+			} // end for k
+			Nodes[Argument].Variant = Count;
+		}
+		else if (Code == '0')
+		{
+			Cursor += Prefix ? 2 : 1;
+			uint64_t Value;
+			bool bNegative;
+			ParseNumber(Value, bNegative);
+			Argument = NewNode(N_INTEGER);
+			Nodes[Argument].Values[0] = (int64_t)Value;
+			Nodes[Argument].Variant = bNegative ? 1 : 0;
+		}
+		else
+		{
+			Argument = ParseType(MODE_DROP);
+		}
+
+		if (bError)
+		{
+			return;
+		}
+		Stack.push_back(Argument);
+	}
+}
+
+void FMsvcDemangler::PrintList(uint32_t InNode, const char *InSeparator, std::string &Out) const
+{
+	const FNode &Node = Nodes[InNode];
+	for (uint32_t k = 0; k < Node.ListCount; k++)
+	{
+		if (k)
+		{
+			Out += InSeparator;
+		}
+		Print(Lists[Node.ListBegin + k], Out);
+	} // end for k
+}
+
+void FMsvcDemangler::PrintTemplateArguments(uint32_t InIdentifier, std::string &Out) const
+{
+	if (Nodes[InIdentifier].FuncClass & ID_TEMPLATE)
+	{
+		Out += '<';
+		PrintList(InIdentifier, ", ", Out);
+		Out += '>';
+	}
+}
+
+void FMsvcDemangler::PrintIdentifier(uint32_t InIdentifier, std::string &Out) const
+{
+	const FNode &Node = Nodes[InIdentifier];
+	switch (Node.Kind)
+	{
+	case N_NAME:
+		Out.append(Node.Text, Node.Length);
+		break;
+
+	case N_STRUCTOR:
+		if (Node.Variant)
+		{
+			Out += '~';
+		}
+		if (Node.Child[0] != NIL)
+		{
+			PrintIdentifier(Node.Child[0], Out);
+		}
+		break;
+
+	case N_CONVERSION:
+		Out += "operator";
+		PrintTemplateArguments(InIdentifier, Out);
+		Out += ' ';
+		if (Node.Child[0] != NIL)
+		{
+			Print(Node.Child[0], Out);
+		}
+		return;
+
+	case N_LITERAL_OPERATOR:
+		Out += "operator \"\"";
+		Out.append(Node.Text, Node.Length);
+		break;
+
+	case N_LOCAL_GUARD:
+		Out += Node.Variant ? "`local static thread guard'" : "`local static guard'";
+		if (Node.Values[0] > 0)
+		{
+			Out += '{';
+			AppendNumber(Out, Node.Values[0]);
+			Out += '}';
+		}
+		break;
+
+	case N_DYNAMIC_STRUCTOR:
+		Out += Node.Variant ? "`dynamic atexit destructor for " : "`dynamic initializer for ";
+		if (Node.Child[0] != NIL)
+		{
+			Out += '`';
+			Print(Node.Child[0], Out);
+		}
+		else
+		{
+			Out += '\'';
+			Print(Node.Child[1], Out);
+		}
+		Out += "''";
+		break;
+
+	case N_VCALL:
+		Out += "`vcall'{";
+		AppendNumber(Out, Node.Values[0]);
+		Out += ", {flat}}";
+		break;
+
+	case N_RTTI_BCD:
+		Out += "`RTTI Base Class Descriptor at (";
+		for (uint32_t k = 0; k < 4; k++)
+		{
+			if (k)
+			{
+				Out += ", ";
+			}
+			AppendNumber(Out, Node.Values[k]);
+		} // end for k
+		Out += ")'";
+		break;
+	}
+	PrintTemplateArguments(InIdentifier, Out);
+}
+
+// access, storage, return type and calling convention
+void FMsvcDemangler::PrintFunctionPre(uint32_t InFunction, std::string &Out, bool bInNoCallingConvention) const
+{
+	const FNode &Node = Nodes[InFunction];
+	uint32_t Class = Node.FuncClass;
+	if (Node.Variant & FN_THUNK)
+	{
+		Out += "[thunk]: ";
+	}
+
+	if (Class & FC_PUBLIC)
+	{
+		Out += "public: ";
+	}
+	if (Class & FC_PROTECTED)
+	{
+		Out += "protected: ";
+	}
+	if (Class & FC_PRIVATE)
+	{
+		Out += "private: ";
+	}
+	if (!(Class & FC_GLOBAL) && (Class & FC_STATIC))
+	{
+		Out += "static ";
+	}
+	if (Class & FC_VIRTUAL)
+	{
+		Out += "virtual ";
+	}
+	if (Class & FC_EXTERNC)
+	{
+		Out += "extern \"C\" ";
+	}
+
+	if (Node.Child[0] != NIL)
+	{
+		PrintPre(Node.Child[0], Out);
+		Out += ' ';
+	}
+	if (!bInNoCallingConvention && Node.CallConv != CC_NONE)
+	{
+		SpaceIfNecessary(Out);
+		Out += CallingConventions[Node.CallConv];
+	}
+}
+
+// this adjustment of thunks, parameters, qualifiers of this, the declarator of the return type
+void FMsvcDemangler::PrintFunctionPost(uint32_t InFunction, std::string &Out) const
+{
+	const FNode &Node = Nodes[InFunction];
+	uint32_t Class = Node.FuncClass;
+	if (Node.Variant & FN_THUNK)
+	{
+		if (Class & FC_STATIC_ADJUST)
+		{
+			Out += "`adjustor{";
+			AppendNumber(Out, Node.Values[0]);
+			Out += "}'";
+		}
+		else if (Class & FC_VIRTUAL_ADJUST_EX)
+		{
+			Out += "`vtordispex{";
+			AppendNumber(Out, Node.Values[2]);
+			Out += ", ";
+			AppendNumber(Out, Node.Values[3]);
+			Out += ", ";
+			AppendNumber(Out, Node.Values[1]);
+			Out += ", ";
+			AppendNumber(Out, Node.Values[0]);
+			Out += "}'";
+		}
+		else if (Class & FC_VIRTUAL_ADJUST)
+		{
+			Out += "`vtordisp{";
+			AppendNumber(Out, Node.Values[1]);
+			Out += ", ";
+			AppendNumber(Out, Node.Values[0]);
+			Out += "}'";
+		}
+	}
+
+	if (!(Class & FC_NO_PARAMETER_LIST))
+	{
+		Out += '(';
+		if (Node.Variant & FN_PARAMETERS)
+		{
+			PrintList(InFunction, ", ", Out);
+		}
+		else
+		{
+			Out += "void";
+		}
+		if (Class & FC_VARIADIC)
+		{
+			if (Out.back() != '(')
+			{
+				Out += ", ";
+			}
+			Out += "...";
+		}
+		Out += ')';
+	}
+
+	if (Node.Quals & Q_CONST)
+	{
+		Out += " const";
+	}
+	if (Node.Quals & Q_VOLATILE)
+	{
+		Out += " volatile";
+	}
+	if (Node.Quals & Q_RESTRICT)
+	{
+		Out += " __restrict";
+	}
+	if (Node.Quals & Q_UNALIGNED)
+	{
+		Out += " __unaligned";
+	}
+	if (Class & FC_NOEXCEPT)
+	{
+		Out += " noexcept";
+	}
+	if (Class & FC_REF)
+	{
+		Out += " &";
+	}
+	else if (Class & FC_RVALUE_REF)
+	{
+		Out += " &&";
+	}
+
+	if (Node.Child[0] != NIL)
+	{
+		PrintPost(Node.Child[0], Out);
+	}
+}
+
+// the part of a type before the declarator name: "int (*", "void (__cdecl *"
+void FMsvcDemangler::PrintPre(uint32_t InType, std::string &Out, bool bInNoCallingConvention) const
+{
+	static const char* const Tags[4] = { "class ", "struct ", "union ", "enum " };
+
+	const FNode &Node = Nodes[InType];
+	switch (Node.Kind)
+	{
+	case N_PRIMITIVE:
+		Out.append(Node.Text, Node.Length);
+		PrintQualifiers(Out, Node.Quals, true, false);
+		break;
+
+	case N_TAG:
+		Out += Tags[Node.Variant];
+		Print(Node.Child[0], Out);
+		PrintQualifiers(Out, Node.Quals, true, false);
+		break;
+
+	case N_CUSTOM:
+		PrintIdentifier(Node.Child[0], Out);
+		break;
+
+	case N_ARRAY:
+		PrintPre(Node.Child[0], Out);
+		PrintQualifiers(Out, Node.Quals, true, false);
+		break;
+
+	case N_FUNCTION:
+		PrintFunctionPre(InType, Out, bInNoCallingConvention);
+		break;
+
+	case N_POINTER:
+	{
+		const FNode &Pointee = Nodes[Node.Child[0]];
+		// the calling convention of a function pointer goes inside the parentheses
+		PrintPre(Node.Child[0], Out, Pointee.Kind == N_FUNCTION);
+		SpaceIfNecessary(Out);
+		if (Node.Quals & Q_UNALIGNED)
+		{
+			Out += "__unaligned ";
+		}
+		if (Pointee.Kind == N_ARRAY)
+		{
+			Out += '(';
+		}
+		else if (Pointee.Kind == N_FUNCTION)
+		{
+			Out += '(';
+			if (Pointee.CallConv != CC_NONE)
+			{
+				Out += CallingConventions[Pointee.CallConv];
+			}
+			Out += ' ';
+		}
+		if (Node.Child[1] != NIL)
+		{
+			Print(Node.Child[1], Out);
+			Out += "::";
+		}
+		Out += Node.Variant == PA_POINTER ? "*" : (Node.Variant == PA_REFERENCE ? "&" : "&&");
+		PrintQualifiers(Out, Node.Quals, false, false);
+		break;
+	}
+	}
+}
+
+// the part of a type after the declarator name: ")[3]", ")(int)"
+void FMsvcDemangler::PrintPost(uint32_t InType, std::string &Out) const
+{
+	const FNode &Node = Nodes[InType];
+	switch (Node.Kind)
+	{
+	case N_ARRAY:
+		Out += '[';
+		PrintList(InType, "][", Out);
+		Out += ']';
+		PrintPost(Node.Child[0], Out);
+		break;
+
+	case N_FUNCTION:
+		PrintFunctionPost(InType, Out);
+		break;
+
+	case N_POINTER:
+	{
+		uint8_t PointeeKind = Nodes[Node.Child[0]].Kind;
+		if (PointeeKind == N_ARRAY || PointeeKind == N_FUNCTION)
+		{
+			Out += ')';
+		}
+		PrintPost(Node.Child[0], Out);
+		break;
+	}
+	}
+}
+
+void FMsvcDemangler::Print(uint32_t InNode, std::string &Out, bool bInNameOnly) const
+{
+	static const char* const Access[3] = { "private: ", "protected: ", "public: " };
+
+	const FNode &Node = Nodes[InNode];
+	switch (Node.Kind)
+	{
+	case N_PRIMITIVE:
+	case N_TAG:
+	case N_POINTER:
+	case N_ARRAY:
+	case N_FUNCTION:
+	case N_CUSTOM:
+		PrintPre(InNode, Out);
+		PrintPost(InNode, Out);
+		break;
+
+	case N_INTEGER:
+		if (Node.Variant)
+		{
+			Out += '-';
+		}
+		AppendUnsigned(Out, (uint64_t)Node.Values[0]);
+		break;
+
+	case N_TEMPLATE_REF:
+		if (Node.Variant)
+		{
+			Out += '{';
+		}
+		else if (Node.Quals)
+		{
+			Out += '&';
+		}
+		if (Node.Child[0] != NIL)
+		{
+			Print(Node.Child[0], Out);
+			if (Node.Variant)
+			{
+				Out += ", ";
+			}
+		}
+		for (uint32_t k = 0; k < Node.Variant; k++)
+		{
+			if (k)
+			{
+				Out += ", ";
+			}
+			AppendNumber(Out, Node.Values[k]);
+		} // end for k
+		if (Node.Variant)
+		{
+			Out += '}';
+		}
+		break;
+
+	case N_QUALIFIED_NAME:
+		for (uint32_t k = 0; k < Node.ListCount; k++)
+		{
+			if (k)
+			{
+				Out += "::";
+			}
+			PrintIdentifier(Lists[Node.ListBegin + k], Out);
+		} // end for k
+		break;
+
+	case N_SYM_FUNCTION:
+		if (bInNameOnly)
+		{
+			Print(Node.Child[0], Out);
+			break;
+		}
+		PrintFunctionPre(Node.Child[1], Out, false);
+		SpaceIfNecessary(Out);
+		Print(Node.Child[0], Out);
+		PrintFunctionPost(Node.Child[1], Out);
+		break;
+
+	case N_SYM_VARIABLE:
+		if (bInNameOnly)
+		{
+			Print(Node.Child[0], Out);
+			break;
+		}
+		if (Node.Variant <= SC_PUBLIC_STATIC)
+		{
+			Out += Access[Node.Variant];
+			Out += "static ";
+		}
+		if (Node.Child[1] != NIL)
+		{
+			PrintPre(Node.Child[1], Out);
+			SpaceIfNecessary(Out);
+		}
+		Print(Node.Child[0], Out);
+		if (Node.Child[1] != NIL)
+		{
+			PrintPost(Node.Child[1], Out);
+		}
+		break;
+
+	case N_SYM_TABLE:
+		if (!bInNameOnly)
+		{
+			PrintQualifiers(Out, Node.Quals, false, true);
+		}
+		Print(Node.Child[0], Out);
+		if (Node.Child[1] != NIL)
+		{
+			Out += "{for `";
+			Print(Node.Child[1], Out);
+			Out += "'}";
+		}
+		break;
+
+	case N_SYM_NAME:
+		Print(Node.Child[0], Out);
+		break;
+
+	case N_SYM_STRING:
+		Out.append(Node.Text, Node.Length);
+		break;
+
+	default:
+		PrintIdentifier(InNode, Out);
+		break;
+	}
+}
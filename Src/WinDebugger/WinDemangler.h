@@ -0,0 +1,160 @@
+// \brief
+//		portable MSVC C++ name demangler. names are parsed into a node tree, then printed the way
+//		undname does: templates, back references, operators and special names, function and member
+//		pointers, arrays, thunks and RTTI records. results are memoized per decorated name and kept
+//		in an arena, a name is never demangled twice.
+//
+// ref: https://en.wikiversity.org/wiki/Visual_C%2B%2B_name_mangling
+//
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <deque>
+
+
+class FMsvcDemangler
+{
+public:
+	FMsvcDemangler();
+	~FMsvcDemangler();
+
+	// the demangled name, NULL if InMangled is not an MSVC decorated name. bInNameOnly keeps the qualified
+	// name alone, the way UNDNAME_NAME_ONLY does. the result stays valid until Clear().
+	const char* Demangle(const char *InMangled, bool bInNameOnly = false);
+	void Clear();
+
+	size_t GetMemoryUsage() const;
+	uint64_t GetHitCount() const { return HitCount; }
+	uint64_t GetMissCount() const { return MissCount; }
+
+private:
+	FMsvcDemangler(const FMsvcDemangler&);
+	FMsvcDemangler& operator=(const FMsvcDemangler&);
+
+	// a node of the parsed name, the meaning of the fields depends on Kind
+	struct FNode
+	{
+		uint8_t			Kind;
+		uint8_t			Quals;			// NSDemangle::Q_xxx
+		uint8_t			Variant;		// tag, pointer affinity, storage class, ...
+		uint8_t			CallConv;
+		uint32_t		FuncClass;		// NSDemangle::FC_xxx, ID_TEMPLATE for identifiers
+		const char		*Text;
+		uint32_t		Length;
+		uint32_t		Child[2];
+		uint32_t		ListBegin;		// into Lists
+		uint32_t		ListCount;
+		int64_t			Values[4];
+	};
+
+	// names and function parameter types a digit refers to
+	struct FBackrefs
+	{
+		const char		*Names[10];
+		uint32_t		NameLengths[10];
+		uint32_t		NameCount;
+		uint32_t		Params[10];
+		uint32_t		ParamCount;
+	};
+
+	struct FMemoEntry
+	{
+		uint64_t		Hash;
+		const char		*Mangled;
+		const char		*Result;		// kFailed if the name could not be demangled
+	};
+
+	// memo and arena
+	const char* CopyToArena(const char *InText, size_t InLength);
+	FMemoEntry* FindEntry(uint64_t InHash, const char *InMangled, size_t InLength);
+	void GrowMemo();
+	bool Run(const char *InMangled, size_t InLength, bool bInNameOnly);
+
+	// parser
+	uint32_t NewNode(uint8_t InKind);
+	uint32_t NewText(uint8_t InKind, const char *InText, uint32_t InLength);
+	uint32_t CopyText(const std::string &InText);
+	void EndList(uint32_t InNode, size_t InStackMark);
+	bool Consume(char InChar);
+	bool Consume(const char *InPrefix);
+	bool StartsWith(const char *InPrefix) const;
+	bool StartsWithDigit() const;
+	uint32_t Fail();
+
+	void Memorize(const char *InText, uint32_t InLength);
+	void MemorizeIdentifier(uint32_t InIdentifier);
+
+	uint32_t ParseSymbol();
+	uint32_t ParseSpecialIntrinsic(bool &bOutHandled);
+	uint32_t ParseDeclarator();
+	uint32_t ParseFullyQualifiedSymbolName();
+	uint32_t ParseFullyQualifiedTypeName();
+	uint32_t ParseNameScopeChain(uint32_t InUnqualifiedName);
+	uint32_t ParseUnqualifiedSymbolName();
+	uint32_t ParseUnqualifiedTypeName(bool bInMemorize);
+	uint32_t ParseNameScopePiece();
+	uint32_t ParseTemplateInstantiationName(bool bInMemorize);
+	uint32_t ParseSimpleName(bool bInMemorize);
+	uint32_t ParseBackRefName();
+	uint32_t ParseLocallyScopedNamePiece();
+	uint32_t ParseFunctionIdentifierCode();
+	uint32_t ParseEncodedSymbol(uint32_t InName);
+	uint32_t ParseFunctionEncoding();
+	uint32_t ParseVariableEncoding(uint8_t InStorageClass);
+	uint32_t ParseInitFiniStub(bool bInDestructor);
+	uint32_t ParseSpecialTable(const char *InName);
+	uint32_t MakeRttiVariable(const char *InName, uint32_t InType);
+	uint32_t ParseType(int32_t InMode);
+	uint32_t ParseTypeBody(int32_t InMode);
+	uint32_t ParsePrimitiveType();
+	uint32_t ParseClassType();
+	uint32_t ParsePointerType();
+	uint32_t ParseMemberPointerType();
+	uint32_t ParseArrayType();
+	uint32_t ParseFunctionType(bool bInHasThisQuals);
+	void ParseTemplateParameterList();
+	void ParseFunctionParameterList(uint32_t InFunction);
+	bool ParseNumber(uint64_t &OutValue, bool &bOutNegative);
+	int64_t ParseSigned();
+	uint8_t ParseQualifiers(bool *OutIsMember);
+	void ParsePointerCVQualifiers(uint8_t &OutQuals, uint8_t &OutAffinity);
+	uint8_t ParsePointerExtQualifiers();
+	uint8_t ParseCallingConvention();
+	uint32_t ParseFunctionClass();
+	bool IsMemberPointer();
+
+	// printer
+	void Print(uint32_t InNode, std::string &Out, bool bInNameOnly = false) const;
+	void PrintPre(uint32_t InType, std::string &Out, bool bInNoCallingConvention = false) const;
+	void PrintPost(uint32_t InType, std::string &Out) const;
+	void PrintList(uint32_t InNode, const char *InSeparator, std::string &Out) const;
+	void PrintIdentifier(uint32_t InIdentifier, std::string &Out) const;
+	void PrintTemplateArguments(uint32_t InIdentifier, std::string &Out) const;
+	void PrintFunctionPre(uint32_t InFunction, std::string &Out, bool bInNoCallingConvention) const;
+	void PrintFunctionPost(uint32_t InFunction, std::string &Out) const;
+
+	// parser state, reused between names
+	const char					*Cursor;
+	const char					*End;
+	bool						bError;
+	uint32_t					Depth;
+	std::vector<FNode>			Nodes;
+	std::vector<uint32_t>		Lists;
+	std::vector<uint32_t>		Stack;		// list items until their list is complete
+	std::deque<std::string>		TextPool;	// rendered names of back references and scopes
+	FBackrefs					Backrefs;
+	std::string					Output;
+
+	// memo
+	std::vector<FMemoEntry>		Memo;
+	uint32_t					MemoCount;
+	std::vector<char*>			Blocks;
+	size_t						BlockUsed;
+	size_t						ArenaBytes;
+	uint64_t					HitCount;
+	uint64_t					MissCount;
+};
@@ -0,0 +1,243 @@
+// \brief
+//		heap snapshot & diff.
+//
+
+#include "WinHeapSnapshot.h"
+
+#include <algorithm>
+
+
+// collect the busy blocks of one heap
+class FSnapshotVisitor : public FHeapBlockVisitor
+{
+public:
+	FSnapshotVisitor(std::vector<FHeapSnapshot::FBlock> &InBlocks, std::vector<FHeapSnapshot::FLfhUserBlocks> &InLfhUserBlocks, uint16_t InHeapIndex)
+		: Blocks(InBlocks)
+		, LfhUserBlocks(InLfhUserBlocks)
+		, HeapIndex(InHeapIndex)
+		, LfhBusyBlocks(0)
+		, bHasBackTraces(false)
+	{}
+
+	virtual void VisitBlock(const FHeapBlock &InBlock) override
+	{
+		if (!(InBlock.Flags & kHeapEntry_Busy))
+		{
+			return;
+		}
+
+		if (InBlock.Flags & kHeapEntry_LfhUserBlocks)
+		{
+			FHeapSnapshot::FLfhUserBlocks Entry;
+			Entry.Address = InBlock.Address;
+			Entry.Size = InBlock.Size > 0xFFFFFFFF ? 0xFFFFFFFF : (uint32_t)InBlock.Size;
+			Entry.HeapIndex = HeapIndex;
+			Entry.BusyBlocks = InBlock.LfhBusyBlocks;
+			LfhUserBlocks.push_back(Entry);
+			LfhBusyBlocks += InBlock.LfhBusyBlocks;
+			return;
+		}
+
+		FHeapSnapshot::FBlock Entry;
+		Entry.Address = InBlock.Address;
+		Entry.Size = InBlock.Size > 0xFFFFFFFF ? 0xFFFFFFFF : (uint32_t)InBlock.Size;
+		Entry.HeapIndex = HeapIndex;
+		Entry.BackTraceIndex = (uint16_t)InBlock.BackTraceIndex;
+		Blocks.push_back(Entry);
+
+		bHasBackTraces = bHasBackTraces || InBlock.BackTraceIndex != 0;
+	}
+
+	std::vector<FHeapSnapshot::FBlock>			&Blocks;
+	std::vector<FHeapSnapshot::FLfhUserBlocks>	&LfhUserBlocks;
+	uint16_t	HeapIndex;
+	uint64_t	LfhBusyBlocks;
+	bool		bHasBackTraces;
+};
+
+static bool BlockAddressLess(const FHeapSnapshot::FBlock &A, const FHeapSnapshot::FBlock &B)
+{
+	return A.Address < B.Address;
+}
+
+static bool UserBlocksAddressLess(const FHeapSnapshot::FLfhUserBlocks &A, const FHeapSnapshot::FLfhUserBlocks &B)
+{
+	return A.Address < B.Address;
+}
+
+bool FHeapSnapshot::Capture(FNtHeapWalker &InWalker, const std::vector<uint64_t> &InHeaps)
+{
+	Blocks.clear();
+	LfhUserBlocks.clear();
+	Heaps = InHeaps;
+	TotalBytes = 0;
+	LfhBusyBlocks = 0;
+	bHasBackTraces = false;
+
+	bool bAnyHeap = false;
+	for (size_t k = 0; k < InHeaps.size(); k++)
+	{
+		FHeapStatistics Stats;
+		FSnapshotVisitor Visitor(Blocks, LfhUserBlocks, (uint16_t)k);
+		if (InWalker.WalkHeap(InHeaps[k], Stats, &Visitor))
+		{
+			bAnyHeap = true;
+			bHasBackTraces = bHasBackTraces || Visitor.bHasBackTraces;
+			TotalBytes += Stats.BusyBytes + Stats.VirtualBytes;
+			LfhBusyBlocks += Visitor.LfhBusyBlocks;
+		}
+	} // end for k
+
+	// blocks are ordered inside a segment, segments and heaps are not.
+	std::sort(Blocks.begin(), Blocks.end(), &BlockAddressLess);
+	std::sort(LfhUserBlocks.begin(), LfhUserBlocks.end(), &UserBlocksAddressLess);
+	return bAnyHeap;
+}
+
+//////////////////////////////////////////////////////////////////////////
+void FHeapSnapshotDiff::AddBlock(const FHeapSnapshot::FBlock &InBlock, bool bIsNew)
+{
+	const int64_t Blocks = 1;
+	const int64_t Bytes = InBlock.Size;
+
+	if (bIsNew)
+	{
+		TotalNewBlocks += Blocks;
+		TotalNewBytes += Bytes;
+	}
+	else
+	{
+		TotalFreedBlocks += Blocks;
+		TotalFreedBytes += Bytes;
+	}
+
+	FGroup &SizeGroup = SizeClassGroups[FHeapStatistics::GetSizeClass(InBlock.Size)];
+	(bIsNew ? SizeGroup.NewBlocks : SizeGroup.FreedBlocks) += Blocks;
+	(bIsNew ? SizeGroup.NewBytes : SizeGroup.FreedBytes) += Bytes;
+
+	if (InBlock.BackTraceIndex)
+	{
+		uint32_t &Slot = BackTraceSlots[InBlock.BackTraceIndex];
+		if (!Slot)
+		{
+			FGroup NewGroup = { InBlock.BackTraceIndex, 0, 0, 0, 0 };
+			BackTraceGroups.push_back(NewGroup);
+			Slot = (uint32_t)BackTraceGroups.size();
+		}
+
+		FGroup &StackGroup = BackTraceGroups[Slot - 1];
+		(bIsNew ? StackGroup.NewBlocks : StackGroup.FreedBlocks) += Blocks;
+		(bIsNew ? StackGroup.NewBytes : StackGroup.FreedBytes) += Bytes;
+	}
+}
+
+static bool GroupGrowthGreater(const FHeapSnapshotDiff::FGroup &A, const FHeapSnapshotDiff::FGroup &B)
+{
+	return (A.NewBytes - A.FreedBytes) > (B.NewBytes - B.FreedBytes);
+}
+
+void FHeapSnapshotDiff::SortGroups(std::vector<FGroup> &InOutGroups)
+{
+	// drop untouched groups
+	size_t Count = 0;
+	for (size_t k = 0; k < InOutGroups.size(); k++)
+	{
+		if (InOutGroups[k].NewBlocks || InOutGroups[k].FreedBlocks)
+		{
+			InOutGroups[Count++] = InOutGroups[k];
+		}
+	} // end for k
+	InOutGroups.resize(Count);
+
+	std::stable_sort(InOutGroups.begin(), InOutGroups.end(), &GroupGrowthGreater);
+}
+
+void FHeapSnapshotDiff::Compare(const FHeapSnapshot &InOld, const FHeapSnapshot &InNew)
+{
+	TotalNewBlocks = TotalNewBytes = TotalFreedBlocks = TotalFreedBytes = 0;
+
+	SizeClassGroups.resize(kHeapSizeClasses);
+	for (uint32_t k = 0; k < kHeapSizeClasses; k++)
+	{
+		FGroup Empty = { k, 0, 0, 0, 0 };
+		SizeClassGroups[k] = Empty;
+	} // end for k
+	BackTraceGroups.clear();
+	BackTraceSlots.assign(0x10000, 0);
+
+	const std::vector<FHeapSnapshot::FBlock> &OldBlocks = InOld.GetBlocks();
+	const std::vector<FHeapSnapshot::FBlock> &NewBlocks = InNew.GetBlocks();
+	size_t i = 0, j = 0;
+	while (i < OldBlocks.size() || j < NewBlocks.size())
+	{
+		if (j == NewBlocks.size() || (i < OldBlocks.size() && OldBlocks[i].Address < NewBlocks[j].Address))
+		{
+			AddBlock(OldBlocks[i++], false);
+		}
+		else if (i == OldBlocks.size() || NewBlocks[j].Address < OldBlocks[i].Address)
+		{
+			AddBlock(NewBlocks[j++], true);
+		}
+		else
+		{
+			// same address: it is the same allocation unless the block was reused.
+			const FHeapSnapshot::FBlock &OldBlock = OldBlocks[i++];
+			const FHeapSnapshot::FBlock &NewBlock = NewBlocks[j++];
+			if (OldBlock.Size != NewBlock.Size || OldBlock.BackTraceIndex != NewBlock.BackTraceIndex
+				|| InOld.GetHeapAddress(OldBlock.HeapIndex) != InNew.GetHeapAddress(NewBlock.HeapIndex))
+			{
+				AddBlock(OldBlock, false);
+				AddBlock(NewBlock, true);
+			}
+		}
+	} // end while
+
+	SortGroups(SizeClassGroups);
+	SortGroups(BackTraceGroups);
+	BackTraceSlots.clear();
+
+	CompareLfh(InOld, InNew);
+}
+
+// the same user blocks gained or lost LFH blocks, new and freed ones bring or take all of theirs
+void FHeapSnapshotDiff::CompareLfh(const FHeapSnapshot &InOld, const FHeapSnapshot &InNew)
+{
+	LfhNewUserBlocks = LfhFreedUserBlocks = LfhNewBlocks = LfhFreedBlocks = 0;
+
+	const std::vector<FHeapSnapshot::FLfhUserBlocks> &OldBlocks = InOld.GetLfhUserBlocks();
+	const std::vector<FHeapSnapshot::FLfhUserBlocks> &NewBlocks = InNew.GetLfhUserBlocks();
+	size_t i = 0, j = 0;
+	while (i < OldBlocks.size() || j < NewBlocks.size())
+	{
+		if (j == NewBlocks.size() || (i < OldBlocks.size() && OldBlocks[i].Address < NewBlocks[j].Address))
+		{
+			LfhFreedUserBlocks++;
+			LfhFreedBlocks += OldBlocks[i++].BusyBlocks;
+		}
+		else if (i == OldBlocks.size() || NewBlocks[j].Address < OldBlocks[i].Address)
+		{
+			LfhNewUserBlocks++;
+			LfhNewBlocks += NewBlocks[j++].BusyBlocks;
+		}
+		else
+		{
+			const FHeapSnapshot::FLfhUserBlocks &OldBlock = OldBlocks[i++];
+			const FHeapSnapshot::FLfhUserBlocks &NewBlock = NewBlocks[j++];
+			if (OldBlock.Size != NewBlock.Size || InOld.GetHeapAddress(OldBlock.HeapIndex) != InNew.GetHeapAddress(NewBlock.HeapIndex))
+			{
+				LfhFreedUserBlocks++;
+				LfhFreedBlocks += OldBlock.BusyBlocks;
+				LfhNewUserBlocks++;
+				LfhNewBlocks += NewBlock.BusyBlocks;
+			}
+			else if (NewBlock.BusyBlocks > OldBlock.BusyBlocks)
+			{
+				LfhNewBlocks += NewBlock.BusyBlocks - OldBlock.BusyBlocks;
+			}
+			else
+			{
+				LfhFreedBlocks += OldBlock.BusyBlocks - NewBlock.BusyBlocks;
+			}
+		}
+	} // end while
+}
@@ -0,0 +1,102 @@
+// \brief
+//		heap snapshot & diff, for leak hunting.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include "WinHeapWalker.h"
+
+
+// busy blocks of all heaps, sorted by address. the user blocks of LFH subsegments are kept apart
+// with the number of LFH blocks busy in them.
+class FHeapSnapshot
+{
+public:
+	// 16 bytes per block
+	struct FBlock
+	{
+		uint64_t	Address;
+		uint32_t	Size;
+		uint16_t	HeapIndex;
+		uint16_t	BackTraceIndex;
+	};
+
+	struct FLfhUserBlocks
+	{
+		uint64_t	Address;
+		uint32_t	Size;
+		uint32_t	HeapIndex;
+		uint32_t	BusyBlocks;
+	};
+
+	FHeapSnapshot() : TotalBytes(0), LfhBusyBlocks(0), bHasBackTraces(false) {}
+
+	// walk all heaps and record their busy blocks.
+	bool Capture(FNtHeapWalker &InWalker, const std::vector<uint64_t> &InHeaps);
+
+	const std::vector<FBlock>& GetBlocks() const { return Blocks; }
+	const std::vector<FLfhUserBlocks>& GetLfhUserBlocks() const { return LfhUserBlocks; }
+	// HeapIndex -> heap address
+	uint64_t GetHeapAddress(uint32_t InHeapIndex) const { return Heaps[InHeapIndex]; }
+	uint64_t GetTotalBytes() const { return TotalBytes; }
+	uint64_t GetLfhBusyBlocks() const { return LfhBusyBlocks; }
+	bool HasBackTraces() const { return bHasBackTraces; }
+
+protected:
+	std::vector<FBlock>				Blocks;
+	std::vector<FLfhUserBlocks>		LfhUserBlocks;	// sorted by address
+	std::vector<uint64_t>			Heaps;
+	uint64_t						TotalBytes;
+	uint64_t						LfhBusyBlocks;
+	bool							bHasBackTraces;
+};
+
+// result of comparing two snapshots
+class FHeapSnapshotDiff
+{
+public:
+	struct FGroup
+	{
+		uint32_t	Key;		// size class or backtrace index
+		int64_t		NewBlocks;
+		int64_t		NewBytes;
+		int64_t		FreedBlocks;
+		int64_t		FreedBytes;
+	};
+
+	FHeapSnapshotDiff()
+		: TotalNewBlocks(0), TotalNewBytes(0), TotalFreedBlocks(0), TotalFreedBytes(0)
+		, LfhNewUserBlocks(0), LfhFreedUserBlocks(0), LfhNewBlocks(0), LfhFreedBlocks(0)
+	{}
+
+	// linear merge of the two sorted block arrays, blocks match by address and heap address
+	void Compare(const FHeapSnapshot &InOld, const FHeapSnapshot &InNew);
+
+	// groups sorted by (NewBytes - FreedBytes) descending
+	const std::vector<FGroup>& GetSizeClassGroups() const { return SizeClassGroups; }
+	const std::vector<FGroup>& GetBackTraceGroups() const { return BackTraceGroups; }
+
+	int64_t TotalNewBlocks;
+	int64_t TotalNewBytes;
+	int64_t TotalFreedBlocks;
+	int64_t TotalFreedBytes;
+
+	// LFH subsegment user blocks that came and went, and the LFH blocks that got busy or free in them
+	int64_t LfhNewUserBlocks;
+	int64_t LfhFreedUserBlocks;
+	int64_t LfhNewBlocks;
+	int64_t LfhFreedBlocks;
+
+protected:
+	void AddBlock(const FHeapSnapshot::FBlock &InBlock, bool bIsNew);
+	void CompareLfh(const FHeapSnapshot &InOld, const FHeapSnapshot &InNew);
+	static void SortGroups(std::vector<FGroup> &InOutGroups);
+
+	std::vector<FGroup>		SizeClassGroups;
+	std::vector<FGroup>		BackTraceGroups;
+	std::vector<uint32_t>	BackTraceSlots; // backtrace index -> group index + 1
+};
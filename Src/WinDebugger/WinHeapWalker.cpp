@@ -0,0 +1,509 @@
+// \brief
+//		NT heap walker.
+//
+// ref: the _HEAP, _HEAP_SEGMENT, _HEAP_ENTRY layouts of ntdll (dt ntdll!_HEAP).
+//
+
+#include "WinHeapWalker.h"
+
+#include <cstring>
+#include <algorithm>
+
+
+static const uint32_t kHeapSignature = 0xEEFFEEFF;
+static const uint32_t kSegmentSignature = 0xFFEEFFEE;
+static const uint32_t kUserDataSignature = 0xF0E0D0C0;
+static const uint32_t kMaxListEntries = 1 << 20; // guard against broken lists
+static const size_t kChunkBytes = 1 << 20;
+
+// newest first: Windows 8 and later, then Windows 7 with HEAP.PointerKey before Interceptor
+static const FNtHeapLayout sLayouts32[] =
+{
+	{
+		4, 8, 0,
+		0x08, 0x10, 0x24, 0x28, 0x38,
+		0x4C, 0x50, 0x60, 0x9C, 0xA4,
+		0x08, 0x10, 0x14,
+		0x10, 0x18,
+		0x0C, 0x14,
+		0x18, 0x88, 0x90
+	},
+	{
+		4, 8, 0,
+		0x08, 0x10, 0x24, 0x28, 0x38,
+		0x4C, 0x50, 0x64, 0xA0, 0xA8,
+		0x08, 0x10, 0x14,
+		0x10, 0x18,
+		0x0C, 0,
+		0x18, 0x88, 0x90
+	}
+};
+static const FNtHeapLayout sLayouts64[] =
+{
+	{
+		8, 16, 8,
+		0x10, 0x18, 0x40, 0x48, 0x60,
+		0x7C, 0x80, 0x98, 0x110, 0x120,
+		0x10, 0x20, 0x28,
+		0x20, 0x30,
+		0x14, 0x20,
+		0x30, 0xE8, 0xF0
+	},
+	{
+		8, 16, 8,
+		0x10, 0x18, 0x40, 0x48, 0x60,
+		0x7C, 0x80, 0xA0, 0x118, 0x128,
+		0x10, 0x20, 0x28,
+		0x20, 0x30,
+		0x18, 0,
+		0x30, 0xE8, 0xF0
+	}
+};
+
+const FNtHeapLayout& FNtHeapLayout::GetLayout(bool bIs64Bit)
+{
+	return bIs64Bit ? sLayouts64[0] : sLayouts32[0];
+}
+
+const FNtHeapLayout* FNtHeapLayout::FindHeapLayout(FRemoteMemory &InMemory, uint64_t InHeapAddress, bool bIs64Bit)
+{
+	const FNtHeapLayout *Layouts = bIs64Bit ? sLayouts64 : sLayouts32;
+	const size_t Count = bIs64Bit ? sizeof(sLayouts64) / sizeof(sLayouts64[0]) : sizeof(sLayouts32) / sizeof(sLayouts32[0]);
+	for (size_t k = 0; k < Count; k++)
+	{
+		uint32_t Signature = 0;
+		if (InMemory.ReadMemory(InHeapAddress + Layouts[k].HeapSignature, &Signature, sizeof(Signature)) && Signature == kHeapSignature)
+		{
+			return &Layouts[k];
+		}
+	} // end for k
+	return NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////
+void FHeapStatistics::Reset(uint64_t InHeapAddress)
+{
+	memset(this, 0, sizeof(*this));
+	HeapAddress = InHeapAddress;
+}
+
+uint32_t FHeapStatistics::GetSizeClass(uint64_t InBytes)
+{
+	uint32_t Class = 0;
+	while (InBytes > 1 && Class < kHeapSizeClasses - 1)
+	{
+		InBytes >>= 1;
+		Class++;
+	}
+	return Class;
+}
+
+uint64_t FHeapStatistics::GetSizeClassBase(uint32_t InClass)
+{
+	return (uint64_t)1 << InClass;
+}
+
+//////////////////////////////////////////////////////////////////////////
+FNtHeapWalker::FNtHeapWalker(FRemoteMemory &InMemory, const FNtHeapLayout &InLayout)
+	: Memory(InMemory)
+	, Layout(InLayout)
+	, bEncoded(false)
+{
+	memset(Encoding, 0, sizeof(Encoding));
+}
+
+bool FNtHeapWalker::GetProcessHeaps(uint64_t InPebAddress, std::vector<uint64_t> &OutHeaps)
+{
+	OutHeaps.clear();
+
+	uint32_t NumberOfHeaps = 0;
+	uint64_t HeapsArray = 0, DefaultHeap = 0;
+	if (!Memory.ReadMemory(InPebAddress + Layout.PebNumberOfHeaps, &NumberOfHeaps, sizeof(NumberOfHeaps))
+		|| !Memory.ReadPointer(InPebAddress + Layout.PebProcessHeaps, Layout.PointerSize, HeapsArray)
+		|| !Memory.ReadPointer(InPebAddress + Layout.PebProcessHeap, Layout.PointerSize, DefaultHeap))
+	{
+		return false;
+	}
+
+	if (NumberOfHeaps > 0x10000)
+	{
+		return false;
+	}
+
+	// one read for the whole array
+	std::vector<uint8_t> Array(NumberOfHeaps * Layout.PointerSize);
+	if (NumberOfHeaps && !Memory.ReadMemory(HeapsArray, &Array[0], Array.size()))
+	{
+		return false;
+	}
+
+	OutHeaps.push_back(DefaultHeap);
+	for (uint32_t k = 0; k < NumberOfHeaps; k++)
+	{
+		uint64_t HeapAddr = 0;
+		memcpy(&HeapAddr, &Array[k * Layout.PointerSize], Layout.PointerSize);
+		if (HeapAddr && HeapAddr != DefaultHeap)
+		{
+			OutHeaps.push_back(HeapAddr);
+		}
+	} // end for k
+
+	return true;
+}
+
+bool FNtHeapWalker::ReadEncoding(uint64_t InHeapAddress, FHeapStatistics &OutStats)
+{
+	const FNtHeapLayout *pHeapLayout = FNtHeapLayout::FindHeapLayout(Memory, InHeapAddress, Layout.PointerSize == 8);
+	if (!pHeapLayout)
+	{
+		return false;
+	}
+	Layout = *pHeapLayout;
+
+	uint32_t EncodeFlagMask = 0;
+	if (!Memory.ReadMemory(InHeapAddress + Layout.HeapEncodeFlagMask, &EncodeFlagMask, sizeof(EncodeFlagMask))
+		|| !Memory.ReadMemory(InHeapAddress + Layout.HeapEncoding, Encoding, Layout.Granularity))
+	{
+		return false;
+	}
+
+	bEncoded = EncodeFlagMask != 0;
+	OutStats.bEncoded = bEncoded;
+	return true;
+}
+
+bool FNtHeapWalker::DecodeEntry(const uint8_t *InHeader, uint16_t &OutSize, uint8_t &OutFlags) const
+{
+	// Size(2) Flags(1) SmallTagIndex(1) PreviousSize(2) SegmentOffset(1) UnusedBytes(1)
+	uint8_t Header[8];
+	memcpy(Header, InHeader, sizeof(Header));
+
+	if (bEncoded)
+	{
+		const uint8_t *Key = Encoding + Layout.EntryHeaderOffset;
+		for (uint32_t k = 0; k < sizeof(Header); k++)
+		{
+			Header[k] ^= Key[k];
+		}
+
+		// SmallTagIndex is the checksum of an encoded entry
+		if ((uint8_t)(Header[0] ^ Header[1] ^ Header[2]) != Header[3])
+		{
+			return false;
+		}
+	}
+
+	OutSize = (uint16_t)(Header[0] | (Header[1] << 8));
+	OutFlags = Header[2];
+	return OutSize != 0;
+}
+
+bool FNtHeapWalker::GetSegmentRanges(uint64_t InSegmentAddress, std::vector<FRange> &OutRanges)
+{
+	OutRanges.clear();
+
+	uint32_t Signature = 0;
+	uint64_t FirstEntry = 0, LastValidEntry = 0;
+	if (!Memory.ReadMemory(InSegmentAddress + Layout.SegmentSignature, &Signature, sizeof(Signature)) || Signature != kSegmentSignature
+		|| !Memory.ReadPointer(InSegmentAddress + Layout.SegmentFirstEntry, Layout.PointerSize, FirstEntry)
+		|| !Memory.ReadPointer(InSegmentAddress + Layout.SegmentLastValidEntry, Layout.PointerSize, LastValidEntry)
+		|| FirstEntry >= LastValidEntry)
+	{
+		return false;
+	}
+
+	// uncommitted ranges of the segment
+	std::vector<FRange> Holes;
+	const uint64_t ListHead = InSegmentAddress + Layout.SegmentUCRList;
+	uint64_t Link = 0;
+	Memory.ReadPointer(ListHead, Layout.PointerSize, Link);
+	for (uint32_t Guard = 0; Link && Link != ListHead && Guard < kMaxListEntries; Guard++)
+	{
+		const uint64_t Descriptor = Link - Layout.UCRSegmentEntry;
+		uint64_t Address = 0, Size = 0;
+		if (!Memory.ReadPointer(Descriptor + Layout.UCRAddress, Layout.PointerSize, Address)
+			|| !Memory.ReadPointer(Descriptor + Layout.UCRSize, Layout.PointerSize, Size)
+			|| !Memory.ReadPointer(Link, Layout.PointerSize, Link))
+		{
+			break;
+		}
+
+		FRange Hole = { Address, Address + Size };
+		Holes.push_back(Hole);
+	} // end for
+
+	std::sort(Holes.begin(), Holes.end(), &FNtHeapWalker::RangeLess);
+
+	// committed = [FirstEntry, LastValidEntry) - holes
+	uint64_t Cursor = FirstEntry;
+	for (size_t k = 0; k < Holes.size(); k++)
+	{
+		if (Holes[k].Begin > Cursor)
+		{
+			FRange Committed = { Cursor, Holes[k].Begin < LastValidEntry ? Holes[k].Begin : LastValidEntry };
+			OutRanges.push_back(Committed);
+		}
+		if (Holes[k].End > Cursor)
+		{
+			Cursor = Holes[k].End;
+		}
+	} // end for k
+
+	if (Cursor < LastValidEntry)
+	{
+		FRange Committed = { Cursor, LastValidEntry };
+		OutRanges.push_back(Committed);
+	}
+
+	return true;
+}
+
+void FNtHeapWalker::AddBlock(const FHeapBlock &InBlock, FHeapStatistics &OutStats, FHeapBlockVisitor *InVisitor)
+{
+	if (InBlock.Flags & kHeapEntry_VirtualAlloc)
+	{
+		OutStats.VirtualBlocks++;
+		OutStats.VirtualBytes += InBlock.Size;
+	}
+	else if (InBlock.Flags & kHeapEntry_Busy)
+	{
+		OutStats.BusyBlocks++;
+		OutStats.BusyBytes += InBlock.Size;
+	}
+	else
+	{
+		OutStats.FreeBlocks++;
+		OutStats.FreeBytes += InBlock.Size;
+		if (InBlock.Size > OutStats.LargestFreeBlock)
+		{
+			OutStats.LargestFreeBlock = InBlock.Size;
+		}
+	}
+
+	if (InBlock.Flags & kHeapEntry_Busy)
+	{
+		const uint32_t Class = FHeapStatistics::GetSizeClass(InBlock.Size);
+		OutStats.SizeClassBlocks[Class]++;
+		OutStats.SizeClassBytes[Class] += InBlock.Size;
+	}
+
+	if (InVisitor)
+	{
+		InVisitor->VisitBlock(InBlock);
+	}
+}
+
+void FNtHeapWalker::WalkRange(const FRange &InRange, uint32_t InSegment, FHeapStatistics &OutStats, FHeapBlockVisitor *InVisitor)
+{
+	const uint32_t Granularity = Layout.Granularity;
+	uint64_t ChunkBase = 0;
+	size_t ChunkSize = 0;
+
+	for (uint64_t Cursor = InRange.Begin; Cursor + Granularity <= InRange.End; )
+	{
+		// refill when the header is not in the buffer. big blocks are skipped without reading their data.
+		if (Cursor < ChunkBase || Cursor + Granularity > ChunkBase + ChunkSize)
+		{
+			ChunkBase = Cursor;
+			ChunkSize = (size_t)((InRange.End - Cursor) < kChunkBytes ? (InRange.End - Cursor) : kChunkBytes);
+			if (!Memory.ReadMemory(ChunkBase, &ChunkBuffer[0], ChunkSize))
+			{
+				// the chunk may end in a unreadable page, try the header only.
+				ChunkSize = Granularity;
+				if (!Memory.ReadMemory(ChunkBase, &ChunkBuffer[0], ChunkSize))
+				{
+					OutStats.CorruptEntries++;
+					return;
+				}
+			}
+		}
+
+		uint16_t Size = 0;
+		uint8_t Flags = 0;
+		if (!DecodeEntry(&ChunkBuffer[(size_t)(Cursor - ChunkBase) + Layout.EntryHeaderOffset], Size, Flags))
+		{
+			OutStats.CorruptEntries++;
+			return;
+		}
+
+		FHeapBlock Block;
+		Block.Address = Cursor;
+		Block.Size = (uint64_t)Size * Granularity;
+		Block.Flags = Flags & ~kHeapEntry_VirtualAlloc;
+		Block.Segment = InSegment;
+		Block.BackTraceIndex = 0;
+		Block.LfhBusyBlocks = 0;
+		if (InVisitor && (Flags & kHeapEntry_Busy) && (Flags & kHeapEntry_ExtraPresent) && Block.Size >= 2 * Granularity)
+		{
+			// HEAP_ENTRY_EXTRA is the last granule of the block
+			Block.BackTraceIndex = ReadBackTraceIndex(Cursor + Block.Size - Granularity, ChunkBase, ChunkSize);
+		}
+		if (InVisitor && (Flags & kHeapEntry_Busy))
+		{
+			ReadLfhUserBlocks(Block, ChunkBase, ChunkSize);
+		}
+		AddBlock(Block, OutStats, InVisitor);
+
+		if (Flags & kHeapEntry_LastEntry)
+		{
+			// followed by uncommitted memory
+			return;
+		}
+		Cursor += Block.Size;
+	} // end for
+}
+
+void FNtHeapWalker::WalkVirtualBlocks(uint64_t InHeapAddress, FHeapStatistics &OutStats, FHeapBlockVisitor *InVisitor)
+{
+	const uint64_t ListHead = InHeapAddress + Layout.HeapVirtualAllocdBlocks;
+	uint64_t Link = 0;
+	Memory.ReadPointer(ListHead, Layout.PointerSize, Link);
+
+	for (uint32_t Guard = 0; Link && Link != ListHead && Guard < kMaxListEntries; Guard++)
+	{
+		uint64_t CommitSize = 0;
+		if (!Memory.ReadPointer(Link + Layout.VirtualCommitSize, Layout.PointerSize, CommitSize))
+		{
+			OutStats.CorruptEntries++;
+			break;
+		}
+
+		FHeapBlock Block;
+		Block.Address = Link + Layout.VirtualBusyBlock;
+		Block.Size = CommitSize;
+		Block.Flags = kHeapEntry_Busy | kHeapEntry_VirtualAlloc;
+		Block.Segment = (uint32_t)-1;
+		// HEAP_VIRTUAL_ALLOC_ENTRY::ExtraStuff follows the list entry
+		Block.BackTraceIndex = InVisitor ? ReadBackTraceIndex(Link + 2 * Layout.PointerSize, 0, 0) : 0;
+		Block.LfhBusyBlocks = 0;
+		AddBlock(Block, OutStats, InVisitor);
+
+		if (!Memory.ReadPointer(Link, Layout.PointerSize, Link))
+		{
+			break;
+		}
+	} // end for
+}
+
+uint32_t FNtHeapWalker::ReadBackTraceIndex(uint64_t InExtraAddress, uint64_t InChunkBase, size_t InChunkSize)
+{
+	// HEAP_ENTRY_EXTRA: AllocatorBackTraceIndex(2) TagIndex(2) Settable(pointer)
+	uint16_t Index = 0;
+	if (!ReadBytes(InExtraAddress, &Index, sizeof(Index), InChunkBase, InChunkSize))
+	{
+		Index = 0;
+	}
+
+	return Index;
+}
+
+// the LFH blocks in user blocks have headers encoded with a key private to ntdll, they are not walked.
+// the busy bitmap of the user data header still counts them.
+void FNtHeapWalker::ReadLfhUserBlocks(FHeapBlock &InOutBlock, uint64_t InChunkBase, size_t InChunkSize)
+{
+	const uint64_t UserData = InOutBlock.Address + Layout.Granularity;
+	const uint32_t HeaderBytes = Layout.UserDataBusyBitmap ? Layout.UserDataBusyBitmap + 2 * Layout.PointerSize : Layout.UserDataSignature + 4;
+	uint8_t Header[64];
+	uint32_t Signature = 0;
+	if (InOutBlock.Size < Layout.Granularity + HeaderBytes || !ReadBytes(UserData, Header, HeaderBytes, InChunkBase, InChunkSize))
+	{
+		return;
+	}
+	memcpy(&Signature, Header + Layout.UserDataSignature, sizeof(Signature));
+	if (Signature != kUserDataSignature)
+	{
+		return;
+	}
+
+	InOutBlock.Flags |= kHeapEntry_LfhUserBlocks;
+	if (!Layout.UserDataBusyBitmap)
+	{
+		return;
+	}
+
+	// RTL_BITMAP(_EX): SizeOfBitMap(pointer) Buffer(pointer), one bit per block of at least a granule
+	uint64_t BitCount = 0, Buffer = 0;
+	memcpy(&BitCount, Header + Layout.UserDataBusyBitmap, Layout.PointerSize);
+	memcpy(&Buffer, Header + Layout.UserDataBusyBitmap + Layout.PointerSize, Layout.PointerSize);
+	if (BitCount == 0 || BitCount > InOutBlock.Size / Layout.Granularity)
+	{
+		return;
+	}
+
+	uint8_t Bits[256];
+	uint32_t BusyBlocks = 0;
+	const uint64_t BitmapBytes = (BitCount + 7) / 8;
+	for (uint64_t Offset = 0; Offset < BitmapBytes; Offset += sizeof(Bits))
+	{
+		const size_t Bytes = (size_t)((BitmapBytes - Offset) < sizeof(Bits) ? (BitmapBytes - Offset) : sizeof(Bits));
+		if (!ReadBytes(Buffer + Offset, Bits, Bytes, InChunkBase, InChunkSize))
+		{
+			return;
+		}
+		if (Offset + Bytes == BitmapBytes && (BitCount & 7))
+		{
+			Bits[Bytes - 1] &= (uint8_t)((1 << (BitCount & 7)) - 1);
+		}
+		for (size_t k = 0; k < Bytes; k++)
+		{
+			for (uint8_t Byte = Bits[k]; Byte; Byte &= Byte - 1)
+			{
+				BusyBlocks++;
+			}
+		} // end for k
+	} // end for Offset
+
+	InOutBlock.LfhBusyBlocks = BusyBlocks;
+}
+
+bool FNtHeapWalker::ReadBytes(uint64_t InAddress, void *OutBuffer, size_t InBytes, uint64_t InChunkBase, size_t InChunkSize)
+{
+	if (InAddress >= InChunkBase && InAddress + InBytes <= InChunkBase + InChunkSize)
+	{
+		memcpy(OutBuffer, &ChunkBuffer[(size_t)(InAddress - InChunkBase)], InBytes);
+		return true;
+	}
+	return Memory.ReadMemory(InAddress, OutBuffer, InBytes);
+}
+
+bool FNtHeapWalker::WalkHeap(uint64_t InHeapAddress, FHeapStatistics &OutStats, FHeapBlockVisitor *InVisitor)
+{
+	OutStats.Reset(InHeapAddress);
+	if (!ReadEncoding(InHeapAddress, OutStats))
+	{
+		return false;
+	}
+
+	ChunkBuffer.resize(kChunkBytes);
+
+	// segments are linked by HEAP_SEGMENT::SegmentListEntry, the heap itself is the first one.
+	const uint64_t ListHead = InHeapAddress + Layout.HeapSegmentList;
+	uint64_t Link = 0;
+	Memory.ReadPointer(ListHead, Layout.PointerSize, Link);
+
+	std::vector<FRange> Ranges;
+	for (uint32_t Guard = 0; Link && Link != ListHead && Guard < kMaxListEntries; Guard++)
+	{
+		const uint64_t Segment = Link - Layout.SegmentListEntry;
+		if (GetSegmentRanges(Segment, Ranges))
+		{
+			for (size_t k = 0; k < Ranges.size(); k++)
+			{
+				WalkRange(Ranges[k], OutStats.SegmentCount, OutStats, InVisitor);
+			} // end for k
+			OutStats.SegmentCount++;
+		}
+		else
+		{
+			OutStats.CorruptEntries++;
+		}
+
+		if (!Memory.ReadPointer(Link, Layout.PointerSize, Link))
+		{
+			break;
+		}
+	} // end for
+
+	WalkVirtualBlocks(InHeapAddress, OutStats, InVisitor);
+	return true;
+}
@@ -0,0 +1,158 @@
+// \brief
+//		NT heap walker: read segment and entry headers of the debuggee heaps directly.
+//		supports the NT heap layouts of Windows 7 and of Windows 8 and later (x86 and x64), told apart
+//		by where the HEAP signature is, encoded entry headers included.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include "WinRemoteMemory.h"
+
+
+// field offsets of the heap structures, they are different between x86 and x64, and the HEAP
+// fields after PointerKey moved one pointer down when Windows 8 removed it.
+struct FNtHeapLayout
+{
+	uint32_t	PointerSize;
+	uint32_t	Granularity;			// sizeof(HEAP_ENTRY)
+	uint32_t	EntryHeaderOffset;		// offset of Size/Flags/SmallTagIndex in HEAP_ENTRY
+
+	// HEAP_SEGMENT
+	uint32_t	SegmentSignature;
+	uint32_t	SegmentListEntry;
+	uint32_t	SegmentFirstEntry;
+	uint32_t	SegmentLastValidEntry;
+	uint32_t	SegmentUCRList;
+
+	// HEAP
+	uint32_t	HeapEncodeFlagMask;
+	uint32_t	HeapEncoding;
+	uint32_t	HeapSignature;
+	uint32_t	HeapVirtualAllocdBlocks;
+	uint32_t	HeapSegmentList;
+
+	// HEAP_UCR_DESCRIPTOR
+	uint32_t	UCRSegmentEntry;
+	uint32_t	UCRAddress;
+	uint32_t	UCRSize;
+
+	// HEAP_VIRTUAL_ALLOC_ENTRY
+	uint32_t	VirtualCommitSize;
+	uint32_t	VirtualBusyBlock;
+
+	// HEAP_USERDATA_HEADER, at the start of the user blocks of an LFH subsegment
+	uint32_t	UserDataSignature;
+	uint32_t	UserDataBusyBitmap;		// 0 before Windows 8, which has no busy bitmap
+
+	// PEB
+	uint32_t	PebProcessHeap;
+	uint32_t	PebNumberOfHeaps;
+	uint32_t	PebProcessHeaps;
+
+	// the Windows 8+ layout. PEB, segment and entry offsets are the same in all layouts.
+	static const FNtHeapLayout& GetLayout(bool bIs64Bit);
+	// the layout with the HEAP signature at InHeapAddress, NULL if it is not a NT heap
+	static const FNtHeapLayout* FindHeapLayout(FRemoteMemory &InMemory, uint64_t InHeapAddress, bool bIs64Bit);
+};
+
+// heap entry flags
+#define kHeapEntry_Busy			0x01
+#define kHeapEntry_ExtraPresent	0x02
+#define kHeapEntry_FillPattern	0x04
+#define kHeapEntry_VirtualAlloc	0x08
+#define kHeapEntry_LastEntry	0x10
+// set by the walker: the block holds the user blocks of an LFH subsegment
+#define kHeapEntry_LfhUserBlocks	0x100
+
+// one decoded heap block
+struct FHeapBlock
+{
+	uint64_t	Address;	// address of the entry header
+	uint64_t	Size;		// bytes, header included
+	uint32_t	Flags;		// kHeapEntry_xxx
+	uint32_t	Segment;	// segment index, -1 for virtual blocks
+	uint32_t	BackTraceIndex; // user-mode stack trace database index (gflags +ust), 0 if none
+	uint32_t	LfhBusyBlocks;	// kHeapEntry_LfhUserBlocks: busy LFH blocks in it, 0 without a busy bitmap
+};
+
+class FHeapBlockVisitor
+{
+public:
+	virtual ~FHeapBlockVisitor() {}
+	virtual void VisitBlock(const FHeapBlock &InBlock) = 0;
+};
+
+// size class histogram bucket: [2^k, 2^(k+1)) bytes
+#define kHeapSizeClasses	24
+
+struct FHeapStatistics
+{
+	uint64_t	HeapAddress;
+	uint32_t	SegmentCount;
+	bool		bEncoded;
+	uint32_t	CorruptEntries;
+
+	uint64_t	BusyBlocks;
+	uint64_t	BusyBytes;
+	uint64_t	FreeBlocks;
+	uint64_t	FreeBytes;
+	uint64_t	LargestFreeBlock;
+	uint64_t	VirtualBlocks;
+	uint64_t	VirtualBytes;
+
+	uint64_t	SizeClassBlocks[kHeapSizeClasses]; // busy blocks
+	uint64_t	SizeClassBytes[kHeapSizeClasses];
+
+	void Reset(uint64_t InHeapAddress);
+
+	static uint32_t GetSizeClass(uint64_t InBytes);
+	// lower bound of the size class
+	static uint64_t GetSizeClassBase(uint32_t InClass);
+};
+
+class FNtHeapWalker
+{
+public:
+	FNtHeapWalker(FRemoteMemory &InMemory, const FNtHeapLayout &InLayout);
+
+	// heaps listed in the PEB. the first one is the process default heap.
+	bool GetProcessHeaps(uint64_t InPebAddress, std::vector<uint64_t> &OutHeaps);
+
+	// walk all segments and the virtual blocks of one heap.
+	// OutStats gets the aggregated statistics, InVisitor (optional) gets every block. the LFH hands out
+	// its blocks from user blocks it takes from the backend, the visitor gets those as one block.
+	bool WalkHeap(uint64_t InHeapAddress, FHeapStatistics &OutStats, FHeapBlockVisitor *InVisitor = NULL);
+
+protected:
+	struct FRange
+	{
+		uint64_t Begin;
+		uint64_t End;
+	};
+	static bool RangeLess(const FRange &A, const FRange &B) { return A.Begin < B.Begin; }
+
+	bool ReadEncoding(uint64_t InHeapAddress, FHeapStatistics &OutStats);
+	bool GetSegmentRanges(uint64_t InSegmentAddress, std::vector<FRange> &OutRanges);
+	void WalkRange(const FRange &InRange, uint32_t InSegment, FHeapStatistics &OutStats, FHeapBlockVisitor *InVisitor);
+	void WalkVirtualBlocks(uint64_t InHeapAddress, FHeapStatistics &OutStats, FHeapBlockVisitor *InVisitor);
+	uint32_t ReadBackTraceIndex(uint64_t InExtraAddress, uint64_t InChunkBase, size_t InChunkSize);
+	void ReadLfhUserBlocks(FHeapBlock &InOutBlock, uint64_t InChunkBase, size_t InChunkSize);
+	// from the bulk read buffer when it has the bytes
+	bool ReadBytes(uint64_t InAddress, void *OutBuffer, size_t InBytes, uint64_t InChunkBase, size_t InChunkSize);
+	bool DecodeEntry(const uint8_t *InHeader, uint16_t &OutSize, uint8_t &OutFlags) const;
+	void AddBlock(const FHeapBlock &InBlock, FHeapStatistics &OutStats, FHeapBlockVisitor *InVisitor);
+
+	FRemoteMemory			&Memory;
+	FNtHeapLayout			Layout;		// of the heap being walked
+
+	// heap entry encoding of the heap being walked
+	bool					bEncoded;
+	uint8_t					Encoding[16];
+
+	// bulk read buffer
+	std::vector<uint8_t>	ChunkBuffer;
+};
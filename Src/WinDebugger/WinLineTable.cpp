@@ -0,0 +1,388 @@
+// \brief
+//		per module line number table.
+//
+
+#include "WinLineTable.h"
+#include "WinSymbolCache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cctype>
+
+
+static const uint32_t kInvalidBlock = 0xFFFFFFFF;
+
+static inline void WriteVarUInt(std::vector<uint8_t> &OutData, uint32_t InValue)
+{
+	while (InValue >= 0x80)
+	{
+		OutData.push_back((uint8_t)(InValue | 0x80));
+		InValue >>= 7;
+	} // end while
+	OutData.push_back((uint8_t)InValue);
+}
+
+static inline uint32_t ReadVarUInt(const uint8_t *&InOutPtr)
+{
+	uint32_t Value = 0;
+	for (uint32_t Shift = 0; ; Shift += 7)
+	{
+		const uint8_t Byte = *InOutPtr++;
+		Value |= (uint32_t)(Byte & 0x7F) << Shift;
+		if (!(Byte & 0x80))
+		{
+			break;
+		}
+	} // end for
+	return Value;
+}
+
+static inline uint32_t ZigZagEncode(int32_t InValue)
+{
+	return ((uint32_t)InValue << 1) ^ (uint32_t)(InValue >> 31);
+}
+
+static inline int32_t ZigZagDecode(uint32_t InValue)
+{
+	return (int32_t)(InValue >> 1) ^ -(int32_t)(InValue & 1);
+}
+
+FModuleLineTable::FModuleLineTable()
+	: RowCount(0)
+{
+	for (uint32_t k = 0; k < kCacheEntries; k++)
+	{
+		Cache[k].BlockIndex = kInvalidBlock;
+	} // end for k
+}
+
+bool FModuleLineTable::RowRvaLess(const FLineRow &A, const FLineRow &B)
+{
+	return A.Rva < B.Rva;
+}
+
+bool FModuleLineTable::LineKeyLess(const FLineKey &A, const FLineKey &B)
+{
+	if (A.FileId != B.FileId)
+	{
+		return A.FileId < B.FileId;
+	}
+	if (A.Line != B.Line)
+	{
+		return A.Line < B.Line;
+	}
+	return A.Rva < B.Rva;
+}
+
+void FModuleLineTable::Clear()
+{
+	Blocks.clear();
+	Data.clear();
+	FileNames.clear();
+	RowCount = 0;
+
+	std::lock_guard<std::mutex> Guard(CacheLock);
+	for (uint32_t k = 0; k < kCacheEntries; k++)
+	{
+		Cache[k].BlockIndex = kInvalidBlock;
+		Cache[k].Rows.clear();
+	} // end for k
+}
+
+// each row after a block's first: varint(rva delta), varint(zigzag(line delta) << 1 | file changed), [varint(file id)]
+void FModuleLineTable::Build(std::vector<FLineRow> &InOutRows, const std::vector<std::string> &InFileNames)
+{
+	Clear();
+	FileNames = InFileNames;
+
+	// an end marker and a line at the same address: keep the line.
+	std::stable_sort(InOutRows.begin(), InOutRows.end(), &RowRvaLess);
+
+	std::vector<FLineRow> Rows;
+	Rows.reserve(InOutRows.size());
+	for (size_t k = 0; k < InOutRows.size(); k++)
+	{
+		FLineRow Row = InOutRows[k];
+		// 0xFEEFEE / 0xF00F00: hidden code
+		if (Row.Line >= 0xF00000)
+		{
+			Row.Line = 0;
+		}
+
+		if (!Rows.empty() && Rows.back().Rva == Row.Rva)
+		{
+			if (Row.Line)
+			{
+				Rows.back() = Row;
+			}
+			continue;
+		}
+		if (!Rows.empty() && Rows.back().Line == Row.Line && Rows.back().FileId == Row.FileId)
+		{
+			continue;
+		}
+		Rows.push_back(Row);
+	} // end for k
+
+	RowCount = Rows.size();
+	Data.reserve(Rows.size() * 3);
+	for (size_t k = 0; k < Rows.size(); k++)
+	{
+		const FLineRow &Row = Rows[k];
+		if (k % kRowsPerBlock == 0)
+		{
+			FBlock Block;
+			Block.StartRva = Row.Rva;
+			Block.StartLine = Row.Line;
+			Block.StartFileId = Row.FileId;
+			Block.DataOffset = (uint32_t)Data.size();
+			Block.RowCount = 0;
+			Blocks.push_back(Block);
+		}
+		else
+		{
+			const FLineRow &Prev = Rows[k - 1];
+			const bool bFileChanged = Row.FileId != Prev.FileId;
+
+			WriteVarUInt(Data, Row.Rva - Prev.Rva);
+			WriteVarUInt(Data, (ZigZagEncode((int32_t)(Row.Line - Prev.Line)) << 1) | (bFileChanged ? 1 : 0));
+			if (bFileChanged)
+			{
+				WriteVarUInt(Data, Row.FileId);
+			}
+		}
+		Blocks.back().RowCount++;
+	} // end for k
+
+	std::vector<uint8_t>(Data).swap(Data);
+}
+
+void FModuleLineTable::DecodeBlock(uint32_t InBlockIndex, std::vector<FLineRow> &OutRows) const
+{
+	const FBlock &Block = Blocks[InBlockIndex];
+
+	FLineRow Row;
+	Row.Rva = Block.StartRva;
+	Row.Line = Block.StartLine;
+	Row.FileId = Block.StartFileId;
+
+	OutRows.resize(Block.RowCount);
+	OutRows[0] = Row;
+
+	const uint8_t *Ptr = Data.empty() ? NULL : &Data[0] + Block.DataOffset;
+	for (uint32_t k = 1; k < Block.RowCount; k++)
+	{
+		Row.Rva += ReadVarUInt(Ptr);
+		const uint32_t LineAndFlag = ReadVarUInt(Ptr);
+		Row.Line += ZigZagDecode(LineAndFlag >> 1);
+		if (LineAndFlag & 1)
+		{
+			Row.FileId = ReadVarUInt(Ptr);
+		}
+		OutRows[k] = Row;
+	} // end for k
+}
+
+bool FModuleLineTable::FindLine(uint32_t InRva, FLineRow &OutRow, uint32_t &OutDisplacement) const
+{
+	if (Blocks.empty() || InRva < Blocks[0].StartRva)
+	{
+		return false;
+	}
+
+	// last block starting at or below InRva
+	uint32_t Low = 0, High = (uint32_t)Blocks.size();
+	while (High - Low > 1)
+	{
+		const uint32_t Middle = (Low + High) / 2;
+		if (Blocks[Middle].StartRva <= InRva)
+		{
+			Low = Middle;
+		}
+		else
+		{
+			High = Middle;
+		}
+	} // end while
+	const uint32_t BlockIndex = Low;
+
+	std::lock_guard<std::mutex> Guard(CacheLock);
+
+	FCacheEntry &Entry = Cache[BlockIndex % kCacheEntries];
+	if (Entry.BlockIndex != BlockIndex)
+	{
+		DecodeBlock(BlockIndex, Entry.Rows);
+		Entry.BlockIndex = BlockIndex;
+	}
+
+	// last row at or below InRva
+	std::vector<FLineRow>::const_iterator Itr = Entry.Rows.begin() + 1;
+	while (Itr != Entry.Rows.end() && Itr->Rva <= InRva)
+	{
+		++Itr;
+	} // end while
+	const FLineRow &Row = *(Itr - 1);
+
+	if (Row.Line == 0)
+	{
+		return false;
+	}
+
+	OutRow = Row;
+	OutDisplacement = InRva - Row.Rva;
+	return true;
+}
+
+void FModuleLineTable::BuildReverseIndex() const
+{
+	ReverseIndex.reserve(RowCount);
+
+	std::vector<FLineRow> Rows;
+	for (uint32_t BlockIndex = 0; BlockIndex < Blocks.size(); BlockIndex++)
+	{
+		DecodeBlock(BlockIndex, Rows);
+
+		// the last row of a block ends where the next block starts
+		const uint32_t NextBlockRva = BlockIndex + 1 < Blocks.size() ? Blocks[BlockIndex + 1].StartRva : Rows.back().Rva;
+		for (size_t k = 0; k < Rows.size(); k++)
+		{
+			if (Rows[k].Line == 0)
+			{
+				continue;
+			}
+
+			const uint32_t EndRva = k + 1 < Rows.size() ? Rows[k + 1].Rva : NextBlockRva;
+
+			FLineKey Key;
+			Key.FileId = Rows[k].FileId;
+			Key.Line = Rows[k].Line;
+			Key.Rva = Rows[k].Rva;
+			Key.Size = EndRva - Rows[k].Rva;
+			ReverseIndex.push_back(Key);
+		} // end for k
+	} // end for BlockIndex
+
+	std::sort(ReverseIndex.begin(), ReverseIndex.end(), &LineKeyLess);
+}
+
+bool FModuleLineTable::FindAddresses(uint32_t InFileId, uint32_t InLine, std::vector<FLineRange> &OutRanges) const
+{
+	std::call_once(ReverseFlag, &FModuleLineTable::BuildReverseIndex, this);
+
+	FLineKey Key = { InFileId, InLine, 0, 0 };
+	std::vector<FLineKey>::const_iterator Itr = std::lower_bound(ReverseIndex.begin(), ReverseIndex.end(), Key, &LineKeyLess);
+	if (Itr == ReverseIndex.end() || Itr->FileId != InFileId)
+	{
+		return false;
+	}
+
+	// a line without code binds to the next line that has some.
+	const uint32_t FoundLine = Itr->Line;
+	for (; Itr != ReverseIndex.end() && Itr->FileId == InFileId && Itr->Line == FoundLine; ++Itr)
+	{
+		FLineRange Range;
+		Range.Rva = Itr->Rva;
+		Range.Size = Itr->Size;
+		Range.Line = FoundLine;
+		OutRanges.push_back(Range);
+	} // end for
+
+	return true;
+}
+
+void FModuleLineTable::FindFiles(const char *InName, std::vector<uint32_t> &OutFileIds) const
+{
+	const size_t NameLength = strlen(InName);
+	for (uint32_t k = 0; k < FileNames.size(); k++)
+	{
+		const std::string &FileName = FileNames[k];
+		if (FileName.size() < NameLength)
+		{
+			continue;
+		}
+
+		const size_t Start = FileName.size() - NameLength;
+		if (Start > 0 && FileName[Start - 1] != '\\' && FileName[Start - 1] != '/')
+		{
+			continue;
+		}
+
+		bool bMatch = true;
+		for (size_t i = 0; i < NameLength && bMatch; i++)
+		{
+			char A = (char)tolower((uint8_t)FileName[Start + i]);
+			char B = (char)tolower((uint8_t)InName[i]);
+			A = A == '/' ? '\\' : A;
+			B = B == '/' ? '\\' : B;
+			bMatch = A == B;
+		} // end for i
+
+		if (bMatch)
+		{
+			OutFileIds.push_back(k);
+		}
+	} // end for k
+}
+
+// file names are stored back to back, each with its terminator.
+void FModuleLineTable::Save(FSymbolCacheWriter &InWriter) const
+{
+	std::vector<char> NamePool;
+	for (size_t k = 0; k < FileNames.size(); k++)
+	{
+		NamePool.insert(NamePool.end(), FileNames[k].c_str(), FileNames[k].c_str() + FileNames[k].size() + 1);
+	} // end for k
+
+	InWriter.WriteValue(RowCount);
+	InWriter.WriteArray(Blocks);
+	InWriter.WriteArray(Data);
+	InWriter.WriteArray(NamePool);
+}
+
+bool FModuleLineTable::Load(FSymbolCacheReader &InReader)
+{
+	Clear();
+
+	uint64_t Rows = 0;
+	const char *NamePool = NULL;
+	uint64_t NameBytes = 0;
+	if (!InReader.ReadValue(Rows) || !InReader.ReadArray(Blocks) || !InReader.ReadArray(Data) || !InReader.ReadArray(NamePool, NameBytes)
+		|| (NameBytes && NamePool[NameBytes - 1] != '\0'))
+	{
+		Clear();
+		return false;
+	}
+
+	for (uint64_t Offset = 0; Offset < NameBytes; )
+	{
+		FileNames.push_back(NamePool + Offset);
+		Offset += FileNames.back().size() + 1;
+	} // end for
+
+	// DecodeBlock trusts the block headers
+	bool bValid = true;
+	for (size_t k = 0; k < Blocks.size() && bValid; k++)
+	{
+		bValid = Blocks[k].RowCount >= 1 && Blocks[k].RowCount <= kRowsPerBlock && Blocks[k].DataOffset <= Data.size()
+			&& Blocks[k].StartFileId < (FileNames.empty() ? 1 : FileNames.size());
+	} // end for k
+
+	if (!bValid)
+	{
+		Clear();
+		return false;
+	}
+
+	RowCount = (size_t)Rows;
+	return true;
+}
+
+size_t FModuleLineTable::GetMemoryUsage() const
+{
+	size_t Bytes = Blocks.capacity() * sizeof(FBlock) + Data.capacity() + ReverseIndex.capacity() * sizeof(FLineKey);
+	for (size_t k = 0; k < FileNames.size(); k++)
+	{
+		Bytes += FileNames[k].capacity();
+	} // end for k
+	return Bytes;
+}
@@ -0,0 +1,106 @@
+// \brief
+//		per module line number table.
+//		rows are delta encoded in blocks of kRowsPerBlock, a lookup decodes one block into a small
+//		cache. the reverse file:line -> address index is built on its first use.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <mutex>
+
+class FSymbolCacheWriter;
+class FSymbolCacheReader;
+
+
+class FModuleLineTable
+{
+public:
+	// one decoded row, it covers [Rva, next row's Rva)
+	struct FLineRow
+	{
+		uint32_t	Rva;
+		uint32_t	Line;		// 0: no line
+		uint32_t	FileId;
+	};
+
+	// code generated for one line
+	struct FLineRange
+	{
+		uint32_t	Rva;
+		uint32_t	Size;
+		uint32_t	Line;
+	};
+
+	FModuleLineTable();
+
+	// rows in any order, Line 0 ends the previous row's range.
+	void Build(std::vector<FLineRow> &InOutRows, const std::vector<std::string> &InFileNames);
+	void Clear();
+	bool IsEmpty() const { return Blocks.empty(); }
+
+	// RVA -> line
+	bool FindLine(uint32_t InRva, FLineRow &OutRow, uint32_t &OutDisplacement) const;
+	const std::string& GetFileName(uint32_t InFileId) const { return FileNames[InFileId]; }
+
+	// file ids whose path ends with InName as a whole path component, case insensitive.
+	void FindFiles(const char *InName, std::vector<uint32_t> &OutFileIds) const;
+	// ranges of the first line >= InLine with code in that file.
+	bool FindAddresses(uint32_t InFileId, uint32_t InLine, std::vector<FLineRange> &OutRanges) const;
+
+	size_t GetRowCount() const { return RowCount; }
+	size_t GetMemoryUsage() const;
+
+	// symbol cache, Load() replaces Build() on a new table.
+	void Save(FSymbolCacheWriter &InWriter) const;
+	bool Load(FSymbolCacheReader &InReader);
+
+	static const uint32_t kRowsPerBlock = 64;
+
+protected:
+	struct FBlock
+	{
+		uint32_t	StartRva;
+		uint32_t	StartLine;
+		uint32_t	StartFileId;
+		uint32_t	DataOffset;	// encoded rows after the first one
+		uint32_t	RowCount;
+	};
+
+	struct FCacheEntry
+	{
+		uint32_t				BlockIndex;
+		std::vector<FLineRow>	Rows;
+	};
+
+	// reverse index entry
+	struct FLineKey
+	{
+		uint32_t	FileId;
+		uint32_t	Line;
+		uint32_t	Rva;
+		uint32_t	Size;
+	};
+
+	static bool RowRvaLess(const FLineRow &A, const FLineRow &B);
+	static bool LineKeyLess(const FLineKey &A, const FLineKey &B);
+
+	void DecodeBlock(uint32_t InBlockIndex, std::vector<FLineRow> &OutRows) const;
+	void BuildReverseIndex() const;
+
+	std::vector<FBlock>			Blocks;
+	std::vector<uint8_t>		Data;
+	std::vector<std::string>	FileNames;
+	size_t						RowCount;
+
+	// decoded blocks, direct mapped
+	static const uint32_t kCacheEntries = 16;
+	mutable std::mutex			CacheLock;
+	mutable FCacheEntry			Cache[kCacheEntries];
+
+	mutable std::once_flag			ReverseFlag;
+	mutable std::vector<FLineKey>	ReverseIndex;
+};
@@ -0,0 +1,133 @@
+// \brief
+//		table driven memory dump formatter.
+//
+
+#include "WinMemoryDumpHelper.h"
+
+#include <cstring>
+
+
+// precomputed lookup tables: byte -> two hex digits, byte -> printable char
+struct FDumpTables
+{
+	char HexPairs[256][2];
+	char Printable[256];
+
+	FDumpTables()
+	{
+		static const char kDigits[] = "0123456789ABCDEF";
+		for (uint32_t k = 0; k < 256; k++)
+		{
+			HexPairs[k][0] = kDigits[k >> 4];
+			HexPairs[k][1] = kDigits[k & 0x0F];
+			Printable[k] = (k >= 0x20 && k < 0x7F) ? (char)k : '.';
+		} // end for k
+	}
+};
+
+static const FDumpTables& GetDumpTables()
+{
+	static const FDumpTables sTables;
+	return sTables;
+}
+
+FMemoryDumpFormatter::FMemoryDumpFormatter(uint32_t InUnitWidth, bool InbShowAscii, uint32_t InAddressDigits)
+	: UnitWidth(InUnitWidth)
+	, AddressDigits(InAddressDigits)
+	, bShowAscii(InbShowAscii)
+{
+	if (UnitWidth != UNIT_BYTE && UnitWidth != UNIT_WORD && UnitWidth != UNIT_DWORD && UnitWidth != UNIT_QWORD)
+	{
+		UnitWidth = UNIT_BYTE;
+	}
+	if (AddressDigits == 0 || AddressDigits > 16)
+	{
+		AddressDigits = 16;
+	}
+
+	// "addr:" + " hex" * units + ["  " + ascii] + "\n"
+	const size_t Units = kBytesPerLine / UnitWidth;
+	LineChars = AddressDigits + 1 + Units * (1 + UnitWidth * 2) + (bShowAscii ? 2 + kBytesPerLine : 0) + 1;
+}
+
+void FMemoryDumpFormatter::FormatLines(uint64_t InAddress, const uint8_t *InData, const uint8_t *InValidMask, size_t InBytes, std::string &OutText) const
+{
+	const size_t Lines = (InBytes + kBytesPerLine - 1) / kBytesPerLine;
+	const size_t OldSize = OutText.size();
+
+	// size the output once, then write straight into it.
+	OutText.resize(OldSize + Lines * LineChars);
+	char *Dest = &OutText[OldSize];
+	for (size_t Offset = 0; Offset < InBytes; Offset += kBytesPerLine)
+	{
+		const size_t LineBytes = (InBytes - Offset) < kBytesPerLine ? (InBytes - Offset) : kBytesPerLine;
+		Dest = FormatOneLine(Dest, InAddress + Offset, InData + Offset, InValidMask ? InValidMask + Offset : NULL, LineBytes);
+	} // end for
+}
+
+char* FMemoryDumpFormatter::FormatOneLine(char *Dest, uint64_t InAddress, const uint8_t *InData, const uint8_t *InValidMask, size_t InBytes) const
+{
+	const FDumpTables &Tables = GetDumpTables();
+
+	// address
+	for (int32_t Shift = (AddressDigits - 1) * 4; Shift >= 0; Shift -= 4)
+	{
+		*Dest++ = Tables.HexPairs[(InAddress >> Shift) & 0x0F][1];
+	}
+	*Dest++ = ':';
+
+	// units, little endian: the most significant byte goes first.
+	for (size_t Unit = 0; Unit < kBytesPerLine; Unit += UnitWidth)
+	{
+		*Dest++ = ' ';
+		bool bValid = (Unit + UnitWidth) <= InBytes;
+		if (bValid && InValidMask)
+		{
+			for (uint32_t b = 0; b < UnitWidth; b++)
+			{
+				bValid = bValid && InValidMask[Unit + b];
+			}
+		}
+
+		if (bValid)
+		{
+			for (int32_t b = (int32_t)UnitWidth - 1; b >= 0; b--)
+			{
+				const char *Pair = Tables.HexPairs[InData[Unit + b]];
+				*Dest++ = Pair[0];
+				*Dest++ = Pair[1];
+			}
+		}
+		else
+		{
+			const char Fill = Unit < InBytes ? '?' : ' ';
+			memset(Dest, Fill, UnitWidth * 2);
+			Dest += UnitWidth * 2;
+		}
+	} // end for Unit
+
+	// ascii column
+	if (bShowAscii)
+	{
+		*Dest++ = ' ';
+		*Dest++ = ' ';
+		for (size_t k = 0; k < kBytesPerLine; k++)
+		{
+			if (k >= InBytes)
+			{
+				*Dest++ = ' ';
+			}
+			else if (InValidMask && !InValidMask[k])
+			{
+				*Dest++ = '?';
+			}
+			else
+			{
+				*Dest++ = Tables.Printable[InData[k]];
+			}
+		} // end for k
+	}
+
+	*Dest++ = '\n';
+	return Dest;
+}
@@ -0,0 +1,41 @@
+// \brief
+//		table driven memory dump formatter (db/dw/dd/dq).
+//
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+
+class FMemoryDumpFormatter
+{
+public:
+	enum EUnitWidth
+	{
+		UNIT_BYTE  = 1,  // db
+		UNIT_WORD  = 2,  // dw
+		UNIT_DWORD = 4,  // dd
+		UNIT_QWORD = 8   // dq
+	};
+
+	static const uint32_t kBytesPerLine = 16;
+
+	FMemoryDumpFormatter(uint32_t InUnitWidth, bool InbShowAscii, uint32_t InAddressDigits);
+
+	// characters of one formatted line, including the '\n'
+	size_t LineLength() const { return LineChars; }
+
+	// format InBytes bytes starting at InAddress, append the text to OutText.
+	// InValidMask is optional, a zero byte in the mask means the byte is unreadable.
+	void FormatLines(uint64_t InAddress, const uint8_t *InData, const uint8_t *InValidMask, size_t InBytes, std::string &OutText) const;
+
+protected:
+	char* FormatOneLine(char *Dest, uint64_t InAddress, const uint8_t *InData, const uint8_t *InValidMask, size_t InBytes) const;
+
+	uint32_t	UnitWidth;
+	uint32_t	AddressDigits;
+	bool		bShowAscii;
+	size_t		LineChars;
+};
@@ -0,0 +1,1141 @@
+// \brief
+//		native PDB reader.
+//
+
+#include "WinPdbReader.h"
+
+#include <cstring>
+
+
+static const char	kMsfMagic[] = "Microsoft C/C++ MSF 7.00\r\n\x1a" "DS\0\0";
+static const size_t	kMsfMagicSize = 32;
+
+// fixed stream indices
+static const uint32_t kPdbStream_Info = 1;
+static const uint32_t kPdbStream_Tpi = 2;
+static const uint32_t kPdbStream_Dbi = 3;
+static const uint32_t kPdbStream_Ipi = 4;
+
+static const uint32_t kNilStreamSize = 0xFFFFFFFF;
+
+// C13 debug subsections
+static const uint32_t kDebugS_Lines = 0xF2;
+static const uint32_t kDebugS_FileChecksums = 0xF4;
+static const uint32_t kDebugS_Ignore = 0x80000000;
+
+
+static inline uint16_t ReadU16(const uint8_t *InPtr)
+{
+	uint16_t Value;
+	memcpy(&Value, InPtr, sizeof(Value));
+	return Value;
+}
+
+static inline uint32_t ReadU32(const uint8_t *InPtr)
+{
+	uint32_t Value;
+	memcpy(&Value, InPtr, sizeof(Value));
+	return Value;
+}
+
+//////////////////////////////////////////////////////////////////////////
+FMsfFile::FMsfFile()
+	: FileData(NULL)
+	, FileSize(0)
+	, BlockSize(0)
+{
+}
+
+bool FMsfFile::Open(const uint8_t *InData, uint64_t InSize)
+{
+	FileData = NULL;
+	FileSize = 0;
+	BlockSize = 0;
+	StreamSizes.clear();
+	StreamBlocks.clear();
+	GatheredStreams.clear();
+	GatherFlags.reset();
+
+	if (InSize < 56 || memcmp(InData, kMsfMagic, kMsfMagicSize) != 0)
+	{
+		return false;
+	}
+
+	const uint32_t SuperBlockSize = ReadU32(InData + 32);
+	const uint32_t NumBlocks = ReadU32(InData + 40);
+	const uint32_t NumDirectoryBytes = ReadU32(InData + 44);
+	const uint32_t BlockMapAddr = ReadU32(InData + 52);
+	if (SuperBlockSize != 512 && SuperBlockSize != 1024 && SuperBlockSize != 2048 && SuperBlockSize != 4096)
+	{
+		return false;
+	}
+	if ((uint64_t)NumBlocks * SuperBlockSize > InSize || BlockMapAddr >= NumBlocks)
+	{
+		return false;
+	}
+
+	FileData = InData;
+	FileSize = InSize;
+	BlockSize = SuperBlockSize;
+
+	// gather the directory, its block list lives in the block map block.
+	const uint32_t NumDirectoryBlocks = (NumDirectoryBytes + BlockSize - 1) / BlockSize;
+	if (NumDirectoryBlocks * sizeof(uint32_t) > BlockSize)
+	{
+		return false;
+	}
+
+	std::vector<uint8_t> Directory(NumDirectoryBlocks * BlockSize);
+	const uint8_t *BlockMap = GetBlock(BlockMapAddr);
+	for (uint32_t k = 0; k < NumDirectoryBlocks; k++)
+	{
+		const uint32_t Block = ReadU32(BlockMap + k * sizeof(uint32_t));
+		if (Block >= NumBlocks)
+		{
+			return false;
+		}
+		memcpy(&Directory[k * BlockSize], GetBlock(Block), BlockSize);
+	} // end for k
+
+	if (NumDirectoryBytes < sizeof(uint32_t))
+	{
+		return false;
+	}
+
+	const uint8_t *Ptr = &Directory[0];
+	const uint8_t *End = Ptr + NumDirectoryBytes;
+	const uint32_t NumStreams = ReadU32(Ptr); Ptr += sizeof(uint32_t);
+	if ((uint64_t)NumStreams * sizeof(uint32_t) > (uint64_t)(End - Ptr))
+	{
+		return false;
+	}
+
+	StreamSizes.resize(NumStreams);
+	for (uint32_t k = 0; k < NumStreams; k++)
+	{
+		const uint32_t Size = ReadU32(Ptr); Ptr += sizeof(uint32_t);
+		StreamSizes[k] = Size == kNilStreamSize ? 0 : Size;
+	} // end for k
+
+	StreamBlocks.resize(NumStreams);
+	for (uint32_t k = 0; k < NumStreams; k++)
+	{
+		const uint32_t NumStreamBlocks = (StreamSizes[k] + BlockSize - 1) / BlockSize;
+		if ((uint64_t)NumStreamBlocks * sizeof(uint32_t) > (uint64_t)(End - Ptr))
+		{
+			return false;
+		}
+
+		std::vector<uint32_t> &Blocks = StreamBlocks[k];
+		Blocks.resize(NumStreamBlocks);
+		for (uint32_t i = 0; i < NumStreamBlocks; i++)
+		{
+			Blocks[i] = ReadU32(Ptr); Ptr += sizeof(uint32_t);
+			if (Blocks[i] >= NumBlocks)
+			{
+				return false;
+			}
+		} // end for i
+	} // end for k
+
+	GatheredStreams.resize(NumStreams);
+	GatherFlags.reset(new std::once_flag[NumStreams]);
+	return true;
+}
+
+uint32_t FMsfFile::GetStreamSize(uint32_t InStream) const
+{
+	return InStream < StreamSizes.size() ? StreamSizes[InStream] : 0;
+}
+
+void FMsfFile::GatherStream(uint32_t InStream) const
+{
+	const std::vector<uint32_t> &Blocks = StreamBlocks[InStream];
+	const uint32_t Size = StreamSizes[InStream];
+
+	std::vector<uint8_t> &Gathered = GatheredStreams[InStream];
+	Gathered.resize(Size);
+	for (size_t k = 0; k < Blocks.size(); k++)
+	{
+		const uint32_t Offset = (uint32_t)k * BlockSize;
+		const uint32_t Bytes = Size - Offset < BlockSize ? Size - Offset : BlockSize;
+		memcpy(&Gathered[Offset], GetBlock(Blocks[k]), Bytes);
+	} // end for k
+}
+
+FPdbStreamView FMsfFile::GetStream(uint32_t InStream) const
+{
+	FPdbStreamView View = { NULL, 0 };
+	if (InStream >= StreamSizes.size() || StreamSizes[InStream] == 0)
+	{
+		return View;
+	}
+
+	const std::vector<uint32_t> &Blocks = StreamBlocks[InStream];
+
+	bool bContiguous = true;
+	for (size_t k = 1; k < Blocks.size() && bContiguous; k++)
+	{
+		bContiguous = Blocks[k] == Blocks[k - 1] + 1;
+	} // end for k
+
+	if (bContiguous)
+	{
+		View.Data = GetBlock(Blocks[0]);
+		View.Size = StreamSizes[InStream];
+		return View;
+	}
+
+	std::call_once(GatherFlags[InStream], &FMsfFile::GatherStream, this, InStream);
+
+	const std::vector<uint8_t> &Gathered = GatheredStreams[InStream];
+	View.Data = &Gathered[0];
+	View.Size = (uint32_t)Gathered.size();
+	return View;
+}
+
+//////////////////////////////////////////////////////////////////////////
+FPdbTypeStream::FPdbTypeStream()
+	: TypeIndexBegin(0)
+	, TypeIndexEnd(0)
+{
+	Records.Data = NULL;
+	Records.Size = 0;
+}
+
+bool FPdbTypeStream::Init(const FPdbStreamView &InStream)
+{
+	if (InStream.Size < 56)
+	{
+		return false;
+	}
+
+	const uint32_t HeaderSize = ReadU32(InStream.Data + 4);
+	const uint32_t TypeRecordBytes = ReadU32(InStream.Data + 16);
+	if (HeaderSize < 56 || (uint64_t)HeaderSize + TypeRecordBytes > InStream.Size)
+	{
+		return false;
+	}
+
+	TypeIndexBegin = ReadU32(InStream.Data + 8);
+	TypeIndexEnd = ReadU32(InStream.Data + 12);
+	if (TypeIndexEnd < TypeIndexBegin)
+	{
+		return false;
+	}
+
+	Records.Data = InStream.Data + HeaderSize;
+	Records.Size = TypeRecordBytes;
+	return true;
+}
+
+void FPdbTypeStream::BuildOffsets() const
+{
+	// one pass over all records, the hash stream's index offsets would only save this walk.
+	Offsets.reserve(TypeIndexEnd - TypeIndexBegin);
+
+	uint32_t Offset = 0;
+	while (Offset + 4 <= Records.Size && Offsets.size() < TypeIndexEnd - TypeIndexBegin)
+	{
+		const uint16_t RecordLength = ReadU16(Records.Data + Offset);
+		if (RecordLength < 2 || Offset + 2 + RecordLength > Records.Size)
+		{
+			break;
+		}
+
+		Offsets.push_back(Offset);
+		Offset += 2 + RecordLength;
+	} // end while
+}
+
+bool FPdbTypeStream::GetRecord(uint32_t InTypeIndex, FPdbTypeRecord &OutRecord) const
+{
+	if (InTypeIndex < TypeIndexBegin || InTypeIndex >= TypeIndexEnd)
+	{
+		return false;
+	}
+
+	std::call_once(OffsetsFlag, &FPdbTypeStream::BuildOffsets, this);
+
+	const uint32_t Slot = InTypeIndex - TypeIndexBegin;
+	if (Slot >= Offsets.size())
+	{
+		return false;
+	}
+
+	const uint8_t *Record = Records.Data + Offsets[Slot];
+	OutRecord.Kind = ReadU16(Record + 2);
+	OutRecord.Data = Record + 4;
+	OutRecord.Length = ReadU16(Record) - 2;
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+FPdbReader::FPdbReader()
+	: Age(0)
+	, Machine(0)
+	, NamesStream(0)
+	, SymRecordStream(0xFFFF)
+	, Streams(new FStreams())
+{
+	memset(&Guid, 0, sizeof(Guid));
+}
+
+FPdbReader::~FPdbReader()
+{
+	Close();
+}
+
+bool FPdbReader::Open(const std::wstring &InFilename)
+{
+	Close();
+
+	if (!File.Open(InFilename))
+	{
+		return false;
+	}
+
+	if (!Streams->Msf.Open(File.GetData(), File.GetSize()) || !Parse())
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+bool FPdbReader::OpenMemory(const uint8_t *InData, uint64_t InSize)
+{
+	Close();
+
+	if (!Streams->Msf.Open(InData, InSize) || !Parse())
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void FPdbReader::Close()
+{
+	Modules.clear();
+	SectionRvas.clear();
+	memset(&Guid, 0, sizeof(Guid));
+	Age = 0;
+	Machine = 0;
+	NamesStream = 0;
+	SymRecordStream = 0xFFFF;
+	// a fresh set, the once_flags of the old one can not be re-armed
+	Streams.reset(new FStreams());
+	File.Close();
+}
+
+bool FPdbReader::Parse()
+{
+	if (!ParseInfoStream() || !ParseDbiStream())
+	{
+		return false;
+	}
+
+	// IPI is optional (old PDBs)
+	Streams->TypeStream.Init(Streams->Msf.GetStream(kPdbStream_Tpi));
+	Streams->IdStream.Init(Streams->Msf.GetStream(kPdbStream_Ipi));
+	return true;
+}
+
+bool FPdbReader::ParseInfoStream()
+{
+	const FPdbStreamView Info = Streams->Msf.GetStream(kPdbStream_Info);
+	if (Info.Size < 28)
+	{
+		return false;
+	}
+
+	Age = ReadU32(Info.Data + 8);
+	memcpy(&Guid, Info.Data + 12, sizeof(Guid));
+
+	// named stream map: string buffer followed by a hash table of (string offset, stream)
+	const uint8_t *Ptr = Info.Data + 28;
+	const uint8_t *End = Info.Data + Info.Size;
+	if (End - Ptr < 4)
+	{
+		return true;
+	}
+
+	const uint32_t StringBytes = ReadU32(Ptr); Ptr += 4;
+	if ((uint64_t)(End - Ptr) < (uint64_t)StringBytes + 8)
+	{
+		return true;
+	}
+	const char *Strings = (const char *)Ptr;
+	Ptr += StringBytes;
+
+	const uint32_t NumEntries = ReadU32(Ptr); Ptr += 4;
+	Ptr += 4; // capacity
+
+	if (End - Ptr < 4)
+	{
+		return true;
+	}
+	const uint32_t PresentWords = ReadU32(Ptr); Ptr += 4;
+	if ((uint64_t)(End - Ptr) < (uint64_t)PresentWords * 4 + 4)
+	{
+		return true;
+	}
+	Ptr += PresentWords * 4;
+	const uint32_t DeletedWords = ReadU32(Ptr); Ptr += 4;
+	if ((uint64_t)(End - Ptr) < (uint64_t)DeletedWords * 4 + (uint64_t)NumEntries * 8)
+	{
+		return true;
+	}
+	Ptr += DeletedWords * 4;
+
+	for (uint32_t k = 0; k < NumEntries; k++, Ptr += 8)
+	{
+		const uint32_t NameOffset = ReadU32(Ptr);
+		if (NameOffset + sizeof("/names") <= StringBytes && strcmp(Strings + NameOffset, "/names") == 0)
+		{
+			NamesStream = ReadU32(Ptr + 4);
+		}
+	} // end for k
+
+	return true;
+}
+
+bool FPdbReader::ParseDbiStream()
+{
+	const FPdbStreamView Dbi = Streams->Msf.GetStream(kPdbStream_Dbi);
+	if (Dbi.Size < 64)
+	{
+		return false;
+	}
+
+	SymRecordStream = ReadU16(Dbi.Data + 20);
+	Machine = ReadU16(Dbi.Data + 58);
+
+	const uint32_t ModInfoSize = ReadU32(Dbi.Data + 24);
+	const uint32_t SectionContributionSize = ReadU32(Dbi.Data + 28);
+	const uint32_t SectionMapSize = ReadU32(Dbi.Data + 32);
+	const uint32_t SourceInfoSize = ReadU32(Dbi.Data + 36);
+	const uint32_t TypeServerMapSize = ReadU32(Dbi.Data + 40);
+	const uint32_t OptionalDbgHeaderSize = ReadU32(Dbi.Data + 48);
+	const uint32_t ECSubstreamSize = ReadU32(Dbi.Data + 52);
+
+	const uint64_t SubstreamBytes = (uint64_t)ModInfoSize + SectionContributionSize + SectionMapSize + SourceInfoSize
+		+ TypeServerMapSize + ECSubstreamSize + OptionalDbgHeaderSize;
+	if (64 + SubstreamBytes > Dbi.Size)
+	{
+		return false;
+	}
+
+	// module infos
+	const uint8_t *Ptr = Dbi.Data + 64;
+	const uint8_t *End = Ptr + ModInfoSize;
+	while (End - Ptr >= 64)
+	{
+		FPdbModuleInfo Module;
+		Module.SymbolStream = ReadU16(Ptr + 34);
+		Module.SymbolBytes = ReadU32(Ptr + 36);
+		Module.C11Bytes = ReadU32(Ptr + 40);
+		Module.C13Bytes = ReadU32(Ptr + 44);
+
+		const uint8_t *NamePtr = Ptr + 64;
+		const char *ModuleName = ReadString(NamePtr, End);
+		const char *ObjFileName = ModuleName ? ReadString(NamePtr, End) : NULL;
+		if (!ObjFileName)
+		{
+			break;
+		}
+		Module.ModuleName = ModuleName;
+		Module.ObjFileName = ObjFileName;
+		Modules.push_back(Module);
+
+		const size_t EntrySize = ((NamePtr - Ptr) + 3) & ~(size_t)3;
+		Ptr = (size_t)(End - Ptr) > EntrySize ? Ptr + EntrySize : End;
+	} // end while
+
+	// optional debug headers, entry 5 is the section header stream
+	const uint8_t *DbgHeader = Dbi.Data + 64 + (SubstreamBytes - OptionalDbgHeaderSize);
+	if (OptionalDbgHeaderSize >= 6 * sizeof(uint16_t))
+	{
+		const uint16_t SectionHeaderStream = ReadU16(DbgHeader + 5 * sizeof(uint16_t));
+		const FPdbStreamView Sections = Streams->Msf.GetStream(SectionHeaderStream);
+		for (uint32_t Offset = 0; Offset + 40 <= Sections.Size; Offset += 40)
+		{
+			SectionRvas.push_back(ReadU32(Sections.Data + Offset + 12));
+		} // end for
+	}
+
+	return true;
+}
+
+const char* FPdbReader::ReadString(const uint8_t *&InOutPtr, const uint8_t *InEnd)
+{
+	const uint8_t *Terminator = (const uint8_t *)memchr(InOutPtr, 0, InEnd - InOutPtr);
+	if (!Terminator)
+	{
+		return NULL;
+	}
+
+	const char *String = (const char *)InOutPtr;
+	InOutPtr = Terminator + 1;
+	return String;
+}
+
+bool FPdbReader::ReadNumeric(const uint8_t *&InOutPtr, const uint8_t *InEnd, uint64_t &OutValue)
+{
+	if (InEnd - InOutPtr < 2)
+	{
+		return false;
+	}
+
+	const uint16_t Leaf = ReadU16(InOutPtr);
+	InOutPtr += 2;
+	if (Leaf < 0x8000)
+	{
+		OutValue = Leaf;
+		return true;
+	}
+
+	size_t Bytes = 0;
+	bool bSigned = false;
+	switch (Leaf)
+	{
+	case 0x8000: Bytes = 1; bSigned = true; break;	// LF_CHAR
+	case 0x8001: Bytes = 2; bSigned = true; break;	// LF_SHORT
+	case 0x8002: Bytes = 2; break;					// LF_USHORT
+	case 0x8003: Bytes = 4; bSigned = true; break;	// LF_LONG
+	case 0x8004: Bytes = 4; break;					// LF_ULONG
+	case 0x8009: Bytes = 8; bSigned = true; break;	// LF_QUADWORD
+	case 0x800A: Bytes = 8; break;					// LF_UQUADWORD
+	default:
+		return false;
+	}
+
+	if ((size_t)(InEnd - InOutPtr) < Bytes)
+	{
+		return false;
+	}
+
+	uint64_t Value = 0;
+	memcpy(&Value, InOutPtr, Bytes);
+	if (bSigned && Bytes < 8 && (Value >> (Bytes * 8 - 1)) & 1)
+	{
+		Value |= ~(uint64_t)0 << (Bytes * 8);
+	}
+
+	InOutPtr += Bytes;
+	OutValue = Value;
+	return true;
+}
+
+uint32_t FPdbReader::SectionOffsetToRva(uint16_t InSegment, uint32_t InOffset) const
+{
+	if (InSegment == 0 || InSegment > SectionRvas.size())
+	{
+		return 0;
+	}
+
+	return SectionRvas[InSegment - 1] + InOffset;
+}
+
+const char* FPdbReader::GetString(uint32_t InOffset) const
+{
+	const FPdbStreamView Names = Streams->Msf.GetStream(NamesStream);
+	if (!NamesStream || Names.Size < 12 || ReadU32(Names.Data) != 0xEFFEEFFE)
+	{
+		return NULL;
+	}
+
+	const uint32_t StringBytes = ReadU32(Names.Data + 8);
+	if (InOffset >= StringBytes || 12 + (uint64_t)StringBytes > Names.Size)
+	{
+		return NULL;
+	}
+
+	const uint8_t *Ptr = Names.Data + 12 + InOffset;
+	return ReadString(Ptr, Names.Data + 12 + StringBytes);
+}
+
+//////////////////////////////////////////////////////////////////////////
+void FPdbReader::GetPublicSymbols(std::vector<FPdbSymbolInfo> &OutSymbols) const
+{
+	const FPdbStreamView Symbols = Streams->Msf.GetStream(SymRecordStream);
+
+	uint32_t Offset = 0;
+	while (Offset + 4 <= Symbols.Size)
+	{
+		const uint8_t *Record = Symbols.Data + Offset;
+		const uint16_t RecordLength = ReadU16(Record);
+		const uint16_t Kind = ReadU16(Record + 2);
+		if (RecordLength < 2 || Offset + 2 + RecordLength > Symbols.Size)
+		{
+			break;
+		}
+
+		const uint8_t *RecordEnd = Record + 2 + RecordLength;
+		if (Kind == NSCodeView::S_PUB32 && RecordLength >= 2 + 10)
+		{
+			const uint8_t *NamePtr = Record + 14;
+			const char *Name = ReadString(NamePtr, RecordEnd);
+			if (Name)
+			{
+				FPdbSymbolInfo Symbol;
+				Symbol.Name = Name;
+				Symbol.Rva = SectionOffsetToRva(ReadU16(Record + 12), ReadU32(Record + 8));
+				Symbol.Size = 0;
+				Symbol.TypeIndex = 0;
+				Symbol.Kind = Kind;
+				OutSymbols.push_back(Symbol);
+			}
+		}
+
+		Offset += 2 + RecordLength;
+	} // end while
+}
+
+void FPdbReader::GetModuleSymbols(uint32_t InModule, std::vector<FPdbSymbolInfo> &OutSymbols) const
+{
+	if (InModule >= Modules.size())
+	{
+		return;
+	}
+
+	const FPdbModuleInfo &Module = Modules[InModule];
+	const FPdbStreamView Stream = Streams->Msf.GetStream(Module.SymbolStream);
+	const uint32_t SymbolBytes = Module.SymbolBytes < Stream.Size ? Module.SymbolBytes : Stream.Size;
+
+	// skip the CV signature
+	uint32_t Offset = 4;
+	while (Offset + 4 <= SymbolBytes)
+	{
+		const uint8_t *Record = Stream.Data + Offset;
+		const uint16_t RecordLength = ReadU16(Record);
+		const uint16_t Kind = ReadU16(Record + 2);
+		if (RecordLength < 2 || Offset + 2 + RecordLength > SymbolBytes)
+		{
+			break;
+		}
+
+		const uint8_t *RecordEnd = Record + 2 + RecordLength;
+		switch (Kind)
+		{
+		case NSCodeView::S_GPROC32:
+		case NSCodeView::S_LPROC32:
+		case NSCodeView::S_GPROC32_ID:
+		case NSCodeView::S_LPROC32_ID:
+			if (RecordLength >= 2 + 35)
+			{
+				const uint8_t *NamePtr = Record + 39;
+				const char *Name = ReadString(NamePtr, RecordEnd);
+				if (Name)
+				{
+					FPdbSymbolInfo Symbol;
+					Symbol.Name = Name;
+					Symbol.Rva = SectionOffsetToRva(ReadU16(Record + 36), ReadU32(Record + 32));
+					Symbol.Size = ReadU32(Record + 16);
+					Symbol.TypeIndex = ReadU32(Record + 28);
+					Symbol.Kind = Kind;
+					OutSymbols.push_back(Symbol);
+				}
+			}
+			break;
+		case NSCodeView::S_GDATA32:
+		case NSCodeView::S_LDATA32:
+			if (RecordLength >= 2 + 10)
+			{
+				const uint8_t *NamePtr = Record + 14;
+				const char *Name = ReadString(NamePtr, RecordEnd);
+				if (Name)
+				{
+					FPdbSymbolInfo Symbol;
+					Symbol.Name = Name;
+					Symbol.Rva = SectionOffsetToRva(ReadU16(Record + 12), ReadU32(Record + 8));
+					Symbol.Size = 0;
+					Symbol.TypeIndex = ReadU32(Record + 4);
+					Symbol.Kind = Kind;
+					OutSymbols.push_back(Symbol);
+				}
+			}
+			break;
+		default:
+			break;
+		}
+
+		Offset += 2 + RecordLength;
+	} // end while
+}
+
+void FPdbReader::GetModuleLines(uint32_t InModule, std::vector<FPdbLineInfo> &OutLines) const
+{
+	if (InModule >= Modules.size())
+	{
+		return;
+	}
+
+	const FPdbModuleInfo &Module = Modules[InModule];
+	const FPdbStreamView Stream = Streams->Msf.GetStream(Module.SymbolStream);
+	const uint64_t C13Begin = (uint64_t)Module.SymbolBytes + Module.C11Bytes;
+	if (Module.C13Bytes == 0 || C13Begin + Module.C13Bytes > Stream.Size)
+	{
+		return;
+	}
+
+	const uint8_t *C13 = Stream.Data + C13Begin;
+	const uint32_t C13Bytes = Module.C13Bytes;
+
+	// the file checksum subsection maps a line block's file id to the /names offset.
+	const uint8_t *Checksums = NULL;
+	uint32_t ChecksumBytes = 0;
+	for (uint32_t Offset = 0; Offset + 8 <= C13Bytes; )
+	{
+		const uint32_t Kind = ReadU32(C13 + Offset);
+		const uint32_t Length = ReadU32(C13 + Offset + 4);
+		if (Length > C13Bytes - Offset - 8)
+		{
+			break;
+		}
+		if (Kind == kDebugS_FileChecksums)
+		{
+			Checksums = C13 + Offset + 8;
+			ChecksumBytes = Length;
+			break;
+		}
+		Offset += 8 + ((Length + 3) & ~3u);
+	} // end for
+
+	for (uint32_t Offset = 0; Offset + 8 <= C13Bytes; )
+	{
+		const uint32_t Kind = ReadU32(C13 + Offset);
+		const uint32_t Length = ReadU32(C13 + Offset + 4);
+		if (Length > C13Bytes - Offset - 8)
+		{
+			break;
+		}
+
+		if (Kind == kDebugS_Lines && !(Kind & kDebugS_Ignore) && Length >= 12)
+		{
+			const uint8_t *Lines = C13 + Offset + 8;
+			const uint8_t *LinesEnd = Lines + Length;
+			const uint32_t BaseRva = SectionOffsetToRva(ReadU16(Lines + 4), ReadU32(Lines));
+			const bool bHasColumns = (ReadU16(Lines + 6) & 1) != 0;
+
+			const uint8_t *Block = Lines + 12;
+			while (LinesEnd - Block >= 12)
+			{
+				const uint32_t FileId = ReadU32(Block);
+				const uint32_t NumLines = ReadU32(Block + 4);
+				const uint32_t BlockSize = ReadU32(Block + 8);
+				if (BlockSize < 12 || BlockSize > (uint32_t)(LinesEnd - Block) || (uint64_t)NumLines * (bHasColumns ? 12 : 8) > BlockSize - 12)
+				{
+					break;
+				}
+
+				const uint32_t FileNameOffset = (Checksums && FileId + 4 <= ChecksumBytes) ? ReadU32(Checksums + FileId) : 0;
+				for (uint32_t k = 0; k < NumLines; k++)
+				{
+					const uint8_t *Entry = Block + 12 + k * 8;
+
+					FPdbLineInfo Line;
+					Line.Rva = BaseRva + ReadU32(Entry);
+					Line.Line = ReadU32(Entry + 4) & 0x00FFFFFF;
+					Line.FileNameOffset = FileNameOffset;
+					OutLines.push_back(Line);
+				} // end for k
+
+				Block += BlockSize;
+			} // end while
+
+			// close the contribution, code past it has no line.
+			FPdbLineInfo EndLine;
+			EndLine.Rva = BaseRva + ReadU32(Lines + 8);
+			EndLine.Line = 0;
+			EndLine.FileNameOffset = 0;
+			OutLines.push_back(EndLine);
+		}
+
+		Offset += 8 + ((Length + 3) & ~3u);
+	} // end for
+}
+
+//////////////////////////////////////////////////////////////////////////
+uint32_t FPdbReader::GetSimpleTypeSize(uint32_t InTypeIndex)
+{
+	const uint32_t Mode = (InTypeIndex >> 8) & 0xF;
+	if (Mode != 0)
+	{
+		// 0x4/0x5 32 bits, 0x6 64 bits, 0x1..0x3 16 bits
+		return Mode == 6 ? 8 : (Mode >= 4 ? 4 : 2);
+	}
+
+	switch (InTypeIndex & 0xFF)
+	{
+	case 0x10: case 0x20: case 0x68: case 0x69: case 0x70: case 0x7C: case 0x30:
+		return 1;
+	case 0x11: case 0x21: case 0x72: case 0x73: case 0x71: case 0x7A: case 0x31: case 0x46:
+		return 2;
+	case 0x12: case 0x22: case 0x74: case 0x75: case 0x7B: case 0x32: case 0x40: case 0x08:
+		return 4;
+	case 0x13: case 0x23: case 0x76: case 0x77: case 0x33: case 0x41:
+		return 8;
+	case 0x42:
+		return 10;
+	case 0x14: case 0x24: case 0x78: case 0x79: case 0x43:
+		return 16;
+	default:
+		return 0;
+	}
+}
+
+bool FPdbReader::GetTypeInfo(uint32_t InTypeIndex, FPdbTypeInfo &OutInfo) const
+{
+	memset(&OutInfo, 0, sizeof(OutInfo));
+	OutInfo.Name = "";
+
+	if (IsSimpleType(InTypeIndex))
+	{
+		OutInfo.Size = GetSimpleTypeSize(InTypeIndex);
+		return true;
+	}
+
+	FPdbTypeRecord Record;
+	if (!Streams->TypeStream.GetRecord(InTypeIndex, Record))
+	{
+		return false;
+	}
+
+	using namespace NSCodeView;
+
+	OutInfo.Kind = Record.Kind;
+	const uint8_t *Ptr = Record.Data;
+	const uint8_t *End = Record.Data + Record.Length;
+	switch (Record.Kind)
+	{
+	case LF_MODIFIER:
+		if (Record.Length < 6) { return false; }
+		OutInfo.ElementType = ReadU32(Ptr);
+		OutInfo.Properties = ReadU16(Ptr + 4);
+		break;
+	case LF_POINTER:
+		if (Record.Length < 8) { return false; }
+		OutInfo.ElementType = ReadU32(Ptr);
+		OutInfo.PointerMode = (ReadU32(Ptr + 4) >> 5) & 0x7;
+		OutInfo.Size = (ReadU32(Ptr + 4) >> 13) & 0x3F;
+		break;
+	case LF_ARRAY:
+		if (Record.Length < 10) { return false; }
+		OutInfo.ElementType = ReadU32(Ptr);
+		Ptr += 8;
+		if (!ReadNumeric(Ptr, End, OutInfo.Size)) { return false; }
+		OutInfo.Name = ReadString(Ptr, End);
+		break;
+	case LF_CLASS:
+	case LF_STRUCTURE:
+	case LF_INTERFACE:
+		if (Record.Length < 18) { return false; }
+		OutInfo.Count = ReadU16(Ptr);
+		OutInfo.Properties = ReadU16(Ptr + 2);
+		OutInfo.FieldList = ReadU32(Ptr + 4);
+		Ptr += 16;
+		if (!ReadNumeric(Ptr, End, OutInfo.Size)) { return false; }
+		OutInfo.Name = ReadString(Ptr, End);
+		break;
+	case LF_UNION:
+		if (Record.Length < 10) { return false; }
+		OutInfo.Count = ReadU16(Ptr);
+		OutInfo.Properties = ReadU16(Ptr + 2);
+		OutInfo.FieldList = ReadU32(Ptr + 4);
+		Ptr += 8;
+		if (!ReadNumeric(Ptr, End, OutInfo.Size)) { return false; }
+		OutInfo.Name = ReadString(Ptr, End);
+		break;
+	case LF_ENUM:
+		if (Record.Length < 12) { return false; }
+		OutInfo.Count = ReadU16(Ptr);
+		OutInfo.Properties = ReadU16(Ptr + 2);
+		OutInfo.ElementType = ReadU32(Ptr + 4);
+		OutInfo.FieldList = ReadU32(Ptr + 8);
+		OutInfo.Size = GetSimpleTypeSize(OutInfo.ElementType);
+		Ptr += 12;
+		OutInfo.Name = ReadString(Ptr, End);
+		break;
+	case LF_PROCEDURE:
+		if (Record.Length < 12) { return false; }
+		OutInfo.ElementType = ReadU32(Ptr);
+		OutInfo.Count = ReadU16(Ptr + 6);
+		OutInfo.FieldList = ReadU32(Ptr + 8);
+		break;
+	case LF_MFUNCTION:
+		if (Record.Length < 20) { return false; }
+		OutInfo.ElementType = ReadU32(Ptr);
+		OutInfo.Count = ReadU16(Ptr + 14);
+		OutInfo.FieldList = ReadU32(Ptr + 16);
+		break;
+	case LF_BITFIELD:
+		if (Record.Length < 6) { return false; }
+		OutInfo.ElementType = ReadU32(Ptr);
+		OutInfo.Count = Ptr[4];
+		OutInfo.Properties = Ptr[5];
+		break;
+	default:
+		break;
+	}
+
+	if (!OutInfo.Name)
+	{
+		OutInfo.Name = "";
+	}
+	return true;
+}
+
+bool FPdbReader::GetFieldList(uint32_t InFieldList, std::vector<FPdbFieldInfo> &OutFields) const
+{
+	using namespace NSCodeView;
+
+	// LF_INDEX chains long field lists, bound the walk in case of a cycle.
+	for (uint32_t Chain = 0; InFieldList && Chain < 4096; Chain++)
+	{
+		FPdbTypeRecord Record;
+		if (!Streams->TypeStream.GetRecord(InFieldList, Record) || Record.Kind != LF_FIELDLIST)
+		{
+			return false;
+		}
+		InFieldList = 0;
+
+		const uint8_t *Ptr = Record.Data;
+		const uint8_t *End = Record.Data + Record.Length;
+		while (End - Ptr >= 2)
+		{
+			// LF_PADx
+			if (*Ptr >= 0xF0)
+			{
+				if ((*Ptr & 0x0F) == 0)
+				{
+					return false;
+				}
+				Ptr += *Ptr & 0x0F;
+				continue;
+			}
+
+			FPdbFieldInfo Field;
+			Field.Kind = ReadU16(Ptr);
+			Field.Attributes = 0;
+			Field.TypeIndex = 0;
+			Field.Value = 0;
+			Field.Name = "";
+			Ptr += 2;
+
+			if (End - Ptr < 2)
+			{
+				return false;
+			}
+
+			switch (Field.Kind)
+			{
+			case LF_MEMBER:
+				if (End - Ptr < 6) { return false; }
+				Field.Attributes = ReadU16(Ptr);
+				Field.TypeIndex = ReadU32(Ptr + 2);
+				Ptr += 6;
+				if (!ReadNumeric(Ptr, End, Field.Value)) { return false; }
+				Field.Name = ReadString(Ptr, End);
+				break;
+			case LF_STMEMBER:
+			case LF_NESTTYPE:
+				if (End - Ptr < 6) { return false; }
+				Field.Attributes = ReadU16(Ptr);
+				Field.TypeIndex = ReadU32(Ptr + 2);
+				Ptr += 6;
+				Field.Name = ReadString(Ptr, End);
+				break;
+			case LF_BCLASS:
+				if (End - Ptr < 6) { return false; }
+				Field.Attributes = ReadU16(Ptr);
+				Field.TypeIndex = ReadU32(Ptr + 2);
+				Ptr += 6;
+				if (!ReadNumeric(Ptr, End, Field.Value)) { return false; }
+				break;
+			case LF_VBCLASS:
+			case LF_IVBCLASS:
+				{
+					if (End - Ptr < 10) { return false; }
+					Field.Attributes = ReadU16(Ptr);
+					Field.TypeIndex = ReadU32(Ptr + 2);
+					Ptr += 10;
+					uint64_t VbTableIndex = 0;
+					if (!ReadNumeric(Ptr, End, Field.Value) || !ReadNumeric(Ptr, End, VbTableIndex)) { return false; }
+				}
+				break;
+			case LF_ENUMERATE:
+				Field.Attributes = ReadU16(Ptr);
+				Ptr += 2;
+				if (!ReadNumeric(Ptr, End, Field.Value)) { return false; }
+				Field.Name = ReadString(Ptr, End);
+				break;
+			case LF_ONEMETHOD:
+				{
+					if (End - Ptr < 6) { return false; }
+					Field.Attributes = ReadU16(Ptr);
+					Field.TypeIndex = ReadU32(Ptr + 2);
+					Ptr += 6;
+					// introducing virtual methods carry their vftable offset
+					const uint16_t MethodProperty = (Field.Attributes >> 2) & 0x7;
+					if (MethodProperty == 4 || MethodProperty == 6)
+					{
+						if (End - Ptr < 4) { return false; }
+						Field.Value = ReadU32(Ptr);
+						Ptr += 4;
+					}
+					Field.Name = ReadString(Ptr, End);
+				}
+				break;
+			case LF_METHOD:
+				if (End - Ptr < 6) { return false; }
+				Field.Value = ReadU16(Ptr);
+				Field.TypeIndex = ReadU32(Ptr + 2);
+				Ptr += 6;
+				Field.Name = ReadString(Ptr, End);
+				break;
+			case LF_VFUNCTAB:
+				if (End - Ptr < 6) { return false; }
+				Field.TypeIndex = ReadU32(Ptr + 2);
+				Ptr += 6;
+				break;
+			case LF_INDEX:
+				if (End - Ptr < 6) { return false; }
+				InFieldList = ReadU32(Ptr + 2);
+				Ptr += 6;
+				continue;
+			default:
+				// unknown member kind, the rest of the list can't be decoded.
+				return false;
+			}
+
+			if (!Field.Name)
+			{
+				return false;
+			}
+			OutFields.push_back(Field);
+		} // end while
+	} // end for Chain
+
+	return true;
+}
+
+bool FPdbReader::GetArgList(uint32_t InArgList, std::vector<uint32_t> &OutArgs) const
+{
+	FPdbTypeRecord Record;
+	if (!Streams->TypeStream.GetRecord(InArgList, Record) || Record.Kind != NSCodeView::LF_ARGLIST || Record.Length < 4)
+	{
+		return false;
+	}
+
+	const uint32_t Count = ReadU32(Record.Data);
+	if ((uint64_t)Count * 4 > Record.Length - 4)
+	{
+		return false;
+	}
+
+	for (uint32_t k = 0; k < Count; k++)
+	{
+		OutArgs.push_back(ReadU32(Record.Data + 4 + k * 4));
+	} // end for k
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// FNV-1a
+static uint32_t HashTypeName(const char *InName)
+{
+	uint32_t Hash = 2166136261u;
+	for (const uint8_t *Ptr = (const uint8_t *)InName; *Ptr; Ptr++)
+	{
+		Hash = (Hash ^ *Ptr) * 16777619u;
+	} // end for
+	return Hash;
+}
+
+static bool IsUdtKind(uint16_t InKind)
+{
+	using namespace NSCodeView;
+	return InKind == LF_CLASS || InKind == LF_STRUCTURE || InKind == LF_INTERFACE || InKind == LF_UNION || InKind == LF_ENUM;
+}
+
+// the unique (decorated) name follows the name when PROP_HASUNIQUENAME is set.
+static const char* GetUdtLookupName(const FPdbTypeInfo &InInfo)
+{
+	if (InInfo.Properties & NSCodeView::PROP_HASUNIQUENAME)
+	{
+		const char *UniqueName = InInfo.Name + strlen(InInfo.Name) + 1;
+		if (*UniqueName)
+		{
+			return UniqueName;
+		}
+	}
+	return InInfo.Name;
+}
+
+void FPdbReader::BuildUdtNameIndex() const
+{
+	const uint32_t Begin = Streams->TypeStream.GetTypeIndexBegin();
+	const uint32_t End = Streams->TypeStream.GetTypeIndexEnd();
+
+	std::vector<uint32_t> Definitions;
+	for (uint32_t TypeIndex = Begin; TypeIndex < End; TypeIndex++)
+	{
+		FPdbTypeRecord Record;
+		if (Streams->TypeStream.GetRecord(TypeIndex, Record) && IsUdtKind(Record.Kind))
+		{
+			FPdbTypeInfo Info;
+			if (GetTypeInfo(TypeIndex, Info) && !(Info.Properties & NSCodeView::PROP_FWDREF))
+			{
+				Definitions.push_back(TypeIndex);
+			}
+		}
+	} // end for TypeIndex
+
+	uint32_t Capacity = 16;
+	while (Capacity < Definitions.size() * 2)
+	{
+		Capacity <<= 1;
+	}
+	Streams->UdtNameTable.assign(Capacity, 0);
+
+	for (size_t k = 0; k < Definitions.size(); k++)
+	{
+		FPdbTypeInfo Info;
+		GetTypeInfo(Definitions[k], Info);
+
+		uint32_t Slot = HashTypeName(GetUdtLookupName(Info)) & (Capacity - 1);
+		while (Streams->UdtNameTable[Slot])
+		{
+			Slot = (Slot + 1) & (Capacity - 1);
+		}
+		Streams->UdtNameTable[Slot] = Definitions[k];
+	} // end for k
+}
+
+uint32_t FPdbReader::ResolveForwardRef(uint32_t InTypeIndex) const
+{
+	FPdbTypeInfo Info;
+	if (!GetTypeInfo(InTypeIndex, Info) || !IsUdtKind(Info.Kind) || !(Info.Properties & NSCodeView::PROP_FWDREF))
+	{
+		return InTypeIndex;
+	}
+
+	std::call_once(Streams->UdtNameFlag, &FPdbReader::BuildUdtNameIndex, this);
+
+	const char *Name = GetUdtLookupName(Info);
+	const uint32_t Mask = (uint32_t)Streams->UdtNameTable.size() - 1;
+	for (uint32_t Slot = HashTypeName(Name) & Mask; Streams->UdtNameTable[Slot]; Slot = (Slot + 1) & Mask)
+	{
+		FPdbTypeInfo Candidate;
+		if (GetTypeInfo(Streams->UdtNameTable[Slot], Candidate) && Candidate.Kind == Info.Kind && strcmp(GetUdtLookupName(Candidate), Name) == 0)
+		{
+			return Streams->UdtNameTable[Slot];
+		}
+	} // end for Slot
+
+	return InTypeIndex;
+}
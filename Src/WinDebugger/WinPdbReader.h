@@ -0,0 +1,268 @@
+// \brief
+//		native PDB reader: MSF container, PDB info, DBI, TPI/IPI, symbol records and C13 line tables.
+//		the file is memory mapped, streams are parsed on demand. all queries are safe to call from
+//		multiple threads once Open() returned.
+//
+// ref: https://llvm.org/docs/PDB/index.html
+//
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <memory>
+
+#include "Foundation/AppMappedFile.h"
+
+
+struct FPdbGuid
+{
+	uint32_t	Data1;
+	uint16_t	Data2;
+	uint16_t	Data3;
+	uint8_t		Data4[8];
+};
+
+// contiguous bytes of one stream
+struct FPdbStreamView
+{
+	const uint8_t	*Data;
+	uint32_t		Size;
+};
+
+// MSF container: superblock, stream directory, stream data.
+class FMsfFile
+{
+public:
+	FMsfFile();
+
+	bool Open(const uint8_t *InData, uint64_t InSize);
+
+	uint32_t GetStreamCount() const { return (uint32_t)StreamSizes.size(); }
+	uint32_t GetStreamSize(uint32_t InStream) const;
+	// streams with consecutive blocks point into the mapping, others are gathered once into a buffer.
+	FPdbStreamView GetStream(uint32_t InStream) const;
+
+private:
+	const uint8_t* GetBlock(uint32_t InBlock) const { return FileData + (uint64_t)InBlock * BlockSize; }
+	void GatherStream(uint32_t InStream) const;
+
+	const uint8_t		*FileData;
+	uint64_t			FileSize;
+	uint32_t			BlockSize;
+
+	std::vector<uint32_t>				StreamSizes;
+	std::vector<std::vector<uint32_t> >	StreamBlocks;
+
+	// gathered streams
+	mutable std::unique_ptr<std::once_flag[]>			GatherFlags;
+	mutable std::vector<std::vector<uint8_t> >			GatheredStreams;
+};
+
+// one type record, Data points after the leaf kind.
+struct FPdbTypeRecord
+{
+	uint16_t		Kind;
+	const uint8_t	*Data;
+	uint32_t		Length;
+};
+
+// TPI or IPI stream
+class FPdbTypeStream
+{
+public:
+	FPdbTypeStream();
+
+	bool Init(const FPdbStreamView &InStream);
+
+	uint32_t GetTypeIndexBegin() const { return TypeIndexBegin; }
+	uint32_t GetTypeIndexEnd() const { return TypeIndexEnd; }
+	bool GetRecord(uint32_t InTypeIndex, FPdbTypeRecord &OutRecord) const;
+
+private:
+	void BuildOffsets() const;
+
+	FPdbStreamView		Records;
+	uint32_t			TypeIndexBegin;
+	uint32_t			TypeIndexEnd;
+
+	mutable std::once_flag			OffsetsFlag;
+	mutable std::vector<uint32_t>	Offsets; // TI - TypeIndexBegin -> record offset
+};
+
+struct FPdbModuleInfo
+{
+	std::string		ModuleName;
+	std::string		ObjFileName;
+	uint16_t		SymbolStream;
+	uint32_t		SymbolBytes;
+	uint32_t		C11Bytes;
+	uint32_t		C13Bytes;
+};
+
+// function, data or public symbol
+struct FPdbSymbolInfo
+{
+	const char		*Name;		// points into the mapping
+	uint32_t		Rva;
+	uint32_t		Size;		// code size for procedures, 0 otherwise
+	uint32_t		TypeIndex;
+	uint16_t		Kind;		// S_xxx
+};
+
+// one line table row, it covers the code up to the next row. Line 0 marks the end of a contribution.
+struct FPdbLineInfo
+{
+	uint32_t		Rva;
+	uint32_t		Line;
+	uint32_t		FileNameOffset; // offset in the /names string table
+};
+
+// a member of a field list
+struct FPdbFieldInfo
+{
+	uint16_t		Kind;		// LF_MEMBER, LF_BCLASS, LF_ENUMERATE ...
+	uint16_t		Attributes;
+	uint32_t		TypeIndex;
+	uint64_t		Value;		// offset of a member/base, value of a enumerate
+	const char		*Name;
+};
+
+// decoded type details
+struct FPdbTypeInfo
+{
+	uint16_t		Kind;			// leaf kind, or 0 for simple types
+	const char		*Name;
+	uint64_t		Size;			// bytes
+	uint32_t		ElementType;	// pointee, element, return, underlying or modified type
+	uint32_t		FieldList;		// UDT/enum field list, procedure arg list
+	uint32_t		Count;			// members of UDT/enum, params of procedures
+	uint16_t		Properties;
+	uint16_t		PointerMode;	// 0 pointer, 1 lvalue reference, 4 rvalue reference
+};
+
+class FPdbReader
+{
+public:
+	FPdbReader();
+	~FPdbReader();
+
+	bool Open(const std::wstring &InFilename);
+	// open a PDB already in memory, the memory must outlive the reader.
+	bool OpenMemory(const uint8_t *InData, uint64_t InSize);
+	void Close();
+
+	// PDB info stream
+	const FPdbGuid& GetGuid() const { return Guid; }
+	uint32_t GetAge() const { return Age; }
+	uint16_t GetMachine() const { return Machine; }
+
+	const FMsfFile& GetMsf() const { return Streams->Msf; }
+	const FPdbTypeStream& GetTypes() const { return Streams->TypeStream; }
+	const FPdbTypeStream& GetIds() const { return Streams->IdStream; }
+
+	// DBI
+	const std::vector<FPdbModuleInfo>& GetModules() const { return Modules; }
+	// segment:offset -> RVA, 0 if the segment is unknown.
+	uint32_t SectionOffsetToRva(uint16_t InSegment, uint32_t InOffset) const;
+
+	// symbols
+	void GetPublicSymbols(std::vector<FPdbSymbolInfo> &OutSymbols) const;
+	void GetModuleSymbols(uint32_t InModule, std::vector<FPdbSymbolInfo> &OutSymbols) const;
+	void GetModuleLines(uint32_t InModule, std::vector<FPdbLineInfo> &OutLines) const;
+	// /names string table
+	const char* GetString(uint32_t InOffset) const;
+
+	// types
+	bool GetTypeInfo(uint32_t InTypeIndex, FPdbTypeInfo &OutInfo) const;
+	bool GetFieldList(uint32_t InFieldList, std::vector<FPdbFieldInfo> &OutFields) const;
+	bool GetArgList(uint32_t InArgList, std::vector<uint32_t> &OutArgs) const;
+	// forward declared UDT/enum -> the definition, returns InTypeIndex if none.
+	uint32_t ResolveForwardRef(uint32_t InTypeIndex) const;
+
+	// simple (built-in) type helpers, type index < 0x1000
+	static bool IsSimpleType(uint32_t InTypeIndex) { return InTypeIndex < 0x1000; }
+	static uint32_t GetSimpleTypeSize(uint32_t InTypeIndex);
+
+	// numeric leaf
+	static bool ReadNumeric(const uint8_t *&InOutPtr, const uint8_t *InEnd, uint64_t &OutValue);
+
+private:
+	bool Parse();
+	bool ParseInfoStream();
+	bool ParseDbiStream();
+	void BuildUdtNameIndex() const;
+	static const char* ReadString(const uint8_t *&InOutPtr, const uint8_t *InEnd);
+
+	// streams parsed on demand, replaced as a whole by Close()
+	struct FStreams
+	{
+		FMsfFile		Msf;
+		FPdbTypeStream	TypeStream;
+		FPdbTypeStream	IdStream;
+
+		// name -> UDT definition, open addressing table of type indices
+		std::once_flag			UdtNameFlag;
+		std::vector<uint32_t>	UdtNameTable;
+	};
+
+	FMappedFile		File;
+
+	FPdbGuid		Guid;
+	uint32_t		Age;
+	uint16_t		Machine;
+	uint32_t		NamesStream;
+	uint16_t		SymRecordStream;
+
+	std::vector<FPdbModuleInfo>	Modules;
+	std::vector<uint32_t>		SectionRvas; // segment - 1 -> virtual address
+
+	std::unique_ptr<FStreams>	Streams;
+};
+
+// CodeView constants used by the reader and its clients
+namespace NSCodeView
+{
+	// symbol kinds
+	const uint16_t S_UDT           = 0x1108;
+	const uint16_t S_LDATA32       = 0x110C;
+	const uint16_t S_GDATA32       = 0x110D;
+	const uint16_t S_PUB32         = 0x110E;
+	const uint16_t S_LPROC32       = 0x110F;
+	const uint16_t S_GPROC32       = 0x1110;
+	const uint16_t S_LPROC32_ID    = 0x1146;
+	const uint16_t S_GPROC32_ID    = 0x1147;
+
+	// type leaf kinds
+	const uint16_t LF_MODIFIER     = 0x1001;
+	const uint16_t LF_POINTER      = 0x1002;
+	const uint16_t LF_PROCEDURE    = 0x1008;
+	const uint16_t LF_MFUNCTION    = 0x1009;
+	const uint16_t LF_ARGLIST      = 0x1201;
+	const uint16_t LF_FIELDLIST    = 0x1203;
+	const uint16_t LF_BITFIELD     = 0x1205;
+	const uint16_t LF_BCLASS       = 0x1400;
+	const uint16_t LF_VBCLASS      = 0x1401;
+	const uint16_t LF_IVBCLASS     = 0x1402;
+	const uint16_t LF_INDEX        = 0x1404;
+	const uint16_t LF_VFUNCTAB     = 0x1409;
+	const uint16_t LF_ENUMERATE    = 0x1502;
+	const uint16_t LF_ARRAY        = 0x1503;
+	const uint16_t LF_CLASS        = 0x1504;
+	const uint16_t LF_STRUCTURE    = 0x1505;
+	const uint16_t LF_UNION        = 0x1506;
+	const uint16_t LF_ENUM         = 0x1507;
+	const uint16_t LF_MEMBER       = 0x150D;
+	const uint16_t LF_STMEMBER     = 0x150E;
+	const uint16_t LF_METHOD       = 0x150F;
+	const uint16_t LF_NESTTYPE     = 0x1510;
+	const uint16_t LF_ONEMETHOD    = 0x1511;
+	const uint16_t LF_INTERFACE    = 0x1519;
+
+	// UDT properties
+	const uint16_t PROP_FWDREF     = 0x0080;
+	const uint16_t PROP_HASUNIQUENAME = 0x0200;
+}
@@ -0,0 +1,717 @@
+// \brief
+//		dbghelp style type queries on top of FPdbReader.
+//
+
+#include "WinPdbTypeSource.h"
+
+#include <cstring>
+#include <algorithm>
+
+
+FPdbSymTypeSource::FPdbSymTypeSource(const FPdbReader &InReader)
+	: Reader(InReader)
+{
+}
+
+uint32_t FPdbSymTypeSource::ResolveType(uint32_t TypeIndex) const
+{
+	// const/volatile chains are short, bound them anyway.
+	for (int32_t Depth = 0; Depth < 8; Depth++)
+	{
+		FPdbTypeInfo Info;
+		if (!Reader.GetTypeInfo(TypeIndex, Info) || Info.Kind != NSCodeView::LF_MODIFIER)
+		{
+			break;
+		}
+		TypeIndex = Info.ElementType;
+	} // end for Depth
+
+	return Reader.ResolveForwardRef(TypeIndex);
+}
+
+uint32_t FPdbSymTypeSource::GetSymTag(uint32_t TypeIndex) const
+{
+	using namespace NSCodeView;
+
+	if (FPdbReader::IsSimpleType(TypeIndex))
+	{
+		return GetSimpleSymTag(TypeIndex);
+	}
+
+	FPdbTypeInfo Info;
+	if (!Reader.GetTypeInfo(TypeIndex, Info))
+	{
+		return SymTagNull;
+	}
+
+	switch (Info.Kind)
+	{
+	case LF_POINTER:
+		return SymTagPointerType;
+	case LF_ARRAY:
+		return SymTagArrayType;
+	case LF_CLASS:
+	case LF_STRUCTURE:
+	case LF_INTERFACE:
+	case LF_UNION:
+		return SymTagUDT;
+	case LF_ENUM:
+		return SymTagEnum;
+	case LF_PROCEDURE:
+	case LF_MFUNCTION:
+		return SymTagFunctionType;
+	case LF_BITFIELD:
+		return GetSymTag(ResolveType(Info.ElementType));
+	default:
+		return SymTagNull;
+	}
+}
+
+uint32_t FPdbSymTypeSource::GetBaseType(uint32_t TypeIndex) const
+{
+	FPdbTypeInfo Info;
+	if (!FPdbReader::IsSimpleType(TypeIndex))
+	{
+		// enums and bit fields report the base type of their underlying type
+		if (!Reader.GetTypeInfo(TypeIndex, Info) || (Info.Kind != NSCodeView::LF_ENUM && Info.Kind != NSCodeView::LF_BITFIELD))
+		{
+			return btNoType;
+		}
+		TypeIndex = Info.ElementType;
+	}
+
+	return GetSimpleBaseType(TypeIndex);
+}
+
+uint32_t FPdbSymTypeSource::GetSimpleSymTag(uint32_t TypeIndex)
+{
+	return (TypeIndex & 0xF00) ? SymTagPointerType : SymTagBaseType;
+}
+
+uint32_t FPdbSymTypeSource::GetSimpleBaseType(uint32_t TypeIndex)
+{
+	switch (TypeIndex & 0xFF)
+	{
+	case 0x03:
+		return btVoid;
+	case 0x10: case 0x70: case 0x68:
+		return btChar;
+	case 0x71: case 0x7A:
+		return btWChar;
+	case 0x11: case 0x72: case 0x74: case 0x13: case 0x76: case 0x14: case 0x78:
+		return btInt;
+	case 0x20: case 0x69: case 0x7C: case 0x21: case 0x73: case 0x75: case 0x7B: case 0x23: case 0x77: case 0x24: case 0x79:
+		return btUInt;
+	case 0x12:
+		return btLong;
+	case 0x22:
+		return btULong;
+	case 0x40: case 0x41: case 0x42: case 0x43: case 0x46:
+		return btFloat;
+	case 0x30: case 0x31: case 0x32: case 0x33:
+		return btBool;
+	case 0x08:
+		return btHresult;
+	default:
+		return btNoType;
+	}
+}
+
+uint64_t FPdbSymTypeSource::GetLength(uint32_t TypeIndex) const
+{
+	FPdbTypeInfo Info;
+	if (!Reader.GetTypeInfo(TypeIndex, Info))
+	{
+		return 0;
+	}
+
+	if (Info.Kind == NSCodeView::LF_BITFIELD)
+	{
+		return GetLength(ResolveType(Info.ElementType));
+	}
+	return Info.Size;
+}
+
+const FPdbSymTypeSource::FChildRange& FPdbSymTypeSource::GetChildren(uint32_t TypeIndex)
+{
+	using namespace NSCodeView;
+
+	std::map<uint32_t, FChildRange>::iterator FindItr = ChildRanges.find(TypeIndex);
+	if (FindItr != ChildRanges.end())
+	{
+		return FindItr->second;
+	}
+
+	FChildRange Range;
+	Range.First = (uint32_t)Children.size();
+	Range.Count = 0;
+
+	FPdbTypeInfo Info;
+	if (Reader.GetTypeInfo(TypeIndex, Info))
+	{
+		if (Info.Kind == LF_PROCEDURE || Info.Kind == LF_MFUNCTION)
+		{
+			std::vector<uint32_t> Args;
+			Reader.GetArgList(Info.FieldList, Args);
+			for (size_t k = 0; k < Args.size(); k++)
+			{
+				FChild Child = { SymTagFunctionArgType, Args[k], 0, "" };
+				Children.push_back(Child);
+			} // end for k
+		}
+		else if (Info.FieldList)
+		{
+			std::vector<FPdbFieldInfo> Fields;
+			Reader.GetFieldList(Info.FieldList, Fields);
+			for (size_t k = 0; k < Fields.size(); k++)
+			{
+				const FPdbFieldInfo &Field = Fields[k];
+
+				// static members have no offset, methods and nested types are not data.
+				FChild Child = { SymTagNull, Field.TypeIndex, Field.Value, Field.Name };
+				switch (Field.Kind)
+				{
+				case LF_MEMBER:
+				case LF_ENUMERATE:
+					Child.Tag = SymTagData;
+					break;
+				case LF_BCLASS:
+					{
+						FPdbTypeInfo BaseInfo;
+						Reader.GetTypeInfo(Field.TypeIndex, BaseInfo);
+						Child.Tag = SymTagBaseClass;
+						Child.Name = BaseInfo.Name;
+					}
+					break;
+				default:
+					break;
+				}
+
+				if (Child.Tag != SymTagNull)
+				{
+					Children.push_back(Child);
+				}
+			} // end for k
+		}
+	}
+
+	Range.Count = (uint32_t)Children.size() - Range.First;
+	return ChildRanges.insert(std::make_pair(TypeIndex, Range)).first->second;
+}
+
+BOOL FPdbSymTypeSource::CopyName(const char *InName, PVOID pInfo)
+{
+	if (!InName || !*InName)
+	{
+		return FALSE;
+	}
+
+	const int32_t Chars = MultiByteToWideChar(CP_UTF8, 0, InName, -1, NULL, 0);
+	WCHAR *pName = (WCHAR *)LocalAlloc(LMEM_FIXED, Chars * sizeof(WCHAR));
+	if (!pName)
+	{
+		return FALSE;
+	}
+
+	MultiByteToWideChar(CP_UTF8, 0, InName, -1, pName, Chars);
+	*(WCHAR **)pInfo = pName;
+	return TRUE;
+}
+
+BOOL FPdbSymTypeSource::GetChildInfo(uint32_t ChildId, IMAGEHLP_SYMBOL_TYPE_INFO GetType, PVOID pInfo)
+{
+	FChild Child;
+	{
+		std::lock_guard<std::mutex> Guard(ChildLock);
+
+		const uint32_t Index = ChildId & ~kChildIdFlag;
+		if (Index >= Children.size())
+		{
+			return FALSE;
+		}
+		Child = Children[Index];
+	}
+
+	switch (GetType)
+	{
+	case TI_GET_SYMTAG:
+		*(DWORD *)pInfo = Child.Tag;
+		return TRUE;
+	case TI_GET_SYMNAME:
+		return CopyName(Child.Name, pInfo);
+	case TI_GET_TYPE:
+	case TI_GET_TYPEID:
+		if (!Child.TypeIndex)
+		{
+			return FALSE;
+		}
+		*(DWORD *)pInfo = ResolveType(Child.TypeIndex);
+		return TRUE;
+	case TI_GET_LENGTH:
+		*(ULONG64 *)pInfo = GetLength(ResolveType(Child.TypeIndex));
+		return TRUE;
+	case TI_GET_OFFSET:
+		if (Child.Tag == SymTagFunctionArgType)
+		{
+			return FALSE;
+		}
+		*(DWORD *)pInfo = (DWORD)Child.Value;
+		return TRUE;
+	case TI_GET_VALUE:
+		{
+			VARIANT *pValue = (VARIANT *)pInfo;
+			memset(pValue, 0, sizeof(VARIANT));
+			pValue->vt = VT_I8;
+			pValue->llVal = (LONGLONG)Child.Value;
+		}
+		return TRUE;
+	case TI_GET_CHILDRENCOUNT:
+		*(DWORD *)pInfo = 0;
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+BOOL FPdbSymTypeSource::GetTypeInfo(uint32_t TypeId, IMAGEHLP_SYMBOL_TYPE_INFO GetType, PVOID pInfo)
+{
+	if (IsChildId(TypeId))
+	{
+		return GetChildInfo(TypeId, GetType, pInfo);
+	}
+
+	const uint32_t TypeIndex = ResolveType(TypeId);
+
+	FPdbTypeInfo Info;
+	if (!Reader.GetTypeInfo(TypeIndex, Info))
+	{
+		return FALSE;
+	}
+
+	switch (GetType)
+	{
+	case TI_GET_SYMTAG:
+		*(DWORD *)pInfo = GetSymTag(TypeIndex);
+		return TRUE;
+
+	case TI_GET_SYMNAME:
+		return CopyName(Info.Name, pInfo);
+
+	case TI_GET_LENGTH:
+		*(ULONG64 *)pInfo = GetLength(TypeIndex);
+		return TRUE;
+
+	case TI_GET_BASETYPE:
+		{
+			const uint32_t BaseType = GetBaseType(TypeIndex);
+			if (BaseType == btNoType)
+			{
+				return FALSE;
+			}
+			*(DWORD *)pInfo = BaseType;
+		}
+		return TRUE;
+
+	case TI_GET_TYPE:
+	case TI_GET_TYPEID:
+		if (FPdbReader::IsSimpleType(TypeIndex))
+		{
+			// simple pointer -> the pointee
+			if (!(TypeIndex & 0xF00))
+			{
+				return FALSE;
+			}
+			*(DWORD *)pInfo = TypeIndex & 0xFF;
+			return TRUE;
+		}
+		if (!Info.ElementType)
+		{
+			return FALSE;
+		}
+		*(DWORD *)pInfo = ResolveType(Info.ElementType);
+		return TRUE;
+
+	case TI_GET_IS_REFERENCE:
+		*(BOOL *)pInfo = (Info.Kind == NSCodeView::LF_POINTER && (Info.PointerMode == 1 || Info.PointerMode == 4)) ? TRUE : FALSE;
+		return TRUE;
+
+	case TI_GET_COUNT:
+		if (Info.Kind == NSCodeView::LF_ARRAY)
+		{
+			const uint64_t ElementLength = GetLength(ResolveType(Info.ElementType));
+			*(DWORD *)pInfo = ElementLength ? (DWORD)(Info.Size / ElementLength) : 0;
+			return TRUE;
+		}
+		if (Info.Kind == NSCodeView::LF_PROCEDURE || Info.Kind == NSCodeView::LF_MFUNCTION)
+		{
+			*(DWORD *)pInfo = Info.Count;
+			return TRUE;
+		}
+		return FALSE;
+
+	case TI_GET_CHILDRENCOUNT:
+		{
+			std::lock_guard<std::mutex> Guard(ChildLock);
+			*(DWORD *)pInfo = GetChildren(TypeIndex).Count;
+		}
+		return TRUE;
+
+	case TI_FINDCHILDREN:
+		{
+			TI_FINDCHILDREN_PARAMS *pFindParams = (TI_FINDCHILDREN_PARAMS *)pInfo;
+
+			std::lock_guard<std::mutex> Guard(ChildLock);
+			const FChildRange &Range = GetChildren(TypeIndex);
+			if ((uint64_t)pFindParams->Start + pFindParams->Count > Range.Count)
+			{
+				return FALSE;
+			}
+
+			for (ULONG k = 0; k < pFindParams->Count; k++)
+			{
+				pFindParams->ChildId[k] = kChildIdFlag | (Range.First + pFindParams->Start + k);
+			} // end for k
+		}
+		return TRUE;
+
+	default:
+		return FALSE;
+	}
+}
+
+uint32_t FPdbSymTypeSource::AddFlatName(std::vector<char> &InOutNames, const char *InName)
+{
+	if (!InName || !*InName)
+	{
+		return 0;
+	}
+
+	const uint32_t Offset = (uint32_t)InOutNames.size();
+	InOutNames.insert(InOutNames.end(), InName, InName + strlen(InName) + 1);
+	return Offset;
+}
+
+void FPdbSymTypeSource::FlattenSimpleType(uint32_t TypeIndex, FSymFlatType &OutType)
+{
+	memset(&OutType, 0, sizeof(OutType));
+	OutType.Flags = NSSymFlat::kFlatValid;
+	OutType.Tag = GetSimpleSymTag(TypeIndex);
+	OutType.BaseType = GetSimpleBaseType(TypeIndex);
+	OutType.Length = FPdbReader::GetSimpleTypeSize(TypeIndex);
+	// simple pointer -> the pointee
+	if (TypeIndex & 0xF00)
+	{
+		OutType.TypeId = TypeIndex & 0xFF;
+		OutType.Flags |= NSSymFlat::kFlatHasType;
+	}
+}
+
+void FPdbSymTypeSource::Flatten(FSymFlatTypes &OutTypes)
+{
+	using namespace NSCodeView;
+	using namespace NSSymFlat;
+
+	const FPdbTypeStream &TypeStream = Reader.GetTypes();
+	const uint32_t TypeIndexBegin = TypeStream.GetTypeIndexBegin();
+	const uint32_t TypeIndexEnd = TypeStream.GetTypeIndexEnd();
+
+	OutTypes.TypeIndexBegin = TypeIndexBegin;
+	OutTypes.Types.assign(TypeIndexEnd - TypeIndexBegin, FSymFlatType());
+	OutTypes.Children.clear();
+	OutTypes.Names.assign(1, '\0');
+
+	// modifiers and forward references share the children of the type they resolve to.
+	std::map<uint32_t, FChildRange> FlatRanges;
+	for (uint32_t TypeIndex = TypeIndexBegin; TypeIndex < TypeIndexEnd; TypeIndex++)
+	{
+		FSymFlatType &Flat = OutTypes.Types[TypeIndex - TypeIndexBegin];
+		memset(&Flat, 0, sizeof(Flat));
+
+		const uint32_t Resolved = ResolveType(TypeIndex);
+		FPdbTypeInfo Info;
+		if (!Reader.GetTypeInfo(Resolved, Info))
+		{
+			continue;
+		}
+
+		if (FPdbReader::IsSimpleType(Resolved))
+		{
+			FlattenSimpleType(Resolved, Flat);
+			continue;
+		}
+
+		Flat.Flags = kFlatValid;
+		Flat.Tag = GetSymTag(Resolved);
+		Flat.BaseType = GetBaseType(Resolved);
+		Flat.Length = GetLength(Resolved);
+		Flat.Name = AddFlatName(OutTypes.Names, Info.Name);
+		if (Info.ElementType)
+		{
+			Flat.TypeId = ResolveType(Info.ElementType);
+			Flat.Flags |= kFlatHasType;
+		}
+		if (Info.Kind == LF_POINTER && (Info.PointerMode == 1 || Info.PointerMode == 4))
+		{
+			Flat.Flags |= kFlatReference;
+		}
+		if (Info.Kind == LF_ARRAY)
+		{
+			const uint64_t ElementLength = GetLength(ResolveType(Info.ElementType));
+			Flat.Count = ElementLength ? (uint32_t)(Info.Size / ElementLength) : 0;
+			Flat.Flags |= kFlatHasCount;
+		}
+		else if (Info.Kind == LF_PROCEDURE || Info.Kind == LF_MFUNCTION)
+		{
+			Flat.Count = Info.Count;
+			Flat.Flags |= kFlatHasCount;
+		}
+
+		std::map<uint32_t, FChildRange>::iterator FindItr = FlatRanges.find(Resolved);
+		if (FindItr == FlatRanges.end())
+		{
+			FChildRange FlatRange;
+			FlatRange.First = (uint32_t)OutTypes.Children.size();
+
+			std::lock_guard<std::mutex> Guard(ChildLock);
+			const FChildRange &Range = GetChildren(Resolved);
+			for (uint32_t k = 0; k < Range.Count; k++)
+			{
+				const FChild &Child = Children[Range.First + k];
+
+				FSymFlatChild FlatChild;
+				FlatChild.Value = Child.Value;
+				FlatChild.Tag = Child.Tag;
+				FlatChild.TypeId = Child.TypeIndex ? ResolveType(Child.TypeIndex) : 0;
+				FlatChild.Name = AddFlatName(OutTypes.Names, Child.Name);
+				FlatChild.Padding = 0;
+				OutTypes.Children.push_back(FlatChild);
+			} // end for k
+
+			FlatRange.Count = Range.Count;
+			FindItr = FlatRanges.insert(std::make_pair(Resolved, FlatRange)).first;
+		}
+		Flat.FirstChild = FindItr->second.First;
+		Flat.ChildCount = FindItr->second.Count;
+	} // end for TypeIndex
+}
+
+
+FFlatSymTypeSource::FFlatSymTypeSource()
+	: TypeIndexBegin(0)
+	, Types(NULL)
+	, TypeCount(0)
+	, Children(NULL)
+	, ChildCount(0)
+	, Names(NULL)
+	, NameBytes(0)
+{
+}
+
+void FFlatSymTypeSource::Init(uint32_t InTypeIndexBegin, const FSymFlatType *InTypes, uint64_t InTypeCount, const FSymFlatChild *InChildren, uint64_t InChildCount,
+	const char *InNames, uint64_t InNameBytes)
+{
+	TypeIndexBegin = InTypeIndexBegin;
+	Types = InTypes;
+	TypeCount = InTypeCount;
+	Children = InChildren;
+	ChildCount = InChildCount;
+	Names = InNames;
+	NameBytes = InNameBytes;
+	NameIndex.clear();
+}
+
+bool FFlatSymTypeSource::TypeNameLess(const FTypeName &A, const FTypeName &B)
+{
+	const int32_t Order = strcmp(A.Name, B.Name);
+	if (Order != 0)
+	{
+		return Order < 0;
+	}
+	return A.bDeclaration != B.bDeclaration ? B.bDeclaration != 0 : A.TypeId < B.TypeId;
+}
+
+void FFlatSymTypeSource::BuildNameIndex()
+{
+	for (uint64_t k = 0; k < TypeCount; k++)
+	{
+		const FSymFlatType &Type = Types[k];
+		const char *Name = GetName(Type.Name);
+		if ((Type.Flags & NSSymFlat::kFlatValid) && (Type.Tag == SymTagUDT || Type.Tag == SymTagEnum) && Name && *Name)
+		{
+			FTypeName TypeName;
+			TypeName.Name = Name;
+			TypeName.TypeId = TypeIndexBegin + (uint32_t)k;
+			TypeName.bDeclaration = Type.Length == 0;
+			NameIndex.push_back(TypeName);
+		}
+	} // end for k
+	std::sort(NameIndex.begin(), NameIndex.end(), &TypeNameLess);
+}
+
+uint32_t FFlatSymTypeSource::FindType(const char *InName)
+{
+	if (NameIndex.empty())
+	{
+		BuildNameIndex();
+	}
+
+	FTypeName Key;
+	Key.Name = InName;
+	Key.TypeId = 0;
+	Key.bDeclaration = 0;
+	std::vector<FTypeName>::const_iterator Itr = std::lower_bound(NameIndex.begin(), NameIndex.end(), Key, &TypeNameLess);
+	return (Itr != NameIndex.end() && strcmp(Itr->Name, InName) == 0) ? Itr->TypeId : 0;
+}
+
+uint64_t FFlatSymTypeSource::GetLength(uint32_t TypeId) const
+{
+	if (TypeId < TypeIndexBegin)
+	{
+		return FPdbReader::GetSimpleTypeSize(TypeId);
+	}
+	return TypeId - TypeIndexBegin < TypeCount ? Types[TypeId - TypeIndexBegin].Length : 0;
+}
+
+BOOL FFlatSymTypeSource::GetChildInfo(uint32_t ChildId, IMAGEHLP_SYMBOL_TYPE_INFO GetType, PVOID pInfo) const
+{
+	const uint32_t Index = ChildId & ~kChildIdFlag;
+	if (Index >= ChildCount)
+	{
+		return FALSE;
+	}
+	const FSymFlatChild &Child = Children[Index];
+
+	switch (GetType)
+	{
+	case TI_GET_SYMTAG:
+		*(DWORD *)pInfo = Child.Tag;
+		return TRUE;
+	case TI_GET_SYMNAME:
+		return FPdbSymTypeSource::CopyName(GetName(Child.Name), pInfo);
+	case TI_GET_TYPE:
+	case TI_GET_TYPEID:
+		if (!Child.TypeId)
+		{
+			return FALSE;
+		}
+		*(DWORD *)pInfo = Child.TypeId;
+		return TRUE;
+	case TI_GET_LENGTH:
+		*(ULONG64 *)pInfo = GetLength(Child.TypeId);
+		return TRUE;
+	case TI_GET_OFFSET:
+		if (Child.Tag == SymTagFunctionArgType)
+		{
+			return FALSE;
+		}
+		*(DWORD *)pInfo = (DWORD)Child.Value;
+		return TRUE;
+	case TI_GET_VALUE:
+		{
+			VARIANT *pValue = (VARIANT *)pInfo;
+			memset(pValue, 0, sizeof(VARIANT));
+			pValue->vt = VT_I8;
+			pValue->llVal = (LONGLONG)Child.Value;
+		}
+		return TRUE;
+	case TI_GET_CHILDRENCOUNT:
+		*(DWORD *)pInfo = 0;
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+BOOL FFlatSymTypeSource::GetTypeInfo(uint32_t TypeId, IMAGEHLP_SYMBOL_TYPE_INFO GetType, PVOID pInfo)
+{
+	using namespace NSSymFlat;
+
+	if (TypeId & kChildIdFlag)
+	{
+		return GetChildInfo(TypeId, GetType, pInfo);
+	}
+
+	FSymFlatType Type;
+	if (TypeId < TypeIndexBegin)
+	{
+		FPdbSymTypeSource::FlattenSimpleType(TypeId, Type);
+	}
+	else if (TypeId - TypeIndexBegin < TypeCount)
+	{
+		Type = Types[TypeId - TypeIndexBegin];
+	}
+	else
+	{
+		return FALSE;
+	}
+
+	if (!(Type.Flags & kFlatValid))
+	{
+		return FALSE;
+	}
+
+	switch (GetType)
+	{
+	case TI_GET_SYMTAG:
+		*(DWORD *)pInfo = Type.Tag;
+		return TRUE;
+
+	case TI_GET_SYMNAME:
+		return FPdbSymTypeSource::CopyName(GetName(Type.Name), pInfo);
+
+	case TI_GET_LENGTH:
+		*(ULONG64 *)pInfo = Type.Length;
+		return TRUE;
+
+	case TI_GET_BASETYPE:
+		if (Type.BaseType == btNoType)
+		{
+			return FALSE;
+		}
+		*(DWORD *)pInfo = Type.BaseType;
+		return TRUE;
+
+	case TI_GET_TYPE:
+	case TI_GET_TYPEID:
+		if (!(Type.Flags & kFlatHasType))
+		{
+			return FALSE;
+		}
+		*(DWORD *)pInfo = Type.TypeId;
+		return TRUE;
+
+	case TI_GET_IS_REFERENCE:
+		*(BOOL *)pInfo = (Type.Flags & kFlatReference) ? TRUE : FALSE;
+		return TRUE;
+
+	case TI_GET_COUNT:
+		if (!(Type.Flags & kFlatHasCount))
+		{
+			return FALSE;
+		}
+		*(DWORD *)pInfo = Type.Count;
+		return TRUE;
+
+	case TI_GET_CHILDRENCOUNT:
+		*(DWORD *)pInfo = Type.ChildCount;
+		return TRUE;
+
+	case TI_FINDCHILDREN:
+		{
+			TI_FINDCHILDREN_PARAMS *pFindParams = (TI_FINDCHILDREN_PARAMS *)pInfo;
+			if ((uint64_t)pFindParams->Start + pFindParams->Count > Type.ChildCount || (uint64_t)Type.FirstChild + Type.ChildCount > ChildCount)
+			{
+				return FALSE;
+			}
+
+			for (ULONG k = 0; k < pFindParams->Count; k++)
+			{
+				pFindParams->ChildId[k] = kChildIdFlag | (Type.FirstChild + pFindParams->Start + k);
+			} // end for k
+		}
+		return TRUE;
+
+	default:
+		return FALSE;
+	}
+}
@@ -0,0 +1,151 @@
+// \brief
+//		answer dbghelp style type queries from FPdbReader, so the FSymTypeInfo classes can be built
+//		without dbghelp. type ids are the PDB type indices, members and parameters get synthesized ids.
+//
+
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "WinPdbReader.h"
+#include "WinVariableTypeHelper.h"
+
+
+// the answers for one type id, the form the symbol cache stores types in.
+struct FSymFlatType
+{
+	uint64_t		Length;
+	uint32_t		Tag;
+	uint32_t		BaseType;		// btNoType if none
+	uint32_t		TypeId;			// TI_GET_TYPE, if kFlatHasType
+	uint32_t		Count;			// TI_GET_COUNT, if kFlatHasCount
+	uint32_t		Name;			// offset in the name pool, 0 is the empty name
+	uint32_t		FirstChild;
+	uint32_t		ChildCount;
+	uint32_t		Flags;			// kFlatxxx
+};
+
+struct FSymFlatChild
+{
+	uint64_t		Value;			// offset, or value of an enumerator
+	uint32_t		Tag;
+	uint32_t		TypeId;			// 0 if none
+	uint32_t		Name;
+	uint32_t		Padding;
+};
+
+// a type stream flattened, indexed by type index - TypeIndexBegin.
+struct FSymFlatTypes
+{
+	uint32_t					TypeIndexBegin;
+	std::vector<FSymFlatType>	Types;
+	std::vector<FSymFlatChild>	Children;
+	std::vector<char>			Names;
+};
+
+namespace NSSymFlat
+{
+	const uint32_t kFlatValid       = 0x1;
+	const uint32_t kFlatReference   = 0x2;
+	const uint32_t kFlatHasCount    = 0x4;
+	const uint32_t kFlatHasType     = 0x8;
+}
+
+
+class FPdbSymTypeSource : public FSymTypeSource
+{
+public:
+	// InReader must outlive the source.
+	explicit FPdbSymTypeSource(const FPdbReader &InReader);
+
+	virtual BOOL GetTypeInfo(uint32_t TypeId, IMAGEHLP_SYMBOL_TYPE_INFO GetType, PVOID pInfo) override;
+
+	// every type of the TPI stream, with the answers this source would give.
+	void Flatten(FSymFlatTypes &OutTypes);
+	// built-in types need no records
+	static void FlattenSimpleType(uint32_t TypeIndex, FSymFlatType &OutType);
+	static BOOL CopyName(const char *InName, PVOID pInfo);
+
+protected:
+	// member, base class, enumerator or parameter
+	struct FChild
+	{
+		uint32_t		Tag;
+		uint32_t		TypeIndex;
+		uint64_t		Value;
+		const char		*Name;
+	};
+
+	struct FChildRange
+	{
+		uint32_t		First;
+		uint32_t		Count;
+	};
+
+	static bool IsChildId(uint32_t TypeId) { return (TypeId & kChildIdFlag) != 0; }
+
+	BOOL GetChildInfo(uint32_t ChildId, IMAGEHLP_SYMBOL_TYPE_INFO GetType, PVOID pInfo);
+	// skip modifiers and forward declarations
+	uint32_t ResolveType(uint32_t TypeIndex) const;
+	uint32_t GetSymTag(uint32_t TypeIndex) const;
+	uint32_t GetBaseType(uint32_t TypeIndex) const;
+	uint64_t GetLength(uint32_t TypeIndex) const;
+	const FChildRange& GetChildren(uint32_t TypeIndex);
+
+	static uint32_t GetSimpleSymTag(uint32_t TypeIndex);
+	static uint32_t GetSimpleBaseType(uint32_t TypeIndex);
+	static uint32_t AddFlatName(std::vector<char> &InOutNames, const char *InName);
+
+	static const uint32_t kChildIdFlag = 0x80000000;
+
+	const FPdbReader				&Reader;
+
+	std::mutex						ChildLock;
+	std::vector<FChild>				Children;
+	std::map<uint32_t, FChildRange>	ChildRanges;
+};
+
+// answers type queries from flattened types, e.g. the arrays of a mapped symbol cache file.
+// type and child ids are the same as the FPdbSymTypeSource the types were flattened from.
+class FFlatSymTypeSource : public FSymTypeSource
+{
+public:
+	FFlatSymTypeSource();
+
+	// the arrays must outlive the source, the name pool ends with a terminator.
+	void Init(uint32_t InTypeIndexBegin, const FSymFlatType *InTypes, uint64_t InTypeCount, const FSymFlatChild *InChildren, uint64_t InChildCount,
+		const char *InNames, uint64_t InNameBytes);
+	bool IsEmpty() const { return TypeCount == 0; }
+	// a UDT or enum by its name, 0 if there is none. the name index is built on the first call.
+	uint32_t FindType(const char *InName);
+
+	virtual BOOL GetTypeInfo(uint32_t TypeId, IMAGEHLP_SYMBOL_TYPE_INFO GetType, PVOID pInfo) override;
+
+protected:
+	struct FTypeName
+	{
+		const char		*Name;
+		uint32_t		TypeId;
+		uint32_t		bDeclaration;	// a forward reference without definition
+	};
+
+	static bool TypeNameLess(const FTypeName &A, const FTypeName &B);
+	void BuildNameIndex();
+	BOOL GetChildInfo(uint32_t ChildId, IMAGEHLP_SYMBOL_TYPE_INFO GetType, PVOID pInfo) const;
+	const char* GetName(uint32_t InOffset) const { return InOffset < NameBytes ? Names + InOffset : NULL; }
+	uint64_t GetLength(uint32_t TypeId) const;
+
+	static const uint32_t kChildIdFlag = 0x80000000;
+
+	uint32_t				TypeIndexBegin;
+	const FSymFlatType		*Types;
+	uint64_t				TypeCount;
+	const FSymFlatChild		*Children;
+	uint64_t				ChildCount;
+	const char				*Names;
+	uint64_t				NameBytes;
+
+	std::vector<FTypeName>	NameIndex;		// by name, definitions first
+};
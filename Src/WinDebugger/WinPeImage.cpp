@@ -0,0 +1,624 @@
+// \brief
+//		portable PE/COFF image parser.
+//
+
+#include "WinPeImage.h"
+#include "WinRemoteMemory.h"
+
+#include <cstring>
+
+
+static const uint32_t kRemoteHeaderBytes = 0x1000;
+static const uint32_t kMaxSections = 96;
+static const uint32_t kMaxDirectories = 16;
+
+static const uint32_t kCodeViewType = 2;
+static const uint32_t kRsdsSignature = 0x53445352; // 'RSDS'
+
+static inline uint16_t ReadU16(const uint8_t *InPtr)
+{
+	uint16_t Value;
+	memcpy(&Value, InPtr, sizeof(Value));
+	return Value;
+}
+
+static inline uint32_t ReadU32(const uint8_t *InPtr)
+{
+	uint32_t Value;
+	memcpy(&Value, InPtr, sizeof(Value));
+	return Value;
+}
+
+static inline uint64_t ReadU64(const uint8_t *InPtr)
+{
+	uint64_t Value;
+	memcpy(&Value, InPtr, sizeof(Value));
+	return Value;
+}
+
+FPeImage::FPeImage()
+	: bRemote(false)
+	, RemoteBase(0)
+	, Machine(0)
+	, Characteristics(0)
+	, b64Bit(false)
+	, TimeDateStamp(0)
+	, ImageBase(0)
+	, SizeOfImage(0)
+	, SizeOfHeaders(0)
+	, EntryPointRva(0)
+{
+}
+
+void FPeImage::Close()
+{
+	File.Close();
+	bRemote = false;
+	RemoteBase = 0;
+	RemoteCopies.clear();
+	Views.clear();
+	Sections.clear();
+	Directories.clear();
+
+	Machine = 0;
+	Characteristics = 0;
+	b64Bit = false;
+	TimeDateStamp = 0;
+	ImageBase = 0;
+	SizeOfImage = 0;
+	SizeOfHeaders = 0;
+	EntryPointRva = 0;
+}
+
+// DOS header, PE signature, file header, optional header, section table. InData is the image start.
+bool FPeImage::ParseHeaders(const uint8_t *InData, uint64_t InSize)
+{
+	if (InSize < 0x40 || InData[0] != 'M' || InData[1] != 'Z')
+	{
+		return false;
+	}
+
+	const uint32_t NtOffset = ReadU32(InData + 0x3C);
+	if ((uint64_t)NtOffset + 24 > InSize || memcmp(InData + NtOffset, "PE\0\0", 4) != 0)
+	{
+		return false;
+	}
+
+	// file header
+	const uint8_t *FileHeader = InData + NtOffset + 4;
+	const uint16_t NumSections = ReadU16(FileHeader + 2);
+	const uint16_t OptionalHeaderSize = ReadU16(FileHeader + 16);
+	const uint64_t OptionalOffset = (uint64_t)NtOffset + 24;
+	if (NumSections > kMaxSections || OptionalOffset + OptionalHeaderSize > InSize || OptionalHeaderSize < 2)
+	{
+		return false;
+	}
+
+	// optional header
+	const uint8_t *Optional = InData + OptionalOffset;
+	const uint16_t Magic = ReadU16(Optional);
+	if (Magic != 0x10B && Magic != 0x20B)
+	{
+		return false;
+	}
+
+	const bool bIs64Bit = Magic == 0x20B;
+	const uint32_t DirectoryOffset = bIs64Bit ? 112 : 96;
+	if (OptionalHeaderSize < DirectoryOffset)
+	{
+		return false;
+	}
+
+	SizeOfHeaders = ReadU32(Optional + 60);
+
+	// the section table may end past the bytes we have, the caller reads more and retries.
+	const uint64_t SectionOffset = OptionalOffset + OptionalHeaderSize;
+	if (SectionOffset + (uint64_t)NumSections * 40 > InSize)
+	{
+		return false;
+	}
+
+	uint32_t NumDirectories = ReadU32(Optional + (bIs64Bit ? 108 : 92));
+	NumDirectories = NumDirectories > kMaxDirectories ? kMaxDirectories : NumDirectories;
+	if (DirectoryOffset + NumDirectories * 8 > OptionalHeaderSize)
+	{
+		return false;
+	}
+
+	Directories.resize(NumDirectories * 2);
+	for (uint32_t k = 0; k < NumDirectories * 2; k++)
+	{
+		Directories[k] = ReadU32(Optional + DirectoryOffset + k * 4);
+	} // end for k
+
+	Sections.resize(NumSections);
+	for (uint32_t k = 0; k < NumSections; k++)
+	{
+		const uint8_t *Header = InData + SectionOffset + k * 40;
+		FPeSection &Section = Sections[k];
+
+		memcpy(Section.Name, Header, 8);
+		Section.Name[8] = '\0';
+		Section.VirtualSize = ReadU32(Header + 8);
+		Section.VirtualAddress = ReadU32(Header + 12);
+		Section.RawSize = ReadU32(Header + 16);
+		Section.RawOffset = ReadU32(Header + 20);
+		Section.Characteristics = ReadU32(Header + 36);
+	} // end for k
+
+	Machine = ReadU16(FileHeader);
+	TimeDateStamp = ReadU32(FileHeader + 4);
+	Characteristics = ReadU16(FileHeader + 18);
+	b64Bit = bIs64Bit;
+	EntryPointRva = ReadU32(Optional + 16);
+	ImageBase = bIs64Bit ? ReadU64(Optional + 24) : ReadU32(Optional + 28);
+	SizeOfImage = ReadU32(Optional + 56);
+	return Machine != 0;
+}
+
+void FPeImage::AddView(uint32_t InRva, const uint8_t *InData, uint32_t InSize)
+{
+	if (InSize)
+	{
+		FView View = { InRva, InSize, InData };
+		Views.push_back(View);
+	}
+}
+
+bool FPeImage::OpenFile(const std::wstring &InFilename)
+{
+	Close();
+
+	if (!File.Open(InFilename) || !OpenLayout(File.GetData(), File.GetSize(), false))
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+bool FPeImage::OpenMemory(const uint8_t *InData, uint64_t InSize, bool bInLoadedLayout)
+{
+	Close();
+
+	if (!OpenLayout(InData, InSize, bInLoadedLayout))
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+bool FPeImage::OpenLayout(const uint8_t *InData, uint64_t InSize, bool bInLoadedLayout)
+{
+	if (!ParseHeaders(InData, InSize))
+	{
+		return false;
+	}
+
+	if (bInLoadedLayout)
+	{
+		AddView(0, InData, (uint32_t)(InSize < SizeOfImage ? InSize : SizeOfImage));
+		return true;
+	}
+
+	AddView(0, InData, (uint32_t)(InSize < SizeOfHeaders ? InSize : SizeOfHeaders));
+	for (size_t k = 0; k < Sections.size(); k++)
+	{
+		const FPeSection &Section = Sections[k];
+		if (Section.RawOffset >= InSize)
+		{
+			continue;
+		}
+
+		// raw data is file aligned, it may run past the section's virtual size.
+		uint64_t Bytes = Section.VirtualSize && Section.VirtualSize < Section.RawSize ? Section.VirtualSize : Section.RawSize;
+		Bytes = Bytes < InSize - Section.RawOffset ? Bytes : InSize - Section.RawOffset;
+		AddView(Section.VirtualAddress, InData + Section.RawOffset, (uint32_t)Bytes);
+	} // end for k
+	return true;
+}
+
+bool FPeImage::OpenRemote(FRemoteMemory &InMemory, uint64_t InImageBase)
+{
+	Close();
+
+	bRemote = true;
+	RemoteBase = InImageBase;
+
+	std::vector<uint8_t> Headers(kRemoteHeaderBytes);
+	if (!InMemory.ReadMemory(InImageBase, &Headers[0], Headers.size()))
+	{
+		Close();
+		return false;
+	}
+
+	if (!ParseHeaders(&Headers[0], Headers.size()))
+	{
+		// headers larger than a page
+		if (SizeOfHeaders <= kRemoteHeaderBytes || SizeOfHeaders > 0x100000)
+		{
+			Close();
+			return false;
+		}
+
+		Headers.resize(SizeOfHeaders);
+		if (!InMemory.ReadMemory(InImageBase, &Headers[0], Headers.size()) || !ParseHeaders(&Headers[0], Headers.size()))
+		{
+			Close();
+			return false;
+		}
+	}
+
+	const uint32_t HeaderBytes = (uint32_t)Headers.size();
+	RemoteCopies.push_back(std::vector<uint8_t>());
+	RemoteCopies.back().swap(Headers);
+	AddView(0, &RemoteCopies.back()[0], HeaderBytes);
+	return true;
+}
+
+bool FPeImage::ReadRemoteRange(FRemoteMemory &InMemory, uint32_t InRva, uint32_t InSize)
+{
+	if (!bRemote || InSize == 0 || (uint64_t)InRva + InSize > SizeOfImage)
+	{
+		return false;
+	}
+	if (RvaToData(InRva, InSize))
+	{
+		return true;
+	}
+
+	std::vector<uint8_t> Bytes(InSize);
+	if (!InMemory.ReadMemory(RemoteBase + InRva, &Bytes[0], InSize))
+	{
+		return false;
+	}
+
+	RemoteCopies.push_back(std::vector<uint8_t>());
+	RemoteCopies.back().swap(Bytes);
+	AddView(InRva, &RemoteCopies.back()[0], InSize);
+	return true;
+}
+
+bool FPeImage::ReadRemoteDirectory(FRemoteMemory &InMemory, uint32_t InDirectory)
+{
+	uint32_t Rva = 0, Size = 0;
+	return GetDataDirectory(InDirectory, Rva, Size) && ReadRemoteRange(InMemory, Rva, Size);
+}
+
+bool FPeImage::ReadRemoteDebugData(FRemoteMemory &InMemory)
+{
+	uint32_t DirRva = 0, DirSize = 0;
+	if (!GetDataDirectory(NSPeImage::DIRECTORY_DEBUG, DirRva, DirSize) || !ReadRemoteRange(InMemory, DirRva, DirSize))
+	{
+		return false;
+	}
+
+	for (uint32_t k = 0; k < DirSize / 28; k++)
+	{
+		const uint8_t *Entry = RvaToData(DirRva + k * 28, 28);
+		const uint32_t DataSize = ReadU32(Entry + 16);
+		const uint32_t DataRva = ReadU32(Entry + 20);
+		if (DataRva && DataSize)
+		{
+			ReadRemoteRange(InMemory, DataRva, DataSize);
+		}
+	} // end for k
+	return true;
+}
+
+const FPeSection* FPeImage::FindSection(uint32_t InRva) const
+{
+	for (size_t k = 0; k < Sections.size(); k++)
+	{
+		const FPeSection &Section = Sections[k];
+		const uint32_t Size = Section.VirtualSize ? Section.VirtualSize : Section.RawSize;
+		if (InRva >= Section.VirtualAddress && InRva - Section.VirtualAddress < Size)
+		{
+			return &Section;
+		}
+	} // end for k
+	return NULL;
+}
+
+bool FPeImage::GetDataDirectory(uint32_t InDirectory, uint32_t &OutRva, uint32_t &OutSize) const
+{
+	if ((size_t)InDirectory * 2 + 1 >= Directories.size())
+	{
+		return false;
+	}
+
+	OutRva = Directories[InDirectory * 2];
+	OutSize = Directories[InDirectory * 2 + 1];
+	return OutRva != 0 && OutSize != 0;
+}
+
+const uint8_t* FPeImage::RvaToData(uint32_t InRva, uint32_t InSize) const
+{
+	for (size_t k = 0; k < Views.size(); k++)
+	{
+		const FView &View = Views[k];
+		if (InRva >= View.Rva && InRva - View.Rva <= View.Size && InSize <= View.Size - (InRva - View.Rva))
+		{
+			return View.Data + (InRva - View.Rva);
+		}
+	} // end for k
+	return NULL;
+}
+
+const char* FPeImage::RvaToString(uint32_t InRva) const
+{
+	for (size_t k = 0; k < Views.size(); k++)
+	{
+		const FView &View = Views[k];
+		if (InRva >= View.Rva && InRva - View.Rva < View.Size)
+		{
+			const uint8_t *String = View.Data + (InRva - View.Rva);
+			return memchr(String, 0, View.Size - (InRva - View.Rva)) ? (const char *)String : NULL;
+		}
+	} // end for k
+	return NULL;
+}
+
+bool FPeImage::GetExports(std::vector<FPeExport> &OutExports, const char **OutModuleName) const
+{
+	uint32_t DirRva = 0, DirSize = 0;
+	const uint8_t *Dir = NULL;
+	if (!GetDataDirectory(NSPeImage::DIRECTORY_EXPORT, DirRva, DirSize) || !(Dir = RvaToData(DirRva, 40)))
+	{
+		return false;
+	}
+
+	const uint32_t OrdinalBase = ReadU32(Dir + 16);
+	const uint32_t NumFunctions = ReadU32(Dir + 20);
+	const uint32_t NumNames = ReadU32(Dir + 24);
+	// ordinals are 16 bits
+	if (NumFunctions > 0x10000 || NumNames > NumFunctions)
+	{
+		return false;
+	}
+
+	const uint8_t *Functions = RvaToData(ReadU32(Dir + 28), NumFunctions * 4);
+	const uint8_t *Names = RvaToData(ReadU32(Dir + 32), NumNames * 4);
+	const uint8_t *NameOrdinals = RvaToData(ReadU32(Dir + 36), NumNames * 2);
+	if ((NumFunctions && !Functions) || (NumNames && (!Names || !NameOrdinals)))
+	{
+		return false;
+	}
+
+	if (OutModuleName)
+	{
+		*OutModuleName = RvaToString(ReadU32(Dir + 12));
+	}
+
+	std::vector<const char*> FunctionNames(NumFunctions, (const char*)NULL);
+	for (uint32_t k = 0; k < NumNames; k++)
+	{
+		const uint16_t Index = ReadU16(NameOrdinals + k * 2);
+		if (Index < NumFunctions)
+		{
+			FunctionNames[Index] = RvaToString(ReadU32(Names + k * 4));
+		}
+	} // end for k
+
+	for (uint32_t k = 0; k < NumFunctions; k++)
+	{
+		const uint32_t Rva = ReadU32(Functions + k * 4);
+		if (!Rva)
+		{
+			continue;
+		}
+
+		FPeExport Export;
+		Export.Name = FunctionNames[k];
+		Export.Ordinal = OrdinalBase + k;
+		Export.Rva = Rva;
+		// an address inside the export directory is a forwarder string
+		Export.Forwarder = (Rva >= DirRva && Rva - DirRva < DirSize) ? RvaToString(Rva) : NULL;
+		OutExports.push_back(Export);
+	} // end for k
+
+	return true;
+}
+
+bool FPeImage::GetImports(std::vector<FPeImport> &OutImports) const
+{
+	uint32_t DirRva = 0, DirSize = 0;
+	if (!GetDataDirectory(NSPeImage::DIRECTORY_IMPORT, DirRva, DirSize))
+	{
+		return false;
+	}
+
+	const uint32_t ThunkSize = b64Bit ? 8 : 4;
+	const uint64_t OrdinalFlag = b64Bit ? 0x8000000000000000ull : 0x80000000ull;
+
+	for (uint32_t DescRva = DirRva; ; DescRva += 20)
+	{
+		const uint8_t *Desc = RvaToData(DescRva, 20);
+		if (!Desc)
+		{
+			return false;
+		}
+
+		const uint32_t LookupRva = ReadU32(Desc);
+		const uint32_t NameRva = ReadU32(Desc + 12);
+		const uint32_t IatRva = ReadU32(Desc + 16);
+		if (!NameRva && !IatRva)
+		{
+			break;
+		}
+
+		const char *ModuleName = RvaToString(NameRva);
+		// bound imports overwrite the IAT, the lookup table keeps the names.
+		const uint32_t ThunkRva = LookupRva ? LookupRva : IatRva;
+		for (uint32_t k = 0; ; k++)
+		{
+			const uint8_t *Thunk = RvaToData(ThunkRva + k * ThunkSize, ThunkSize);
+			if (!Thunk)
+			{
+				break;
+			}
+
+			const uint64_t Value = b64Bit ? ReadU64(Thunk) : ReadU32(Thunk);
+			if (!Value)
+			{
+				break;
+			}
+
+			FPeImport Import;
+			Import.ModuleName = ModuleName;
+			Import.IatRva = IatRva + k * ThunkSize;
+			if (Value & OrdinalFlag)
+			{
+				Import.Name = NULL;
+				Import.Ordinal = (uint32_t)(Value & 0xFFFF);
+			}
+			else
+			{
+				const uint8_t *HintName = RvaToData((uint32_t)Value, 2);
+				Import.Ordinal = HintName ? ReadU16(HintName) : 0;
+				Import.Name = RvaToString((uint32_t)Value + 2);
+			}
+			OutImports.push_back(Import);
+		} // end for k
+	} // end for DescRva
+
+	return true;
+}
+
+bool FPeImage::GetCodeView(FPeCodeView &OutCodeView) const
+{
+	uint32_t DirRva = 0, DirSize = 0;
+	if (!GetDataDirectory(NSPeImage::DIRECTORY_DEBUG, DirRva, DirSize))
+	{
+		return false;
+	}
+
+	for (uint32_t k = 0; k < DirSize / 28; k++)
+	{
+		const uint8_t *Entry = RvaToData(DirRva + k * 28, 28);
+		if (!Entry || ReadU32(Entry + 12) != kCodeViewType)
+		{
+			continue;
+		}
+
+		const uint32_t DataSize = ReadU32(Entry + 16);
+		const uint8_t *Data = RvaToData(ReadU32(Entry + 20), DataSize);
+		if (!Data || DataSize < 25 || ReadU32(Data) != kRsdsSignature || !memchr(Data + 24, 0, DataSize - 24))
+		{
+			continue;
+		}
+
+		memcpy(&OutCodeView.Guid, Data + 4, sizeof(OutCodeView.Guid));
+		OutCodeView.Age = ReadU32(Data + 20);
+		OutCodeView.PdbPath = (const char *)(Data + 24);
+		return true;
+	} // end for k
+
+	return false;
+}
+
+uint32_t FPeImage::GetRuntimeFunctionCount() const
+{
+	uint32_t DirRva = 0, DirSize = 0;
+	return GetDataDirectory(NSPeImage::DIRECTORY_EXCEPTION, DirRva, DirSize) ? DirSize / 12 : 0;
+}
+
+bool FPeImage::GetRuntimeFunction(uint32_t InIndex, FPeRuntimeFunction &OutFunction) const
+{
+	uint32_t DirRva = 0, DirSize = 0;
+	const uint8_t *Entry = NULL;
+	if (!GetDataDirectory(NSPeImage::DIRECTORY_EXCEPTION, DirRva, DirSize) || InIndex >= DirSize / 12
+		|| !(Entry = RvaToData(DirRva + InIndex * 12, 12)))
+	{
+		return false;
+	}
+
+	OutFunction.BeginRva = ReadU32(Entry);
+	OutFunction.EndRva = ReadU32(Entry + 4);
+	OutFunction.UnwindInfoRva = ReadU32(Entry + 8);
+	return true;
+}
+
+bool FPeImage::FindRuntimeFunction(uint32_t InRva, FPeRuntimeFunction &OutFunction) const
+{
+	// last entry starting at or below InRva
+	uint32_t Low = 0, High = GetRuntimeFunctionCount();
+	FPeRuntimeFunction Function;
+	while (Low < High)
+	{
+		const uint32_t Middle = (Low + High) / 2;
+		if (!GetRuntimeFunction(Middle, Function))
+		{
+			return false;
+		}
+
+		if (Function.BeginRva <= InRva)
+		{
+			Low = Middle + 1;
+		}
+		else
+		{
+			High = Middle;
+		}
+	} // end while
+
+	if (Low == 0 || !GetRuntimeFunction(Low - 1, Function) || InRva >= Function.EndRva)
+	{
+		return false;
+	}
+
+	OutFunction = Function;
+	return true;
+}
+
+bool FPeImage::GetUnwindInfo(uint32_t InUnwindInfoRva, FPeUnwindInfo &OutInfo) const
+{
+	using namespace NSPeImage;
+
+	const uint8_t *Header = RvaToData(InUnwindInfoRva, 4);
+	if (!Header)
+	{
+		return false;
+	}
+
+	memset(&OutInfo, 0, sizeof(OutInfo));
+	OutInfo.Version = Header[0] & 0x7;
+	OutInfo.Flags = Header[0] >> 3;
+	OutInfo.PrologSize = Header[1];
+	OutInfo.CodeCount = Header[2];
+	OutInfo.FrameRegister = Header[3] & 0xF;
+	OutInfo.FrameOffset = Header[3] >> 4;
+
+	// codes are padded to an even count
+	const uint32_t CodeBytes = ((OutInfo.CodeCount + 1) & ~1u) * 2;
+	OutInfo.Codes = RvaToData(InUnwindInfoRva + 4, CodeBytes);
+	if (!OutInfo.Codes)
+	{
+		return false;
+	}
+
+	const uint32_t TailRva = InUnwindInfoRva + 4 + CodeBytes;
+	if (OutInfo.Flags & UNW_FLAG_CHAININFO)
+	{
+		const uint8_t *Chained = RvaToData(TailRva, 12);
+		if (!Chained)
+		{
+			return false;
+		}
+		OutInfo.Chained.BeginRva = ReadU32(Chained);
+		OutInfo.Chained.EndRva = ReadU32(Chained + 4);
+		OutInfo.Chained.UnwindInfoRva = ReadU32(Chained + 8);
+	}
+	else if (OutInfo.Flags & (UNW_FLAG_EHANDLER | UNW_FLAG_UHANDLER))
+	{
+		const uint8_t *Handler = RvaToData(TailRva, 4);
+		if (!Handler)
+		{
+			return false;
+		}
+		OutInfo.HandlerRva = ReadU32(Handler);
+	}
+
+	return true;
+}
@@ -0,0 +1,183 @@
+// \brief
+//		portable PE/COFF image parser: headers, sections, exports, imports, .pdata/.xdata unwind records
+//		and the CodeView debug record. it reads in place from a mapped file, from a copy of a loaded
+//		image, or from ranges of a debuggee module read on demand.
+//
+// ref: https://learn.microsoft.com/en-us/windows/win32/debug/pe-format
+//
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "Foundation/AppMappedFile.h"
+#include "WinPdbReader.h"
+
+class FRemoteMemory;
+
+
+struct FPeSection
+{
+	char			Name[9];
+	uint32_t		VirtualAddress;
+	uint32_t		VirtualSize;
+	uint32_t		RawOffset;
+	uint32_t		RawSize;
+	uint32_t		Characteristics;
+};
+
+struct FPeExport
+{
+	const char		*Name;			// NULL if exported by ordinal only
+	uint32_t		Ordinal;
+	uint32_t		Rva;
+	const char		*Forwarder;		// "dll.name" if forwarded, Rva is then meaningless
+};
+
+struct FPeImport
+{
+	const char		*ModuleName;
+	const char		*Name;			// NULL if imported by ordinal
+	uint32_t		Ordinal;		// or hint for imports by name
+	uint32_t		IatRva;			// slot the loader fills
+};
+
+// .pdata entry, x64 RUNTIME_FUNCTION
+struct FPeRuntimeFunction
+{
+	uint32_t		BeginRva;
+	uint32_t		EndRva;
+	uint32_t		UnwindInfoRva;
+};
+
+// .xdata UNWIND_INFO
+struct FPeUnwindInfo
+{
+	uint8_t				Version;
+	uint8_t				Flags;			// UNW_FLAG_xxx
+	uint8_t				PrologSize;
+	uint8_t				CodeCount;		// slots in Codes
+	uint8_t				FrameRegister;
+	uint8_t				FrameOffset;	// scaled by 16
+	const uint8_t		*Codes;			// CodeCount UNWIND_CODE slots, 2 bytes each
+	uint32_t			HandlerRva;		// UNW_FLAG_EHANDLER/UHANDLER
+	FPeRuntimeFunction	Chained;		// UNW_FLAG_CHAININFO
+};
+
+// RSDS record, the key of the matching PDB
+struct FPeCodeView
+{
+	FPdbGuid		Guid;
+	uint32_t		Age;
+	const char		*PdbPath;
+};
+
+class FPeImage
+{
+public:
+	FPeImage();
+
+	// a PE file on disk, mapped.
+	bool OpenFile(const std::wstring &InFilename);
+	// an image in memory, either laid out as a file or as the loader maps it. the memory must outlive the image.
+	bool OpenMemory(const uint8_t *InData, uint64_t InSize, bool bInLoadedLayout);
+	// headers of a module loaded at InImageBase in a debuggee, in one read. other data needs ReadRemoteRange().
+	bool OpenRemote(FRemoteMemory &InMemory, uint64_t InImageBase);
+	void Close();
+
+	// copy [InRva, InRva + InSize) of a remote image, in one read.
+	bool ReadRemoteRange(FRemoteMemory &InMemory, uint32_t InRva, uint32_t InSize);
+	bool ReadRemoteDirectory(FRemoteMemory &InMemory, uint32_t InDirectory);
+	// the debug directory and the data of its entries
+	bool ReadRemoteDebugData(FRemoteMemory &InMemory);
+
+	bool IsOpen() const { return Machine != 0; }
+	bool Is64Bit() const { return b64Bit; }
+	uint16_t GetMachine() const { return Machine; }
+	uint32_t GetTimeDateStamp() const { return TimeDateStamp; }
+	uint16_t GetCharacteristics() const { return Characteristics; }
+	uint64_t GetImageBase() const { return ImageBase; }
+	uint32_t GetSizeOfImage() const { return SizeOfImage; }
+	uint32_t GetEntryPointRva() const { return EntryPointRva; }
+
+	const std::vector<FPeSection>& GetSections() const { return Sections; }
+	const FPeSection* FindSection(uint32_t InRva) const;
+	bool GetDataDirectory(uint32_t InDirectory, uint32_t &OutRva, uint32_t &OutSize) const;
+
+	// InSize bytes at InRva, NULL if any of them is not available.
+	const uint8_t* RvaToData(uint32_t InRva, uint32_t InSize) const;
+	// terminated string at InRva, NULL if not available.
+	const char* RvaToString(uint32_t InRva) const;
+
+	// tables
+	bool GetExports(std::vector<FPeExport> &OutExports, const char **OutModuleName = NULL) const;
+	bool GetImports(std::vector<FPeImport> &OutImports) const;
+	bool GetCodeView(FPeCodeView &OutCodeView) const;
+
+	// .pdata, sorted by address
+	uint32_t GetRuntimeFunctionCount() const;
+	bool GetRuntimeFunction(uint32_t InIndex, FPeRuntimeFunction &OutFunction) const;
+	bool FindRuntimeFunction(uint32_t InRva, FPeRuntimeFunction &OutFunction) const;
+	bool GetUnwindInfo(uint32_t InUnwindInfoRva, FPeUnwindInfo &OutInfo) const;
+
+private:
+	FPeImage(const FPeImage&);
+	FPeImage& operator=(const FPeImage&);
+
+	// a run of image bytes available in memory
+	struct FView
+	{
+		uint32_t		Rva;
+		uint32_t		Size;
+		const uint8_t	*Data;
+	};
+
+	bool ParseHeaders(const uint8_t *InData, uint64_t InSize);
+	bool OpenLayout(const uint8_t *InData, uint64_t InSize, bool bInLoadedLayout);
+	void AddView(uint32_t InRva, const uint8_t *InData, uint32_t InSize);
+
+	FMappedFile			File;
+	bool				bRemote;
+	uint64_t			RemoteBase;
+	std::vector<std::vector<uint8_t> >	RemoteCopies;
+
+	std::vector<FView>	Views;
+
+	uint16_t			Machine;
+	uint16_t			Characteristics;
+	bool				b64Bit;
+	uint32_t			TimeDateStamp;
+	uint64_t			ImageBase;
+	uint32_t			SizeOfImage;
+	uint32_t			SizeOfHeaders;
+	uint32_t			EntryPointRva;
+
+	std::vector<FPeSection>	Sections;
+	std::vector<uint32_t>	Directories; // rva, size pairs
+};
+
+// PE constants used by the parser and its clients
+namespace NSPeImage
+{
+	// data directories
+	const uint32_t DIRECTORY_EXPORT      = 0;
+	const uint32_t DIRECTORY_IMPORT      = 1;
+	const uint32_t DIRECTORY_EXCEPTION   = 3;
+	const uint32_t DIRECTORY_DEBUG       = 6;
+
+	// machines
+	const uint16_t MACHINE_I386          = 0x014C;
+	const uint16_t MACHINE_AMD64         = 0x8664;
+	const uint16_t MACHINE_ARM64         = 0xAA64;
+
+	// section characteristics
+	const uint32_t SCN_MEM_EXECUTE       = 0x20000000;
+
+	// unwind info flags
+	const uint8_t UNW_FLAG_EHANDLER      = 0x1;
+	const uint8_t UNW_FLAG_UHANDLER      = 0x2;
+	const uint8_t UNW_FLAG_CHAININFO     = 0x4;
+}
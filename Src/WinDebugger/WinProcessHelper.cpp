@@ -200,3 +200,61 @@ const TCHAR* FSnapshotTool::GetHeapBlockFlagsDesc(uint32_t InFlags)
 
 	return TEXT("--");
 }
+
+//////////////////////////////////////////////////////////////////////////
+// ntdll!NtQueryInformationProcess(ProcessBasicInformation)
+typedef LONG(NTAPI *PtrNtQueryInformationProcess)(HANDLE, ULONG, PVOID, ULONG, PULONG);
+
+struct FProcessBasicInformation
+{
+	PVOID		ExitStatus;
+	PVOID		PebBaseAddress;
+	PVOID		AffinityMask;
+	PVOID		BasePriority;
+	ULONG_PTR	UniqueProcessId;
+	PVOID		InheritedFromUniqueProcessId;
+};
+
+uint64_t FProcessInfoHelper::GetPebAddress(HANDLE InProcess)
+{
+	static PtrNtQueryInformationProcess sNtQueryInformationProcess = (PtrNtQueryInformationProcess)
+		GetProcAddress(GetModuleHandle(TEXT("ntdll.dll")), "NtQueryInformationProcess");
+	if (!sNtQueryInformationProcess)
+	{
+		return 0;
+	}
+
+	if (GetPointerSize(InProcess) < sizeof(void*))
+	{
+		// ProcessWow64Information, the PEB of the 32 bit side
+		ULONG_PTR Peb32 = 0;
+		const ULONG kProcessWow64Information = 26;
+		if (sNtQueryInformationProcess(InProcess, kProcessWow64Information, &Peb32, sizeof(Peb32), NULL) < 0)
+		{
+			return 0;
+		}
+		return (uint64_t)Peb32;
+	}
+
+	FProcessBasicInformation BasicInfo;
+	ZeroMemory(&BasicInfo, sizeof(BasicInfo));
+
+	const ULONG kProcessBasicInformation = 0;
+	if (sNtQueryInformationProcess(InProcess, kProcessBasicInformation, &BasicInfo, sizeof(BasicInfo), NULL) < 0)
+	{
+		return 0;
+	}
+
+	return (uint64_t)(uintptr_t)BasicInfo.PebBaseAddress;
+}
+
+uint32_t FProcessInfoHelper::GetPointerSize(HANDLE InProcess)
+{
+#if defined(_WIN64)
+	BOOL bWow64 = FALSE;
+	return (IsWow64Process(InProcess, &bWow64) && bWow64) ? 4 : 8;
+#else
+	(void)InProcess;
+	return 4;
+#endif
+}
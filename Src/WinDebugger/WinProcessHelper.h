@@ -86,4 +86,12 @@ protected:
 	uint32_t	ProcessId;
 };
 
-
+// process information which is not in the snapshot
+class FProcessInfoHelper
+{
+public:
+	// address of the process environment block, the 32 bit one of a WOW64 process. 0 if failed.
+	static uint64_t GetPebAddress(HANDLE InProcess);
+	// bytes of a pointer of the process, 4 for x86 and WOW64 processes
+	static uint32_t GetPointerSize(HANDLE InProcess);
+};
@@ -0,0 +1,295 @@
+// \brief
+//		debuggee memory access.
+//
+
+#include "WinRemoteMemory.h"
+
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+
+bool FRemoteMemory::ReadPointer(uint64_t InAddress, uint32_t InPointerSize, uint64_t &OutValue)
+{
+	OutValue = 0;
+	if (InPointerSize == 8)
+	{
+		return ReadMemory(InAddress, &OutValue, 8);
+	}
+
+	uint32_t Value32 = 0;
+	if (!ReadMemory(InAddress, &Value32, 4))
+	{
+		return false;
+	}
+	OutValue = Value32;
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+#if defined(_WIN32)
+bool FProcessMemory::ReadMemory(uint64_t InAddress, void *OutBuffer, size_t InBytes)
+{
+	SIZE_T BytesRead = 0;
+	if (!::ReadProcessMemory(hProcess, (LPCVOID)(uintptr_t)InAddress, OutBuffer, InBytes, &BytesRead))
+	{
+		return false;
+	}
+
+	return BytesRead == InBytes;
+}
+#endif
+
+//////////////////////////////////////////////////////////////////////////
+void FCapturedMemory::AddRegion(uint64_t InAddress, const void *InData, size_t InBytes)
+{
+	FRegion NewRegion;
+	NewRegion.Address = InAddress;
+	NewRegion.Bytes.assign((const uint8_t*)InData, (const uint8_t*)InData + InBytes);
+
+	std::vector<FRegion>::iterator Itr = Regions.begin();
+	while (Itr != Regions.end() && Itr->Address < InAddress)
+	{
+		++Itr;
+	}
+	Regions.insert(Itr, NewRegion);
+}
+
+const FCapturedMemory::FRegion* FCapturedMemory::FindRegion(uint64_t InAddress) const
+{
+	// last region starting at or below the address
+	size_t Low = 0, High = Regions.size();
+	while (Low < High)
+	{
+		const size_t Mid = (Low + High) / 2;
+		if (Regions[Mid].Address <= InAddress)
+		{
+			Low = Mid + 1;
+		}
+		else
+		{
+			High = Mid;
+		}
+	} // end while
+
+	if (Low == 0)
+	{
+		return NULL;
+	}
+
+	const FRegion &Region = Regions[Low - 1];
+	return (InAddress - Region.Address) < Region.Bytes.size() ? &Region : NULL;
+}
+
+bool FCapturedMemory::ReadMemory(uint64_t InAddress, void *OutBuffer, size_t InBytes)
+{
+	uint8_t *Dest = (uint8_t *)OutBuffer;
+	while (InBytes > 0)
+	{
+		const FRegion *Region = FindRegion(InAddress);
+		if (!Region)
+		{
+			return false;
+		}
+
+		const size_t Offset = (size_t)(InAddress - Region->Address);
+		const size_t Available = Region->Bytes.size() - Offset;
+		const size_t Count = InBytes < Available ? InBytes : Available;
+		memcpy(Dest, &Region->Bytes[Offset], Count);
+
+		Dest += Count;
+		InAddress += Count;
+		InBytes -= Count;
+	} // end while
+
+	return true;
+}
+
+bool FCapturedMemory::LoadFromFile(const char *InFilename)
+{
+	FILE *File = fopen(InFilename, "rb");
+	if (!File)
+	{
+		return false;
+	}
+
+	bool bSuccess = true;
+	std::vector<uint8_t> Data;
+	uint64_t Header[2];
+	while (fread(Header, sizeof(Header), 1, File) == 1)
+	{
+		Data.resize((size_t)Header[1]);
+		if (Header[1] && fread(&Data[0], 1, Data.size(), File) != Data.size())
+		{
+			bSuccess = false;
+			break;
+		}
+		if (Header[1])
+		{
+			AddRegion(Header[0], &Data[0], Data.size());
+		}
+	} // end while
+
+	fclose(File);
+	return bSuccess;
+}
+
+bool FCapturedMemory::SaveToFile(const char *InFilename) const
+{
+	FILE *File = fopen(InFilename, "wb");
+	if (!File)
+	{
+		return false;
+	}
+
+	bool bSuccess = true;
+	for (size_t k = 0; k < Regions.size() && bSuccess; k++)
+	{
+		const FRegion &Region = Regions[k];
+		const uint64_t Header[2] = { Region.Address, (uint64_t)Region.Bytes.size() };
+
+		bSuccess = fwrite(Header, sizeof(Header), 1, File) == 1;
+		if (bSuccess && !Region.Bytes.empty())
+		{
+			bSuccess = fwrite(&Region.Bytes[0], 1, Region.Bytes.size(), File) == Region.Bytes.size();
+		}
+	} // end for k
+
+	fclose(File);
+	return bSuccess;
+}
+
+//////////////////////////////////////////////////////////////////////////
+namespace NSRemotePageCache
+{
+	// unneeded pages between two needed ones that are read along rather than starting a new read,
+	// copying a few pages costs less than one more read of another process
+	const uint64_t kMaxGapPages = 16;
+	const uint64_t kMaxRunPages = 256;
+}
+
+FRemotePageCache::FRemotePageCache(FRemoteMemory &InSource)
+	: Source(InSource)
+	, ReadCount(0)
+{
+}
+
+void FRemotePageCache::Prefetch(const std::vector<FRange> &InRanges)
+{
+	std::vector<uint64_t> Missing;
+	for (size_t k = 0; k < InRanges.size(); k++)
+	{
+		const FRange &Range = InRanges[k];
+		if (Range.Bytes == 0)
+		{
+			continue;
+		}
+
+		const uint64_t LastPage = (Range.Address + Range.Bytes - 1) / kPageSize;
+		for (uint64_t Page = Range.Address / kPageSize; Page <= LastPage; Page++)
+		{
+			if (PageMap.find(Page) == PageMap.end())
+			{
+				Missing.push_back(Page);
+			}
+		} // end for Page
+	} // end for k
+
+	std::sort(Missing.begin(), Missing.end());
+	Missing.erase(std::unique(Missing.begin(), Missing.end()), Missing.end());
+
+	// one read per run of nearby pages
+	size_t First = 0;
+	while (First < Missing.size())
+	{
+		size_t End = First + 1;
+		while (End < Missing.size()
+			&& Missing[End] - Missing[End - 1] <= NSRemotePageCache::kMaxGapPages + 1
+			&& Missing[End] - Missing[First] < NSRemotePageCache::kMaxRunPages)
+		{
+			End++;
+		} // end while
+
+		const std::vector<uint64_t> Needed(Missing.begin() + First, Missing.begin() + End);
+		FetchRun(Missing[First], Missing[End - 1] - Missing[First] + 1, Needed);
+		First = End;
+	} // end while
+}
+
+void FRemotePageCache::FetchRun(uint64_t InFirstPage, uint64_t InPageCount, const std::vector<uint64_t> &InNeeded)
+{
+	std::vector<uint8_t> Buffer((size_t)InPageCount * kPageSize);
+	ReadCount++;
+	if (Source.ReadMemory(InFirstPage * kPageSize, &Buffer[0], Buffer.size()))
+	{
+		for (uint64_t k = 0; k < InPageCount; k++)
+		{
+			AddPage(InFirstPage + k, &Buffer[(size_t)k * kPageSize]);
+		} // end for k
+		return;
+	}
+
+	// a page of the run is not readable, read the needed ones alone
+	for (size_t k = 0; k < InNeeded.size(); k++)
+	{
+		if (InPageCount > 1)
+		{
+			ReadCount++;
+			if (Source.ReadMemory(InNeeded[k] * kPageSize, &Buffer[0], kPageSize))
+			{
+				AddPage(InNeeded[k], &Buffer[0]);
+				continue;
+			}
+		}
+		PageMap[InNeeded[k]] = kNoPage;
+	} // end for k
+}
+
+void FRemotePageCache::AddPage(uint64_t InPage, const uint8_t *InData)
+{
+	std::map<uint64_t, size_t>::iterator Itr = PageMap.find(InPage);
+	if (Itr != PageMap.end() && Itr->second != kNoPage)
+	{
+		return;
+	}
+
+	const size_t Offset = PageData.size();
+	PageData.insert(PageData.end(), InData, InData + kPageSize);
+	PageMap[InPage] = Offset;
+}
+
+bool FRemotePageCache::ReadMemory(uint64_t InAddress, void *OutBuffer, size_t InBytes)
+{
+	uint8_t *Dest = (uint8_t *)OutBuffer;
+	while (InBytes > 0)
+	{
+		const uint64_t Page = InAddress / kPageSize;
+		std::map<uint64_t, size_t>::iterator Itr = PageMap.find(Page);
+		if (Itr == PageMap.end())
+		{
+			FetchRun(Page, 1, std::vector<uint64_t>(1, Page));
+			Itr = PageMap.find(Page);
+		}
+		if (Itr->second == kNoPage)
+		{
+			return false;
+		}
+
+		const size_t Offset = (size_t)(InAddress % kPageSize);
+		const size_t Count = InBytes < kPageSize - Offset ? InBytes : kPageSize - Offset;
+		memcpy(Dest, &PageData[Itr->second + Offset], Count);
+
+		Dest += Count;
+		InAddress += Count;
+		InBytes -= Count;
+	} // end while
+
+	return true;
+}
+
+void FRemotePageCache::Clear()
+{
+	PageMap.clear();
+	PageData.clear();
+	ReadCount = 0;
+}
@@ -0,0 +1,107 @@
+// \brief
+//		debuggee memory access: live process or captured memory image.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <map>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#endif
+
+
+// memory reader
+class FRemoteMemory
+{
+public:
+	virtual ~FRemoteMemory() {}
+
+	// read InBytes bytes at InAddress. return false if any byte is not readable.
+	virtual bool ReadMemory(uint64_t InAddress, void *OutBuffer, size_t InBytes) = 0;
+
+	// read a pointer sized value of the target, InPointerSize is 4 or 8.
+	bool ReadPointer(uint64_t InAddress, uint32_t InPointerSize, uint64_t &OutValue);
+};
+
+#if defined(_WIN32)
+// memory of a live process
+class FProcessMemory : public FRemoteMemory
+{
+public:
+	explicit FProcessMemory(HANDLE InProcess) : hProcess(InProcess) {}
+
+	virtual bool ReadMemory(uint64_t InAddress, void *OutBuffer, size_t InBytes) override;
+
+protected:
+	HANDLE	hProcess;
+};
+#endif
+
+// captured memory regions, used to parse memory images offline.
+class FCapturedMemory : public FRemoteMemory
+{
+public:
+	// copy a region into the image. regions must not overlap.
+	void AddRegion(uint64_t InAddress, const void *InData, size_t InBytes);
+	// load/save a image file, format: { uint64 address, uint64 bytes, data } ...
+	bool LoadFromFile(const char *InFilename);
+	bool SaveToFile(const char *InFilename) const;
+
+	virtual bool ReadMemory(uint64_t InAddress, void *OutBuffer, size_t InBytes) override;
+
+protected:
+	struct FRegion
+	{
+		uint64_t				Address;
+		std::vector<uint8_t>	Bytes;
+	};
+
+	const FRegion* FindRegion(uint64_t InAddress) const;
+
+	std::vector<FRegion>	Regions; // sorted by address
+};
+
+// page granular cache over another reader, for walks that touch many small pieces of memory.
+// Prefetch() reads the missing pages of a whole batch of ranges with one read per run of nearby
+// pages, ReadMemory() is served from the cached pages.
+class FRemotePageCache : public FRemoteMemory
+{
+public:
+	static const uint32_t kPageSize = 4096;
+
+	struct FRange
+	{
+		uint64_t	Address;
+		uint32_t	Bytes;
+	};
+
+	explicit FRemotePageCache(FRemoteMemory &InSource);
+
+	// fetch the pages of all the ranges not cached yet
+	void Prefetch(const std::vector<FRange> &InRanges);
+
+	virtual bool ReadMemory(uint64_t InAddress, void *OutBuffer, size_t InBytes) override;
+
+	// reads issued to the source
+	uint64_t GetReadCount() const { return ReadCount; }
+	void Clear();
+
+private:
+	FRemotePageCache(const FRemotePageCache&);
+	FRemotePageCache& operator=(const FRemotePageCache&);
+
+	// read pages [InFirstPage, InFirstPage + InPageCount), the ones in InNeeded that fail are marked unreadable
+	void FetchRun(uint64_t InFirstPage, uint64_t InPageCount, const std::vector<uint64_t> &InNeeded);
+	void AddPage(uint64_t InPage, const uint8_t *InData);
+
+	static const size_t kNoPage = (size_t)-1;
+
+	FRemoteMemory					&Source;
+	std::map<uint64_t, size_t>		PageMap;		// page number -> offset in PageData, kNoPage if unreadable
+	std::vector<uint8_t>			PageData;
+	uint64_t						ReadCount;
+};
@@ -3,14 +3,451 @@
 //
 
 #include "WinStackTraceHelper.h"
+#include "WinSymbolIndex.h"
+#include "WinLineTable.h"
+#include "WinPdbReader.h"
+#include "WinPdbTypeSource.h"
+#include "WinSymbolCache.h"
+#include "WinPeImage.h"
+#include "WinRemoteMemory.h"
+#include "WinSymbolStore.h"
+#include "WinTaskPool.h"
+#include "WinDemangler.h"
+#include "WinSymbolSearch.h"
+#include "WinX64Unwinder.h"
 #include "Foundation/AppHelper.h"
 
 #include <sstream>
 #include <iomanip>
+#include <algorithm>
+#include <map>
+#include <chrono>
 
 
+// a loaded module, its headers, symbol and name indexes, line table and cached types
+struct FSymbolModule
+{
+	DWORD64				Base;
+	DWORD				Size;
+	std::wstring		ImageName;
+	std::wstring		PdbName;
+	FPeImage			Image;		// headers read from the debuggee, closed if they don't match the module
+	FPdbGuid			PdbGuid;	// RSDS record of the image
+	DWORD				PdbAge;
+	bool				bIndexBuilt;
+	FModuleSymbolIndex	Index;
+	FSymbolTrigramIndex	Search;		// names of Index
+	FModuleLineTable	Lines;
+	FSymbolCacheReader	Cache;		// Types point into its mapping
+	FFlatSymTypeSource	Types;
+};
+
+// sorted by base address
+static std::vector<FSymbolModule*> sSymbolModules;
+// PDBs of modules without a local one, fetched in the background
+static FSymbolStore sSymbolStore;
+// .pdata of the x64 modules
+static FX64Unwinder sX64Unwinder;
+
+static bool SymbolModuleBaseLess(DWORD64 InAddress, const FSymbolModule *InModule)
+{
+	return InAddress < InModule->Base;
+}
+
+static std::string WideToUtf8(const WCHAR *InText)
+{
+	const int32_t Bytes = WideCharToMultiByte(CP_UTF8, 0, InText, -1, NULL, 0, NULL, NULL);
+	if (Bytes <= 1)
+	{
+		return std::string();
+	}
+
+	std::string Result(Bytes - 1, '\0');
+	WideCharToMultiByte(CP_UTF8, 0, InText, -1, &Result[0], Bytes, NULL, NULL);
+	return Result;
+}
+
+static std::wstring Utf8ToWide(const char *InText)
+{
+	const int32_t Chars = MultiByteToWideChar(CP_UTF8, 0, InText, -1, NULL, 0);
+	if (Chars <= 1)
+	{
+		return std::wstring();
+	}
+
+	std::wstring Result(Chars - 1, TEXT('\0'));
+	MultiByteToWideChar(CP_UTF8, 0, InText, -1, &Result[0], Chars);
+	return Result;
+}
+
+// qualified name of a decorated symbol, the way dbghelp shows it. InName if it is not decorated.
+// one demangler per thread, modules are indexed on the task pool.
+static const char* UndecorateName(const char *InName)
+{
+	static thread_local FMsvcDemangler sDemangler;
+	const char *Undecorated = sDemangler.Demangle(InName, true);
+	return Undecorated ? Undecorated : InName;
+}
+
+// publics carry decorated names
+static void AddPdbSymbol(FModuleSymbolIndex &InIndex, const FPdbSymbolInfo &InSymbol)
+{
+	InIndex.AddSymbol(InSymbol.Rva, InSymbol.Size, UndecorateName(InSymbol.Name));
+}
+
+// a PDB of another build would put wrong names on every address.
+static bool IsPdbOfImage(const FPdbReader &InReader, const FSymbolModule *InModule)
+{
+	FPeCodeView CodeView;
+	if (!InModule->Image.GetCodeView(CodeView))
+	{
+		return true;
+	}
+	return InReader.GetAge() == CodeView.Age && !memcmp(&InReader.GetGuid(), &CodeView.Guid, sizeof(FPdbGuid));
+}
+
+// exports of the image, functions are sized from .pdata where the image has one.
+static bool IndexExportSymbols(HANDLE InProcess, FSymbolModule *InModule)
+{
+	FPeImage &Image = InModule->Image;
+	FProcessMemory Memory(InProcess);
+
+	std::vector<FPeExport> Exports;
+	if (!Image.IsOpen() || !Image.ReadRemoteDirectory(Memory, NSPeImage::DIRECTORY_EXPORT) || !Image.GetExports(Exports) || Exports.empty())
+	{
+		return false;
+	}
+	Image.ReadRemoteDirectory(Memory, NSPeImage::DIRECTORY_EXCEPTION);
+
+	InModule->Index.Reserve(Exports.size(), Exports.size() * 24);
+	for (size_t k = 0; k < Exports.size(); k++)
+	{
+		const FPeExport &Export = Exports[k];
+		if (Export.Forwarder)
+		{
+			continue;
+		}
+
+		FPeRuntimeFunction Function;
+		const uint32_t Size = (Image.FindRuntimeFunction(Export.Rva, Function) && Function.BeginRva == Export.Rva) ? Function.EndRva - Function.BeginRva : 0;
+		if (Export.Name)
+		{
+			InModule->Index.AddSymbol(Export.Rva, Size, UndecorateName(Export.Name));
+		}
+		else
+		{
+			InModule->Index.AddSymbol(Export.Rva, Size, ("Ordinal" + std::to_string(Export.Ordinal)).c_str());
+		}
+	} // end for k
+
+	return true;
+}
+
+static BOOL CALLBACK IndexSymbolsCallback(PSYMBOL_INFO pSymInfo, ULONG SymbolSize, PVOID UserContext)
+{
+	FSymbolModule *pModule = reinterpret_cast<FSymbolModule*>(UserContext);
+	if (pSymInfo->Tag == SymTagFunction || pSymInfo->Tag == SymTagPublicSymbol)
+	{
+		pModule->Index.AddSymbol((uint32_t)(pSymInfo->Address - pModule->Base), pSymInfo->Size, WideToUtf8(pSymInfo->Name).c_str());
+	}
+	return TRUE;
+}
+
+// file ids are dense indices of the /names offsets the lines refer to.
+static void BuildLineTable(const FPdbReader &InReader, FModuleLineTable &OutLines)
+{
+	std::vector<FPdbLineInfo> PdbLines;
+	for (uint32_t k = 0; k < InReader.GetModules().size(); k++)
+	{
+		InReader.GetModuleLines(k, PdbLines);
+	} // end for k
+
+	std::map<uint32_t, uint32_t> FileIds;
+	std::vector<std::string> FileNames;
+	std::vector<FModuleLineTable::FLineRow> Rows(PdbLines.size());
+	for (size_t k = 0; k < PdbLines.size(); k++)
+	{
+		const FPdbLineInfo &PdbLine = PdbLines[k];
+
+		uint32_t FileId = 0;
+		if (PdbLine.Line)
+		{
+			std::map<uint32_t, uint32_t>::iterator FindItr = FileIds.find(PdbLine.FileNameOffset);
+			if (FindItr == FileIds.end())
+			{
+				const char *FileName = InReader.GetString(PdbLine.FileNameOffset);
+				FileId = (uint32_t)FileNames.size();
+				FileIds.insert(std::make_pair(PdbLine.FileNameOffset, FileId));
+				FileNames.push_back(FileName ? FileName : "");
+			}
+			else
+			{
+				FileId = FindItr->second;
+			}
+		}
+
+		Rows[k].Rva = PdbLine.Rva;
+		Rows[k].Line = PdbLine.Line;
+		Rows[k].FileId = FileId;
+	} // end for k
+
+	OutLines.Build(Rows, FileNames);
+}
+
+// %WINDEBUGGER_SYMCACHE%, or %LOCALAPPDATA%\WinDebugger\SymCache. empty if neither can be used.
+static const std::wstring& GetSymbolCacheDir()
+{
+	static std::wstring sCacheDir;
+	static bool sbCacheDirInitialized = false;
+	if (sbCacheDirInitialized)
+	{
+		return sCacheDir;
+	}
+	sbCacheDirInitialized = true;
+
+	TCHAR szDir[MAX_PATH];
+	const DWORD dwLength = GetEnvironmentVariable(TEXT("WINDEBUGGER_SYMCACHE"), szDir, XARRAY_COUNT(szDir));
+	if (dwLength && dwLength < XARRAY_COUNT(szDir))
+	{
+		sCacheDir = szDir;
+	}
+	else
+	{
+		const DWORD dwAppDataLength = GetEnvironmentVariable(TEXT("LOCALAPPDATA"), szDir, XARRAY_COUNT(szDir));
+		if (!dwAppDataLength || dwAppDataLength >= XARRAY_COUNT(szDir))
+		{
+			return sCacheDir;
+		}
+
+		sCacheDir = std::wstring(szDir) + TEXT("\\WinDebugger");
+		CreateDirectory(sCacheDir.c_str(), NULL);
+		sCacheDir += TEXT("\\SymCache");
+	}
+
+	if (!CreateDirectory(sCacheDir.c_str(), NULL) && GetLastError() != ERROR_ALREADY_EXISTS)
+	{
+		sCacheDir.clear();
+	}
+	return sCacheDir;
+}
+
+static std::wstring GetPdbFileName(const std::wstring &InPdbPath)
+{
+	const std::wstring::size_type Slash = InPdbPath.find_last_of(TEXT("\\/"));
+	return Slash == std::wstring::npos ? InPdbPath : InPdbPath.substr(Slash + 1);
+}
+
+// a module can only be matched with its PDB through the RSDS record.
+static bool HasPdbKey(const FSymbolModule *InModule)
+{
+	static const FPdbGuid kNullGuid = { 0 };
+	return !InModule->PdbName.empty() && memcmp(&InModule->PdbGuid, &kNullGuid, sizeof(kNullGuid)) != 0;
+}
+
+// <cache dir>\<pdb name>.<guid><age>.symcache, the way symbol stores key a PDB.
+static std::wstring GetSymbolCachePath(const FSymbolModule *InModule)
+{
+	const std::wstring &CacheDir = GetSymbolCacheDir();
+	if (CacheDir.empty() || !HasPdbKey(InModule))
+	{
+		return std::wstring();
+	}
+
+	return CacheDir + TEXT("\\") + GetPdbFileName(InModule->PdbName) + TEXT(".") + FSymbolStore::MakeKey(InModule->PdbGuid, InModule->PdbAge) + TEXT(".symcache");
+}
+
+// the type arrays come first in a cache file, they are used in place.
+static bool LoadCachedTypes(const std::wstring &InPath, FSymbolModule *InModule)
+{
+	uint64_t TypeIndexBegin = 0, TypeCount = 0, ChildCount = 0, NameBytes = 0;
+	const FSymFlatType *Types = NULL;
+	const FSymFlatChild *Children = NULL;
+	const char *Names = NULL;
+
+	if (!InModule->Cache.Open(InPath, InModule->PdbGuid, InModule->PdbAge) || !InModule->Cache.ReadValue(TypeIndexBegin)
+		|| !InModule->Cache.ReadArray(Types, TypeCount) || !InModule->Cache.ReadArray(Children, ChildCount) || !InModule->Cache.ReadArray(Names, NameBytes)
+		|| !NameBytes || Names[NameBytes - 1] != '\0')
+	{
+		InModule->Cache.Close();
+		return false;
+	}
+
+	InModule->Types.Init((uint32_t)TypeIndexBegin, Types, TypeCount, Children, ChildCount, Names, NameBytes);
+	return true;
+}
+
+static bool LoadSymbolCache(const std::wstring &InPath, FSymbolModule *InModule)
+{
+	if (LoadCachedTypes(InPath, InModule) && InModule->Index.Load(InModule->Cache) && InModule->Lines.Load(InModule->Cache))
+	{
+		return true;
+	}
+
+	InModule->Types.Init(0, NULL, 0, NULL, 0, NULL, 0);
+	InModule->Cache.Close();
+	InModule->Index.Clear();
+	InModule->Lines.Clear();
+	return false;
+}
+
+static void SaveSymbolCache(const std::wstring &InPath, const FPdbReader &InReader, FSymbolModule *InModule)
+{
+	FSymFlatTypes FlatTypes;
+	FPdbSymTypeSource TypeSource(InReader);
+	TypeSource.Flatten(FlatTypes);
+
+	FSymbolCacheWriter Writer;
+	Writer.WriteValue(FlatTypes.TypeIndexBegin);
+	Writer.WriteArray(FlatTypes.Types);
+	Writer.WriteArray(FlatTypes.Children);
+	Writer.WriteArray(FlatTypes.Names);
+	InModule->Index.Save(Writer);
+	InModule->Lines.Save(Writer);
+
+	if (Writer.Save(InPath, InReader.GetGuid(), InReader.GetAge()))
+	{
+		LoadCachedTypes(InPath, InModule);
+	}
+}
+
+// the PDB dbghelp found or the one the RSDS record names, else the symbol store copy. the store
+// lookup waits for the prefetch of the module if it is still running.
+static bool OpenModulePdb(FPdbReader &InReader, FSymbolModule *InModule)
+{
+	if (InModule->PdbName.empty())
+	{
+		return false;
+	}
+	if (InReader.Open(InModule->PdbName) && IsPdbOfImage(InReader, InModule))
+	{
+		return true;
+	}
+	if (!HasPdbKey(InModule))
+	{
+		return false;
+	}
+
+	const std::wstring StorePath = sSymbolStore.Resolve(GetPdbFileName(InModule->PdbName), InModule->PdbGuid, InModule->PdbAge);
+	if (StorePath.empty() || !InReader.Open(StorePath) || !IsPdbOfImage(InReader, InModule))
+	{
+		return false;
+	}
+
+	InModule->PdbName = StorePath;
+	return true;
+}
+
+// load the symbol cache, or read functions, publics and lines straight from the PDB and write the cache.
+// without a matching PDB the image exports are used, dbghelp enumeration is the last resort. off the
+// debugger thread dbghelp is not called, a module that needs it is left for its first lookup.
+static void LoadSymbolIndex(HANDLE InProcess, FSymbolModule *InModule, bool bInWorkerThread)
+{
+	InModule->bIndexBuilt = true;
+
+	const std::wstring CachePath = GetSymbolCachePath(InModule);
+	if (!CachePath.empty() && LoadSymbolCache(CachePath, InModule))
+	{
+		return;
+	}
+
+	FPdbReader Reader;
+	if (OpenModulePdb(Reader, InModule))
+	{
+		std::vector<FPdbSymbolInfo> Symbols;
+		for (uint32_t k = 0; k < Reader.GetModules().size(); k++)
+		{
+			Reader.GetModuleSymbols(k, Symbols);
+		} // end for k
+		Reader.GetPublicSymbols(Symbols);
+
+		InModule->Index.Reserve(Symbols.size(), Symbols.size() * 32);
+		for (size_t k = 0; k < Symbols.size(); k++)
+		{
+			const FPdbSymbolInfo &Symbol = Symbols[k];
+			if (Symbol.Kind != NSCodeView::S_GDATA32 && Symbol.Kind != NSCodeView::S_LDATA32 && Symbol.Rva)
+			{
+				AddPdbSymbol(InModule->Index, Symbol);
+			}
+		} // end for k
+
+		BuildLineTable(Reader, InModule->Lines);
+		InModule->Index.Finalize();
+
+		if (!CachePath.empty())
+		{
+			SaveSymbolCache(CachePath, Reader, InModule);
+		}
+	}
+	else
+	{
+		if (!IndexExportSymbols(InProcess, InModule))
+		{
+			if (bInWorkerThread)
+			{
+				InModule->Index.Clear();
+				InModule->bIndexBuilt = false;
+				return;
+			}
+			SymEnumSymbols(InProcess, InModule->Base, TEXT("*"), &IndexSymbolsCallback, InModule);
+		}
+		InModule->Index.Finalize();
+	}
+}
+
+// the trigram index of the names is built with the symbol index, on the thread pool at attach
+static void BuildSymbolIndex(HANDLE InProcess, FSymbolModule *InModule, bool bInWorkerThread = false)
+{
+	LoadSymbolIndex(InProcess, InModule, bInWorkerThread);
+	if (InModule->bIndexBuilt)
+	{
+		InModule->Search.Build(InModule->Index);
+	}
+}
+
+static FSymbolModule* FindSymbolModule(HANDLE InProcess, DWORD64 InAddress)
+{
+	std::vector<FSymbolModule*>::iterator Itr = std::upper_bound(sSymbolModules.begin(), sSymbolModules.end(), InAddress, &SymbolModuleBaseLess);
+	if (Itr == sSymbolModules.begin())
+	{
+		return NULL;
+	}
+
+	FSymbolModule *pModule = *(Itr - 1);
+	if (InAddress - pModule->Base >= pModule->Size)
+	{
+		return NULL;
+	}
+
+	if (!pModule->bIndexBuilt)
+	{
+		BuildSymbolIndex(InProcess, pModule);
+	}
+	return pModule;
+}
+
+
+DWORD64 FWinStackTraceHelper::GetProgramCounter(const CONTEXT &InContext)
+{
+#if defined(_M_X64)
+	return InContext.Rip;
+#else
+	return InContext.Eip;
+#endif
+}
+
 INT FWinStackTraceHelper::CaptureStackTrace(HANDLE InProcess, HANDLE InThread, const CONTEXT &InContext, DWORD64* OutBackTrace, DWORD InMaxDepth)
 {
+#if defined(_M_X64)
+	// unwound from the .pdata of the registered modules, frames share stack and unwind info pages
+	FProcessMemory Memory(InProcess);
+	FRemotePageCache Cache(Memory);
+	FX64Frame Frame;
+	Frame.Rip = InContext.Rip;
+	// Rax to R15 are in unwind code order
+	memcpy(Frame.Registers, &InContext.Rax, sizeof(Frame.Registers));
+
+	const DWORD CurrentDepth = sX64Unwinder.CaptureStack(Cache, Frame, OutBackTrace, InMaxDepth);
+#else
 	STACKFRAME64	StackFrame64;
 	BOOL			bStackWalkSucceeded = TRUE;
 	DWORD			CurrentDepth = 0;
@@ -51,6 +488,7 @@ INT FWinStackTraceHelper::CaptureStackTrace(HANDLE InProcess, HANDLE InThread, c
 	{
 		TRACE_ERROR(TEXT("StackWalk64 Exception Occured."));
 	}
+#endif
 
 	for (DWORD k=CurrentDepth; k<InMaxDepth; k++)
 	{
@@ -60,50 +498,105 @@ INT FWinStackTraceHelper::CaptureStackTrace(HANDLE InProcess, HANDLE InThread, c
 	return CurrentDepth;
 }
 
-std::wstring FWinStackTraceHelper::ProgramCounterToSymbolInfo(HANDLE InProcess, DWORD64 InProgramCounter)
+struct FStackCaptureBatch
 {
-	std::wostringstream    SymbolDescBuilder;
+	HANDLE							Process;
+	DWORD							MaxDepth;
+	std::vector<FThreadStack>		*Stacks;
+};
 
-	const INT kMaxNameLength = 512;
-	CHAR  SymbolBuffer[sizeof(IMAGEHLP_SYMBOL64) + kMaxNameLength];
-	PIMAGEHLP_SYMBOL64 Symbol = NULL;
-	DWORD SymbolDisplacement = 0;
-	DWORD64 SymbolDisplacement64 = 0;
+static void CaptureStackTraceTask(void *InContext, uint32_t InTaskIndex)
+{
+	FStackCaptureBatch *pBatch = reinterpret_cast<FStackCaptureBatch*>(InContext);
+	FThreadStack &Stack = (*pBatch->Stacks)[InTaskIndex];
+	HANDLE hThread = OpenThread(THREAD_GET_CONTEXT | THREAD_QUERY_INFORMATION, FALSE, Stack.ThreadId);
+	if (hThread == NULL)
+	{
+		return;
+	}
 
-	Symbol = (PIMAGEHLP_SYMBOL64)SymbolBuffer;
-	Symbol->SizeOfStruct = sizeof(IMAGEHLP_SYMBOL64);
-	Symbol->MaxNameLength = kMaxNameLength;
+	CONTEXT ThreadContext;
+	ThreadContext.ContextFlags = CONTEXT_FULL;
+	if (GetThreadContext(hThread, &ThreadContext))
+	{
+		Stack.BackTrace.resize(pBatch->MaxDepth);
+		Stack.BackTrace.resize(FWinStackTraceHelper::CaptureStackTrace(pBatch->Process, hThread, ThreadContext, &Stack.BackTrace[0], pBatch->MaxDepth));
+		Stack.bCaptured = true;
+	}
+	CloseHandle(hThread);
+}
 
-	// get symbol from address
-	if (SymGetSymFromAddr64(InProcess, InProgramCounter, &SymbolDisplacement64, Symbol))
+uint32_t FWinStackTraceHelper::CaptureStackTraces(HANDLE InProcess, const std::vector<DWORD> &InThreadIds, DWORD InMaxDepth, std::vector<FThreadStack> &OutStacks)
+{
+	OutStacks.clear();
+	OutStacks.resize(InThreadIds.size());
+	for (size_t k = 0; k < InThreadIds.size(); k++)
+	{
+		OutStacks[k].ThreadId = InThreadIds[k];
+		OutStacks[k].bCaptured = false;
+	} // end for k
+	if (InThreadIds.empty() || InMaxDepth == 0)
 	{
+		return 0;
+	}
 
-		// skip any funky chars in the beginning of a function name.
-		INT Offset = 0;
-		while (Symbol->Name[Offset] < 32 || Symbol->Name[Offset] > 127)
-		{
-			Offset++;
-		}
+	FStackCaptureBatch Batch;
+	Batch.Process = InProcess;
+	Batch.MaxDepth = InMaxDepth;
+	Batch.Stacks = &OutStacks;
+#if defined(_M_X64)
+	return FTaskPool::ParallelFor((uint32_t)InThreadIds.size(), &CaptureStackTraceTask, &Batch);
+#else
+	return FTaskPool::ParallelFor((uint32_t)InThreadIds.size(), &CaptureStackTraceTask, &Batch, 1);
+#endif
+}
 
-		TCHAR  szFunctionName[kMaxNameLength] = { 0 };
-		appANSIToTCHAR((const CHAR*)(Symbol->Name + Offset), szFunctionName, XARRAY_COUNT(szFunctionName));
+std::wstring FWinStackTraceHelper::ProgramCounterToSymbolInfo(HANDLE InProcess, DWORD64 InProgramCounter)
+{
+	std::wostringstream    SymbolDescBuilder;
+
+	const FSymbolModule *pModule = FindSymbolModule(InProcess, InProgramCounter);
 
-		SymbolDescBuilder << szFunctionName;
+	FModuleSymbolIndex::FSymbol IndexSymbol;
+	if (pModule && pModule->Index.FindByAddress((uint32_t)(InProgramCounter - pModule->Base), IndexSymbol))
+	{
+		SymbolDescBuilder << Utf8ToWide(IndexSymbol.Name);
 	}
 	else
 	{
-		//TRACE_ERROR(TEXT("ProgramCounterToSymbolInfo:"));
+		const INT kMaxNameLength = 512;
+		CHAR  SymbolBuffer[sizeof(IMAGEHLP_SYMBOL64) + kMaxNameLength];
+		PIMAGEHLP_SYMBOL64 Symbol = NULL;
+		DWORD64 SymbolDisplacement64 = 0;
+
+		Symbol = (PIMAGEHLP_SYMBOL64)SymbolBuffer;
+		Symbol->SizeOfStruct = sizeof(IMAGEHLP_SYMBOL64);
+		Symbol->MaxNameLength = kMaxNameLength;
+
+		// get symbol from address
+		if (SymGetSymFromAddr64(InProcess, InProgramCounter, &SymbolDisplacement64, Symbol))
+		{
+			// skip any funky chars in the beginning of a function name.
+			INT Offset = 0;
+			while (Symbol->Name[Offset] < 32 || Symbol->Name[Offset] > 127)
+			{
+				Offset++;
+			}
+
+			TCHAR  szFunctionName[kMaxNameLength] = { 0 };
+			appANSIToTCHAR(UndecorateName(Symbol->Name + Offset), szFunctionName, XARRAY_COUNT(szFunctionName));
+
+			SymbolDescBuilder << szFunctionName;
+		}
 	}
 
 	// Filename:Line
 	{
-		DWORD dwDisplacement = 0;
-		IMAGEHLP_LINE64  Line64;
-
-		Line64.SizeOfStruct = sizeof(Line64);
-		if (SymGetLineFromAddr64(InProcess, InProgramCounter, &dwDisplacement, &Line64))
+		std::wstring FileName;
+		DWORD LineNumber = 0, dwDisplacement = 0;
+		if (ProgramCounterToLine(InProcess, InProgramCounter, FileName, LineNumber, dwDisplacement))
 		{
-			SymbolDescBuilder << TEXT("      #") << Line64.FileName << TEXT(":") << Line64.LineNumber;
+			SymbolDescBuilder << TEXT("      #") << FileName << TEXT(":") << LineNumber;
 		}
 		else
 		{
@@ -113,6 +606,11 @@ std::wstring FWinStackTraceHelper::ProgramCounterToSymbolInfo(HANDLE InProcess,
 	}
 
 	// get module information from address
+	if (pModule)
+	{
+		SymbolDescBuilder << TEXT(" @") << pModule->ImageName;
+	}
+	else
 	{
 		IMAGEHLP_MODULE64 ImageHelpModule;
 		ImageHelpModule.SizeOfStruct = sizeof(ImageHelpModule);
@@ -126,3 +624,370 @@ std::wstring FWinStackTraceHelper::ProgramCounterToSymbolInfo(HANDLE InProcess,
 	return SymbolDescBuilder.str();
 }
 
+bool FWinStackTraceHelper::ProgramCounterToLine(HANDLE InProcess, DWORD64 InProgramCounter, std::wstring &OutFileName, DWORD &OutLine, DWORD &OutDisplacement)
+{
+	const FSymbolModule *pModule = FindSymbolModule(InProcess, InProgramCounter);
+	if (pModule && !pModule->Lines.IsEmpty())
+	{
+		FModuleLineTable::FLineRow Row;
+		uint32_t Displacement = 0;
+		if (!pModule->Lines.FindLine((uint32_t)(InProgramCounter - pModule->Base), Row, Displacement))
+		{
+			return false;
+		}
+
+		OutFileName = Utf8ToWide(pModule->Lines.GetFileName(Row.FileId).c_str());
+		OutLine = Row.Line;
+		OutDisplacement = Displacement;
+		return true;
+	}
+
+	IMAGEHLP_LINE64  Line64;
+	Line64.SizeOfStruct = sizeof(Line64);
+	if (!SymGetLineFromAddr64(InProcess, InProgramCounter, &OutDisplacement, &Line64))
+	{
+		return false;
+	}
+
+	OutFileName = Line64.FileName;
+	OutLine = Line64.LineNumber;
+	return true;
+}
+
+void FWinStackTraceHelper::SourceLineToAddresses(HANDLE InProcess, const std::wstring &InFileName, DWORD InLine, std::vector<FSourceLocation> &OutLocations)
+{
+	const std::string FileName = WideToUtf8(InFileName.c_str());
+
+	for (size_t k = 0; k < sSymbolModules.size(); k++)
+	{
+		FSymbolModule *pModule = sSymbolModules[k];
+		if (!pModule->bIndexBuilt)
+		{
+			BuildSymbolIndex(InProcess, pModule);
+		}
+
+		std::vector<uint32_t> FileIds;
+		pModule->Lines.FindFiles(FileName.c_str(), FileIds);
+		for (size_t i = 0; i < FileIds.size(); i++)
+		{
+			std::vector<FModuleLineTable::FLineRange> Ranges;
+			pModule->Lines.FindAddresses(FileIds[i], InLine, Ranges);
+			for (size_t j = 0; j < Ranges.size(); j++)
+			{
+				FSourceLocation Location;
+				Location.Address = pModule->Base + Ranges[j].Rva;
+				Location.Size = Ranges[j].Size;
+				Location.Line = Ranges[j].Line;
+				Location.FileName = Utf8ToWide(pModule->Lines.GetFileName(FileIds[i]).c_str());
+				OutLocations.push_back(Location);
+			} // end for j
+		} // end for i
+	} // end for k
+}
+
+// file name of a module, with or without its extension, against a module pattern
+static bool MatchModuleName(const FSymbolModule *InModule, const std::string &InPattern, const FSymbolQuery &InGlob)
+{
+	const std::string FileName = WideToUtf8(GetPdbFileName(InModule->ImageName).c_str());
+	const size_t Dot = FileName.rfind('.');
+	const std::string BaseName = FileName.substr(0, Dot);
+
+	if (InGlob.GetMode() == FSymbolQuery::MODE_GLOB)
+	{
+		return InGlob.Match(FileName.c_str()) || InGlob.Match(BaseName.c_str());
+	}
+	return _stricmp(FileName.c_str(), InPattern.c_str()) == 0 || _stricmp(BaseName.c_str(), InPattern.c_str()) == 0;
+}
+
+// a match before it is sorted and paged
+struct FSymbolHit
+{
+	uint32_t			Tier;
+	const char			*Name;
+	FSymbolModule		*Module;
+	uint32_t			Rank;
+};
+
+static bool SymbolHitLess(const FSymbolHit &A, const FSymbolHit &B)
+{
+	if (A.Tier != B.Tier)
+	{
+		return A.Tier < B.Tier;
+	}
+	const size_t LengthA = strlen(A.Name);
+	const size_t LengthB = strlen(B.Name);
+	if (LengthA != LengthB)
+	{
+		return LengthA < LengthB;
+	}
+	const int32_t Order = strcmp(A.Name, B.Name);
+	return Order != 0 ? Order < 0 : A.Module->Base < B.Module->Base;
+}
+
+size_t FWinStackTraceHelper::SearchSymbols(HANDLE InProcess, const std::wstring &InModulePattern, const FSymbolQuery &InQuery, size_t InFirst, size_t InCount, std::vector<FSymbolMatch> &OutMatches)
+{
+	const std::string ModulePattern = WideToUtf8(InModulePattern.c_str());
+	FSymbolQuery ModuleGlob;
+	ModuleGlob.Parse(ModulePattern.c_str(), false);
+
+	std::vector<FSymbolHit> Hits;
+	std::vector<uint32_t> Ranks;
+	for (size_t k = 0; k < sSymbolModules.size(); k++)
+	{
+		FSymbolModule *pModule = sSymbolModules[k];
+		if (!ModulePattern.empty() && !MatchModuleName(pModule, ModulePattern, ModuleGlob))
+		{
+			continue;
+		}
+		if (!pModule->bIndexBuilt)
+		{
+			BuildSymbolIndex(InProcess, pModule);
+		}
+
+		pModule->Search.Search(InQuery, pModule->Index, Ranks);
+		for (size_t i = 0; i < Ranks.size(); i++)
+		{
+			FModuleSymbolIndex::FSymbol Symbol;
+			pModule->Index.GetSymbol(Ranks[i], Symbol);
+
+			FSymbolHit Hit;
+			Hit.Tier = InQuery.Rank(Symbol.Name);
+			Hit.Name = Symbol.Name;
+			Hit.Module = pModule;
+			Hit.Rank = Ranks[i];
+			Hits.push_back(Hit);
+		} // end for i
+	} // end for k
+
+	// only the hits up to the page are ordered
+	const size_t Last = InFirst + InCount < Hits.size() ? InFirst + InCount : Hits.size();
+	if (InFirst >= Last)
+	{
+		return Hits.size();
+	}
+	std::partial_sort(Hits.begin(), Hits.begin() + Last, Hits.end(), &SymbolHitLess);
+
+	for (size_t k = InFirst; k < Last; k++)
+	{
+		const FSymbolHit &Hit = Hits[k];
+		FModuleSymbolIndex::FSymbol Symbol;
+		Hit.Module->Index.GetSymbol(Hit.Rank, Symbol);
+
+		FSymbolMatch Match;
+		Match.Address = Hit.Module->Base + Symbol.Rva;
+		Match.Size = Symbol.Size;
+		Match.ModuleName = GetPdbFileName(Hit.Module->ImageName);
+		Match.Name = Utf8ToWide(Symbol.Name);
+		OutMatches.push_back(Match);
+	} // end for k
+	return Hits.size();
+}
+
+// a module dbghelp has loaded, with its headers and PDB key. the symbol store starts fetching its PDB.
+static FSymbolModule* CreateSymbolModule(HANDLE InProcess, DWORD64 InModuleBase)
+{
+	IMAGEHLP_MODULE64 ImageHelpModule;
+	ImageHelpModule.SizeOfStruct = sizeof(ImageHelpModule);
+	if (!SymGetModuleInfo64(InProcess, InModuleBase, &ImageHelpModule))
+	{
+		return NULL;
+	}
+
+	FSymbolModule *pModule = new FSymbolModule();
+	pModule->Base = InModuleBase;
+	pModule->Size = ImageHelpModule.ImageSize;
+	pModule->ImageName = ImageHelpModule.ImageName;
+	pModule->PdbName = ImageHelpModule.LoadedPdbName;
+	memcpy(&pModule->PdbGuid, &ImageHelpModule.PdbSig70, sizeof(pModule->PdbGuid));
+	pModule->PdbAge = ImageHelpModule.PdbAge;
+	pModule->bIndexBuilt = false;
+
+	// one read for the headers, they must describe the module dbghelp loaded.
+	FProcessMemory Memory(InProcess);
+	if (pModule->Image.OpenRemote(Memory, InModuleBase) && pModule->Image.GetSizeOfImage() == ImageHelpModule.ImageSize)
+	{
+		FPeCodeView CodeView;
+		if (pModule->Image.ReadRemoteDebugData(Memory) && pModule->Image.GetCodeView(CodeView))
+		{
+			pModule->PdbGuid = CodeView.Guid;
+			pModule->PdbAge = CodeView.Age;
+			if (pModule->PdbName.empty())
+			{
+				pModule->PdbName = Utf8ToWide(CodeView.PdbPath);
+			}
+		}
+		if (pModule->Image.Is64Bit())
+		{
+			pModule->Image.ReadRemoteDirectory(Memory, NSPeImage::DIRECTORY_EXCEPTION);
+		}
+	}
+	else
+	{
+		pModule->Image.Close();
+	}
+
+	// the download overlaps with the debuggee running, the first lookup into the module waits for it.
+	// nothing to fetch if the build output or a symbol cache file has the PDB.
+	if (HasPdbKey(pModule) && GetFileAttributes(pModule->PdbName.c_str()) == INVALID_FILE_ATTRIBUTES)
+	{
+		const std::wstring CachePath = GetSymbolCachePath(pModule);
+		if (CachePath.empty() || GetFileAttributes(CachePath.c_str()) == INVALID_FILE_ATTRIBUTES)
+		{
+			sSymbolStore.Prefetch(GetPdbFileName(pModule->PdbName), pModule->PdbGuid, pModule->PdbAge);
+		}
+	}
+
+	return pModule;
+}
+
+// the unwinder copies the .pdata, the module keeps nothing for it
+static void AddUnwindModule(const FSymbolModule *InModule)
+{
+	if (InModule->Image.IsOpen() && InModule->Image.Is64Bit())
+	{
+		sX64Unwinder.AddModule(InModule->Base, InModule->Size, InModule->Image);
+	}
+}
+
+static bool SymbolModuleLess(const FSymbolModule *A, const FSymbolModule *B)
+{
+	return A->Base < B->Base;
+}
+
+// biggest images first, their PDBs take the longest
+static bool SymbolModuleSizeGreater(const FSymbolModule *A, const FSymbolModule *B)
+{
+	return A->Size > B->Size;
+}
+
+struct FModuleBuildBatch
+{
+	HANDLE							Process;
+	std::vector<FSymbolModule*>		Modules;
+};
+
+static void BuildSymbolIndexTask(void *InContext, uint32_t InTaskIndex)
+{
+	FModuleBuildBatch *pBatch = reinterpret_cast<FModuleBuildBatch*>(InContext);
+	BuildSymbolIndex(pBatch->Process, pBatch->Modules[InTaskIndex], true);
+}
+
+static double MillisecondsSince(const std::chrono::steady_clock::time_point &InStart)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - InStart).count();
+}
+
+void FWinStackTraceHelper::RegisterModule(HANDLE InProcess, DWORD64 InModuleBase)
+{
+	FSymbolModule *pModule = CreateSymbolModule(InProcess, InModuleBase);
+	if (!pModule)
+	{
+		return;
+	}
+
+	UnregisterModule(InModuleBase);
+
+	std::vector<FSymbolModule*>::iterator Itr = std::upper_bound(sSymbolModules.begin(), sSymbolModules.end(), InModuleBase, &SymbolModuleBaseLess);
+	sSymbolModules.insert(Itr, pModule);
+	AddUnwindModule(pModule);
+}
+
+void FWinStackTraceHelper::RegisterModules(HANDLE InProcess, const std::vector<DWORD64> &InModuleBases, FModuleLoadTimes &OutTimes)
+{
+	std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+
+	FModuleBuildBatch Batch;
+	Batch.Process = InProcess;
+	for (size_t k = 0; k < InModuleBases.size(); k++)
+	{
+		FSymbolModule *pModule = CreateSymbolModule(InProcess, InModuleBases[k]);
+		if (pModule)
+		{
+			Batch.Modules.push_back(pModule);
+		}
+	} // end for k
+	OutTimes.HeadersMs = MillisecondsSince(Start);
+
+	// created before the workers race for it
+	GetSymbolCacheDir();
+
+	Start = std::chrono::steady_clock::now();
+	std::sort(Batch.Modules.begin(), Batch.Modules.end(), &SymbolModuleSizeGreater);
+	OutTimes.ThreadCount = FTaskPool::ParallelFor((uint32_t)Batch.Modules.size(), &BuildSymbolIndexTask, &Batch);
+	OutTimes.SymbolsMs = MillisecondsSince(Start);
+
+	// all modules become visible at once
+	Start = std::chrono::steady_clock::now();
+	OutTimes.ModuleCount = (DWORD)Batch.Modules.size();
+	OutTimes.DeferredCount = 0;
+	for (size_t k = 0; k < Batch.Modules.size(); k++)
+	{
+		UnregisterModule(Batch.Modules[k]->Base);
+		AddUnwindModule(Batch.Modules[k]);
+		OutTimes.DeferredCount += Batch.Modules[k]->bIndexBuilt ? 0 : 1;
+	} // end for k
+	sSymbolModules.insert(sSymbolModules.end(), Batch.Modules.begin(), Batch.Modules.end());
+	std::sort(sSymbolModules.begin(), sSymbolModules.end(), &SymbolModuleLess);
+	OutTimes.CommitMs = MillisecondsSince(Start);
+}
+
+bool FWinStackTraceHelper::HasModule(DWORD64 InModuleBase)
+{
+	std::vector<FSymbolModule*>::iterator Itr = std::upper_bound(sSymbolModules.begin(), sSymbolModules.end(), InModuleBase, &SymbolModuleBaseLess);
+	return Itr != sSymbolModules.begin() && (*(Itr - 1))->Base == InModuleBase;
+}
+
+bool FWinStackTraceHelper::FindCachedType(HANDLE InProcess, DWORD64 InModuleBase, const std::wstring &InName, DWORD64 &OutTypeModule, DWORD &OutTypeId)
+{
+	FSymbolModule *pModule = FindSymbolModule(InProcess, InModuleBase);
+	if (!pModule || pModule->Types.IsEmpty())
+	{
+		return false;
+	}
+
+	OutTypeId = pModule->Types.FindType(WideToUtf8(InName.c_str()).c_str());
+	if (!OutTypeId)
+	{
+		return false;
+	}
+
+	// the types stay mapped until the module is unregistered
+	FSymTypeInfoHelper::RegisterTypeSource(pModule->Base, &pModule->Types);
+	OutTypeModule = FSymTypeInfoHelper::GetTypeSourceKey(pModule->Base);
+	return true;
+}
+
+void FWinStackTraceHelper::UnregisterModule(DWORD64 InModuleBase)
+{
+	for (size_t k = 0; k < sSymbolModules.size(); k++)
+	{
+		if (sSymbolModules[k]->Base == InModuleBase)
+		{
+			sX64Unwinder.RemoveModule(InModuleBase);
+			FSymTypeInfoHelper::UnregisterTypeSource(InModuleBase);
+			delete sSymbolModules[k];
+			sSymbolModules.erase(sSymbolModules.begin() + k);
+			break;
+		}
+	} // end for k
+}
+
+void FWinStackTraceHelper::InitializeSymbolStore()
+{
+	TCHAR szSearchPath[4096];
+	const DWORD dwLength = GetEnvironmentVariable(TEXT("_NT_SYMBOL_PATH"), szSearchPath, XARRAY_COUNT(szSearchPath));
+	sSymbolStore.SetSearchPath((dwLength && dwLength < XARRAY_COUNT(szSearchPath)) ? szSearchPath : TEXT(""), GetSymbolCacheDir());
+}
+
+void FWinStackTraceHelper::ClearModules()
+{
+	sSymbolStore.CancelPending();
+
+	for (size_t k = 0; k < sSymbolModules.size(); k++)
+	{
+		FSymTypeInfoHelper::UnregisterTypeSource(sSymbolModules[k]->Base);
+		delete sSymbolModules[k];
+	} // end for k
+	sSymbolModules.clear();
+	sX64Unwinder.Clear();
+}
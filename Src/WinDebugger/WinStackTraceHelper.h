@@ -7,12 +7,83 @@
 #include <Windows.h>
 #include <dbghelp.h>
 #include <string>
+#include <vector>
 
+class FSymbolQuery;
+
+// where the time of RegisterModules() went
+struct FModuleLoadTimes
+{
+	double		HeadersMs;		// module info and image headers, serial
+	double		SymbolsMs;		// symbol caches and PDBs, on the thread pool
+	double		CommitMs;		// modules made visible
+	DWORD		ModuleCount;
+	DWORD		DeferredCount;	// modules that need dbghelp, indexed on first lookup
+	DWORD		ThreadCount;
+};
+
+
+// code generated for a source line
+struct FSourceLocation
+{
+	DWORD64			Address;
+	DWORD			Size;
+	DWORD			Line;
+	std::wstring	FileName;
+};
+
+// a symbol found by name
+struct FSymbolMatch
+{
+	DWORD64			Address;
+	DWORD			Size;		// 0 if unknown
+	std::wstring	ModuleName;
+	std::wstring	Name;
+};
+
+// the call stack of one thread of a capture
+struct FThreadStack
+{
+	DWORD					ThreadId;
+	bool					bCaptured;		// false if the thread could not be opened or its context read
+	std::vector<DWORD64>	BackTrace;
+};
 
 class FWinStackTraceHelper
 {
 public:
+	// the instruction of a thread context, eip or rip
+	static DWORD64 GetProgramCounter(const CONTEXT &InContext);
 	static INT CaptureStackTrace(HANDLE InProcess, HANDLE InThread, const CONTEXT &InContext, DWORD64* OutBackTrace, DWORD InMaxDepth);
+	// the stacks of threads stopped by a debug event, in InThreadIds order. the x64 unwinder runs on
+	// the task pool, StackWalk64 is not thread safe and walks them one after the other.
+	// returns the number of threads used.
+	static uint32_t CaptureStackTraces(HANDLE InProcess, const std::vector<DWORD> &InThreadIds, DWORD InMaxDepth, std::vector<FThreadStack> &OutStacks);
 	static std::wstring ProgramCounterToSymbolInfo(HANDLE InProcess, DWORD64 InProgramCounter);
+	static bool ProgramCounterToLine(HANDLE InProcess, DWORD64 InProgramCounter, std::wstring &OutFileName, DWORD &OutLine, DWORD &OutDisplacement);
+	// file name may be a trailing part of the path, a line without code binds to the next one.
+	static void SourceLineToAddresses(HANDLE InProcess, const std::wstring &InFileName, DWORD InLine, std::vector<FSourceLocation> &OutLocations);
+	// symbols of every module matching InModulePattern, a file name with or without extension and * or ?,
+	// empty for all modules. matches are ranked by FSymbolQuery::Rank(), InCount of them from InFirst
+	// are returned, the result is the total number of matches.
+	static size_t SearchSymbols(HANDLE InProcess, const std::wstring &InModulePattern, const FSymbolQuery &InQuery, size_t InFirst, size_t InCount, std::vector<FSymbolMatch> &OutMatches);
+
+	// modules with a symbol index, the index is built on the first lookup into the module.
+	// the index, line table and PDB types of a module are kept in a symbol cache file keyed by the PDB
+	// GUID and age, later sessions map it instead of reading the PDB.
+	// a module without a local PDB queues a symbol store lookup, see InitializeSymbolStore().
+	static void RegisterModule(HANDLE InProcess, DWORD64 InModuleBase);
+	// modules loaded by dbghelp in a burst, at attach. their symbols are built on a thread pool and
+	// the modules are registered in one step, the attach takes about as long as the largest PDB.
+	static void RegisterModules(HANDLE InProcess, const std::vector<DWORD64> &InModuleBases, FModuleLoadTimes &OutTimes);
+	static bool HasModule(DWORD64 InModuleBase);
+	static void UnregisterModule(DWORD64 InModuleBase);
+	static void ClearModules();
+	// symbol stores from _NT_SYMBOL_PATH, downloads of http stores without a downstream cache go to the symbol cache directory.
+	static void InitializeSymbolStore();
+	// a UDT or enum of the module by name, from the PDB types of its symbol cache. the ids are PDB type
+	// indices, the type is built with OutTypeModule, see FSymTypeInfoHelper::GetTypeSourceKey().
+	// false if the module has no cached types or none of that name.
+	static bool FindCachedType(HANDLE InProcess, DWORD64 InModuleBase, const std::wstring &InName, DWORD64 &OutTypeModule, DWORD &OutTypeId);
 };
 
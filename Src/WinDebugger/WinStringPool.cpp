@@ -0,0 +1,126 @@
+// \brief
+//		interned strings.
+//
+
+#include "WinStringPool.h"
+
+#include <cstring>
+#include <cwchar>
+
+
+static const uint32_t kInitialSlots = 1024;
+
+FStringPool::FStringPool()
+	: TextBytes(0)
+{
+	Clear();
+}
+
+// FNV-1a
+uint32_t FStringPool::HashString(const wchar_t *InText, size_t InLength)
+{
+	uint32_t Hash = 2166136261u;
+	for (size_t k = 0; k < InLength; k++)
+	{
+		Hash = (Hash ^ (uint32_t)InText[k]) * 16777619u;
+	} // end for k
+	return Hash;
+}
+
+// the slot holding the string, or the empty slot it would go to
+uint32_t FStringPool::FindSlot(const wchar_t *InText, size_t InLength, uint32_t InHash) const
+{
+	const uint32_t Mask = (uint32_t)Slots.size() - 1;
+	uint32_t Slot = InHash & Mask;
+	while (Slots[Slot])
+	{
+		const uint32_t Id = Slots[Slot] - 1;
+		if (Hashes[Id] == InHash)
+		{
+			const std::wstring &String = Strings[Id];
+			if (String.size() == InLength && wmemcmp(String.c_str(), InText, InLength) == 0)
+			{
+				break;
+			}
+		}
+		Slot = (Slot + 1) & Mask;
+	} // end while
+	return Slot;
+}
+
+void FStringPool::Grow()
+{
+	Slots.assign(Slots.size() * 2, 0);
+	const uint32_t Mask = (uint32_t)Slots.size() - 1;
+	for (uint32_t Id = 0; Id < (uint32_t)Strings.size(); Id++)
+	{
+		uint32_t Slot = Hashes[Id] & Mask;
+		while (Slots[Slot])
+		{
+			Slot = (Slot + 1) & Mask;
+		}
+		Slots[Slot] = Id + 1;
+	} // end for Id
+}
+
+uint32_t FStringPool::Intern(const wchar_t *InText)
+{
+	return InText ? Intern(InText, wcslen(InText)) : kEmptyId;
+}
+
+uint32_t FStringPool::Intern(const wchar_t *InText, size_t InLength)
+{
+	if (!InText || InLength == 0)
+	{
+		return kEmptyId;
+	}
+
+	const uint32_t Hash = HashString(InText, InLength);
+	uint32_t Slot = FindSlot(InText, InLength, Hash);
+	if (Slots[Slot])
+	{
+		return Slots[Slot] - 1;
+	}
+
+	const uint32_t Id = (uint32_t)Strings.size();
+	Strings.push_back(std::wstring(InText, InLength));
+	Hashes.push_back(Hash);
+	TextBytes += (InLength + 1) * sizeof(wchar_t);
+	Slots[Slot] = Id + 1;
+
+	// at most half full
+	if (Strings.size() * 2 > Slots.size())
+	{
+		Grow();
+	}
+	return Id;
+}
+
+uint32_t FStringPool::Find(const wchar_t *InText, size_t InLength) const
+{
+	if (!InText || InLength == 0)
+	{
+		return kEmptyId;
+	}
+
+	const uint32_t Slot = FindSlot(InText, InLength, HashString(InText, InLength));
+	return Slots[Slot] ? Slots[Slot] - 1 : kEmptyId;
+}
+
+size_t FStringPool::GetMemoryUsage() const
+{
+	return Strings.size() * sizeof(std::wstring) + TextBytes + Hashes.capacity() * sizeof(uint32_t) + Slots.capacity() * sizeof(uint32_t);
+}
+
+void FStringPool::Clear()
+{
+	Strings.clear();
+	Hashes.clear();
+	Slots.assign(kInitialSlots, 0);
+	TextBytes = 0;
+
+	// kEmptyId
+	Strings.push_back(std::wstring());
+	Hashes.push_back(HashString(NULL, 0));
+	Slots[Hashes[0] & (kInitialSlots - 1)] = kEmptyId + 1;
+}
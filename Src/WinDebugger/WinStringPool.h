@@ -0,0 +1,52 @@
+// \brief
+//		interned strings. each distinct string is stored once and named by a 32-bit id that stays
+//		valid for the life of the pool, two ids of a pool are equal only if their strings are.
+//		hashes are computed once, when a string is added.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <deque>
+
+
+class FStringPool
+{
+public:
+	// the id of the empty string
+	static const uint32_t kEmptyId = 0;
+
+	FStringPool();
+
+	// id of the string, added on first use. NULL is the empty string.
+	uint32_t Intern(const wchar_t *InText);
+	uint32_t Intern(const wchar_t *InText, size_t InLength);
+	uint32_t Intern(const std::wstring &InText) { return Intern(InText.c_str(), InText.size()); }
+	// id of a string already in the pool, kEmptyId if it is not.
+	uint32_t Find(const wchar_t *InText, size_t InLength) const;
+
+	const std::wstring& GetString(uint32_t InId) const { return Strings[InId]; }
+	uint32_t GetHash(uint32_t InId) const { return Hashes[InId]; }
+	size_t GetCount() const { return Strings.size(); }
+	size_t GetMemoryUsage() const;
+
+	// ids handed out before are invalid.
+	void Clear();
+
+	static uint32_t HashString(const wchar_t *InText, size_t InLength);
+
+private:
+	FStringPool(const FStringPool&);
+	FStringPool& operator=(const FStringPool&);
+
+	uint32_t FindSlot(const wchar_t *InText, size_t InLength, uint32_t InHash) const;
+	void Grow();
+
+	std::deque<std::wstring>	Strings;	// by id, the addresses never change
+	std::vector<uint32_t>		Hashes;		// by id
+	std::vector<uint32_t>		Slots;		// open addressing, id + 1, 0 is empty
+	size_t						TextBytes;
+};
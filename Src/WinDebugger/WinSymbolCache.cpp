@@ -0,0 +1,200 @@
+// \brief
+//		on-disk cache of the per module symbol data.
+//
+
+#include "WinSymbolCache.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+
+static const char kSymbolCacheMagic[8] = { 'W', 'D', 'S', 'Y', 'M', 'C', 'H', 'E' };
+// bump when a cached record layout changes
+static const uint32_t kSymbolCacheVersion = 1;
+
+struct FSymbolCacheHeader
+{
+	char		Magic[8];
+	uint32_t	Version;
+	uint32_t	Age;
+	FPdbGuid	Guid;
+	uint64_t	PayloadSize;
+};
+
+struct FSymbolCacheArray
+{
+	uint32_t	ElementSize;
+	uint32_t	Reserved;
+	uint64_t	Count;
+};
+
+static inline uint64_t AlignTo8(uint64_t InValue)
+{
+	return (InValue + 7) & ~(uint64_t)7;
+}
+
+static FILE* OpenFileForWrite(const std::wstring &InFilename)
+{
+#if defined(_WIN32)
+	return _wfopen(InFilename.c_str(), L"wb");
+#else
+	std::vector<char> Filename(InFilename.size() * 4 + 1);
+	if (wcstombs(&Filename[0], InFilename.c_str(), Filename.size()) == (size_t)-1)
+	{
+		return NULL;
+	}
+	return fopen(&Filename[0], "wb");
+#endif
+}
+
+static bool ReplaceFile(const std::wstring &InFrom, const std::wstring &InTo)
+{
+#if defined(_WIN32)
+	_wremove(InTo.c_str());
+	return _wrename(InFrom.c_str(), InTo.c_str()) == 0;
+#else
+	std::vector<char> From(InFrom.size() * 4 + 1), To(InTo.size() * 4 + 1);
+	if (wcstombs(&From[0], InFrom.c_str(), From.size()) == (size_t)-1 || wcstombs(&To[0], InTo.c_str(), To.size()) == (size_t)-1)
+	{
+		return false;
+	}
+	return rename(&From[0], &To[0]) == 0;
+#endif
+}
+
+static void RemoveFile(const std::wstring &InFilename)
+{
+#if defined(_WIN32)
+	_wremove(InFilename.c_str());
+#else
+	std::vector<char> Filename(InFilename.size() * 4 + 1);
+	if (wcstombs(&Filename[0], InFilename.c_str(), Filename.size()) != (size_t)-1)
+	{
+		remove(&Filename[0]);
+	}
+#endif
+}
+
+FSymbolCacheWriter::FSymbolCacheWriter()
+{
+}
+
+void FSymbolCacheWriter::WriteArray(const void *InData, uint32_t InElementSize, uint64_t InCount)
+{
+	FSymbolCacheArray Array;
+	Array.ElementSize = InElementSize;
+	Array.Reserved = 0;
+	Array.Count = InCount;
+
+	const size_t Offset = Payload.size();
+	const uint64_t Bytes = (uint64_t)InElementSize * InCount;
+	Payload.resize((size_t)AlignTo8(Offset + sizeof(Array) + Bytes), 0);
+
+	memcpy(&Payload[Offset], &Array, sizeof(Array));
+	if (Bytes)
+	{
+		memcpy(&Payload[Offset + sizeof(Array)], InData, (size_t)Bytes);
+	}
+}
+
+bool FSymbolCacheWriter::Save(const std::wstring &InFilename, const FPdbGuid &InGuid, uint32_t InAge) const
+{
+	FSymbolCacheHeader Header;
+	memset(&Header, 0, sizeof(Header));
+	memcpy(Header.Magic, kSymbolCacheMagic, sizeof(Header.Magic));
+	Header.Version = kSymbolCacheVersion;
+	Header.Age = InAge;
+	Header.Guid = InGuid;
+	Header.PayloadSize = Payload.size();
+
+	const std::wstring TempFilename = InFilename + L".tmp";
+	FILE *fp = OpenFileForWrite(TempFilename);
+	if (!fp)
+	{
+		return false;
+	}
+
+	bool bWritten = fwrite(&Header, sizeof(Header), 1, fp) == 1;
+	if (bWritten && !Payload.empty())
+	{
+		bWritten = fwrite(&Payload[0], Payload.size(), 1, fp) == 1;
+	}
+	bWritten = (fclose(fp) == 0) && bWritten;
+
+	if (!bWritten || !ReplaceFile(TempFilename, InFilename))
+	{
+		RemoveFile(TempFilename);
+		return false;
+	}
+	return true;
+}
+
+FSymbolCacheReader::FSymbolCacheReader()
+	: Cursor(0)
+{
+}
+
+bool FSymbolCacheReader::Open(const std::wstring &InFilename, const FPdbGuid &InGuid, uint32_t InAge)
+{
+	Close();
+
+	if (!File.Open(InFilename) || File.GetSize() < sizeof(FSymbolCacheHeader))
+	{
+		Close();
+		return false;
+	}
+
+	FSymbolCacheHeader Header;
+	memcpy(&Header, File.GetData(), sizeof(Header));
+	if (memcmp(Header.Magic, kSymbolCacheMagic, sizeof(Header.Magic)) != 0 || Header.Version != kSymbolCacheVersion
+		|| Header.Age != InAge || memcmp(&Header.Guid, &InGuid, sizeof(FPdbGuid)) != 0
+		|| Header.PayloadSize != File.GetSize() - sizeof(Header))
+	{
+		Close();
+		return false;
+	}
+
+	Cursor = sizeof(Header);
+	return true;
+}
+
+void FSymbolCacheReader::Close()
+{
+	File.Close();
+	Cursor = 0;
+}
+
+bool FSymbolCacheReader::ReadArray(const void *&OutData, uint32_t InElementSize, uint64_t &OutCount)
+{
+	const uint64_t FileSize = File.GetSize();
+	if (!File.IsOpen() || FileSize - Cursor < sizeof(FSymbolCacheArray))
+	{
+		return false;
+	}
+
+	FSymbolCacheArray Array;
+	memcpy(&Array, File.GetData() + Cursor, sizeof(Array));
+	if (Array.ElementSize != InElementSize || Array.Count > (FileSize - Cursor - sizeof(Array)) / InElementSize)
+	{
+		return false;
+	}
+
+	OutData = File.GetData() + Cursor + sizeof(Array);
+	OutCount = Array.Count;
+	Cursor = AlignTo8(Cursor + sizeof(Array) + Array.Count * InElementSize);
+	return true;
+}
+
+bool FSymbolCacheReader::ReadValue(uint64_t &OutValue)
+{
+	const uint64_t *Data = NULL;
+	uint64_t Count = 0;
+	if (!ReadArray(Data, Count) || Count != 1)
+	{
+		return false;
+	}
+
+	OutValue = *Data;
+	return true;
+}
@@ -0,0 +1,83 @@
+// \brief
+//		on-disk cache of the per module symbol data, keyed by PDB GUID and age.
+//		a file is a header followed by arrays of plain records, each 8 byte aligned and prefixed by its
+//		element size and count. there are no pointers, the reader maps the file and hands out the
+//		arrays in place.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "Foundation/AppMappedFile.h"
+#include "WinPdbReader.h"
+
+
+class FSymbolCacheWriter
+{
+public:
+	FSymbolCacheWriter();
+
+	// arrays are read back in the order they were written.
+	void WriteArray(const void *InData, uint32_t InElementSize, uint64_t InCount);
+	void WriteValue(uint64_t InValue) { WriteArray(&InValue, sizeof(InValue), 1); }
+
+	template <typename T>
+	void WriteArray(const std::vector<T> &InArray)
+	{
+		WriteArray(InArray.empty() ? NULL : &InArray[0], sizeof(T), InArray.size());
+	}
+
+	// writes a temporary file and renames it, a reader never sees a partial file.
+	bool Save(const std::wstring &InFilename, const FPdbGuid &InGuid, uint32_t InAge) const;
+
+private:
+	std::vector<uint8_t>	Payload;
+};
+
+class FSymbolCacheReader
+{
+public:
+	FSymbolCacheReader();
+
+	// fails if the file is missing, truncated, of another version or of another PDB.
+	bool Open(const std::wstring &InFilename, const FPdbGuid &InGuid, uint32_t InAge);
+	void Close();
+	bool IsOpen() const { return File.IsOpen(); }
+
+	// the next array, it points into the mapping and stays valid until Close().
+	bool ReadArray(const void *&OutData, uint32_t InElementSize, uint64_t &OutCount);
+	bool ReadValue(uint64_t &OutValue);
+
+	template <typename T>
+	bool ReadArray(const T *&OutData, uint64_t &OutCount)
+	{
+		const void *Data = NULL;
+		if (!ReadArray(Data, sizeof(T), OutCount))
+		{
+			return false;
+		}
+		OutData = (const T *)Data;
+		return true;
+	}
+
+	template <typename T>
+	bool ReadArray(std::vector<T> &OutArray)
+	{
+		const T *Data = NULL;
+		uint64_t Count = 0;
+		if (!ReadArray(Data, Count))
+		{
+			return false;
+		}
+		OutArray.assign(Data, Data + Count);
+		return true;
+	}
+
+private:
+	FMappedFile		File;
+	uint64_t		Cursor;
+};
@@ -0,0 +1,255 @@
+// \brief
+//		per module address -> symbol index.
+//
+// ref: Khuong, Morin. Array Layouts for Comparison-Based Searching.
+//
+
+#include "WinSymbolIndex.h"
+#include "WinSymbolCache.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+// index of the lowest set bit, InValue != 0
+static inline uint32_t FindLowestSetBit(uint32_t InValue)
+{
+#if defined(_MSC_VER)
+	unsigned long Index;
+	_BitScanForward(&Index, InValue);
+	return Index;
+#else
+	return (uint32_t)__builtin_ctz(InValue);
+#endif
+}
+
+// FNV-1a
+static inline uint32_t HashSymbolName(const char *InName)
+{
+	uint32_t Hash = 2166136261u;
+	for (const uint8_t *Ptr = (const uint8_t *)InName; *Ptr; Ptr++)
+	{
+		Hash = (Hash ^ *Ptr) * 16777619u;
+	} // end for
+	return Hash;
+}
+
+FModuleSymbolIndex::FModuleSymbolIndex()
+{
+}
+
+void FModuleSymbolIndex::Reserve(size_t InCount, size_t InNameBytes)
+{
+	Pending.reserve(InCount);
+	StringPool.reserve(InNameBytes);
+}
+
+void FModuleSymbolIndex::AddSymbol(uint32_t InRva, uint32_t InSize, const char *InName)
+{
+	FPendingSymbol Symbol;
+	Symbol.Rva = InRva;
+	Symbol.Size = InSize;
+	Symbol.NameOffset = (uint32_t)StringPool.size();
+	Pending.push_back(Symbol);
+
+	StringPool.insert(StringPool.end(), InName, InName + strlen(InName) + 1);
+}
+
+void FModuleSymbolIndex::Clear()
+{
+	Pending.clear();
+	StringPool.clear();
+	LayoutRvas.clear();
+	LayoutRanks.clear();
+	Rvas.clear();
+	Sizes.clear();
+	NameOffsets.clear();
+	NameTable.clear();
+}
+
+// by address, symbols with a known size first
+bool FModuleSymbolIndex::PendingLess(const FPendingSymbol &A, const FPendingSymbol &B)
+{
+	if (A.Rva != B.Rva)
+	{
+		return A.Rva < B.Rva;
+	}
+	return A.Size > B.Size;
+}
+
+// in-order walk of the implicit tree assigns the sorted keys
+void FModuleSymbolIndex::BuildLayout(uint32_t InNode, uint32_t &InOutRank)
+{
+	if (InNode >= LayoutRvas.size())
+	{
+		return;
+	}
+
+	BuildLayout(2 * InNode, InOutRank);
+	LayoutRvas[InNode] = Rvas[InOutRank];
+	LayoutRanks[InNode] = InOutRank;
+	InOutRank++;
+	BuildLayout(2 * InNode + 1, InOutRank);
+}
+
+void FModuleSymbolIndex::Finalize()
+{
+	std::sort(Pending.begin(), Pending.end(), &PendingLess);
+
+	// one symbol per address
+	Rvas.clear();
+	Sizes.clear();
+	NameOffsets.clear();
+	Rvas.reserve(Pending.size());
+	Sizes.reserve(Pending.size());
+	NameOffsets.reserve(Pending.size());
+	for (size_t k = 0; k < Pending.size(); k++)
+	{
+		if (!Rvas.empty() && Rvas.back() == Pending[k].Rva)
+		{
+			continue;
+		}
+		Rvas.push_back(Pending[k].Rva);
+		Sizes.push_back(Pending[k].Size);
+		NameOffsets.push_back(Pending[k].NameOffset);
+	} // end for k
+	std::vector<FPendingSymbol>().swap(Pending);
+
+	const uint32_t Count = (uint32_t)Rvas.size();
+	LayoutRvas.assign(Count + 1, 0);
+	LayoutRanks.assign(Count + 1, 0);
+	uint32_t Rank = 0;
+	BuildLayout(1, Rank);
+
+	uint32_t Capacity = 16;
+	while (Capacity < Count * 2)
+	{
+		Capacity <<= 1;
+	}
+	NameTable.assign(Capacity, 0);
+	for (uint32_t k = 0; k < Count; k++)
+	{
+		uint32_t Slot = HashSymbolName(&StringPool[NameOffsets[k]]) & (Capacity - 1);
+		while (NameTable[Slot])
+		{
+			Slot = (Slot + 1) & (Capacity - 1);
+		}
+		NameTable[Slot] = k + 1;
+	} // end for k
+}
+
+void FModuleSymbolIndex::GetSymbol(uint32_t InRank, FSymbol &OutSymbol) const
+{
+	OutSymbol.Name = &StringPool[NameOffsets[InRank]];
+	OutSymbol.Rva = Rvas[InRank];
+	OutSymbol.Size = Sizes[InRank];
+}
+
+bool FModuleSymbolIndex::FindByAddress(uint32_t InRva, FSymbol &OutSymbol) const
+{
+	const uint32_t Count = (uint32_t)Rvas.size();
+	if (Count == 0)
+	{
+		return false;
+	}
+
+	// descend to the first key > InRva, the comparison result picks the child.
+	const uint32_t *Keys = &LayoutRvas[0];
+	uint32_t Node = 1;
+	while (Node <= Count)
+	{
+		Node = 2 * Node + (Keys[Node] <= InRva);
+	} // end while
+	// undo the trailing right turns, 0 means every key is <= InRva.
+	Node >>= FindLowestSetBit(~Node) + 1;
+
+	const uint32_t UpperRank = Node ? LayoutRanks[Node] : Count;
+	if (UpperRank == 0)
+	{
+		return false;
+	}
+
+	const uint32_t Rank = UpperRank - 1;
+	if (Sizes[Rank] && InRva - Rvas[Rank] >= Sizes[Rank])
+	{
+		return false;
+	}
+
+	GetSymbol(Rank, OutSymbol);
+	return true;
+}
+
+bool FModuleSymbolIndex::FindByName(const char *InName, FSymbol &OutSymbol) const
+{
+	if (NameTable.empty())
+	{
+		return false;
+	}
+
+	const uint32_t Mask = (uint32_t)NameTable.size() - 1;
+	for (uint32_t Slot = HashSymbolName(InName) & Mask; NameTable[Slot]; Slot = (Slot + 1) & Mask)
+	{
+		const uint32_t Rank = NameTable[Slot] - 1;
+		if (strcmp(&StringPool[NameOffsets[Rank]], InName) == 0)
+		{
+			GetSymbol(Rank, OutSymbol);
+			return true;
+		}
+	} // end for Slot
+
+	return false;
+}
+
+void FModuleSymbolIndex::Save(FSymbolCacheWriter &InWriter) const
+{
+	InWriter.WriteArray(StringPool);
+	InWriter.WriteArray(LayoutRvas);
+	InWriter.WriteArray(LayoutRanks);
+	InWriter.WriteArray(Rvas);
+	InWriter.WriteArray(Sizes);
+	InWriter.WriteArray(NameOffsets);
+	InWriter.WriteArray(NameTable);
+}
+
+bool FModuleSymbolIndex::Load(FSymbolCacheReader &InReader)
+{
+	Clear();
+
+	if (!InReader.ReadArray(StringPool) || !InReader.ReadArray(LayoutRvas) || !InReader.ReadArray(LayoutRanks)
+		|| !InReader.ReadArray(Rvas) || !InReader.ReadArray(Sizes) || !InReader.ReadArray(NameOffsets) || !InReader.ReadArray(NameTable))
+	{
+		Clear();
+		return false;
+	}
+
+	// the lookups index these without checks
+	const size_t Count = Rvas.size();
+	bool bValid = LayoutRvas.size() == Count + 1 && LayoutRanks.size() == Count + 1 && Sizes.size() == Count && NameOffsets.size() == Count
+		&& (StringPool.empty() || StringPool.back() == '\0')
+		&& NameTable.size() > Count && (NameTable.size() & (NameTable.size() - 1)) == 0;
+	for (size_t k = 0; k < Count && bValid; k++)
+	{
+		bValid = NameOffsets[k] < StringPool.size() && LayoutRanks[k + 1] < Count;
+	} // end for k
+	for (size_t k = 0; k < NameTable.size() && bValid; k++)
+	{
+		bValid = NameTable[k] <= Count;
+	} // end for k
+
+	if (!bValid)
+	{
+		Clear();
+		return false;
+	}
+	return true;
+}
+
+size_t FModuleSymbolIndex::GetMemoryUsage() const
+{
+	return StringPool.capacity() + (LayoutRvas.capacity() + LayoutRanks.capacity() + Rvas.capacity()
+		+ Sizes.capacity() + NameOffsets.capacity() + NameTable.capacity()) * sizeof(uint32_t);
+}
@@ -0,0 +1,74 @@
+// \brief
+//		per module address -> symbol index.
+//		function starts are kept in Eytzinger (BFS) order so a lookup touches one cache line per
+//		level and runs without unpredictable branches. names live in one string pool, a hash
+//		table gives the reverse name -> address lookup.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+class FSymbolCacheWriter;
+class FSymbolCacheReader;
+
+
+class FModuleSymbolIndex
+{
+public:
+	struct FSymbol
+	{
+		const char		*Name;
+		uint32_t		Rva;
+		uint32_t		Size;		// 0 if unknown
+	};
+
+	FModuleSymbolIndex();
+
+	// add symbols, then Finalize() once before any lookup.
+	void Reserve(size_t InCount, size_t InNameBytes);
+	void AddSymbol(uint32_t InRva, uint32_t InSize, const char *InName);
+	void Finalize();
+	void Clear();
+
+	// nearest symbol starting at or below InRva, fails if InRva is past a known size.
+	bool FindByAddress(uint32_t InRva, FSymbol &OutSymbol) const;
+	bool FindByName(const char *InName, FSymbol &OutSymbol) const;
+	// InRank in [0, GetCount()), symbols are sorted by address
+	void GetSymbol(uint32_t InRank, FSymbol &OutSymbol) const;
+
+	size_t GetCount() const { return Rvas.size(); }
+	size_t GetMemoryUsage() const;
+
+	// symbol cache, Save() after Finalize(), Load() replaces Finalize().
+	void Save(FSymbolCacheWriter &InWriter) const;
+	bool Load(FSymbolCacheReader &InReader);
+
+protected:
+	struct FPendingSymbol
+	{
+		uint32_t	Rva;
+		uint32_t	Size;
+		uint32_t	NameOffset;
+	};
+
+	static bool PendingLess(const FPendingSymbol &A, const FPendingSymbol &B);
+	void BuildLayout(uint32_t InNode, uint32_t &InOutRank);
+
+	std::vector<FPendingSymbol>	Pending;
+	std::vector<char>			StringPool;
+
+	// Eytzinger order, slot 0 unused
+	std::vector<uint32_t>		LayoutRvas;
+	std::vector<uint32_t>		LayoutRanks;
+
+	// sorted order
+	std::vector<uint32_t>		Rvas;
+	std::vector<uint32_t>		Sizes;
+	std::vector<uint32_t>		NameOffsets;
+
+	// open addressing, rank + 1, 0 is empty
+	std::vector<uint32_t>		NameTable;
+};
@@ -0,0 +1,578 @@
+// \brief
+//		symbol name search.
+//
+// ref: Russ Cox. Regular Expression Matching with a Trigram Index.
+//
+
+#include "WinSymbolSearch.h"
+#include "WinSymbolIndex.h"
+
+#include <algorithm>
+#include <cstring>
+
+
+static const uint32_t kKeySpace = 1 << 18;
+static const uint32_t kKeyMask = kKeySpace - 1;
+static const uint32_t kNoRank = 0xFFFFFFFF;
+// postings lists intersected before the names are checked
+static const size_t kMaxIntersections = 4;
+
+// characters folded to 6 bits: case is ignored, the punctuation of C++ names keeps its own codes
+struct FFoldTable
+{
+	uint8_t		Codes[256];
+
+	FFoldTable()
+	{
+		static const char Punctuation[] = "_:<>~, *&()`'";
+		for (uint32_t k = 0; k < 256; k++)
+		{
+			Codes[k] = (uint8_t)(50 + k % 14);
+		} // end for k
+		for (uint32_t k = 0; k < 26; k++)
+		{
+			Codes['a' + k] = (uint8_t)(1 + k);
+			Codes['A' + k] = (uint8_t)(1 + k);
+		} // end for k
+		for (uint32_t k = 0; k < 10; k++)
+		{
+			Codes['0' + k] = (uint8_t)(27 + k);
+		} // end for k
+		for (uint32_t k = 0; Punctuation[k]; k++)
+		{
+			Codes[(uint8_t)Punctuation[k]] = (uint8_t)(37 + k);
+		} // end for k
+	}
+};
+
+static const uint8_t* GetFoldTable()
+{
+	static const FFoldTable sTable;
+	return sTable.Codes;
+}
+
+static inline char ToLower(char InChar)
+{
+	return (InChar >= 'A' && InChar <= 'Z') ? (char)(InChar - 'A' + 'a') : InChar;
+}
+
+static inline uint32_t VarintSize(uint32_t InValue)
+{
+	uint32_t Size = 1;
+	while (InValue >= 0x80)
+	{
+		InValue >>= 7;
+		Size++;
+	} // end while
+	return Size;
+}
+
+// first occurrence of InLower in InName ignoring case, InLower is lower case
+static const char* FindNoCase(const char *InName, const std::string &InLower)
+{
+	const size_t Length = InLower.size();
+	if (Length == 0)
+	{
+		return InName;
+	}
+
+	const char First = InLower[0];
+	for (const char *Ptr = InName; *Ptr; Ptr++)
+	{
+		if (ToLower(*Ptr) != First)
+		{
+			continue;
+		}
+		size_t k = 1;
+		while (k < Length && Ptr[k] && ToLower(Ptr[k]) == InLower[k])
+		{
+			k++;
+		}
+		if (k == Length)
+		{
+			return Ptr;
+		}
+	} // end for Ptr
+	return NULL;
+}
+
+static bool StartsWithNoCase(const char *InName, const std::string &InLower)
+{
+	for (size_t k = 0; k < InLower.size(); k++)
+	{
+		if (ToLower(InName[k]) != InLower[k])
+		{
+			return false;
+		}
+	} // end for k
+	return true;
+}
+
+// * any run, ? one character, the whole name must match
+static bool GlobMatchNoCase(const char *InPattern, const char *InName)
+{
+	const char *Star = NULL;
+	const char *Resume = NULL;
+	while (*InName)
+	{
+		if (*InPattern == '*')
+		{
+			Star = InPattern++;
+			Resume = InName;
+		}
+		else if (*InPattern && (*InPattern == '?' || *InPattern == ToLower(*InName)))
+		{
+			InPattern++;
+			InName++;
+		}
+		else if (Star)
+		{
+			InPattern = Star + 1;
+			InName = ++Resume;
+		}
+		else
+		{
+			return false;
+		}
+	} // end while
+
+	while (*InPattern == '*')
+	{
+		InPattern++;
+	}
+	return *InPattern == 0;
+}
+
+// the name after the last scope operator outside template arguments
+static const char* GetUnqualifiedName(const char *InName)
+{
+	const char *Unqualified = InName;
+	int32_t Depth = 0;
+	for (const char *Ptr = InName; *Ptr; Ptr++)
+	{
+		if (*Ptr == '<')
+		{
+			Depth++;
+		}
+		else if (*Ptr == '>')
+		{
+			Depth--;
+		}
+		else if (Depth == 0 && Ptr[0] == ':' && Ptr[1] == ':')
+		{
+			Unqualified = Ptr + 2;
+		}
+	} // end for Ptr
+	return Unqualified;
+}
+
+static inline bool IsLiteralChar(char InChar)
+{
+	return (InChar >= 'a' && InChar <= 'z') || (InChar >= 'A' && InChar <= 'Z') || (InChar >= '0' && InChar <= '9')
+		|| InChar == '_' || InChar == ':' || InChar == '<' || InChar == '>' || InChar == '~' || InChar == ',' || InChar == ' ';
+}
+
+// runs of characters every match of a regex contains. groups are skipped, alternatives outside a
+// group give up, a quantified character ends the run before it.
+static void GetRegexLiterals(const std::string &InPattern, std::vector<std::string> &OutLiterals)
+{
+	std::string Run;
+	int32_t GroupDepth = 0;
+	for (size_t k = 0; k < InPattern.size(); k++)
+	{
+		const char Char = InPattern[k];
+		if (Char == '?' || Char == '*' || Char == '{')
+		{
+			// the character before is optional
+			if (!Run.empty())
+			{
+				Run.erase(Run.size() - 1);
+			}
+			OutLiterals.push_back(Run);
+			Run.clear();
+			if (Char == '{')
+			{
+				const size_t Close = InPattern.find('}', k);
+				k = Close == std::string::npos ? InPattern.size() : Close;
+			}
+		}
+		else if (Char == '\\')
+		{
+			// classes and escapes
+			OutLiterals.push_back(Run);
+			Run.clear();
+			k++;
+		}
+		else if (Char == '[')
+		{
+			OutLiterals.push_back(Run);
+			Run.clear();
+			const size_t Close = InPattern.find(']', k + 2);
+			k = Close == std::string::npos ? InPattern.size() : Close;
+		}
+		else if (Char == '|' && GroupDepth == 0)
+		{
+			OutLiterals.clear();
+			return;
+		}
+		else if (Char == '(' || Char == ')')
+		{
+			OutLiterals.push_back(Run);
+			Run.clear();
+			GroupDepth += Char == '(' ? 1 : -1;
+		}
+		else if (GroupDepth == 0 && IsLiteralChar(Char))
+		{
+			Run += Char;
+		}
+		else
+		{
+			// . ^ $ + and anything inside a group
+			OutLiterals.push_back(Run);
+			Run.clear();
+		}
+	} // end for k
+	OutLiterals.push_back(Run);
+}
+
+FSymbolQuery::FSymbolQuery()
+	: Mode(MODE_SUBSTRING)
+{
+}
+
+bool FSymbolQuery::Parse(const char *InPattern, bool bInRegex)
+{
+	Pattern = InPattern;
+	LowerPattern = Pattern;
+	for (size_t k = 0; k < LowerPattern.size(); k++)
+	{
+		LowerPattern[k] = ToLower(LowerPattern[k]);
+	} // end for k
+	Trigrams.clear();
+
+	if (bInRegex)
+	{
+		Mode = MODE_REGEX;
+		try
+		{
+			Regex.assign(Pattern, std::regex::ECMAScript | std::regex::icase | std::regex::optimize);
+		}
+		catch (const std::regex_error&)
+		{
+			return false;
+		}
+
+		std::vector<std::string> Literals;
+		GetRegexLiterals(Pattern, Literals);
+		for (size_t k = 0; k < Literals.size(); k++)
+		{
+			AddTrigrams(Literals[k]);
+		} // end for k
+	}
+	else if (Pattern.find_first_of("*?") != std::string::npos)
+	{
+		Mode = MODE_GLOB;
+		size_t Start = 0;
+		while (Start < LowerPattern.size())
+		{
+			size_t Wildcard = LowerPattern.find_first_of("*?", Start);
+			if (Wildcard == std::string::npos)
+			{
+				Wildcard = LowerPattern.size();
+			}
+			AddTrigrams(LowerPattern.substr(Start, Wildcard - Start));
+			Start = Wildcard + 1;
+		} // end while
+	}
+	else
+	{
+		Mode = MODE_SUBSTRING;
+		AddTrigrams(LowerPattern);
+	}
+
+	std::sort(Trigrams.begin(), Trigrams.end());
+	Trigrams.erase(std::unique(Trigrams.begin(), Trigrams.end()), Trigrams.end());
+	return true;
+}
+
+void FSymbolQuery::AddTrigrams(const std::string &InLiteral)
+{
+	for (size_t k = 0; k + 2 < InLiteral.size(); k++)
+	{
+		Trigrams.push_back(FSymbolTrigramIndex::MakeKey(InLiteral[k], InLiteral[k + 1], InLiteral[k + 2]));
+	} // end for k
+}
+
+bool FSymbolQuery::Match(const char *InName) const
+{
+	switch (Mode)
+	{
+	case MODE_SUBSTRING:
+		return FindNoCase(InName, LowerPattern) != NULL;
+	case MODE_GLOB:
+		return GlobMatchNoCase(LowerPattern.c_str(), InName);
+	case MODE_REGEX:
+		return std::regex_search(InName, Regex);
+	}
+	return false;
+}
+
+uint32_t FSymbolQuery::Rank(const char *InName) const
+{
+	if (strcmp(InName, Pattern.c_str()) == 0)
+	{
+		return 0;
+	}
+	if (Mode != MODE_SUBSTRING)
+	{
+		return 5;
+	}
+
+	const char *Unqualified = GetUnqualifiedName(InName);
+	if (strlen(InName) == LowerPattern.size() && StartsWithNoCase(InName, LowerPattern))
+	{
+		return 1;
+	}
+	if (strlen(Unqualified) == LowerPattern.size() && StartsWithNoCase(Unqualified, LowerPattern))
+	{
+		return 2;
+	}
+	if (StartsWithNoCase(InName, LowerPattern))
+	{
+		return 3;
+	}
+	if (StartsWithNoCase(Unqualified, LowerPattern))
+	{
+		return 4;
+	}
+	return 5;
+}
+
+FSymbolTrigramIndex::FSymbolTrigramIndex()
+	: bBuilt(false)
+{
+}
+
+uint32_t FSymbolTrigramIndex::MakeKey(char InChar0, char InChar1, char InChar2)
+{
+	const uint8_t *Fold = GetFoldTable();
+	return ((uint32_t)Fold[(uint8_t)InChar0] << 12) | ((uint32_t)Fold[(uint8_t)InChar1] << 6) | Fold[(uint8_t)InChar2];
+}
+
+void FSymbolTrigramIndex::Clear()
+{
+	Keys.clear();
+	Offsets.clear();
+	Counts.clear();
+	Postings.clear();
+	bBuilt = false;
+}
+
+// two passes over the names: sizes of the postings per key, then the postings in place
+void FSymbolTrigramIndex::Build(const FModuleSymbolIndex &InIndex)
+{
+	Clear();
+
+	const uint8_t *Fold = GetFoldTable();
+	const uint32_t Count = (uint32_t)InIndex.GetCount();
+	std::vector<uint32_t> KeyCounts(kKeySpace, 0);
+	std::vector<uint32_t> KeyBytes(kKeySpace, 0);
+	std::vector<uint32_t> LastRanks(kKeySpace, kNoRank);
+
+	FModuleSymbolIndex::FSymbol Symbol;
+	for (uint32_t Rank = 0; Rank < Count; Rank++)
+	{
+		InIndex.GetSymbol(Rank, Symbol);
+		const char *Name = Symbol.Name;
+		if (!Name[0] || !Name[1])
+		{
+			continue;
+		}
+
+		uint32_t Key = ((uint32_t)Fold[(uint8_t)Name[0]] << 6) | Fold[(uint8_t)Name[1]];
+		for (const char *Ptr = Name + 2; *Ptr; Ptr++)
+		{
+			Key = ((Key << 6) | Fold[(uint8_t)*Ptr]) & kKeyMask;
+			if (LastRanks[Key] == Rank)
+			{
+				continue;
+			}
+			KeyBytes[Key] += VarintSize(LastRanks[Key] == kNoRank ? Rank : Rank - LastRanks[Key]);
+			KeyCounts[Key]++;
+			LastRanks[Key] = Rank;
+		} // end for Ptr
+	} // end for Rank
+
+	// KeyBytes becomes the write position of each key
+	uint32_t Total = 0;
+	for (uint32_t Key = 0; Key < kKeySpace; Key++)
+	{
+		if (KeyCounts[Key])
+		{
+			Keys.push_back(Key);
+			Offsets.push_back(Total);
+			Counts.push_back(KeyCounts[Key]);
+			const uint32_t Bytes = KeyBytes[Key];
+			KeyBytes[Key] = Total;
+			Total += Bytes;
+		}
+	} // end for Key
+	Offsets.push_back(Total);
+	Postings.resize(Total);
+
+	LastRanks.assign(kKeySpace, kNoRank);
+	for (uint32_t Rank = 0; Rank < Count; Rank++)
+	{
+		InIndex.GetSymbol(Rank, Symbol);
+		const char *Name = Symbol.Name;
+		if (!Name[0] || !Name[1])
+		{
+			continue;
+		}
+
+		uint32_t Key = ((uint32_t)Fold[(uint8_t)Name[0]] << 6) | Fold[(uint8_t)Name[1]];
+		for (const char *Ptr = Name + 2; *Ptr; Ptr++)
+		{
+			Key = ((Key << 6) | Fold[(uint8_t)*Ptr]) & kKeyMask;
+			if (LastRanks[Key] == Rank)
+			{
+				continue;
+			}
+			uint32_t Delta = LastRanks[Key] == kNoRank ? Rank : Rank - LastRanks[Key];
+			LastRanks[Key] = Rank;
+
+			uint8_t *Write = &Postings[KeyBytes[Key]];
+			while (Delta >= 0x80)
+			{
+				*Write++ = (uint8_t)(Delta | 0x80);
+				Delta >>= 7;
+			} // end while
+			*Write++ = (uint8_t)Delta;
+			KeyBytes[Key] = (uint32_t)(Write - &Postings[0]);
+		} // end for Ptr
+	} // end for Rank
+
+	bBuilt = true;
+}
+
+bool FSymbolTrigramIndex::FindKey(uint32_t InKey, uint32_t &OutSlot) const
+{
+	std::vector<uint32_t>::const_iterator Itr = std::lower_bound(Keys.begin(), Keys.end(), InKey);
+	if (Itr == Keys.end() || *Itr != InKey)
+	{
+		return false;
+	}
+	OutSlot = (uint32_t)(Itr - Keys.begin());
+	return true;
+}
+
+void FSymbolTrigramIndex::DecodePostings(uint32_t InSlot, std::vector<uint32_t> &OutRanks) const
+{
+	OutRanks.clear();
+	OutRanks.reserve(Counts[InSlot]);
+
+	const uint8_t *Ptr = &Postings[0] + Offsets[InSlot];
+	const uint8_t *End = &Postings[0] + Offsets[InSlot + 1];
+	uint32_t Rank = 0;
+	while (Ptr < End)
+	{
+		uint32_t Delta = 0;
+		uint32_t Shift = 0;
+		while (*Ptr & 0x80)
+		{
+			Delta |= (uint32_t)(*Ptr++ & 0x7F) << Shift;
+			Shift += 7;
+		} // end while
+		Delta |= (uint32_t)*Ptr++ << Shift;
+		Rank += Delta;
+		OutRanks.push_back(Rank);
+	} // end while
+}
+
+void FSymbolTrigramIndex::Search(const FSymbolQuery &InQuery, const FModuleSymbolIndex &InIndex, std::vector<uint32_t> &OutRanks) const
+{
+	OutRanks.clear();
+	if (!bBuilt)
+	{
+		return;
+	}
+
+	FModuleSymbolIndex::FSymbol Symbol;
+	const std::vector<uint32_t> &Trigrams = InQuery.GetTrigrams();
+	if (Trigrams.empty())
+	{
+		// nothing to narrow with, check every name
+		const uint32_t Count = (uint32_t)InIndex.GetCount();
+		for (uint32_t Rank = 0; Rank < Count; Rank++)
+		{
+			InIndex.GetSymbol(Rank, Symbol);
+			if (InQuery.Match(Symbol.Name))
+			{
+				OutRanks.push_back(Rank);
+			}
+		} // end for Rank
+		return;
+	}
+
+	// rarest keys first, a missing key means no name matches
+	std::vector<std::pair<uint32_t, uint32_t> > Slots;
+	for (size_t k = 0; k < Trigrams.size(); k++)
+	{
+		uint32_t Slot;
+		if (!FindKey(Trigrams[k], Slot))
+		{
+			return;
+		}
+		Slots.push_back(std::make_pair(Counts[Slot], Slot));
+	} // end for k
+	std::sort(Slots.begin(), Slots.end());
+
+	DecodePostings(Slots[0].second, OutRanks);
+	std::vector<uint32_t> Other;
+	for (size_t k = 1; k < Slots.size() && k < kMaxIntersections && !OutRanks.empty(); k++)
+	{
+		// decoding a list far longer than the candidates costs more than checking them
+		if (Slots[k].first / 16 > OutRanks.size())
+		{
+			break;
+		}
+
+		DecodePostings(Slots[k].second, Other);
+		size_t Kept = 0;
+		for (size_t i = 0, j = 0; i < OutRanks.size() && j < Other.size(); )
+		{
+			if (OutRanks[i] < Other[j])
+			{
+				i++;
+			}
+			else if (Other[j] < OutRanks[i])
+			{
+				j++;
+			}
+			else
+			{
+				OutRanks[Kept++] = OutRanks[i];
+				i++;
+				j++;
+			}
+		} // end for i
+		OutRanks.resize(Kept);
+	} // end for k
+
+	// trigrams are folded and unordered, the names decide
+	size_t Kept = 0;
+	for (size_t k = 0; k < OutRanks.size(); k++)
+	{
+		InIndex.GetSymbol(OutRanks[k], Symbol);
+		if (InQuery.Match(Symbol.Name))
+		{
+			OutRanks[Kept++] = OutRanks[k];
+		}
+	} // end for k
+	OutRanks.resize(Kept);
+}
+
+size_t FSymbolTrigramIndex::GetMemoryUsage() const
+{
+	return (Keys.capacity() + Offsets.capacity() + Counts.capacity()) * sizeof(uint32_t) + Postings.capacity();
+}
@@ -0,0 +1,84 @@
+// \brief
+//		symbol name search. every module index gets a trigram index: for each run of three characters
+//		of a name, the ranks of the symbols containing it, delta coded. a query looks up its rarest
+//		trigrams, intersects their postings and checks the few candidates left against the pattern,
+//		so a search over millions of names touches a few thousand of them.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <regex>
+
+class FModuleSymbolIndex;
+
+
+// a case insensitive pattern: a substring, a glob with * and ? matching the whole name, or a regex
+class FSymbolQuery
+{
+public:
+	enum EMode
+	{
+		MODE_SUBSTRING,
+		MODE_GLOB,
+		MODE_REGEX
+	};
+
+	FSymbolQuery();
+
+	// a glob if InPattern has * or ?, false for a bad regex.
+	bool Parse(const char *InPattern, bool bInRegex);
+
+	bool Match(const char *InName) const;
+	// lower ranks first: exact name, exact unqualified name, prefix, unqualified prefix, anywhere
+	uint32_t Rank(const char *InName) const;
+
+	EMode GetMode() const { return Mode; }
+	// trigram keys every matching name contains, empty if the pattern has none
+	const std::vector<uint32_t>& GetTrigrams() const { return Trigrams; }
+
+private:
+	void AddTrigrams(const std::string &InLiteral);
+
+	EMode					Mode;
+	std::string				Pattern;		// as typed
+	std::string				LowerPattern;
+	std::regex				Regex;
+	std::vector<uint32_t>	Trigrams;
+};
+
+class FSymbolTrigramIndex
+{
+public:
+	FSymbolTrigramIndex();
+
+	// index the names of a finalized module index.
+	void Build(const FModuleSymbolIndex &InIndex);
+	void Clear();
+	bool IsBuilt() const { return bBuilt; }
+
+	// ranks of the symbols of InIndex matching InQuery, ascending. InIndex is the index Build() saw.
+	void Search(const FSymbolQuery &InQuery, const FModuleSymbolIndex &InIndex, std::vector<uint32_t> &OutRanks) const;
+
+	size_t GetMemoryUsage() const;
+
+	// folded characters, 6 bits each
+	static uint32_t MakeKey(char InChar0, char InChar1, char InChar2);
+
+private:
+	FSymbolTrigramIndex(const FSymbolTrigramIndex&);
+	FSymbolTrigramIndex& operator=(const FSymbolTrigramIndex&);
+
+	bool FindKey(uint32_t InKey, uint32_t &OutSlot) const;
+	void DecodePostings(uint32_t InSlot, std::vector<uint32_t> &OutRanks) const;
+
+	// sorted keys, Offsets has one more entry
+	std::vector<uint32_t>	Keys;
+	std::vector<uint32_t>	Offsets;		// into Postings
+	std::vector<uint32_t>	Counts;			// postings per key
+	std::vector<uint8_t>	Postings;		// varint rank deltas
+	bool					bBuilt;
+};
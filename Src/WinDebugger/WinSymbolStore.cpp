@@ -0,0 +1,688 @@
+// \brief
+//		symbol store client.
+//
+
+#include "WinSymbolStore.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cwctype>
+#include <sstream>
+#include <iomanip>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#include <winhttp.h>
+#include <io.h>
+#include <direct.h>
+#else
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+
+// lookups mostly wait on the network
+static const uint32_t kWorkerCount = 8;
+static const uint32_t kCopyBufferSize = 64 * 1024;
+
+#if defined(_WIN32)
+static const wchar_t kSlash = L'\\';
+#else
+static const wchar_t kSlash = L'/';
+#endif
+
+#if !defined(_WIN32)
+static std::string NarrowPath(const std::wstring &InPath)
+{
+	std::vector<char> Path(InPath.size() * 4 + 1);
+	if (wcstombs(&Path[0], InPath.c_str(), Path.size()) == (size_t)-1)
+	{
+		return std::string();
+	}
+	return &Path[0];
+}
+#endif
+
+static FILE* OpenFile(const std::wstring &InFilename, bool bInWrite)
+{
+#if defined(_WIN32)
+	return _wfopen(InFilename.c_str(), bInWrite ? L"wb" : L"rb");
+#else
+	const std::string Filename = NarrowPath(InFilename);
+	return Filename.empty() ? NULL : fopen(Filename.c_str(), bInWrite ? "wb" : "rb");
+#endif
+}
+
+static bool FileExists(const std::wstring &InFilename)
+{
+#if defined(_WIN32)
+	return _waccess(InFilename.c_str(), 0) == 0;
+#else
+	const std::string Filename = NarrowPath(InFilename);
+	return !Filename.empty() && access(Filename.c_str(), F_OK) == 0;
+#endif
+}
+
+static void MakeDirectory(const std::wstring &InPath)
+{
+#if defined(_WIN32)
+	_wmkdir(InPath.c_str());
+#else
+	const std::string Path = NarrowPath(InPath);
+	if (!Path.empty())
+	{
+		mkdir(Path.c_str(), 0755);
+	}
+#endif
+}
+
+static bool ReplaceFile(const std::wstring &InFrom, const std::wstring &InTo)
+{
+#if defined(_WIN32)
+	_wremove(InTo.c_str());
+	return _wrename(InFrom.c_str(), InTo.c_str()) == 0;
+#else
+	const std::string From = NarrowPath(InFrom), To = NarrowPath(InTo);
+	return !From.empty() && !To.empty() && rename(From.c_str(), To.c_str()) == 0;
+#endif
+}
+
+static void RemoveFile(const std::wstring &InFilename)
+{
+#if defined(_WIN32)
+	_wremove(InFilename.c_str());
+#else
+	const std::string Filename = NarrowPath(InFilename);
+	if (!Filename.empty())
+	{
+		remove(Filename.c_str());
+	}
+#endif
+}
+
+// the directories of a file path, existing ones and the roots fail quietly.
+static void MakeParentDirectories(const std::wstring &InFilename)
+{
+	for (std::wstring::size_type Slash = InFilename.find_first_of(L"\\/", 1); Slash != std::wstring::npos; Slash = InFilename.find_first_of(L"\\/", Slash + 1))
+	{
+		MakeDirectory(InFilename.substr(0, Slash));
+	} // end for
+}
+
+static bool StartsWithNoCase(const std::wstring &InText, const wchar_t *InPrefix)
+{
+	for (size_t k = 0; InPrefix[k]; k++)
+	{
+		if (k >= InText.size() || towlower(InText[k]) != towlower(InPrefix[k]))
+		{
+			return false;
+		}
+	} // end for k
+	return true;
+}
+
+static bool IsHttp(const std::wstring &InTier)
+{
+	return StartsWithNoCase(InTier, L"http://") || StartsWithNoCase(InTier, L"https://");
+}
+
+static std::wstring TrimPath(const std::wstring &InPath)
+{
+	const std::wstring::size_type Start = InPath.find_first_not_of(L" \t");
+	if (Start == std::wstring::npos)
+	{
+		return std::wstring();
+	}
+	std::wstring::size_type End = InPath.find_last_not_of(L" \t");
+	while (End > Start && (InPath[End] == L'\\' || InPath[End] == L'/'))
+	{
+		End--;
+	} // end while
+	return InPath.substr(Start, End - Start + 1);
+}
+
+static void SplitPath(const std::wstring &InText, wchar_t InSeparator, std::vector<std::wstring> &OutParts)
+{
+	std::wstring::size_type Start = 0;
+	for (;;)
+	{
+		const std::wstring::size_type End = InText.find(InSeparator, Start);
+		OutParts.push_back(TrimPath(InText.substr(Start, End == std::wstring::npos ? std::wstring::npos : End - Start)));
+		if (End == std::wstring::npos)
+		{
+			break;
+		}
+		Start = End + 1;
+	} // end for
+}
+
+static bool CopyFileData(FILE *InFile, FILE *OutFile)
+{
+	std::vector<char> Buffer(kCopyBufferSize);
+	for (;;)
+	{
+		const size_t Bytes = fread(&Buffer[0], 1, Buffer.size(), InFile);
+		if (Bytes && fwrite(&Buffer[0], Bytes, 1, OutFile) != 1)
+		{
+			return false;
+		}
+		if (Bytes < Buffer.size())
+		{
+			return !ferror(InFile);
+		}
+	} // end for
+}
+
+// GET InUrl into OutFile, or only check that it exists if OutFile is NULL.
+static bool HttpGet(void *InSession, const std::wstring &InUrl, FILE *OutFile)
+{
+#if defined(_WIN32)
+	URL_COMPONENTS Components;
+	memset(&Components, 0, sizeof(Components));
+	Components.dwStructSize = sizeof(Components);
+	Components.dwHostNameLength = (DWORD)-1;
+	Components.dwUrlPathLength = (DWORD)-1;
+	Components.dwExtraInfoLength = (DWORD)-1;
+	if (!InSession || !WinHttpCrackUrl(InUrl.c_str(), 0, 0, &Components))
+	{
+		return false;
+	}
+
+	const std::wstring Host(Components.lpszHostName, Components.dwHostNameLength);
+	const std::wstring Path(Components.lpszUrlPath, Components.dwUrlPathLength + Components.dwExtraInfoLength);
+	const DWORD dwFlags = Components.nScheme == INTERNET_SCHEME_HTTPS ? WINHTTP_FLAG_SECURE : 0;
+
+	bool bSucceeded = false;
+	HINTERNET hConnect = WinHttpConnect((HINTERNET)InSession, Host.c_str(), Components.nPort, 0);
+	HINTERNET hRequest = hConnect ? WinHttpOpenRequest(hConnect, OutFile ? L"GET" : L"HEAD", Path.c_str(), NULL, WINHTTP_NO_REFERER, WINHTTP_DEFAULT_ACCEPT_TYPES, dwFlags) : NULL;
+	if (hRequest && WinHttpSendRequest(hRequest, WINHTTP_NO_ADDITIONAL_HEADERS, 0, WINHTTP_NO_REQUEST_DATA, 0, 0, 0) && WinHttpReceiveResponse(hRequest, NULL))
+	{
+		DWORD dwStatus = 0, dwSize = sizeof(dwStatus);
+		WinHttpQueryHeaders(hRequest, WINHTTP_QUERY_STATUS_CODE | WINHTTP_QUERY_FLAG_NUMBER, WINHTTP_HEADER_NAME_BY_INDEX, &dwStatus, &dwSize, WINHTTP_NO_HEADER_INDEX);
+		bSucceeded = dwStatus == 200;
+
+		std::vector<char> Buffer(OutFile ? kCopyBufferSize : 0);
+		while (bSucceeded && OutFile)
+		{
+			DWORD dwRead = 0;
+			if (!WinHttpReadData(hRequest, &Buffer[0], (DWORD)Buffer.size(), &dwRead))
+			{
+				bSucceeded = false;
+			}
+			else if (!dwRead)
+			{
+				break;
+			}
+			else
+			{
+				bSucceeded = fwrite(&Buffer[0], dwRead, 1, OutFile) == 1;
+			}
+		} // end while
+	}
+
+	if (hRequest)
+	{
+		WinHttpCloseHandle(hRequest);
+	}
+	if (hConnect)
+	{
+		WinHttpCloseHandle(hConnect);
+	}
+	return bSucceeded;
+#else
+	(void)InSession;
+	(void)InUrl;
+	(void)OutFile;
+	return false;
+#endif
+}
+
+// copy a file or a download to InTarget through a temporary file, a reader never sees a partial PDB.
+static bool FetchFile(void *InHttpSession, const std::wstring &InSource, const std::wstring &InTarget)
+{
+	MakeParentDirectories(InTarget);
+
+	const std::wstring TempFilename = InTarget + L".tmp";
+	FILE *fp = OpenFile(TempFilename, true);
+	if (!fp)
+	{
+		return false;
+	}
+
+	bool bFetched = false;
+	if (IsHttp(InSource))
+	{
+		bFetched = HttpGet(InHttpSession, InSource, fp);
+	}
+	else if (FILE *Source = OpenFile(InSource, false))
+	{
+		bFetched = CopyFileData(Source, fp);
+		fclose(Source);
+	}
+	bFetched = (fclose(fp) == 0) && bFetched;
+
+	if (!bFetched || !ReplaceFile(TempFilename, InTarget))
+	{
+		RemoveFile(TempFilename);
+		return false;
+	}
+	return true;
+}
+
+// a file.ptr next to where the PDB would be: "PATH:<file>" points to the PDB elsewhere.
+static std::wstring ReadFilePointer(const std::wstring &InPdbPath)
+{
+	const std::wstring::size_type Slash = InPdbPath.find_last_of(L"\\/");
+	FILE *fp = Slash == std::wstring::npos ? NULL : OpenFile(InPdbPath.substr(0, Slash + 1) + L"file.ptr", false);
+	if (!fp)
+	{
+		return std::wstring();
+	}
+
+	char Buffer[1024];
+	const size_t Bytes = fread(Buffer, 1, sizeof(Buffer) - 1, fp);
+	fclose(fp);
+	Buffer[Bytes] = '\0';
+	if (strncmp(Buffer, "PATH:", 5) != 0)
+	{
+		return std::wstring();
+	}
+
+	std::wstring Path;
+	for (const char *Ptr = Buffer + 5; *Ptr && *Ptr != '\r' && *Ptr != '\n'; Ptr++)
+	{
+		Path.push_back((wchar_t)(uint8_t)*Ptr);
+	} // end for
+	return FileExists(Path) ? Path : std::wstring();
+}
+
+FSymbolStore::FSymbolStore()
+	: HttpSession(NULL)
+	, bStopping(false)
+{
+}
+
+FSymbolStore::~FSymbolStore()
+{
+	{
+		std::lock_guard<std::mutex> Guard(Lock);
+		bStopping = true;
+		Requests.clear();
+	}
+	RequestReady.notify_all();
+
+	for (size_t k = 0; k < Workers.size(); k++)
+	{
+		Workers[k].join();
+	} // end for k
+
+#if defined(_WIN32)
+	if (HttpSession)
+	{
+		WinHttpCloseHandle((HINTERNET)HttpSession);
+	}
+#endif
+}
+
+void FSymbolStore::SetSearchPath(const std::wstring &InSearchPath, const std::wstring &InDefaultCache)
+{
+	std::vector<std::wstring> Parts;
+	SplitPath(InSearchPath, L';', Parts);
+
+	std::vector<FElement> NewElements;
+	for (size_t k = 0; k < Parts.size(); k++)
+	{
+		FElement Element;
+		Element.bServer = StartsWithNoCase(Parts[k], L"srv*");
+		if (!Element.bServer)
+		{
+			if (!Parts[k].empty() && Parts[k].find(L'*') == std::wstring::npos)
+			{
+				Element.Tiers.push_back(Parts[k]);
+				NewElements.push_back(Element);
+			}
+			continue;
+		}
+
+		// srv**store: the default downstream cache
+		std::vector<std::wstring> Tiers;
+		SplitPath(Parts[k].substr(4), L'*', Tiers);
+		for (size_t i = 0; i < Tiers.size(); i++)
+		{
+			const std::wstring &Tier = Tiers[i].empty() ? InDefaultCache : Tiers[i];
+			if (!Tier.empty())
+			{
+				Element.Tiers.push_back(Tier);
+			}
+		} // end for i
+
+		// a download needs somewhere to go
+		if (Element.Tiers.size() == 1 && IsHttp(Element.Tiers[0]) && !InDefaultCache.empty())
+		{
+			Element.Tiers.insert(Element.Tiers.begin(), InDefaultCache);
+		}
+		if (!Element.Tiers.empty())
+		{
+			NewElements.push_back(Element);
+		}
+	} // end for k
+
+	std::lock_guard<std::mutex> Guard(Lock);
+	Elements.swap(NewElements);
+
+	// stores may have changed, what was not found is looked up again
+	for (std::map<std::wstring, FEntry>::iterator Itr = Entries.begin(); Itr != Entries.end(); )
+	{
+		if (Itr->second.State == ENTRY_DONE && Itr->second.Path.empty())
+		{
+			Entries.erase(Itr++);
+		}
+		else
+		{
+			++Itr;
+		}
+	} // end for
+	TwoTierStores.clear();
+}
+
+bool FSymbolStore::IsEmpty() const
+{
+	std::lock_guard<std::mutex> Guard(Lock);
+	return Elements.empty();
+}
+
+std::wstring FSymbolStore::MakeKey(const FPdbGuid &InGuid, uint32_t InAge)
+{
+	std::wostringstream KeyBuilder;
+	KeyBuilder << std::hex << std::uppercase << std::setfill(L'0')
+		<< std::setw(8) << InGuid.Data1 << std::setw(4) << InGuid.Data2 << std::setw(4) << InGuid.Data3;
+	for (int32_t k = 0; k < 8; k++)
+	{
+		KeyBuilder << std::setw(2) << (uint32_t)InGuid.Data4[k];
+	} // end for k
+	KeyBuilder << std::setw(0) << InAge;
+	return KeyBuilder.str();
+}
+
+FSymbolStore::FRequest FSymbolStore::MakeRequest(const std::wstring &InPdbName, const FPdbGuid &InGuid, uint32_t InAge) const
+{
+	FRequest Request;
+	Request.PdbName = InPdbName;
+	Request.Key = MakeKey(InGuid, InAge);
+	Request.EntryName = InPdbName + L"\\" + Request.Key;
+	for (size_t k = 0; k < Request.EntryName.size(); k++)
+	{
+		Request.EntryName[k] = (wchar_t)towlower(Request.EntryName[k]);
+	} // end for k
+	return Request;
+}
+
+void FSymbolStore::Prefetch(const std::wstring &InPdbName, const FPdbGuid &InGuid, uint32_t InAge)
+{
+	if (InPdbName.empty())
+	{
+		return;
+	}
+
+	const FRequest Request = MakeRequest(InPdbName, InGuid, InAge);
+
+	std::lock_guard<std::mutex> Guard(Lock);
+	if (Elements.empty() || Entries.find(Request.EntryName) != Entries.end())
+	{
+		return;
+	}
+
+	FEntry &Entry = Entries[Request.EntryName];
+	Entry.State = ENTRY_QUEUED;
+	Requests.push_back(Request);
+
+	if (Workers.empty())
+	{
+		StartWorkers();
+	}
+	RequestReady.notify_one();
+}
+
+std::wstring FSymbolStore::Resolve(const std::wstring &InPdbName, const FPdbGuid &InGuid, uint32_t InAge)
+{
+	if (InPdbName.empty())
+	{
+		return std::wstring();
+	}
+
+	const FRequest Request = MakeRequest(InPdbName, InGuid, InAge);
+	{
+		std::unique_lock<std::mutex> Guard(Lock);
+		if (Elements.empty())
+		{
+			return std::wstring();
+		}
+
+		std::map<std::wstring, FEntry>::iterator Itr = Entries.find(Request.EntryName);
+		if (Itr != Entries.end() && Itr->second.State == ENTRY_QUEUED)
+		{
+			for (std::deque<FRequest>::iterator RequestItr = Requests.begin(); RequestItr != Requests.end(); ++RequestItr)
+			{
+				if (RequestItr->EntryName == Request.EntryName)
+				{
+					Requests.erase(RequestItr);
+					break;
+				}
+			} // end for
+		}
+		else if (Itr != Entries.end())
+		{
+			// the entry is looked up again each time, SetSearchPath() may drop it
+			while (Itr != Entries.end() && Itr->second.State == ENTRY_RUNNING)
+			{
+				EntryDone.wait(Guard);
+				Itr = Entries.find(Request.EntryName);
+			} // end while
+			if (Itr != Entries.end())
+			{
+				return Itr->second.Path;
+			}
+		}
+
+		Entries[Request.EntryName].State = ENTRY_RUNNING;
+		OpenHttpSession();
+	}
+
+	const std::wstring Path = Lookup(Request);
+	Complete(Request, Path);
+	return Path;
+}
+
+void FSymbolStore::CancelPending()
+{
+	std::lock_guard<std::mutex> Guard(Lock);
+	for (size_t k = 0; k < Requests.size(); k++)
+	{
+		Entries.erase(Requests[k].EntryName);
+	} // end for k
+	Requests.clear();
+}
+
+// called with Lock held, before any lookup
+void FSymbolStore::OpenHttpSession()
+{
+#if defined(_WIN32)
+	if (!HttpSession)
+	{
+		HttpSession = WinHttpOpen(L"WinDebugger/SymbolStore", WINHTTP_ACCESS_TYPE_DEFAULT_PROXY, WINHTTP_NO_PROXY_NAME, WINHTTP_NO_PROXY_BYPASS, 0);
+		if (HttpSession)
+		{
+			// resolve, connect, send, receive
+			WinHttpSetTimeouts((HINTERNET)HttpSession, 10000, 10000, 10000, 30000);
+		}
+	}
+#endif
+}
+
+// called with Lock held
+void FSymbolStore::StartWorkers()
+{
+	OpenHttpSession();
+	for (uint32_t k = 0; k < kWorkerCount; k++)
+	{
+		Workers.push_back(std::thread(&FSymbolStore::WorkerMain, this));
+	} // end for k
+}
+
+void FSymbolStore::WorkerMain()
+{
+	for (;;)
+	{
+		FRequest Request;
+		{
+			std::unique_lock<std::mutex> Guard(Lock);
+			while (!bStopping && Requests.empty())
+			{
+				RequestReady.wait(Guard);
+			} // end while
+			if (bStopping)
+			{
+				return;
+			}
+
+			Request = Requests.front();
+			Requests.pop_front();
+			Entries[Request.EntryName].State = ENTRY_RUNNING;
+		}
+
+		Complete(Request, Lookup(Request));
+	} // end for
+}
+
+void FSymbolStore::Complete(const FRequest &InRequest, const std::wstring &InPath)
+{
+	{
+		std::lock_guard<std::mutex> Guard(Lock);
+		FEntry &Entry = Entries[InRequest.EntryName];
+		Entry.State = ENTRY_DONE;
+		Entry.Path = InPath;
+	}
+	EntryDone.notify_all();
+}
+
+std::wstring FSymbolStore::Lookup(const FRequest &InRequest)
+{
+	std::vector<FElement> SearchElements;
+	{
+		std::lock_guard<std::mutex> Guard(Lock);
+		SearchElements = Elements;
+	}
+
+	for (size_t k = 0; k < SearchElements.size(); k++)
+	{
+		const FElement &Element = SearchElements[k];
+		if (!Element.bServer)
+		{
+			const std::wstring Path = Element.Tiers[0] + kSlash + InRequest.PdbName;
+			if (FileExists(Path))
+			{
+				return Path;
+			}
+			continue;
+		}
+
+		const std::wstring Path = LookupServer(Element, InRequest);
+		if (!Path.empty())
+		{
+			return Path;
+		}
+	} // end for k
+
+	return std::wstring();
+}
+
+std::wstring FSymbolStore::LookupServer(const FElement &InElement, const FRequest &InRequest)
+{
+	for (size_t k = 0; k < InElement.Tiers.size(); k++)
+	{
+		const std::wstring &Tier = InElement.Tiers[k];
+		std::wstring Source = GetStorePath(Tier, InRequest);
+		if (!IsHttp(Tier))
+		{
+			if (!FileExists(Source))
+			{
+				Source = ReadFilePointer(Source);
+				if (Source.empty())
+				{
+					continue;
+				}
+			}
+			if (k == 0)
+			{
+				return Source;
+			}
+		}
+
+		// copy to the downstream caches, the nearest one first, the others copy from it.
+		// a download that fails means this store does not have the PDB.
+		std::wstring Current = Source;
+		for (size_t i = k; i-- > 0; )
+		{
+			if (IsHttp(InElement.Tiers[i]))
+			{
+				continue;
+			}
+
+			const std::wstring Target = GetStorePath(InElement.Tiers[i], InRequest);
+			if (FetchFile(HttpSession, Current, Target))
+			{
+				Current = Target;
+			}
+			else if (IsHttp(Current))
+			{
+				break;
+			}
+		} // end for i
+
+		if (!IsHttp(Current))
+		{
+			return Current;
+		}
+	} // end for k
+
+	return std::wstring();
+}
+
+std::wstring FSymbolStore::GetStorePath(const std::wstring &InTier, const FRequest &InRequest)
+{
+	const wchar_t Slash = IsHttp(InTier) ? L'/' : kSlash;
+
+	std::wstring Path = InTier;
+	Path += Slash;
+	if (IsTwoTier(InTier))
+	{
+		Path += InRequest.PdbName.substr(0, 2);
+		Path += Slash;
+	}
+	Path += InRequest.PdbName;
+	Path += Slash;
+	Path += InRequest.Key;
+	Path += Slash;
+	Path += InRequest.PdbName;
+	return Path;
+}
+
+bool FSymbolStore::IsTwoTier(const std::wstring &InTier)
+{
+	{
+		std::lock_guard<std::mutex> Guard(Lock);
+		std::map<std::wstring, bool>::const_iterator Itr = TwoTierStores.find(InTier);
+		if (Itr != TwoTierStores.end())
+		{
+			return Itr->second;
+		}
+	}
+
+	// workers may probe the same store at once, they agree on the answer.
+	const bool bTwoTier = IsHttp(InTier) ? HttpGet(HttpSession, InTier + L"/index2.txt", NULL) : FileExists(InTier + kSlash + L"index2.txt");
+
+	std::lock_guard<std::mutex> Guard(Lock);
+	TwoTierStores[InTier] = bTwoTier;
+	return bTwoTier;
+}
@@ -0,0 +1,101 @@
+// \brief
+//		symbol store client. a PDB is looked up by file name, GUID and age in the elements of a symbol
+//		path, "srv*C:\cache*\\server\symbols;srv*C:\cache*https://host/symbols;C:\pdbs", and a file found
+//		in an upstream store is copied to the downstream caches of its element. lookups run on a small
+//		pool of workers, the PDBs of all modules are fetched while the debuggee keeps running.
+//
+// ref: https://learn.microsoft.com/en-us/windows/win32/debug/using-symsrv
+//
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "WinPdbReader.h"
+
+
+class FSymbolStore
+{
+public:
+	FSymbolStore();
+	~FSymbolStore();
+
+	// elements are separated by ';'. srv*a*b*c searches a, b then c, a file found in c is copied to b and a.
+	// an srv element with a single http store gets InDefaultCache as its downstream cache.
+	// plain directories are searched for the file name only, the caller checks the PDB signature.
+	void SetSearchPath(const std::wstring &InSearchPath, const std::wstring &InDefaultCache);
+	bool IsEmpty() const;
+
+	// queue a lookup and return at once.
+	void Prefetch(const std::wstring &InPdbName, const FPdbGuid &InGuid, uint32_t InAge);
+	// local path of the PDB, empty if no store has it. a running lookup is waited for, a queued one
+	// is taken off the queue and run on the calling thread.
+	std::wstring Resolve(const std::wstring &InPdbName, const FPdbGuid &InGuid, uint32_t InAge);
+	// drop the lookups that have not started, lookups in flight finish.
+	void CancelPending();
+
+	// <GUID><age>, the directory of a PDB version in a store
+	static std::wstring MakeKey(const FPdbGuid &InGuid, uint32_t InAge);
+
+private:
+	FSymbolStore(const FSymbolStore&);
+	FSymbolStore& operator=(const FSymbolStore&);
+
+	// a ';' element of the search path, Tiers[0] is searched first
+	struct FElement
+	{
+		std::vector<std::wstring>	Tiers;
+		bool						bServer;	// srv*, else a plain directory
+	};
+
+	struct FRequest
+	{
+		std::wstring	PdbName;
+		std::wstring	Key;
+		std::wstring	EntryName;	// lower case "name\key"
+	};
+
+	enum EEntryState
+	{
+		ENTRY_QUEUED,
+		ENTRY_RUNNING,
+		ENTRY_DONE
+	};
+
+	struct FEntry
+	{
+		EEntryState		State;
+		std::wstring	Path;
+	};
+
+	FRequest MakeRequest(const std::wstring &InPdbName, const FPdbGuid &InGuid, uint32_t InAge) const;
+	void OpenHttpSession();
+	void StartWorkers();
+	void WorkerMain();
+	void Complete(const FRequest &InRequest, const std::wstring &InPath);
+
+	std::wstring Lookup(const FRequest &InRequest);
+	std::wstring LookupServer(const FElement &InElement, const FRequest &InRequest);
+	// "name\key\name" below a store, or "na\name\key\name" if the store has an index2.txt
+	std::wstring GetStorePath(const std::wstring &InTier, const FRequest &InRequest);
+	bool IsTwoTier(const std::wstring &InTier);
+
+	std::vector<FElement>			Elements;
+	std::vector<std::thread>		Workers;
+	void							*HttpSession;
+
+	mutable std::mutex				Lock;
+	std::condition_variable			RequestReady;
+	std::condition_variable			EntryDone;
+	std::deque<FRequest>			Requests;
+	std::map<std::wstring, FEntry>	Entries;		// by EntryName
+	std::map<std::wstring, bool>	TwoTierStores;	// index2.txt probed once per store
+	bool							bStopping;
+};
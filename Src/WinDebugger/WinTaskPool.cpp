@@ -0,0 +1,108 @@
+// \brief
+//		work stealing thread pool.
+//
+
+#include "WinTaskPool.h"
+
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// tasks of a thread, the owner takes from the front, thieves from the back
+struct FTaskQueue
+{
+	std::mutex				Lock;
+	std::deque<uint32_t>	Tasks;
+};
+
+struct FTaskBatch
+{
+	FTaskPool::FTaskFunction	Function;
+	void						*Context;
+	FTaskQueue					*Queues;
+	uint32_t					QueueCount;
+};
+
+static bool PopTask(FTaskQueue &InQueue, bool bInFront, uint32_t &OutTask)
+{
+	std::lock_guard<std::mutex> Guard(InQueue.Lock);
+	if (InQueue.Tasks.empty())
+	{
+		return false;
+	}
+
+	if (bInFront)
+	{
+		OutTask = InQueue.Tasks.front();
+		InQueue.Tasks.pop_front();
+	}
+	else
+	{
+		OutTask = InQueue.Tasks.back();
+		InQueue.Tasks.pop_back();
+	}
+	return true;
+}
+
+// no task is added once the batch runs, a thread that finds every queue empty is done.
+static void RunTasks(FTaskBatch *InBatch, uint32_t InQueueIndex)
+{
+	for (;;)
+	{
+		uint32_t Task = 0;
+		bool bFound = PopTask(InBatch->Queues[InQueueIndex], true, Task);
+		for (uint32_t k = 1; k < InBatch->QueueCount && !bFound; k++)
+		{
+			bFound = PopTask(InBatch->Queues[(InQueueIndex + k) % InBatch->QueueCount], false, Task);
+		} // end for k
+
+		if (!bFound)
+		{
+			return;
+		}
+		InBatch->Function(InBatch->Context, Task);
+	} // end for
+}
+
+uint32_t FTaskPool::ParallelFor(uint32_t InTaskCount, FTaskFunction InFunction, void *InContext, uint32_t InMaxThreads)
+{
+	uint32_t ThreadCount = InMaxThreads ? InMaxThreads : std::thread::hardware_concurrency();
+	ThreadCount = ThreadCount < 1 ? 1 : ThreadCount;
+	ThreadCount = ThreadCount > InTaskCount ? InTaskCount : ThreadCount;
+	if (ThreadCount <= 1)
+	{
+		for (uint32_t k = 0; k < InTaskCount; k++)
+		{
+			InFunction(InContext, k);
+		} // end for k
+		return 1;
+	}
+
+	std::vector<FTaskQueue> Queues(ThreadCount);
+	for (uint32_t k = 0; k < InTaskCount; k++)
+	{
+		Queues[k % ThreadCount].Tasks.push_back(k);
+	} // end for k
+
+	FTaskBatch Batch;
+	Batch.Function = InFunction;
+	Batch.Context = InContext;
+	Batch.Queues = &Queues[0];
+	Batch.QueueCount = ThreadCount;
+
+	std::vector<std::thread> Threads;
+	for (uint32_t k = 1; k < ThreadCount; k++)
+	{
+		Threads.push_back(std::thread(&RunTasks, &Batch, k));
+	} // end for k
+
+	RunTasks(&Batch, 0);
+	for (size_t k = 0; k < Threads.size(); k++)
+	{
+		Threads[k].join();
+	} // end for k
+
+	return ThreadCount;
+}
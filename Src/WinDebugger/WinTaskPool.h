@@ -0,0 +1,20 @@
+// \brief
+//		work stealing thread pool for batches of independent tasks.
+//
+
+#pragma once
+
+#include <cstdint>
+
+
+class FTaskPool
+{
+public:
+	typedef void (*FTaskFunction)(void *InContext, uint32_t InTaskIndex);
+
+	// run tasks [0, InTaskCount) and return when all are done, the calling thread runs tasks too.
+	// tasks are dealt to the threads in index order, put the expensive ones first. a thread out of
+	// work takes the last task of another one. InMaxThreads 0 is one thread per core.
+	// returns the number of threads used.
+	static uint32_t ParallelFor(uint32_t InTaskCount, FTaskFunction InFunction, void *InContext, uint32_t InMaxThreads = 0);
+};
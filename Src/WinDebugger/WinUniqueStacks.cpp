@@ -0,0 +1,47 @@
+// \brief
+//		threads grouped by identical call stacks.
+//
+
+#include "WinUniqueStacks.h"
+
+#include <algorithm>
+
+
+static bool StackMoreThreads(const FUniqueStacks::FStack *A, const FUniqueStacks::FStack *B)
+{
+	return A->ThreadIds.size() > B->ThreadIds.size();
+}
+
+void FUniqueStacks::Add(uint32_t InThreadId, const uint64_t *InFrames, uint32_t InDepth)
+{
+	std::vector<uint64_t> Frames(InFrames, InFrames + InDepth);
+	std::map<std::vector<uint64_t>, size_t>::iterator Itr = StackMap.find(Frames);
+	if (Itr == StackMap.end())
+	{
+		Itr = StackMap.insert(std::make_pair(Frames, Stacks.size())).first;
+		Stacks.push_back(FStack());
+		Stacks.back().Frames.swap(Frames);
+	}
+
+	Stacks[Itr->second].ThreadIds.push_back(InThreadId);
+	ThreadCount++;
+}
+
+void FUniqueStacks::Clear()
+{
+	Stacks.clear();
+	StackMap.clear();
+	ThreadCount = 0;
+}
+
+void FUniqueStacks::GetStacks(std::vector<const FStack*> &OutStacks) const
+{
+	OutStacks.clear();
+	OutStacks.reserve(Stacks.size());
+	for (size_t k = 0; k < Stacks.size(); k++)
+	{
+		OutStacks.push_back(&Stacks[k]);
+	} // end for k
+	// Stacks is in first thread order, stable keeps it among stacks with as many threads
+	std::stable_sort(OutStacks.begin(), OutStacks.end(), &StackMoreThreads);
+}
@@ -0,0 +1,38 @@
+// \brief
+//		threads grouped by identical call stacks, the way !uniqstack prints them: each distinct stack
+//		once, with the number and ids of the threads sitting in it.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <map>
+
+
+class FUniqueStacks
+{
+public:
+	struct FStack
+	{
+		std::vector<uint64_t>	Frames;
+		std::vector<uint32_t>	ThreadIds;		// in the order they were added
+	};
+
+	FUniqueStacks() : ThreadCount(0) {}
+
+	void Add(uint32_t InThreadId, const uint64_t *InFrames, uint32_t InDepth);
+	void Clear();
+
+	// most threads first, stacks with as many threads in the order their first thread was added
+	void GetStacks(std::vector<const FStack*> &OutStacks) const;
+
+	uint32_t GetThreadCount() const { return ThreadCount; }
+	uint32_t GetStackCount() const { return (uint32_t)Stacks.size(); }
+
+private:
+	std::vector<FStack>						Stacks;
+	std::map<std::vector<uint64_t>, size_t>	StackMap;		// frames -> index in Stacks
+	uint32_t								ThreadCount;
+};
@@ -0,0 +1,117 @@
+// \brief
+//		growable text buffer for formatted values.
+//
+
+#include "WinValueFormatter.h"
+
+#include <cwchar>
+#include <cstdio>
+#include <cmath>
+
+
+namespace NSValueFormatter
+{
+	// "00" "01" ... "99"
+	static const char kDigitPairs[] =
+		"00010203040506070809"
+		"10111213141516171819"
+		"20212223242526272829"
+		"30313233343536373839"
+		"40414243444546474849"
+		"50515253545556575859"
+		"60616263646566676869"
+		"70717273747576777879"
+		"80818283848586878889"
+		"90919293949596979899";
+
+	static const wchar_t kHexDigits[] = L"0123456789ABCDEF";
+
+	// writes the digits backwards from pEnd, two at a time. returns the first digit.
+	static wchar_t* WriteDecimal(uint64_t InValue, wchar_t *pEnd)
+	{
+		wchar_t *pCursor = pEnd;
+		while (InValue >= 100)
+		{
+			const uint32_t Pair = (uint32_t)(InValue % 100) * 2;
+			InValue /= 100;
+			*--pCursor = (wchar_t)kDigitPairs[Pair + 1];
+			*--pCursor = (wchar_t)kDigitPairs[Pair];
+		} // end while
+		if (InValue >= 10)
+		{
+			const uint32_t Pair = (uint32_t)InValue * 2;
+			*--pCursor = (wchar_t)kDigitPairs[Pair + 1];
+			*--pCursor = (wchar_t)kDigitPairs[Pair];
+		}
+		else
+		{
+			*--pCursor = (wchar_t)(L'0' + InValue);
+		}
+		return pCursor;
+	}
+}
+
+void FFormatBuffer::Append(const wchar_t *InText)
+{
+	if (InText)
+	{
+		Text.append(InText, wcslen(InText));
+	}
+}
+
+void FFormatBuffer::AppendInt(int64_t InValue)
+{
+	wchar_t Digits[24];
+	wchar_t *pEnd = Digits + 24;
+	// negate in unsigned, INT64_MIN has no positive counterpart
+	const uint64_t Magnitude = InValue < 0 ? 0 - (uint64_t)InValue : (uint64_t)InValue;
+	wchar_t *pBegin = NSValueFormatter::WriteDecimal(Magnitude, pEnd);
+	if (InValue < 0)
+	{
+		*--pBegin = L'-';
+	}
+	Text.append(pBegin, pEnd - pBegin);
+}
+
+void FFormatBuffer::AppendUInt(uint64_t InValue)
+{
+	wchar_t Digits[24];
+	wchar_t *pEnd = Digits + 24;
+	wchar_t *pBegin = NSValueFormatter::WriteDecimal(InValue, pEnd);
+	Text.append(pBegin, pEnd - pBegin);
+}
+
+void FFormatBuffer::AppendHex(uint64_t InValue, uint32_t InWidth)
+{
+	wchar_t Digits[16];
+	wchar_t *pEnd = Digits + 16;
+	wchar_t *pCursor = pEnd;
+	do
+	{
+		*--pCursor = NSValueFormatter::kHexDigits[InValue & 0xF];
+		InValue >>= 4;
+	} while (InValue);
+
+	for (size_t k = pEnd - pCursor; k < InWidth; k++)
+	{
+		Text.push_back(L'0');
+	} // end for k
+	Text.append(pCursor, pEnd - pCursor);
+}
+
+void FFormatBuffer::AppendFloat(double InValue)
+{
+	// whole numbers below 1e6 print the same in %g as in decimal, most values in memory are such
+	if (InValue > -1e6 && InValue < 1e6 && InValue == (double)(int32_t)InValue && !(InValue == 0 && std::signbit(InValue)))
+	{
+		AppendInt((int32_t)InValue);
+		return;
+	}
+
+	wchar_t Digits[64];
+	const int Length = swprintf(Digits, 64, L"%g", InValue);
+	if (Length > 0)
+	{
+		Text.append(Digits, Length);
+	}
+}
@@ -0,0 +1,44 @@
+// \brief
+//		growable text buffer the value formatters append to. one buffer is reused for many values,
+//		clearing it keeps its memory. numbers are converted in place, without streams or temporary strings.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+
+class FFormatBuffer
+{
+public:
+	FFormatBuffer() {}
+
+	void Append(wchar_t InChar) { Text.push_back(InChar); }
+	void Append(const wchar_t *InText, size_t InLength) { Text.append(InText, InLength); }
+	void Append(const wchar_t *InText);
+	void Append(const std::wstring &InText) { Text.append(InText); }
+
+	// decimal
+	void AppendInt(int64_t InValue);
+	void AppendUInt(uint64_t InValue);
+	// upper case hex, zero filled to InWidth digits
+	void AppendHex(uint64_t InValue, uint32_t InWidth);
+	// as printf("%g")
+	void AppendFloat(double InValue);
+
+	void Reserve(size_t InLength) { Text.reserve(InLength); }
+	// keeps the memory for the next value
+	void Clear() { Text.clear(); }
+
+	const wchar_t* c_str() const { return Text.c_str(); }
+	size_t Length() const { return Text.size(); }
+	const std::wstring& GetText() const { return Text; }
+
+private:
+	FFormatBuffer(const FFormatBuffer&);
+	FFormatBuffer& operator=(const FFormatBuffer&);
+
+	std::wstring	Text;
+};
@@ -3,11 +3,19 @@
 //
 
 #include "WinVariableTypeHelper.h"
+#include "WinRemoteMemory.h"
+#include "WinVisualizer.h"
+#include "WinProcessHelper.h"
 #include "Foundation/AppHelper.h"
 
 #include <sstream>
-#include <iomanip>
+#include <limits>
+#include <algorithm>
 #include <map>
+#include <set>
+#include <new>
+#include <cstddef>
+#include <cstring>
 
 
 //char͵ַתɿַ̨,
@@ -139,124 +147,306 @@ static CPrimitiveTypeEnum TranslateBaseTypeToC(DWORD BaseType, ULONG64 Length)
 	return cType;
 }
 
-static std::wstring FormatPrimitiveTypeValue(CPrimitiveTypeEnum PrimitiveType, void *pData)
+static void FormatPrimitiveTypeValue(CPrimitiveTypeEnum PrimitiveType, void *pData, FFormatBuffer &OutText)
 {
-	std::wostringstream valueBuilder;
-
 	switch (PrimitiveType) {
 
 	case cbtNone:
-		valueBuilder << TEXT("??");
+		OutText.Append(TEXT("??"), 2);
 		break;
 
 	case cbtVoid:
-		valueBuilder << TEXT("??");
+		OutText.Append(TEXT("??"), 2);
 		break;
 
 	case cbtBool:
-		valueBuilder << (*(char*)pData == 0 ? L"false" : L"true");
+		OutText.Append(*(char*)pData == 0 ? L"false" : L"true");
 		break;
 
 	case cbtChar:
-		valueBuilder << ConvertToSafeChar(*((char*)pData));
+		OutText.Append((wchar_t)ConvertToSafeChar(*((char*)pData)));
 		break;
 
 	case cbtUChar:
-		valueBuilder << std::hex
-			<< std::uppercase
-			<< std::setw(2)
-			<< std::setfill(TEXT('0'))
-			<< *((unsigned char*)pData);
+		OutText.AppendHex(*((unsigned char*)pData), 2);
 		break;
 
 	case cbtWChar:
-		valueBuilder << ConvertToSafeWChar(*((wchar_t*)pData));
+		OutText.Append(ConvertToSafeWChar(*((wchar_t*)pData)));
 		break;
 
 	case cbtShort:
-		valueBuilder << *((short*)pData);
+		OutText.AppendInt(*((short*)pData));
 		break;
 
 	case cbtUShort:
-		valueBuilder << *((unsigned short*)pData);
+		OutText.AppendUInt(*((unsigned short*)pData));
 		break;
 
 	case cbtInt:
-		valueBuilder << *((int*)pData);
+		OutText.AppendInt(*((int*)pData));
 		break;
 
 	case cbtUInt:
-		valueBuilder << *((unsigned int*)pData);
+		OutText.AppendUInt(*((unsigned int*)pData));
 		break;
 
 	case cbtLong:
-		valueBuilder << *((long*)pData);
+		OutText.AppendInt(*((long*)pData));
 		break;
 
 	case cbtULong:
-		valueBuilder << *((unsigned long*)pData);
+		OutText.AppendUInt(*((unsigned long*)pData));
 		break;
 
 	case cbtLongLong:
-		valueBuilder << *((long long*)pData);
+		OutText.AppendInt(*((long long*)pData));
 		break;
 
 	case cbtULongLong:
-		valueBuilder << *((unsigned long long*)pData);
+		OutText.AppendUInt(*((unsigned long long*)pData));
 		break;
 
 	case cbtFloat:
-		valueBuilder << *((float*)pData);
+		OutText.AppendFloat(*((float*)pData));
 		break;
 
 	case cbtDouble:
-		valueBuilder << *((double*)pData);
+		OutText.AppendFloat(*((double*)pData));
 		break;
 	}
+}
+
+static uint32_t GetPrimitiveLength(CPrimitiveTypeEnum PrimitiveType)
+{
+	switch (PrimitiveType)
+	{
+	case cbtBool:
+	case cbtChar:
+	case cbtUChar:
+		return 1;
+	case cbtWChar:
+	case cbtShort:
+	case cbtUShort:
+		return 2;
+	case cbtInt:
+	case cbtUInt:
+	case cbtLong:
+	case cbtULong:
+	case cbtFloat:
+		return 4;
+	case cbtLongLong:
+	case cbtULongLong:
+	case cbtDouble:
+		return 8;
+	default:
+		return 0;
+	}
+}
+
+static bool GetPrimitiveInteger(CPrimitiveTypeEnum PrimitiveType, const void *pData, int64_t &OutValue)
+{
+	switch (PrimitiveType)
+	{
+	case cbtBool:		OutValue = *(const char*)pData != 0; break;
+	case cbtChar:		OutValue = *(const char*)pData; break;
+	case cbtUChar:		OutValue = *(const unsigned char*)pData; break;
+	case cbtWChar:		OutValue = *(const wchar_t*)pData; break;
+	case cbtShort:		OutValue = *(const short*)pData; break;
+	case cbtUShort:		OutValue = *(const unsigned short*)pData; break;
+	case cbtInt:		OutValue = *(const int*)pData; break;
+	case cbtUInt:		OutValue = *(const unsigned int*)pData; break;
+	case cbtLong:		OutValue = *(const long*)pData; break;
+	case cbtULong:		OutValue = *(const unsigned long*)pData; break;
+	case cbtLongLong:	OutValue = *(const long long*)pData; break;
+	case cbtULongLong:	OutValue = (int64_t)*(const unsigned long long*)pData; break;
+	case cbtFloat:		OutValue = (int64_t)*(const float*)pData; break;
+	case cbtDouble:		OutValue = (int64_t)*(const double*)pData; break;
+	default:
+		return false;
+	}
+	return true;
+}
 
-	return valueBuilder.str();
+// a pointer of the debuggee, 4 or 8 bytes, widened
+static uint64_t ReadPointerValue(const void *pData, uint32_t InLength)
+{
+	uint64_t Value = 0;
+	memcpy(&Value, pData, InLength < sizeof(Value) ? InLength : sizeof(Value));
+	return Value;
+}
+
+// "[k]: "
+static void AppendElementIndex(uint64_t InIndex, FFormatBuffer &OutText)
+{
+	OutText.Append(TEXT('['));
+	OutText.AppendUInt(InIndex);
+	OutText.Append(TEXT("]: "), 3);
 }
 
-static bool VariantEqual(const VARIANT &var, CPrimitiveTypeEnum cBaseType, const void* pData) {
+// element lines of an integer array, the type is known once for all of them
+template <typename T>
+static void FormatIntegerElements(const BYTE *pData, uint32_t InCount, uint32_t InStride, uint64_t InFirstIndex, FFormatBuffer &OutText)
+{
+	for (uint32_t k = 0; k < InCount; k++)
+	{
+		AppendElementIndex(InFirstIndex + k, OutText);
+		const T Value = *(const T*)(pData + (size_t)k * InStride);
+		if (std::numeric_limits<T>::is_signed)
+		{
+			OutText.AppendInt((int64_t)Value);
+		}
+		else
+		{
+			OutText.AppendUInt((uint64_t)Value);
+		}
+		OutText.Append(TEXT('\n'));
+	} // end for k
+}
 
-	switch (cBaseType) 
+// the type enum values are compared as, int for the types that are not integers
+static CPrimitiveTypeEnum GetEnumStorageType(CPrimitiveTypeEnum InValueType)
+{
+	switch (InValueType)
 	{
 	case cbtChar:
-		return var.cVal == *((char*)pData);
-
 	case cbtUChar:
-		return var.bVal == *((unsigned char*)pData);
-
 	case cbtShort:
-		return var.iVal == *((short*)pData);
-
 	case cbtWChar:
 	case cbtUShort:
-		return var.uiVal == *((unsigned short*)pData);
-
 	case cbtUInt:
-		return var.uintVal == *((int*)pData);
-
 	case cbtLong:
-		return var.lVal == *((long*)pData);
-
 	case cbtULong:
-		return var.ulVal == *((unsigned long*)pData);
-
 	case cbtLongLong:
-		return var.llVal == *((long long*)pData);
-
 	case cbtULongLong:
-		return var.ullVal == *((unsigned long long*)pData);
+		return InValueType;
+	default:
+		return cbtInt;
+	}
+}
 
+// an enumerator value read as GetPrimitiveInteger() reads a value of the storage type
+static int64_t GetVariantInteger(const VARIANT &var, CPrimitiveTypeEnum InStorageType)
+{
+	switch (InStorageType)
+	{
+	case cbtChar:		return var.cVal;
+	case cbtUChar:		return var.bVal;
+	case cbtShort:		return var.iVal;
+	case cbtWChar:
+	case cbtUShort:		return var.uiVal;
+	case cbtUInt:		return var.uintVal;
+	case cbtLong:		return var.lVal;
+	case cbtULong:		return var.ulVal;
+	case cbtLongLong:	return var.llVal;
+	case cbtULongLong:	return (int64_t)var.ullVal;
 	case cbtInt:
 	default:
-		return var.intVal == *((int*)pData);
+		return var.intVal;
+	}
+}
+
+// TI_GET_SYMNAME, interned
+static uint32_t GetSymNameId(HANDLE InProcess, uint64_t InModuleBase, uint32_t TypeId)
+{
+	TCHAR *pSymName = NULL;
+	if (!FSymTypeInfoHelper::GetTypeInfo(InProcess, InModuleBase, TypeId, TI_GET_SYMNAME, &pSymName))
+	{
+		return FStringPool::kEmptyId;
+	}
+
+	const uint32_t NameId = FSymTypeInfoHelper::GetNamePool().Intern(pSymName);
+	LocalFree(pSymName);
+	return NameId;
+}
+
+// the children of a type and InReqCount attributes of each, in one batched query. OutRows holds a row
+// of InStride bytes per child, the attributes at InOffsets, zero if they could not be queried.
+// TI_GET_SYMNAME strings are the caller's to LocalFree().
+static DWORD GetChildrenInfo(HANDLE InProcess, uint64_t InModuleBase, uint32_t TypeId, ULONG InReqCount,
+	const IMAGEHLP_SYMBOL_TYPE_INFO *InReqs, const ULONG_PTR *InOffsets, const ULONG *InSizes, ULONG_PTR InStride, std::vector<BYTE> &OutRows)
+{
+	OutRows.clear();
+
+	DWORD ChildrenCount = 0;
+	if (!FSymTypeInfoHelper::GetTypeInfo(InProcess, InModuleBase, TypeId, TI_GET_CHILDRENCOUNT, &ChildrenCount) || ChildrenCount == 0)
+	{
+		return 0;
+	}
+
+	std::vector<BYTE> FindBuffer(sizeof(TI_FINDCHILDREN_PARAMS) + sizeof(ULONG) * ChildrenCount);
+	TI_FINDCHILDREN_PARAMS *pFindParams = (TI_FINDCHILDREN_PARAMS*)&FindBuffer[0];
+	pFindParams->Count = ChildrenCount;
+	pFindParams->Start = 0;
+	if (!FSymTypeInfoHelper::GetTypeInfo(InProcess, InModuleBase, TypeId, TI_FINDCHILDREN, pFindParams))
+	{
+		return 0;
+	}
+
+	OutRows.resize(ChildrenCount * InStride);
+	std::vector<ULONG64> ReqsValid(ChildrenCount);
+
+	IMAGEHLP_GET_TYPE_INFO_PARAMS Params;
+	memset(&Params, 0, sizeof(Params));
+	Params.SizeOfStruct = sizeof(Params);
+	Params.NumIds = ChildrenCount;
+	Params.TypeIds = pFindParams->ChildId;
+	Params.TagFilter = ~(ULONG64)0;
+	Params.NumReqs = InReqCount;
+	Params.ReqKinds = (IMAGEHLP_SYMBOL_TYPE_INFO*)InReqs;
+	Params.ReqOffsets = (PULONG_PTR)InOffsets;
+	Params.ReqSizes = (PULONG)InSizes;
+	Params.ReqStride = InStride;
+	Params.BufferSize = OutRows.size();
+	Params.Buffer = &OutRows[0];
+	Params.ReqsValid = &ReqsValid[0];
+	FSymTypeInfoHelper::GetTypeInfoEx(InProcess, InModuleBase, &Params);
+
+	return ChildrenCount;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+// get type name
+const std::wstring& FSymTypeInfo::TypeName() const
+{
+	return FSymTypeInfoHelper::GetNamePool().GetString(TypeNameId());
+}
+
+uint32_t FSymTypeInfo::TypeNameId() const
+{
+	// built on first use, the parts of a type may still be under construction when it is created
+	if (NameId == kNoNameId)
+	{
+		NameId = FSymTypeInfoHelper::GetNamePool().Intern(BuildTypeName());
 	}
+	return NameId;
+}
+
+std::wstring FSymTypeInfo::BuildTypeName() const
+{
+	return TEXT("Unknown");
+}
+
+void FSymTypeInfo::FormatElements(void *ValuePtr, uint32_t InCount, uint32_t InStride, uint64_t InFirstIndex, FSymExpandBudget &InOutBudget, FFormatBuffer &OutText) const
+{
+	for (uint32_t k = 0; k < InCount; k++)
+	{
+		AppendElementIndex(InFirstIndex + k, OutText);
+		FormatValue((BYTE *)ValuePtr + (size_t)k * InStride, InOutBudget, OutText);
+		OutText.Append(TEXT('\n'));
+	} // end for k
+}
 
-	return false;
+FSymTypeInfo* FSymTypeInfo::ResolveType(uint32_t InTypeId) const
+{
+	return FSymTypeInfoHelper::BuildSymTypeInfo(hProcess, ModuleBase, InTypeId);
 }
 
+void FSymTypeInfo::BuildLayout(FSymLayoutPlan &OutPlan, uint32_t InOffset) const
+{
+	OutPlan.AddValue(InOffset, this);
+}
 
 //////////////////////////////////////////////////////////////////////////
 
@@ -270,7 +460,7 @@ FSymUnknownType::~FSymUnknownType()
 
 FSymUnknownType* FSymUnknownType::StaticCreate(HANDLE InProcess, uint64_t InModuleBase, uint32_t TypeId)
 {
-	FSymUnknownType *pNew = new FSymUnknownType();
+	FSymUnknownType *pNew = new (FSymTypeInfoHelper::AllocSymType(InModuleBase, sizeof(FSymUnknownType))) FSymUnknownType();
 
 	if (pNew)
 	{
@@ -280,24 +470,10 @@ FSymUnknownType* FSymUnknownType::StaticCreate(HANDLE InProcess, uint64_t InModu
 	return pNew;
 }
 
-// get type name
-std::wstring FSymUnknownType::TypeName() const
-{
-	return TEXT("Unknown");
-}
-
 // get format value
-std::wstring FSymUnknownType::FormatValue(void *pData) const
+void FSymUnknownType::FormatValue(void *pData, FSymExpandBudget &InOutBudget, FFormatBuffer &OutText) const
 {
-	std::wostringstream valueBuilder;
-
-	valueBuilder  << std::hex
-		<< std::uppercase
-		<< std::setw(8)
-		<< std::setfill(TEXT('0'))
-		<< *((DWORD*)pData);
-
-	return valueBuilder.str();
+	OutText.AppendHex(*((DWORD*)pData), 8);
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -314,12 +490,12 @@ FSymPrimitiveType::~FSymPrimitiveType()
 FSymPrimitiveType* FSymPrimitiveType::StaticCreate(HANDLE InProcess, uint64_t InModuleBase, uint32_t TypeId)
 {
 	DWORD BaseType = 0;
-	SymGetTypeInfo(InProcess, InModuleBase, TypeId, TI_GET_BASETYPE, &BaseType);
+	FSymTypeInfoHelper::GetTypeInfo(InProcess, InModuleBase, TypeId, TI_GET_BASETYPE, &BaseType);
 
 	ULONG64 Length = 0;
-	SymGetTypeInfo(InProcess, InModuleBase, TypeId, TI_GET_LENGTH, &Length);
+	FSymTypeInfoHelper::GetTypeInfo(InProcess, InModuleBase, TypeId, TI_GET_LENGTH, &Length);
 
-	FSymPrimitiveType* pNew = new FSymPrimitiveType();
+	FSymPrimitiveType* pNew = new (FSymTypeInfoHelper::AllocSymType(InModuleBase, sizeof(FSymPrimitiveType))) FSymPrimitiveType();
 	if (pNew)
 	{
 		FSymTypeInfoHelper::CacheSymTypeInfo(InProcess, InModuleBase, TypeId, pNew);
@@ -330,21 +506,77 @@ FSymPrimitiveType* FSymPrimitiveType::StaticCreate(HANDLE InProcess, uint64_t In
 	return pNew;
 }
 
-std::wstring FSymPrimitiveType::TypeName() const
+FSymPrimitiveType* FSymPrimitiveType::StaticCreate(HANDLE InProcess, uint64_t InModuleBase, uint32_t TypeId, CPrimitiveTypeEnum InPrimitiveType)
+{
+	FSymPrimitiveType* pNew = new (FSymTypeInfoHelper::AllocSymType(InModuleBase, sizeof(FSymPrimitiveType))) FSymPrimitiveType();
+	if (pNew)
+	{
+		FSymTypeInfoHelper::CacheSymTypeInfo(InProcess, InModuleBase, TypeId, pNew);
+
+		pNew->PrimitiveType = InPrimitiveType;
+	}
+
+	return pNew;
+}
+
+std::wstring FSymPrimitiveType::BuildTypeName() const
 {
 	return std::wstring(GetPrimitiveTypeText(PrimitiveType));
 }
 
 // get format value
-std::wstring FSymPrimitiveType::FormatValue(void *pData) const
+void FSymPrimitiveType::FormatValue(void *pData, FSymExpandBudget &InOutBudget, FFormatBuffer &OutText) const
+{
+	FormatPrimitiveTypeValue(PrimitiveType, pData, OutText);
+}
+
+uint32_t FSymPrimitiveType::GetLength() const
+{
+	return GetPrimitiveLength(PrimitiveType);
+}
+
+bool FSymPrimitiveType::GetInteger(const void *ValuePtr, int64_t &OutValue) const
+{
+	return GetPrimitiveInteger(PrimitiveType, ValuePtr, OutValue);
+}
+
+void FSymPrimitiveType::BuildLayout(FSymLayoutPlan &OutPlan, uint32_t InOffset) const
+{
+	OutPlan.AddPrimitive(InOffset, PrimitiveType);
+}
+
+// the common integer arrays are formatted without a switch per element
+void FSymPrimitiveType::FormatElements(void *ValuePtr, uint32_t InCount, uint32_t InStride, uint64_t InFirstIndex, FSymExpandBudget &InOutBudget, FFormatBuffer &OutText) const
 {
-	return FormatPrimitiveTypeValue(PrimitiveType, pData);
+	const BYTE *pData = (const BYTE*)ValuePtr;
+	OutText.Reserve(OutText.Length() + (size_t)InCount * 16);
+
+	switch (PrimitiveType)
+	{
+	case cbtShort:		FormatIntegerElements<short>(pData, InCount, InStride, InFirstIndex, OutText); break;
+	case cbtUShort:		FormatIntegerElements<unsigned short>(pData, InCount, InStride, InFirstIndex, OutText); break;
+	case cbtInt:		FormatIntegerElements<int>(pData, InCount, InStride, InFirstIndex, OutText); break;
+	case cbtUInt:		FormatIntegerElements<unsigned int>(pData, InCount, InStride, InFirstIndex, OutText); break;
+	case cbtLong:		FormatIntegerElements<long>(pData, InCount, InStride, InFirstIndex, OutText); break;
+	case cbtULong:		FormatIntegerElements<unsigned long>(pData, InCount, InStride, InFirstIndex, OutText); break;
+	case cbtLongLong:	FormatIntegerElements<long long>(pData, InCount, InStride, InFirstIndex, OutText); break;
+	case cbtULongLong:	FormatIntegerElements<unsigned long long>(pData, InCount, InStride, InFirstIndex, OutText); break;
+	default:
+		for (uint32_t k = 0; k < InCount; k++)
+		{
+			AppendElementIndex(InFirstIndex + k, OutText);
+			FormatPrimitiveTypeValue(PrimitiveType, (void*)(pData + (size_t)k * InStride), OutText);
+			OutText.Append(TEXT('\n'));
+		} // end for k
+	}
 }
 
 //////////////////////////////////////////////////////////////////////////
 
 FSymPointerType::FSymPointerType()
-	: pInnerType(NULL)
+	: InnerTypeId(0)
+	, InnerLength(0)
+	, Length(0)
 	, bIsReference(false)
 {
 
@@ -352,37 +584,57 @@ FSymPointerType::FSymPointerType()
 
 FSymPointerType::~FSymPointerType()
 {
-	if (pInnerType)
-	{
-		delete pInnerType; pInnerType = NULL;
-	}
 }
 
 FSymPointerType* FSymPointerType::StaticCreate(HANDLE InProcess, uint64_t InModuleBase, uint32_t TypeId)
 {
 	BOOL IsReference = FALSE;
-	SymGetTypeInfo(InProcess, InModuleBase, TypeId, TI_GET_IS_REFERENCE, &IsReference);
+	FSymTypeInfoHelper::GetTypeInfo(InProcess, InModuleBase, TypeId, TI_GET_IS_REFERENCE, &IsReference);
 
 	DWORD InnerTypeId;
-	SymGetTypeInfo(InProcess, InModuleBase, TypeId, TI_GET_TYPEID, &InnerTypeId);
+	FSymTypeInfoHelper::GetTypeInfo(InProcess, InModuleBase, TypeId, TI_GET_TYPEID, &InnerTypeId);
+
+	ULONG64 InnerLength = 0;
+	FSymTypeInfoHelper::GetTypeInfo(InProcess, InModuleBase, InnerTypeId, TI_GET_LENGTH, &InnerLength);
+
+	ULONG64 Length = 0;
+	FSymTypeInfoHelper::GetTypeInfo(InProcess, InModuleBase, TypeId, TI_GET_LENGTH, &Length);
 
-	FSymPointerType *pNew = new FSymPointerType();
+	FSymPointerType *pNew = new (FSymTypeInfoHelper::AllocSymType(InModuleBase, sizeof(FSymPointerType))) FSymPointerType();
 	if (pNew)
 	{
 		FSymTypeInfoHelper::CacheSymTypeInfo(InProcess, InModuleBase, TypeId, pNew);
 
 		pNew->bIsReference = !!IsReference;
-		pNew->pInnerType = FSymTypeInfoHelper::BuildSymTypeInfo(InProcess, InModuleBase, InnerTypeId);
+		pNew->InnerTypeId = InnerTypeId;
+		pNew->InnerLength = (uint32_t)InnerLength;
+		pNew->Length = (Length == 4 || Length == 8) ? (uint32_t)Length : FProcessInfoHelper::GetPointerSize(InProcess);
 	}
 
 	return pNew;
 }
 
-// get type name
-std::wstring FSymPointerType::TypeName() const
+FSymPointerType* FSymPointerType::StaticCreate(HANDLE InProcess, uint64_t InModuleBase, uint32_t TypeId, uint32_t InInnerTypeId, uint32_t InInnerLength)
+{
+	FSymPointerType *pNew = new (FSymTypeInfoHelper::AllocSymType(InModuleBase, sizeof(FSymPointerType))) FSymPointerType();
+	if (pNew)
+	{
+		FSymTypeInfoHelper::CacheSymTypeInfo(InProcess, InModuleBase, TypeId, pNew);
+
+		pNew->InnerTypeId = InInnerTypeId;
+		pNew->InnerLength = InInnerLength;
+		pNew->Length = FProcessInfoHelper::GetPointerSize(InProcess);
+	}
+
+	return pNew;
+}
+
+std::wstring FSymPointerType::BuildTypeName() const
 {
 	std::wstring szName(TEXT("Unknown"));
 
+	// only the name of the pointed type is needed, its members stay unread
+	FSymTypeInfo *pInnerType = ResolveType(InnerTypeId);
 	if (pInnerType)
 	{
 		szName = pInnerType->TypeName();
@@ -393,19 +645,40 @@ std::wstring FSymPointerType::TypeName() const
 }
 
 // get format value
-std::wstring FSymPointerType::FormatValue(void *pData) const
+void FSymPointerType::FormatValue(void *pData, FSymExpandBudget &InOutBudget, FFormatBuffer &OutText) const
 {
-	std::wostringstream valueBuilder;
+	const uint64_t Address = ReadPointerValue(pData, Length);
+	OutText.AppendHex(Address, Length * 2);
 
-	valueBuilder << std::hex << std::uppercase << std::setfill(TEXT('0')) << std::setw(8) << *((DWORD*)pData);
+	// void* and function pointers have nothing to show
+	if (InOutBudget.pPointees && Address && InnerLength)
+	{
+		FSymPointee Pointee;
+		Pointee.Address = Address;
+		Pointee.pTypeInfo = ResolveType(InnerTypeId);
+		Pointee.Length = InnerLength;
+		if (Pointee.pTypeInfo)
+		{
+			InOutBudget.pPointees->push_back(Pointee);
+		}
+	}
+}
+
+bool FSymPointerType::GetInteger(const void *ValuePtr, int64_t &OutValue) const
+{
+	OutValue = (int64_t)ReadPointerValue(ValuePtr, Length);
+	return true;
+}
 
-	return valueBuilder.str();
+void FSymPointerType::BuildLayout(FSymLayoutPlan &OutPlan, uint32_t InOffset) const
+{
+	OutPlan.AddPointer(InOffset, Length, InnerLength ? ResolveType(InnerTypeId) : NULL, InnerLength);
 }
 
 //////////////////////////////////////////////////////////////////////////
 
 FSymArrayType::FSymArrayType()
-	: pInnerType(NULL)
+	: InnerTypeId(0)
 	, ElementCount(0)
 	, ElementLength(0)
 {
@@ -413,41 +686,37 @@ FSymArrayType::FSymArrayType()
 
 FSymArrayType::~FSymArrayType()
 {
-	if (pInnerType)
-	{
-		delete pInnerType; pInnerType = NULL;
-	}
 }
 
 FSymArrayType* FSymArrayType::StaticCreate(HANDLE InProcess, uint64_t InModuleBase, uint32_t TypeId)
 {
 	DWORD ElemCount;
-	SymGetTypeInfo(InProcess, InModuleBase, TypeId, TI_GET_COUNT, &ElemCount);
+	FSymTypeInfoHelper::GetTypeInfo(InProcess, InModuleBase, TypeId, TI_GET_COUNT, &ElemCount);
 
 	DWORD InnerTypeId;
-	SymGetTypeInfo(InProcess, InModuleBase, TypeId, TI_GET_TYPEID, &InnerTypeId);
+	FSymTypeInfoHelper::GetTypeInfo(InProcess, InModuleBase, TypeId, TI_GET_TYPEID, &InnerTypeId);
 
 	ULONG64 InnerLength;
-	SymGetTypeInfo(InProcess, InModuleBase, InnerTypeId, TI_GET_LENGTH, &InnerLength);
+	FSymTypeInfoHelper::GetTypeInfo(InProcess, InModuleBase, InnerTypeId, TI_GET_LENGTH, &InnerLength);
 
-	FSymArrayType *pNew = new FSymArrayType();
+	FSymArrayType *pNew = new (FSymTypeInfoHelper::AllocSymType(InModuleBase, sizeof(FSymArrayType))) FSymArrayType();
 	if (pNew)
 	{
 		FSymTypeInfoHelper::CacheSymTypeInfo(InProcess, InModuleBase, TypeId, pNew);
 
 		pNew->ElementCount = ElemCount;
 		pNew->ElementLength = (uint32_t)InnerLength;
-		pNew->pInnerType = FSymTypeInfoHelper::BuildSymTypeInfo(InProcess, InModuleBase, InnerTypeId);
+		pNew->InnerTypeId = InnerTypeId;
 	}
 
 	return pNew;
 }
 
-// get type name
-std::wstring FSymArrayType::TypeName() const
+std::wstring FSymArrayType::BuildTypeName() const
 {
 	std::wostringstream strBuilder;
 
+	FSymTypeInfo *pInnerType = ResolveType(InnerTypeId);
 	if (pInnerType)
 	{
 		strBuilder << pInnerType->TypeName() << TEXT("[") << ElementCount << TEXT("]");
@@ -461,24 +730,32 @@ std::wstring FSymArrayType::TypeName() const
 }
 
 // get format value
-std::wstring FSymArrayType::FormatValue(void *ValuePtr) const
+void FSymArrayType::FormatValue(void *ValuePtr, FSymExpandBudget &InOutBudget, FFormatBuffer &OutText) const
 {
-	std::wostringstream valueBuilder;
+	if (InOutBudget.Depth >= InOutBudget.MaxDepth)
+	{
+		OutText.Append(TEXT("{ ... }"));
+		return;
+	}
 
+	FSymTypeInfo *pInnerType = ResolveType(InnerTypeId);
 	if (pInnerType)
 	{
+		// the elements the budget has room for, in one call
 		uint32_t Count = ElementCount;
-		if (Count > 32) { Count = 32; }
-
-		valueBuilder << std::endl;
-		for (uint32_t k=0; k<Count; k++)
+		const uint32_t Room = InOutBudget.ValueCount < InOutBudget.MaxValues ? InOutBudget.MaxValues - InOutBudget.ValueCount : 0;
+		if (Count > Room) { Count = Room; }
+		InOutBudget.ValueCount += Count;
+
+		InOutBudget.Depth++;
+		OutText.Append(TEXT('\n'));
+		pInnerType->FormatElements(ValuePtr, Count, ElementLength, 0, InOutBudget, OutText);
+		if (Count < ElementCount)
 		{
-			valueBuilder << TEXT("[") << k << TEXT("]: ") << pInnerType->FormatValue(((byte *)ValuePtr) + k * ElementLength)
-				<< std::endl;
-		} // end for k
+			OutText.Append(TEXT("...\n"));
+		}
+		InOutBudget.Depth--;
 	}
-
-	return valueBuilder.str();
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -495,57 +772,51 @@ FSymEnumType::~FSymEnumType()
 
 FSymEnumType* FSymEnumType::StaticCreate(HANDLE InProcess, uint64_t InModuleBase, uint32_t TypeId)
 {
-	std::wstring EnumName;
-
 	// ö
-	TCHAR *pSymName = NULL;
-	SymGetTypeInfo(InProcess, InModuleBase, TypeId, TI_GET_SYMNAME, &pSymName);
-	EnumName = pSymName;
-	LocalFree(pSymName);
+	const uint32_t EnumNameId = GetSymNameId(InProcess, InModuleBase, TypeId);
 
 	// ֵ
 	DWORD BaseType = 0;
-	SymGetTypeInfo(InProcess, InModuleBase, TypeId, TI_GET_BASETYPE, &BaseType);
+	FSymTypeInfoHelper::GetTypeInfo(InProcess, InModuleBase, TypeId, TI_GET_BASETYPE, &BaseType);
 	ULONG64 Length = 0;
-	SymGetTypeInfo(InProcess, InModuleBase, TypeId, TI_GET_LENGTH, &Length);
+	FSymTypeInfoHelper::GetTypeInfo(InProcess, InModuleBase, TypeId, TI_GET_LENGTH, &Length);
 
 	CPrimitiveTypeEnum PrimType = TranslateBaseTypeToC(BaseType, Length);
+	const CPrimitiveTypeEnum StorageType = GetEnumStorageType(PrimType);
 	std::vector<FEnumElement>	EnumValues;
 
-	//ȡöֵĸ
-	DWORD ChildrenCount;
-	SymGetTypeInfo(InProcess, InModuleBase, TypeId, TI_GET_CHILDRENCOUNT, &ChildrenCount);
-
-	//ȡÿöֵ
-	TI_FINDCHILDREN_PARAMS *pFindParams = (TI_FINDCHILDREN_PARAMS *)malloc(sizeof(TI_FINDCHILDREN_PARAMS) + ChildrenCount * sizeof(ULONG));
-	pFindParams->Start = 0;
-	pFindParams->Count = ChildrenCount;
-	SymGetTypeInfo(InProcess, InModuleBase, TypeId, TI_FINDCHILDREN, pFindParams);
+	//ȡÿöֵ, name and value of every enumerator in one query
+	struct FEnumeratorRow
+	{
+		VARIANT		Value;
+		WCHAR		*pName;
+	};
+	static const IMAGEHLP_SYMBOL_TYPE_INFO kReqs[] = { TI_GET_VALUE, TI_GET_SYMNAME };
+	static const ULONG_PTR kOffsets[] = { offsetof(FEnumeratorRow, Value), offsetof(FEnumeratorRow, pName) };
+	static const ULONG kSizes[] = { sizeof(VARIANT), sizeof(WCHAR*) };
 
+	std::vector<BYTE> Rows;
+	const DWORD ChildrenCount = GetChildrenInfo(InProcess, InModuleBase, TypeId, XARRAY_COUNT(kReqs), kReqs, kOffsets, kSizes, sizeof(FEnumeratorRow), Rows);
+	FStringPool &NamePool = FSymTypeInfoHelper::GetNamePool();
 	for (DWORD k=0; k<ChildrenCount; k++)
 	{
-		VARIANT enumValue;
-		TCHAR *enumName = NULL;
-
-		SymGetTypeInfo(InProcess, InModuleBase, pFindParams->ChildId[k], TI_GET_VALUE, &enumValue);
-		SymGetTypeInfo(InProcess, InModuleBase, pFindParams->ChildId[k], TI_GET_SYMNAME, &enumName);
+		const FEnumeratorRow &Row = ((const FEnumeratorRow*)&Rows[0])[k];
 
 		FEnumElement Entry;
-		Entry.Name = enumName;
-		Entry.Value = enumValue;
+		Entry.Value = GetVariantInteger(Row.Value, StorageType);
+		Entry.NameId = NamePool.Intern(Row.pName);
 
 		EnumValues.push_back(Entry);
-		LocalFree(enumName);
+		LocalFree(Row.pName);
 	} // end for k
+	std::stable_sort(EnumValues.begin(), EnumValues.end());
 
-	free(pFindParams);
-
-	FSymEnumType *pNew = new FSymEnumType();
+	FSymEnumType *pNew = new (FSymTypeInfoHelper::AllocSymType(InModuleBase, sizeof(FSymEnumType))) FSymEnumType();
 	if (pNew)
 	{
 		FSymTypeInfoHelper::CacheSymTypeInfo(InProcess, InModuleBase, TypeId, pNew);
 
-		pNew->szTypeName = EnumName;
+		pNew->NameId = EnumNameId;
 		pNew->ValueType = PrimType;
 		pNew->EnumValues = EnumValues;
 	}
@@ -553,54 +824,56 @@ FSymEnumType* FSymEnumType::StaticCreate(HANDLE InProcess, uint64_t InModuleBase
 	return pNew;
 }
 
-// get type name
-std::wstring FSymEnumType::TypeName() const
+// get format value
+void FSymEnumType::FormatValue(void *ValuePtr, FSymExpandBudget &InOutBudget, FFormatBuffer &OutText) const
 {
-	return szTypeName;
+	AppendValueName(ValuePtr, OutText);
 }
 
-// get format value
-std::wstring FSymEnumType::FormatValue(void *ValuePtr) const
+// a binary search, the first declared of the enumerators with the value is found
+void FSymEnumType::AppendValueName(const void *ValuePtr, FFormatBuffer &OutText) const
 {
-	for (size_t k=0; k<EnumValues.size(); k++)
+	FEnumElement Key;
+	GetPrimitiveInteger(GetEnumStorageType(ValueType), ValuePtr, Key.Value);
+	std::vector<FEnumElement>::const_iterator It = std::lower_bound(EnumValues.begin(), EnumValues.end(), Key);
+	if (It != EnumValues.end() && It->Value == Key.Value)
 	{
-		const FEnumElement &Entry = EnumValues[k];
-		if (VariantEqual(Entry.Value, ValueType, ValuePtr))
-		{
-			return Entry.Name;
-		}
-	} // end for k
+		OutText.Append(FSymTypeInfoHelper::GetNamePool().GetString(It->NameId));
+		return;
+	}
+
+	OutText.Append(TEXT("N/A"));
+}
+
+void FSymEnumType::BuildLayout(FSymLayoutPlan &OutPlan, uint32_t InOffset) const
+{
+	OutPlan.AddEnum(InOffset, this);
+}
+
+uint32_t FSymEnumType::GetLength() const
+{
+	return GetPrimitiveLength(ValueType);
+}
 
-	return TEXT("N/A");
+bool FSymEnumType::GetInteger(const void *ValuePtr, int64_t &OutValue) const
+{
+	return GetPrimitiveInteger(ValueType, ValuePtr, OutValue);
 }
 
 //////////////////////////////////////////////////////////////////////////
 
 FSymFunctionType::FSymFunctionType()
-	: pReturnType(NULL)
+	: ReturnTypeId(0)
 {
 }
 
 FSymFunctionType::~FSymFunctionType()
 {
-	if (pReturnType) 
-	{ 
-		delete pReturnType; pReturnType = NULL; 
-	}
-	for (size_t k=0; k<ParamTypes.size(); k++)
-	{
-		if (ParamTypes[k]) 
-		{ 
-			delete ParamTypes[k]; 
-		}
-	} // end for k
-
-	ParamTypes.clear();
 }
 
 FSymFunctionType* FSymFunctionType::StaticCreate(HANDLE InProcess, uint64_t InModuleBase, uint32_t TypeId)
 {
-	FSymFunctionType *pNew = new FSymFunctionType();
+	FSymFunctionType *pNew = new (FSymTypeInfoHelper::AllocSymType(InModuleBase, sizeof(FSymFunctionType))) FSymFunctionType();
 	if (!pNew)
 	{
 		return NULL;
@@ -608,318 +881,946 @@ FSymFunctionType* FSymFunctionType::StaticCreate(HANDLE InProcess, uint64_t InMo
 	FSymTypeInfoHelper::CacheSymTypeInfo(InProcess, InModuleBase, TypeId, pNew);
 
 	//ȡֵ
-	FSymTypeInfo *pReturnType = NULL;
-	{
-		DWORD returnTypeID;
-		SymGetTypeInfo(InProcess, InModuleBase, TypeId, TI_GET_TYPEID, &returnTypeID);
-
-		pReturnType = FSymTypeInfoHelper::BuildSymTypeInfo(InProcess, InModuleBase, returnTypeID);
-	}
+	DWORD ReturnTypeId = 0;
+	FSymTypeInfoHelper::GetTypeInfo(InProcess, InModuleBase, TypeId, TI_GET_TYPEID, &ReturnTypeId);
 
-	std::vector<FSymTypeInfo *> ParamTypes;
+	std::vector<uint32_t> ParamTypeIds;
 	{
-		//ȡ
-		DWORD paramCount;
-		SymGetTypeInfo(InProcess, InModuleBase, TypeId, TI_GET_CHILDRENCOUNT, &paramCount);
-
-		//ȡÿ
-		BYTE* pBuffer = (BYTE*)malloc(sizeof(TI_FINDCHILDREN_PARAMS) + sizeof(ULONG) * paramCount);
-		TI_FINDCHILDREN_PARAMS* pFindParams = (TI_FINDCHILDREN_PARAMS*)pBuffer;
-		pFindParams->Count = paramCount;
-		pFindParams->Start = 0;
+		//ȡÿ, in one query
+		static const IMAGEHLP_SYMBOL_TYPE_INFO kReqs[] = { TI_GET_TYPEID };
+		static const ULONG_PTR kOffsets[] = { 0 };
+		static const ULONG kSizes[] = { sizeof(DWORD) };
 
-		SymGetTypeInfo(InProcess, InModuleBase, TypeId, TI_FINDCHILDREN, pFindParams);
+		std::vector<BYTE> Rows;
+		const DWORD paramCount = GetChildrenInfo(InProcess, InModuleBase, TypeId, XARRAY_COUNT(kReqs), kReqs, kOffsets, kSizes, sizeof(DWORD), Rows);
 		for (DWORD k = 0; k < paramCount; k++)
 		{
-			DWORD paramTypeID;
-			SymGetTypeInfo(InProcess, InModuleBase, pFindParams->ChildId[k], TI_GET_TYPEID, &paramTypeID);
-
-			FSymTypeInfo *ParamType = FSymTypeInfoHelper::BuildSymTypeInfo(InProcess, InModuleBase, paramTypeID);
-			ParamTypes.push_back(ParamType);
+			ParamTypeIds.push_back(((const DWORD*)&Rows[0])[k]);
 		} // end for k
-		free(pBuffer);
 	}
 
+	// assign attributes.
+	pNew->ReturnTypeId = ReturnTypeId;
+	pNew->ParamTypeIds = ParamTypeIds;
+
+	return pNew;
+}
+
+std::wstring FSymFunctionType::BuildTypeName() const
+{
 	std::wostringstream nameBuilder;
+	FSymTypeInfo *pReturnType = ResolveType(ReturnTypeId);
 	nameBuilder << (pReturnType ? pReturnType->TypeName() : TEXT("??"));
 	nameBuilder << TEXT("(");
-	for (DWORD k = 0; k < ParamTypes.size(); k++)
+	for (DWORD k = 0; k < ParamTypeIds.size(); k++)
 	{
-		nameBuilder << (ParamTypes[k] ? ParamTypes[k]->TypeName() : TEXT("??"));
-		if (k != ParamTypes.size() - 1)
+		FSymTypeInfo *pParamType = ResolveType(ParamTypeIds[k]);
+		nameBuilder << (pParamType ? pParamType->TypeName() : TEXT("??"));
+		if (k != ParamTypeIds.size() - 1)
 		{
 			nameBuilder << TEXT(", ");
 		}
 	} // end for k
 	nameBuilder << TEXT(")");
 
-	// assign attributes.
-	pNew->pReturnType = pReturnType;
-	pNew->ParamTypes = ParamTypes;
-	pNew->szFunctionProto = nameBuilder.str();
-
-	return pNew;
-}
-
-// get type name
-std::wstring FSymFunctionType::TypeName() const
-{
-	return szFunctionProto;
+	return nameBuilder.str();
 }
 
 // get format value
-std::wstring FSymFunctionType::FormatValue(void *ValuePtr) const
+void FSymFunctionType::FormatValue(void *ValuePtr, FSymExpandBudget &InOutBudget, FFormatBuffer &OutText) const
 {
-	return TEXT("{ ..function.. }");
+	OutText.Append(TEXT("{ ..function.. }"));
 }
 
 //////////////////////////////////////////////////////////////////////////
 
 FSymTypedefType::FSymTypedefType()
-	: pInnerType(NULL)
+	: InnerTypeId(0)
 {
 }
 
 FSymTypedefType::~FSymTypedefType()
 {
-	if (pInnerType)
-	{
-		delete pInnerType; pInnerType = NULL;
-	}
 }
 
 FSymTypedefType* FSymTypedefType::StaticCreate(HANDLE InProcess, uint64_t InModuleBase, uint32_t TypeId)
 {
-	std::wstring DefName;
-
-	TCHAR *pSymName = NULL;
-	SymGetTypeInfo(InProcess, InModuleBase, TypeId, TI_GET_SYMNAME, &pSymName);
-	DefName = pSymName;
-	LocalFree(pSymName);
+	const uint32_t DefNameId = GetSymNameId(InProcess, InModuleBase, TypeId);
 
 	DWORD InnerTypeId;
-	SymGetTypeInfo(InProcess, InModuleBase, TypeId, TI_GET_TYPEID, &InnerTypeId);
+	FSymTypeInfoHelper::GetTypeInfo(InProcess, InModuleBase, TypeId, TI_GET_TYPEID, &InnerTypeId);
 
-	FSymTypedefType *pNew = new FSymTypedefType();
+	FSymTypedefType *pNew = new (FSymTypeInfoHelper::AllocSymType(InModuleBase, sizeof(FSymTypedefType))) FSymTypedefType();
 	if (pNew)
 	{
 		FSymTypeInfoHelper::CacheSymTypeInfo(InProcess, InModuleBase, TypeId, pNew);
 
-		pNew->DefName = DefName;
-		pNew->pInnerType = FSymTypeInfoHelper::BuildSymTypeInfo(InProcess, InModuleBase, InnerTypeId);
+		pNew->NameId = DefNameId;
+		pNew->InnerTypeId = InnerTypeId;
 	}
 
 	return pNew;
 }
 
-// get type name
-std::wstring FSymTypedefType::TypeName() const
+// get format value
+void FSymTypedefType::FormatValue(void *ValuePtr, FSymExpandBudget &InOutBudget, FFormatBuffer &OutText) const
+{
+	FSymTypeInfo *pInnerType = ResolveType(InnerTypeId);
+	if (pInnerType)
+	{
+		pInnerType->FormatValue(ValuePtr, InOutBudget, OutText);
+		return;
+	}
+
+	OutText.Append(TEXT("??"));
+}
+
+const FSymTypeInfo* FSymTypedefType::GetRealType() const
 {
-	return DefName;
+	FSymTypeInfo *pInnerType = ResolveType(InnerTypeId);
+	return pInnerType ? pInnerType->GetRealType() : this;
 }
 
-// get format value
-std::wstring FSymTypedefType::FormatValue(void *ValuePtr) const
+void FSymTypedefType::FormatElements(void *ValuePtr, uint32_t InCount, uint32_t InStride, uint64_t InFirstIndex, FSymExpandBudget &InOutBudget, FFormatBuffer &OutText) const
+{
+	FSymTypeInfo *pInnerType = ResolveType(InnerTypeId);
+	if (pInnerType)
+	{
+		pInnerType->FormatElements(ValuePtr, InCount, InStride, InFirstIndex, InOutBudget, OutText);
+		return;
+	}
+
+	FSymTypeInfo::FormatElements(ValuePtr, InCount, InStride, InFirstIndex, InOutBudget, OutText);
+}
+
+void FSymTypedefType::BuildLayout(FSymLayoutPlan &OutPlan, uint32_t InOffset) const
 {
+	FSymTypeInfo *pInnerType = ResolveType(InnerTypeId);
 	if (pInnerType)
 	{
-		return pInnerType->FormatValue(ValuePtr);
+		pInnerType->BuildLayout(OutPlan, InOffset);
+		return;
 	}
 
-	return TEXT("??");
+	FSymTypeInfo::BuildLayout(OutPlan, InOffset);
 }
 
 //////////////////////////////////////////////////////////////////////////
 FSymComplexType::FSymComplexType()
+	: Length(0)
+	, bMembersBuilt(false)
+	, pVisualizer(NULL)
+	, bVisualizerMatched(false)
+	, pLayoutPlan(NULL)
 {
 }
 
 FSymComplexType::~FSymComplexType()
 {
-	for (size_t k=0; k<Members.size(); k++)
-	{
-		FMemberElement &Entry = Members[k];
-
-		if (Entry.pTypeInfo)
-		{
-			delete Entry.pTypeInfo;
-		}
-	} // end for k
-
-	Members.clear();
+	delete pVisualizer;
+	delete pLayoutPlan;
 }
 
 FSymComplexType* FSymComplexType::StaticCreate(HANDLE InProcess, uint64_t InModuleBase, uint32_t TypeId)
 {
-	FSymComplexType *pNew = new FSymComplexType();
+	FSymComplexType *pNew = new (FSymTypeInfoHelper::AllocSymType(InModuleBase, sizeof(FSymComplexType))) FSymComplexType();
 	if (!pNew)
 	{
 		return NULL;
 	}
 	FSymTypeInfoHelper::CacheSymTypeInfo(InProcess, InModuleBase, TypeId, pNew);
 
-	std::wstring UserDefName;
+	pNew->NameId = GetSymNameId(InProcess, InModuleBase, TypeId);
+
+	ULONG64 Length = 0;
+	FSymTypeInfoHelper::GetTypeInfo(InProcess, InModuleBase, TypeId, TI_GET_LENGTH, &Length);
+	pNew->Length = (uint32_t)Length;
+
+	return pNew;
+}
+
+const std::vector<FSymComplexType::FMemberElement>& FSymComplexType::GetMembers() const
+{
+	if (bMembersBuilt)
 	{
-		TCHAR *pSymName = NULL;
-		SymGetTypeInfo(InProcess, InModuleBase, TypeId, TI_GET_SYMNAME, &pSymName);
-		UserDefName = pSymName;
-		LocalFree(pSymName);
+		return Members;
 	}
+	bMembersBuilt = true;
 
-	std::vector<FMemberElement>	Members;
+	//ȡԱ, tag, name, type and offset of every member in one query
+	struct FMemberRow
 	{
-		//ȡԱ
-		DWORD MembersCount;
-		SymGetTypeInfo(InProcess, InModuleBase, TypeId, TI_GET_CHILDRENCOUNT, &MembersCount);
+		DWORD		SymTag;
+		WCHAR		*pName;
+		DWORD		TypeId;
+		DWORD		Offset;
+	};
+	static const IMAGEHLP_SYMBOL_TYPE_INFO kReqs[] = { TI_GET_SYMTAG, TI_GET_SYMNAME, TI_GET_TYPEID, TI_GET_OFFSET };
+	static const ULONG_PTR kOffsets[] = { offsetof(FMemberRow, SymTag), offsetof(FMemberRow, pName), offsetof(FMemberRow, TypeId), offsetof(FMemberRow, Offset) };
+	static const ULONG kSizes[] = { sizeof(DWORD), sizeof(WCHAR*), sizeof(DWORD), sizeof(DWORD) };
+
+	std::vector<BYTE> Rows;
+	const DWORD MembersCount = GetChildrenInfo(hProcess, ModuleBase, TypeId, XARRAY_COUNT(kReqs), kReqs, kOffsets, kSizes, sizeof(FMemberRow), Rows);
+	FStringPool &NamePool = FSymTypeInfoHelper::GetNamePool();
+	for (DWORD k = 0; k < MembersCount; k++)
+	{
+		const FMemberRow &Row = ((const FMemberRow*)&Rows[0])[k];
+		if (Row.SymTag != SymTagData && Row.SymTag != SymTagBaseClass)
+		{
+			LocalFree(Row.pName);
+			continue;
+		}
+
+		FMemberElement MemberEntry;
+		MemberEntry.NameId = NamePool.Intern(Row.pName);
+		MemberEntry.Offset = Row.Offset;
+		MemberEntry.TypeId = Row.TypeId;
+		MemberEntry.bBaseClass = Row.SymTag == SymTagBaseClass;
 
-		//ȡÿ
-		BYTE* pBuffer = (BYTE*)malloc(sizeof(TI_FINDCHILDREN_PARAMS) + sizeof(ULONG) * MembersCount);
-		TI_FINDCHILDREN_PARAMS* pFindParams = (TI_FINDCHILDREN_PARAMS*)pBuffer;
-		pFindParams->Count = MembersCount;
-		pFindParams->Start = 0;
+		Members.push_back(MemberEntry);
+		LocalFree(Row.pName);
+	} // end for k
+
+	return Members;
+}
 
-		SymGetTypeInfo(InProcess, InModuleBase, TypeId, TI_FINDCHILDREN, pFindParams);
-		for (DWORD k = 0; k < MembersCount; k++)
+FSymTypeInfo* FSymComplexType::FindMember(uint32_t InNameId, uint32_t &OutOffset) const
+{
+	const std::vector<FMemberElement> &MemberList = GetMembers();
+	for (size_t k = 0; k < MemberList.size(); k++)
+	{
+		if (MemberList[k].NameId == InNameId && !MemberList[k].bBaseClass)
 		{
-			const ULONG kChildId = pFindParams->ChildId[k];
+			OutOffset = MemberList[k].Offset;
+			return ResolveType(MemberList[k].TypeId);
+		}
+	} // end for k
 
-			DWORD MemberTag;
-			SymGetTypeInfo(InProcess, InModuleBase, kChildId, TI_GET_SYMTAG, &MemberTag);
+	// then the members of the base classes
+	for (size_t k = 0; k < MemberList.size(); k++)
+	{
+		FSymTypeInfo *pBaseType = MemberList[k].bBaseClass ? ResolveType(MemberList[k].TypeId) : NULL;
+		uint32_t BaseOffset = 0;
+		FSymTypeInfo *pFound = pBaseType ? pBaseType->FindMember(InNameId, BaseOffset) : NULL;
+		if (pFound)
+		{
+			OutOffset = MemberList[k].Offset + BaseOffset;
+			return pFound;
+		}
+	} // end for k
 
-			if (MemberTag != SymTagData && MemberTag != SymTagBaseClass)
-			{
-				continue;
-			}
+	return NULL;
+}
 
-			std::wstring MemberName;
+const FSymVisualizer* FSymComplexType::GetVisualizer() const
+{
+	if (!bVisualizerMatched)
+	{
+		bVisualizerMatched = true;
+		pVisualizer = FVisualizerSet::Get().CreateVisualizer(this);
+	}
+	return pVisualizer;
+}
 
-			TCHAR *pSymName = NULL;
-			SymGetTypeInfo(InProcess, InModuleBase, kChildId, TI_GET_SYMNAME, &pSymName);
-			MemberName = pSymName;
-			LocalFree(pSymName);
+// get format value
+void FSymComplexType::FormatValue(void *ValuePtr, FSymExpandBudget &InOutBudget, FFormatBuffer &OutText) const
+{
+	// a visualizer needs the debuggee memory for what the value points at
+	const FSymVisualizer *pValueVisualizer = InOutBudget.pMemory ? GetVisualizer() : NULL;
+	if (pValueVisualizer)
+	{
+		pValueVisualizer->FormatValue(ValuePtr, InOutBudget, OutText);
+		return;
+	}
 
-			DWORD MemberTypeID;
-			SymGetTypeInfo(InProcess, InModuleBase, kChildId, TI_GET_TYPEID, &MemberTypeID);
+	// past the budget the members are not even queried
+	if (InOutBudget.Depth >= InOutBudget.MaxDepth)
+	{
+		OutText.Append(TEXT("{ ... }"));
+		return;
+	}
 
-			DWORD MemberOffset;
-			SymGetTypeInfo(InProcess, InModuleBase, kChildId, TI_GET_OFFSET, &MemberOffset);
+	GetLayoutPlan()->FormatValue(ValuePtr, InOutBudget, OutText);
+}
 
-			FSymTypeInfo *pMemberType = FSymTypeInfoHelper::BuildSymTypeInfo(InProcess, InModuleBase, MemberTypeID);
-			
-			FMemberElement MemberEntry;
-			MemberEntry.Name = MemberName;
-			MemberEntry.Offset = MemberOffset;
-			MemberEntry.pTypeInfo = pMemberType;
+const FSymLayoutPlan* FSymComplexType::GetLayoutPlan() const
+{
+	if (!pLayoutPlan)
+	{
+		pLayoutPlan = new FSymLayoutPlan();
+		BuildLayout(*pLayoutPlan, 0);
+	}
+	return pLayoutPlan;
+}
 
-			Members.push_back(MemberEntry);
-		} // end for k
-		free(pBuffer);
+// the members one step each, "name(type): " kept as the label of the step
+void FSymComplexType::BuildLayout(FSymLayoutPlan &OutPlan, uint32_t InOffset) const
+{
+	if (!OutPlan.BeginAggregate(InOffset, this, GetVisualizer() != NULL))
+	{
+		FSymTypeInfo::BuildLayout(OutPlan, InOffset);
+		return;
 	}
 
-	// assign attributes.
-	pNew->UserTypeName = UserDefName;
-	pNew->Members = Members;
+	const FStringPool &NamePool = FSymTypeInfoHelper::GetNamePool();
+	const std::vector<FMemberElement> &MemberList = GetMembers();
+	std::wstring Label;
+	for (size_t k = 0; k < MemberList.size(); k++)
+	{
+		const FMemberElement &Entry = MemberList[k];
+		Label = NamePool.GetString(Entry.NameId);
 
-	return pNew;
+		FSymTypeInfo *pMemberType = ResolveType(Entry.TypeId);
+		if (pMemberType)
+		{
+			Label += TEXT('(');
+			Label += pMemberType->TypeName();
+			Label += TEXT("): ");
+			OutPlan.SetMember(Entry.NameId, Label);
+			pMemberType->BuildLayout(OutPlan, InOffset + Entry.Offset);
+		}
+		else
+		{
+			Label += TEXT(" ??, ");
+			OutPlan.SetMember(Entry.NameId, Label);
+			OutPlan.AddUnresolved();
+		}
+	} // end for k
+	OutPlan.EndAggregate();
 }
 
-// get type name
-std::wstring FSymComplexType::TypeName() const
+//////////////////////////////////////////////////////////////////////////
+namespace NSLayoutPlan
 {
-	return UserTypeName;
+	// aggregates nested deeper are formatted by their type, a type that contains itself is not flattened forever
+	const size_t kMaxNesting = 64;
 }
 
-// get format value
-std::wstring FSymComplexType::FormatValue(void *ValuePtr) const
+void FSymLayoutPlan::SetMember(uint32_t InNameId, const std::wstring &InLabel)
 {
-	std::wostringstream  valueBuilder;
+	PendingNameId = InNameId;
+	PendingLabel = InLabel;
+}
+
+FSymLayoutPlan::FStep& FSymLayoutPlan::AddStep(LayoutOpEnum InOp, uint32_t InOffset)
+{
+	FStep Step;
+	Step.Op = InOp;
+	Step.PrimitiveType = cbtNone;
+	Step.Offset = InOffset;
+	Step.LabelStart = (uint32_t)Labels.size();
+	Step.LabelLength = (uint32_t)PendingLabel.size();
+	Step.NameId = PendingNameId;
+	Step.Parent = OpenSteps.empty() ? 0 : OpenSteps.back();
+	Step.End = 0;
+	Step.pType = NULL;
+	Step.pPointedType = NULL;
+	Step.PointedLength = 0;
+	Step.PointerLength = 0;
+	Step.bVisualized = false;
+
+	Labels += PendingLabel;
+	PendingLabel.clear();
+	PendingNameId = kNoNameId;
+
+	Steps.push_back(Step);
+	return Steps.back();
+}
 
-	valueBuilder << TEXT("{ ");
-	for (size_t k = 0; k < Members.size(); k++)
+void FSymLayoutPlan::AddLeaf(uint32_t InOffset, uint32_t InLength, CPrimitiveTypeEnum InPrimitiveType)
+{
+	if (InLength == 0)
 	{
-		const FMemberElement &Entry = Members[k];
-		if (Entry.pTypeInfo)
+		return;
+	}
+
+	FLeaf Leaf;
+	Leaf.Offset = InOffset;
+	Leaf.Length = InLength;
+	Leaf.PrimitiveType = InPrimitiveType;
+	Leaf.Step = (uint32_t)Steps.size() - 1;
+	Leaves.push_back(Leaf);
+}
+
+void FSymLayoutPlan::AddPrimitive(uint32_t InOffset, CPrimitiveTypeEnum InPrimitiveType)
+{
+	AddStep(loPrimitive, InOffset).PrimitiveType = InPrimitiveType;
+	AddLeaf(InOffset, GetPrimitiveLength(InPrimitiveType), InPrimitiveType);
+}
+
+void FSymLayoutPlan::AddPointer(uint32_t InOffset, uint32_t InLength, FSymTypeInfo *InPointedType, uint32_t InPointedLength)
+{
+	FStep &Step = AddStep(loPointer, InOffset);
+	Step.pPointedType = InPointedType;
+	Step.PointedLength = InPointedLength;
+	Step.PointerLength = InLength;
+	AddLeaf(InOffset, InLength, cbtNone);
+}
+
+void FSymLayoutPlan::AddEnum(uint32_t InOffset, const FSymEnumType *InEnumType)
+{
+	AddStep(loEnum, InOffset).pType = InEnumType;
+	AddLeaf(InOffset, InEnumType->GetLength(), GetEnumStorageType(InEnumType->GetValueType()));
+}
+
+void FSymLayoutPlan::AddValue(uint32_t InOffset, const FSymTypeInfo *InType)
+{
+	AddStep(loValue, InOffset).pType = InType;
+	AddLeaf(InOffset, InType->GetLength(), cbtNone);
+}
+
+void FSymLayoutPlan::AddUnresolved()
+{
+	AddStep(loUnresolved, 0);
+}
+
+bool FSymLayoutPlan::BeginAggregate(uint32_t InOffset, const FSymTypeInfo *InType, bool bInVisualized)
+{
+	if (OpenSteps.size() >= NSLayoutPlan::kMaxNesting)
+	{
+		return false;
+	}
+
+	FStep &Step = AddStep(loBegin, InOffset);
+	Step.pType = InType;
+	Step.bVisualized = bInVisualized;
+	OpenSteps.push_back((uint32_t)Steps.size() - 1);
+	return true;
+}
+
+void FSymLayoutPlan::EndAggregate()
+{
+	const uint32_t Begin = OpenSteps.back();
+	OpenSteps.pop_back();
+	AddStep(loEnd, Steps[Begin].Offset).Parent = Begin;
+	Steps[Begin].End = (uint32_t)Steps.size() - 1;
+	if (!OpenSteps.empty())
+	{
+		return;
+	}
+
+	// the outermost aggregate is done, the leaves in address order make the runs
+	std::vector<FRun> Sorted(Leaves.size());
+	for (size_t k = 0; k < Leaves.size(); k++)
+	{
+		Sorted[k].Offset = Leaves[k].Offset;
+		Sorted[k].Length = Leaves[k].Length;
+	} // end for k
+	struct FLessOffset
+	{
+		bool operator()(const FRun &A, const FRun &B) const { return A.Offset < B.Offset; }
+	};
+	std::sort(Sorted.begin(), Sorted.end(), FLessOffset());
+
+	Runs.clear();
+	for (size_t k = 0; k < Sorted.size(); k++)
+	{
+		if (!Runs.empty() && Sorted[k].Offset <= Runs.back().Offset + Runs.back().Length)
 		{
-			valueBuilder << Entry.Name << TEXT("(") << Entry.pTypeInfo->TypeName() << TEXT("): ") << Entry.pTypeInfo->FormatValue((BYTE *)ValuePtr + Entry.Offset)
-				<< TEXT(", ");
+			const uint32_t End = Sorted[k].Offset + Sorted[k].Length;
+			if (End > Runs.back().Offset + Runs.back().Length)
+			{
+				Runs.back().Length = End - Runs.back().Offset;
+			}
+			continue;
 		}
-		else
+		Runs.push_back(Sorted[k]);
+	} // end for k
+}
+
+// the steps in order. a member past the budget ends its aggregate, an aggregate past the depth is
+// skipped to its end.
+void FSymLayoutPlan::FormatValue(const void *ValuePtr, FSymExpandBudget &InOutBudget, FFormatBuffer &OutText) const
+{
+	const BYTE *pData = (const BYTE*)ValuePtr;
+	const wchar_t *pLabels = Labels.c_str();
+	const uint32_t StepCount = (uint32_t)Steps.size();
+	for (uint32_t k = 0; k < StepCount; k++)
+	{
+		const FStep &Step = Steps[k];
+		if (Step.Op == loEnd)
 		{
-			valueBuilder << Entry.Name << TEXT(" ??, ");
+			OutText.Append(TEXT(" }"), 2);
+			InOutBudget.Depth--;
+			if (k + 1 < StepCount)
+			{
+				OutText.Append(TEXT(", "), 2);
+			}
+			continue;
+		}
+
+		// the outermost aggregate is not a member
+		if (k > 0)
+		{
+			if (InOutBudget.ValueCount >= InOutBudget.MaxValues)
+			{
+				OutText.Append(TEXT("..., "));
+				k = Steps[Step.Parent].End - 1;
+				continue;
+			}
+			InOutBudget.ValueCount++;
+			OutText.Append(pLabels + Step.LabelStart, Step.LabelLength);
+		}
+
+		switch (Step.Op)
+		{
+		case loPrimitive:
+			FormatPrimitiveTypeValue(Step.PrimitiveType, (void*)(pData + Step.Offset), OutText);
+			break;
+
+		case loPointer:
+			{
+				const uint64_t Address = ReadPointerValue(pData + Step.Offset, Step.PointerLength);
+				OutText.AppendHex(Address, Step.PointerLength * 2);
+				if (InOutBudget.pPointees && Address && Step.PointedLength && Step.pPointedType)
+				{
+					FSymPointee Pointee;
+					Pointee.Address = Address;
+					Pointee.pTypeInfo = Step.pPointedType;
+					Pointee.Length = Step.PointedLength;
+					InOutBudget.pPointees->push_back(Pointee);
+				}
+			}
+			break;
+
+		case loEnum:
+			((const FSymEnumType*)Step.pType)->AppendValueName(pData + Step.Offset, OutText);
+			break;
+
+		case loValue:
+			Step.pType->FormatValue((void*)(pData + Step.Offset), InOutBudget, OutText);
+			break;
+
+		case loUnresolved:
+			continue;
+
+		case loBegin:
+			if (k > 0 && Step.bVisualized && InOutBudget.pMemory)
+			{
+				Step.pType->FormatValue((void*)(pData + Step.Offset), InOutBudget, OutText);
+				OutText.Append(TEXT(", "), 2);
+				k = Step.End;
+				continue;
+			}
+			if (InOutBudget.Depth >= InOutBudget.MaxDepth)
+			{
+				OutText.Append(TEXT("{ ... }"));
+				if (k > 0)
+				{
+					OutText.Append(TEXT(", "), 2);
+				}
+				k = Step.End;
+				continue;
+			}
+			InOutBudget.Depth++;
+			OutText.Append(TEXT("{ "), 2);
+			continue;
+
+		default:
+			break;
+		}
+		OutText.Append(TEXT(", "), 2);
+	} // end for k
+}
+
+// FNV-1a
+uint64_t FSymLayoutPlan::HashValue(const void *ValuePtr, uint64_t InHash) const
+{
+	const BYTE *pData = (const BYTE*)ValuePtr;
+	for (size_t k = 0; k < Runs.size(); k++)
+	{
+		const BYTE *pRun = pData + Runs[k].Offset;
+		for (uint32_t i = 0; i < Runs[k].Length; i++)
+		{
+			InHash = (InHash ^ pRun[i]) * 1099511628211ull;
+		} // end for i
+	} // end for k
+	return InHash;
+}
+
+void FSymLayoutPlan::Diff(const void *InOldValue, const void *InNewValue, std::vector<uint32_t> &OutLeaves) const
+{
+	const BYTE *pOld = (const BYTE*)InOldValue;
+	const BYTE *pNew = (const BYTE*)InNewValue;
+	for (uint32_t k = 0; k < (uint32_t)Leaves.size(); k++)
+	{
+		const FLeaf &Leaf = Leaves[k];
+		if (memcmp(pOld + Leaf.Offset, pNew + Leaf.Offset, Leaf.Length) != 0)
+		{
+			OutLeaves.push_back(k);
 		}
 	} // end for k
-	valueBuilder << TEXT(" }");
+}
 
-	return valueBuilder.str();
+std::wstring FSymLayoutPlan::GetLeafPath(uint32_t InLeaf) const
+{
+	const FStringPool &NamePool = FSymTypeInfoHelper::GetNamePool();
+	std::wstring Path;
+	for (uint32_t Step = Leaves[InLeaf].Step; Step != 0; Step = Steps[Step].Parent)
+	{
+		const std::wstring &Name = Steps[Step].NameId != kNoNameId ? NamePool.GetString(Steps[Step].NameId) : std::wstring();
+		Path = Path.empty() ? Name : Name + TEXT('.') + Path;
+	} // end for Step
+	return Path;
 }
 
 //////////////////////////////////////////////////////////////////////////
-struct FSymTypeKey
+namespace NSSymTypeArena
 {
-	uint64_t	MouduleBase;
-	uint32_t	TypeId;
+	const size_t kBlockSize = 64 * 1024;
+	const size_t kAlignment = 16;
+	const uint32_t kInitialSlots = 256;
+	// ids of the types made for expressions, above the ids of the symbols
+	const uint32_t kPrimitiveTypeIdBase = 0xFFFFFF00;
+	const uint32_t kPointerTypeIdBase = 0xF0000000;
+}
 
-	FSymTypeKey(uint64_t InModuleBase, uint32_t InTypeId)
-		: MouduleBase(InModuleBase)
-		, TypeId(InTypeId)
-	{}
+// the types of one module. nodes are carved from large blocks and found by type id through an
+// open addressing table, the whole graph is destroyed at once with the arena.
+class FSymTypeArena
+{
+public:
+	FSymTypeArena()
+		: BlockUsed(NSSymTypeArena::kBlockSize)
+		, SlotCount(0)
+		, NextPointerTypeId(NSSymTypeArena::kPointerTypeIdBase)
+	{
+		Slots.resize(NSSymTypeArena::kInitialSlots);
+	}
 
-	bool operator ==(const FSymTypeKey &rhs) const
+	~FSymTypeArena()
 	{
-		return (MouduleBase == rhs.MouduleBase) && (TypeId == rhs.TypeId);
+		// types only point at each other, the order does not matter
+		for (size_t k = 0; k < Nodes.size(); k++)
+		{
+			Nodes[k]->~FSymTypeInfo();
+		} // end for k
+		for (size_t k = 0; k < Blocks.size(); k++)
+		{
+			free(Blocks[k]);
+		} // end for k
 	}
 
-	bool operator <(const FSymTypeKey &rhs) const
+	void* Alloc(size_t InSize)
 	{
-		return (MouduleBase < rhs.MouduleBase) || (TypeId < rhs.TypeId);
+		InSize = (InSize + NSSymTypeArena::kAlignment - 1) & ~(NSSymTypeArena::kAlignment - 1);
+		if (InSize > NSSymTypeArena::kBlockSize / 4)
+		{
+			// keep the current block, a large node gets its own
+			char *pLarge = (char*)malloc(InSize);
+			if (!pLarge) { throw std::bad_alloc(); }
+			Blocks.insert(Blocks.end() - (Blocks.empty() ? 0 : 1), pLarge);
+			return pLarge;
+		}
+		if (BlockUsed + InSize > NSSymTypeArena::kBlockSize)
+		{
+			char *pBlock = (char*)malloc(NSSymTypeArena::kBlockSize);
+			if (!pBlock) { throw std::bad_alloc(); }
+			Blocks.push_back(pBlock);
+			BlockUsed = 0;
+		}
+		void *pMemory = Blocks.back() + BlockUsed;
+		BlockUsed += InSize;
+		return pMemory;
 	}
+
+	void Add(uint32_t TypeId, FSymTypeInfo *InTypeInfo)
+	{
+		uint32_t Slot = FindSlot(TypeId);
+		if (Slots[Slot].pTypeInfo)
+		{
+			// first one wins, as it did with the map
+			return;
+		}
+
+		Nodes.push_back(InTypeInfo);
+		Slots[Slot].TypeId = TypeId;
+		Slots[Slot].pTypeInfo = InTypeInfo;
+		SlotCount++;
+
+		// at most half full
+		if (SlotCount * 2 > Slots.size())
+		{
+			std::vector<FSlot> OldSlots(Slots.size() * 2);
+			OldSlots.swap(Slots);
+			for (size_t k = 0; k < OldSlots.size(); k++)
+			{
+				if (OldSlots[k].pTypeInfo)
+				{
+					Slots[FindSlot(OldSlots[k].TypeId)] = OldSlots[k];
+				}
+			} // end for k
+		}
+	}
+
+	FSymTypeInfo* Find(uint32_t TypeId) const
+	{
+		return Slots[FindSlot(TypeId)].pTypeInfo;
+	}
+
+	// the id of the pointer made to a type, a new one the first time
+	uint32_t GetPointerTypeId(uint32_t InPointedTypeId, bool &bOutNew)
+	{
+		std::map<uint32_t, uint32_t>::iterator FindItr = PointerTypeIds.find(InPointedTypeId);
+		bOutNew = FindItr == PointerTypeIds.end();
+		if (!bOutNew)
+		{
+			return FindItr->second;
+		}
+		PointerTypeIds[InPointedTypeId] = NextPointerTypeId;
+		return NextPointerTypeId++;
+	}
+
+private:
+	FSymTypeArena(const FSymTypeArena&);
+	FSymTypeArena& operator=(const FSymTypeArena&);
+
+	struct FSlot
+	{
+		uint32_t		TypeId;
+		FSymTypeInfo	*pTypeInfo;		// NULL if empty
+
+		FSlot() : TypeId(0), pTypeInfo(NULL) {}
+	};
+
+	// the slot holding the type, or the empty slot it would go to
+	uint32_t FindSlot(uint32_t TypeId) const
+	{
+		const uint32_t Mask = (uint32_t)Slots.size() - 1;
+		uint32_t Slot = (TypeId * 0x9E3779B1u) & Mask;
+		while (Slots[Slot].pTypeInfo && Slots[Slot].TypeId != TypeId)
+		{
+			Slot = (Slot + 1) & Mask;
+		} // end while
+		return Slot;
+	}
+
+	std::vector<char*>			Blocks;		// the last one is being filled
+	size_t						BlockUsed;
+	std::vector<FSymTypeInfo*>	Nodes;		// to destroy
+	std::vector<FSlot>			Slots;
+	size_t						SlotCount;
+	std::map<uint32_t, uint32_t>	PointerTypeIds;		// by pointed type id
+	uint32_t					NextPointerTypeId;
 };
 
-static std::map<FSymTypeKey, FSymTypeInfo*> sSymTypeMap;
+static std::map<uint64_t, FSymTypeArena*> sTypeArenaMap;
+static std::map<uint64_t, FSymTypeSource*> sTypeSourceMap;
+static FStringPool sNamePool;
+static FSymTypeStats sTypeStats;
+
+// the arena of the last lookup, types are built module by module
+static uint64_t sLastArenaBase = 0;
+static FSymTypeArena *sLastArena = NULL;
 
-static void ClearSymTypeMap()
+static FSymTypeArena* FindTypeArena(uint64_t InModuleBase, bool bInCreate)
 {
-	for (std::map<FSymTypeKey, FSymTypeInfo*>::iterator Itr=sSymTypeMap.begin(); Itr!=sSymTypeMap.end(); ++Itr)
+	if (sLastArena && sLastArenaBase == InModuleBase)
+	{
+		return sLastArena;
+	}
+
+	FSymTypeArena *pArena = NULL;
+	std::map<uint64_t, FSymTypeArena*>::iterator FindItr = sTypeArenaMap.find(InModuleBase);
+	if (FindItr != sTypeArenaMap.end())
+	{
+		pArena = FindItr->second;
+	}
+	else if (bInCreate)
+	{
+		pArena = new FSymTypeArena();
+		sTypeArenaMap[InModuleBase] = pArena;
+	}
+	else
+	{
+		return NULL;
+	}
+
+	sLastArenaBase = InModuleBase;
+	sLastArena = pArena;
+	return pArena;
+}
+
+static void ClearTypeArenas()
+{
+	for (std::map<uint64_t, FSymTypeArena*>::iterator Itr=sTypeArenaMap.begin(); Itr!=sTypeArenaMap.end(); ++Itr)
 	{
 		delete Itr->second;
 	} // end for
 
-	sSymTypeMap.clear();
+	sTypeArenaMap.clear();
+	sLastArena = NULL;
 }
 
 void FSymTypeInfoHelper::Initialize()
 {
-	ClearSymTypeMap();
+	ClearTypeArenas();
 }
 
 void FSymTypeInfoHelper::Uninitialize()
 {
-	ClearSymTypeMap();
+	ClearTypeArenas();
+	sTypeSourceMap.clear();
+	sNamePool.Clear();
 }
 
-void FSymTypeInfoHelper::CacheSymTypeInfo(HANDLE InProcess, uint64_t InModuleBase, uint32_t TypeId, FSymTypeInfo *InTypeInfo)
+FStringPool& FSymTypeInfoHelper::GetNamePool()
 {
-	if (InTypeInfo)
+	return sNamePool;
+}
+
+void FSymTypeInfoHelper::RegisterTypeSource(uint64_t InModuleBase, FSymTypeSource *InSource)
+{
+	if (InSource)
 	{
-		const FSymTypeKey Key(InModuleBase, TypeId);
+		sTypeSourceMap[GetTypeSourceKey(InModuleBase)] = InSource;
+	}
+}
 
-		sSymTypeMap.insert(std::make_pair(Key, InTypeInfo));
+void FSymTypeInfoHelper::UnregisterTypeSource(uint64_t InModuleBase)
+{
+	sTypeSourceMap.erase(GetTypeSourceKey(InModuleBase));
+}
+
+void* FSymTypeInfoHelper::AllocSymType(uint64_t InModuleBase, size_t InSize)
+{
+	return FindTypeArena(InModuleBase, true)->Alloc(InSize);
+}
+
+static void DestroyTypeArena(uint64_t InModuleBase)
+{
+	std::map<uint64_t, FSymTypeArena*>::iterator FindItr = sTypeArenaMap.find(InModuleBase);
+	if (FindItr != sTypeArenaMap.end())
+	{
+		delete FindItr->second;
+		sTypeArenaMap.erase(FindItr);
+	}
+	if (sLastArenaBase == InModuleBase)
+	{
+		sLastArena = NULL;
 	}
 }
 
-FSymTypeInfo* FSymTypeInfoHelper::BuildSymTypeInfo(HANDLE InProcess, uint64_t InModuleBase, uint32_t TypeId)
+void FSymTypeInfoHelper::UnloadModule(uint64_t InModuleBase)
+{
+	DestroyTypeArena(InModuleBase);
+	DestroyTypeArena(GetTypeSourceKey(InModuleBase));
+	UnregisterTypeSource(InModuleBase);
+}
+
+BOOL FSymTypeInfoHelper::GetTypeInfo(HANDLE InProcess, uint64_t InModuleBase, uint32_t TypeId, IMAGEHLP_SYMBOL_TYPE_INFO GetType, PVOID pInfo)
+{
+	sTypeStats.QueryCount++;
+
+	if (!sTypeSourceMap.empty())
+	{
+		std::map<uint64_t, FSymTypeSource*>::iterator FindItr = sTypeSourceMap.find(InModuleBase);
+		if (FindItr != sTypeSourceMap.end())
+		{
+			return FindItr->second->GetTypeInfo(TypeId, GetType, pInfo);
+		}
+	}
+
+	return SymGetTypeInfo(InProcess, InModuleBase, TypeId, GetType, pInfo);
+}
+
+BOOL FSymTypeSource::GetTypeInfoEx(PIMAGEHLP_GET_TYPE_INFO_PARAMS Params)
+{
+	Params->EntriesMatched = 0;
+	Params->EntriesFilled = 0;
+	for (ULONG k = 0; k < Params->NumIds; k++)
+	{
+		BYTE *pEntry = (BYTE*)Params->Buffer + k * Params->ReqStride;
+		ULONG64 Valid = 0;
+		for (ULONG r = 0; r < Params->NumReqs; r++)
+		{
+			if (GetTypeInfo(Params->TypeIds[k], Params->ReqKinds[r], pEntry + Params->ReqOffsets[r]))
+			{
+				Valid |= (ULONG64)1 << r;
+			}
+		} // end for r
+		if (Params->ReqsValid)
+		{
+			Params->ReqsValid[k] = Valid;
+		}
+		Params->EntriesMatched++;
+		Params->EntriesFilled++;
+	} // end for k
+	return TRUE;
+}
+
+BOOL FSymTypeInfoHelper::GetTypeInfoEx(HANDLE InProcess, uint64_t InModuleBase, PIMAGEHLP_GET_TYPE_INFO_PARAMS Params)
 {
-	DWORD TypeTag;
-	SymGetTypeInfo(InProcess, InModuleBase, TypeId, TI_GET_SYMTAG, &TypeTag);
+	sTypeStats.BatchCount++;
 
-	const FSymTypeKey Key(InModuleBase, TypeId);
+	BOOL bSuccess = FALSE;
+	std::map<uint64_t, FSymTypeSource*>::iterator FindItr = sTypeSourceMap.find(InModuleBase);
+	if (FindItr != sTypeSourceMap.end())
+	{
+		bSuccess = FindItr->second->GetTypeInfoEx(Params);
+	}
+	else
+	{
+		bSuccess = SymGetTypeInfoEx(InProcess, InModuleBase, Params);
+	}
 
-	std::map<FSymTypeKey, FSymTypeInfo*>::iterator FindItr = sSymTypeMap.find(Key);
-	if (FindItr != sSymTypeMap.end())
+	// an attribute a batch leaves invalid does not apply to the child, the offset of a method or a
+	// nested type. older dbghelp versions fail the whole batch, the ids are asked one at a time then.
+	if (bSuccess)
 	{
-		return FindItr->second;
+		return TRUE;
 	}
 
+	for (ULONG k = 0; k < Params->NumIds; k++)
+	{
+		ULONG64 Valid = 0;
+		BYTE *pEntry = (BYTE*)Params->Buffer + k * Params->ReqStride;
+		for (ULONG r = 0; r < Params->NumReqs; r++)
+		{
+			if (GetTypeInfo(InProcess, InModuleBase, Params->TypeIds[k], Params->ReqKinds[r], pEntry + Params->ReqOffsets[r]))
+			{
+				Valid |= (ULONG64)1 << r;
+				bSuccess = TRUE;
+			}
+		} // end for r
+		if (Params->ReqsValid)
+		{
+			Params->ReqsValid[k] = Valid;
+		}
+	} // end for k
+
+	return bSuccess;
+}
+
+const FSymTypeStats& FSymTypeInfoHelper::GetStats()
+{
+	return sTypeStats;
+}
+
+void FSymTypeInfoHelper::CacheSymTypeInfo(HANDLE InProcess, uint64_t InModuleBase, uint32_t TypeId, FSymTypeInfo *InTypeInfo)
+{
+	if (InTypeInfo)
+	{
+		InTypeInfo->hProcess = InProcess;
+		InTypeInfo->ModuleBase = InModuleBase;
+		InTypeInfo->TypeId = TypeId;
+		FindTypeArena(InModuleBase, true)->Add(TypeId, InTypeInfo);
+	}
+}
+
+FSymTypeInfo* FSymTypeInfoHelper::BuildSymTypeInfo(HANDLE InProcess, uint64_t InModuleBase, uint32_t TypeId)
+{
+	FSymTypeArena *pArena = FindTypeArena(InModuleBase, false);
+	FSymTypeInfo *pFound = pArena ? pArena->Find(TypeId) : NULL;
+	if (pFound)
+	{
+		return pFound;
+	}
+
+	DWORD TypeTag = 0;
+	FSymTypeInfoHelper::GetTypeInfo(InProcess, InModuleBase, TypeId, TI_GET_SYMTAG, &TypeTag);
+
+	sTypeStats.TypeCount++;
 	FSymTypeInfo* pTypeInfo = NULL;
 	switch (TypeTag)
 	{
@@ -950,3 +1851,119 @@ FSymTypeInfo* FSymTypeInfoHelper::BuildSymTypeInfo(HANDLE InProcess, uint64_t In
 
 	return pTypeInfo;
 }
+
+FSymTypeInfo* FSymTypeInfoHelper::BuildPrimitiveType(HANDLE InProcess, uint64_t InModuleBase, const std::wstring &InName)
+{
+	for (uint32_t k = cbtBool; k < cbtEnd; k++)
+	{
+		if (InName == GetPrimitiveTypeText(k))
+		{
+			const uint32_t TypeId = NSSymTypeArena::kPrimitiveTypeIdBase + k;
+			FSymTypeArena *pArena = FindTypeArena(InModuleBase, false);
+			FSymTypeInfo *pFound = pArena ? pArena->Find(TypeId) : NULL;
+			return pFound ? pFound : FSymPrimitiveType::StaticCreate(InProcess, InModuleBase, TypeId, (CPrimitiveTypeEnum)k);
+		}
+	} // end for k
+
+	return NULL;
+}
+
+FSymTypeInfo* FSymTypeInfoHelper::BuildPointerType(const FSymTypeInfo *InPointedType)
+{
+	if (!InPointedType)
+	{
+		return NULL;
+	}
+
+	bool bNew = false;
+	FSymTypeArena *pArena = FindTypeArena(InPointedType->ModuleBase, true);
+	const uint32_t TypeId = pArena->GetPointerTypeId(InPointedType->TypeId, bNew);
+	if (!bNew)
+	{
+		return pArena->Find(TypeId);
+	}
+	return FSymPointerType::StaticCreate(InPointedType->hProcess, InPointedType->ModuleBase, TypeId, InPointedType->TypeId, InPointedType->GetRealType()->GetLength());
+}
+
+// larger pointed data is not read when pointers are followed
+static const uint32_t kMaxPointeeBytes = 64 * 1024;
+
+void FSymTypeInfoHelper::FormatPointees(FRemotePageCache &InMemory, std::vector<FSymPointee> &InOutPointees, uint32_t InMaxLevels,
+	FSymExpandBudget &InOutBudget, FFormatBuffer &OutText)
+{
+	std::vector<FSymPointee> *pOuterPointees = InOutBudget.pPointees;
+	const uint32_t OuterDepth = InOutBudget.Depth;
+
+	std::set<std::pair<uint64_t, FSymTypeInfo*> > Visited;
+	std::vector<FSymPointee> Level, NextLevel;
+	std::vector<FRemotePageCache::FRange> Ranges;
+	std::vector<BYTE> Value;
+	Level.swap(InOutPointees);
+
+	for (uint32_t LevelDepth = 1; LevelDepth <= InMaxLevels && !Level.empty(); LevelDepth++)
+	{
+		// drop what was shown already, a cycle ends here. what the budget has room for is read at once.
+		const uint32_t Room = InOutBudget.ValueCount < InOutBudget.MaxValues ? InOutBudget.MaxValues - InOutBudget.ValueCount : 0;
+		size_t Count = 0;
+		Ranges.clear();
+		for (size_t k = 0; k < Level.size() && Ranges.size() <= Room; k++)
+		{
+			const FSymPointee &Pointee = Level[k];
+			if (Pointee.Length > kMaxPointeeBytes || !Visited.insert(std::make_pair(Pointee.Address, Pointee.pTypeInfo)).second)
+			{
+				continue;
+			}
+
+			FRemotePageCache::FRange Range;
+			Range.Address = Pointee.Address;
+			Range.Bytes = Pointee.Length;
+			Ranges.push_back(Range);
+			Level[Count++] = Pointee;
+		} // end for k
+		Level.resize(Count);
+		InMemory.Prefetch(Ranges);
+
+		// pointers met at this level make the next one
+		NextLevel.clear();
+		InOutBudget.pPointees = LevelDepth < InMaxLevels ? &NextLevel : NULL;
+		for (size_t k = 0; k < Level.size(); k++)
+		{
+			if (InOutBudget.ValueCount >= InOutBudget.MaxValues)
+			{
+				OutText.Append(TEXT("...\n"));
+				NextLevel.clear();
+				break;
+			}
+			InOutBudget.ValueCount++;
+
+			const FSymPointee &Pointee = Level[k];
+			for (uint32_t Indent = 0; Indent < LevelDepth; Indent++)
+			{
+				OutText.Append(TEXT("  "), 2);
+			} // end for Indent
+			OutText.Append(TEXT('*'));
+			OutText.AppendHex(Pointee.Address, 8);
+			OutText.Append(TEXT('('));
+			OutText.Append(Pointee.pTypeInfo->TypeName());
+			OutText.Append(TEXT("): "), 3);
+
+			Value.resize(Pointee.Length);
+			if (InMemory.ReadMemory(Pointee.Address, &Value[0], Pointee.Length))
+			{
+				InOutBudget.Depth = 0;
+				Pointee.pTypeInfo->FormatValue(&Value[0], InOutBudget, OutText);
+			}
+			else
+			{
+				OutText.Append(TEXT("<unreadable>"));
+			}
+			OutText.Append(TEXT('\n'));
+		} // end for k
+
+		Level.swap(NextLevel);
+	} // end for LevelDepth
+
+	InOutBudget.pPointees = pOuterPointees;
+	InOutBudget.Depth = OuterDepth;
+	InOutPointees.clear();
+}
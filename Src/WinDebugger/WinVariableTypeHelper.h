@@ -10,6 +10,9 @@
 #include <string>
 #include <vector>
 
+#include "WinStringPool.h"
+#include "WinValueFormatter.h"
+
 
 
 enum BaseTypeEnum {
@@ -67,6 +70,45 @@ enum SymTagEnum {
 	SymTagDimension
 };
 
+// register numbers of cvconst.h the symbols use, x86 and the x64 ones
+enum CV_HREG_e {
+	CV_REG_EAX = 17,
+	CV_REG_ECX = 18,
+	CV_REG_EDX = 19,
+	CV_REG_EBX = 20,
+	CV_REG_ESP = 21,
+	CV_REG_EBP = 22,
+	CV_REG_ESI = 23,
+	CV_REG_EDI = 24,
+	CV_REG_EIP = 33,
+
+	CV_AMD64_EAX = 17,
+	CV_AMD64_ECX = 18,
+	CV_AMD64_EDX = 19,
+	CV_AMD64_EBX = 20,
+	CV_AMD64_ESP = 21,
+	CV_AMD64_EBP = 22,
+	CV_AMD64_ESI = 23,
+	CV_AMD64_EDI = 24,
+	CV_AMD64_RIP = 33,
+	CV_AMD64_RAX = 328,
+	CV_AMD64_RBX = 329,
+	CV_AMD64_RCX = 330,
+	CV_AMD64_RDX = 331,
+	CV_AMD64_RSI = 332,
+	CV_AMD64_RDI = 333,
+	CV_AMD64_RBP = 334,
+	CV_AMD64_RSP = 335,
+	CV_AMD64_R8 = 336,
+	CV_AMD64_R9 = 337,
+	CV_AMD64_R10 = 338,
+	CV_AMD64_R11 = 339,
+	CV_AMD64_R12 = 340,
+	CV_AMD64_R13 = 341,
+	CV_AMD64_R14 = 342,
+	CV_AMD64_R15 = 343
+};
+
 // c/c++ primitive type
 enum CPrimitiveTypeEnum {
 	cbtNone,
@@ -88,17 +130,101 @@ enum CPrimitiveTypeEnum {
 	cbtEnd,
 };
 
-// class type info
+class FSymTypeInfo;
+class FRemotePageCache;
+class FSymVisualizer;
+class FSymLayoutPlan;
+
+// what a type is, for code that looks into values rather than formatting them
+enum SymTypeKindEnum {
+	stkUnknown,
+	stkPrimitive,
+	stkPointer,
+	stkArray,
+	stkEnum,
+	stkFunction,
+	stkTypedef,
+	stkComplex
+};
+
+// a non-null pointer met while formatting, to follow with FSymTypeInfoHelper::FormatPointees()
+struct FSymPointee
+{
+	uint64_t		Address;
+	FSymTypeInfo	*pTypeInfo;		// the pointed type
+	uint32_t		Length;			// bytes of the pointed data
+};
+
+// how far one FormatValue() call expands a value. aggregates nested deeper than MaxDepth print
+// as { ... }, members and elements past MaxValues in total print as ...
+struct FSymExpandBudget
+{
+	uint32_t	MaxDepth;
+	uint32_t	MaxValues;
+	uint32_t	Depth;			// aggregates being formatted
+	uint32_t	ValueCount;		// members and elements formatted so far
+	std::vector<FSymPointee>	*pPointees;		// pointers met are added here, NULL to print addresses only
+	FRemotePageCache			*pMemory;		// debuggee memory for visualizers, NULL shows the raw members
+
+	FSymExpandBudget(uint32_t InMaxDepth = 4, uint32_t InMaxValues = 256)
+		: MaxDepth(InMaxDepth)
+		, MaxValues(InMaxValues)
+		, Depth(0)
+		, ValueCount(0)
+		, pPointees(NULL)
+		, pMemory(NULL)
+	{
+	}
+};
+
+// class type info. a type refers to the types it is made of by id, they are built the first time
+// a name or a value needs them.
 class FSymTypeInfo
 {
 public:
-	FSymTypeInfo() {}
+	FSymTypeInfo() : NameId(kNoNameId), hProcess(NULL), ModuleBase(0), TypeId(0) {}
 	virtual ~FSymTypeInfo() {}
 
-	// get type name
-	virtual std::wstring TypeName() const = 0;
-	// get format value
-	virtual std::wstring FormatValue(void *ValuePtr) const = 0;
+	// get type name, built once and kept in the name pool
+	const std::wstring& TypeName() const;
+	uint32_t TypeNameId() const;
+	// append the formatted value, aggregates are expanded as far as InOutBudget allows
+	virtual void FormatValue(void *ValuePtr, FSymExpandBudget &InOutBudget, FFormatBuffer &OutText) const = 0;
+	// append InCount values InStride bytes apart as "[k]: value" lines, k counting from InFirstIndex, by default
+	// one FormatValue() each.
+	// the caller has taken the values from the budget.
+	virtual void FormatElements(void *ValuePtr, uint32_t InCount, uint32_t InStride, uint64_t InFirstIndex, FSymExpandBudget &InOutBudget, FFormatBuffer &OutText) const;
+
+	// the shape of the type, for visualizer expressions
+	virtual SymTypeKindEnum GetKind() const { return stkUnknown; }
+	// the type behind typedefs
+	virtual const FSymTypeInfo* GetRealType() const { return this; }
+	// bytes of a value, 0 if not known
+	virtual uint32_t GetLength() const { return 0; }
+	// the pointed type of a pointer, the element type of an array
+	virtual FSymTypeInfo* GetElementType() const { return NULL; }
+	// a data member, base classes included, by name pool id
+	virtual FSymTypeInfo* FindMember(uint32_t InNameId, uint32_t &OutOffset) const { return NULL; }
+	// a scalar value as an integer, false for aggregates
+	virtual bool GetInteger(const void *ValuePtr, int64_t &OutValue) const { return false; }
+	// the flattened layout of an aggregate, built on first use. NULL for the other types.
+	virtual const FSymLayoutPlan* GetLayoutPlan() const { return NULL; }
+	// add the steps of a value at InOffset to a plan being built, by default one FormatValue() call
+	virtual void BuildLayout(FSymLayoutPlan &OutPlan, uint32_t InOffset) const;
+protected:
+	friend class FSymTypeInfoHelper;
+
+	static const uint32_t kNoNameId = 0xFFFFFFFF;
+
+	// name of a type without a symbol name, made of the names of its parts
+	virtual std::wstring BuildTypeName() const;
+	// a type of the same module
+	FSymTypeInfo* ResolveType(uint32_t InTypeId) const;
+
+	mutable uint32_t	NameId;		// name pool id, kNoNameId until the name is built
+	HANDLE				hProcess;	// where the type came from, set when it is cached
+	uint64_t			ModuleBase;
+	uint32_t			TypeId;
 };
 
 class FSymUnknownType : public FSymTypeInfo
@@ -108,10 +234,8 @@ public:
 
 	static FSymUnknownType* StaticCreate(HANDLE InProcess, uint64_t InModuleBase, uint32_t TypeId);
 
-	// get type name
-	virtual std::wstring TypeName() const override;
 	// get format value
-	virtual std::wstring FormatValue(void *ValuePtr) const override;
+	virtual void FormatValue(void *ValuePtr, FSymExpandBudget &InOutBudget, FFormatBuffer &OutText) const override;
 protected:
 	FSymUnknownType();
 };
@@ -123,14 +247,24 @@ public:
 	~FSymPrimitiveType();
 
 	static FSymPrimitiveType* StaticCreate(HANDLE InProcess, uint64_t InModuleBase, uint32_t TypeId);
+	// a primitive type the symbols do not name, for casts
+	static FSymPrimitiveType* StaticCreate(HANDLE InProcess, uint64_t InModuleBase, uint32_t TypeId, CPrimitiveTypeEnum InPrimitiveType);
 
-	// get type name
-	virtual std::wstring TypeName() const override;
 	// get format value
-	virtual std::wstring FormatValue(void *ValuePtr) const override;
+	virtual void FormatValue(void *ValuePtr, FSymExpandBudget &InOutBudget, FFormatBuffer &OutText) const override;
+	virtual void FormatElements(void *ValuePtr, uint32_t InCount, uint32_t InStride, uint64_t InFirstIndex, FSymExpandBudget &InOutBudget, FFormatBuffer &OutText) const override;
+
+	virtual SymTypeKindEnum GetKind() const override { return stkPrimitive; }
+	virtual uint32_t GetLength() const override;
+	virtual bool GetInteger(const void *ValuePtr, int64_t &OutValue) const override;
+	virtual void BuildLayout(FSymLayoutPlan &OutPlan, uint32_t InOffset) const override;
+
+	CPrimitiveTypeEnum GetPrimitiveType() const { return PrimitiveType; }
 protected:
 	FSymPrimitiveType();
 
+	virtual std::wstring BuildTypeName() const override;
+
 	CPrimitiveTypeEnum	PrimitiveType;
 };
 
@@ -141,15 +275,25 @@ public:
 	~FSymPointerType();
 
 	static FSymPointerType* StaticCreate(HANDLE InProcess, uint64_t InModuleBase, uint32_t TypeId);
+	// a pointer type the symbols may not have, for casts and &
+	static FSymPointerType* StaticCreate(HANDLE InProcess, uint64_t InModuleBase, uint32_t TypeId, uint32_t InInnerTypeId, uint32_t InInnerLength);
 
-	// get type name
-	virtual std::wstring TypeName() const override;
 	// get format value
-	virtual std::wstring FormatValue(void *ValuePtr) const override;
+	virtual void FormatValue(void *ValuePtr, FSymExpandBudget &InOutBudget, FFormatBuffer &OutText) const override;
+
+	virtual SymTypeKindEnum GetKind() const override { return stkPointer; }
+	virtual uint32_t GetLength() const override { return Length; }
+	virtual FSymTypeInfo* GetElementType() const override { return ResolveType(InnerTypeId); }
+	virtual bool GetInteger(const void *ValuePtr, int64_t &OutValue) const override;
+	virtual void BuildLayout(FSymLayoutPlan &OutPlan, uint32_t InOffset) const override;
 protected:
 	FSymPointerType();
 
-	FSymTypeInfo    *pInnerType;  // the pointed data type.
+	virtual std::wstring BuildTypeName() const override;
+
+	uint32_t		InnerTypeId;  // the pointed data type.
+	uint32_t		InnerLength;  // bytes of the pointed data
+	uint32_t		Length;       // bytes of the pointer, 4 or 8 as the debuggee has them
 	bool			bIsReference; // is & ?
 };
 
@@ -161,14 +305,18 @@ public:
 
 	static FSymArrayType* StaticCreate(HANDLE InProcess, uint64_t InModuleBase, uint32_t TypeId);
 
-	// get type name
-	virtual std::wstring TypeName() const override;
 	// get format value
-	virtual std::wstring FormatValue(void *ValuePtr) const override;
+	virtual void FormatValue(void *ValuePtr, FSymExpandBudget &InOutBudget, FFormatBuffer &OutText) const override;
+
+	virtual SymTypeKindEnum GetKind() const override { return stkArray; }
+	virtual uint32_t GetLength() const override { return ElementCount * ElementLength; }
+	virtual FSymTypeInfo* GetElementType() const override { return ResolveType(InnerTypeId); }
 protected:
 	FSymArrayType();
 
-	FSymTypeInfo    *pInnerType;  // the pointed data type.
+	virtual std::wstring BuildTypeName() const override;
+
+	uint32_t		 InnerTypeId; // the element type.
 	uint32_t		 ElementCount;// element count
 	uint32_t		 ElementLength; // bytes per element
 };
@@ -181,22 +329,30 @@ public:
 
 	static FSymEnumType* StaticCreate(HANDLE InProcess, uint64_t InModuleBase, uint32_t TypeId);
 
-	// get type name
-	virtual std::wstring TypeName() const override;
 	// get format value
-	virtual std::wstring FormatValue(void *ValuePtr) const override;
+	virtual void FormatValue(void *ValuePtr, FSymExpandBudget &InOutBudget, FFormatBuffer &OutText) const override;
+
+	virtual SymTypeKindEnum GetKind() const override { return stkEnum; }
+	virtual uint32_t GetLength() const override;
+	virtual bool GetInteger(const void *ValuePtr, int64_t &OutValue) const override;
+	virtual void BuildLayout(FSymLayoutPlan &OutPlan, uint32_t InOffset) const override;
+
+	// the name of the enumerator with the value, N/A if there is none
+	void AppendValueName(const void *ValuePtr, FFormatBuffer &OutText) const;
+	CPrimitiveTypeEnum GetValueType() const { return ValueType; }
 protected:
 	FSymEnumType();
 
 	struct FEnumElement
 	{
-		std::wstring   Name;
-		VARIANT		   Value;
+		int64_t		   Value;
+		uint32_t	   NameId;
+
+		bool operator<(const FEnumElement &Other) const { return Value < Other.Value; }
 	};
 
 	CPrimitiveTypeEnum			ValueType;
-	std::wstring				szTypeName;
-	std::vector<FEnumElement>	EnumValues;
+	std::vector<FEnumElement>	EnumValues;		// sorted by value, in declaration order for equal values
 };
 
 // function type
@@ -207,16 +363,17 @@ public:
 
 	static FSymFunctionType* StaticCreate(HANDLE InProcess, uint64_t InModuleBase, uint32_t TypeId);
 
-	// get type name
-	virtual std::wstring TypeName() const override;
 	// get format value
-	virtual std::wstring FormatValue(void *ValuePtr) const override;
+	virtual void FormatValue(void *ValuePtr, FSymExpandBudget &InOutBudget, FFormatBuffer &OutText) const override;
+
+	virtual SymTypeKindEnum GetKind() const override { return stkFunction; }
 protected:
 	FSymFunctionType();
 
-	FSymTypeInfo			   *pReturnType;
-	std::vector<FSymTypeInfo*>  ParamTypes;
-	std::wstring				szFunctionProto;
+	virtual std::wstring BuildTypeName() const override;
+
+	uint32_t				ReturnTypeId;
+	std::vector<uint32_t>	ParamTypeIds;
 };
 
 // typedef type
@@ -227,15 +384,17 @@ public:
 
 	static FSymTypedefType* StaticCreate(HANDLE InProcess, uint64_t InModuleBase, uint32_t TypeId);
 
-	// get type name
-	virtual std::wstring TypeName() const override;
 	// get format value
-	virtual std::wstring FormatValue(void *ValuePtr) const override;
+	virtual void FormatValue(void *ValuePtr, FSymExpandBudget &InOutBudget, FFormatBuffer &OutText) const override;
+	virtual void FormatElements(void *ValuePtr, uint32_t InCount, uint32_t InStride, uint64_t InFirstIndex, FSymExpandBudget &InOutBudget, FFormatBuffer &OutText) const override;
+
+	virtual SymTypeKindEnum GetKind() const override { return stkTypedef; }
+	virtual const FSymTypeInfo* GetRealType() const override;
+	virtual void BuildLayout(FSymLayoutPlan &OutPlan, uint32_t InOffset) const override;
 protected:
 	FSymTypedefType();
 
-	std::wstring	DefName;
-	FSymTypeInfo    *pInnerType;  // the real type
+	uint32_t		InnerTypeId;  // the real type
 };
 
 // user define type(class, union, struct)
@@ -246,22 +405,145 @@ public:
 
 	static FSymComplexType* StaticCreate(HANDLE InProcess, uint64_t InModuleBase, uint32_t TypeId);
 
-	// get type name
-	virtual std::wstring TypeName() const override;
 	// get format value
-	virtual std::wstring FormatValue(void *ValuePtr) const override;
+	virtual void FormatValue(void *ValuePtr, FSymExpandBudget &InOutBudget, FFormatBuffer &OutText) const override;
+
+	virtual SymTypeKindEnum GetKind() const override { return stkComplex; }
+	virtual uint32_t GetLength() const override { return Length; }
+	virtual FSymTypeInfo* FindMember(uint32_t InNameId, uint32_t &OutOffset) const override;
+	virtual const FSymLayoutPlan* GetLayoutPlan() const override;
+	virtual void BuildLayout(FSymLayoutPlan &OutPlan, uint32_t InOffset) const override;
 protected:
 	FSymComplexType();
 
 	struct FMemberElement
 	{
-		std::wstring	Name;
+		uint32_t		NameId;
 		uint32_t		Offset;
-		FSymTypeInfo	*pTypeInfo;
+		uint32_t		TypeId;
+		bool			bBaseClass;
+	};
+
+	// members are queried the first time a value is expanded
+	const std::vector<FMemberElement>& GetMembers() const;
+	// the visualizer of the type, looked up on first use. NULL shows the members.
+	const FSymVisualizer* GetVisualizer() const;
+
+	uint32_t							Length;
+	mutable std::vector<FMemberElement>	Members;
+	mutable bool						bMembersBuilt;
+	mutable FSymVisualizer				*pVisualizer;
+	mutable bool						bVisualizerMatched;
+	mutable FSymLayoutPlan				*pLayoutPlan;
+};
+
+// a type flattened once into the steps that format a value of it, and the leaves, the scalars at fixed
+// offsets its bytes are made of. formatting, hashing and comparing a value are then loops over arrays,
+// without a virtual call, a type lookup or a member query per member.
+class FSymLayoutPlan
+{
+public:
+	struct FLeaf
+	{
+		uint32_t			Offset;
+		uint32_t			Length;
+		CPrimitiveTypeEnum	PrimitiveType;	// cbtNone for pointers and the values formatted by their type
+		uint32_t			Step;			// the member it is
 	};
 
-	std::wstring					UserTypeName;
-	std::vector<FMemberElement>		Members;
+	FSymLayoutPlan() : PendingNameId(kNoNameId) {}
+
+	// the text FormatValue() of the type gives, the visualizer of the outermost value aside
+	void FormatValue(const void *ValuePtr, FSymExpandBudget &InOutBudget, FFormatBuffer &OutText) const;
+	// FNV-1a of the leaves, the padding between members does not count
+	uint64_t HashValue(const void *ValuePtr, uint64_t InHash = 14695981039346656037ull) const;
+	// the leaves whose bytes differ between two values
+	void Diff(const void *InOldValue, const void *InNewValue, std::vector<uint32_t> &OutLeaves) const;
+	// "member.member" of a leaf
+	std::wstring GetLeafPath(uint32_t InLeaf) const;
+	const std::vector<FLeaf>& GetLeaves() const { return Leaves; }
+
+	// building, FSymTypeInfo::BuildLayout() adds the steps of a value. SetMember() names the step
+	// added next, "name(type): " is its label.
+	void SetMember(uint32_t InNameId, const std::wstring &InLabel);
+	void AddPrimitive(uint32_t InOffset, CPrimitiveTypeEnum InPrimitiveType);
+	void AddPointer(uint32_t InOffset, uint32_t InLength, FSymTypeInfo *InPointedType, uint32_t InPointedLength);
+	void AddEnum(uint32_t InOffset, const FSymEnumType *InEnumType);
+	void AddValue(uint32_t InOffset, const FSymTypeInfo *InType);
+	// a member without a type, the label says so
+	void AddUnresolved();
+	// false when aggregates are nested too deep to flatten, the value is then added whole
+	bool BeginAggregate(uint32_t InOffset, const FSymTypeInfo *InType, bool bInVisualized);
+	void EndAggregate();
+
+private:
+	static const uint32_t kNoNameId = 0xFFFFFFFF;
+
+	enum LayoutOpEnum {
+		loPrimitive,
+		loPointer,
+		loEnum,
+		loValue,
+		loUnresolved,
+		loBegin,
+		loEnd
+	};
+
+	struct FStep
+	{
+		LayoutOpEnum		Op;
+		CPrimitiveTypeEnum	PrimitiveType;
+		uint32_t			Offset;
+		uint32_t			LabelStart;		// in Labels
+		uint32_t			LabelLength;
+		uint32_t			NameId;
+		uint32_t			Parent;			// the loBegin of the aggregate the member is in
+		uint32_t			End;			// the loEnd of a loBegin
+		const FSymTypeInfo	*pType;			// loEnum, loValue and loBegin
+		FSymTypeInfo		*pPointedType;	// loPointer
+		uint32_t			PointedLength;
+		uint32_t			PointerLength;	// loPointer, 4 or 8
+		bool				bVisualized;	// loBegin, a visualizer shows the value when there is memory to read
+	};
+
+	// bytes hashed together, the leaves merged where they touch
+	struct FRun
+	{
+		uint32_t	Offset;
+		uint32_t	Length;
+	};
+
+	FStep& AddStep(LayoutOpEnum InOp, uint32_t InOffset);
+	void AddLeaf(uint32_t InOffset, uint32_t InLength, CPrimitiveTypeEnum InPrimitiveType);
+
+	std::vector<FStep>		Steps;
+	std::vector<FLeaf>		Leaves;
+	std::vector<FRun>		Runs;
+	std::wstring			Labels;
+	std::vector<uint32_t>	OpenSteps;		// the loBegin steps not yet ended, while building
+	uint32_t				PendingNameId;
+	std::wstring			PendingLabel;
+};
+
+// provides type attributes for one module, in place of dbghelp.
+// type ids handed to the helper for that module are the source's own ids.
+class FSymTypeSource
+{
+public:
+	virtual ~FSymTypeSource() {}
+
+	// same contract as SymGetTypeInfo
+	virtual BOOL GetTypeInfo(uint32_t TypeId, IMAGEHLP_SYMBOL_TYPE_INFO GetType, PVOID pInfo) = 0;
+	// same contract as SymGetTypeInfoEx for a list of ids, by default one GetTypeInfo() per attribute.
+	virtual BOOL GetTypeInfoEx(PIMAGEHLP_GET_TYPE_INFO_PARAMS Params);
+};
+
+// type queries made while building types, the cost of a type is counted in calls
+struct FSymTypeStats
+{
+	uint64_t	QueryCount;		// single attribute queries
+	uint64_t	BatchCount;		// attribute queries for many ids at once
+	uint64_t	TypeCount;		// types built
 };
 
 // build symbol type description
@@ -270,7 +552,35 @@ class FSymTypeInfoHelper
 public:
 	static void Initialize();
 	static void Uninitialize();
+	// symbol and type names of the process, Uninitialize() clears it.
+	static FStringPool& GetNamePool();
+	// route the type queries of GetTypeSourceKey(InModuleBase) to InSource, the source is not owned. its ids
+	// are not dbghelp ids, its types are built with the key as module base and kept apart from the dbghelp
+	// types of the module. UnloadModule() of the module drops both.
+	static void RegisterTypeSource(uint64_t InModuleBase, FSymTypeSource *InSource);
+	static void UnregisterTypeSource(uint64_t InModuleBase);
+	// modules are 64K aligned, the key is never the base of a module
+	static uint64_t GetTypeSourceKey(uint64_t InModuleBase) { return InModuleBase | 1; }
+	// SymGetTypeInfo, or the registered source of the module.
+	static BOOL GetTypeInfo(HANDLE InProcess, uint64_t InModuleBase, uint32_t TypeId, IMAGEHLP_SYMBOL_TYPE_INFO GetType, PVOID pInfo);
+	// SymGetTypeInfoEx, or the registered source of the module. ReqsValid is required, attributes the
+	// batch did not return are queried one by one and the ones no query could answer stay clear.
+	static BOOL GetTypeInfoEx(HANDLE InProcess, uint64_t InModuleBase, PIMAGEHLP_GET_TYPE_INFO_PARAMS Params);
+	static const FSymTypeStats& GetStats();
+	// memory for a type of the module, types live in one arena per module and are never deleted alone.
+	static void* AllocSymType(uint64_t InModuleBase, size_t InSize);
 	static void CacheSymTypeInfo(HANDLE InProcess, uint64_t InModuleBase, uint32_t TypeId, FSymTypeInfo *InTypeInfo);
+	// destroy the types of a module in one step and drop its type source.
+	static void UnloadModule(uint64_t InModuleBase);
 	static FSymTypeInfo* BuildSymTypeInfo(HANDLE InProcess, uint64_t InModuleBase, uint32_t TypeId);
+	// a primitive type by its c name, "unsigned int", kept with the types of the module. NULL for other names.
+	static FSymTypeInfo* BuildPrimitiveType(HANDLE InProcess, uint64_t InModuleBase, const std::wstring &InName);
+	// a pointer to InPointedType, built once per pointed type and kept with the types of its module.
+	static FSymTypeInfo* BuildPointerType(const FSymTypeInfo *InPointedType);
+	// follow the pointers in InOutPointees breadth first, InMaxLevels levels deep, one "*address(type): value"
+	// line each. the pointees of a level are read together through InMemory, an address is shown once
+	// per type, and the walk ends when the budget runs out. InOutPointees is consumed.
+	static void FormatPointees(FRemotePageCache &InMemory, std::vector<FSymPointee> &InOutPointees, uint32_t InMaxLevels,
+		FSymExpandBudget &InOutBudget, FFormatBuffer &OutText);
 };
 
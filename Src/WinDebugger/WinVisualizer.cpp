@@ -0,0 +1,2060 @@
+// \brief
+//		declarative visualizers for container types.
+//
+
+#include "WinVisualizer.h"
+#include "WinRemoteMemory.h"
+#include "Foundation/AppHelper.h"
+
+#include <cstdio>
+#include <cstring>
+#include <cwchar>
+#include <cwctype>
+#include <set>
+#include <algorithm>
+
+
+namespace NSVisualizer
+{
+	// characters a ,s spec shows at most
+	const uint32_t kMaxStringChars = 256;
+	// biggest value read to format it
+	const uint32_t kMaxValueBytes = 64 * 1024;
+	// bytes of array elements read at once
+	const uint32_t kMaxArrayBytes = 1024 * 1024;
+	// tree nodes read ahead, level by level
+	const uint32_t kMaxPrefetchNodes = 4096;
+}
+
+// descriptions of the standard library containers of vs2015
+static const wchar_t kBuiltinNatvis[] =
+	L"<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+	L"<AutoVisualizer xmlns=\"http://schemas.microsoft.com/vstudio/debugger/natvis/2010\">\n"
+	L"<Type Name=\"std::vector&lt;*&gt;\">\n"
+	L"  <DisplayString>{{ size={_Mypair._Myval2._Mylast - _Mypair._Myval2._Myfirst} }}</DisplayString>\n"
+	L"  <Expand>\n"
+	L"    <Item Name=\"[capacity]\">_Mypair._Myval2._Myend - _Mypair._Myval2._Myfirst</Item>\n"
+	L"    <ArrayItems>\n"
+	L"      <Size>_Mypair._Myval2._Mylast - _Mypair._Myval2._Myfirst</Size>\n"
+	L"      <ValuePointer>_Mypair._Myval2._Myfirst</ValuePointer>\n"
+	L"    </ArrayItems>\n"
+	L"  </Expand>\n"
+	L"</Type>\n"
+	L"<Type Name=\"std::basic_string&lt;char,*&gt;\">\n"
+	L"  <DisplayString Condition=\"_Mypair._Myval2._Myres &lt; 16\">{_Mypair._Myval2._Bx._Buf,s}</DisplayString>\n"
+	L"  <DisplayString>{_Mypair._Myval2._Bx._Ptr,s}</DisplayString>\n"
+	L"</Type>\n"
+	L"<Type Name=\"std::basic_string&lt;wchar_t,*&gt;\">\n"
+	L"  <AlternativeType Name=\"std::basic_string&lt;unsigned short,*&gt;\" />\n"
+	L"  <DisplayString Condition=\"_Mypair._Myval2._Myres &lt; 8\">{_Mypair._Myval2._Bx._Buf,su}</DisplayString>\n"
+	L"  <DisplayString>{_Mypair._Myval2._Bx._Ptr,su}</DisplayString>\n"
+	L"</Type>\n"
+	L"<Type Name=\"std::list&lt;*&gt;\">\n"
+	L"  <DisplayString>{{ size={_Mypair._Myval2._Mysize} }}</DisplayString>\n"
+	L"  <Expand>\n"
+	L"    <LinkedListItems>\n"
+	L"      <Size>_Mypair._Myval2._Mysize</Size>\n"
+	L"      <HeadPointer>_Mypair._Myval2._Myhead-&gt;_Next</HeadPointer>\n"
+	L"      <NextPointer>_Next</NextPointer>\n"
+	L"      <ValueNode>_Myval</ValueNode>\n"
+	L"    </LinkedListItems>\n"
+	L"  </Expand>\n"
+	L"</Type>\n"
+	L"<Type Name=\"std::map&lt;*&gt;\">\n"
+	L"  <AlternativeType Name=\"std::multimap&lt;*&gt;\" />\n"
+	L"  <AlternativeType Name=\"std::set&lt;*&gt;\" />\n"
+	L"  <AlternativeType Name=\"std::multiset&lt;*&gt;\" />\n"
+	L"  <DisplayString>{{ size={_Mypair._Myval2._Myval2._Mysize} }}</DisplayString>\n"
+	L"  <Expand>\n"
+	L"    <TreeItems>\n"
+	L"      <Size>_Mypair._Myval2._Myval2._Mysize</Size>\n"
+	L"      <HeadPointer>_Mypair._Myval2._Myval2._Myhead-&gt;_Parent</HeadPointer>\n"
+	L"      <LeftPointer>_Left</LeftPointer>\n"
+	L"      <RightPointer>_Right</RightPointer>\n"
+	L"      <ValueNode Condition=\"_Isnil == 0\">_Myval</ValueNode>\n"
+	L"    </TreeItems>\n"
+	L"  </Expand>\n"
+	L"</Type>\n"
+	L"</AutoVisualizer>\n";
+
+//////////////////////////////////////////////////////////////////////////
+
+const std::wstring* FXmlElement::FindAttribute(const wchar_t *InName) const
+{
+	for (size_t k = 0; k < Attributes.size(); k++)
+	{
+		if (Attributes[k].first == InName)
+		{
+			return &Attributes[k].second;
+		}
+	} // end for k
+	return NULL;
+}
+
+const FXmlElement* FXmlElement::FindChild(const wchar_t *InName) const
+{
+	for (size_t k = 0; k < Children.size(); k++)
+	{
+		if (Children[k].Name == InName)
+		{
+			return &Children[k];
+		}
+	} // end for k
+	return NULL;
+}
+
+// reads the part of xml natvis files use: elements, attributes, character data, CDATA, comments,
+// processing instructions and the predefined and numeric entities. no DTD.
+class FXmlReader
+{
+public:
+	FXmlReader(const wchar_t *InText, size_t InLength) : Ptr(InText), End(InText + InLength) {}
+
+	bool ReadDocument(FXmlElement &OutRoot)
+	{
+		if (Ptr < End && *Ptr == 0xFEFF)
+		{
+			Ptr++;
+		}
+		SkipMisc();
+		if (!ReadElement(OutRoot))
+		{
+			return false;
+		}
+		SkipMisc();
+		return Ptr == End;
+	}
+
+private:
+	bool StartsWith(const wchar_t *InText) const
+	{
+		const size_t Length = wcslen(InText);
+		return (size_t)(End - Ptr) >= Length && wmemcmp(Ptr, InText, Length) == 0;
+	}
+
+	// to the character after InText, or the end
+	void SkipPast(const wchar_t *InText)
+	{
+		while (Ptr < End && !StartsWith(InText))
+		{
+			Ptr++;
+		}
+		Ptr = Ptr < End ? Ptr + wcslen(InText) : End;
+	}
+
+	void SkipSpace()
+	{
+		while (Ptr < End && iswspace(*Ptr))
+		{
+			Ptr++;
+		}
+	}
+
+	// white space, comments and processing instructions between elements
+	void SkipMisc()
+	{
+		for (;;)
+		{
+			SkipSpace();
+			if (StartsWith(L"<!--"))
+			{
+				SkipPast(L"-->");
+			}
+			else if (StartsWith(L"<?"))
+			{
+				SkipPast(L"?>");
+			}
+			else if (StartsWith(L"<!DOCTYPE"))
+			{
+				SkipPast(L">");
+			}
+			else
+			{
+				return;
+			}
+		} // end for
+	}
+
+	bool ReadName(std::wstring &OutName)
+	{
+		const wchar_t *pBegin = Ptr;
+		while (Ptr < End && (iswalnum(*Ptr) || *Ptr == L'_' || *Ptr == L':' || *Ptr == L'-' || *Ptr == L'.'))
+		{
+			Ptr++;
+		}
+		OutName.assign(pBegin, Ptr - pBegin);
+		return !OutName.empty();
+	}
+
+	static void AppendDecoded(const wchar_t *InBegin, const wchar_t *InEnd, std::wstring &OutText)
+	{
+		for (const wchar_t *pChar = InBegin; pChar < InEnd; pChar++)
+		{
+			const wchar_t *pSemicolon = *pChar == L'&' ? std::find(pChar, InEnd, L';') : InEnd;
+			if (pSemicolon == InEnd)
+			{
+				OutText.push_back(*pChar);
+				continue;
+			}
+
+			const std::wstring Entity(pChar + 1, pSemicolon);
+			if (Entity == L"lt")			{ OutText.push_back(L'<'); }
+			else if (Entity == L"gt")		{ OutText.push_back(L'>'); }
+			else if (Entity == L"amp")		{ OutText.push_back(L'&'); }
+			else if (Entity == L"quot")		{ OutText.push_back(L'"'); }
+			else if (Entity == L"apos")		{ OutText.push_back(L'\''); }
+			else if (Entity.size() > 1 && Entity[0] == L'#')
+			{
+				const bool bHex = Entity[1] == L'x' || Entity[1] == L'X';
+				OutText.push_back((wchar_t)wcstoul(Entity.c_str() + (bHex ? 2 : 1), NULL, bHex ? 16 : 10));
+			}
+			else
+			{
+				OutText.push_back(*pChar);
+				continue;
+			}
+			pChar = pSemicolon;
+		} // end for
+	}
+
+	bool ReadElement(FXmlElement &OutElement)
+	{
+		if (Ptr >= End || *Ptr != L'<')
+		{
+			return false;
+		}
+		Ptr++;
+		if (!ReadName(OutElement.Name))
+		{
+			return false;
+		}
+
+		// attributes
+		for (;;)
+		{
+			SkipSpace();
+			if (StartsWith(L"/>"))
+			{
+				Ptr += 2;
+				return true;
+			}
+			if (Ptr < End && *Ptr == L'>')
+			{
+				Ptr++;
+				break;
+			}
+
+			std::pair<std::wstring, std::wstring> Attribute;
+			if (!ReadName(Attribute.first))
+			{
+				return false;
+			}
+			SkipSpace();
+			if (Ptr >= End || *Ptr != L'=')
+			{
+				return false;
+			}
+			Ptr++;
+			SkipSpace();
+			if (Ptr >= End || (*Ptr != L'"' && *Ptr != L'\''))
+			{
+				return false;
+			}
+			const wchar_t Quote = *Ptr++;
+			const wchar_t *pValueEnd = std::find(Ptr, End, Quote);
+			if (pValueEnd == End)
+			{
+				return false;
+			}
+			AppendDecoded(Ptr, pValueEnd, Attribute.second);
+			OutElement.Attributes.push_back(Attribute);
+			Ptr = pValueEnd + 1;
+		} // end for
+
+		// content
+		while (Ptr < End)
+		{
+			if (*Ptr != L'<')
+			{
+				const wchar_t *pTextEnd = std::find(Ptr, End, L'<');
+				AppendDecoded(Ptr, pTextEnd, OutElement.Text);
+				Ptr = pTextEnd;
+			}
+			else if (StartsWith(L"</"))
+			{
+				Ptr += 2;
+				std::wstring CloseName;
+				ReadName(CloseName);
+				SkipSpace();
+				if (Ptr >= End || *Ptr != L'>' || CloseName != OutElement.Name)
+				{
+					return false;
+				}
+				Ptr++;
+				return true;
+			}
+			else if (StartsWith(L"<![CDATA["))
+			{
+				Ptr += 9;
+				const wchar_t *pDataBegin = Ptr;
+				while (Ptr < End && !StartsWith(L"]]>"))
+				{
+					Ptr++;
+				}
+				OutElement.Text.append(pDataBegin, Ptr - pDataBegin);
+				Ptr = Ptr < End ? Ptr + 3 : End;
+			}
+			else if (StartsWith(L"<!--"))
+			{
+				SkipPast(L"-->");
+			}
+			else if (StartsWith(L"<?"))
+			{
+				SkipPast(L"?>");
+			}
+			else
+			{
+				OutElement.Children.push_back(FXmlElement());
+				if (!ReadElement(OutElement.Children.back()))
+				{
+					return false;
+				}
+			}
+		} // end while
+
+		return false;
+	}
+
+	const wchar_t	*Ptr;
+	const wchar_t	*End;
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+static const FSymTypeInfo* GetRealType(const FSymTypeInfo *InType)
+{
+	return InType ? InType->GetRealType() : NULL;
+}
+
+static SymTypeKindEnum GetRealKind(const FSymTypeInfo *InType)
+{
+	return InType ? InType->GetRealType()->GetKind() : stkUnknown;
+}
+
+// integers and what converts to one
+static bool IsIntegral(const FSymTypeInfo *InType)
+{
+	const SymTypeKindEnum Kind = GetRealKind(InType);
+	return !InType || Kind == stkPrimitive || Kind == stkEnum;
+}
+
+// bytes of the element of a pointer or array, 0 for void*
+static uint32_t GetElementLength(const FSymTypeInfo *InType)
+{
+	const FSymTypeInfo *pElementType = InType ? GetRealType(InType->GetRealType()->GetElementType()) : NULL;
+	return pElementType ? pElementType->GetLength() : 0;
+}
+
+// values $name reads
+static const struct
+{
+	const wchar_t	*szName;
+	VisRegisterEnum	Register;
+} sVisRegisters[] =
+{
+#if defined(_M_X64)
+	{ L"$rax", vrEax },
+	{ L"$rbx", vrEbx },
+	{ L"$rcx", vrEcx },
+	{ L"$rdx", vrEdx },
+	{ L"$rsi", vrEsi },
+	{ L"$rdi", vrEdi },
+	{ L"$rbp", vrEbp },
+	{ L"$rsp", vrEsp },
+	{ L"$rip", vrEip },
+	{ L"$r8", vrR8 },
+	{ L"$r9", vrR9 },
+	{ L"$r10", vrR10 },
+	{ L"$r11", vrR11 },
+	{ L"$r12", vrR12 },
+	{ L"$r13", vrR13 },
+	{ L"$r14", vrR14 },
+	{ L"$r15", vrR15 },
+#else
+	{ L"$eax", vrEax },
+	{ L"$ebx", vrEbx },
+	{ L"$ecx", vrEcx },
+	{ L"$edx", vrEdx },
+	{ L"$esi", vrEsi },
+	{ L"$edi", vrEdi },
+	{ L"$ebp", vrEbp },
+	{ L"$esp", vrEsp },
+	{ L"$eip", vrEip },
+#endif
+	{ L"$eflags", vrEflags },
+};
+
+// recursive descent over the C subset natvis and eval expressions use. nodes are typed as they are
+// made, a member name becomes an offset and a name of the scope its binding.
+struct FVisParser
+{
+	typedef FVisExpression::FNode FNode;
+
+	FVisParser(FVisExpression &InExpression, const wchar_t *InText, const FSymTypeInfo *InThisType, const FVisScope *InScope)
+		: Expression(InExpression)
+		, Ptr(InText)
+		, pThisType(InThisType)
+		, pScope(InScope)
+	{
+	}
+
+	void SkipSpace()
+	{
+		while (*Ptr && iswspace(*Ptr))
+		{
+			Ptr++;
+		}
+	}
+
+	// an operator, not the start of a longer one
+	bool Accept(const wchar_t *InOperator)
+	{
+		SkipSpace();
+		const size_t Length = wcslen(InOperator);
+		if (wcsncmp(Ptr, InOperator, Length) != 0)
+		{
+			return false;
+		}
+		const wchar_t Next = Ptr[Length];
+		if (Length == 1 && Next == L'=' && wcschr(L"<>!=", InOperator[0]))
+		{
+			return false;
+		}
+		if (Length == 1 && InOperator[0] == L'-' && (Next == L'>' || Next == L'-'))
+		{
+			return false;
+		}
+		if (Length == 1 && wcschr(L"&|<>", InOperator[0]) && Next == InOperator[0])
+		{
+			return false;
+		}
+		Ptr += Length;
+		return true;
+	}
+
+	bool ReadIdentifier(std::wstring &OutName)
+	{
+		SkipSpace();
+		const wchar_t *pBegin = Ptr;
+		if (iswalpha(*Ptr) || *Ptr == L'_' || *Ptr == L'$')
+		{
+			while (iswalnum(*Ptr) || *Ptr == L'_' || *Ptr == L'$')
+			{
+				Ptr++;
+			}
+		}
+		OutName.assign(pBegin, Ptr - pBegin);
+		return !OutName.empty();
+	}
+
+	uint32_t AddNode(FVisExpression::VisOpEnum InOp, const FSymTypeInfo *InType, int64_t InInteger, uint32_t InLeft, uint32_t InRight)
+	{
+		FNode Node;
+		Node.Op = InOp;
+		Node.pType = InType;
+		Node.Integer = InInteger;
+		Node.Left = InLeft;
+		Node.Right = InRight;
+		Expression.Nodes.push_back(Node);
+		return (uint32_t)Expression.Nodes.size() - 1;
+	}
+
+	const FSymTypeInfo* TypeOf(uint32_t InNode) const
+	{
+		return Expression.Nodes[InNode].pType;
+	}
+
+	uint32_t AddMember(uint32_t InOuter, const std::wstring &InName)
+	{
+		const FSymTypeInfo *pOuterType = GetRealType(TypeOf(InOuter));
+		if (!pOuterType || pOuterType->GetKind() != stkComplex)
+		{
+			return FVisExpression::kNoNode;
+		}
+
+		uint32_t Offset = 0;
+		const FSymTypeInfo *pMemberType = pOuterType->FindMember(FSymTypeInfoHelper::GetNamePool().Intern(InName), Offset);
+		return pMemberType ? AddNode(FVisExpression::voMember, pMemberType, Offset, InOuter, FVisExpression::kNoNode) : FVisExpression::kNoNode;
+	}
+
+	uint32_t AddDeref(uint32_t InPointer)
+	{
+		const FSymTypeInfo *pPointerType = TypeOf(InPointer);
+		if (GetRealKind(pPointerType) != stkPointer || !pPointerType->GetRealType()->GetElementType())
+		{
+			return FVisExpression::kNoNode;
+		}
+		return AddNode(FVisExpression::voDeref, pPointerType->GetRealType()->GetElementType(), 0, InPointer, FVisExpression::kNoNode);
+	}
+
+	uint32_t AddBinding(const FVisBinding &InBinding)
+	{
+		switch (InBinding.Kind)
+		{
+		case vbAddress:				return AddNode(FVisExpression::voAddress, InBinding.pType, InBinding.Offset, FVisExpression::kNoNode, FVisExpression::kNoNode);
+		case vbRegisterRelative:	return AddNode(FVisExpression::voRegisterRelative, InBinding.pType, InBinding.Offset, FVisExpression::kNoNode, InBinding.Register);
+		case vbRegister:			return AddNode(FVisExpression::voRegister, InBinding.pType, 0, FVisExpression::kNoNode, InBinding.Register);
+		case vbConstant:			return AddNode(FVisExpression::voConst, NULL, InBinding.Offset, FVisExpression::kNoNode, FVisExpression::kNoNode);
+		default:					return FVisExpression::kNoNode;
+		}
+	}
+
+	// after "(": the type of a cast as the symbols name it, "const", "struct" and the like left out.
+	// false, and nothing read, if the parenthesis holds no type of the scope.
+	bool ReadCastType(const FSymTypeInfo *&OutType)
+	{
+		if (!pScope)
+		{
+			return false;
+		}
+
+		const wchar_t *pStart = Ptr;
+		std::wstring TypeName, Word;
+		uint32_t PointerLevels = 0;
+		while (ReadIdentifier(Word))
+		{
+			if (Word == L"const" || Word == L"volatile" || Word == L"struct" || Word == L"class" || Word == L"union" || Word == L"enum")
+			{
+				continue;
+			}
+			if (!TypeName.empty() && TypeName[TypeName.size() - 1] != L':')
+			{
+				TypeName += L' ';
+			}
+			TypeName += Word;
+
+			SkipSpace();
+			if (*Ptr == L'<')
+			{
+				// template arguments spaced as the symbols have them, "A<B<int> >"
+				uint32_t Nesting = 0;
+				do
+				{
+					Nesting += *Ptr == L'<';
+					Nesting -= *Ptr == L'>';
+					const wchar_t Last = TypeName[TypeName.size() - 1];
+					if (iswspace(*Ptr))
+					{
+						SkipSpace();
+						if ((iswalnum(Last) || Last == L'_') && (iswalnum(*Ptr) || *Ptr == L'_'))
+						{
+							TypeName += L' ';
+						}
+						continue;
+					}
+					if (*Ptr == L'>' && Last == L'>')
+					{
+						TypeName += L' ';
+					}
+					TypeName += *Ptr++;
+				} while (*Ptr && Nesting);
+			}
+			// "unsigned int" goes on with a word, a qualified name with ::
+			if (Accept(L"::"))
+			{
+				TypeName += L"::";
+			}
+			else if (!iswalpha(*Ptr) && *Ptr != L'_')
+			{
+				break;
+			}
+		} // end while
+		while (Accept(L"*"))
+		{
+			PointerLevels++;
+			ReadIdentifier(Word);
+			if (Word != L"const" && !Word.empty())
+			{
+				break;
+			}
+		} // end while
+
+		FVisBinding Binding;
+		OutType = NULL;
+		if (!TypeName.empty() && Accept(L")") && (PointerLevels || !pScope->FindName(TypeName, Binding)))
+		{
+			OutType = pScope->FindType(TypeName);
+		}
+		for (uint32_t k = 0; OutType && k < PointerLevels; k++)
+		{
+			OutType = FSymTypeInfoHelper::BuildPointerType(OutType);
+		} // end for k
+
+		if (!OutType)
+		{
+			Ptr = pStart;
+			return false;
+		}
+		return true;
+	}
+
+	// integers, enums and pointers convert to each other, the value is cut to the size of the type
+	uint32_t AddCast(const FSymTypeInfo *InType, uint32_t InOperand)
+	{
+		const FSymTypeInfo *pRealType = GetRealType(InType);
+		const SymTypeKindEnum Kind = pRealType->GetKind();
+		const SymTypeKindEnum OperandKind = GetRealKind(TypeOf(InOperand));
+		const bool bScalar = Kind == stkPointer || Kind == stkEnum
+			|| (Kind == stkPrimitive && pRealType->GetLength() && static_cast<const FSymPrimitiveType*>(pRealType)->GetPrimitiveType() != cbtFloat
+				&& static_cast<const FSymPrimitiveType*>(pRealType)->GetPrimitiveType() != cbtDouble);
+		if (!bScalar || (!IsIntegral(TypeOf(InOperand)) && OperandKind != stkPointer && OperandKind != stkArray))
+		{
+			return FVisExpression::kNoNode;
+		}
+		return AddNode(FVisExpression::voCast, InType, 0, InOperand, FVisExpression::kNoNode);
+	}
+
+	uint32_t ParsePrimary()
+	{
+		SkipSpace();
+		if (Accept(L"("))
+		{
+			const FSymTypeInfo *pCastType = NULL;
+			if (ReadCastType(pCastType))
+			{
+				const uint32_t Operand = ParseUnary();
+				return Operand != FVisExpression::kNoNode ? AddCast(pCastType, Operand) : FVisExpression::kNoNode;
+			}
+			const uint32_t Inner = ParseOr();
+			return Inner != FVisExpression::kNoNode && Accept(L")") ? Inner : FVisExpression::kNoNode;
+		}
+
+		if (iswdigit(*Ptr))
+		{
+			wchar_t *pEnd = NULL;
+			const int64_t Value = (int64_t)wcstoull(Ptr, &pEnd, 0);
+			Ptr = pEnd;
+			while (*Ptr == L'u' || *Ptr == L'U' || *Ptr == L'l' || *Ptr == L'L')
+			{
+				Ptr++;
+			}
+			return AddNode(FVisExpression::voConst, NULL, Value, FVisExpression::kNoNode, FVisExpression::kNoNode);
+		}
+
+		std::wstring Name;
+		if (!ReadIdentifier(Name))
+		{
+			return FVisExpression::kNoNode;
+		}
+		if (Name == L"this" && pThisType)
+		{
+			return AddNode(FVisExpression::voThis, pThisType, 0, FVisExpression::kNoNode, FVisExpression::kNoNode);
+		}
+		if (Name == L"true" || Name == L"false" || Name == L"nullptr" || Name == L"NULL")
+		{
+			return AddNode(FVisExpression::voConst, NULL, Name == L"true" ? 1 : 0, FVisExpression::kNoNode, FVisExpression::kNoNode);
+		}
+		if (Name[0] == L'$')
+		{
+			for (uint32_t k = 0; k < XARRAY_COUNT(sVisRegisters); k++)
+			{
+				if (!_wcsicmp(Name.c_str(), sVisRegisters[k].szName))
+				{
+					return AddNode(FVisExpression::voRegister, NULL, 0, FVisExpression::kNoNode, sVisRegisters[k].Register);
+				}
+			} // end for k
+			return FVisExpression::kNoNode;
+		}
+		// a member of this, then a name of the scope
+		if (pThisType)
+		{
+			const uint32_t This = AddNode(FVisExpression::voThis, pThisType, 0, FVisExpression::kNoNode, FVisExpression::kNoNode);
+			const uint32_t Member = AddMember(This, Name);
+			if (Member != FVisExpression::kNoNode || !pScope)
+			{
+				return Member;
+			}
+		}
+		FVisBinding Binding;
+		return pScope && pScope->FindName(Name, Binding) ? AddBinding(Binding) : FVisExpression::kNoNode;
+	}
+
+	uint32_t ParsePostfix()
+	{
+		uint32_t Node = ParsePrimary();
+		while (Node != FVisExpression::kNoNode)
+		{
+			std::wstring Name;
+			if (Accept(L"."))
+			{
+				Node = ReadIdentifier(Name) ? AddMember(Node, Name) : FVisExpression::kNoNode;
+			}
+			else if (Accept(L"->"))
+			{
+				// this is the value itself, not a pointer to it
+				if (Expression.Nodes[Node].Op != FVisExpression::voThis)
+				{
+					Node = AddDeref(Node);
+				}
+				Node = Node != FVisExpression::kNoNode && ReadIdentifier(Name) ? AddMember(Node, Name) : FVisExpression::kNoNode;
+			}
+			else if (Accept(L"["))
+			{
+				const uint32_t Index = ParseOr();
+				const SymTypeKindEnum Kind = GetRealKind(TypeOf(Node));
+				const uint32_t ElementLength = GetElementLength(TypeOf(Node));
+				if (Index == FVisExpression::kNoNode || !Accept(L"]") || !IsIntegral(TypeOf(Index))
+					|| (Kind != stkPointer && Kind != stkArray) || ElementLength == 0)
+				{
+					return FVisExpression::kNoNode;
+				}
+				Node = AddNode(FVisExpression::voIndex, TypeOf(Node)->GetRealType()->GetElementType(), ElementLength, Node, Index);
+			}
+			else
+			{
+				break;
+			}
+		} // end while
+		return Node;
+	}
+
+	uint32_t ParseUnary()
+	{
+		if (Accept(L"-"))
+		{
+			const uint32_t Operand = ParseUnary();
+			return Operand != FVisExpression::kNoNode && IsIntegral(TypeOf(Operand))
+				? AddNode(FVisExpression::voNeg, NULL, 0, Operand, FVisExpression::kNoNode) : FVisExpression::kNoNode;
+		}
+		if (Accept(L"!"))
+		{
+			const uint32_t Operand = ParseUnary();
+			return Operand != FVisExpression::kNoNode ? AddNode(FVisExpression::voNot, NULL, 0, Operand, FVisExpression::kNoNode) : FVisExpression::kNoNode;
+		}
+		if (Accept(L"~"))
+		{
+			const uint32_t Operand = ParseUnary();
+			return Operand != FVisExpression::kNoNode && IsIntegral(TypeOf(Operand))
+				? AddNode(FVisExpression::voBitNot, NULL, 0, Operand, FVisExpression::kNoNode) : FVisExpression::kNoNode;
+		}
+		if (Accept(L"&"))
+		{
+			// only what is in memory has an address
+			const uint32_t Operand = ParseUnary();
+			if (Operand == FVisExpression::kNoNode)
+			{
+				return FVisExpression::kNoNode;
+			}
+			const FVisExpression::VisOpEnum Op = Expression.Nodes[Operand].Op;
+			if (Op != FVisExpression::voThis && Op != FVisExpression::voAddress && Op != FVisExpression::voRegisterRelative
+				&& Op != FVisExpression::voMember && Op != FVisExpression::voDeref && Op != FVisExpression::voIndex)
+			{
+				return FVisExpression::kNoNode;
+			}
+			return AddNode(FVisExpression::voAddressOf, FSymTypeInfoHelper::BuildPointerType(TypeOf(Operand)), 0, Operand, FVisExpression::kNoNode);
+		}
+		if (Accept(L"*"))
+		{
+			const uint32_t Operand = ParseUnary();
+			return Operand != FVisExpression::kNoNode ? AddDeref(Operand) : FVisExpression::kNoNode;
+		}
+		if (Accept(L"+"))
+		{
+			return ParseUnary();
+		}
+		return ParsePostfix();
+	}
+
+	uint32_t ParseMultiplicative()
+	{
+		uint32_t Left = ParseUnary();
+		while (Left != FVisExpression::kNoNode)
+		{
+			FVisExpression::VisOpEnum Op;
+			if (Accept(L"*"))		{ Op = FVisExpression::voMul; }
+			else if (Accept(L"/"))	{ Op = FVisExpression::voDiv; }
+			else if (Accept(L"%"))	{ Op = FVisExpression::voMod; }
+			else					{ break; }
+
+			const uint32_t Right = ParseUnary();
+			if (Right == FVisExpression::kNoNode || !IsIntegral(TypeOf(Left)) || !IsIntegral(TypeOf(Right)))
+			{
+				return FVisExpression::kNoNode;
+			}
+			Left = AddNode(Op, NULL, 0, Left, Right);
+		} // end while
+		return Left;
+	}
+
+	// pointer arithmetic is scaled by the element length
+	uint32_t ParseAdditive()
+	{
+		uint32_t Left = ParseMultiplicative();
+		while (Left != FVisExpression::kNoNode)
+		{
+			bool bAdd;
+			if (Accept(L"+"))		{ bAdd = true; }
+			else if (Accept(L"-"))	{ bAdd = false; }
+			else					{ break; }
+
+			uint32_t Right = ParseMultiplicative();
+			if (Right == FVisExpression::kNoNode)
+			{
+				return FVisExpression::kNoNode;
+			}
+			if (bAdd && IsIntegral(TypeOf(Left)) && GetRealKind(TypeOf(Right)) == stkPointer)
+			{
+				std::swap(Left, Right);
+			}
+
+			const bool bLeftPointer = GetRealKind(TypeOf(Left)) == stkPointer;
+			const bool bRightPointer = GetRealKind(TypeOf(Right)) == stkPointer;
+			const uint32_t ElementLength = bLeftPointer ? GetElementLength(TypeOf(Left)) : 0;
+			if (IsIntegral(TypeOf(Left)) && IsIntegral(TypeOf(Right)))
+			{
+				Left = AddNode(bAdd ? FVisExpression::voAdd : FVisExpression::voSub, NULL, 0, Left, Right);
+			}
+			else if (bLeftPointer && IsIntegral(TypeOf(Right)) && ElementLength)
+			{
+				Left = AddNode(bAdd ? FVisExpression::voAdd : FVisExpression::voSub, TypeOf(Left), ElementLength, Left, Right);
+			}
+			else if (!bAdd && bLeftPointer && bRightPointer && ElementLength)
+			{
+				// the element count between two pointers
+				Left = AddNode(FVisExpression::voSub, NULL, ElementLength, Left, Right);
+			}
+			else
+			{
+				return FVisExpression::kNoNode;
+			}
+		} // end while
+		return Left;
+	}
+
+	uint32_t ParseShift()
+	{
+		uint32_t Left = ParseAdditive();
+		while (Left != FVisExpression::kNoNode)
+		{
+			FVisExpression::VisOpEnum Op;
+			if (Accept(L"<<"))		{ Op = FVisExpression::voShiftLeft; }
+			else if (Accept(L">>"))	{ Op = FVisExpression::voShiftRight; }
+			else					{ break; }
+
+			const uint32_t Right = ParseAdditive();
+			if (Right == FVisExpression::kNoNode || !IsIntegral(TypeOf(Left)) || !IsIntegral(TypeOf(Right)))
+			{
+				return FVisExpression::kNoNode;
+			}
+			Left = AddNode(Op, NULL, 0, Left, Right);
+		} // end while
+		return Left;
+	}
+
+	uint32_t ParseRelational()
+	{
+		uint32_t Left = ParseShift();
+		while (Left != FVisExpression::kNoNode)
+		{
+			FVisExpression::VisOpEnum Op;
+			if (Accept(L"<="))		{ Op = FVisExpression::voLessEqual; }
+			else if (Accept(L">="))	{ Op = FVisExpression::voGreaterEqual; }
+			else if (Accept(L"<"))	{ Op = FVisExpression::voLess; }
+			else if (Accept(L">"))	{ Op = FVisExpression::voGreater; }
+			else					{ break; }
+
+			const uint32_t Right = ParseShift();
+			Left = Right != FVisExpression::kNoNode ? AddNode(Op, NULL, 0, Left, Right) : FVisExpression::kNoNode;
+		} // end while
+		return Left;
+	}
+
+	uint32_t ParseEquality()
+	{
+		uint32_t Left = ParseRelational();
+		while (Left != FVisExpression::kNoNode)
+		{
+			FVisExpression::VisOpEnum Op;
+			if (Accept(L"=="))		{ Op = FVisExpression::voEqual; }
+			else if (Accept(L"!="))	{ Op = FVisExpression::voNotEqual; }
+			else					{ break; }
+
+			const uint32_t Right = ParseRelational();
+			Left = Right != FVisExpression::kNoNode ? AddNode(Op, NULL, 0, Left, Right) : FVisExpression::kNoNode;
+		} // end while
+		return Left;
+	}
+
+	// &, ^ and | over integers, InLevel 0 is the tightest
+	uint32_t ParseBitwise(uint32_t InLevel)
+	{
+		static const wchar_t *sOperators[] = { L"&", L"^", L"|" };
+		static const FVisExpression::VisOpEnum sOps[] = { FVisExpression::voBitAnd, FVisExpression::voBitXor, FVisExpression::voBitOr };
+
+		uint32_t Left = InLevel ? ParseBitwise(InLevel - 1) : ParseEquality();
+		while (Left != FVisExpression::kNoNode && Accept(sOperators[InLevel]))
+		{
+			const uint32_t Right = InLevel ? ParseBitwise(InLevel - 1) : ParseEquality();
+			if (Right == FVisExpression::kNoNode || !IsIntegral(TypeOf(Left)) || !IsIntegral(TypeOf(Right)))
+			{
+				return FVisExpression::kNoNode;
+			}
+			Left = AddNode(sOps[InLevel], NULL, 0, Left, Right);
+		} // end while
+		return Left;
+	}
+
+	uint32_t ParseAnd()
+	{
+		uint32_t Left = ParseBitwise(2);
+		while (Left != FVisExpression::kNoNode && Accept(L"&&"))
+		{
+			const uint32_t Right = ParseBitwise(2);
+			Left = Right != FVisExpression::kNoNode ? AddNode(FVisExpression::voAnd, NULL, 0, Left, Right) : FVisExpression::kNoNode;
+		} // end while
+		return Left;
+	}
+
+	uint32_t ParseOr()
+	{
+		uint32_t Left = ParseAnd();
+		while (Left != FVisExpression::kNoNode && Accept(L"||"))
+		{
+			const uint32_t Right = ParseAnd();
+			Left = Right != FVisExpression::kNoNode ? AddNode(FVisExpression::voOr, NULL, 0, Left, Right) : FVisExpression::kNoNode;
+		} // end while
+		return Left;
+	}
+
+	FVisExpression		&Expression;
+	const wchar_t		*Ptr;
+	const FSymTypeInfo	*pThisType;		// NULL outside a visualizer
+	const FVisScope		*pScope;
+};
+
+bool FVisExpression::Compile(const std::wstring &InText, const FSymTypeInfo *InThisType, const FVisScope *InScope)
+{
+	Nodes.clear();
+	Spec.clear();
+	Root = kNoNode;
+
+	FVisParser Parser(*this, InText.c_str(), InThisType, InScope);
+	const uint32_t Node = Parser.ParseOr();
+	if (Node == kNoNode)
+	{
+		return false;
+	}
+
+	// the expression has no comma operator, a comma starts the format spec
+	if (Parser.Accept(L","))
+	{
+		Parser.SkipSpace();
+		const wchar_t *pSpecEnd = Parser.Ptr + wcslen(Parser.Ptr);
+		while (pSpecEnd > Parser.Ptr && iswspace(pSpecEnd[-1]))
+		{
+			pSpecEnd--;
+		}
+		Spec.assign(Parser.Ptr, pSpecEnd);
+		Parser.Ptr = pSpecEnd;
+	}
+	Parser.SkipSpace();
+	if (*Parser.Ptr)
+	{
+		return false;
+	}
+
+	Root = Node;
+	return true;
+}
+
+bool FVisExpression::ReadInteger(const FVisValue &InValue, FRemotePageCache *pMemory, int64_t &OutValue)
+{
+	if (!InValue.bLValue)
+	{
+		OutValue = InValue.Integer;
+		return true;
+	}
+
+	const FSymTypeInfo *pRealType = GetRealType(InValue.pType);
+	if (pRealType && pRealType->GetKind() == stkArray)
+	{
+		// an array in the debuggee decays to the address of its first element
+		OutValue = (int64_t)InValue.Address;
+		return !InValue.pLocal;
+	}
+	const uint32_t Length = pRealType ? pRealType->GetLength() : 0;
+	BYTE Bytes[8];
+	if (Length == 0 || Length > sizeof(Bytes))
+	{
+		return false;
+	}
+	if (InValue.pLocal)
+	{
+		memcpy(Bytes, InValue.pLocal, Length);
+	}
+	else if (!pMemory || !pMemory->ReadMemory(InValue.Address, Bytes, Length))
+	{
+		return false;
+	}
+	return pRealType->GetInteger(Bytes, OutValue);
+}
+
+// an integer as a scalar type holds it, cut to its size and extended by its sign
+static bool ConvertInteger(const FSymTypeInfo *InType, int64_t InValue, int64_t &OutValue)
+{
+	BYTE Bytes[sizeof(InValue)];
+	memcpy(Bytes, &InValue, sizeof(InValue));
+	return GetRealType(InType)->GetInteger(Bytes, OutValue);
+}
+
+bool FVisExpression::Evaluate(const FVisContext &InContext, FVisValue &OutValue) const
+{
+	return IsValid() && EvaluateNode(Root, InContext, OutValue);
+}
+
+bool FVisExpression::EvaluateInteger(const FVisContext &InContext, int64_t &OutValue) const
+{
+	return IsValid() && EvaluateNodeInteger(Root, InContext, OutValue);
+}
+
+bool FVisExpression::EvaluateNode(uint32_t InNode, const FVisContext &InContext, FVisValue &OutValue) const
+{
+	const FNode &Node = Nodes[InNode];
+	OutValue.pType = Node.pType;
+	OutValue.bLValue = false;
+	OutValue.pLocal = NULL;
+	OutValue.Address = 0;
+	OutValue.Integer = 0;
+
+	switch (Node.Op)
+	{
+	case voThis:
+		OutValue.bLValue = true;
+		OutValue.pLocal = InContext.pThis;
+		OutValue.Address = InContext.ThisAddress;
+		return true;
+
+	case voAddress:
+		OutValue.bLValue = true;
+		OutValue.Address = (uint64_t)Node.Integer;
+		return true;
+
+	case voRegisterRelative:
+		if (!InContext.pRegisters)
+		{
+			return false;
+		}
+		OutValue.bLValue = true;
+		OutValue.Address = InContext.pRegisters[Node.Right] + Node.Integer;
+		return true;
+
+	case voMember:
+	{
+		FVisValue Outer;
+		if (!EvaluateNode(Node.Left, InContext, Outer) || !Outer.bLValue)
+		{
+			return false;
+		}
+		OutValue.bLValue = true;
+		OutValue.pLocal = Outer.pLocal ? Outer.pLocal + Node.Integer : NULL;
+		OutValue.Address = Outer.pLocal ? 0 : Outer.Address + Node.Integer;
+		return true;
+	}
+
+	case voDeref:
+	{
+		int64_t Address = 0;
+		if (!EvaluateNodeInteger(Node.Left, InContext, Address) || Address == 0)
+		{
+			return false;
+		}
+		OutValue.bLValue = true;
+		OutValue.Address = (uint64_t)Address;
+		return true;
+	}
+
+	case voIndex:
+	{
+		FVisValue Base;
+		int64_t Index = 0;
+		if (!EvaluateNode(Node.Left, InContext, Base) || !EvaluateNodeInteger(Node.Right, InContext, Index))
+		{
+			return false;
+		}
+		const int64_t Offset = Index * Node.Integer;
+
+		// an array is indexed where it is, the bytes of this only as far as the array goes
+		const FSymTypeInfo *pBaseType = GetRealType(Base.pType);
+		if (pBaseType->GetKind() == stkArray)
+		{
+			if (!Base.bLValue || (Base.pLocal && (Offset < 0 || Offset + Node.Integer > pBaseType->GetLength())))
+			{
+				return false;
+			}
+			OutValue.bLValue = true;
+			OutValue.pLocal = Base.pLocal ? Base.pLocal + Offset : NULL;
+			OutValue.Address = Base.pLocal ? 0 : Base.Address + Offset;
+			return true;
+		}
+
+		int64_t Address = 0;
+		if (!ReadInteger(Base, InContext.pMemory, Address) || Address == 0)
+		{
+			return false;
+		}
+		OutValue.bLValue = true;
+		OutValue.Address = (uint64_t)(Address + Offset);
+		return true;
+	}
+
+	default:
+		return EvaluateNodeInteger(InNode, InContext, OutValue.Integer);
+	}
+}
+
+bool FVisExpression::EvaluateNodeInteger(uint32_t InNode, const FVisContext &InContext, int64_t &OutValue) const
+{
+	const FNode &Node = Nodes[InNode];
+	int64_t Left = 0, Right = 0;
+
+	switch (Node.Op)
+	{
+	case voConst:
+		OutValue = Node.Integer;
+		return true;
+
+	case voRegister:
+		if (!InContext.pRegisters)
+		{
+			return false;
+		}
+		OutValue = (int64_t)InContext.pRegisters[Node.Right];
+		return !Node.pType || ConvertInteger(Node.pType, OutValue, OutValue);
+
+	case voThis:
+	case voAddress:
+	case voRegisterRelative:
+	case voMember:
+	case voDeref:
+	case voIndex:
+	{
+		FVisValue Value;
+		return EvaluateNode(InNode, InContext, Value) && ReadInteger(Value, InContext.pMemory, OutValue);
+	}
+
+	case voAddressOf:
+	{
+		FVisValue Value;
+		if (!EvaluateNode(Node.Left, InContext, Value) || !Value.bLValue || Value.pLocal)
+		{
+			return false;
+		}
+		OutValue = (int64_t)Value.Address;
+		return true;
+	}
+
+	case voCast:
+		return EvaluateNodeInteger(Node.Left, InContext, Left) && ConvertInteger(Node.pType, Left, OutValue);
+
+	case voAnd:
+	case voOr:
+		if (!EvaluateNodeInteger(Node.Left, InContext, Left))
+		{
+			return false;
+		}
+		if ((Node.Op == voAnd) != (Left != 0))
+		{
+			OutValue = Left != 0;
+			return true;
+		}
+		if (!EvaluateNodeInteger(Node.Right, InContext, Right))
+		{
+			return false;
+		}
+		OutValue = Right != 0;
+		return true;
+
+	default:
+		break;
+	}
+
+	if (!EvaluateNodeInteger(Node.Left, InContext, Left)
+		|| (Node.Right != kNoNode && !EvaluateNodeInteger(Node.Right, InContext, Right)))
+	{
+		return false;
+	}
+
+	switch (Node.Op)
+	{
+	case voNeg:				OutValue = -Left; break;
+	case voNot:				OutValue = !Left; break;
+	case voBitNot:			OutValue = ~Left; break;
+	case voAdd:				OutValue = Node.Integer ? Left + Right * Node.Integer : Left + Right; break;
+	case voSub:
+		if (Node.pType)
+		{
+			OutValue = Left - Right * Node.Integer;
+		}
+		else
+		{
+			OutValue = Node.Integer ? (Left - Right) / Node.Integer : Left - Right;
+		}
+		break;
+	case voMul:				OutValue = Left * Right; break;
+	case voShiftLeft:		OutValue = (int64_t)((uint64_t)Left << (Right & 63)); break;
+	case voShiftRight:		OutValue = Left >> (Right & 63); break;
+	case voBitAnd:			OutValue = Left & Right; break;
+	case voBitXor:			OutValue = Left ^ Right; break;
+	case voBitOr:			OutValue = Left | Right; break;
+	case voDiv:
+	case voMod:
+		if (Right == 0)
+		{
+			return false;
+		}
+		OutValue = Node.Op == voDiv ? Left / Right : Left % Right;
+		break;
+	case voLess:			OutValue = Left < Right; break;
+	case voGreater:			OutValue = Left > Right; break;
+	case voLessEqual:		OutValue = Left <= Right; break;
+	case voGreaterEqual:	OutValue = Left >= Right; break;
+	case voEqual:			OutValue = Left == Right; break;
+	case voNotEqual:		OutValue = Left != Right; break;
+	default:
+		return false;
+	}
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static void AppendElementIndex(uint64_t InIndex, FFormatBuffer &OutText)
+{
+	OutText.Append(TEXT('['));
+	OutText.AppendUInt(InIndex);
+	OutText.Append(TEXT("]: "), 3);
+}
+
+static bool IsConditionTrue(const FVisExpression &InCondition, const FVisContext &InContext)
+{
+	int64_t Value = 0;
+	return !InCondition.IsValid() || (InCondition.EvaluateInteger(InContext, Value) && Value != 0);
+}
+
+// a char or wchar_t string in quotes, up to the terminating zero
+static void FormatStringValue(const FVisValue &InValue, bool bInWide, FRemotePageCache *pMemory, FFormatBuffer &OutText)
+{
+	const uint32_t CharBytes = bInWide ? sizeof(wchar_t) : 1;
+	const uint32_t MaxBytes = NSVisualizer::kMaxStringChars * CharBytes;
+	BYTE Bytes[NSVisualizer::kMaxStringChars * sizeof(wchar_t)];
+	uint32_t Length = 0;
+
+	const FSymTypeInfo *pRealType = GetRealType(InValue.pType);
+	if (pRealType && pRealType->GetKind() == stkArray && InValue.bLValue && InValue.pLocal)
+	{
+		Length = pRealType->GetLength() < MaxBytes ? pRealType->GetLength() : MaxBytes;
+		memcpy(Bytes, InValue.pLocal, Length);
+	}
+	else
+	{
+		int64_t Address = 0;
+		if (pRealType && pRealType->GetKind() == stkArray && InValue.bLValue)
+		{
+			Address = (int64_t)InValue.Address;
+		}
+		else if (!FVisExpression::ReadInteger(InValue, pMemory, Address))
+		{
+			OutText.Append(TEXT("???"));
+			return;
+		}
+
+		// a page at a time, the string may end right before an unreadable one
+		while (pMemory && Address && Length < MaxBytes)
+		{
+			const uint32_t PageRoom = FRemotePageCache::kPageSize - (uint32_t)((Address + Length) % FRemotePageCache::kPageSize);
+			const uint32_t Count = PageRoom < MaxBytes - Length ? PageRoom : MaxBytes - Length;
+			if (!pMemory->ReadMemory(Address + Length, Bytes + Length, Count))
+			{
+				break;
+			}
+			const uint32_t Begin = Length;
+			Length += Count;
+
+			bool bTerminated = false;
+			for (uint32_t k = Begin - Begin % CharBytes; k + CharBytes <= Length && !bTerminated; k += CharBytes)
+			{
+				bTerminated = bInWide ? *(const wchar_t*)(Bytes + k) == 0 : Bytes[k] == 0;
+			} // end for k
+			if (bTerminated)
+			{
+				break;
+			}
+		} // end while
+		if (Length == 0)
+		{
+			OutText.Append(TEXT("<unreadable>"));
+			return;
+		}
+	}
+
+	OutText.Append(TEXT('"'));
+	for (uint32_t k = 0; k + CharBytes <= Length; k += CharBytes)
+	{
+		const wchar_t Char = bInWide ? *(const wchar_t*)(Bytes + k) : (wchar_t)Bytes[k];
+		if (Char == 0)
+		{
+			break;
+		}
+		OutText.Append(Char);
+	} // end for k
+	OutText.Append(TEXT('"'));
+}
+
+void FVisExpression::FormatValue(const FVisContext &InContext, FSymExpandBudget &InOutBudget, FFormatBuffer &OutText) const
+{
+	FVisValue Value;
+	if (!Evaluate(InContext, Value))
+	{
+		OutText.Append(TEXT("???"));
+		return;
+	}
+
+	if (Spec == TEXT("s") || Spec == TEXT("s8") || Spec == TEXT("su"))
+	{
+		FormatStringValue(Value, Spec == TEXT("su"), InContext.pMemory, OutText);
+		return;
+	}
+
+	const FSymTypeInfo *pRealType = GetRealType(Value.pType);
+	if (!Value.bLValue || Spec == TEXT("x") || Spec == TEXT("X") || Spec == TEXT("d"))
+	{
+		int64_t Integer = 0;
+		if (!ReadInteger(Value, InContext.pMemory, Integer))
+		{
+			OutText.Append(TEXT("???"));
+		}
+		else if (Spec == TEXT("x") || Spec == TEXT("X") || (Spec.empty() && pRealType && pRealType->GetKind() == stkPointer))
+		{
+			OutText.AppendHex((uint64_t)Integer, 8);
+		}
+		else
+		{
+			OutText.AppendInt(Integer);
+		}
+		return;
+	}
+
+	const uint32_t Length = pRealType->GetLength();
+	if (Length == 0 || Length > NSVisualizer::kMaxValueBytes)
+	{
+		OutText.Append(TEXT("???"));
+		return;
+	}
+	if (Value.pLocal)
+	{
+		Value.pType->FormatValue((void*)Value.pLocal, InOutBudget, OutText);
+		return;
+	}
+
+	std::vector<BYTE> Bytes(Length);
+	if (!InContext.pMemory->ReadMemory(Value.Address, &Bytes[0], Length))
+	{
+		OutText.Append(TEXT("<unreadable>"));
+		return;
+	}
+	Value.pType->FormatValue(&Bytes[0], InOutBudget, OutText);
+}
+
+FSymVisualizer* FSymVisualizer::StaticCreate(const FXmlElement &InDescription, const FSymTypeInfo *InType)
+{
+	FSymVisualizer *pNew = new FSymVisualizer();
+	for (size_t k = 0; k < InDescription.Children.size(); k++)
+	{
+		const FXmlElement &Element = InDescription.Children[k];
+		// views are not supported, an element for a view is left out
+		if (Element.FindAttribute(L"IncludeView"))
+		{
+			continue;
+		}
+
+		const std::wstring *pOptional = Element.FindAttribute(L"Optional");
+		bool bCompiled = true;
+		if (Element.Name == L"DisplayString")
+		{
+			bCompiled = pNew->CompileDisplayString(Element, InType);
+		}
+		else if (Element.Name == L"Expand")
+		{
+			pNew->bHasExpand = true;
+			for (size_t ItemIndex = 0; ItemIndex < Element.Children.size(); ItemIndex++)
+			{
+				const FXmlElement &ItemElement = Element.Children[ItemIndex];
+				const std::wstring *pItemOptional = ItemElement.FindAttribute(L"Optional");
+				if (!ItemElement.FindAttribute(L"IncludeView") && !pNew->CompileItem(ItemElement, InType)
+					&& !(pItemOptional && *pItemOptional == L"true"))
+				{
+					bCompiled = false;
+					break;
+				}
+			} // end for ItemIndex
+		}
+
+		if (!bCompiled && !(pOptional && *pOptional == L"true"))
+		{
+			delete pNew;
+			return NULL;
+		}
+	} // end for k
+
+	return pNew;
+}
+
+bool FSymVisualizer::CompileDisplayString(const FXmlElement &InElement, const FSymTypeInfo *InType)
+{
+	FDisplayString DisplayString;
+	const std::wstring *pCondition = InElement.FindAttribute(L"Condition");
+	if (pCondition && !DisplayString.Condition.Compile(*pCondition, InType))
+	{
+		return false;
+	}
+
+	// literal text with {expression} parts, {{ and }} are braces
+	const std::wstring &Text = InElement.Text;
+	FTextPart Part;
+	for (size_t k = 0; k < Text.size(); k++)
+	{
+		if ((Text[k] == L'{' || Text[k] == L'}') && k + 1 < Text.size() && Text[k + 1] == Text[k])
+		{
+			Part.Literal.push_back(Text[k++]);
+		}
+		else if (Text[k] == L'{')
+		{
+			const size_t Close = Text.find(L'}', k + 1);
+			if (Close == std::wstring::npos || !Part.Expression.Compile(Text.substr(k + 1, Close - k - 1), InType))
+			{
+				return false;
+			}
+			DisplayString.Parts.push_back(Part);
+			Part = FTextPart();
+			k = Close;
+		}
+		else
+		{
+			Part.Literal.push_back(Text[k]);
+		}
+	} // end for k
+	if (!Part.Literal.empty())
+	{
+		DisplayString.Parts.push_back(Part);
+	}
+
+	DisplayStrings.push_back(DisplayString);
+	return true;
+}
+
+bool FSymVisualizer::CompileItem(const FXmlElement &InElement, const FSymTypeInfo *InType)
+{
+	FExpandItem Item;
+	Item.NodeLength = 0;
+	if (InElement.Name == L"Item")				{ Item.Kind = vikItem; }
+	else if (InElement.Name == L"ArrayItems")		{ Item.Kind = vikArray; }
+	else if (InElement.Name == L"LinkedListItems")	{ Item.Kind = vikList; }
+	else if (InElement.Name == L"TreeItems")		{ Item.Kind = vikTree; }
+	else
+	{
+		// not supported, shows nothing
+		return true;
+	}
+
+	const std::wstring *pCondition = InElement.FindAttribute(L"Condition");
+	if (pCondition && !Item.Condition.Compile(*pCondition, InType))
+	{
+		return false;
+	}
+
+	if (Item.Kind == vikItem)
+	{
+		const std::wstring *pName = InElement.FindAttribute(L"Name");
+		Item.Name = pName ? *pName : std::wstring();
+		if (!Item.Value.Compile(InElement.Text, InType))
+		{
+			return false;
+		}
+		Items.push_back(Item);
+		return true;
+	}
+
+	const FXmlElement *pSize = InElement.FindChild(L"Size");
+	if (pSize && !Item.Size.Compile(pSize->Text, InType))
+	{
+		return false;
+	}
+
+	if (Item.Kind == vikArray)
+	{
+		const FXmlElement *pPointer = InElement.FindChild(L"ValuePointer");
+		const SymTypeKindEnum PointerKind = pPointer && Item.Value.Compile(pPointer->Text, InType) ? GetRealKind(Item.Value.GetType()) : stkUnknown;
+		Item.NodeLength = GetElementLength(Item.Value.GetType());
+		if (!pSize || (PointerKind != stkPointer && PointerKind != stkArray) || Item.NodeLength == 0)
+		{
+			return false;
+		}
+		Items.push_back(Item);
+		return true;
+	}
+
+	// the other expressions are about a node
+	const FXmlElement *pHead = InElement.FindChild(L"HeadPointer");
+	if (!pHead || !Item.Value.Compile(pHead->Text, InType) || GetRealKind(Item.Value.GetType()) != stkPointer)
+	{
+		return false;
+	}
+	const FSymTypeInfo *pNodeType = GetRealType(Item.Value.GetType()->GetRealType()->GetElementType());
+	Item.NodeLength = pNodeType ? pNodeType->GetLength() : 0;
+
+	const FXmlElement *pNext = InElement.FindChild(Item.Kind == vikList ? L"NextPointer" : L"LeftPointer");
+	const FXmlElement *pRight = InElement.FindChild(L"RightPointer");
+	const FXmlElement *pValueNode = InElement.FindChild(L"ValueNode");
+	const std::wstring *pNodeCondition = pValueNode ? pValueNode->FindAttribute(L"Condition") : NULL;
+	if (!pNodeType || !pNext || !pValueNode
+		|| !Item.Next.Compile(pNext->Text, pNodeType)
+		|| !Item.NodeValue.Compile(pValueNode->Text, pNodeType)
+		|| (pNodeCondition && !Item.NodeCondition.Compile(*pNodeCondition, pNodeType)))
+	{
+		return false;
+	}
+	if (Item.Kind == vikTree && (!pRight || !Item.Right.Compile(pRight->Text, pNodeType)))
+	{
+		return false;
+	}
+
+	Items.push_back(Item);
+	return true;
+}
+
+void FSymVisualizer::FormatValue(void *ValuePtr, FSymExpandBudget &InOutBudget, FFormatBuffer &OutText) const
+{
+	FVisContext Context;
+	Context.pThis = (const BYTE *)ValuePtr;
+	Context.ThisAddress = 0;
+	Context.pMemory = InOutBudget.pMemory;
+	Context.pRegisters = NULL;
+
+	// the first display string whose condition holds
+	bool bDisplayed = false;
+	for (size_t k = 0; k < DisplayStrings.size() && !bDisplayed; k++)
+	{
+		const FDisplayString &DisplayString = DisplayStrings[k];
+		if (!IsConditionTrue(DisplayString.Condition, Context))
+		{
+			continue;
+		}
+		for (size_t PartIndex = 0; PartIndex < DisplayString.Parts.size(); PartIndex++)
+		{
+			const FTextPart &Part = DisplayString.Parts[PartIndex];
+			OutText.Append(Part.Literal);
+			if (Part.Expression.IsValid())
+			{
+				Part.Expression.FormatValue(Context, InOutBudget, OutText);
+			}
+		} // end for PartIndex
+		bDisplayed = true;
+	} // end for k
+	if (!bDisplayed)
+	{
+		OutText.Append(TEXT("{...}"));
+	}
+
+	if (!bHasExpand || InOutBudget.Depth >= InOutBudget.MaxDepth)
+	{
+		return;
+	}
+
+	InOutBudget.Depth++;
+	OutText.Append(TEXT('\n'));
+	for (size_t k = 0; k < Items.size(); k++)
+	{
+		const FExpandItem &Item = Items[k];
+		if (InOutBudget.ValueCount >= InOutBudget.MaxValues)
+		{
+			OutText.Append(TEXT("...\n"));
+			break;
+		}
+		if (!IsConditionTrue(Item.Condition, Context))
+		{
+			continue;
+		}
+
+		switch (Item.Kind)
+		{
+		case vikItem:	FormatItem(Item, Context, InOutBudget, OutText); break;
+		case vikArray:	FormatArrayItems(Item, Context, InOutBudget, OutText); break;
+		case vikList:	FormatListItems(Item, Context, InOutBudget, OutText); break;
+		case vikTree:	FormatTreeItems(Item, Context, InOutBudget, OutText); break;
+		}
+	} // end for k
+	InOutBudget.Depth--;
+}
+
+void FSymVisualizer::FormatItem(const FExpandItem &InItem, const FVisContext &InContext, FSymExpandBudget &InOutBudget, FFormatBuffer &OutText) const
+{
+	InOutBudget.ValueCount++;
+	OutText.Append(InItem.Name);
+	OutText.Append(TEXT(": "), 2);
+	InItem.Value.FormatValue(InContext, InOutBudget, OutText);
+	OutText.Append(TEXT('\n'));
+}
+
+// only the elements the budget has room for are read, with one read per run of pages
+void FSymVisualizer::FormatArrayItems(const FExpandItem &InItem, const FVisContext &InContext, FSymExpandBudget &InOutBudget, FFormatBuffer &OutText) const
+{
+	int64_t Size = 0;
+	FVisValue Pointer;
+	if (!InItem.Size.EvaluateInteger(InContext, Size) || Size < 0 || !InItem.Value.Evaluate(InContext, Pointer))
+	{
+		OutText.Append(TEXT("???\n"));
+		return;
+	}
+
+	const uint32_t Room = InOutBudget.ValueCount < InOutBudget.MaxValues ? InOutBudget.MaxValues - InOutBudget.ValueCount : 0;
+	const uint32_t MaxCount = NSVisualizer::kMaxArrayBytes / InItem.NodeLength;
+	uint32_t Count = Size < (int64_t)Room ? (uint32_t)Size : Room;
+	if (Count > MaxCount) { Count = MaxCount; }
+	if (Count == 0)
+	{
+		if (Size > 0)
+		{
+			OutText.Append(TEXT("...\n"));
+		}
+		return;
+	}
+
+	std::vector<BYTE> Bytes((size_t)Count * InItem.NodeLength);
+	const FSymTypeInfo *pPointerType = Pointer.pType->GetRealType();
+	if (pPointerType->GetKind() == stkArray && Pointer.bLValue && Pointer.pLocal)
+	{
+		if (Bytes.size() > pPointerType->GetLength())
+		{
+			OutText.Append(TEXT("???\n"));
+			return;
+		}
+		memcpy(&Bytes[0], Pointer.pLocal, Bytes.size());
+	}
+	else
+	{
+		int64_t Address = 0;
+		if (pPointerType->GetKind() == stkArray)
+		{
+			Address = (int64_t)Pointer.Address;
+		}
+		else if (!FVisExpression::ReadInteger(Pointer, InContext.pMemory, Address))
+		{
+			Address = 0;
+		}
+
+		std::vector<FRemotePageCache::FRange> Ranges(1);
+		Ranges[0].Address = (uint64_t)Address;
+		Ranges[0].Bytes = (uint32_t)Bytes.size();
+		InContext.pMemory->Prefetch(Ranges);
+		if (!Address || !InContext.pMemory->ReadMemory((uint64_t)Address, &Bytes[0], Bytes.size()))
+		{
+			OutText.Append(TEXT("<unreadable>\n"));
+			return;
+		}
+	}
+
+	InOutBudget.ValueCount += Count;
+	Pointer.pType->GetRealType()->GetElementType()->FormatElements(&Bytes[0], Count, InItem.NodeLength, 0, InOutBudget, OutText);
+	if (Count < Size)
+	{
+		OutText.Append(TEXT("...\n"));
+	}
+}
+
+void FSymVisualizer::FormatListItems(const FExpandItem &InItem, const FVisContext &InContext, FSymExpandBudget &InOutBudget, FFormatBuffer &OutText) const
+{
+	int64_t Size = -1;
+	int64_t Node = 0;
+	if ((InItem.Size.IsValid() && !InItem.Size.EvaluateInteger(InContext, Size)) || !InItem.Value.EvaluateInteger(InContext, Node))
+	{
+		OutText.Append(TEXT("???\n"));
+		return;
+	}
+
+	FVisContext NodeContext;
+	NodeContext.pThis = NULL;
+	NodeContext.pMemory = InContext.pMemory;
+	NodeContext.pRegisters = InContext.pRegisters;
+
+	// a broken list may loop
+	std::set<int64_t> Visited;
+	for (int64_t Index = 0; Node && (Size < 0 || Index < Size) && Visited.insert(Node).second; Index++)
+	{
+		if (InOutBudget.ValueCount >= InOutBudget.MaxValues)
+		{
+			OutText.Append(TEXT("...\n"));
+			break;
+		}
+		InOutBudget.ValueCount++;
+
+		NodeContext.ThisAddress = (uint64_t)Node;
+		AppendElementIndex((uint64_t)Index, OutText);
+		InItem.NodeValue.FormatValue(NodeContext, InOutBudget, OutText);
+		OutText.Append(TEXT('\n'));
+
+		if (!InItem.Next.EvaluateInteger(NodeContext, Node))
+		{
+			break;
+		}
+	} // end for Index
+}
+
+// the nodes are read ahead level by level, one batch of reads per level, then walked in order
+void FSymVisualizer::FormatTreeItems(const FExpandItem &InItem, const FVisContext &InContext, FSymExpandBudget &InOutBudget, FFormatBuffer &OutText) const
+{
+	int64_t Size = -1;
+	int64_t Root = 0;
+	if ((InItem.Size.IsValid() && !InItem.Size.EvaluateInteger(InContext, Size)) || !InItem.Value.EvaluateInteger(InContext, Root))
+	{
+		OutText.Append(TEXT("???\n"));
+		return;
+	}
+
+	FVisContext NodeContext;
+	NodeContext.pThis = NULL;
+	NodeContext.pMemory = InContext.pMemory;
+	NodeContext.pRegisters = InContext.pRegisters;
+
+	// a sentinel fails the ValueNode condition
+	struct FLocal
+	{
+		static bool IsValueNode(const FExpandItem &InItem, FVisContext &InOutContext, int64_t InNode)
+		{
+			InOutContext.ThisAddress = (uint64_t)InNode;
+			return InNode != 0 && IsConditionTrue(InItem.NodeCondition, InOutContext);
+		}
+
+		static int64_t GetChild(const FVisExpression &InPointer, FVisContext &InOutContext, int64_t InNode)
+		{
+			int64_t Child = 0;
+			InOutContext.ThisAddress = (uint64_t)InNode;
+			return InPointer.EvaluateInteger(InOutContext, Child) ? Child : 0;
+		}
+	};
+
+	std::set<int64_t> Visited;
+	std::vector<int64_t> Level(1, Root), NextLevel;
+	std::vector<FRemotePageCache::FRange> Ranges;
+	// a tree the budget shows whole is read ahead. the first values of a larger one are a walk down
+	// its left side, most nodes of the top levels would not be shown.
+	const uint32_t Room = InOutBudget.ValueCount < InOutBudget.MaxValues ? InOutBudget.MaxValues - InOutBudget.ValueCount : 0;
+	const uint64_t MaxPrefetch = Size >= 0 && Size <= Room && Size < NSVisualizer::kMaxPrefetchNodes ? Size + 1 : 0;
+	for (uint64_t Fetched = 0; !Level.empty() && Fetched < MaxPrefetch; Fetched += Level.size())
+	{
+		Ranges.resize(Level.size());
+		for (size_t k = 0; k < Level.size(); k++)
+		{
+			Ranges[k].Address = (uint64_t)Level[k];
+			Ranges[k].Bytes = InItem.NodeLength;
+		} // end for k
+		InContext.pMemory->Prefetch(Ranges);
+
+		NextLevel.clear();
+		for (size_t k = 0; k < Level.size(); k++)
+		{
+			if (!Visited.insert(Level[k]).second || !FLocal::IsValueNode(InItem, NodeContext, Level[k]))
+			{
+				continue;
+			}
+			const int64_t Left = FLocal::GetChild(InItem.Next, NodeContext, Level[k]);
+			const int64_t Right = FLocal::GetChild(InItem.Right, NodeContext, Level[k]);
+			if (Left) { NextLevel.push_back(Left); }
+			if (Right) { NextLevel.push_back(Right); }
+		} // end for k
+		Level.swap(NextLevel);
+	} // end for Fetched
+
+	// in order, a node met twice means the links are broken
+	Visited.clear();
+	std::vector<int64_t> Stack;
+	int64_t Node = Root;
+	for (int64_t Index = 0; Size < 0 || Index < Size; Index++)
+	{
+		while (FLocal::IsValueNode(InItem, NodeContext, Node) && Visited.insert(Node).second)
+		{
+			Stack.push_back(Node);
+			Node = FLocal::GetChild(InItem.Next, NodeContext, Node);
+		} // end while
+		if (Stack.empty())
+		{
+			break;
+		}
+		if (InOutBudget.ValueCount >= InOutBudget.MaxValues)
+		{
+			OutText.Append(TEXT("...\n"));
+			break;
+		}
+		InOutBudget.ValueCount++;
+
+		Node = Stack.back();
+		Stack.pop_back();
+		NodeContext.ThisAddress = (uint64_t)Node;
+		AppendElementIndex((uint64_t)Index, OutText);
+		InItem.NodeValue.FormatValue(NodeContext, InOutBudget, OutText);
+		OutText.Append(TEXT('\n'));
+
+		Node = FLocal::GetChild(InItem.Right, NodeContext, Node);
+	} // end for Index
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+const FVisExpression& FVisExpressionCache::Find(const std::wstring &InText, uint64_t InScopeKey, uint64_t InModuleBase, const FVisScope &InScope)
+{
+	const std::pair<uint64_t, std::wstring> Key(InScopeKey, InText);
+	std::map<std::pair<uint64_t, std::wstring>, FEntry>::iterator FindItr = Entries.find(Key);
+	if (FindItr != Entries.end())
+	{
+		HitCount++;
+		return FindItr->second.Expression;
+	}
+
+	CompileCount++;
+	FEntry &Entry = Entries[Key];
+	Entry.ModuleBase = InModuleBase;
+	Entry.Expression.Compile(InText, NULL, &InScope);
+	return Entry.Expression;
+}
+
+void FVisExpressionCache::UnloadModule(uint64_t InModuleBase)
+{
+	for (std::map<std::pair<uint64_t, std::wstring>, FEntry>::iterator Itr = Entries.begin(); Itr != Entries.end();)
+	{
+		if (Itr->second.ModuleBase == InModuleBase)
+		{
+			Entries.erase(Itr++);
+		}
+		else
+		{
+			++Itr;
+		}
+	} // end for
+}
+
+void FVisExpressionCache::Clear()
+{
+	Entries.clear();
+	HitCount = 0;
+	CompileCount = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static std::wstring RemoveSpaces(const std::wstring &InText)
+{
+	std::wstring Result;
+	Result.reserve(InText.size());
+	for (size_t k = 0; k < InText.size(); k++)
+	{
+		if (!iswspace(InText[k]))
+		{
+			Result.push_back(InText[k]);
+		}
+	} // end for k
+	return Result;
+}
+
+// '*' matches any run of characters
+static bool MatchPattern(const std::wstring &InPattern, const std::wstring &InName)
+{
+	size_t PatternIndex = 0, NameIndex = 0;
+	size_t StarIndex = std::wstring::npos, StarNameIndex = 0;
+	while (NameIndex < InName.size())
+	{
+		if (PatternIndex < InPattern.size() && InPattern[PatternIndex] == L'*')
+		{
+			StarIndex = PatternIndex++;
+			StarNameIndex = NameIndex;
+		}
+		else if (PatternIndex < InPattern.size() && InPattern[PatternIndex] == InName[NameIndex])
+		{
+			PatternIndex++;
+			NameIndex++;
+		}
+		else if (StarIndex != std::wstring::npos)
+		{
+			PatternIndex = StarIndex + 1;
+			NameIndex = ++StarNameIndex;
+		}
+		else
+		{
+			return false;
+		}
+	} // end while
+	while (PatternIndex < InPattern.size() && InPattern[PatternIndex] == L'*')
+	{
+		PatternIndex++;
+	}
+	return PatternIndex == InPattern.size();
+}
+
+FVisualizerSet& FVisualizerSet::Get()
+{
+	static FVisualizerSet sVisualizers;
+	static bool sbLoaded = false;
+	if (sbLoaded)
+	{
+		return sVisualizers;
+	}
+	sbLoaded = true;
+
+	sVisualizers.LoadText(kBuiltinNatvis);
+
+	// files for in-house containers, separated by ';'
+	TCHAR szFiles[4096];
+	const DWORD dwLength = GetEnvironmentVariable(TEXT("WINDEBUGGER_NATVIS"), szFiles, XARRAY_COUNT(szFiles));
+	if (dwLength && dwLength < XARRAY_COUNT(szFiles))
+	{
+		const std::wstring Files(szFiles);
+		size_t Begin = 0;
+		while (Begin < Files.size())
+		{
+			size_t End = Files.find(L';', Begin);
+			End = End == std::wstring::npos ? Files.size() : End;
+			const std::wstring Filename = Files.substr(Begin, End - Begin);
+			if (!Filename.empty() && !sVisualizers.LoadFile(Filename))
+			{
+				appConsolePrintf(TEXT("can not load natvis file %s\n"), Filename.c_str());
+			}
+			Begin = End + 1;
+		} // end while
+	}
+	return sVisualizers;
+}
+
+bool FVisualizerSet::LoadText(const std::wstring &InText)
+{
+	FXmlElement Root;
+	FXmlReader Reader(InText.c_str(), InText.size());
+	if (!Reader.ReadDocument(Root) || Root.Name != L"AutoVisualizer")
+	{
+		return false;
+	}
+
+	for (size_t k = 0; k < Root.Children.size(); k++)
+	{
+		const FXmlElement &Element = Root.Children[k];
+		const std::wstring *pName = Element.FindAttribute(L"Name");
+		if (Element.Name != L"Type" || !pName)
+		{
+			continue;
+		}
+
+		const size_t Description = Descriptions.size();
+		Descriptions.push_back(Element);
+		AddPattern(*pName, Description);
+		for (size_t AltIndex = 0; AltIndex < Element.Children.size(); AltIndex++)
+		{
+			const std::wstring *pAltName = Element.Children[AltIndex].FindAttribute(L"Name");
+			if (Element.Children[AltIndex].Name == L"AlternativeType" && pAltName)
+			{
+				AddPattern(*pAltName, Description);
+			}
+		} // end for AltIndex
+	} // end for k
+	return true;
+}
+
+bool FVisualizerSet::LoadFile(const std::wstring &InFilename)
+{
+	FILE *fp = _wfopen(InFilename.c_str(), L"rb");
+	if (!fp)
+	{
+		return false;
+	}
+
+	std::vector<char> Bytes;
+	char Buffer[4096];
+	size_t Count;
+	while ((Count = fread(Buffer, 1, sizeof(Buffer), fp)) > 0)
+	{
+		Bytes.insert(Bytes.end(), Buffer, Buffer + Count);
+	} // end while
+	fclose(fp);
+	if (Bytes.empty())
+	{
+		return false;
+	}
+
+	const int32_t Chars = MultiByteToWideChar(CP_UTF8, 0, &Bytes[0], (int)Bytes.size(), NULL, 0);
+	if (Chars <= 0)
+	{
+		return false;
+	}
+	std::wstring Text(Chars, L'\0');
+	MultiByteToWideChar(CP_UTF8, 0, &Bytes[0], (int)Bytes.size(), &Text[0], Chars);
+	return LoadText(Text);
+}
+
+void FVisualizerSet::Clear()
+{
+	Descriptions.clear();
+	PatternsByPrefix.clear();
+	WildcardPatterns.clear();
+}
+
+void FVisualizerSet::AddPattern(const std::wstring &InName, size_t InDescription)
+{
+	FPattern Pattern;
+	Pattern.Name = RemoveSpaces(InName);
+	Pattern.Description = InDescription;
+
+	const std::wstring Prefix = Pattern.Name.substr(0, Pattern.Name.find(L'<'));
+	if (Prefix.find(L'*') != std::wstring::npos)
+	{
+		WildcardPatterns.push_back(Pattern);
+	}
+	else
+	{
+		PatternsByPrefix[Prefix].push_back(Pattern);
+	}
+}
+
+FSymVisualizer* FVisualizerSet::CreateVisualizer(const FSymTypeInfo *InType) const
+{
+	const std::wstring Name = RemoveSpaces(InType->TypeName());
+	std::vector<const FPattern*> Candidates;
+	std::map<std::wstring, std::vector<FPattern> >::const_iterator Itr = PatternsByPrefix.find(Name.substr(0, Name.find(L'<')));
+	if (Itr != PatternsByPrefix.end())
+	{
+		for (size_t k = 0; k < Itr->second.size(); k++)
+		{
+			Candidates.push_back(&Itr->second[k]);
+		} // end for k
+	}
+	for (size_t k = 0; k < WildcardPatterns.size(); k++)
+	{
+		Candidates.push_back(&WildcardPatterns[k]);
+	} // end for k
+
+	// the last loaded first, a description whose expressions do not fit the type gives way to the one before
+	struct FLaterFirst
+	{
+		bool operator()(const FPattern *A, const FPattern *B) const { return A->Description > B->Description; }
+	};
+	std::stable_sort(Candidates.begin(), Candidates.end(), FLaterFirst());
+
+	for (size_t k = 0; k < Candidates.size(); k++)
+	{
+		if (!MatchPattern(Candidates[k]->Name, Name))
+		{
+			continue;
+		}
+		FSymVisualizer *pVisualizer = FSymVisualizer::StaticCreate(Descriptions[Candidates[k]->Description], InType);
+		if (pVisualizer)
+		{
+			return pVisualizer;
+		}
+	} // end for k
+	return NULL;
+}
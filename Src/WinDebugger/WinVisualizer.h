@@ -0,0 +1,307 @@
+// \brief
+//		declarative visualizers for container types, read from natvis files. the supported subset is
+//		what says where the elements are: Type (with AlternativeType), DisplayString, Expand with Item,
+//		ArrayItems, LinkedListItems and TreeItems, Condition and Optional. descriptions are matched
+//		against a type name once per type, their expressions are compiled then, member names resolved
+//		to offsets, and only evaluated for each value.
+//		the same expressions serve the eval command, names are then bound to the variables and
+//		registers of a scope, and the compiled expression is kept for the next stop in that scope.
+//
+// ref: https://learn.microsoft.com/en-us/visualstudio/debugger/create-custom-views-of-native-objects
+//
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+
+#include "WinVariableTypeHelper.h"
+
+
+class FRemotePageCache;
+
+// element of a natvis file
+struct FXmlElement
+{
+	std::wstring										Name;
+	std::vector<std::pair<std::wstring, std::wstring> >	Attributes;
+	std::wstring										Text;		// character data, entities decoded
+	std::vector<FXmlElement>							Children;
+
+	// NULL if missing
+	const std::wstring* FindAttribute(const wchar_t *InName) const;
+	const FXmlElement* FindChild(const wchar_t *InName) const;
+};
+
+// registers an expression reads, $eax to $eflags. on x64 they are the full registers, $rax to $r15.
+// vrFrame is the base x86 locals are relative to.
+enum VisRegisterEnum {
+	vrEax,
+	vrEbx,
+	vrEcx,
+	vrEdx,
+	vrEsi,
+	vrEdi,
+	vrEbp,
+	vrEsp,
+	vrEip,
+	vrEflags,
+	vrR8,
+	vrR9,
+	vrR10,
+	vrR11,
+	vrR12,
+	vrR13,
+	vrR14,
+	vrR15,
+	vrFrame,
+	vrCount
+};
+
+// where a name of a scope is
+enum VisBindingEnum {
+	vbAddress,				// in memory at Offset
+	vbRegisterRelative,		// in memory at Register + Offset
+	vbRegister,				// the value of Register
+	vbConstant				// Offset is the value
+};
+
+struct FVisBinding
+{
+	VisBindingEnum		Kind;
+	const FSymTypeInfo	*pType;
+	VisRegisterEnum		Register;
+	int64_t				Offset;
+};
+
+// the variables and types an expression may name besides the members of this. names are bound
+// once, when the expression is compiled.
+class FVisScope
+{
+public:
+	virtual ~FVisScope() {}
+
+	virtual bool FindName(const std::wstring &InName, FVisBinding &OutBinding) const = 0;
+	// the type of a cast, NULL if there is none of that name
+	virtual const FSymTypeInfo* FindType(const std::wstring &InName) const = 0;
+};
+
+// a value an expression evaluates to
+struct FVisValue
+{
+	const FSymTypeInfo	*pType;		// NULL for plain integers
+	bool				bLValue;	// the value is in memory, else it is Integer
+	const BYTE			*pLocal;	// the bytes when the value is part of the one being formatted
+	uint64_t			Address;	// the debuggee address otherwise
+	int64_t				Integer;
+};
+
+// what names in an expression refer to
+struct FVisContext
+{
+	const BYTE			*pThis;			// local bytes of this, NULL if it is in the debuggee
+	uint64_t			ThisAddress;
+	FRemotePageCache	*pMemory;
+	const uint64_t		*pRegisters;	// vrCount values, NULL where there are none
+};
+
+// an expression compiled against the type of this. "expr,spec" keeps the format spec apart.
+class FVisExpression
+{
+public:
+	FVisExpression() : Root(kNoNode) {}
+
+	// false if the text does not parse or a name is neither a member of the type nor in the scope
+	bool Compile(const std::wstring &InText, const FSymTypeInfo *InThisType, const FVisScope *InScope = NULL);
+	bool IsValid() const { return Root != kNoNode; }
+
+	bool Evaluate(const FVisContext &InContext, FVisValue &OutValue) const;
+	// pointers give their address
+	bool EvaluateInteger(const FVisContext &InContext, int64_t &OutValue) const;
+	// append the value as the format spec says, or as its type formats it
+	void FormatValue(const FVisContext &InContext, FSymExpandBudget &InOutBudget, FFormatBuffer &OutText) const;
+
+	// static type of the result, NULL for integers
+	const FSymTypeInfo* GetType() const { return IsValid() ? Nodes[Root].pType : NULL; }
+	const std::wstring& GetSpec() const { return Spec; }
+
+	// scalar value as an integer
+	static bool ReadInteger(const FVisValue &InValue, FRemotePageCache *pMemory, int64_t &OutValue);
+
+private:
+	friend struct FVisParser;
+
+	enum VisOpEnum {
+		voConst,
+		voThis,
+		voAddress,		// Integer is the address
+		voRegister,		// Right is the register
+		voRegisterRelative,	// Right is the register, Integer the offset
+		voMember,		// Integer is the offset
+		voDeref,
+		voIndex,
+		voAddressOf,
+		voCast,			// to the scalar type of the node
+		voNeg,
+		voNot,
+		voBitNot,
+		voAdd,			// Integer is the element length for pointer arithmetic, 0 for integers
+		voSub,
+		voMul,
+		voDiv,
+		voMod,
+		voShiftLeft,
+		voShiftRight,
+		voLess,
+		voGreater,
+		voLessEqual,
+		voGreaterEqual,
+		voEqual,
+		voNotEqual,
+		voBitAnd,
+		voBitXor,
+		voBitOr,
+		voAnd,
+		voOr
+	};
+
+	static const uint32_t kNoNode = 0xFFFFFFFF;
+
+	struct FNode
+	{
+		VisOpEnum			Op;
+		const FSymTypeInfo	*pType;
+		int64_t				Integer;
+		uint32_t			Left;
+		uint32_t			Right;
+	};
+
+	bool EvaluateNode(uint32_t InNode, const FVisContext &InContext, FVisValue &OutValue) const;
+	bool EvaluateNodeInteger(uint32_t InNode, const FVisContext &InContext, int64_t &OutValue) const;
+
+	std::vector<FNode>	Nodes;		// operands come before their operator
+	uint32_t			Root;
+	std::wstring		Spec;
+};
+
+// a natvis description compiled against one type
+class FSymVisualizer
+{
+public:
+	// NULL if the description does not apply to the type, an expression failed to compile
+	static FSymVisualizer* StaticCreate(const FXmlElement &InDescription, const FSymTypeInfo *InType);
+
+	// the display string, then the expansion as lines if the budget allows
+	void FormatValue(void *ValuePtr, FSymExpandBudget &InOutBudget, FFormatBuffer &OutText) const;
+
+protected:
+	FSymVisualizer() : bHasExpand(false) {}
+
+	enum VisItemEnum {
+		vikItem,
+		vikArray,
+		vikList,
+		vikTree
+	};
+
+	struct FTextPart
+	{
+		std::wstring	Literal;
+		FVisExpression	Expression;		// formatted after the literal if valid
+	};
+
+	struct FDisplayString
+	{
+		FVisExpression			Condition;
+		std::vector<FTextPart>	Parts;
+	};
+
+	struct FExpandItem
+	{
+		VisItemEnum				Kind;
+		std::wstring			Name;			// Item
+		FVisExpression			Condition;
+		FVisExpression			Size;			// ArrayItems, LinkedListItems, TreeItems
+		FVisExpression			Value;			// Item value, ValuePointer or HeadPointer
+		FVisExpression			Next;			// NextPointer or LeftPointer, against a node
+		FVisExpression			Right;			// RightPointer
+		FVisExpression			NodeValue;		// ValueNode
+		FVisExpression			NodeCondition;	// ValueNode Condition, a node failing it is a sentinel
+		uint32_t				NodeLength;
+	};
+
+	bool CompileDisplayString(const FXmlElement &InElement, const FSymTypeInfo *InType);
+	bool CompileItem(const FXmlElement &InElement, const FSymTypeInfo *InType);
+
+	void FormatItem(const FExpandItem &InItem, const FVisContext &InContext, FSymExpandBudget &InOutBudget, FFormatBuffer &OutText) const;
+	void FormatArrayItems(const FExpandItem &InItem, const FVisContext &InContext, FSymExpandBudget &InOutBudget, FFormatBuffer &OutText) const;
+	void FormatListItems(const FExpandItem &InItem, const FVisContext &InContext, FSymExpandBudget &InOutBudget, FFormatBuffer &OutText) const;
+	void FormatTreeItems(const FExpandItem &InItem, const FVisContext &InContext, FSymExpandBudget &InOutBudget, FFormatBuffer &OutText) const;
+
+	std::vector<FDisplayString>	DisplayStrings;
+	std::vector<FExpandItem>	Items;
+	bool						bHasExpand;
+};
+
+// compiled expressions by text and scope. an expression met again in the same scope costs only
+// the reads of its evaluation.
+class FVisExpressionCache
+{
+public:
+	FVisExpressionCache() : HitCount(0), CompileCount(0) {}
+
+	// the expression compiled against InScope the first time InText is met with InScopeKey. a text
+	// that does not compile is kept as an expression that is not valid.
+	const FVisExpression& Find(const std::wstring &InText, uint64_t InScopeKey, uint64_t InModuleBase, const FVisScope &InScope);
+	// forget the expressions compiled against the types of a module
+	void UnloadModule(uint64_t InModuleBase);
+	void Clear();
+
+	uint64_t	HitCount;
+	uint64_t	CompileCount;
+
+private:
+	struct FEntry
+	{
+		FVisExpression	Expression;
+		uint64_t		ModuleBase;
+	};
+
+	std::map<std::pair<uint64_t, std::wstring>, FEntry>	Entries;
+};
+
+// all loaded descriptions. a later description of the same type takes precedence, the built-in ones
+// for the standard library are loaded first, then the files listed in %WINDEBUGGER_NATVIS%.
+class FVisualizerSet
+{
+public:
+	static FVisualizerSet& Get();
+
+	// add the Type elements of a natvis text. false if it is not well formed.
+	bool LoadText(const std::wstring &InText);
+	// utf-8 natvis file
+	bool LoadFile(const std::wstring &InFilename);
+	void Clear();
+
+	// the visualizer of the last matching description that compiles, NULL if none
+	FSymVisualizer* CreateVisualizer(const FSymTypeInfo *InType) const;
+
+private:
+	FVisualizerSet() {}
+	FVisualizerSet(const FVisualizerSet&);
+	FVisualizerSet& operator=(const FVisualizerSet&);
+
+	struct FPattern
+	{
+		std::wstring	Name;			// without white space, '*' matches anything
+		size_t			Description;
+	};
+
+	void AddPattern(const std::wstring &InName, size_t InDescription);
+
+	std::vector<FXmlElement>						Descriptions;		// Type elements, in load order
+	std::map<std::wstring, std::vector<FPattern> >	PatternsByPrefix;	// by the name before '<'
+	std::vector<FPattern>							WildcardPatterns;	// '*' before '<'
+};
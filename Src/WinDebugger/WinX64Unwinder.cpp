@@ -0,0 +1,719 @@
+// \brief
+//		x64 stack unwinder.
+//
+
+#include "WinX64Unwinder.h"
+#include "WinRemoteMemory.h"
+
+#include <cstring>
+#include <algorithm>
+
+
+namespace NSX64Unwinder
+{
+	// unwind operations
+	const uint8_t UWOP_PUSH_NONVOL       = 0;
+	const uint8_t UWOP_ALLOC_LARGE       = 1;
+	const uint8_t UWOP_ALLOC_SMALL       = 2;
+	const uint8_t UWOP_SET_FPREG         = 3;
+	const uint8_t UWOP_SAVE_NONVOL       = 4;
+	const uint8_t UWOP_SAVE_NONVOL_FAR   = 5;
+	const uint8_t UWOP_EPILOG            = 6;
+	const uint8_t UWOP_SPARE_CODE        = 7;
+	const uint8_t UWOP_SAVE_XMM128       = 8;
+	const uint8_t UWOP_SAVE_XMM128_FAR   = 9;
+	const uint8_t UWOP_PUSH_MACHFRAME    = 10;
+
+	// header, 255 codes padded to an even count, and a chained RUNTIME_FUNCTION
+	const uint32_t kMaxUnwindInfoBytes = 4 + 256 * 2 + 12;
+	// chained records followed for one frame, more is a cycle in corrupt data
+	const uint32_t kMaxChainDepth = 32;
+	// code read at once while looking at an epilog, an add or lea, eight pops and a ret fit
+	const uint32_t kCodeWindow = 32;
+	// instructions and jumps of one epilog
+	const uint32_t kMaxEpilogSteps = 32;
+	// the pc is not in the prolog
+	const uint32_t kNoPrologOffset = 0xFFFFFFFF;
+}
+
+static inline uint16_t ReadU16(const uint8_t *InPtr)
+{
+	uint16_t Value;
+	memcpy(&Value, InPtr, sizeof(Value));
+	return Value;
+}
+
+static inline uint32_t ReadU32(const uint8_t *InPtr)
+{
+	uint32_t Value;
+	memcpy(&Value, InPtr, sizeof(Value));
+	return Value;
+}
+
+static bool RuntimeFunctionLess(const FPeRuntimeFunction &A, const FPeRuntimeFunction &B)
+{
+	return A.BeginRva < B.BeginRva;
+}
+
+static bool RuntimeFunctionRvaLess(uint32_t InRva, const FPeRuntimeFunction &InFunction)
+{
+	return InRva < InFunction.BeginRva;
+}
+
+// slots an unwind code takes, the code included
+static uint32_t GetCodeSlots(uint8_t InOp, uint8_t InOpInfo)
+{
+	using namespace NSX64Unwinder;
+
+	switch (InOp)
+	{
+	case UWOP_ALLOC_LARGE:
+		return InOpInfo ? 3 : 2;
+	case UWOP_SAVE_NONVOL:
+	case UWOP_SAVE_XMM128:
+	case UWOP_EPILOG:
+		return 2;
+	case UWOP_SAVE_NONVOL_FAR:
+	case UWOP_SAVE_XMM128_FAR:
+	case UWOP_SPARE_CODE:
+		return 3;
+	default:
+		return 1;
+	}
+}
+
+// an UNWIND_INFO of the debuggee, Codes point into OutBuffer
+static bool ReadUnwindInfo(FRemoteMemory &InMemory, uint64_t InAddress, uint8_t *OutBuffer, FPeUnwindInfo &OutInfo)
+{
+	using namespace NSPeImage;
+
+	if (!InMemory.ReadMemory(InAddress, OutBuffer, 4))
+	{
+		return false;
+	}
+
+	memset(&OutInfo, 0, sizeof(OutInfo));
+	OutInfo.Version = OutBuffer[0] & 0x7;
+	OutInfo.Flags = OutBuffer[0] >> 3;
+	OutInfo.PrologSize = OutBuffer[1];
+	OutInfo.CodeCount = OutBuffer[2];
+	OutInfo.FrameRegister = OutBuffer[3] & 0xF;
+	OutInfo.FrameOffset = OutBuffer[3] >> 4;
+	OutInfo.Codes = OutBuffer + 4;
+
+	// codes are padded to an even count, the chained function follows them
+	const uint32_t CodeBytes = ((OutInfo.CodeCount + 1) & ~1u) * 2;
+	const uint32_t TailBytes = (OutInfo.Flags & UNW_FLAG_CHAININFO) ? 12 : 0;
+	if (CodeBytes + TailBytes && !InMemory.ReadMemory(InAddress + 4, OutBuffer + 4, CodeBytes + TailBytes))
+	{
+		return false;
+	}
+
+	if (TailBytes)
+	{
+		const uint8_t *Chained = OutBuffer + 4 + CodeBytes;
+		OutInfo.Chained.BeginRva = ReadU32(Chained);
+		OutInfo.Chained.EndRva = ReadU32(Chained + 4);
+		OutInfo.Chained.UnwindInfoRva = ReadU32(Chained + 8);
+	}
+	return true;
+}
+
+// code of the debuggee, a window at a time
+class FCodeReader
+{
+public:
+	explicit FCodeReader(FRemoteMemory &InMemory) : Memory(InMemory), Address(0), Count(0) {}
+
+	// InBytes bytes at InAddress, NULL if they are not readable
+	const uint8_t* Get(uint64_t InAddress, uint32_t InBytes)
+	{
+		if (InAddress < Address || InAddress + InBytes > Address + Count)
+		{
+			Fill(InAddress);
+		}
+		return InAddress + InBytes <= Address + Count ? &Bytes[InAddress - Address] : NULL;
+	}
+
+private:
+	// a whole window, or what the page holds when the next one is not readable
+	void Fill(uint64_t InAddress)
+	{
+		Address = InAddress;
+		Count = NSX64Unwinder::kCodeWindow;
+		if (Memory.ReadMemory(InAddress, Bytes, Count))
+		{
+			return;
+		}
+
+		const uint32_t ToPageEnd = FRemotePageCache::kPageSize - (uint32_t)(InAddress & (FRemotePageCache::kPageSize - 1));
+		Count = (ToPageEnd < Count && Memory.ReadMemory(InAddress, Bytes, ToPageEnd)) ? ToPageEnd : 0;
+	}
+
+	FRemoteMemory	&Memory;
+	uint64_t		Address;	// of Bytes[0]
+	uint32_t		Count;		// bytes read
+	uint8_t			Bytes[NSX64Unwinder::kCodeWindow];
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+void FX64Unwinder::AddModule(uint64_t InImageBase, uint32_t InImageSize, const FPeImage &InImage)
+{
+	RemoveModule(InImageBase);
+
+	FModule Module;
+	Module.ImageBase = InImageBase;
+	Module.ImageSize = InImageSize;
+	if (InImage.Is64Bit())
+	{
+		const uint32_t Count = InImage.GetRuntimeFunctionCount();
+		Module.Functions.reserve(Count);
+		for (uint32_t k = 0; k < Count; k++)
+		{
+			FPeRuntimeFunction Function;
+			if (InImage.GetRuntimeFunction(k, Function) && Function.BeginRva < Function.EndRva)
+			{
+				Module.Functions.push_back(Function);
+			}
+		} // end for k
+		// the linker sorts .pdata, a table that is not sorted would only be searched wrong
+		if (!std::is_sorted(Module.Functions.begin(), Module.Functions.end(), &RuntimeFunctionLess))
+		{
+			std::sort(Module.Functions.begin(), Module.Functions.end(), &RuntimeFunctionLess);
+		}
+	}
+
+	std::vector<FModule>::iterator Itr = Modules.begin();
+	while (Itr != Modules.end() && Itr->ImageBase < InImageBase)
+	{
+		++Itr;
+	} // end while
+	Modules.insert(Itr, Module);
+}
+
+void FX64Unwinder::RemoveModule(uint64_t InImageBase)
+{
+	for (size_t k = 0; k < Modules.size(); k++)
+	{
+		if (Modules[k].ImageBase == InImageBase)
+		{
+			Modules.erase(Modules.begin() + k);
+			return;
+		}
+	} // end for k
+}
+
+void FX64Unwinder::Clear()
+{
+	Modules.clear();
+}
+
+bool FX64Unwinder::FindFunction(uint64_t InAddress, uint64_t &OutImageBase, FPeRuntimeFunction &OutFunction) const
+{
+	// the last module starting at or below the address
+	size_t Low = 0, High = Modules.size();
+	while (Low < High)
+	{
+		const size_t Middle = (Low + High) / 2;
+		if (Modules[Middle].ImageBase <= InAddress)
+		{
+			Low = Middle + 1;
+		}
+		else
+		{
+			High = Middle;
+		}
+	} // end while
+	if (Low == 0 || InAddress - Modules[Low - 1].ImageBase >= Modules[Low - 1].ImageSize)
+	{
+		return false;
+	}
+
+	const FModule &Module = Modules[Low - 1];
+	const uint32_t Rva = (uint32_t)(InAddress - Module.ImageBase);
+	std::vector<FPeRuntimeFunction>::const_iterator Itr = std::upper_bound(Module.Functions.begin(), Module.Functions.end(), Rva, &RuntimeFunctionRvaLess);
+	if (Itr == Module.Functions.begin() || Rva >= (Itr - 1)->EndRva)
+	{
+		return false;
+	}
+
+	OutImageBase = Module.ImageBase;
+	OutFunction = *(Itr - 1);
+	return true;
+}
+
+// the function a fragment was split from: an odd unwind info address refers to its entry, chained
+// unwind info names it. InOutFunction is left as is if it is not a fragment.
+static bool FindPrimaryFunction(FRemoteMemory &InMemory, uint64_t InImageBase, FPeRuntimeFunction &InOutFunction)
+{
+	using namespace NSX64Unwinder;
+
+	uint8_t Buffer[kMaxUnwindInfoBytes];
+	FPeUnwindInfo Info;
+	for (uint32_t Chain = 0; Chain < kMaxChainDepth; Chain++)
+	{
+		if (InOutFunction.UnwindInfoRva & 1)
+		{
+			uint8_t Entry[12];
+			if (!InMemory.ReadMemory(InImageBase + (InOutFunction.UnwindInfoRva & ~1u), Entry, sizeof(Entry)))
+			{
+				return false;
+			}
+			InOutFunction.BeginRva = ReadU32(Entry);
+			InOutFunction.EndRva = ReadU32(Entry + 4);
+			InOutFunction.UnwindInfoRva = ReadU32(Entry + 8);
+			continue;
+		}
+
+		if (!ReadUnwindInfo(InMemory, InImageBase + InOutFunction.UnwindInfoRva, Buffer, Info))
+		{
+			return false;
+		}
+		if (!(Info.Flags & NSPeImage::UNW_FLAG_CHAININFO))
+		{
+			return true;
+		}
+		InOutFunction = Info.Chained;
+	} // end for Chain
+
+	return false;
+}
+
+bool FX64Unwinder::IsSameFunction(FRemoteMemory &InMemory, uint64_t InImageBase, const FPeRuntimeFunction &InFunction, uint64_t InAddress) const
+{
+	const uint64_t Rva = InAddress - InImageBase;
+	if (Rva >= InFunction.BeginRva && Rva < InFunction.EndRva)
+	{
+		return true;
+	}
+
+	// hot and cold parts of a function jump to each other
+	uint64_t ImageBase = 0;
+	FPeRuntimeFunction Target, Primary = InFunction;
+	if (!FindFunction(InAddress, ImageBase, Target) || ImageBase != InImageBase
+		|| !FindPrimaryFunction(InMemory, ImageBase, Target) || !FindPrimaryFunction(InMemory, ImageBase, Primary))
+	{
+		return false;
+	}
+	return Target.BeginRva == Primary.BeginRva;
+}
+
+// an epilog is an optional add or lea to rsp, pops, then a ret or a tail call: a jump to another function,
+// directly or through the import table. jumps within the function lead to a shared epilog.
+bool FX64Unwinder::IsInsideEpilog(FRemoteMemory &InMemory, uint64_t InImageBase, const FPeRuntimeFunction &InFunction, uint64_t InAddress) const
+{
+	FCodeReader Code(InMemory);
+	uint64_t Pc = InAddress;
+
+	// the add or lea has a rex.w prefix
+	const uint8_t *pInsn = Code.Get(Pc, 3);
+	if (pInsn && (pInsn[0] & 0xF8) == 0x48)
+	{
+		switch (pInsn[1])
+		{
+		case 0x81:		// add rsp, imm32
+			if (pInsn[0] != 0x48 || pInsn[2] != 0xC4)
+			{
+				return false;
+			}
+			Pc += 7;
+			break;
+
+		case 0x83:		// add rsp, imm8
+			if (pInsn[0] != 0x48 || pInsn[2] != 0xC4)
+			{
+				return false;
+			}
+			Pc += 4;
+			break;
+
+		case 0x8D:		// lea rsp, [reg + disp], without rex.r, rex.x or a sib byte
+			if ((pInsn[0] & 0x06) || ((pInsn[2] >> 3) & 7) != 4 || (pInsn[2] & 7) == 4)
+			{
+				return false;
+			}
+			if ((pInsn[2] >> 6) == 1)
+			{
+				Pc += 4;
+			}
+			else if ((pInsn[2] >> 6) == 2)
+			{
+				Pc += 7;
+			}
+			else
+			{
+				return false;
+			}
+			break;
+		}
+	}
+
+	for (uint32_t Step = 0; Step < NSX64Unwinder::kMaxEpilogSteps; Step++)
+	{
+		pInsn = Code.Get(Pc, 1);
+		if (pInsn && (pInsn[0] & 0xF0) == 0x40)
+		{
+			pInsn = Code.Get(++Pc, 1);
+		}
+		if (!pInsn)
+		{
+			return false;
+		}
+
+		if (pInsn[0] >= 0x58 && pInsn[0] <= 0x5F)	// pop reg
+		{
+			Pc++;
+			continue;
+		}
+		if (pInsn[0] == 0xC2 || pInsn[0] == 0xC3)	// ret
+		{
+			return true;
+		}
+		if (pInsn[0] == 0xF3)						// rep ret
+		{
+			pInsn = Code.Get(Pc, 2);
+			return pInsn && pInsn[1] == 0xC3;
+		}
+		if (pInsn[0] == 0xE9 || pInsn[0] == 0xEB)	// jmp rel32, jmp rel8
+		{
+			const bool bNear = pInsn[0] == 0xE9;
+			pInsn = Code.Get(Pc, bNear ? 5 : 2);
+			if (!pInsn)
+			{
+				return false;
+			}
+			Pc += bNear ? 5 + (int64_t)(int32_t)ReadU32(pInsn + 1) : 2 + (int64_t)(int8_t)pInsn[1];
+			if (IsSameFunction(InMemory, InImageBase, InFunction, Pc))
+			{
+				continue;
+			}
+			return true;
+		}
+		if (pInsn[0] == 0xFF)						// jmp [rip + disp32]
+		{
+			pInsn = Code.Get(Pc, 2);
+			return pInsn && pInsn[1] == 0x25;
+		}
+		return false;
+	} // end for Step
+
+	return false;
+}
+
+// the ret, or the tail call that leaves the caller's return address on the stack
+static bool PopReturnAddress(FRemoteMemory &InMemory, FX64Frame &InOutFrame, uint32_t InPopBytes)
+{
+	if (!InMemory.ReadPointer(InOutFrame.Registers[x64Rsp], 8, InOutFrame.Rip))
+	{
+		return false;
+	}
+	InOutFrame.Registers[x64Rsp] += 8 + InPopBytes;
+	return true;
+}
+
+// run the rest of an epilog IsInsideEpilog() accepted
+bool FX64Unwinder::UnwindEpilog(FRemoteMemory &InMemory, uint64_t InImageBase, const FPeRuntimeFunction &InFunction, uint64_t InAddress, FX64Frame &InOutFrame) const
+{
+	FCodeReader Code(InMemory);
+	uint64_t *Registers = InOutFrame.Registers;
+	uint64_t Pc = InAddress;
+	for (uint32_t Step = 0; Step < NSX64Unwinder::kMaxEpilogSteps; Step++)
+	{
+		uint8_t Rex = 0;
+		const uint8_t *pInsn = Code.Get(Pc, 1);
+		if (pInsn && (pInsn[0] & 0xF0) == 0x40)
+		{
+			Rex = pInsn[0] & 0x0F;
+			pInsn = Code.Get(++Pc, 1);
+		}
+		if (!pInsn)
+		{
+			return false;
+		}
+
+		switch (pInsn[0])
+		{
+		case 0x58: case 0x59: case 0x5A: case 0x5B:
+		case 0x5C: case 0x5D: case 0x5E: case 0x5F:		// pop reg
+			if (!InMemory.ReadPointer(Registers[x64Rsp], 8, Registers[(pInsn[0] - 0x58) + (Rex & 1) * 8]))
+			{
+				return false;
+			}
+			Registers[x64Rsp] += 8;
+			Pc++;
+			break;
+
+		case 0x81:		// add rsp, imm32
+			if (!(pInsn = Code.Get(Pc, 6)))
+			{
+				return false;
+			}
+			Registers[x64Rsp] += (int64_t)(int32_t)ReadU32(pInsn + 2);
+			Pc += 6;
+			break;
+
+		case 0x83:		// add rsp, imm8
+			if (!(pInsn = Code.Get(Pc, 3)))
+			{
+				return false;
+			}
+			Registers[x64Rsp] += (int64_t)(int8_t)pInsn[2];
+			Pc += 3;
+			break;
+
+		case 0x8D:		// lea rsp, [reg + disp]
+			if (!(pInsn = Code.Get(Pc, 3)))
+			{
+				return false;
+			}
+			if ((pInsn[1] >> 6) == 1)
+			{
+				Registers[x64Rsp] = Registers[(pInsn[1] & 7) + (Rex & 1) * 8] + (int64_t)(int8_t)pInsn[2];
+				Pc += 3;
+			}
+			else
+			{
+				if (!(pInsn = Code.Get(Pc, 6)))
+				{
+					return false;
+				}
+				Registers[x64Rsp] = Registers[(pInsn[1] & 7) + (Rex & 1) * 8] + (int64_t)(int32_t)ReadU32(pInsn + 2);
+				Pc += 6;
+			}
+			break;
+
+		case 0xC2:		// ret imm16
+			if (!(pInsn = Code.Get(Pc, 3)))
+			{
+				return false;
+			}
+			return PopReturnAddress(InMemory, InOutFrame, ReadU16(pInsn + 1));
+
+		case 0xC3:		// ret
+		case 0xF3:		// rep ret
+		case 0xFF:		// jmp [rip + disp32]
+			return PopReturnAddress(InMemory, InOutFrame, 0);
+
+		case 0xE9:		// jmp rel32
+			if (!(pInsn = Code.Get(Pc, 5)))
+			{
+				return false;
+			}
+			Pc += 5 + (int64_t)(int32_t)ReadU32(pInsn + 1);
+			if (!IsSameFunction(InMemory, InImageBase, InFunction, Pc))
+			{
+				return PopReturnAddress(InMemory, InOutFrame, 0);
+			}
+			break;
+
+		case 0xEB:		// jmp rel8
+			if (!(pInsn = Code.Get(Pc, 2)))
+			{
+				return false;
+			}
+			Pc += 2 + (int64_t)(int8_t)pInsn[1];
+			if (!IsSameFunction(InMemory, InImageBase, InFunction, Pc))
+			{
+				return PopReturnAddress(InMemory, InOutFrame, 0);
+			}
+			break;
+
+		default:
+			return false;
+		}
+	} // end for Step
+
+	return false;
+}
+
+// the prolog codes are undone in order, the ones past the pc in the prolog are not executed yet.
+// chained records describe the rest of the prolog of the function a fragment was split from.
+bool FX64Unwinder::UnwindFrame(FRemoteMemory &InMemory, FX64Frame &InOutFrame) const
+{
+	using namespace NSX64Unwinder;
+	using namespace NSPeImage;
+
+	FX64Frame Frame = InOutFrame;
+	uint64_t *Registers = Frame.Registers;
+	bool bMachineFrame = false;
+
+	uint64_t ImageBase = 0;
+	FPeRuntimeFunction Function;
+	if (FindFunction(Frame.Rip, ImageBase, Function))
+	{
+		uint8_t Buffer[kMaxUnwindInfoBytes];
+		FPeUnwindInfo Info;
+		for (uint32_t Chain = 0; ; Chain++)
+		{
+			// an odd unwind info address refers to the entry of the function the code belongs to
+			uint8_t Entry[12];
+			while (Chain < kMaxChainDepth && (Function.UnwindInfoRva & 1))
+			{
+				if (!InMemory.ReadMemory(ImageBase + (Function.UnwindInfoRva & ~1u), Entry, sizeof(Entry)))
+				{
+					return false;
+				}
+				Function.BeginRva = ReadU32(Entry);
+				Function.EndRva = ReadU32(Entry + 4);
+				Function.UnwindInfoRva = ReadU32(Entry + 8);
+				Chain++;
+			} // end while
+
+			if (Chain >= kMaxChainDepth || !ReadUnwindInfo(InMemory, ImageBase + Function.UnwindInfoRva, Buffer, Info)
+				|| (Info.Version != 1 && Info.Version != 2))
+			{
+				return false;
+			}
+
+			const uint64_t Begin = ImageBase + Function.BeginRva;
+			uint32_t PrologOffset = kNoPrologOffset;
+			if (Frame.Rip >= Begin && Frame.Rip < Begin + Info.PrologSize)
+			{
+				PrologOffset = (uint32_t)(Frame.Rip - Begin);
+			}
+			else if (Chain == 0 && Info.CodeCount && IsInsideEpilog(InMemory, ImageBase, Function, Frame.Rip))
+			{
+				// the rest of the epilog is the unwind
+				if (!UnwindEpilog(InMemory, ImageBase, Function, Frame.Rip, Frame))
+				{
+					return false;
+				}
+				InOutFrame = Frame;
+				return true;
+			}
+
+			// saves are relative to the frame register once the prolog has set it, else to rsp
+			uint64_t FrameBase = Registers[x64Rsp];
+			if (Info.FrameRegister)
+			{
+				bool bFrameSet = PrologOffset == kNoPrologOffset;
+				for (uint32_t k = 0; k < Info.CodeCount && !bFrameSet; k += GetCodeSlots(Info.Codes[k * 2 + 1] & 0xF, Info.Codes[k * 2 + 1] >> 4))
+				{
+					if ((Info.Codes[k * 2 + 1] & 0xF) == UWOP_SET_FPREG)
+					{
+						bFrameSet = PrologOffset >= Info.Codes[k * 2];
+						break;
+					}
+				} // end for k
+				if (bFrameSet)
+				{
+					FrameBase = Registers[Info.FrameRegister] - Info.FrameOffset * 16;
+				}
+			}
+
+			uint32_t Slots = 0;
+			for (uint32_t k = 0; k < Info.CodeCount; k += Slots)
+			{
+				const uint8_t *Code = Info.Codes + k * 2;
+				const uint8_t Op = Code[1] & 0xF;
+				const uint8_t OpInfo = Code[1] >> 4;
+				Slots = GetCodeSlots(Op, OpInfo);
+				if (k + Slots > Info.CodeCount)
+				{
+					return false;
+				}
+				if (PrologOffset < Code[0])
+				{
+					continue;
+				}
+
+				switch (Op)
+				{
+				case UWOP_PUSH_NONVOL:
+					if (!InMemory.ReadPointer(Registers[x64Rsp], 8, Registers[OpInfo]))
+					{
+						return false;
+					}
+					Registers[x64Rsp] += 8;
+					break;
+
+				case UWOP_ALLOC_LARGE:
+					Registers[x64Rsp] += OpInfo ? ReadU32(Code + 2) : ReadU16(Code + 2) * 8u;
+					break;
+
+				case UWOP_ALLOC_SMALL:
+					Registers[x64Rsp] += OpInfo * 8u + 8;
+					break;
+
+				case UWOP_SET_FPREG:
+					Registers[x64Rsp] = FrameBase;
+					break;
+
+				case UWOP_SAVE_NONVOL:
+					if (!InMemory.ReadPointer(FrameBase + ReadU16(Code + 2) * 8u, 8, Registers[OpInfo]))
+					{
+						return false;
+					}
+					break;
+
+				case UWOP_SAVE_NONVOL_FAR:
+					if (!InMemory.ReadPointer(FrameBase + ReadU32(Code + 2), 8, Registers[OpInfo]))
+					{
+						return false;
+					}
+					break;
+
+				case UWOP_SAVE_XMM128:
+				case UWOP_SAVE_XMM128_FAR:
+				case UWOP_EPILOG:
+				case UWOP_SPARE_CODE:
+					// xmm registers are not tracked, version 2 epilog descriptions are not needed
+					break;
+
+				case UWOP_PUSH_MACHFRAME:
+					{
+						// rip, cs, eflags, rsp and ss, after an error code if OpInfo says so
+						const uint64_t MachineFrame = Registers[x64Rsp] + (OpInfo ? 8 : 0);
+						if (!InMemory.ReadPointer(MachineFrame, 8, Frame.Rip) || !InMemory.ReadPointer(MachineFrame + 24, 8, Registers[x64Rsp]))
+						{
+							return false;
+						}
+						bMachineFrame = true;
+					}
+					break;
+
+				default:
+					return false;
+				}
+			} // end for k
+
+			if (!(Info.Flags & UNW_FLAG_CHAININFO))
+			{
+				break;
+			}
+			Function = Info.Chained;
+		} // end for Chain
+	}
+
+	// the return address is what the call pushed, a leaf function has not moved rsp
+	if (!bMachineFrame)
+	{
+		if (!InMemory.ReadPointer(Registers[x64Rsp], 8, Frame.Rip))
+		{
+			return false;
+		}
+		Registers[x64Rsp] += 8;
+	}
+
+	InOutFrame = Frame;
+	return true;
+}
+
+uint32_t FX64Unwinder::CaptureStack(FRemoteMemory &InMemory, const FX64Frame &InFrame, uint64_t *OutAddresses, uint32_t InMaxDepth) const
+{
+	FX64Frame Frame = InFrame;
+	uint32_t Depth = 0;
+	while (Depth < InMaxDepth && Frame.Rip)
+	{
+		OutAddresses[Depth++] = Frame.Rip;
+
+		const uint64_t Rsp = Frame.Registers[x64Rsp];
+		if (!UnwindFrame(InMemory, Frame) || Frame.Registers[x64Rsp] <= Rsp)
+		{
+			break;
+		}
+	} // end while
+
+	return Depth;
+}
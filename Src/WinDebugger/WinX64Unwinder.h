@@ -0,0 +1,80 @@
+// \brief
+//		x64 stack unwinder driven by .pdata and UNWIND_INFO, the way RtlVirtualUnwind does it: a function
+//		with a RUNTIME_FUNCTION entry is unwound by undoing its prolog codes, or by running the rest of
+//		its epilog when the pc is in one, a function without one is a leaf. the runtime functions of each
+//		module are copied once into a sorted table, unwind records and stack memory are read through
+//		the reader passed in, which should be a page cache.
+//
+// ref: https://learn.microsoft.com/en-us/cpp/build/exception-handling-x64
+//
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "WinPeImage.h"
+
+class FRemoteMemory;
+
+
+// general purpose registers, in the order unwind codes number them
+enum X64RegisterEnum {
+	x64Rax,
+	x64Rcx,
+	x64Rdx,
+	x64Rbx,
+	x64Rsp,
+	x64Rbp,
+	x64Rsi,
+	x64Rdi,
+	x64R8,
+	x64R9,
+	x64R10,
+	x64R11,
+	x64R12,
+	x64R13,
+	x64R14,
+	x64R15,
+	x64RegisterCount
+};
+
+// the registers of a frame. only the nonvolatile ones are meaningful past the first frame.
+struct FX64Frame
+{
+	uint64_t	Rip;
+	uint64_t	Registers[x64RegisterCount];
+};
+
+class FX64Unwinder
+{
+public:
+	// the .pdata of a module, copied. a module without one has only leaf functions.
+	void AddModule(uint64_t InImageBase, uint32_t InImageSize, const FPeImage &InImage);
+	void RemoveModule(uint64_t InImageBase);
+	void Clear();
+
+	// the runtime function containing InAddress, false in a leaf function or outside the modules
+	bool FindFunction(uint64_t InAddress, uint64_t &OutImageBase, FPeRuntimeFunction &OutFunction) const;
+
+	// the registers of the caller, false if the memory the unwind needs is not readable
+	bool UnwindFrame(FRemoteMemory &InMemory, FX64Frame &InOutFrame) const;
+	// InFrame.Rip, then the return address of each caller, until the pc is 0, the stack does not
+	// grow or InMaxDepth addresses. returns the number of addresses.
+	uint32_t CaptureStack(FRemoteMemory &InMemory, const FX64Frame &InFrame, uint64_t *OutAddresses, uint32_t InMaxDepth) const;
+
+private:
+	struct FModule
+	{
+		uint64_t							ImageBase;
+		uint32_t							ImageSize;
+		std::vector<FPeRuntimeFunction>		Functions;		// sorted by BeginRva
+	};
+
+	// InAddress is in InFunction or in a fragment split from the same function, else a jump to it is a tail call
+	bool IsSameFunction(FRemoteMemory &InMemory, uint64_t InImageBase, const FPeRuntimeFunction &InFunction, uint64_t InAddress) const;
+	bool IsInsideEpilog(FRemoteMemory &InMemory, uint64_t InImageBase, const FPeRuntimeFunction &InFunction, uint64_t InAddress) const;
+	bool UnwindEpilog(FRemoteMemory &InMemory, uint64_t InImageBase, const FPeRuntimeFunction &InFunction, uint64_t InAddress, FX64Frame &InOutFrame) const;
+
+	std::vector<FModule>	Modules;		// sorted by ImageBase
+};